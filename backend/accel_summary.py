@@ -0,0 +1,201 @@
+import json
+import math
+import time
+from datetime import datetime, timezone
+from pathlib import Path
+from threading import Lock
+
+from listener_snapshots import latest_updated_at, read_all, writer_path
+
+# Per-node accel overview built from the summary block every data packet
+# carries (firmware mqtt.h, "s"): real / NaN sample counts and per-axis min,
+# max, mean and RMS in g, computed on the node while it decimates.
+#
+# The data listener folds each packet's summary into OVERVIEW_BUCKET_S
+# buckets; the last OVERVIEW_WINDOW_S of them are flushed to
+# ACCEL_SUMMARY_JSON, which the backend serves at /api/accel/overview.
+# Neither side looks at the 200 samples of a packet.
+# A partitioned listener writes one file per process (listener_snapshots.py).
+ACCEL_SUMMARY_JSON = Path("/home/pi/accel_summary.json")
+_WRITE_PATH = writer_path(ACCEL_SUMMARY_JSON)
+_FLUSH_INTERVAL = 10.0  # seconds
+
+OVERVIEW_BUCKET_S = 10
+OVERVIEW_WINDOW_S = 3600
+
+_LOCK = Lock()
+_NODES: dict = {}
+_LAST_FLUSH_TIME = 0.0
+
+
+def _now_iso() -> str:
+    return datetime.now(timezone.utc).isoformat()
+
+
+def _axis_list(value):
+    if isinstance(value, list) and len(value) == 3:
+        try:
+            out = [float(v) for v in value]
+        except (TypeError, ValueError):
+            return None
+        if all(math.isfinite(v) for v in out):
+            return out
+    return None
+
+
+def packet_summary(data: dict):
+    """The packet's summary block, or None when the node did not send one."""
+    summary = data.get("s")
+    if not isinstance(summary, dict):
+        return None
+    try:
+        real = int(summary.get("n", 0))
+        nan = int(summary.get("nan", 0))
+    except (TypeError, ValueError):
+        return None
+    out = {"n": real, "nan": nan}
+    if real > 0:
+        for key in ("min", "max", "mean", "rms"):
+            axes = _axis_list(summary.get(key))
+            if axes is None:
+                return None
+            out[key] = axes
+    return out
+
+
+class _Bucket:
+    """Summaries of the packets that started within one bucket."""
+
+    def __init__(self, start_s: float):
+        self.start_s = start_s
+        self.packets = 0
+        self.n = 0
+        self.nan = 0
+        self.min = [math.inf] * 3
+        self.max = [-math.inf] * 3
+        self.sum = [0.0] * 3        # mean x n, per axis
+        self.sum_sq = [0.0] * 3     # rms^2 x n, per axis
+
+    def add(self, summary: dict) -> None:
+        self.packets += 1
+        self.nan += summary["nan"]
+        real = summary["n"]
+        if real <= 0:
+            return
+        self.n += real
+        for a in range(3):
+            self.min[a] = min(self.min[a], summary["min"][a])
+            self.max[a] = max(self.max[a], summary["max"][a])
+            self.sum[a] += summary["mean"][a] * real
+            self.sum_sq[a] += summary["rms"][a] ** 2 * real
+
+    def snapshot(self) -> dict:
+        point = {
+            "ts": datetime.fromtimestamp(self.start_s, tz=timezone.utc).isoformat(),
+            "packets": self.packets,
+            "n": self.n,
+            "nan": self.nan,
+        }
+        if self.n > 0:
+            point["min"] = [round(v, 6) for v in self.min]
+            point["max"] = [round(v, 6) for v in self.max]
+            point["mean"] = [round(v / self.n, 6) for v in self.sum]
+            point["rms"] = [round(math.sqrt(v / self.n), 6) for v in self.sum_sq]
+        return point
+
+
+class _NodeSummary:
+    def __init__(self):
+        self.buckets: dict = {}     # bucket start (s) -> _Bucket
+        self.latest = None
+        self.latest_ts = None
+
+    def add(self, sample_s: float, summary: dict) -> None:
+        start = math.floor(sample_s / OVERVIEW_BUCKET_S) * OVERVIEW_BUCKET_S
+        bucket = self.buckets.get(start)
+        if bucket is None:
+            bucket = self.buckets[start] = _Bucket(start)
+        bucket.add(summary)
+
+        if self.latest_ts is None or sample_s >= self.latest_ts:
+            self.latest = summary
+            self.latest_ts = sample_s
+
+        horizon = time.time() - OVERVIEW_WINDOW_S
+        for old in [s for s in self.buckets if s < horizon]:
+            del self.buckets[old]
+
+    def snapshot(self) -> dict:
+        return {
+            "latest": self.latest,
+            "latest_ts": (datetime.fromtimestamp(self.latest_ts, tz=timezone.utc).isoformat()
+                          if self.latest_ts is not None else None),
+            "points": [self.buckets[s].snapshot() for s in sorted(self.buckets)],
+        }
+
+
+def _first_sample_s(data: dict):
+    # First accel sample time, or the accel gap start, after
+    # normalise_sensor_timestamps()
+    accel = data.get("a")
+    if isinstance(accel, list) and accel and isinstance(accel[0], list):
+        ts = accel[0][0]
+        if isinstance(ts, (int, float)):
+            return float(ts)
+    for gap in data.get("g") or []:
+        if isinstance(gap, list) and len(gap) > 2 and gap[2] == "a":
+            if isinstance(gap[0], (int, float)):
+                return float(gap[0])
+    return None
+
+
+def note_packet(serial: str, data: dict) -> None:
+    """Fold one normalised data packet's summary into the node overview."""
+    summary = packet_summary(data)
+    sample_s = _first_sample_s(data)
+    if summary is None or sample_s is None:
+        return
+    with _LOCK:
+        node = _NODES.get(serial)
+        if node is None:
+            node = _NODES[serial] = _NodeSummary()
+        node.add(sample_s, summary)
+    _flush_to_disk()
+
+
+def snapshot() -> dict:
+    with _LOCK:
+        return {
+            "updated_at": _now_iso(),
+            "bucket_s": OVERVIEW_BUCKET_S,
+            "nodes": {serial: node.snapshot() for serial, node in _NODES.items()},
+        }
+
+
+# Write the snapshot for the backend at most every _FLUSH_INTERVAL.
+def _flush_to_disk() -> None:
+    global _LAST_FLUSH_TIME
+
+    now = time.time()
+    if now - _LAST_FLUSH_TIME < _FLUSH_INTERVAL:
+        return
+    _LAST_FLUSH_TIME = now
+
+    try:
+        _WRITE_PATH.parent.mkdir(parents=True, exist_ok=True)
+        tmp_path = _WRITE_PATH.with_suffix(".tmp")
+        tmp_path.write_text(json.dumps(snapshot(), separators=(",", ":")), encoding="utf-8")
+        tmp_path.replace(_WRITE_PATH)
+    except OSError as e:
+        print(f"[accel_summary] Failed to write {_WRITE_PATH}: {e}")
+
+
+# Backend side: the last snapshot written by the data listener (merged
+# over its processes, which each hold different nodes).
+def load_accel_summaries() -> dict:
+    snapshots = read_all(ACCEL_SUMMARY_JSON)
+    return {
+        "updated_at": latest_updated_at(snapshots),
+        "bucket_s": OVERVIEW_BUCKET_S,
+        "nodes": {serial: node for s in snapshots for serial, node in s.get("nodes", {}).items()},
+    }
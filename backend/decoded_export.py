@@ -0,0 +1,304 @@
+from __future__ import annotations
+
+import io
+import os
+import queue
+import threading
+from concurrent.futures import ThreadPoolExecutor
+from datetime import datetime, timezone
+
+from export_utils import find_sensor_files_for_serial
+from sensor_export_decoder import (
+    columns_available,
+    iter_decoded_columns,
+    iter_decoded_records_for_export,
+)
+
+try:
+    import pyarrow
+    import pyarrow.parquet as pyarrow_parquet
+except ImportError:     # optional dependency: CSV only without it
+    pyarrow = None
+
+# Server-side decoded sensor export (/api/exports/sensor-data/decoded).
+#
+# The raw export hands out whole hourly .bin files. Here the Pi decodes the
+# files overlapping the window through their time index, keeps the samples
+# inside [start, end) and the requested axes, optionally averages them onto
+# a fixed rate grid, and streams one CSV or Parquet member per node and
+# sensor into the ZIP (export_utils.stream_zip()).
+#
+# Members are produced by EXPORT_WORKERS threads (at lowered priority) ahead
+# of the ZIP writer, which takes them in order. Each member hands over
+# encoded chunks of EXPORT_CHUNK_ROWS rows through a bounded queue sized so
+# that all running members together hold at most EXPORT_MEMORY_BUDGET_BYTES;
+# a worker that gets ahead of the download simply waits. A large export
+# therefore costs bounded memory and CPU, not ingest headroom.
+EXPORT_WORKERS = max(1, int(os.getenv("SHM_EXPORT_WORKERS", "2")))
+EXPORT_MEMORY_BUDGET_BYTES = int(float(os.getenv("SHM_EXPORT_MEMORY_MB", "32")) * 1024 * 1024)
+EXPORT_CHUNK_ROWS = 20000
+EXPORT_CHUNK_BYTES_EST = EXPORT_CHUNK_ROWS * 64     # ~ one CSV / Arrow row of 3 axes
+EXPORT_WORKER_NICE = 10
+EXPORT_FORMATS = ("csv", "parquet")
+
+EXPORT_SENSOR_AXES = {
+    "accel": ("x", "y", "z"),
+    "inclin": ("roll", "pitch", "yaw"),
+    "temp": ("value",),
+}
+
+_DONE = object()
+
+
+def parquet_available() -> bool:
+    return pyarrow is not None
+
+
+def parse_channels(sensors: str, axes: str | None) -> dict[str, tuple[str, ...]]:
+    """{sensor: selected axes} from "accel,temp" and an optional axis list
+    such as "x,z,roll" (axis names are unique across sensors)."""
+    wanted = [s.strip() for s in sensors.split(",") if s.strip()]
+    unknown = [s for s in wanted if s not in EXPORT_SENSOR_AXES]
+    if not wanted or unknown:
+        raise ValueError(f"sensors must be a list of {', '.join(EXPORT_SENSOR_AXES)}.")
+    axis_filter = {a.strip() for a in axes.split(",") if a.strip()} if axes else None
+
+    channels = {}
+    for sensor in dict.fromkeys(wanted):
+        names = EXPORT_SENSOR_AXES[sensor]
+        picked = tuple(a for a in names if axis_filter is None or a in axis_filter)
+        if picked:
+            channels[sensor] = picked
+    if axis_filter is not None:
+        known = {a for names in EXPORT_SENSOR_AXES.values() for a in names}
+        if axis_filter - known:
+            raise ValueError(f"Unknown axes: {', '.join(sorted(axis_filter - known))}.")
+    if not channels:
+        raise ValueError("No axis of the selected sensors was requested.")
+    return channels
+
+
+def _record_samples(rec: dict, sensor: str):
+    # (ts, values...) of one sensor in a decoded record
+    if sensor == "accel":
+        return rec.get("accel_samples") or ()
+    if sensor == "inclin":
+        return rec.get("inclin") or ()
+    temp = rec.get("temp")
+    return (temp,) if temp else ()
+
+
+def _iter_rows(serial: str, sensor: str, picks: tuple, window: tuple):
+    # (ts, selected values...) of one sensor in [start_s, end_s), file by file
+    start_iso, end_iso, start_s, end_s = window
+    for path in find_sensor_files_for_serial(serial, start_iso, end_iso):
+        if columns_available():
+            # Window cut and axis pick on whole columns, not per sample
+            for block in iter_decoded_columns(str(path), start_s, end_s):
+                columns = block.get(sensor)
+                if columns is None:
+                    continue
+                keep = (columns[0] >= start_s) & (columns[0] < end_s)
+                picked = [columns[0][keep]] + [columns[1 + i][keep] for i in picks]
+                yield from zip(*(c.tolist() for c in picked))
+            continue
+        for rec in iter_decoded_records_for_export(str(path), start_s, end_s):
+            for sample in _record_samples(rec, sensor):
+                ts = sample[0]
+                if start_s <= ts < end_s:
+                    yield (ts,) + tuple(sample[1 + i] for i in picks)
+
+
+def _resampled(rows, rate_hz: float, start_s: float, width: int):
+    # Mean of each axis per 1 / rate_hz bucket, stamped with the bucket start
+    step = 1.0 / rate_hz
+    bucket = None
+    sums = counts = None
+    for row in rows:
+        b = int((row[0] - start_s) // step)
+        if b != bucket:
+            if bucket is not None:
+                yield (start_s + bucket * step,) + tuple(
+                    sums[i] / counts[i] if counts[i] else None for i in range(width)
+                )
+            bucket, sums, counts = b, [0.0] * width, [0] * width
+        for i, v in enumerate(row[1:]):
+            if v is not None and v == v:
+                sums[i] += v
+                counts[i] += 1
+    if bucket is not None:
+        yield (start_s + bucket * step,) + tuple(
+            sums[i] / counts[i] if counts[i] else None for i in range(width)
+        )
+
+
+def _chunks(rows, size: int):
+    chunk = []
+    for row in rows:
+        chunk.append(row)
+        if len(chunk) >= size:
+            yield chunk
+            chunk = []
+    if chunk:
+        yield chunk
+
+
+def _csv_value(v) -> str:
+    if v is None or v != v:
+        return ""
+    return repr(round(v, 6))
+
+
+def _encode_csv(axes: tuple, chunks):
+    yield ("ts_s," + ",".join(axes) + "\n").encode()
+    for chunk in chunks:
+        lines = [f"{row[0]:.6f}," + ",".join(_csv_value(v) for v in row[1:]) for row in chunk]
+        yield ("\n".join(lines) + "\n").encode()
+
+
+class _DrainSink(io.RawIOBase):
+    # Append-only file for ParquetWriter, emptied after every row group
+    def __init__(self):
+        self.chunks: list[bytes] = []
+        self.pos = 0
+
+    def writable(self) -> bool:
+        return True
+
+    def tell(self) -> int:
+        return self.pos
+
+    def write(self, b) -> int:
+        self.chunks.append(bytes(b))
+        self.pos += len(b)
+        return len(b)
+
+    def drain(self) -> bytes:
+        out = b"".join(self.chunks)
+        self.chunks = []
+        return out
+
+
+def _encode_parquet(axes: tuple, chunks):
+    # One row group per chunk; the footer comes with the last one
+    schema = pyarrow.schema(
+        [("ts", pyarrow.timestamp("us", tz="UTC"))] + [(a, pyarrow.float64()) for a in axes]
+    )
+    sink = _DrainSink()
+    writer = pyarrow_parquet.ParquetWriter(sink, schema, compression="zstd")
+    try:
+        for chunk in chunks:
+            columns = [pyarrow.array([int(round(row[0] * 1_000_000)) for row in chunk],
+                                     pyarrow.timestamp("us", tz="UTC"))]
+            for i in range(len(axes)):
+                columns.append(pyarrow.array(
+                    [None if row[1 + i] != row[1 + i] else row[1 + i] for row in chunk],
+                    pyarrow.float64(),
+                ))
+            writer.write_table(pyarrow.Table.from_arrays(columns, schema=schema))
+            yield sink.drain()
+    finally:
+        writer.close()
+    yield sink.drain()
+
+
+def _lower_priority() -> None:
+    try:
+        tid = threading.get_native_id()
+        os.setpriority(os.PRIO_PROCESS, tid, os.getpriority(os.PRIO_PROCESS, tid) + EXPORT_WORKER_NICE)
+    except (AttributeError, OSError):
+        pass
+
+
+class _Member:
+    """One output file, produced on a worker into a bounded queue."""
+
+    def __init__(self, arcname: str, produce, capacity: int, cancel: threading.Event):
+        self.arcname = arcname
+        self.produce = produce
+        self.queue: queue.Queue = queue.Queue(maxsize=capacity)
+        self.cancel = cancel
+        self.rows = 0
+
+    def _put(self, item) -> bool:
+        while not self.cancel.is_set():
+            try:
+                self.queue.put(item, timeout=0.5)
+                return True
+            except queue.Full:
+                continue
+        return False
+
+    def run(self) -> None:
+        _lower_priority()
+        try:
+            for data in self.produce(self):
+                if data and not self._put(data):
+                    return
+            self._put(_DONE)
+        except Exception as e:
+            self._put(e)
+
+    def chunks(self):
+        while True:
+            item = self.queue.get()
+            if item is _DONE:
+                return
+            if isinstance(item, Exception):
+                raise item
+            yield item
+
+
+def _member_producer(serial: str, sensor: str, axes: tuple, window: tuple, rate_hz, fmt: str):
+    names = EXPORT_SENSOR_AXES[sensor]
+    picks = tuple(names.index(a) for a in axes)
+
+    def produce(member: _Member):
+        rows = _iter_rows(serial, sensor, picks, window)
+        if rate_hz:
+            rows = _resampled(rows, rate_hz, window[2], len(picks))
+
+        def counted(chunks):
+            for chunk in chunks:
+                member.rows += len(chunk)
+                yield chunk
+
+        chunks = counted(_chunks(rows, EXPORT_CHUNK_ROWS))
+        if fmt == "parquet":
+            return _encode_parquet(axes, chunks)
+        return _encode_csv(axes, chunks)
+
+    return produce
+
+
+def iter_decoded_members(nodes: list[dict], channels: dict, window: tuple,
+                         rate_hz: float | None, fmt: str, summary: dict):
+    """
+    (arcname, chunk iterator, None, mtime) ZIP members of a decoded export,
+    in node / sensor order. summary[arcname] gets each member's row count
+    once it is complete. window is (start_iso, end_iso, start_s, end_s).
+    """
+    suffix = ".parquet" if fmt == "parquet" else ".csv"
+    capacity = max(1, EXPORT_MEMORY_BUDGET_BYTES // (EXPORT_CHUNK_BYTES_EST * EXPORT_WORKERS))
+    cancel = threading.Event()
+
+    members = []
+    for node in nodes:
+        for sensor, axes in channels.items():
+            arcname = f"decoded_data/node_{node['node_id']}_{sensor}{suffix}"
+            producer = _member_producer(str(node["serial"]), sensor, axes, window, rate_hz, fmt)
+            members.append(_Member(arcname, producer, capacity, cancel))
+
+    executor = ThreadPoolExecutor(max_workers=EXPORT_WORKERS, thread_name_prefix="decoded-export")
+    try:
+        # FIFO submission: the member the ZIP writer is on is always running
+        for member in members:
+            executor.submit(member.run)
+        now = datetime.now(timezone.utc).timestamp()
+        for member in members:
+            yield member.arcname, member.chunks(), None, now
+            summary[member.arcname] = member.rows
+    finally:
+        # Download finished or abandoned: stop the workers still running
+        cancel.set()
+        executor.shutdown(wait=False, cancel_futures=True)
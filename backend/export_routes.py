@@ -1,11 +1,14 @@
 from __future__ import annotations
 
+import io
+import os
 import sqlite3
+import time
 from pathlib import Path
 from typing import Optional
 
-from fastapi import APIRouter, HTTPException, Query
-from fastapi.responses import FileResponse
+from fastapi import APIRouter, Depends, HTTPException, Query
+from fastapi.responses import FileResponse, StreamingResponse
 from starlette.background import BackgroundTask
 
 from export_utils import (
@@ -17,9 +20,7 @@ from export_utils import (
     build_raw_sensor_export_metadata_text,
     build_sensor_export_zip_filename,
     build_where_sql,
-    create_temp_export_dir,
     create_temp_export_path,
-    create_zip_from_paths,
     extract_raw_bucket_from_filename,
     extract_sensor_bucket_from_filename,
     find_raw_sensor_files_for_serial,
@@ -27,25 +28,24 @@ from export_utils import (
     is_fault_db_available,
     is_raw_sensor_data_available,
     is_sensor_data_available,
+    parse_export_window,
+    parse_iso_to_epoch_seconds,
     parse_node_ids_csv,
-    remove_temp_dir,
+    sanitize_filename_part,
     remove_temp_file,
-    stage_files_for_zip,
+    stream_zip,
     utc_now_iso,
     validate_required_day_hour_range,
     write_fault_csv,
-    write_text_file,
 )
+from auth.auth_dependencies import get_current_user
+from decoded_export import iter_decoded_members, parquet_available, parse_channels
 from node_registry import get_node_by_id
+import query_executor
 
 router = APIRouter()
 
 
-def _cleanup_sensor_export(export_dir: Path, zip_path: Path) -> None:
-    remove_temp_file(zip_path)
-    remove_temp_dir(export_dir)
-
-
 @router.get("/api/exports/faults")
 def export_faults(
     start_day: Optional[str] = Query(default=None),
@@ -139,15 +139,18 @@ def export_sensor_data(
     start_hour: Optional[str] = Query(default=None),
     end_hour: Optional[str] = Query(default=None),
     include_raw_data: bool = Query(default=False),
+    user=Depends(get_current_user),
 ):
     """
     Export matching sensor storage files for the selected nodes and date/hour range.
 
     Output format:
     - always returns a ZIP
-    - includes processed .bin / .bin.gz files when available
+    - includes processed .bin / .bin.gz / .bin.zst files when available
     - includes raw .rawbin files unchanged when include_raw_data=true
-    - includes export_metadata.txt
+    - includes export_metadata.txt, last
+    - streamed as it is built (members STORED, ZIP64 when needed), with no
+      staging copy or temporary ZIP on disk
     """
     processed_available = is_sensor_data_available()
     raw_available = is_raw_sensor_data_available()
@@ -177,93 +180,77 @@ def export_sensor_data(
     except ValueError as exc:
         raise HTTPException(status_code=400, detail=str(exc)) from exc
 
-    resolved_nodes: list[dict[str, object]] = []
-    for node_id in parsed_node_ids:
-        node = get_node_by_id(node_id, timeout_seconds=300)
-        if node is None:
-            raise HTTPException(status_code=404, detail=f"Node {node_id} not found.")
+    resolved_nodes = _resolve_export_nodes(parsed_node_ids)
 
-        serial = str(node.get("serial") or "").strip()
-        if not serial:
-            raise HTTPException(status_code=400, detail=f"Node {node_id} has no serial number.")
+    sources: list[tuple[str, str, Path, str]] = []     # (serial, kind, path, export name)
 
-        resolved_nodes.append(
-            {
-                "node_id": node_id,
-                "serial": serial,
-                "label": node.get("label") or f"Node {node_id}",
-            }
-        )
+    for node in resolved_nodes:
+        node_id = int(node["node_id"])
+        serial = str(node["serial"])
 
-    export_dir = create_temp_export_dir(prefix="sensor_export_")
-    zip_path = create_temp_export_path(prefix="sensor_export_", suffix=".zip")
+        processed_matching_files = (
+            find_sensor_files_for_serial(
+                serial=serial,
+                start_iso=start_iso,
+                end_exclusive_iso=end_exclusive_iso,
+            )
+            if processed_available
+            else []
+        )
 
-    staged_sources: list[tuple[Path, str]] = []
-    node_file_counts: dict[str, int] = {}
-    exported_files: dict[str, list[str]] = {}
-    raw_node_file_counts: dict[str, int] = {}
-    raw_exported_files: dict[str, list[str]] = {}
+        for source_path in processed_matching_files:
+            bucket_day, bucket_hour = extract_sensor_bucket_from_filename(source_path.name)
+            export_name = build_export_member_name(
+                node_id=node_id,
+                bucket_day=bucket_day,
+                bucket_hour=bucket_hour,
+                source_name=source_path.name,
+            )
+            sources.append((serial, "processed", source_path, export_name))
 
-    try:
-        for node in resolved_nodes:
-            node_id = int(node["node_id"])
-            serial = str(node["serial"])
-
-            processed_matching_files = (
-                find_sensor_files_for_serial(
-                    serial=serial,
-                    start_iso=start_iso,
-                    end_exclusive_iso=end_exclusive_iso,
-                )
-                if processed_available
-                else []
+        if include_raw_data:
+            raw_matching_files = find_raw_sensor_files_for_serial(
+                serial=serial,
+                start_iso=start_iso,
+                end_exclusive_iso=end_exclusive_iso,
             )
 
-            renamed_processed_files: list[str] = []
-            for source_path in processed_matching_files:
-                bucket_day, bucket_hour = extract_sensor_bucket_from_filename(source_path.name)
-                export_name = build_export_member_name(
+            for source_path in raw_matching_files:
+                bucket_day, bucket_hour = extract_raw_bucket_from_filename(source_path.name)
+                export_name = build_raw_export_member_name(
                     node_id=node_id,
                     bucket_day=bucket_day,
                     bucket_hour=bucket_hour,
-                    source_name=source_path.name,
-                )
-                staged_sources.append((source_path, export_name))
-                renamed_processed_files.append(export_name)
-
-            node_file_counts[serial] = len(processed_matching_files)
-            exported_files[serial] = renamed_processed_files
-
-            if include_raw_data:
-                raw_matching_files = find_raw_sensor_files_for_serial(
-                    serial=serial,
-                    start_iso=start_iso,
-                    end_exclusive_iso=end_exclusive_iso,
                 )
+                sources.append((serial, "raw", source_path, export_name))
 
-                renamed_raw_files: list[str] = []
-                for source_path in raw_matching_files:
-                    bucket_day, bucket_hour = extract_raw_bucket_from_filename(source_path.name)
-                    export_name = build_raw_export_member_name(
-                        node_id=node_id,
-                        bucket_day=bucket_day,
-                        bucket_hour=bucket_hour,
-                    )
-                    staged_sources.append((source_path, export_name))
-                    renamed_raw_files.append(export_name)
-
-                raw_node_file_counts[serial] = len(raw_matching_files)
-                raw_exported_files[serial] = renamed_raw_files
-
-        if not staged_sources:
-            raise HTTPException(
-                status_code=404,
-                detail="No sensor files matched the selected nodes and date/hour range.",
-            )
+    if not sources:
+        raise HTTPException(
+            status_code=404,
+            detail="No sensor files matched the selected nodes and date/hour range.",
+        )
 
-        staged_file_paths = stage_files_for_zip(export_dir, staged_sources)
+    def zip_members():
+        # Files are opened as the ZIP reaches them; the metadata goes last
+        # so it lists what was actually exported
+        node_file_counts: dict[str, int] = {str(node["serial"]): 0 for node in resolved_nodes}
+        exported_files: dict[str, list[str]] = {serial: [] for serial in node_file_counts}
+        raw_node_file_counts: dict[str, int] = dict(node_file_counts)
+        raw_exported_files: dict[str, list[str]] = {serial: [] for serial in node_file_counts}
+
+        for serial, kind, source_path, export_name in sources:
+            opened = _open_export_source(source_path, export_name)
+            if opened is None:
+                continue
+            source, size, mtime, export_name = opened
+            if kind == "processed":
+                node_file_counts[serial] += 1
+                exported_files[serial].append(export_name)
+            else:
+                raw_node_file_counts[serial] += 1
+                raw_exported_files[serial].append(export_name)
+            yield export_name, source, size, mtime
 
-        metadata_path = export_dir / "export_metadata.txt"
         metadata_text = build_raw_sensor_export_metadata_text(
             generated_at=utc_now_iso(),
             start_day=start_day,
@@ -275,25 +262,8 @@ def export_sensor_data(
             exported_files=exported_files,
             raw_node_file_counts=raw_node_file_counts if include_raw_data else None,
             raw_exported_files=raw_exported_files if include_raw_data else None,
-        )
-        write_text_file(metadata_path, metadata_text)
-
-        zip_members = [metadata_path, *staged_file_paths]
-
-        # Preserve processed_data/ and raw_data/ inside the ZIP.
-        create_zip_from_paths(zip_path=zip_path, members=zip_members, root_dir=export_dir)
-
-    except HTTPException:
-        remove_temp_file(zip_path)
-        remove_temp_dir(export_dir)
-        raise
-    except Exception as exc:
-        remove_temp_file(zip_path)
-        remove_temp_dir(export_dir)
-        raise HTTPException(
-            status_code=500,
-            detail=f"Failed to export sensor data: {exc}",
-        ) from exc
+        ).encode("utf-8")
+        yield "export_metadata.txt", io.BytesIO(metadata_text), len(metadata_text), time.time()
 
     # Use serial numbers in the ZIP filename.
     filename = build_sensor_export_zip_filename(
@@ -304,9 +274,130 @@ def export_sensor_data(
         end_hour=parsed_end_hour,
     )
 
-    return FileResponse(
-        path=str(zip_path),
+    return StreamingResponse(
+        query_executor.stream(user, stream_zip(zip_members())),
         media_type="application/zip",
-        filename=filename,
-        background=BackgroundTask(_cleanup_sensor_export, export_dir, zip_path),
+        headers={"Content-Disposition": f'attachment; filename="{filename}"'},
+    )
+
+
+@router.get("/api/exports/sensor-data/decoded")
+def export_decoded_sensor_data(
+    node_ids: str = Query(..., description="Comma-separated node ids, e.g. 1,2,3"),
+    start: str = Query(..., description="Window start, ISO 8601 (UTC if no offset)"),
+    end: str = Query(..., description="Window end (exclusive), ISO 8601"),
+    sensors: str = Query(default="accel,inclin,temp"),
+    axes: Optional[str] = Query(default=None, description="e.g. x,z,roll; default all"),
+    rate_hz: Optional[float] = Query(default=None, gt=0, le=4000),
+    format: str = Query(default="csv", pattern="^(csv|parquet)$"),
+    user=Depends(get_current_user),
+):
+    """
+    Decode the selected nodes' samples on the Pi and export them cut to the
+    exact window and channels (see decoded_export.py).
+
+    Output format:
+    - always returns a ZIP, streamed as it is built
+    - decoded_data/node_<id>_<sensor>.csv|.parquet per node and sensor:
+      ts_s (or ts for Parquet) plus one column per selected axis, averaged
+      per 1 / rate_hz bucket when rate_hz is given
+    - includes export_metadata.txt, last
+    """
+    if not is_sensor_data_available():
+        raise HTTPException(
+            status_code=503,
+            detail="Sensor export unavailable because the SSD storage directories are not available.",
+        )
+    if format == "parquet" and not parquet_available():
+        raise HTTPException(status_code=400, detail="Parquet export needs pyarrow on the Pi; use format=csv.")
+
+    try:
+        parsed_node_ids = parse_node_ids_csv(node_ids)
+        start_iso, end_exclusive_iso = parse_export_window(start, end)
+        channels = parse_channels(sensors, axes)
+    except ValueError as exc:
+        raise HTTPException(status_code=400, detail=str(exc)) from exc
+
+    resolved_nodes = _resolve_export_nodes(parsed_node_ids)
+    window = (
+        start_iso,
+        end_exclusive_iso,
+        parse_iso_to_epoch_seconds(start_iso),
+        parse_iso_to_epoch_seconds(end_exclusive_iso),
+    )
+
+    def zip_members():
+        row_counts: dict[str, int] = {}
+        yield from iter_decoded_members(resolved_nodes, channels, window, rate_hz, format, row_counts)
+
+        lines = [
+            "SHM decoded sensor export",
+            f"Generated at: {utc_now_iso()}",
+            f"Window: {start_iso} to {end_exclusive_iso} (end exclusive)",
+            f"Format: {format}",
+            f"Resampled to: {f'{rate_hz:g} Hz (bucket mean)' if rate_hz else 'no (native sample times)'}",
+            "Channels: " + "; ".join(f"{sensor}: {', '.join(a)}" for sensor, a in channels.items()),
+            "",
+            "Nodes:",
+        ]
+        for node in resolved_nodes:
+            lines.append(f"- Node {node['node_id']} ({node['label']}, serial {node['serial']})")
+        lines += ["", "Files (rows):"]
+        lines += [f"- {name}: {rows}" for name, rows in row_counts.items()]
+        metadata_text = ("\n".join(lines) + "\n").encode("utf-8")
+        yield "export_metadata.txt", io.BytesIO(metadata_text), len(metadata_text), time.time()
+
+    safe_start = sanitize_filename_part(start_iso[:16].replace(":", ""))
+    safe_end = sanitize_filename_part(end_exclusive_iso[:16].replace(":", ""))
+    filename = f"decoded_{'_'.join(str(n['serial']) for n in resolved_nodes)}_{safe_start}_{safe_end}.zip"
+
+    return StreamingResponse(
+        query_executor.stream(user, stream_zip(zip_members())),
+        media_type="application/zip",
+        headers={"Content-Disposition": f'attachment; filename="{sanitize_filename_part(filename)}"'},
     )
+
+
+def _resolve_export_nodes(node_ids: list[int]) -> list[dict[str, object]]:
+    resolved_nodes: list[dict[str, object]] = []
+    for node_id in node_ids:
+        node = get_node_by_id(node_id, timeout_seconds=300)
+        if node is None:
+            raise HTTPException(status_code=404, detail=f"Node {node_id} not found.")
+
+        serial = str(node.get("serial") or "").strip()
+        if not serial:
+            raise HTTPException(status_code=400, detail=f"Node {node_id} has no serial number.")
+
+        resolved_nodes.append(
+            {
+                "node_id": node_id,
+                "serial": serial,
+                "label": node.get("label") or f"Node {node_id}",
+            }
+        )
+    return resolved_nodes
+
+
+def _open_export_source(source_path: Path, export_name: str):
+    """
+    (file, size, mtime, export name) for one export member, or None when it
+    is gone. An hourly .bin archived since it was listed is exported as its
+    .bin.gz / .bin.zst instead.
+    """
+    candidates = [(source_path, export_name)]
+    if source_path.name.endswith(".bin"):
+        for suffix in (".gz", ".zst"):
+            candidates.append(
+                (source_path.with_name(source_path.name + suffix), export_name + suffix)
+            )
+
+    for path, name in candidates:
+        try:
+            source = open(path, "rb")
+        except FileNotFoundError:
+            continue
+        stat = os.fstat(source.fileno())
+        return source, stat.st_size, stat.st_mtime, name
+    print(f"[export] {source_path.name} disappeared before it was exported")
+    return None
@@ -1,19 +1,22 @@
 from __future__ import annotations
 
 import csv
+import io
 import os
 import re
-import shutil
 import tempfile
 import zipfile
 from datetime import date, datetime, time, timedelta, timezone
 from pathlib import Path
 from typing import Any, Iterable, Optional
 
+import storage_catalog
+
 DATA_DIR = Path("/mnt/ssd")
 FAULTS_DB = DATA_DIR / "fault" / "faults.db"
 # Processed sensor data files are stored in hourly buckets with filenames like:
-# data_{serial}_{YYYYMMDD}_{HH}.bin for the active/current hour or .bin.gz for previous hours.
+# data_{serial}_{YYYYMMDD}_{HH}.bin for the active/current hour or .bin.gz
+# (.bin.zst with SHM_ARCHIVE_CODEC=zstd) for previous hours.
 SENSOR_DATA_DIR = DATA_DIR / "data"
 # Raw MQTT capture files are stored separately from processed backend storage files.
 RAW_SENSOR_DATA_DIR = DATA_DIR / "raw"
@@ -250,11 +253,6 @@ def create_temp_export_path(prefix: str, suffix: str = ".csv") -> Path:
     return Path(path)
 
 
-def create_temp_export_dir(prefix: str) -> Path:
-    ensure_export_tmp_dir()
-    return Path(tempfile.mkdtemp(prefix=prefix, dir=str(EXPORT_TMP_DIR)))
-
-
 def remove_temp_file(path: Path) -> None:
     try:
         path.unlink(missing_ok=True)
@@ -262,22 +260,6 @@ def remove_temp_file(path: Path) -> None:
         pass
 
 
-def remove_temp_dir(path: Path) -> None:
-    if not path.exists():
-        return
-
-    for child in path.iterdir():
-        if child.is_file():
-            remove_temp_file(child)
-        elif child.is_dir():
-            remove_temp_dir(child)
-
-    try:
-        path.rmdir()
-    except OSError:
-        pass
-
-
 def write_fault_csv(
     export_path: Path,
     rows: Iterable[dict[str, Any]],
@@ -339,6 +321,23 @@ def parse_iso_to_epoch_seconds(value: str) -> float:
     return datetime.fromisoformat(value).timestamp()
 
 
+def parse_export_window(start: str, end: str) -> tuple[str, str]:
+    """Exact [start, end) export window from ISO datetimes (naive ones are
+    UTC), as UTC ISO strings."""
+    try:
+        start_dt = datetime.fromisoformat(start)
+        end_dt = datetime.fromisoformat(end)
+    except ValueError as exc:
+        raise ValueError("start and end must be ISO 8601 datetimes.") from exc
+    if start_dt.tzinfo is None:
+        start_dt = start_dt.replace(tzinfo=timezone.utc)
+    if end_dt.tzinfo is None:
+        end_dt = end_dt.replace(tzinfo=timezone.utc)
+    if end_dt <= start_dt:
+        raise ValueError("end must be later than start.")
+    return start_dt.astimezone(timezone.utc).isoformat(), end_dt.astimezone(timezone.utc).isoformat()
+
+
 def utc_now_iso() -> str:
     return datetime.now(timezone.utc).isoformat()
 
@@ -354,6 +353,21 @@ def iter_hour_starts(start_iso: str, end_exclusive_iso: str):
         current += timedelta(hours=1)
 
 
+def _catalog_files(kind: str, serial: str, start_hour: datetime, end_dt: datetime) -> Optional[list[Path]]:
+    # The storage catalog's files for the local hours [start_hour, end_dt),
+    # instead of one exists() per hour of the range; None until it is ready.
+    # A row whose file went away outside the writers is skipped.
+    end_hour = end_dt.replace(minute=0, second=0, microsecond=0)
+    if end_hour < end_dt:
+        end_hour += timedelta(hours=1)
+    files = storage_catalog.find_files(
+        kind, serial, start_hour.strftime("%Y%m%d_%H"), end_hour.strftime("%Y%m%d_%H"),
+    )
+    if files is None:
+        return None
+    return [path for path in files if path.exists()]
+
+
 def find_sensor_files_for_serial(
     serial: str,
     start_iso: str,
@@ -365,23 +379,29 @@ def find_sensor_files_for_serial(
     Prefer .bin for the active/current hour if both .bin and .bin.gz somehow
     exist at the same time.
     """
-    matched: list[Path] = []
-
     # Plot file lookup should follow the Pi's local time so it matches filename
     start_dt = datetime.fromisoformat(start_iso).astimezone()
     end_dt = datetime.fromisoformat(end_exclusive_iso).astimezone()
     current = start_dt.replace(minute=0, second=0, microsecond=0)
 
+    catalogued = _catalog_files("data", serial, current, end_dt)
+    if catalogued is not None:
+        return catalogued
+
+    matched: list[Path] = []
     while current < end_dt:
         hour_str = current.strftime("%Y%m%d_%H")
         base = f"data_{serial}_{hour_str}"
         bin_path = SENSOR_DATA_DIR / f"{base}.bin"
         gz_path = SENSOR_DATA_DIR / f"{base}.bin.gz"
+        zst_path = SENSOR_DATA_DIR / f"{base}.bin.zst"
 
         if bin_path.exists():
             matched.append(bin_path)
         elif gz_path.exists():
             matched.append(gz_path)
+        elif zst_path.exists():
+            matched.append(zst_path)
 
         current += timedelta(hours=1)
     return matched
@@ -393,13 +413,16 @@ def find_raw_sensor_files_for_serial(
     start_iso: str,
     end_exclusive_iso: str,
 ) -> list[Path]:
-    matched: list[Path] = []
-
     # Use the Pi's local time so hour buckets match the raw filenames.
     start_dt = datetime.fromisoformat(start_iso).astimezone()
     end_dt = datetime.fromisoformat(end_exclusive_iso).astimezone()
     current = start_dt.replace(minute=0, second=0, microsecond=0)
 
+    catalogued = _catalog_files("raw", serial, current, end_dt)
+    if catalogued is not None:
+        return catalogued
+
+    matched: list[Path] = []
     while current < end_dt:
         hour_str = current.strftime("%Y%m%d_%H")
         raw_path = RAW_SENSOR_DATA_DIR / serial / f"{serial}_{hour_str}.rawbin"
@@ -521,6 +544,8 @@ def build_export_member_name(
 ) -> str:
     if source_name.endswith(".bin.gz"):
         suffix = ".bin.gz"
+    elif source_name.endswith(".bin.zst"):
+        suffix = ".bin.zst"
     else:
         suffix = ".bin"
 
@@ -540,7 +565,7 @@ def build_raw_export_member_name(
 
 
 def extract_sensor_bucket_from_filename(source_name: str) -> tuple[str, str]:
-    match = re.match(r"^data_.+_(\d{8})_(\d{2})\.bin(?:\.gz)?$", source_name)
+    match = re.match(r"^data_.+_(\d{8})_(\d{2})\.bin(?:\.gz|\.zst)?$", source_name)
     if not match:
         raise ValueError(f"Unrecognized sensor export source filename: {source_name}")
 
@@ -561,41 +586,68 @@ def extract_raw_bucket_from_filename(source_name: str) -> tuple[str, str]:
     return bucket_day, hour_token
 
 
-def stage_files_for_zip(
-    export_dir: Path,
-    members: list[tuple[Path, str]],
-) -> list[Path]:
-    """
-    Copy matching storage files into the temporary export directory before zipping.
-    This keeps the ZIP response stable even if source files change during download.
-    """
-    staged_paths: list[Path] = []
+ZIP_STREAM_CHUNK_BYTES = 1024 * 1024
 
-    for source_path, destination_name in members:
-        destination = export_dir / destination_name
 
-        # Create ZIP subfolders before copying files.
-        destination.parent.mkdir(parents=True, exist_ok=True)
+class _ZipChunkSink(io.RawIOBase):
+    # Unseekable sink: zipfile then writes each member's sizes and CRC in a
+    # data descriptor after its data instead of seeking back to the header
+    def __init__(self):
+        self.chunks: list[bytes] = []
 
-        shutil.copy2(source_path, destination)
-        staged_paths.append(destination)
+    def writable(self) -> bool:
+        return True
 
-    return staged_paths
+    def write(self, b) -> int:
+        self.chunks.append(bytes(b))
+        return len(b)
 
+    def drain(self) -> bytes:
+        out = b"".join(self.chunks)
+        self.chunks = []
+        return out
 
-def create_zip_from_paths(
-    zip_path: Path,
-    members: list[Path],
-    *,
-    root_dir: Optional[Path] = None,
-) -> None:
-    with zipfile.ZipFile(zip_path, "w", compression=zipfile.ZIP_DEFLATED) as zf:
-        for member in members:
-            # Preserve staged subfolder paths inside the ZIP.
-            arcname = str(member.relative_to(root_dir)) if root_dir is not None else member.name
-            zf.write(member, arcname=arcname)
 
+def stream_zip(members: Iterable[tuple[str, Any, int, float]]) -> Iterable[bytes]:
+    """
+    Write a ZIP as it is read, for a StreamingResponse.
+
+    members yields (arcname, open binary file, size, mtime); exactly size
+    bytes are copied from each file, so a storage file still being appended
+    to is exported as it was when it was opened. Members are STORED (the
+    storage files are compressed already) and ZIP64 records are used for
+    members or archives past 4 GiB. Nothing is staged on disk.
 
-def write_text_file(path: Path, content: str) -> None:
-    path.write_text(content, encoding="utf-8")
-    
\ No newline at end of file
+    A member may instead be (arcname, iterable of bytes, None, mtime) for
+    content generated while it is written (decoded exports); its size is
+    unknown up front, so it always gets ZIP64 sizes.
+    """
+    sink = _ZipChunkSink()
+    with zipfile.ZipFile(sink, "w", compression=zipfile.ZIP_STORED, allowZip64=True) as zf:
+        for arcname, source, size, mtime in members:
+            info = zipfile.ZipInfo(arcname, date_time=time_tuple_for_zip(mtime))
+            info.compress_type = zipfile.ZIP_STORED
+            if size is None:
+                with zf.open(info, "w", force_zip64=True) as dst:
+                    for chunk in source:
+                        dst.write(chunk)
+                        yield sink.drain()
+                yield sink.drain()
+                continue
+            info.file_size = size
+            with source, zf.open(info, "w", force_zip64=size > zipfile.ZIP64_LIMIT) as dst:
+                remaining = size
+                while remaining > 0:
+                    chunk = source.read(min(ZIP_STREAM_CHUNK_BYTES, remaining))
+                    if not chunk:
+                        raise OSError(f"{arcname} shrank while it was exported")
+                    dst.write(chunk)
+                    remaining -= len(chunk)
+                    yield sink.drain()
+            yield sink.drain()
+    yield sink.drain()
+
+
+def time_tuple_for_zip(mtime: float) -> tuple:
+    # ZIP timestamps are local time, 1980 at the earliest
+    return max(datetime.fromtimestamp(mtime).timetuple()[:6], (1980, 1, 1, 0, 0, 0))
@@ -0,0 +1,83 @@
+import asyncio
+import json
+from threading import Lock
+
+# Broadcast channel for newly logged fault rows (/api/events/faults).
+#
+# Each fault SSE client used to poll read_fault_rows_since_id() every 5 s,
+# so DB load grew with every open dashboard and a fault took up to 5 s to
+# show. Faults are logged by the data listener process
+# (fault_logger.log_fault_events()), which now publishes the inserted rows,
+# ids included, on the local broker under FAULT_BUS_TOPIC. The backend's
+# MQTT client hands them to publish() here, and every SSE client gets them
+# from its own queue: no DB read per viewer.
+#
+# The DB is only read for a client's initial snapshot, for the catch-up
+# when it reconnects with last_id, and when its queue overflowed or the
+# backend's MQTT client is down (see main.fault_events()).
+FAULT_BUS_TOPIC = "shm/faults/new"
+FAULT_BUS_QUEUE_BATCHES = 256
+
+
+class FaultSubscriber:
+    """One SSE client's queue of fault row batches."""
+
+    def __init__(self, loop: asyncio.AbstractEventLoop):
+        self.loop = loop
+        self.queue: asyncio.Queue = asyncio.Queue(maxsize=FAULT_BUS_QUEUE_BATCHES)
+        # Set when a batch had to be dropped; the client then catches up
+        # from the DB instead of trusting the queue
+        self.overflowed = False
+
+    def _put(self, rows: list) -> None:
+        if self.queue.full():
+            self.overflowed = True
+            return
+        self.queue.put_nowait(rows)
+
+
+_SUBSCRIBERS: set = set()
+_SUBSCRIBERS_LOCK = Lock()
+
+# In-process consumers of every batch (fleet_status), called on the MQTT
+# client thread
+_LISTENERS: list = []
+
+
+def add_listener(listener) -> None:
+    _LISTENERS.append(listener)
+
+
+def subscribe() -> FaultSubscriber:
+    sub = FaultSubscriber(asyncio.get_running_loop())
+    with _SUBSCRIBERS_LOCK:
+        _SUBSCRIBERS.add(sub)
+    return sub
+
+
+def unsubscribe(sub: FaultSubscriber) -> None:
+    with _SUBSCRIBERS_LOCK:
+        _SUBSCRIBERS.discard(sub)
+
+
+def publish(payload: bytes) -> None:
+    """Broadcast one published batch of fault rows. MQTT client thread."""
+    try:
+        rows = json.loads(payload)
+    except ValueError as e:
+        print(f"[fault_bus] Bad fault batch: {e}")
+        return
+    if not isinstance(rows, list) or not rows:
+        return
+    for listener in _LISTENERS:
+        try:
+            listener(rows)
+        except Exception as e:
+            print(f"[fault_bus] Fault listener failed: {e}")
+    with _SUBSCRIBERS_LOCK:
+        subs = list(_SUBSCRIBERS)
+    for sub in subs:
+        try:
+            sub.loop.call_soon_threadsafe(sub._put, rows)
+        except RuntimeError:
+            pass
@@ -262,6 +262,70 @@ FAULT_CODE_MAP: dict[int, FaultDefinition] = {
         False,
         None,
     ),
+
+    # Store-and-forward (offline packet log) faults.
+    24: FaultDefinition(
+        "Store-and-forward flash error",
+        "node",
+        "store_forward_error",
+        2,
+        "active",
+        "node",
+        False,
+        None,
+    ),
+    25: FaultDefinition(
+        "Store-and-forward log full, oldest packets overwritten",
+        "node",
+        "store_forward_full",
+        2,
+        "active",
+        "node",
+        False,
+        None,
+    ),
+
+    # Adaptive publish level (firmware flow_control.h). One state, four levels.
+    26: FaultDefinition(
+        "Publish level restored to full rate",
+        "mqtt",
+        "publish_flow",
+        1,
+        "resolved",
+        "node",
+        True,
+        "publish_flow",
+    ),
+    27: FaultDefinition(
+        "Publish level reduced to coarse batching (link congested)",
+        "mqtt",
+        "publish_flow",
+        2,
+        "active",
+        "node",
+        True,
+        "publish_flow",
+    ),
+    28: FaultDefinition(
+        "Publish level reduced to summary only, raw data logged on node",
+        "mqtt",
+        "publish_flow",
+        2,
+        "active",
+        "node",
+        True,
+        "publish_flow",
+    ),
+    29: FaultDefinition(
+        "Publish level reduced to store-and-forward, no live data",
+        "mqtt",
+        "publish_flow",
+        3,
+        "active",
+        "node",
+        True,
+        "publish_flow",
+    ),
     
     # Backend data-management faults.
     100: FaultDefinition(
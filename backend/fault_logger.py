@@ -1,5 +1,8 @@
 import os
+import queue
 import sqlite3
+import threading
+import time
 from pathlib import Path
 from typing import Iterable, Any
 
@@ -12,12 +15,24 @@ SSD_ROOT = Path("/mnt/ssd")
 STATEFUL_FAULT_TYPES = {
     "ethernet_link",
     "mqtt_connection",
+    "publish_flow",
     "power_loss",
     "backend_storage_availability",
     "backend_storage_low_space",
 }
 
 
+# Called with the inserted rows (ids included) after each commit; the data
+# listener installs one that publishes them to the backend's fault SSE
+# clients (fault_bus.py).
+_row_sink = None
+
+
+def set_fault_row_sink(sink) -> None:
+    global _row_sink
+    _row_sink = sink
+
+
 def _ensure_fault_table(conn: sqlite3.Connection) -> None:
     # Create the faults table when the DB is empty.
     conn.execute(
@@ -86,9 +101,27 @@ def _backfill_stateful_metadata(conn: sqlite3.Connection) -> None:
     )
 
 
+def _ensure_fault_indexes(conn: sqlite3.Connection) -> None:
+    # Match the dashboard / export filters (export_utils.build_fault_export_where,
+    # main.read_fault_rows): time range and recency order, the per-node
+    # active state lookup, and the case-insensitive equality filters.
+    conn.execute("CREATE INDEX IF NOT EXISTS idx_faults_ts_id ON faults (ts, id)")
+    conn.execute(
+        "CREATE INDEX IF NOT EXISTS idx_faults_serial_state ON faults (serial_number, state_key, ts)"
+    )
+    conn.execute("CREATE INDEX IF NOT EXISTS idx_faults_sensor_type ON faults (LOWER(sensor_type))")
+    conn.execute("CREATE INDEX IF NOT EXISTS idx_faults_fault_type ON faults (LOWER(fault_type))")
+    conn.execute("CREATE INDEX IF NOT EXISTS idx_faults_status ON faults (LOWER(fault_status))")
+    conn.execute("CREATE INDEX IF NOT EXISTS idx_faults_severity ON faults (severity)")
+
+
+def _ssd_mounted() -> bool:
+    return SSD_ROOT.exists() and os.path.ismount(SSD_ROOT)
+
+
 def ensure_fault_db_schema() -> None:
     # Keep the DB schema compatible with current fault-state logic.
-    if not SSD_ROOT.exists() or not os.path.ismount(SSD_ROOT):
+    if not _ssd_mounted():
         return
 
     FAULT_DB_PATH.parent.mkdir(parents=True, exist_ok=True)
@@ -96,9 +129,12 @@ def ensure_fault_db_schema() -> None:
     conn = None
     try:
         conn = sqlite3.connect(FAULT_DB_PATH)
+        # WAL: the dashboard reads while the data listener writes
+        conn.execute("PRAGMA journal_mode=WAL")
         _ensure_fault_table(conn)
         _ensure_fault_columns(conn)
         _backfill_stateful_metadata(conn)
+        _ensure_fault_indexes(conn)
         conn.commit()
     except Exception as e:
         print(f"[fault_logger] Failed to ensure fault DB schema: {e}")
@@ -107,6 +143,163 @@ def ensure_fault_db_schema() -> None:
             conn.close()
 
 
+# Fault store writer.
+#
+# log_fault_events() used to open the DB, check the schema and commit once
+# per call, and the storage path can call it for every packet while the SSD
+# misbehaves. Calls now only queue their rows; one writer thread holds a
+# long-lived WAL connection (synchronous=NORMAL) and group-commits whatever
+# queued within FAULT_COMMIT_INTERVAL_S in one transaction. WAL keeps the
+# dashboard's reads concurrent with it. The row sink (fault_bus) is called
+# once per committed batch.
+#
+# The queue holds at most FAULT_QUEUE_MAX rows; a storm beyond that drops
+# rows (counted and reported by the writer) rather than stall ingest.
+FAULT_COMMIT_INTERVAL_S = 0.25
+FAULT_QUEUE_MAX = 10000
+FAULT_BUSY_TIMEOUT_S = 5.0
+
+_INSERT_SQL = """
+    INSERT INTO faults (
+        serial_number,
+        fault_code,
+        sensor_type,
+        fault_type,
+        state_key,
+        is_stateful,
+        severity,
+        fault_status,
+        description,
+        ts
+    )
+    VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+"""
+
+_ROW_KEYS = (
+    "serial_number",
+    "fault_code",
+    "sensor_type",
+    "fault_type",
+    "state_key",
+    "is_stateful",
+    "severity",
+    "fault_status",
+    "description",
+    "ts",
+)
+
+
+class _FaultWriter:
+    def __init__(self):
+        self.queue: queue.Queue = queue.Queue(maxsize=FAULT_QUEUE_MAX)
+        self.conn = None
+        self.dropped = 0
+        self.thread = None
+        self.stop_seen = False
+        self.lock = threading.Lock()
+
+    def start(self) -> None:
+        with self.lock:
+            if self.thread is None:
+                self.thread = threading.Thread(target=self._run, name="fault-writer", daemon=True)
+                self.thread.start()
+
+    def put(self, row: tuple) -> None:
+        try:
+            self.queue.put_nowait(row)
+        except queue.Full:
+            self.dropped += 1
+
+    def _connect(self) -> sqlite3.Connection:
+        if self.conn is None:
+            FAULT_DB_PATH.parent.mkdir(parents=True, exist_ok=True)
+            conn = sqlite3.connect(FAULT_DB_PATH, timeout=FAULT_BUSY_TIMEOUT_S, check_same_thread=False)
+            conn.execute("PRAGMA journal_mode=WAL")
+            conn.execute("PRAGMA synchronous=NORMAL")
+            _ensure_fault_table(conn)
+            _ensure_fault_columns(conn)
+            _ensure_fault_indexes(conn)
+            conn.commit()
+            self.conn = conn
+        return self.conn
+
+    def close(self) -> None:
+        if self.conn is not None:
+            try:
+                self.conn.close()
+            except sqlite3.Error:
+                pass
+            self.conn = None
+
+    def _take_batch(self, first) -> list:
+        # Everything that queues within the commit interval joins the batch
+        batch = [first]
+        deadline = time.monotonic() + FAULT_COMMIT_INTERVAL_S
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                break
+            try:
+                item = self.queue.get(timeout=remaining)
+            except queue.Empty:
+                break
+            if item is None:
+                self.stop_seen = True
+                break
+            batch.append(item)
+        return batch
+
+    def _write(self, batch: list) -> list:
+        if not _ssd_mounted():
+            print(f"[fault_logger] SSD not mounted. Skipping {len(batch)} fault row(s).")
+            self.close()
+            return []
+        inserted = []
+        try:
+            conn = self._connect()
+            with conn:
+                for row in batch:
+                    cur = conn.execute(_INSERT_SQL, row)
+                    inserted.append({"id": cur.lastrowid, **dict(zip(_ROW_KEYS, row))})
+        except Exception as e:
+            # Reopen on the next batch (e.g. the SSD was remounted)
+            print(f"[fault_logger] Failed to write fault log: {e}")
+            self.close()
+            return []
+        return inserted
+
+    def _run(self) -> None:
+        self.stop_seen = False
+        while not self.stop_seen:
+            first = self.queue.get()
+            if first is None:
+                break
+            inserted = self._write(self._take_batch(first))
+
+            if self.dropped:
+                print(f"[fault_logger] Fault queue full, dropped {self.dropped} row(s)")
+                self.dropped = 0
+
+            if inserted and _row_sink is not None:
+                try:
+                    _row_sink(inserted)
+                except Exception as e:
+                    print(f"[fault_logger] Failed to publish fault rows: {e}")
+        self.close()
+
+    def stop(self, timeout: float = 5.0) -> None:
+        with self.lock:
+            thread = self.thread
+            self.thread = None
+        if thread is None:
+            return
+        self.queue.put(None)
+        thread.join(timeout)
+
+
+_writer = _FaultWriter()
+
+
 def log_fault_events(
     serial_number: str,
     fault_events: Iterable[tuple[int, Any]],
@@ -117,54 +310,30 @@ def log_fault_events(
         return
 
     # Skip fault logging if the SSD is not mounted.
-    if not SSD_ROOT.exists() or not os.path.ismount(SSD_ROOT):
+    if not _ssd_mounted():
         print("[fault_logger] SSD not mounted. Skipping fault log.")
         return
 
-    FAULT_DB_PATH.parent.mkdir(parents=True, exist_ok=True)
-
-    conn = None
-    try:
-        conn = sqlite3.connect(FAULT_DB_PATH)
-        _ensure_fault_table(conn)
-        _ensure_fault_columns(conn)
-
-        for code, ts in unique_events:
-            f = get_fault_definition(code)
-
-            conn.execute(
-                """
-                INSERT INTO faults (
-                    serial_number,
-                    fault_code,
-                    sensor_type,
-                    fault_type,
-                    state_key,
-                    is_stateful,
-                    severity,
-                    fault_status,
-                    description,
-                    ts
-                )
-                VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
-                """,
-                (
-                    serial_number,
-                    code,
-                    f.sensor_type,
-                    f.fault_type,
-                    f.state_key,
-                    int(f.is_stateful),
-                    f.severity,
-                    f.fault_status,
-                    f.description,
-                    ts,
-                ),
+    # Queued for the writer thread, committed within FAULT_COMMIT_INTERVAL_S
+    _writer.start()
+    for code, ts in unique_events:
+        f = get_fault_definition(code)
+        _writer.put(
+            (
+                serial_number,
+                code,
+                f.sensor_type,
+                f.fault_type,
+                f.state_key,
+                int(f.is_stateful),
+                f.severity,
+                f.fault_status,
+                f.description,
+                ts,
             )
+        )
 
-        conn.commit()
-    except Exception as e:
-        print(f"[fault_logger] Failed to write fault log: {e}")
-    finally:
-        if conn is not None:
-            conn.close()
\ No newline at end of file
+
+def close_fault_store() -> None:
+    """Commit the queued fault rows and close the writer's connection."""
+    _writer.stop()
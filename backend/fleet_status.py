@@ -0,0 +1,235 @@
+import json
+import time
+from collections import deque
+from datetime import datetime, timezone
+from threading import Lock
+from typing import Any, Optional
+
+# In-memory fleet sensor health for /api/fleet/status.
+#
+# The dashboard used to ask /api/nodes/{id}/sensor-status per node, and each
+# request re-read the node registry and ran the active-fault query. The
+# backend now keeps the inputs here and updates them as they arrive:
+#   - sensor runtime: the data listener's live frames carry one NaN flag per
+#     sensor of the packet ("h", see live_stream.build_frame()); note_frame()
+#     stamps the sensor's last packet / valid / NaN time.
+#   - active faults: the newest stateful row per (node, sensor, state key),
+#     seeded from the DB by seed_faults() and then kept current from the
+#     fault_bus rows by note_fault_rows().
+# main.refresh_fleet_status() derives every node's health from these at most
+# once per FLEET_STATUS_REFRESH_S and publish()es it. Each node entry keeps
+# the snapshot version it last changed at, so a client that sends the
+# version it has gets only the nodes changed since, and nothing at all (304)
+# while the fleet is unchanged.
+SENSOR_KEYS = ("accelerometer", "inclinometer", "temperature")
+LEGACY_STATEFUL_FAULT_TYPES = ("ethernet_link", "mqtt_connection", "power_loss")
+RECENT_FAULT_ROWS = 1000
+
+# Versions restart with the process; the epoch tells a client's old tag apart
+_EPOCH = format(int(time.time()), "x")
+
+
+def _iso(ts: float) -> str:
+    return datetime.fromtimestamp(ts, tz=timezone.utc).isoformat()
+
+
+def _epoch(ts: Any) -> Optional[float]:
+    if not ts:
+        return None
+    try:
+        return datetime.fromisoformat(str(ts).replace("Z", "+00:00")).timestamp()
+    except ValueError:
+        return None
+
+
+# Sensor runtime (live frames)
+_RUNTIME: dict = {}     # serial -> sensor -> {runtime key: epoch seconds}
+_RUNTIME_LOCK = Lock()
+
+
+def note_frame(serial: str, payload: bytes) -> None:
+    """Stamp the sensors of one live frame. MQTT client thread."""
+    try:
+        health = json.loads(payload).get("h")
+    except (ValueError, AttributeError):
+        return
+    if not isinstance(health, dict):
+        # Frame from a data listener that does not send the flags yet
+        return
+
+    now = time.time()
+    with _RUNTIME_LOCK:
+        runtime = _RUNTIME.setdefault(serial, {})
+        for sensor, has_nan in health.items():
+            if sensor not in SENSOR_KEYS:
+                continue
+            stamps = runtime.setdefault(sensor, {})
+            stamps["last_packet_ts"] = now
+            stamps["last_nan_ts" if has_nan else "last_valid_data_ts"] = now
+
+
+def merged_runtime(serial: str, registry_runtime: dict) -> dict:
+    """The registry's runtime of one node (flushed by the data listener every
+    few seconds) with the fresher live frame timestamps, as ISO strings."""
+    with _RUNTIME_LOCK:
+        live = {sensor: dict(stamps) for sensor, stamps in _RUNTIME.get(serial, {}).items()}
+
+    merged = {}
+    for sensor in SENSOR_KEYS:
+        base = registry_runtime.get(sensor)
+        out = dict(base) if isinstance(base, dict) else {}
+        for key, ts in live.get(sensor, {}).items():
+            current = _epoch(out.get(key))
+            if current is None or ts > current:
+                out[key] = _iso(ts)
+        merged[sensor] = out
+    return merged
+
+
+# Active faults (fault_bus)
+_FAULTS: dict = {}      # serial -> (sensor, state key) -> newest row
+_FAULTS_SEED_ID = 0     # rows up to this id are in the seed
+_RECENT_ROWS: deque = deque(maxlen=RECENT_FAULT_ROWS)
+_FAULTS_LOCK = Lock()
+
+
+def _apply_fault_row(row: dict) -> None:
+    sensor = str(row.get("sensor_type") or "").lower().strip()
+    if sensor not in SENSOR_KEYS:
+        return
+    fault_type = row.get("fault_type")
+    is_stateful = row.get("is_stateful")
+    if is_stateful is None:
+        is_stateful = fault_type in LEGACY_STATEFUL_FAULT_TYPES
+    if not is_stateful:
+        return
+
+    state_key = row.get("state_key") or fault_type
+    item = {
+        "id": row.get("id"),
+        "serial_number": row.get("serial_number"),
+        "sensor_type": row.get("sensor_type"),
+        "fault_type": fault_type,
+        "state_key": state_key,
+        "is_stateful": 1,
+        "severity": row.get("severity"),
+        "fault_status": row.get("fault_status"),
+        "description": row.get("description"),
+        "ts": row.get("ts"),
+    }
+    faults = _FAULTS.setdefault(str(row.get("serial_number") or ""), {})
+    key = (sensor, state_key)
+    current = faults.get(key)
+    if current is None or (str(item["ts"]), int(item["id"] or 0)) >= (
+        str(current["ts"]),
+        int(current["id"] or 0),
+    ):
+        faults[key] = item
+
+
+def seed_faults(rows: list, max_id: int) -> None:
+    """Replace the fault state with the DB's active rows, read in one
+    transaction with max_id, the largest fault id at that point."""
+    global _FAULTS_SEED_ID
+
+    with _FAULTS_LOCK:
+        _FAULTS.clear()
+        _FAULTS_SEED_ID = max_id
+        for row in rows:
+            _apply_fault_row(row)
+        # Rows the bus delivered while the DB was being read
+        for row in _RECENT_ROWS:
+            if int(row.get("id") or 0) > max_id:
+                _apply_fault_row(row)
+
+
+def note_fault_rows(rows: list) -> None:
+    """Apply one fault_bus batch. MQTT client thread."""
+    with _FAULTS_LOCK:
+        for row in rows:
+            if not isinstance(row, dict):
+                continue
+            _RECENT_ROWS.append(row)
+            if int(row.get("id") or 0) > _FAULTS_SEED_ID:
+                _apply_fault_row(row)
+
+
+def active_faults(serial: str) -> dict:
+    """Active faults of one node per sensor, newest first."""
+    grouped: dict = {sensor: [] for sensor in SENSOR_KEYS}
+    with _FAULTS_LOCK:
+        rows = list(_FAULTS.get(serial, {}).items())
+    for (sensor, _), row in rows:
+        if str(row.get("fault_status") or "").lower() == "active":
+            grouped[sensor].append(dict(row))
+    for items in grouped.values():
+        items.sort(key=lambda row: (str(row["ts"]), int(row["id"] or 0)), reverse=True)
+    return grouped
+
+
+# Published snapshot
+_NODES: dict = {}       # node_id -> (version, entry)
+_VERSION = 0
+_REMOVED_VERSION = 0    # last version at which a node left the fleet
+_SNAPSHOT_LOCK = Lock()
+
+
+def publish(entries: list) -> None:
+    """Install the fleet's current node entries; only changed ones get a new
+    version."""
+    global _VERSION, _REMOVED_VERSION
+
+    with _SNAPSHOT_LOCK:
+        version = _VERSION + 1
+        changed = False
+        seen = set()
+        for entry in entries:
+            node_id = entry["node_id"]
+            seen.add(node_id)
+            current = _NODES.get(node_id)
+            if current is None or current[1] != entry:
+                _NODES[node_id] = (version, entry)
+                changed = True
+        for node_id in [node_id for node_id in _NODES if node_id not in seen]:
+            del _NODES[node_id]
+            _REMOVED_VERSION = version
+            changed = True
+        if changed:
+            _VERSION = version
+
+
+def tag() -> str:
+    with _SNAPSHOT_LOCK:
+        return f"{_EPOCH}-{_VERSION}"
+
+
+def node(node_id: int) -> Optional[dict]:
+    with _SNAPSHOT_LOCK:
+        current = _NODES.get(node_id)
+    return current[1] if current else None
+
+
+def read(since: Optional[str]) -> dict:
+    """The snapshot as the client's delta: only the nodes changed since the
+    tag it has (since), or every node when that tag is from another process
+    or predates a node's removal."""
+    with _SNAPSHOT_LOCK:
+        since_version = None
+        if since:
+            epoch, _, version = since.partition("-")
+            if epoch == _EPOCH and version.isdigit() and int(version) >= _REMOVED_VERSION:
+                since_version = int(version)
+
+        nodes = sorted(
+            (
+                entry
+                for version, entry in _NODES.values()
+                if since_version is None or version > since_version
+            ),
+            key=lambda entry: entry["node_id"],
+        )
+        return {
+            "tag": f"{_EPOCH}-{_VERSION}",
+            "full": since_version is None,
+            "nodes": nodes,
+        }
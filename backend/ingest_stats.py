@@ -0,0 +1,444 @@
+import json
+import math
+import time
+from datetime import datetime, timezone
+from pathlib import Path
+from threading import Lock
+
+from listener_snapshots import latest_updated_at, read_all, writer_path
+
+# Per-node ingest accounting, from the node's packet sequence to the record
+# on disk (firmware mqtt.h: every data packet carries "seq" and, once the
+# node clock is synced, its send time "st" in UTC microseconds).
+#
+# The data listener records every stage here; the snapshot is flushed to
+# INGEST_STATS_JSON, which the backend serves at /api/ingest/stats.
+#
+# Where a missing second went:
+#   lost          seq never arrived: dropped on the node (its metrics count
+#                 which), by the broker or on the link
+#   decode_errors arrived but could not be decoded
+#   rejected      decoded but dropped for invalid timestamps
+#   queue_drops   the storage queue was over its budget and the packet was
+#                 evicted or refused
+#   queue_spills  same, but with the spill_raw policy, or the listener's
+#                 ingest queue was over its budget: the packet is only in
+#                 the raw backup, from which it can be replayed
+#   store_failed  the write to the SSD failed
+#
+# "storage_shards" lists the encoder's per-node storage queues (see
+# encoder_storage.py): nodes, current depth and high-water mark since the
+# previous report, so a node whose shard falls behind is visible.
+# "storage_queue" is their shared memory budget: policy, use, peak and
+# overflow counts.
+# "raw_backup" lists the raw backup writers (dataStorage/raw_backup.py):
+# queue depth, packets written and dropped over budget, receive-to-buffer
+# latency and the slowest fsync since the previous report.
+# "ingest_pipeline" is the listener's message handling (see
+# dataStorage/ingest_pipeline.py): per worker its nodes, queue depth,
+# overflows, queue wait and handling time by topic kind, and sub-stage
+# timings such as decoding.
+#
+# With a partitioned listener every process writes its own file (see
+# listener_snapshots.py); load_ingest_stats() merges them into one snapshot.
+INGEST_STATS_JSON = Path("/home/pi/ingest_stats.json")
+_WRITE_PATH = writer_path(INGEST_STATS_JSON)
+_FLUSH_INTERVAL = 10.0  # seconds
+
+# Histogram bucket upper bounds in ms; the last bucket counts everything above.
+LATENCY_BUCKETS_MS = (5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 30000, 60000)
+
+# Sample-to-disk target: a second of data counts toward the SLO when its last
+# sample is on disk within this long.
+INGEST_SLO_MS = 5000
+
+# Missing seqs are remembered this far back so a late (or replayed) packet
+# fills its gap instead of counting twice; older gaps are final.
+MISSING_WINDOW = 3600
+# seq this far behind the newest one (or 0 again) means the node rebooted.
+RESTART_BACKSTEP = 600
+
+
+def _now_iso() -> str:
+    return datetime.now(timezone.utc).isoformat()
+
+
+class _Histogram:
+    """Log-spaced latency buckets with count, mean and max."""
+
+    def __init__(self):
+        self.counts = [0] * (len(LATENCY_BUCKETS_MS) + 1)
+        self.n = 0
+        self.total_ms = 0.0
+        self.max_ms = 0.0
+        self.negative = 0          # clock skew between node and Pi
+
+    def add(self, ms: float) -> None:
+        if not math.isfinite(ms):
+            return
+        if ms < 0:
+            self.negative += 1
+            ms = 0.0
+        idx = len(LATENCY_BUCKETS_MS)
+        for i, bound in enumerate(LATENCY_BUCKETS_MS):
+            if ms <= bound:
+                idx = i
+                break
+        self.counts[idx] += 1
+        self.n += 1
+        self.total_ms += ms
+        self.max_ms = max(self.max_ms, ms)
+
+    def percentile(self, q: float):
+        # Upper bound of the bucket holding the q-quantile (None = above the last)
+        if self.n == 0:
+            return None
+        rank = q * self.n
+        seen = 0
+        for i, c in enumerate(self.counts):
+            seen += c
+            if seen >= rank:
+                return LATENCY_BUCKETS_MS[i] if i < len(LATENCY_BUCKETS_MS) else None
+        return None
+
+    def snapshot(self) -> dict:
+        return {
+            "n": self.n,
+            "avg_ms": round(self.total_ms / self.n, 1) if self.n else None,
+            "max_ms": round(self.max_ms, 1),
+            "p50_ms": self.percentile(0.50),
+            "p95_ms": self.percentile(0.95),
+            "p99_ms": self.percentile(0.99),
+            "negative": self.negative,
+            "buckets_ms": list(LATENCY_BUCKETS_MS),
+            "counts": list(self.counts),
+        }
+
+
+class _SeqTracker:
+    """Loss / duplicate / reorder accounting over one node's packet sequence."""
+
+    def __init__(self):
+        self.first = None
+        self.high = None
+        self.unique = 0
+        self.duplicates = 0
+        self.late = 0              # filled a gap after newer packets arrived
+        self.recovered = 0         # gap filled by a store-and-forward replay
+        self.stale_replays = 0     # replayed from before the last reboot
+        self.missing: set[int] = set()
+        self.lost_final = 0
+        self.restarts = 0
+        self.lost_before_restarts = 0
+
+    def lost(self) -> int:
+        return len(self.missing) + self.lost_final
+
+    def _restart(self) -> None:
+        self.lost_before_restarts += self.lost()
+        self.missing.clear()
+        self.lost_final = 0
+        self.first = self.high = None
+        self.restarts += 1
+
+    def note(self, seq: int, replayed: bool) -> None:
+        if self.high is not None and not replayed and (
+                seq == 0 or seq + RESTART_BACKSTEP < self.high):
+            self._restart()
+
+        if self.high is None:
+            self.first = self.high = seq
+            self.unique += 1
+            return
+
+        if seq > self.high:
+            gap = seq - self.high - 1
+            if gap > MISSING_WINDOW:
+                self.lost_final += gap
+            else:
+                self.missing.update(range(self.high + 1, seq))
+            self.high = seq
+            self.unique += 1
+            self._expire()
+        elif seq in self.missing:
+            self.missing.discard(seq)
+            self.unique += 1
+            if replayed:
+                self.recovered += 1
+            else:
+                self.late += 1
+        elif replayed and seq < self.first:
+            self.stale_replays += 1
+        else:
+            self.duplicates += 1
+
+    def _expire(self) -> None:
+        floor = self.high - MISSING_WINDOW
+        old = [s for s in self.missing if s < floor]
+        for s in old:
+            self.missing.discard(s)
+        self.lost_final += len(old)
+
+    def snapshot(self) -> dict:
+        return {
+            "first": self.first,
+            "high": self.high,
+            "received": self.unique,
+            "lost": self.lost(),
+            "lost_before_restarts": self.lost_before_restarts,
+            "duplicates": self.duplicates,
+            "late": self.late,
+            "recovered": self.recovered,
+            "stale_replays": self.stale_replays,
+            "restarts": self.restarts,
+        }
+
+
+class _NodeIngest:
+    def __init__(self):
+        self.seq = _SeqTracker()
+        self.packets = 0
+        self.unsequenced = 0       # older firmware without "seq"
+        self.replayed = 0
+        self.decode_errors = 0
+        self.rejected = 0
+        self.queue_drops = 0
+        self.queue_spills = 0
+        self.stored = 0
+        self.store_failed = 0
+        self.slo_met = 0
+        self.last_rx = None
+        # Stage latencies, live packets only (replays are late by design)
+        self.hist = {
+            "sample_to_send": _Histogram(),   # node: last sample -> serialize
+            "send_to_rx": _Histogram(),       # network + broker -> listener
+            "rx_to_disk": _Histogram(),       # listener queue + SSD write
+            "sample_to_disk": _Histogram(),   # the whole path
+        }
+
+    def snapshot(self) -> dict:
+        seq = self.seq.snapshot()
+        expected = seq["received"] + seq["lost"] + seq["lost_before_restarts"]
+        return {
+            "last_rx": self.last_rx,
+            "packets": self.packets,
+            "unsequenced": self.unsequenced,
+            "replayed": self.replayed,
+            "seq": seq,
+            "decode_errors": self.decode_errors,
+            "rejected": self.rejected,
+            "queue_drops": self.queue_drops,
+            "queue_spills": self.queue_spills,
+            "stored": self.stored,
+            "store_failed": self.store_failed,
+            "slo": {
+                "target_ms": INGEST_SLO_MS,
+                "met": self.slo_met,
+                "expected": expected,
+                "ratio": round(self.slo_met / expected, 5) if expected else None,
+            },
+            "latency": {name: h.snapshot() for name, h in self.hist.items()},
+        }
+
+
+_NODES: dict[str, _NodeIngest] = {}
+_SHARDS: list = []
+_QUEUE: dict = {}
+_RAW_BACKUP: list = []
+_PIPELINE: dict = {}
+_LOCK = Lock()
+_LAST_FLUSH_TIME = 0.0
+
+
+def _node(serial: str) -> _NodeIngest:
+    node = _NODES.get(serial)
+    if node is None:
+        node = _NODES[serial] = _NodeIngest()
+    return node
+
+
+def _last_sample_s(data: dict):
+    # Newest accel sample time, after normalise_sensor_timestamps()
+    accel = data.get("a")
+    if isinstance(accel, list) and accel and isinstance(accel[-1], list):
+        ts = accel[-1][0]
+        if isinstance(ts, (int, float)):
+            return float(ts)
+    return None
+
+
+def note_received(serial: str, data: dict, rx_s: float) -> None:
+    """One decoded data packet arrived (before timestamp normalisation)."""
+    data["_rx_s"] = rx_s
+    replayed = bool(data.get("replayed"))
+    with _LOCK:
+        node = _node(serial)
+        node.packets += 1
+        node.last_rx = _now_iso()
+        if replayed:
+            node.replayed += 1
+
+        seq = data.get("seq")
+        if isinstance(seq, int):
+            node.seq.note(seq, replayed)
+        else:
+            node.unsequenced += 1
+
+        send_us = data.get("st")
+        if isinstance(send_us, int) and send_us > 0 and not replayed:
+            node.hist["send_to_rx"].add(rx_s * 1000.0 - send_us / 1000.0)
+    _flush_to_disk()
+
+
+def note_decode_error(serial: str) -> None:
+    with _LOCK:
+        _node(serial).decode_errors += 1
+
+
+def note_rejected(serial: str) -> None:
+    with _LOCK:
+        _node(serial).rejected += 1
+
+
+def note_queue_drop(serial: str) -> None:
+    with _LOCK:
+        _node(serial).queue_drops += 1
+
+
+def note_queue_spill(serial: str) -> None:
+    with _LOCK:
+        _node(serial).queue_spills += 1
+
+
+def note_stored(serial: str, data: dict, ok: bool) -> None:
+    """The storage worker finished with a packet queued by the listener."""
+    now_s = time.time()
+    with _LOCK:
+        node = _node(serial)
+        if not ok:
+            node.store_failed += 1
+            return
+        node.stored += 1
+        if data.get("replayed"):
+            return
+
+        rx_s = data.get("_rx_s")
+        sample_s = _last_sample_s(data)
+        send_us = data.get("st")
+        if isinstance(rx_s, float):
+            node.hist["rx_to_disk"].add((now_s - rx_s) * 1000.0)
+        if sample_s is not None:
+            age_ms = (now_s - sample_s) * 1000.0
+            node.hist["sample_to_disk"].add(age_ms)
+            if age_ms <= INGEST_SLO_MS:
+                node.slo_met += 1
+            if isinstance(send_us, int) and send_us > 0:
+                node.hist["sample_to_send"].add(send_us / 1000.0 - sample_s * 1000.0)
+
+
+def note_storage_shards(shards: list, queue_state: dict) -> None:
+    """Latest per-shard and whole-budget storage queue report from the encoder."""
+    global _SHARDS, _QUEUE
+    with _LOCK:
+        _SHARDS = shards
+        _QUEUE = queue_state
+
+
+def note_raw_backup(writers: list) -> None:
+    """Latest per-writer report from the raw backup."""
+    global _RAW_BACKUP
+    with _LOCK:
+        _RAW_BACKUP = writers
+
+
+def note_ingest_pipeline(pipeline: dict) -> None:
+    """Latest report of the listener's ingest workers."""
+    global _PIPELINE
+    with _LOCK:
+        _PIPELINE = pipeline
+
+
+def snapshot() -> dict:
+    with _LOCK:
+        return {
+            "updated_at": _now_iso(),
+            "nodes": {serial: node.snapshot() for serial, node in _NODES.items()},
+            "storage_shards": list(_SHARDS),
+            "storage_queue": dict(_QUEUE),
+            "raw_backup": list(_RAW_BACKUP),
+            "ingest_pipeline": dict(_PIPELINE),
+        }
+
+
+# Write the snapshot for the backend at most every _FLUSH_INTERVAL.
+def _flush_to_disk() -> None:
+    global _LAST_FLUSH_TIME
+
+    now = time.time()
+    if now - _LAST_FLUSH_TIME < _FLUSH_INTERVAL:
+        return
+    _LAST_FLUSH_TIME = now
+
+    try:
+        _WRITE_PATH.parent.mkdir(parents=True, exist_ok=True)
+        tmp_path = _WRITE_PATH.with_suffix(".tmp")
+        tmp_path.write_text(json.dumps(snapshot(), separators=(",", ":")), encoding="utf-8")
+        tmp_path.replace(_WRITE_PATH)
+    except OSError as e:
+        print(f"[ingest_stats] Failed to write {_WRITE_PATH}: {e}")
+
+
+# Budgets and counters add up across listener processes; the policy and
+# the overflowing nodes do not.
+def _merge_queues(queues: list[dict]) -> dict:
+    merged: dict = {}
+    for q in queues:
+        for key, value in q.items():
+            if key == "overflowing":
+                merged[key] = sorted({*merged.get(key, []), *value})
+            elif isinstance(value, (int, float)) and not isinstance(value, bool):
+                merged[key] = merged.get(key, 0) + value
+            else:
+                merged.setdefault(key, value)
+    return merged
+
+
+def _merge_pipelines(pipelines: list[dict]) -> dict:
+    if not pipelines:
+        return {}
+    stages: dict = {}
+    for p in pipelines:
+        for name, t in (p.get("stages") or {}).items():
+            s = stages.setdefault(name, {"n": 0, "total_ms": 0.0, "ms_max": 0.0})
+            s["n"] += t.get("n") or 0
+            s["total_ms"] += (t.get("ms_mean") or 0.0) * (t.get("n") or 0)
+            s["ms_max"] = max(s["ms_max"], t.get("ms_max") or 0.0)
+    return {
+        "workers": [w for p in pipelines for w in p.get("workers") or []],
+        "stages": {
+            name: {
+                "n": s["n"],
+                "ms_mean": round(s["total_ms"] / s["n"], 3) if s["n"] else None,
+                "ms_max": s["ms_max"],
+            }
+            for name, s in stages.items()
+        },
+        "budget_bytes": sum(p.get("budget_bytes") or 0 for p in pipelines),
+    }
+
+
+# Backend side: the last snapshot written by the data listener (merged
+# over its processes).
+def load_ingest_stats() -> dict:
+    snapshots = read_all(INGEST_STATS_JSON)
+    if len(snapshots) == 1:
+        return snapshots[0]
+    return {
+        "updated_at": latest_updated_at(snapshots),
+        "nodes": {serial: node for s in snapshots for serial, node in s.get("nodes", {}).items()},
+        "storage_shards": [shard for s in snapshots for shard in s.get("storage_shards") or []],
+        "storage_queue": _merge_queues([s["storage_queue"] for s in snapshots if s.get("storage_queue")]),
+        "raw_backup": [w for s in snapshots for w in s.get("raw_backup") or []],
+        "ingest_pipeline": _merge_pipelines([s["ingest_pipeline"] for s in snapshots
+                                             if s.get("ingest_pipeline")]),
+    }
@@ -0,0 +1,52 @@
+# Snapshot files the data listener writes for the backend (ingest_stats.json,
+# accel_summary.json) when it runs as several processes
+# (dataStorage/listener_supervisor.py). Each process writes its own
+# <name>.p<k>.json, as only it knows its nodes; the backend reads them all
+# and merges.
+import json
+import os
+from pathlib import Path
+
+# "index/count", set by the supervisor for each listener process
+_PARTITION = os.getenv("SHM_INGEST_PARTITION", "0/1")
+
+# A file this much older than the newest one is left over from a different
+# process layout (e.g. partitioned before, single listener now). Long
+# enough that a partition whose nodes went quiet is still shown.
+STALE_S = 3600.0
+
+
+def writer_path(base: Path) -> Path:
+    """File this process writes: base itself unless ingest is partitioned."""
+    index, _, count = _PARTITION.partition("/")
+    if count in ("", "1"):
+        return base
+    return base.with_name(f"{base.stem}.p{index}{base.suffix}")
+
+
+def read_all(base: Path) -> list[dict]:
+    """Current snapshots from base and its per-process files."""
+    found = []
+    for path in [base, *sorted(base.parent.glob(f"{base.stem}.p*{base.suffix}"))]:
+        try:
+            found.append((path.stat().st_mtime, path))
+        except OSError:
+            continue
+    if not found:
+        return []
+
+    newest = max(mtime for mtime, _ in found)
+    snapshots = []
+    for mtime, path in found:
+        if newest - mtime > STALE_S:
+            continue
+        try:
+            snapshots.append(json.loads(path.read_text(encoding="utf-8")))
+        except (OSError, ValueError):
+            continue
+    return snapshots
+
+
+def latest_updated_at(snapshots: list[dict]) -> str | None:
+    # ISO-8601 UTC strings sort in time order
+    return max((s.get("updated_at") or "" for s in snapshots), default="") or None
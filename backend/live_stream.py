@@ -0,0 +1,194 @@
+import asyncio
+import json
+import math
+import os
+from datetime import datetime, timezone
+from threading import Lock
+from typing import Optional
+
+from plot_downsample import make_downsampler
+
+# Live sensor frames for the dashboard, straight from the ingest path.
+#
+# Live plots used to re-poll the plot endpoints, which re-read the SSD. Now
+# the data listener reduces every stored packet to a small frame (at most
+# LIVE_ACCEL_POINTS / LIVE_INCLIN_POINTS LTTB points per sensor, plus the
+# temperature reading and outage breaks) and publishes it on the local
+# broker under LIVE_TOPIC (QoS 0: a live view would rather skip a frame than
+# queue it). The backend's MQTT client hands each frame to the in-process
+# hub below, which serialises it once and fans it out to the
+# /api/events/sensor-data subscribers of that node. No disk I/O either way.
+#
+# Frame (JSON):
+#   {"node": serial, "accel": [[ts_s, x, y, z], ...],
+#    "inclin": [[ts_s, roll, pitch, yaw], ...], "temp": [ts_s, value],
+#    "h": {"accelerometer": 0 | 1, ...}}
+# with None for NaN values and outage breaks (all axes None). "h" flags, per
+# sensor in the packet, whether it had a NaN sample or an outage; the
+# reduced points cannot tell (fleet_status.py).
+#
+# Each subscriber has its own bounded queue and max_hz: frames arriving
+# faster are coalesced into one SSE message, and the oldest are dropped
+# when a slow client lets LIVE_QUEUE_FRAMES pile up.
+LIVE_TOPIC = "shm/live/{serial}"
+LIVE_SUBSCRIBE_TOPIC = "shm/live/+"
+LIVE_ACCEL_POINTS = int(os.getenv("SHM_LIVE_ACCEL_POINTS", "50"))
+LIVE_INCLIN_POINTS = int(os.getenv("SHM_LIVE_INCLIN_POINTS", "10"))
+LIVE_QUEUE_FRAMES = 64
+
+_GAP_KEYS = {"a": "accel", "i": "inclin"}
+
+
+# Ingest side (data listener)
+_sink = None
+
+
+def set_sink(sink) -> None:
+    """Install sink(topic, payload_bytes), e.g. the listener's MQTT publish."""
+    global _sink
+    _sink = sink
+
+
+def _finite_or_none(value):
+    try:
+        v = float(value)
+    except (TypeError, ValueError):
+        return None
+    return v if math.isfinite(v) else None
+
+
+def _reduced(samples: list, points: int) -> list:
+    if not samples:
+        return []
+    first, last = float(samples[0][0]), float(samples[-1][0])
+    sampler = make_downsampler("lttb", first, last + 1e-6, points, 3)
+    for s in samples:
+        sampler.add(float(s[0]), tuple(_finite_or_none(v) for v in s[1:4]))
+    return [[ts, *values] for ts, values, _, _ in sampler.finish()]
+
+
+def build_frame(serial: str, data: dict, health: Optional[dict] = None) -> dict:
+    """The live frame of one normalised data packet; health as returned by
+    node_registry.update_sensor_runtime()."""
+    frame = {"node": serial}
+    accel = _reduced(data.get("a") or [], LIVE_ACCEL_POINTS)
+    inclin = _reduced(data.get("i") or [], LIVE_INCLIN_POINTS)
+
+    # Outages as one all-None break each, merged in time order
+    for gap in data.get("g") or []:
+        sensor = _GAP_KEYS.get(gap[2]) if len(gap) > 2 else None
+        if sensor == "accel":
+            accel.append([float(gap[0]), None, None, None])
+        elif sensor == "inclin":
+            inclin.append([float(gap[0]), None, None, None])
+    if accel:
+        frame["accel"] = sorted(accel, key=lambda p: p[0])
+    if inclin:
+        frame["inclin"] = sorted(inclin, key=lambda p: p[0])
+
+    temp = data.get("T")
+    if temp and len(temp) > 1:
+        frame["temp"] = [float(temp[0]), _finite_or_none(temp[1])]
+    if health:
+        frame["h"] = {sensor: int(has_nan) for sensor, has_nan in health.items()}
+    return frame
+
+
+def note_packet(serial: str, data: dict, health: Optional[dict] = None) -> None:
+    """Publish one normalised packet's live frame. Never raises into the
+    ingest path: a lost frame only costs the live view."""
+    if _sink is None:
+        return
+    try:
+        payload = json.dumps(build_frame(serial, data, health), separators=(",", ":"))
+        _sink(LIVE_TOPIC.format(serial=serial), payload.encode())
+    except Exception as e:
+        print(f"[live_stream] Failed to publish frame for {serial}: {e}")
+
+
+# Backend side (hub)
+def _iso(ts: float) -> str:
+    return datetime.fromtimestamp(ts, tz=timezone.utc).isoformat()
+
+
+def _frame_points(frame: dict) -> dict:
+    # Plot-endpoint point shape, so the dashboard appends frames as is
+    out = {"node": frame.get("node")}
+    for sensor, names in (("accel", ("x", "y", "z")), ("inclin", ("roll", "pitch", "yaw"))):
+        rows = frame.get(sensor)
+        if rows:
+            out[sensor] = [{"ts": _iso(r[0]), **dict(zip(names, r[1:4]))} for r in rows]
+    temp = frame.get("temp")
+    if temp:
+        out["temp"] = [{"ts": _iso(temp[0]), "value": temp[1]}]
+    return out
+
+
+class Subscriber:
+    """One SSE client: bounded queue of serialised frames plus its rate."""
+
+    def __init__(self, serial: str, max_hz: float, loop: asyncio.AbstractEventLoop):
+        self.serial = serial
+        self.min_interval = 1.0 / max_hz
+        self.loop = loop
+        self.queue: asyncio.Queue = asyncio.Queue(maxsize=LIVE_QUEUE_FRAMES)
+        self.dropped = 0
+
+    def _put(self, text: str) -> None:
+        # Event loop thread; a full queue drops its oldest frame
+        if self.queue.full():
+            self.queue.get_nowait()
+            self.dropped += 1
+        self.queue.put_nowait(text)
+
+    async def next_batch(self) -> list:
+        """Wait for a frame, then take everything queued with it."""
+        batch = [await self.queue.get()]
+        while not self.queue.empty():
+            batch.append(self.queue.get_nowait())
+        return batch
+
+
+_SUBSCRIBERS: dict = {}     # serial -> set of Subscriber
+_SUBSCRIBERS_LOCK = Lock()
+
+
+def subscribe(serial: str, max_hz: float) -> Subscriber:
+    sub = Subscriber(serial, max_hz, asyncio.get_running_loop())
+    with _SUBSCRIBERS_LOCK:
+        _SUBSCRIBERS.setdefault(serial, set()).add(sub)
+    return sub
+
+
+def unsubscribe(sub: Subscriber) -> None:
+    with _SUBSCRIBERS_LOCK:
+        subs = _SUBSCRIBERS.get(sub.serial)
+        if subs is not None:
+            subs.discard(sub)
+            if not subs:
+                del _SUBSCRIBERS[sub.serial]
+
+
+def subscriber_count() -> int:
+    with _SUBSCRIBERS_LOCK:
+        return sum(len(subs) for subs in _SUBSCRIBERS.values())
+
+
+def publish(serial: str, payload: bytes) -> None:
+    """Fan one frame out to the node's subscribers. Called from the MQTT
+    client thread; the frame is parsed and serialised once, not per client."""
+    with _SUBSCRIBERS_LOCK:
+        subs = list(_SUBSCRIBERS.get(serial, ()))
+    if not subs:
+        return
+    try:
+        text = json.dumps(_frame_points(json.loads(payload)))
+    except (ValueError, TypeError, IndexError) as e:
+        print(f"[live_stream] Bad frame for {serial}: {e}")
+        return
+    for sub in subs:
+        try:
+            sub.loop.call_soon_threadsafe(sub._put, text)
+        except RuntimeError:
+            # Loop closed under a client that has not unsubscribed yet
+            pass
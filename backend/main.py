@@ -1,18 +1,23 @@
 from fastapi import FastAPI, Query, Request, HTTPException, Depends
 from fastapi.middleware.cors import CORSMiddleware
-from fastapi.responses import StreamingResponse
+from fastapi.responses import Response, StreamingResponse
 from datetime import datetime, timezone, timedelta
 from typing import List, Dict, Any, Optional
 from pydantic import BaseModel, Field
 import asyncio
+import gzip
 import json
 import sqlite3
 import shutil
 import os
 from pathlib import Path
-from collections import deque
+from threading import Lock
 import subprocess
 import math
+import struct
+import time
+import sys
+from array import array
 
 import mqtt_listener_control as mqtt_listener_control
 from mqtt_listener_control import start_listener
@@ -26,18 +31,41 @@ from settings_store import (
     save_settings,
     ensure_node_defaults,
     update_accelerometer_config_request,
-    # mark_accelerometer_config_failed,
+    apply_accelerometer_config_ack,
+    mark_accelerometer_config_failed,
+    get_publish_config,
+    update_publish_config,
     get_site_name,
     update_site_name,
-    # update_node_control_request,
-    # mark_node_control_failed,
+    update_node_control_request,
+    apply_node_control_ack,
+    mark_node_control_failed,
 )
 
 from node_registry import list_nodes, get_node_by_id, update_node_position
-from mqtt_commands import publish_accelerometer_config, publish_node_control
+from mqtt_commands import (
+    build_accelerometer_config,
+    publish_fleet_config,
+    publish_fleet_control,
+    publish_fleet_start_at,
+    start_command_client,
+    stop_command_client,
+)
 
 from export_routes import router as export_router
+from export_utils import find_sensor_files_for_serial
 from sensor_export_decoder import iter_decoded_records_for_export
+import plot_tail_cache
+import query_executor
+import storage_catalog
+import replication
+import live_stream
+import metrics
+import node_analytics
+import fault_bus
+import fleet_status
+from plot_pyramid import PYRAMID_AXES, read_buckets
+from plot_downsample import make_downsampler
 
 from server_management import (
     clear_faults_db,
@@ -51,6 +79,8 @@ from server_management import (
 )
 
 from fault_logger import ensure_fault_db_schema
+from ingest_stats import load_ingest_stats
+from accel_summary import load_accel_summaries
 
 from auth.auth_routes import router as auth_router
 from auth.auth_db import init_db
@@ -70,6 +100,7 @@ app.add_middleware(
     allow_credentials=True,
     allow_methods=["*"],
     allow_headers=["*"],
+    expose_headers=["X-Plot-Sensor", "X-Plot-Unit"],
 )
 
 # Protect export routes as authenticated read-only API routes.
@@ -87,13 +118,40 @@ SENSOR_KEYS = ("accelerometer", "inclinometer", "temperature")
 
 # Keep raw preview plots limited to short windows to keep the backend lightweight.
 PLOT_MAX_WINDOW_MINUTES = 60
+# Longer windows are served from the downsample pyramid only (plot_pyramid.py).
+PLOT_PYRAMID_MAX_MINUTES = 7 * 24 * 60
+# Point budget per plot request (?points=), reduced by ?downsample=
+# (plot_downsample.py)
+PLOT_MIN_POINTS = 50
+PLOT_MAX_POINTS = 5000
+# /api/plot/window (the dashboard's WebGL plot): windows up to this long are
+# served sample by sample when the pyramid has no level fine enough
+PLOT_WINDOW_RAW_MAX_S = 15 * 60
+PLOT_WINDOW_MAX_POINTS = 20000
+# Binary plot bodies at least this large are gzipped for a client that
+# accepts it
+PLOT_GZIP_MIN_BYTES = 16 * 1024
 FAULT_LOG_MAX_PAGES = 10
+# Fault SSE: idle keepalive, and DB poll period while the fault bus is down
+FAULT_SSE_KEEPALIVE_S = 15.0
+FAULT_SSE_FALLBACK_POLL_S = 5.0
+# Live sensor-data SSE: per-client rate cap and idle keepalive
+LIVE_MAX_HZ = 10.0
+LIVE_KEEPALIVE_S = 15.0
+
+# Query-path metrics (metrics.py), served at /metrics with the data
+# listener's
+_PLOT_READ_S = metrics.histogram(
+    "shm_plot_read_seconds", "Time to read and downsample one plot window", ("sensor", "source"),
+    buckets=(0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0))
+_SSE_CLIENTS = metrics.gauge("shm_sse_clients", "Open server-sent event streams", ("stream",))
 
 
 # Stateful fault types that should be reduced to current state.
 STATEFUL_FAULT_TYPES = (
     "ethernet_link",
     "mqtt_connection",
+    "publish_flow",
     "power_loss",
 )
 
@@ -107,10 +165,36 @@ class AccelerometerConfigApplyRequest(BaseModel):
     odr_index: int = Field(..., ge=0, le=2)
     range: int = Field(..., ge=1, le=3)
     hpf_corner: int = Field(..., ge=0, le=6)
+    payload_format: str | None = Field(None, pattern="^(json|bin|packed)$")
+    spectrum_mode: str | None = Field(None, pattern="^(off|on|only)$")
+    trigger_mode: str | None = Field(None, pattern="^(off|threshold|rms|sta_lta)$")
+    trigger_level: int | None = Field(None, ge=1, le=100000)
+    metrics_interval_s: int | None = Field(None, ge=0, le=3600)
+    flow_mode: str | None = Field(None, pattern="^(auto|off)$")
+    batch_s: int | None = Field(None, ge=1, le=10)
+    batch_max_ms: int | None = Field(None, ge=0, le=60000)
 
 
 class NodeControlRequest(BaseModel):
-    cmd: str = Field(..., pattern="^(start|stop|init|reset)$")
+    cmd: str = Field(..., pattern="^(start|stop|init|reset|trigger|timing|timing_reset)$")
+
+
+# Fleet commands go to node_ids, or to every online node when it is empty.
+class FleetAccelerometerConfigRequest(AccelerometerConfigApplyRequest):
+    node_ids: list[int] = Field(default_factory=list)
+
+
+# broadcast sends one message on wind_turbine/all/cmd/control instead of one
+# per node; the acks are still collected per node.
+class FleetControlRequest(NodeControlRequest):
+    node_ids: list[int] = Field(default_factory=list)
+    broadcast: bool = False
+
+
+# Lead time must cover MQTT delivery to every node; the firmware accepts
+# 100 ms to 600 s ahead of its own clock.
+class FleetStartAtRequest(BaseModel):
+    lead_ms: int = Field(2000, ge=500, le=600000)
 
 
 class SiteNameUpdate(BaseModel):
@@ -199,6 +283,82 @@ def empty_fault_response(page: int = 1, page_size: int = 15) -> Dict[str, Any]:
     }
 
 
+# Reduce stateful fault history into one latest row per state key.
+_ACTIVE_SENSOR_FAULTS_SQL = """
+WITH normalized_faults AS (
+    SELECT
+        id,
+        serial_number,
+        sensor_type,
+        fault_type,
+        COALESCE(state_key, fault_type) AS normalized_state_key,
+        COALESCE(
+            is_stateful,
+            CASE
+                WHEN fault_type IN ('ethernet_link', 'mqtt_connection', 'power_loss') THEN 1
+                ELSE 0
+            END
+        ) AS normalized_is_stateful,
+        severity,
+        fault_status,
+        description,
+        ts
+    FROM faults
+    {serial_filter}
+),
+ranked_faults AS (
+    SELECT
+        id,
+        serial_number,
+        sensor_type,
+        fault_type,
+        normalized_state_key AS state_key,
+        normalized_is_stateful AS is_stateful,
+        severity,
+        fault_status,
+        description,
+        ts,
+        ROW_NUMBER() OVER (
+            PARTITION BY serial_number, sensor_type, normalized_state_key
+            ORDER BY ts DESC, id DESC
+        ) AS rn
+    FROM normalized_faults
+    WHERE normalized_is_stateful = 1
+)
+SELECT
+    id,
+    serial_number,
+    sensor_type,
+    fault_type,
+    state_key,
+    is_stateful,
+    severity,
+    fault_status,
+    description,
+    ts
+FROM ranked_faults
+WHERE rn = 1
+  AND LOWER(fault_status) = 'active'
+  AND LOWER(sensor_type) IN ('accelerometer', 'inclinometer', 'temperature')
+ORDER BY ts DESC
+"""
+
+
+def _query_active_sensor_faults(cur: sqlite3.Cursor, serial: Optional[str] = None) -> list[dict[str, Any]]:
+    """
+    Currently active stateful accelerometer / inclinometer / temperature
+    faults, newest first, of one node serial or of every node.
+    """
+    if serial is None:
+        cur.execute(_ACTIVE_SENSOR_FAULTS_SQL.format(serial_filter=""))
+    else:
+        cur.execute(
+            _ACTIVE_SENSOR_FAULTS_SQL.format(serial_filter="WHERE serial_number = ?"),
+            [serial],
+        )
+    return [dict(row) for row in cur.fetchall()]
+
+
 def _active_sensor_faults_for_serial(serial: str) -> dict[str, list[dict[str, Any]]]:
     """
     Return currently active stateful sensor faults grouped by sensor type for one node serial.
@@ -220,71 +380,7 @@ def _active_sensor_faults_for_serial(serial: str) -> dict[str, list[dict[str, An
         con.row_factory = sqlite3.Row
         cur = con.cursor()
 
-        # Reduce stateful fault history into one latest row per state key.
-        cur.execute(
-            """
-            WITH normalized_faults AS (
-                SELECT
-                    id,
-                    serial_number,
-                    sensor_type,
-                    fault_type,
-                    COALESCE(state_key, fault_type) AS normalized_state_key,
-                    COALESCE(
-                        is_stateful,
-                        CASE
-                            WHEN fault_type IN ('ethernet_link', 'mqtt_connection', 'power_loss') THEN 1
-                            ELSE 0
-                        END
-                    ) AS normalized_is_stateful,
-                    severity,
-                    fault_status,
-                    description,
-                    ts
-                FROM faults
-                WHERE serial_number = ?
-            ),
-            ranked_faults AS (
-                SELECT
-                    id,
-                    serial_number,
-                    sensor_type,
-                    fault_type,
-                    normalized_state_key AS state_key,
-                    normalized_is_stateful AS is_stateful,
-                    severity,
-                    fault_status,
-                    description,
-                    ts,
-                    ROW_NUMBER() OVER (
-                        PARTITION BY serial_number, sensor_type, normalized_state_key
-                        ORDER BY ts DESC, id DESC
-                    ) AS rn
-                FROM normalized_faults
-                WHERE normalized_is_stateful = 1
-            )
-            SELECT
-                id,
-                serial_number,
-                sensor_type,
-                fault_type,
-                state_key,
-                is_stateful,
-                severity,
-                fault_status,
-                description,
-                ts
-            FROM ranked_faults
-            WHERE rn = 1
-              AND LOWER(fault_status) = 'active'
-              AND LOWER(sensor_type) IN ('accelerometer', 'inclinometer', 'temperature')
-            ORDER BY ts DESC
-            """,
-            [serial],
-        )
-
-        for row in cur.fetchall():
-            item = dict(row)
+        for item in _query_active_sensor_faults(cur, serial):
             sensor_type = str(item.get("sensor_type", "")).lower().strip()
             if sensor_type in grouped:
                 grouped[sensor_type].append(item)
@@ -302,9 +398,11 @@ def _active_sensor_faults_for_serial(serial: str) -> dict[str, list[dict[str, An
 def _recent_sensor_data_presence(
     serial: str,
     window_seconds: int = SENSOR_STATUS_WINDOW_SECONDS,
+    runtime: Optional[dict[str, Any]] = None,
 ) -> dict[str, dict[str, Any]]:
     """
-    Read recent per-sensor health from the live MQTT packet cache.
+    Read recent per-sensor health from the live MQTT packet cache, or from
+    the given runtime.
 
     A sensor counts as having recent data only when its cached timestamps
     are within the requested window.
@@ -332,7 +430,8 @@ def _recent_sensor_data_presence(
         },
     }
     
-    runtime = get_sensor_runtime(serial)  
+    if runtime is None:
+        runtime = get_sensor_runtime(serial)
 
     def _parse_iso(ts: Any) -> Optional[datetime]:
         if not ts:
@@ -422,10 +521,22 @@ def build_node_sensor_status(
     if not serial:
         raise HTTPException(status_code=400, detail="Node has no serial number")
 
-    node_online = bool(node.get("online"))
     fault_groups = _active_sensor_faults_for_serial(serial)
     data_presence = _recent_sensor_data_presence(serial, window_seconds=window_seconds)
 
+    return {
+        **_node_sensor_status_entry(node, fault_groups, data_presence, window_seconds),
+        "time": datetime.now(timezone.utc).isoformat(),
+    }
+
+
+def _node_sensor_status_entry(
+    node: Dict[str, Any],
+    fault_groups: dict[str, list[dict[str, Any]]],
+    data_presence: dict[str, dict[str, Any]],
+    window_seconds: int,
+) -> Dict[str, Any]:
+    node_online = bool(node.get("online"))
     sensors: dict[str, Any] = {}
 
     for sensor_name in SENSOR_KEYS:
@@ -454,14 +565,85 @@ def build_node_sensor_status(
 
     return {
         "node_id": node["node_id"],
-        "serial": serial,
+        "serial": str(node.get("serial") or "").strip(),
         "node_online": node_online,
         "window_seconds": window_seconds,
         "sensors": sensors,
-        "time": datetime.now(timezone.utc).isoformat(),
     }
 
 
+# Fleet sensor health (fleet_status.py). Recomputed from memory at most once
+# per FLEET_STATUS_REFRESH_S, whatever the number of clients; the active
+# faults are re-read from the DB every FLEET_FAULT_RESEED_S as a safety net,
+# and on each refresh while the backend's MQTT client (the fault bus) is down.
+FLEET_STATUS_REFRESH_S = 1.0
+FLEET_FAULT_RESEED_S = 60.0
+
+_fleet_refresh_lock = Lock()
+_fleet_refreshed_at = 0.0
+_fleet_seeded_at: Optional[float] = None
+
+
+def _seed_fleet_faults() -> None:
+    rows: list[dict[str, Any]] = []
+    max_id = 0
+
+    if is_ssd_available() and FAULTS_DB.exists():
+        con: Optional[sqlite3.Connection] = None
+        try:
+            # One read transaction, so max_id matches the rows
+            con = sqlite3.connect(str(FAULTS_DB), isolation_level=None)
+            con.row_factory = sqlite3.Row
+            cur = con.cursor()
+            cur.execute("BEGIN")
+            max_id = int(cur.execute("SELECT COALESCE(MAX(id), 0) FROM faults").fetchone()[0])
+            rows = _query_active_sensor_faults(cur)
+            cur.execute("COMMIT")
+        except sqlite3.Error as e:
+            print(f"[fleet] Active fault read failed: {e}")
+            return
+        finally:
+            if con is not None:
+                con.close()
+
+    fleet_status.seed_faults(rows, max_id)
+
+
+def refresh_fleet_status() -> None:
+    global _fleet_refreshed_at, _fleet_seeded_at
+
+    with _fleet_refresh_lock:
+        now = time.monotonic()
+        if now - _fleet_refreshed_at < FLEET_STATUS_REFRESH_S:
+            return
+
+        if (
+            _fleet_seeded_at is None
+            or now - _fleet_seeded_at >= FLEET_FAULT_RESEED_S
+            or not mqtt_listener_control.MQTT_CONNECTED
+        ):
+            _seed_fleet_faults()
+            _fleet_seeded_at = now
+
+        entries = []
+        for node in list_nodes(timeout_seconds=60, include_runtime=True):
+            serial = str(node.get("serial") or "").strip()
+            if not serial:
+                continue
+            runtime = fleet_status.merged_runtime(serial, node.get("sensor_runtime") or {})
+            entries.append(
+                _node_sensor_status_entry(
+                    node,
+                    fleet_status.active_faults(serial),
+                    _recent_sensor_data_presence(serial, runtime=runtime),
+                    SENSOR_STATUS_WINDOW_SECONDS,
+                )
+            )
+
+        fleet_status.publish(entries)
+        _fleet_refreshed_at = time.monotonic()
+
+
 @app.get("/")
 def root():
     return {"message": "backend working"}
@@ -473,11 +655,29 @@ def health():
     return get_system_health()
 
 
+@app.get("/metrics")
+def get_metrics():
+    # Prometheus scrape target: the backend's and the data listener
+    # processes' metrics (metrics.py). Unauthenticated like /health, as a
+    # scraper has no session.
+    return Response(metrics.exposition(), media_type="text/plain; version=0.0.4; charset=utf-8")
+
+
+@app.get("/api/metrics/summary")
+def get_metrics_summary(user=Depends(get_current_user)):
+    """
+    Every metric summed over its series and processes, for the dashboard:
+    counter and gauge values, histogram count, mean and p50 / p95 bucket.
+    """
+    return metrics.summary()
+
+
 @app.get("/api/events/health")
 async def health_events(request: Request, user=Depends(get_current_user)):
     # SSE code for backend status live updates on the frontend dashboard.
     # This endpoint should remain independent of SSD availability.
     async def event_generator():
+        _SSE_CLIENTS.inc("health")
         try:
             while True:
                 if await request.is_disconnected():
@@ -490,6 +690,8 @@ async def health_events(request: Request, user=Depends(get_current_user)):
         except asyncio.CancelledError:
             # Expected when the client disconnects or the backend shuts down.
             return
+        finally:
+            _SSE_CLIENTS.dec("health")
 
     return StreamingResponse(
         event_generator(),
@@ -537,6 +739,33 @@ def get_storage(user=Depends(get_current_user)):
         }
 
 
+# Per-node storage usage (files, bytes, records, hour span per kind) from
+# the storage catalog; "ready" is false until the data listener has
+# reconciled it with the disk once.
+@app.get("/api/storage/nodes")
+def get_storage_by_node(user=Depends(get_current_user)):
+    usage = storage_catalog.usage_by_node()
+    if usage is None:
+        return {"ready": False, "nodes": []}
+
+    nodes: Dict[str, Dict[str, Any]] = {}
+    for row in usage:
+        node = nodes.setdefault(row["node"], {"serial": row["node"], "bytes": 0})
+        node["bytes"] += row["bytes"]
+        node[row["kind"]] = {k: v for k, v in row.items() if k not in ("node", "kind")}
+    return {"ready": True, "nodes": list(nodes.values())}
+
+
+@app.get("/api/replication/status")
+def get_replication_status(user=Depends(get_current_user)):
+    """
+    Upstream replication of sealed storage files (see replication.py):
+    pending files and bytes, lag (age of the oldest unshipped file),
+    progress of the current transfer and the last error.
+    """
+    return replication.status()
+
+
 @app.get("/api/storage/status")
 def get_storage_status(user=Depends(get_current_user)):
     """
@@ -713,9 +942,79 @@ def get_node_sensor_status(
     """
     Return per-sensor health for one node using recent data presence + active faults.
     """
+    if window_seconds == SENSOR_STATUS_WINDOW_SECONDS:
+        refresh_fleet_status()
+        entry = fleet_status.node(node_id)
+        if entry is not None:
+            return {**entry, "time": datetime.now(timezone.utc).isoformat()}
     return build_node_sensor_status(node_id=node_id, window_seconds=window_seconds)
 
 
+@app.get("/api/nodes/{node_id}/trends")
+def get_node_trends(
+    node_id: int,
+    days: float = Query(7, gt=0, le=node_analytics.ANALYTICS_RETENTION_S / 86400),
+    points: int = Query(1000, ge=PLOT_MIN_POINTS, le=PLOT_MAX_POINTS),
+    user=Depends(get_current_user),
+):
+    """
+    Health trends of one node from its per-minute analytics (see
+    node_analytics.py), merged to about `points` buckets: accel AC RMS and
+    peak-to-peak, mean inclination and its drift from the first bucket,
+    temperature and dominant frequency. No sample data is read.
+    """
+    serial = _get_plot_node_serial(node_id)
+    end_s = time.time()
+    start_s = end_s - days * 86400
+    width_s = max(60, math.ceil((end_s - start_s) / points / 60) * 60)
+
+    points_out = []
+    baseline = None
+    for point in node_analytics.read_trends(serial, start_s, end_s, width_s):
+        incl = point["inclin_mean"]
+        if incl is not None and baseline is None:
+            baseline = incl
+        point["inclin_drift"] = (
+            [round(v - b, 6) for v, b in zip(incl, baseline)] if incl is not None else None
+        )
+        points_out.append({"ts": _iso_from_epoch_seconds(point.pop("start_s")), **point})
+
+    return {
+        "node": node_id,
+        "bucket_s": width_s,
+        "units": {"accel": "g", "inclin": "deg", "temp": "C", "dom_hz": "Hz", "dom_psd": "g^2/Hz"},
+        "points": points_out,
+    }
+
+
+@app.get("/api/fleet/status")
+def get_fleet_status(
+    request: Request,
+    since: Optional[str] = Query(None, description="Tag of the snapshot the client has"),
+    user=Depends(get_current_user),
+):
+    """
+    Sensor health of every node, as /api/nodes/{id}/sensor-status reports it
+    for one. With since (the "tag" of an earlier response, also its ETag)
+    only the nodes changed since are returned ("full": false); nothing
+    changed is a 304.
+    """
+    refresh_fleet_status()
+
+    etag = f'"{fleet_status.tag()}"'
+    if request.headers.get("if-none-match") == etag:
+        return Response(status_code=304, headers={"ETag": etag, "Cache-Control": "no-cache"})
+
+    body = fleet_status.read(since)
+    body["window_seconds"] = SENSOR_STATUS_WINDOW_SECONDS
+    body["time"] = datetime.now(timezone.utc).isoformat()
+    return Response(
+        content=json.dumps(body),
+        media_type="application/json",
+        headers={"ETag": f'"{body["tag"]}"', "Cache-Control": "no-cache"},
+    )
+
+
 @app.put("/api/nodes/{node_id}/position")
 def put_node_position(node_id: int, payload: NodePositionUpdate, user=Depends(require_admin)):
     updated = update_node_position(node_id=node_id, x=payload.x, y=payload.y)
@@ -758,17 +1057,35 @@ def startup_event():
     except Exception as e:
         print(f"[startup] Fault DB schema check failed: {e}")
 
+    # Fault rows from the bus keep the fleet status current
+    fault_bus.add_listener(fleet_status.note_fault_rows)
+
     try:
         mqtt_status_client = start_listener()
     except Exception as e:
         mqtt_status_client = None
         print(f"[startup] MQTT listener not started: {e}")
 
+    try:
+        start_command_client()
+    except Exception as e:
+        print(f"[startup] MQTT command client not started: {e}")
+
+    replication.start_replication()
+
 
 @app.on_event("shutdown")
 def shutdown_event():
     global mqtt_status_client
 
+    query_executor.shutdown()
+    replication.stop_replication()
+
+    try:
+        stop_command_client()
+    except Exception as e:
+        print(f"[shutdown] MQTT command client cleanup failed: {e}")
+
     if mqtt_status_client is None:
         return
 
@@ -866,8 +1183,138 @@ def api_put_site_name(payload: SiteNameUpdate, user=Depends(require_admin)):
     return {"ok": True, "site_name": updated_name}
 
 
-# Publish config immediately without seq/ack tracking.
-# The older pending-sync workflow is intentionally commented out for now.
+# Resolve node_ids (or every online node when empty) to registry entries.
+def _fleet_targets(node_ids: list[int]) -> list[dict]:
+    if not node_ids:
+        return [node for node in list_nodes(timeout_seconds=60) if node.get("online")]
+
+    nodes = []
+    for node_id in dict.fromkeys(node_ids):
+        node = get_node_by_id(node_id, timeout_seconds=60)
+        if node is None:
+            raise HTTPException(status_code=404, detail=f"Node {node_id} not found")
+        nodes.append(node)
+    return nodes
+
+
+# Send one accelerometer configuration to nodes and record each node's ack.
+# Batching is a stored per-node setting: it is resent with every configure
+# so a node that rebooted (back to one packet per message) picks it up, and
+# nodes whose stored batching differs get their own command.
+def _configure_nodes(nodes: list[dict], payload: AccelerometerConfigApplyRequest) -> dict:
+    groups: dict[tuple, list[dict]] = {}
+    for node in nodes:
+        ensure_node_defaults(node["node_id"])
+        batching = update_publish_config(
+            node["node_id"],
+            batch_s=payload.batch_s,
+            batch_max_ms=payload.batch_max_ms,
+        )
+        groups.setdefault((batching.batch_s, batching.batch_max_ms), []).append(node)
+
+    results = []
+    for (batch_s, batch_max_ms), group in groups.items():
+        config = build_accelerometer_config(
+            odr_index=payload.odr_index,
+            range_value=payload.range,
+            hpf_corner=payload.hpf_corner,
+            payload_format=payload.payload_format,
+            spectrum_mode=payload.spectrum_mode,
+            trigger_mode=payload.trigger_mode,
+            trigger_level=payload.trigger_level,
+            metrics_interval_s=payload.metrics_interval_s,
+            flow_mode=payload.flow_mode,
+            batch_s=batch_s,
+            batch_max_ms=batch_max_ms,
+        )
+        try:
+            results.append(publish_fleet_config([node["serial"] for node in group], config))
+        except Exception as exc:
+            raise HTTPException(
+                status_code=503,
+                detail=f"Failed to publish configure command: {exc}",
+            )
+
+    result = _merge_results("configure", results)
+    by_serial = {node["serial"]: node for node in nodes}
+    for node_result in result["nodes"]:
+        node = by_serial.get(node_result["serial"])
+        if node is None:
+            continue
+        node_result["node_id"] = node["node_id"]
+        if node_result["status"] == "acked":
+            apply_accelerometer_config_ack(
+                node_id=node["node_id"],
+                odr_index=payload.odr_index,
+                range_value=payload.range,
+                hpf_corner=payload.hpf_corner,
+                seq_ack=node_result["seq"],
+                acked_at=datetime.now(timezone.utc).isoformat(),
+                current_state=node_result.get("state") or "unknown",
+            )
+        else:
+            mark_accelerometer_config_failed(node["node_id"])
+    return result
+
+
+# Send a control command to nodes and record each node's ack.
+def _control_nodes(nodes: list[dict], cmd: str, broadcast: bool = False) -> dict:
+    try:
+        result = publish_fleet_control([node["serial"] for node in nodes], cmd, broadcast=broadcast)
+    except Exception as exc:
+        raise HTTPException(
+            status_code=503,
+            detail=f"Failed to publish control command: {exc}",
+        )
+
+    result = _merge_results(cmd, [result])
+    by_serial = {node["serial"]: node for node in nodes}
+    for node_result in result["nodes"]:
+        node = by_serial.get(node_result["serial"])
+        if node is None:
+            continue
+        node_result["node_id"] = node["node_id"]
+        ensure_node_defaults(node["node_id"])
+        if node_result["status"] == "acked":
+            apply_node_control_ack(
+                node_id=node["node_id"],
+                cmd_ack=node_result.get("cmd_ack") or cmd,
+                seq_ack=node_result["seq"],
+                acked_at=datetime.now(timezone.utc).isoformat(),
+                current_state=node_result.get("state") or "unknown",
+            )
+        else:
+            mark_node_control_failed(node["node_id"], node_result.get("error"))
+    return result
+
+
+# One result for several mqtt_commands sends: per-node entries carry their
+# seq, totals and latency cover the whole set.
+def _merge_results(cmd: str, results: list[dict]) -> dict:
+    nodes = []
+    for result in results:
+        nodes += [{**node, "seq": result["seq"]} for node in result["nodes"]]
+    latencies = sorted(n["latency_ms"] for n in nodes if n["latency_ms"] is not None)
+    counts = {
+        status: sum(1 for n in nodes if n["status"] == status)
+        for status in ("acked", "rejected", "timeout")
+    }
+
+    return {
+        "cmd": cmd,
+        "targets": len(nodes),
+        **counts,
+        "all_acked": counts["acked"] == len(nodes),
+        "elapsed_ms": max((r["elapsed_ms"] for r in results), default=0.0),
+        "latency_ms": {
+            "median": latencies[len(latencies) // 2] if latencies else None,
+            "max": latencies[-1] if latencies else None,
+        },
+        "nodes": sorted(nodes, key=lambda n: n["serial"]),
+    }
+
+
+# Publish config with a seq and wait for the node's ack (mqtt_commands).
 @app.post("/api/nodes/{node_id}/config/accelerometer/apply")
 def apply_accelerometer_config(
     node_id: int,
@@ -880,27 +1327,18 @@ def apply_accelerometer_config(
 
     ensure_node_defaults(node_id)
 
-    try:
-        publish_accelerometer_config(
-            serial=node["serial"],
-            odr_index=payload.odr_index,
-            range_value=payload.range,
-            hpf_corner=payload.hpf_corner,
-        )
+    # Persist the requested configure payload so the UI reflects it after reloads.
+    update_accelerometer_config_request(
+        node_id=node_id,
+        odr_index=payload.odr_index,
+        range_value=payload.range,
+        hpf_corner=payload.hpf_corner,
+        seq=0,
+    )
 
-        # Persist the last sent configure payload so the UI reflects it after reloads.
-        update_accelerometer_config_request(
-            node_id=node_id,
-            odr_index=payload.odr_index,
-            range_value=payload.range,
-            hpf_corner=payload.hpf_corner,
-            seq=0,
-        )
-    except Exception as exc:
-        raise HTTPException(
-            status_code=503,
-            detail=f"Failed to publish configure command: {exc}",
-        )
+    result = _configure_nodes([node], payload)
+    batching = get_publish_config(node_id)
+    ack = result["nodes"][0]
 
     return {
         "ok": True,
@@ -911,12 +1349,15 @@ def apply_accelerometer_config(
             "odr_index": payload.odr_index,
             "range": payload.range,
             "hpf_corner": payload.hpf_corner,
+            "batch_s": batching.batch_s,
+            "batch_max_ms": batching.batch_max_ms,
         },
-        "status": "accepted",
+        "status": ack["status"],
+        "ack": ack,
     }
 
 
-# Publish runtime control commands immediately without seq/ack tracking.
+# Publish a runtime control command with a seq and wait for the node's ack.
 @app.post("/api/nodes/{node_id}/control")
 def control_node(node_id: int, payload: NodeControlRequest, user=Depends(require_admin)):
     node = get_node_by_id(node_id, timeout_seconds=60)
@@ -924,24 +1365,72 @@ def control_node(node_id: int, payload: NodeControlRequest, user=Depends(require
         raise HTTPException(status_code=404, detail="Node not found")
 
     ensure_node_defaults(node_id)
+    update_node_control_request(node_id, payload.cmd, seq=0)
 
-    try:
-        publish_node_control(
-            serial=node["serial"],
-            cmd=payload.cmd,
+    result = _control_nodes([node], payload.cmd)
+    ack = result["nodes"][0]
+
+    return {
+        "ok": True,
+        "node_id": node["node_id"],
+        "serial": node["serial"],
+        "cmd": payload.cmd,
+        "status": ack["status"],
+        "ack": ack,
+    }
+
+
+# Configure many nodes at once: the commands go out together on the open
+# command session and the response has every node's ack and latency.
+@app.post("/api/nodes/config/accelerometer/apply")
+def apply_fleet_accelerometer_config(
+    payload: FleetAccelerometerConfigRequest,
+    user=Depends(require_admin),
+):
+    nodes = _fleet_targets(payload.node_ids)
+    for node in nodes:
+        update_accelerometer_config_request(
+            node_id=node["node_id"],
+            odr_index=payload.odr_index,
+            range_value=payload.range,
+            hpf_corner=payload.hpf_corner,
+            seq=0,
         )
+
+    return {"ok": True, "sensor": "accelerometer", **_configure_nodes(nodes, payload)}
+
+
+# Start / stop / reset many nodes at once, per node or on the broadcast topic.
+@app.post("/api/nodes/control")
+def control_fleet(payload: FleetControlRequest, user=Depends(require_admin)):
+    nodes = _fleet_targets(payload.node_ids)
+    for node in nodes:
+        update_node_control_request(node["node_id"], payload.cmd, seq=0)
+
+    return {"ok": True, **_control_nodes(nodes, payload.cmd, broadcast=payload.broadcast)}
+
+
+# Broadcast a scheduled start so all nodes share one sample grid; the
+# response has the start_at ack of every online node.
+@app.post("/api/nodes/control/start-at")
+def fleet_start_at(payload: FleetStartAtRequest, user=Depends(require_admin)):
+    start_at = datetime.now(timezone.utc) + timedelta(milliseconds=payload.lead_ms)
+    epoch_us = int(start_at.timestamp() * 1000000)
+    nodes = _fleet_targets([])
+
+    try:
+        result = publish_fleet_start_at(epoch_us, [node["serial"] for node in nodes])
     except Exception as exc:
         raise HTTPException(
             status_code=503,
-            detail=f"Failed to publish control command: {exc}",
+            detail=f"Failed to publish start_at command: {exc}",
         )
 
     return {
         "ok": True,
-        "node_id": node["node_id"],
-        "serial": node["serial"],
-        "cmd": payload.cmd,
-        "status": "accepted",
+        "epoch_us": epoch_us,
+        "start_at": start_at.isoformat(),
+        **_merge_results("start_at", [result]),
     }
 
 
@@ -1416,62 +1905,171 @@ def get_fault_summary(user=Depends(get_current_user)):
     return read_active_fault_summary()
 
 
+@app.get("/api/ingest/stats")
+def get_ingest_stats(
+    serial: Optional[str] = Query(default=None),
+    user=Depends(get_current_user),
+):
+    """
+    Per-node packet loss / reorder counts and stage latency histograms, from
+    the node's packet sequence to the record on disk, and the storage
+    shard, raw backup writer and ingest worker queue depths (see
+    ingest_stats.py).
+    """
+    stats = load_ingest_stats()
+    if serial is None:
+        return stats
+    node = stats.get("nodes", {}).get(serial)
+    if node is None:
+        raise HTTPException(status_code=404, detail="No ingest stats for node")
+    shards = [s for s in stats.get("storage_shards", []) if serial in s.get("nodes", [])]
+    raw_writers = [w for w in stats.get("raw_backup", []) if serial in w.get("nodes", [])]
+    pipeline = stats.get("ingest_pipeline", {})
+    pipeline = dict(pipeline, workers=[w for w in pipeline.get("workers", [])
+                                       if serial in w.get("nodes", [])])
+    return {
+        "updated_at": stats.get("updated_at"),
+        "nodes": {serial: node},
+        "storage_shards": shards,
+        "storage_queue": stats.get("storage_queue", {}),
+        "raw_backup": raw_writers,
+        "ingest_pipeline": pipeline,
+    }
+
+
 @app.get("/api/events/faults")
 async def fault_events(
     request: Request,
     serial_number: Optional[str] = Query(default=None),
     limit: int = Query(default=200, ge=1, le=5000),
+    last_id: Optional[int] = Query(default=None, ge=0),
     user=Depends(get_current_user),
 ):
     # SSE code for live fault log updates on the frontend dashboard.
-    # This now sends one initial snapshot, then only newly inserted fault rows.
-    async def event_generator():
-        last_seen_id = 0
+    # Sends one initial snapshot (or, on a reconnect with last_id, the rows
+    # missed since), then the new rows as fault_bus broadcasts them. The DB
+    # is only polled again while the bus cannot be trusted: the client's
+    # queue overflowed or the backend's MQTT client is down.
+    serial_filter = _normalize_fault_text(serial_number).lower()
+
+    def matches(row: dict) -> bool:
+        return not serial_filter or serial_filter in str(row.get("serial_number") or "").lower()
+
+    def payload(mode: str, rows: list, seen_id: int) -> str:
+        body = {
+            "mode": mode,
+            "faults": rows,
+            "last_id": seen_id,
+            "time": datetime.now(timezone.utc).isoformat(),
+        }
+        return f"id: {seen_id}\ndata: {json.dumps(body)}\n\n"
 
+    async def event_generator():
+        # Subscribe before reading the DB so nothing lands in between
+        sub = fault_bus.subscribe()
+        _SSE_CLIENTS.inc("faults")
         try:
-            snapshot_rows = read_fault_rows(
-                serial_number=serial_number,
-                limit=limit,
-            )["faults"]
-
-            if snapshot_rows:
-                last_seen_id = max(int(row.get("id") or 0) for row in snapshot_rows)
-
-            snapshot_payload = {
-                "mode": "snapshot",
-                "faults": snapshot_rows,
-                "last_id": last_seen_id,
-                "time": datetime.now(timezone.utc).isoformat(),
-            }
-
-            yield f"data: {json.dumps(snapshot_payload)}\n\n"
+            if last_id is None:
+                snapshot_rows = read_fault_rows(
+                    serial_number=serial_number,
+                    limit=limit,
+                )["faults"]
+                last_seen_id = max((int(row.get("id") or 0) for row in snapshot_rows), default=0)
+                yield payload("snapshot", snapshot_rows, last_seen_id)
+            else:
+                last_seen_id = last_id
+                catch_up = read_fault_rows_since_id(
+                    after_id=last_seen_id,
+                    limit=limit,
+                    serial_number=serial_number,
+                )
+                if catch_up:
+                    last_seen_id = max(int(row.get("id") or 0) for row in catch_up)
+                yield payload("delta", catch_up, last_seen_id)
 
             while True:
                 if await request.is_disconnected():
                     break
 
-                delta_rows = read_fault_rows_since_id(
-                    after_id=last_seen_id,
-                    limit=limit,
-                    serial_number=serial_number,
-                )
+                if sub.overflowed or not mqtt_listener_control.MQTT_CONNECTED:
+                    sub.overflowed = False
+                    while not sub.queue.empty():
+                        sub.queue.get_nowait()
+                    delta_rows = read_fault_rows_since_id(
+                        after_id=last_seen_id,
+                        limit=limit,
+                        serial_number=serial_number,
+                    )
+                    if not delta_rows:
+                        await asyncio.sleep(FAULT_SSE_FALLBACK_POLL_S)
+                else:
+                    try:
+                        rows = await asyncio.wait_for(sub.queue.get(), timeout=FAULT_SSE_KEEPALIVE_S)
+                    except asyncio.TimeoutError:
+                        yield ": keepalive\n\n"
+                        continue
+                    delta_rows = [
+                        row for row in rows
+                        if int(row.get("id") or 0) > last_seen_id and matches(row)
+                    ]
 
                 if delta_rows:
                     last_seen_id = max(int(row.get("id") or 0) for row in delta_rows)
+                    yield payload("delta", delta_rows, last_seen_id)
 
-                    payload = {
-                        "mode": "delta",
-                        "faults": delta_rows,
-                        "last_id": last_seen_id,
-                        "time": datetime.now(timezone.utc).isoformat(),
-                    }
+        except asyncio.CancelledError:
+            return
+        finally:
+            fault_bus.unsubscribe(sub)
+            _SSE_CLIENTS.dec("faults")
+
+    return StreamingResponse(
+        event_generator(),
+        media_type="text/event-stream",
+        headers={
+            "Cache-Control": "no-cache",
+            "Connection": "keep-alive",
+        },
+    )
 
-                    yield f"data: {json.dumps(payload)}\n\n"
 
-                await asyncio.sleep(5)
+@app.get("/api/events/sensor-data")
+async def sensor_data_events(
+    request: Request,
+    node: int = Query(1, ge=1),
+    max_hz: float = Query(default=2.0, gt=0, le=LIVE_MAX_HZ),
+    user=Depends(get_current_user),
+):
+    # SSE live sensor frames pushed from the ingest path (live_stream.py);
+    # frames arriving faster than max_hz are coalesced into one message.
+    serial = _get_plot_node_serial(node)
+
+    async def event_generator():
+        sub = live_stream.subscribe(serial, max_hz)
+        _SSE_CLIENTS.inc("sensor-data")
+        try:
+            while True:
+                if await request.is_disconnected():
+                    break
+
+                try:
+                    frames = await asyncio.wait_for(sub.next_batch(), timeout=LIVE_KEEPALIVE_S)
+                except asyncio.TimeoutError:
+                    # Keeps proxies from closing an idle stream
+                    yield ": keepalive\n\n"
+                    continue
+
+                yield (
+                    f'data: {{"mode": "frames", "node": {node}, "dropped": {sub.dropped}, '
+                    f'"frames": [{", ".join(frames)}]}}\n\n'
+                )
+                await asyncio.sleep(sub.min_interval)
 
         except asyncio.CancelledError:
             return
+        finally:
+            live_stream.unsubscribe(sub)
+            _SSE_CLIENTS.dec("sensor-data")
 
     return StreamingResponse(
         event_generator(),
@@ -1484,12 +2082,22 @@ async def fault_events(
 
 
 @app.get("/api/accel")
-def get_accel_data(
+async def get_accel_data(
+    request: Request,
     node: int = Query(1, ge=1),
-    minutes: int = Query(1, ge=1, le=PLOT_MAX_WINDOW_MINUTES),
+    minutes: int = Query(1, ge=1, le=PLOT_PYRAMID_MAX_MINUTES),
+    points: int = Query(1200, ge=PLOT_MIN_POINTS, le=PLOT_MAX_POINTS),
+    downsample: str = Query("lttb", pattern="^(lttb|minmax)$"),
     user=Depends(get_current_user),
 ):
-    pts = read_accel_points(node_id=node, minutes=minutes)
+    columnar = _wants_plot_columns(request)
+    pts = await query_executor.run_query(
+        request, user, ("accel", node, minutes, points, downsample, columnar),
+        read_accel_points, node_id=node, minutes=minutes, limit=points, method=downsample,
+        columnar=columnar,
+    )
+    if columnar:
+        return await _plot_columns_response(request, pts, "accelerometer", "g")
     return {
         "sensor": "accelerometer",
         "unit": "g",
@@ -1498,13 +2106,53 @@ def get_accel_data(
     }
 
 
+@app.get("/api/accel/overview")
+def get_accel_overview(
+    node: int = Query(1, ge=1),
+    minutes: int = Query(10, ge=1, le=60),
+    user=Depends(get_current_user),
+):
+    """
+    Per-axis min / max / mean / RMS in OVERVIEW_BUCKET_S buckets, built from
+    the summary block of each packet (see accel_summary.py); no samples are
+    read. Covers the last hour at most.
+    """
+    serial = _get_plot_node_serial(node)
+    summaries = load_accel_summaries()
+    entry = summaries.get("nodes", {}).get(serial) or {}
+
+    cutoff = (datetime.now(timezone.utc) - timedelta(minutes=minutes)).isoformat()
+    points = [p for p in entry.get("points", []) if str(p.get("ts", "")) >= cutoff]
+
+    return {
+        "sensor": "accelerometer",
+        "unit": "g",
+        "node": node,
+        "bucket_s": summaries.get("bucket_s"),
+        "updated_at": summaries.get("updated_at"),
+        "latest": entry.get("latest"),
+        "latest_ts": entry.get("latest_ts"),
+        "points": points,
+    }
+
+
 @app.get("/api/inclinometer")
-def api_inclinometer(
+async def api_inclinometer(
+    request: Request,
     node: int = Query(1, ge=1),
-    minutes: int = Query(10, ge=1, le=PLOT_MAX_WINDOW_MINUTES),
+    minutes: int = Query(10, ge=1, le=PLOT_PYRAMID_MAX_MINUTES),
+    points: int = Query(1200, ge=PLOT_MIN_POINTS, le=PLOT_MAX_POINTS),
+    downsample: str = Query("lttb", pattern="^(lttb|minmax)$"),
     user=Depends(get_current_user),
 ):
-    pts = read_inclinometer_points(node_id=node, minutes=minutes)
+    columnar = _wants_plot_columns(request)
+    pts = await query_executor.run_query(
+        request, user, ("inclin", node, minutes, points, downsample, columnar),
+        read_inclinometer_points, node_id=node, minutes=minutes, limit=points, method=downsample,
+        columnar=columnar,
+    )
+    if columnar:
+        return await _plot_columns_response(request, pts, "inclinometer", "deg")
     return {
         "sensor": "inclinometer",
         "unit": "deg",
@@ -1514,12 +2162,22 @@ def api_inclinometer(
 
 
 @app.get("/api/temperature")
-def api_temperature(
+async def api_temperature(
+    request: Request,
     node: int = Query(1, ge=1),
-    minutes: int = Query(60, ge=1, le=PLOT_MAX_WINDOW_MINUTES),
+    minutes: int = Query(60, ge=1, le=PLOT_PYRAMID_MAX_MINUTES),
+    points: int = Query(2000, ge=PLOT_MIN_POINTS, le=PLOT_MAX_POINTS),
+    downsample: str = Query("lttb", pattern="^(lttb|minmax)$"),
     user=Depends(get_current_user),
 ):
-    pts = read_temperature_points(node_id=node, minutes=minutes)
+    columnar = _wants_plot_columns(request)
+    pts = await query_executor.run_query(
+        request, user, ("temp", node, minutes, points, downsample, columnar),
+        read_temperature_points, node_id=node, minutes=minutes, limit=points, method=downsample,
+        columnar=columnar,
+    )
+    if columnar:
+        return await _plot_columns_response(request, pts, "temperature", "C")
     return {
         "sensor": "temperature",
         "unit": "C",
@@ -1528,6 +2186,57 @@ def api_temperature(
     }
 
 
+@app.get("/api/plot/window")
+async def get_plot_window(
+    request: Request,
+    node: int = Query(1, ge=1),
+    sensor: str = Query(..., pattern="^(accel|inclin|temp)$"),
+    start: float = Query(..., description="Window start, epoch seconds"),
+    end: float = Query(..., description="Window end, epoch seconds"),
+    points: int = Query(2000, ge=PLOT_MIN_POINTS, le=PLOT_WINDOW_MAX_POINTS),
+    axis: Optional[str] = Query(None, description="One axis only, e.g. x or roll"),
+    user=Depends(get_current_user),
+):
+    """
+    Columns of one sensor in [start, end) for the dashboard's WebGL plot,
+    which asks again for the visible range as it is zoomed; the layout is
+    described at read_plot_window().
+    """
+    if end <= start:
+        raise HTTPException(status_code=400, detail="end must be after start")
+    if end - start > PLOT_PYRAMID_MAX_MINUTES * 60:
+        raise HTTPException(status_code=400, detail="Window too long")
+    if axis is not None and axis not in PYRAMID_AXES[sensor]:
+        raise HTTPException(status_code=400, detail=f"Unknown {sensor} axis: {axis}")
+
+    body = await query_executor.run_query(
+        request, user, ("window", node, sensor, start, end, points, axis),
+        read_plot_window, node, sensor, start, end, points, axis,
+    )
+    return await _plot_columns_response(request, body)
+
+
+def _wants_plot_columns(request: Request) -> bool:
+    # /api/accel, /api/inclinometer and /api/temperature answer a client
+    # that accepts application/octet-stream with the /api/plot/window column
+    # layout instead of JSON points: no ISO string and dict per point to
+    # build, serialise and parse back
+    return "application/octet-stream" in request.headers.get("accept", "")
+
+
+async def _plot_columns_response(request: Request, body: bytes, sensor: Optional[str] = None,
+                                 unit: Optional[str] = None) -> Response:
+    headers = {"Cache-Control": "no-store", "Vary": "Accept, Accept-Encoding"}
+    if sensor is not None:
+        headers["X-Plot-Sensor"] = sensor
+        headers["X-Plot-Unit"] = unit
+    if len(body) >= PLOT_GZIP_MIN_BYTES and "gzip" in request.headers.get("accept-encoding", ""):
+        # Level 1: most of the gain on timestamps and NaN runs, little CPU
+        body = await asyncio.to_thread(gzip.compress, body, 1)
+        headers["Content-Encoding"] = "gzip"
+    return Response(content=body, media_type="application/octet-stream", headers=headers)
+
+
 def _get_plot_node_serial(node_id: int) -> str:
     node = get_node_by_id(node_id, timeout_seconds=300)
     if node is None:
@@ -1558,131 +2267,290 @@ def _current_hour_plot_file_path(serial: str, reference_dt: datetime) -> Path:
     return DATA_DIR / "data" / f"data_{serial}_{hour_str}.bin"
 
 
-def _min_spacing_seconds(minutes: int, target_points: int) -> float:
-    window_seconds = max(1, minutes * 60)
-    return max(0.0, window_seconds / max(1, target_points))
-
-
-
 def _plot_float_or_none(value):
     if value is None:
         return None
     return float(value)
 
 
-def read_accel_points(node_id: int, minutes: int, limit: int = 1200):
-    if not is_ssd_available():
-        return []
-
-    serial = _get_plot_node_serial(node_id)
-    start_ts, end_ts, _, _, end_dt = _plot_time_window(minutes)
-
-    file_path = _current_hour_plot_file_path(serial, end_dt)
-
-    if not file_path.exists():
-        return []
-
-    points = deque(maxlen=limit)
-    min_spacing = _min_spacing_seconds(minutes, limit)
-    last_kept_ts = None
-
-    for rec in iter_decoded_records_for_export(str(file_path)):
-        accel_samples = rec.get("accel_samples")
-        if not accel_samples:
-            continue
+def _plot_records(serial: str, file_path: Path, sensor: str, start_ts: float, end_ts: float):
+    # Live windows come from the node's tail cache; longer ones are decoded
+    # through the file's time index
+    cached = plot_tail_cache.records_since(serial, str(file_path), sensor, start_ts)
+    if cached is not None:
+        return cached
+    return iter_decoded_records_for_export(str(file_path), start_ts, end_ts)
 
-        for ts, x, y, z in accel_samples:
-            if ts < start_ts or ts >= end_ts:
-                continue
 
-            if last_kept_ts is not None and (ts - last_kept_ts) < min_spacing:
-                continue
-
-            points.append(
-                {
-                    "ts": _iso_from_epoch_seconds(ts),
-                    "x": _plot_float_or_none(x),
-                    "y": _plot_float_or_none(y),
-                    "z": _plot_float_or_none(z),
-                }
-            )
-
-            last_kept_ts = ts
-
-    return list(points)
+def _pyramid_rows(serial: str, sensor: str, start_ts: float, end_ts: float, limit: int,
+                  picks: list):
+    # (PLOT_WINDOW_BUCKETS, bucket width, rows) of mean / min / max per
+    # bucket from the node's pyramid, at the coarsest level that still gives
+    # about `limit` points; None when no level is fine enough or the pyramid
+    # holds nothing for the window
+    found = read_buckets(serial, sensor, start_ts, end_ts, (end_ts - start_ts) / max(1, limit))
+    if found is None or not found[1]:
+        return None
+    width, buckets = found
+
+    rows = []
+    prev_start = None
+    for bucket_start, aggs in buckets:
+        if prev_start is not None and bucket_start - prev_start > width:
+            # No data for a whole bucket: one empty row breaks the line
+            rows.append((prev_start + width, None, None, None))
+        picked = [aggs[axis] for axis in picks]
+        rows.append((
+            bucket_start,
+            [round(agg[3], 6) if agg else None for agg in picked],
+            [agg[1] if agg else None for agg in picked],
+            [agg[2] if agg else None for agg in picked],
+        ))
+        prev_start = bucket_start
+    return PLOT_WINDOW_BUCKETS, float(width), rows
+
+
+def _plot_points(rows, names: tuple) -> list:
+    # JSON plot points from (ts, values, mins, maxs) rows; min / max fields
+    # where the rows have them, and a None value per axis at gaps
+    points = []
+    for ts, values, mins, maxs in rows:
+        point = {"ts": _iso_from_epoch_seconds(ts)}
+        for axis, name in enumerate(names):
+            point[name] = values[axis] if values else None
+            if mins is not None:
+                point[f"{name}_min"] = mins[axis]
+                point[f"{name}_max"] = maxs[axis]
+        points.append(point)
+    return points
+
+
+def _plot_gap_start(rec: dict, sensor: str, start_ts: float, end_ts: float):
+    # Start of a GAP record for this sensor inside the window, else None
+    gap = rec.get("gap")
+    if rec.get("record_type") != "GAP" or not gap or gap.get("sensor") != sensor:
+        return None
+    ts = gap.get("start_s")
+    if ts is None or ts < start_ts or ts >= end_ts:
+        return None
+    return ts
 
 
-def read_inclinometer_points(node_id: int, minutes: int, limit: int = 1200):
+def _read_plot_rows(sensor: str, node_id: int, minutes: int, limit: int, method: str, cancel=None):
+    # (kind, bucket_s, rows) of the last `minutes`, as _pack_plot_window()
+    # takes them
     if not is_ssd_available():
-        return []
+        return PLOT_WINDOW_SAMPLES, 0.0, []
 
     serial = _get_plot_node_serial(node_id)
-    start_ts, end_ts, _, _, end_dt = _plot_time_window(minutes)
-
-    file_path = _current_hour_plot_file_path(serial, end_dt)
-
-    if not file_path.exists():
-        return []
-
-    points = deque(maxlen=limit)
-    min_spacing = _min_spacing_seconds(minutes, limit)
-    last_kept_ts = None
-
-    for rec in iter_decoded_records_for_export(str(file_path)):
-        inclin = rec.get("inclin")
-        if not inclin:
+    window = _plot_time_window(minutes)
+    start_ts, end_ts = window[0], window[1]
+    picks = list(range(len(PYRAMID_AXES[sensor])))
+    started = time.perf_counter()
+
+    pyramid = _pyramid_rows(serial, sensor, start_ts, end_ts, limit, picks)
+    if pyramid is not None:
+        _PLOT_READ_S.observe(time.perf_counter() - started, sensor, "pyramid")
+        return pyramid
+    if minutes > PLOT_MAX_WINDOW_MINUTES:
+        return PLOT_WINDOW_SAMPLES, 0.0, []
+
+    sampler = make_downsampler(method, start_ts, end_ts, limit, len(picks))
+    for ts, values in _plot_window_samples(serial, sensor, window, picks, cancel):
+        if values is None:
+            # Outage: one null point breaks the line
+            sampler.gap(ts)
+        else:
+            sampler.add(ts, tuple(values))
+    _PLOT_READ_S.observe(time.perf_counter() - started, sensor, "decode")
+
+    # LTTB keeps real samples; min / max reduces to buckets
+    if method == "minmax":
+        return PLOT_WINDOW_BUCKETS, (end_ts - start_ts) / limit, sampler.finish()
+    return PLOT_WINDOW_SAMPLES, 0.0, sampler.finish()
+
+
+def _read_plot_points(sensor: str, node_id: int, minutes: int, limit: int, method: str,
+                      columnar: bool = False, cancel=None):
+    # JSON points, or with columnar the packed /api/plot/window layout
+    kind, bucket_s, rows = _read_plot_rows(sensor, node_id, minutes, limit, method, cancel)
+    names = PYRAMID_AXES[sensor]
+    if columnar:
+        return _pack_plot_window(kind, bucket_s, rows, len(names))
+    return _plot_points(rows, names)
+
+
+def read_accel_points(node_id: int, minutes: int, limit: int = 1200, method: str = "lttb",
+                      columnar: bool = False, cancel=None):
+    return _read_plot_points("accel", node_id, minutes, limit, method, columnar, cancel)
+
+
+def read_inclinometer_points(node_id: int, minutes: int, limit: int = 1200, method: str = "lttb",
+                             columnar: bool = False, cancel=None):
+    return _read_plot_points("inclin", node_id, minutes, limit, method, columnar, cancel)
+
+
+def read_temperature_points(node_id: int, minutes: int, limit: int = 2000, method: str = "lttb",
+                            columnar: bool = False, cancel=None):
+    return _read_plot_points("temp", node_id, minutes, limit, method, columnar, cancel)
+
+
+# /api/plot/window body: typed columns instead of JSON points, as a
+# 10-minute window at 200 Hz is 120k samples per axis. Also the body of
+# /api/accel, /api/inclinometer and /api/temperature for a client that
+# accepts application/octet-stream (_wants_plot_columns()).
+#
+#   header  "<4sBBBxId4x": b"SHMW", version, kind, axes, count, bucket_s
+#   ts      float64[count], epoch seconds
+#   values  float32[count] per axis, NaN for a missing value or a gap break
+#   min/max float32[count] per axis, all minima then all maxima (kind 1 only)
+#
+# kind 0 is every stored sample (bucket_s 0); kind 1 is mean / min / max
+# buckets of bucket_s, starting at ts.
+PLOT_WINDOW_HEADER = struct.Struct("<4sBBBxId4x")
+PLOT_WINDOW_MAGIC = b"SHMW"
+PLOT_WINDOW_VERSION = 1
+PLOT_WINDOW_SAMPLES = 0
+PLOT_WINDOW_BUCKETS = 1
+
+
+def _plot_explicit_window(start_ts: float, end_ts: float) -> tuple:
+    # The _plot_time_window() tuple for a given [start, end)
+    start_dt = datetime.fromtimestamp(start_ts).astimezone()
+    end_dt = datetime.fromtimestamp(end_ts).astimezone()
+    return start_ts, end_ts, start_dt.isoformat(), end_dt.isoformat(), end_dt
+
+
+def _plot_active_samples(serial: str, file_path: Path, sensor: str, start_ts: float, end_ts: float,
+                         picks: list, cancel):
+    # The active hour's samples, from the node's tail cache when it has them
+    field = {"accel": "accel_samples", "inclin": "inclin"}.get(sensor)
+
+    for rec in _plot_records(serial, file_path, sensor, start_ts, end_ts):
+        query_executor.check_cancelled(cancel)
+        gap_ts = _plot_gap_start(rec, sensor, start_ts, end_ts)
+        if gap_ts is not None:
+            yield gap_ts, None
             continue
 
-        inclin_samples = inclin if isinstance(inclin, list) else [inclin]
+        if field is None:
+            samples = (rec["temp"],) if rec.get("temp") else ()
+        else:
+            samples = rec.get(field) or ()
 
-        for ts, roll, pitch, yaw in inclin_samples:
+        for sample in samples:
+            ts = sample[0]
             if ts < start_ts or ts >= end_ts:
                 continue
+            yield ts, [_plot_float_or_none(sample[1 + axis]) for axis in picks]
+
+
+def _plot_decoded_samples(decoded: dict, picks: list):
+    # A plot_decode.decode_window() result as samples, gap starts merged in
+    ts_column = decoded["ts"]
+    columns = [decoded["values"][axis] for axis in picks]
+    gaps = decoded["gaps"]
+    gap_index = 0
+
+    for i, ts in enumerate(ts_column):
+        while gap_index < len(gaps) and gaps[gap_index] <= ts:
+            yield gaps[gap_index], None
+            gap_index += 1
+        values = [column[i] for column in columns]
+        yield ts, [None if v != v else v for v in values]
+    for gap_ts in gaps[gap_index:]:
+        yield gap_ts, None
+
+
+def _plot_window_samples(serial: str, sensor: str, window: tuple, picks: list, cancel=None):
+    # (ts, [value or None per picked axis]) of every stored sample in the
+    # window, oldest first; (ts, None) at the start of an outage. Completed
+    # hourly files are decoded in query_executor's decode processes, all of
+    # them started up front; the active hour comes from the tail cache.
+    start_ts, end_ts, start_iso, end_iso, end_dt = window
+    active = _current_hour_plot_file_path(serial, end_dt)
+    files = find_sensor_files_for_serial(serial, start_iso, end_iso)
+    decodes = [
+        None if file_path == active
+        else query_executor.submit_decode(str(file_path), sensor, start_ts, end_ts)
+        for file_path in files
+    ]
 
-            if last_kept_ts is not None and (ts - last_kept_ts) < min_spacing:
-                continue
-
-            points.append(
-                {
-                    "ts": _iso_from_epoch_seconds(ts),
-                    "roll": _plot_float_or_none(roll),
-                    "pitch": _plot_float_or_none(pitch),
-                    "yaw": _plot_float_or_none(yaw),
-                }
-            )
-            last_kept_ts = ts
-
-    return list(points)
-
-
-def read_temperature_points(node_id: int, minutes: int, limit: int = 2000):
+    try:
+        for file_path, future in zip(files, decodes):
+            query_executor.check_cancelled(cancel)
+            if file_path == active:
+                hour_start = end_dt.replace(minute=0, second=0, microsecond=0).timestamp()
+                yield from _plot_active_samples(
+                    serial, file_path, sensor, max(start_ts, hour_start), end_ts, picks, cancel
+                )
+            else:
+                decoded = query_executor.decoded(future, str(file_path), sensor, start_ts, end_ts)
+                yield from _plot_decoded_samples(decoded, picks)
+    finally:
+        for future in decodes:
+            if future is not None:
+                future.cancel()
+
+
+def _pack_plot_window(kind: int, bucket_s: float, rows, axes: int) -> bytes:
+    # rows: (ts, values, mins, maxs) as the downsamplers return them, read
+    # once (a generator for sample windows)
+    ts = array("d")
+    columns = [array("f") for _ in range(axes * (3 if kind == PLOT_WINDOW_BUCKETS else 1))]
+    nan_row = [None] * axes
+
+    for row_ts, values, mins, maxs in rows:
+        ts.append(row_ts)
+        parts = (values, mins, maxs) if kind == PLOT_WINDOW_BUCKETS else (values,)
+        for part_index, part in enumerate(parts):
+            for axis, v in enumerate(part or nan_row):
+                columns[part_index * axes + axis].append(math.nan if v is None else v)
+
+    if sys.byteorder != "little":
+        ts.byteswap()
+        for column in columns:
+            column.byteswap()
+    header = PLOT_WINDOW_HEADER.pack(PLOT_WINDOW_MAGIC, PLOT_WINDOW_VERSION, kind, axes,
+                                     len(ts), bucket_s)
+    return b"".join([header, ts.tobytes()] + [column.tobytes() for column in columns])
+
+
+def read_plot_window(node_id: int, sensor: str, start_ts: float, end_ts: float,
+                     points: int, axis: Optional[str] = None, cancel=None) -> bytes:
+    """
+    One sensor's data in [start_ts, end_ts) at about `points` points or finer:
+    pyramid buckets when a level fits the spacing, every sample when the
+    window is at most PLOT_WINDOW_RAW_MAX_S, else min / max buckets reduced
+    from the samples (windows up to PLOT_MAX_WINDOW_MINUTES).
+    """
+    names = PYRAMID_AXES[sensor]
+    picks = [names.index(axis)] if axis else list(range(len(names)))
+    empty = _pack_plot_window(PLOT_WINDOW_SAMPLES, 0.0, [], len(picks))
     if not is_ssd_available():
-        return []
+        return empty
 
     serial = _get_plot_node_serial(node_id)
-    start_ts, end_ts, _, _, end_dt = _plot_time_window(minutes)
+    span = end_ts - start_ts
 
-    file_path = _current_hour_plot_file_path(serial, end_dt)
+    pyramid = _pyramid_rows(serial, sensor, start_ts, end_ts, points, picks)
+    if pyramid is not None:
+        return _pack_plot_window(*pyramid, len(picks))
 
-    if not file_path.exists():
-        return []
+    if span > PLOT_MAX_WINDOW_MINUTES * 60:
+        return empty
 
-    points = deque(maxlen=limit)
+    window = _plot_explicit_window(start_ts, end_ts)
+    samples = _plot_window_samples(serial, sensor, window, picks, cancel)
 
-    for rec in iter_decoded_records_for_export(str(file_path)):
-        temp = rec.get("temp")
-        if not temp:
-            continue
-
-        ts, value = temp
-        if ts < start_ts or ts >= end_ts:
-            continue
-
-        points.append(
-            {
-                "ts": _iso_from_epoch_seconds(ts),
-                "value": _plot_float_or_none(value),
-            }
-        )
+    if span <= PLOT_WINDOW_RAW_MAX_S:
+        rows = ((ts, values, None, None) for ts, values in samples)
+        return _pack_plot_window(PLOT_WINDOW_SAMPLES, 0.0, rows, len(picks))
 
-    return list(points)
+    sampler = make_downsampler("minmax", start_ts, end_ts, points, len(picks))
+    for ts, values in samples:
+        if values is None:
+            sampler.gap(ts)
+        else:
+            sampler.add(ts, tuple(values))
+    return _pack_plot_window(PLOT_WINDOW_BUCKETS, span / points, sampler.finish(), len(picks))
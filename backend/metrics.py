@@ -0,0 +1,310 @@
+import bisect
+import json
+import math
+import os
+import threading
+import time
+from datetime import datetime, timezone
+from pathlib import Path
+
+from listener_snapshots import latest_updated_at, read_all, writer_path
+
+# Process-local metrics for the ingest and query hot paths: counters,
+# gauges and histograms, cheap enough to update per message (a dict lookup,
+# a bisect and a short lock).
+#
+# Modules declare theirs at import time:
+#
+#   _ENCODE_S = metrics.histogram("shm_storage_encode_seconds", "...", ("record",))
+#   ...
+#   _ENCODE_S.observe(elapsed_s, "delta")
+#
+# Label values are passed positionally in the order of the declared labels.
+# A gauge may instead be given fn, called when the metrics are read (queue
+# depths and client counts the module already tracks).
+#
+# The data listener runs in its own processes: each writes its metrics to
+# LISTENER_METRICS_JSON (one file per partition, see listener_snapshots.py)
+# every SNAPSHOT_INTERVAL_S. The backend serves its own metrics and those
+# files at /metrics in the Prometheus text format (every series labelled
+# with process and, for a listener, partition) and summed over series and
+# processes at /api/metrics/summary for the dashboard.
+LISTENER_METRICS_JSON = Path("/home/pi/listener_metrics.json")
+_WRITE_PATH = writer_path(LISTENER_METRICS_JSON)
+SNAPSHOT_INTERVAL_S = 10.0
+# This listener process's partition index ("index/count", see
+# listener_snapshots.py)
+_PARTITION = os.getenv("SHM_INGEST_PARTITION", "0/1").partition("/")[0]
+
+# Seconds; the last bucket (+Inf) counts everything above
+DEFAULT_BUCKETS_S = (0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+                     0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0)
+
+_REGISTRY: dict = {}
+_REGISTRY_LOCK = threading.Lock()
+_snapshot_thread = None
+
+
+def _now_iso() -> str:
+    return datetime.now(timezone.utc).isoformat()
+
+
+class _Metric:
+    kind = ""
+
+    def __init__(self, name: str, help_text: str, labels: tuple):
+        self.name = name
+        self.help = help_text
+        self.labels = tuple(labels)
+        self._lock = threading.Lock()
+        self._series: dict = {}     # label values -> value
+
+    def _values(self) -> list:
+        with self._lock:
+            return [[list(key), value] for key, value in self._series.items()]
+
+    def dump(self) -> dict:
+        return {"name": self.name, "kind": self.kind, "help": self.help,
+                "labels": list(self.labels), "series": self._values()}
+
+
+class Counter(_Metric):
+    kind = "counter"
+
+    def inc(self, *label_values: str, by: float = 1) -> None:
+        with self._lock:
+            self._series[label_values] = self._series.get(label_values, 0) + by
+
+
+class Gauge(_Metric):
+    kind = "gauge"
+
+    def __init__(self, name: str, help_text: str, labels: tuple, fn=None):
+        super().__init__(name, help_text, labels)
+        # fn() -> value, or {label values tuple: value} for a labelled gauge
+        self.fn = fn
+
+    def set(self, value: float, *label_values: str) -> None:
+        with self._lock:
+            self._series[label_values] = value
+
+    def inc(self, *label_values: str, by: float = 1) -> None:
+        with self._lock:
+            self._series[label_values] = self._series.get(label_values, 0) + by
+
+    def dec(self, *label_values: str, by: float = 1) -> None:
+        self.inc(*label_values, by=-by)
+
+    def _values(self) -> list:
+        if self.fn is None:
+            return super()._values()
+        try:
+            value = self.fn()
+        except Exception as e:
+            print(f"[metrics] {self.name}: {e}")
+            return []
+        if isinstance(value, dict):
+            return [[list(key), v] for key, v in value.items()]
+        return [[[], value]]
+
+
+class Histogram(_Metric):
+    kind = "histogram"
+
+    def __init__(self, name: str, help_text: str, labels: tuple, buckets: tuple = DEFAULT_BUCKETS_S):
+        super().__init__(name, help_text, labels)
+        self.buckets = tuple(buckets)
+
+    def observe(self, value: float, *label_values: str) -> None:
+        if not math.isfinite(value):
+            return
+        # Prometheus buckets are upper bounds: value <= le
+        i = bisect.bisect_left(self.buckets, value)
+        with self._lock:
+            series = self._series.get(label_values)
+            if series is None:
+                series = self._series[label_values] = {
+                    "counts": [0] * (len(self.buckets) + 1), "sum": 0.0, "count": 0}
+            series["counts"][i] += 1
+            series["sum"] += value
+            series["count"] += 1
+
+    def _values(self) -> list:
+        with self._lock:
+            return [[list(key), {"counts": list(s["counts"]), "sum": s["sum"], "count": s["count"]}]
+                    for key, s in self._series.items()]
+
+    def dump(self) -> dict:
+        return {**super().dump(), "buckets": list(self.buckets)}
+
+
+def _register(cls, name: str, *args, **kwargs):
+    with _REGISTRY_LOCK:
+        metric = _REGISTRY.get(name)
+        if metric is None:
+            metric = _REGISTRY[name] = cls(name, *args, **kwargs)
+        elif not isinstance(metric, cls):
+            raise ValueError(f"metric {name} already registered as a {metric.kind}")
+        return metric
+
+
+def counter(name: str, help_text: str, labels: tuple = ()) -> Counter:
+    return _register(Counter, name, help_text, labels)
+
+
+def gauge(name: str, help_text: str, labels: tuple = (), fn=None) -> Gauge:
+    return _register(Gauge, name, help_text, labels, fn=fn)
+
+
+def histogram(name: str, help_text: str, labels: tuple = (), buckets: tuple = DEFAULT_BUCKETS_S) -> Histogram:
+    return _register(Histogram, name, help_text, labels, buckets=buckets)
+
+
+def snapshot() -> dict:
+    with _REGISTRY_LOCK:
+        registered = list(_REGISTRY.values())
+    return {"updated_at": _now_iso(), "partition": _PARTITION,
+            "metrics": [m.dump() for m in registered]}
+
+
+# -------------------------------------------------------------------
+# Data listener side
+# -------------------------------------------------------------------
+
+def _write_snapshots() -> None:
+    while True:
+        time.sleep(SNAPSHOT_INTERVAL_S)
+        try:
+            _WRITE_PATH.parent.mkdir(parents=True, exist_ok=True)
+            tmp_path = _WRITE_PATH.with_suffix(".tmp")
+            tmp_path.write_text(json.dumps(snapshot(), separators=(",", ":")), encoding="utf-8")
+            tmp_path.replace(_WRITE_PATH)
+        except OSError as e:
+            print(f"[metrics] Failed to write {_WRITE_PATH}: {e}")
+
+
+def start_snapshot_writer() -> threading.Thread:
+    """Write this process's metrics for the backend every SNAPSHOT_INTERVAL_S
+    (data listener)."""
+    global _snapshot_thread
+    if _snapshot_thread is None:
+        _snapshot_thread = threading.Thread(target=_write_snapshots, daemon=True, name="metrics-snapshot")
+        _snapshot_thread.start()
+    return _snapshot_thread
+
+
+# -------------------------------------------------------------------
+# Backend side
+# -------------------------------------------------------------------
+
+def _sources() -> list:
+    # (extra labels, snapshot) of the backend and every listener process
+    sources = [({"process": "backend"}, snapshot())]
+    for snap in read_all(LISTENER_METRICS_JSON):
+        sources.append(({"process": "listener", "partition": snap.get("partition", "0")}, snap))
+    return sources
+
+
+def _escape(value) -> str:
+    return str(value).replace("\\", "\\\\").replace("\n", "\\n").replace('"', '\\"')
+
+
+def _labels_text(pairs: list) -> str:
+    if not pairs:
+        return ""
+    return "{" + ",".join(f'{name}="{_escape(value)}"' for name, value in pairs) + "}"
+
+
+def _number(value) -> str:
+    if value is None:
+        return "NaN"
+    if isinstance(value, float):
+        if math.isinf(value):
+            return "+Inf" if value > 0 else "-Inf"
+        return repr(value)
+    return str(value)
+
+
+def exposition() -> str:
+    """All metrics in the Prometheus text exposition format (0.0.4)."""
+    families: dict = {}
+    for extra, snap in _sources():
+        for metric in snap.get("metrics") or []:
+            family = families.setdefault(metric["name"], {"metric": metric, "series": []})
+            base = list(extra.items())
+            for values, value in metric.get("series") or []:
+                family["series"].append((base + list(zip(metric["labels"], values)), value))
+
+    lines = []
+    for name, family in families.items():
+        metric = family["metric"]
+        if not family["series"]:
+            continue
+        lines.append(f"# HELP {name} {metric['help']}")
+        lines.append(f"# TYPE {name} {metric['kind']}")
+        for labels, value in family["series"]:
+            if metric["kind"] != "histogram":
+                lines.append(f"{name}{_labels_text(labels)} {_number(value)}")
+                continue
+            cumulative = 0
+            for le, count in zip([*metric["buckets"], math.inf], value["counts"]):
+                cumulative += count
+                lines.append(f"{name}_bucket{_labels_text(labels + [('le', _number(float(le)))])} {cumulative}")
+            lines.append(f"{name}_sum{_labels_text(labels)} {_number(value['sum'])}")
+            lines.append(f"{name}_count{_labels_text(labels)} {value['count']}")
+    return "\n".join(lines) + "\n"
+
+
+def _quantile(buckets: list, counts: list, total: int, q: float):
+    # Upper bound of the bucket holding the q-quantile (None = above the last)
+    rank = q * total
+    seen = 0
+    for i, c in enumerate(counts):
+        seen += c
+        if seen >= rank:
+            return buckets[i] if i < len(buckets) else None
+    return None
+
+
+def summary() -> dict:
+    """Every metric summed over its series and the processes: value for
+    counters and gauges; count, mean, p50 and p95 for histograms.
+    updated_at is the data listener's latest snapshot."""
+    merged: dict = {}
+    listener_snaps = []
+    for extra, snap in _sources():
+        if extra["process"] == "listener":
+            listener_snaps.append(snap)
+        for metric in snap.get("metrics") or []:
+            entry = merged.get(metric["name"])
+            if entry is None:
+                entry = merged[metric["name"]] = {
+                    "name": metric["name"], "kind": metric["kind"], "help": metric["help"],
+                    "series": 0, "value": 0, "counts": None, "sum": 0.0, "count": 0,
+                    "buckets": metric.get("buckets"),
+                }
+            for _values, value in metric.get("series") or []:
+                entry["series"] += 1
+                if metric["kind"] != "histogram":
+                    entry["value"] += value or 0
+                elif metric.get("buckets") == entry["buckets"]:
+                    counts = entry["counts"] or [0] * len(value["counts"])
+                    entry["counts"] = [a + b for a, b in zip(counts, value["counts"])]
+                    entry["sum"] += value["sum"]
+                    entry["count"] += value["count"]
+
+    out = []
+    for entry in merged.values():
+        item = {k: entry[k] for k in ("name", "kind", "help", "series")}
+        if entry["kind"] == "histogram":
+            n = entry["count"]
+            item.update(
+                count=n,
+                mean=entry["sum"] / n if n else None,
+                p50=_quantile(entry["buckets"], entry["counts"], n, 0.50) if n else None,
+                p95=_quantile(entry["buckets"], entry["counts"], n, 0.95) if n else None,
+            )
+        else:
+            item["value"] = entry["value"]
+        out.append(item)
+    return {"updated_at": latest_updated_at(listener_snaps), "metrics": out}
@@ -0,0 +1,141 @@
+import json
+import os
+import sqlite3
+from datetime import datetime, timezone
+from pathlib import Path
+from typing import Any
+
+METRICS_DB_PATH = Path("/mnt/ssd/metrics/metrics.db")
+SSD_ROOT = Path("/mnt/ssd")
+
+# Scalar columns filled from the node metrics message (firmware metrics.h).
+# Each entry is (column, path into the JSON payload).
+METRIC_COLUMNS = (
+    ("uptime_s", ("up",)),
+    ("state", ("state",)),
+    ("heap_free", ("heap",)),
+    ("heap_min", ("heap_min",)),
+    ("heap_largest_block", ("heap_big",)),
+    ("eth_up", ("eth",)),
+    ("mqtt_up", ("mqtt",)),
+    ("outbox_bytes", ("outbox",)),
+    ("flow_level", ("flow",)),
+    ("adxl_pending", ("ring", "adxl", 0)),
+    ("adxl_high_water", ("ring", "adxl", 1)),
+    ("scl_pending", ("ring", "scl", 0)),
+    ("scl_high_water", ("ring", "scl", 1)),
+    ("adt_pending", ("ring", "adt", 0)),
+    ("adt_high_water", ("ring", "adt", 1)),
+    ("adxl_overflow", ("ovf", "adxl")),
+    ("scl_overflow", ("ovf", "scl")),
+    ("fifo_full", ("ovf", "fifo_full")),
+    ("acq_dropped", ("ovf", "acq_drop")),
+    ("packets_sent", ("pub", "pkts")),
+    ("samples_sent", ("pub", "samples")),
+    ("samples_dropped", ("pub", "drop")),
+    ("publish_failed", ("pub", "fail")),
+    ("slot_full_drops", ("pub", "slot_full")),
+    ("store_forward_pending", ("pub", "sf_pending")),
+    ("publish_lat_avg_us", ("pub", "lat_us", 0)),
+    ("publish_lat_max_us", ("pub", "lat_us", 1)),
+    ("e2e_lat_avg_us", ("pub", "e2e_us", 0)),
+    ("e2e_lat_max_us", ("pub", "e2e_us", 1)),
+    ("adxl_spi_hz", ("spi_hz", 0)),
+    ("scl_spi_hz", ("spi_hz", 1)),
+    ("cpu0_load_x10", ("cpu", 0)),
+    ("cpu1_load_x10", ("cpu", 1)),
+)
+
+_TEXT_COLUMNS = {"state", "flow_level"}
+
+
+def _ensure_metrics_table(conn: sqlite3.Connection) -> None:
+    # One row per metrics message; counters are cumulative since node boot.
+    columns = ",\n            ".join(
+        f"{name} {'TEXT' if name in _TEXT_COLUMNS else 'INTEGER'}"
+        for name, _ in METRIC_COLUMNS
+    )
+    conn.execute(
+        f"""
+        CREATE TABLE IF NOT EXISTS node_metrics (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            serial_number TEXT,
+            ts TEXT,
+            received_at TEXT,
+            {columns},
+            tasks_json TEXT
+        )
+        """
+    )
+    conn.execute(
+        "CREATE INDEX IF NOT EXISTS idx_node_metrics_serial_ts "
+        "ON node_metrics (serial_number, ts)"
+    )
+
+
+def _ensure_metrics_columns(conn: sqlite3.Connection) -> None:
+    # Add columns introduced after the table was first created.
+    cur = conn.execute("PRAGMA table_info(node_metrics)")
+    existing = {str(row[1]) for row in cur.fetchall()}
+    for name, _ in METRIC_COLUMNS:
+        if name not in existing:
+            col_type = "TEXT" if name in _TEXT_COLUMNS else "INTEGER"
+            conn.execute(f"ALTER TABLE node_metrics ADD COLUMN {name} {col_type}")
+
+
+def _lookup(data: Any, path: tuple) -> Any:
+    # Walk dict keys / list indices; missing fields become NULL.
+    for key in path:
+        try:
+            data = data[key]
+        except (KeyError, IndexError, TypeError):
+            return None
+    return data
+
+
+def log_node_metrics(serial_number: str, payload_bytes: bytes) -> None:
+    """Store one wind_turbine/<serial>/metrics message."""
+    # Skip metrics logging if the SSD is not mounted.
+    if not SSD_ROOT.exists() or not os.path.ismount(SSD_ROOT):
+        return
+
+    try:
+        data = json.loads(payload_bytes.decode())
+    except Exception as e:
+        print(f"[metrics_logger] Invalid metrics payload from {serial_number}: {e}")
+        return
+
+    METRICS_DB_PATH.parent.mkdir(parents=True, exist_ok=True)
+
+    received_at = datetime.now(timezone.utc).isoformat()
+    names = [name for name, _ in METRIC_COLUMNS]
+    values = [_lookup(data, path) for _, path in METRIC_COLUMNS]
+    tasks = data.get("tasks")
+
+    conn = None
+    try:
+        conn = sqlite3.connect(METRICS_DB_PATH)
+        _ensure_metrics_table(conn)
+        _ensure_metrics_columns(conn)
+        placeholders = ",".join("?" for _ in range(len(names) + 4))
+        conn.execute(
+            f"""
+            INSERT INTO node_metrics (
+                serial_number, ts, received_at, {", ".join(names)}, tasks_json
+            )
+            VALUES ({placeholders})
+            """,
+            (
+                serial_number,
+                data.get("ts") or received_at,
+                received_at,
+                *values,
+                json.dumps(tasks, separators=(",", ":")) if tasks is not None else None,
+            ),
+        )
+        conn.commit()
+    except Exception as e:
+        print(f"[metrics_logger] Failed to write metrics for {serial_number}: {e}")
+    finally:
+        if conn is not None:
+            conn.close()
@@ -1,11 +1,27 @@
 # Publish Pi-side MQTT commands for node configuration and control.
 import json
+import os
+import threading
+import time
 
-import paho.mqtt.publish as mqtt_publish
+import paho.mqtt.client as mqtt
 
 BROKER_HOST = "localhost"
 BROKER_PORT = 1883
 MQTT_QOS = 1
+STATUS_TOPIC = "wind_turbine/+/status"
+
+# How long a command waits for every target's ack on the status topic.
+ACK_TIMEOUT_S = float(os.getenv("SHM_CMD_ACK_TIMEOUT_S", "5"))
+
+# Commands go out on one long-lived client instead of a connect/publish/
+# disconnect per command (paho publish.single()). Every command carries a
+# "seq"; the node echoes it as "seq_ack" in the status message that answers
+# it (mqtt_publish_status_json() in the firmware), with "error" set when it
+# refused. The client subscribes to the status topic itself and matches
+# those acks to the pending command, so a fan-out to N nodes is N publishes
+# on the open session followed by one wait for all acks, and every node
+# gets a result: "acked", "rejected" (the node's error) or "timeout".
 
 
 # Build the accelerometer configure topic for a node serial.
@@ -18,52 +34,306 @@ def control_topic(serial: str) -> str:
     return f"wind_turbine/{serial}/cmd/control"
 
 
-# Publish an accelerometer configuration command to the target node.
-# seq/ack support is intentionally disabled for now.
-def publish_accelerometer_config(
-    serial: str,
+# Every node also subscribes to this control topic.
+BROADCAST_CONTROL_TOPIC = "wind_turbine/all/cmd/control"
+
+
+class _Command:
+    """One seq in flight and the targets still owing an ack."""
+
+    def __init__(self, seq: int, cmd: str, targets: list[str], broadcast: bool):
+        self.seq = seq
+        self.cmd = cmd
+        self.broadcast = broadcast
+        self.sent_at = time.monotonic()
+        self.results: dict[str, dict] = {}
+        self.waiting = set(targets)
+        self.done = threading.Event()
+        if not self.waiting:
+            self.done.set()
+
+    # Status-topic ack from one node. MQTT client thread, under the lock.
+    def note_ack(self, serial: str, status: dict) -> None:
+        if serial in self.results:
+            # start_at acks twice (armed, then started): the first one counts
+            return
+        if serial not in self.waiting and not self.broadcast:
+            return
+        error = status.get("error")
+        self.results[serial] = {
+            "serial": serial,
+            "status": "rejected" if error else "acked",
+            "latency_ms": round((time.monotonic() - self.sent_at) * 1000.0, 1),
+            "state": status.get("state"),
+            "cmd_ack": status.get("cmd_ack"),
+            "selftest_ok": status.get("selftest_ok"),
+            "error": error,
+        }
+        self.waiting.discard(serial)
+        if not self.waiting:
+            self.done.set()
+
+    def summary(self) -> dict:
+        nodes = list(self.results.values())
+        nodes += [
+            {"serial": serial, "status": "timeout", "latency_ms": None, "error": "no ack"}
+            for serial in sorted(self.waiting)
+        ]
+        latencies = sorted(n["latency_ms"] for n in nodes if n["latency_ms"] is not None)
+        counts = {"acked": 0, "rejected": 0, "timeout": 0}
+        for node in nodes:
+            counts[node["status"]] += 1
+
+        return {
+            "seq": self.seq,
+            "cmd": self.cmd,
+            "targets": len(nodes),
+            **counts,
+            "ok": counts["acked"] == len(nodes),
+            "elapsed_ms": round((time.monotonic() - self.sent_at) * 1000.0, 1),
+            "latency_ms": {
+                "median": latencies[len(latencies) // 2] if latencies else None,
+                "max": latencies[-1] if latencies else None,
+            },
+            "nodes": sorted(nodes, key=lambda n: n["serial"]),
+        }
+
+
+class CommandClient:
+    """Long-lived MQTT session for node commands and their acks."""
+
+    def __init__(self, host: str, port: int):
+        self._host = host
+        self._port = port
+        self._client = None
+        self._connected = False
+        self._lock = threading.Lock()
+        self._pending: dict[int, _Command] = {}
+        # Restarts pick a new range, so a late ack to the previous process's
+        # command does not match a new one. The firmware reads seq as int32.
+        self._seq = (int(time.time()) % 1_000_000) * 1000
+
+    @property
+    def connected(self) -> bool:
+        return self._connected
+
+    def start(self) -> None:
+        if self._client is not None:
+            return
+        client = mqtt.Client()
+        client.on_connect = self._on_connect
+        client.on_disconnect = self._on_disconnect
+        client.on_message = self._on_message
+        # connect_async + loop_start: reconnects on its own, and a broker that
+        # is down at startup does not stop the backend from coming up
+        client.connect_async(self._host, self._port, 60)
+        client.loop_start()
+        self._client = client
+
+    def stop(self) -> None:
+        client, self._client = self._client, None
+        if client is None:
+            return
+        client.loop_stop()
+        client.disconnect()
+        self._connected = False
+
+    def _on_connect(self, client, userdata, flags, rc):
+        self._connected = rc == 0
+        if rc == 0:
+            print("[cmd] Connected")
+            client.subscribe(STATUS_TOPIC, qos=MQTT_QOS)
+        else:
+            print(f"[cmd] Connection failed: {rc}")
+
+    def _on_disconnect(self, client, userdata, rc):
+        self._connected = False
+        print(f"[cmd] Disconnected: rc={rc}")
+
+    def _on_message(self, client, userdata, msg):
+        if not self._pending:
+            return
+        parts = msg.topic.split("/")
+        if len(parts) < 3:
+            return
+        try:
+            status = json.loads(msg.payload)
+            seq_ack = int(status.get("seq_ack") or 0)
+        except (ValueError, TypeError, AttributeError):
+            return
+        if seq_ack <= 0:
+            # Periodic status, not an answer to a command
+            return
+        with self._lock:
+            command = self._pending.get(seq_ack)
+            if command is not None:
+                command.note_ack(parts[1], status)
+
+    def _next_seq(self) -> int:
+        with self._lock:
+            self._seq = self._seq % 2_000_000_000 + 1
+            return self._seq
+
+    def send(
+        self,
+        cmd: str,
+        payload: dict,
+        serials: list[str],
+        topic_for=None,
+        broadcast_topic: str | None = None,
+        timeout_s: float = ACK_TIMEOUT_S,
+    ) -> dict:
+        """Publish payload (plus a fresh seq) and wait for the acks.
+
+        With topic_for, one publish per serial on topic_for(serial). With
+        broadcast_topic, a single publish there; serials are the nodes
+        expected to answer, and acks from others are reported as well.
+        Raises ConnectionError when the broker session is down.
+        """
+        client = self._client
+        if client is None or not self._connected:
+            raise ConnectionError("MQTT command client is not connected")
+
+        seq = self._next_seq()
+        body = json.dumps(
+            {**payload, "seq": seq},
+            # Compact separators keep the command payload small.
+            separators=(",", ":"),
+        )
+        targets = list(dict.fromkeys(serials))
+        command = _Command(seq, cmd, targets, broadcast_topic is not None)
+        with self._lock:
+            self._pending[seq] = command
+
+        try:
+            if broadcast_topic is not None:
+                topics = [broadcast_topic]
+            else:
+                topics = [topic_for(serial) for serial in targets]
+            for topic in topics:
+                info = client.publish(topic, body, qos=MQTT_QOS, retain=False)
+                if info.rc != mqtt.MQTT_ERR_SUCCESS:
+                    raise ConnectionError(f"publish to {topic} failed: rc={info.rc}")
+
+            command.done.wait(timeout_s)
+        finally:
+            with self._lock:
+                self._pending.pop(seq, None)
+                summary = command.summary()
+
+        return summary
+
+
+_CLIENT = CommandClient(BROKER_HOST, BROKER_PORT)
+
+
+def start_command_client() -> CommandClient:
+    _CLIENT.start()
+    return _CLIENT
+
+
+def stop_command_client() -> None:
+    _CLIENT.stop()
+
+
+def command_client_connected() -> bool:
+    return _CLIENT.connected
+
+
+# Build an accelerometer configuration command.
+def build_accelerometer_config(
     odr_index: int,
     range_value: int,
     hpf_corner: int,
-    # seq: int,
-) -> None:
+    payload_format: str | None = None,
+    spectrum_mode: str | None = None,
+    trigger_mode: str | None = None,
+    trigger_level: int | None = None,
+    metrics_interval_s: int | None = None,
+    flow_mode: str | None = None,
+    batch_s: int | None = None,
+    batch_max_ms: int | None = None,
+) -> dict:
     payload = {
         "odr_index": odr_index,
         "range": range_value,
         "hpf_corner": hpf_corner,
-        # "seq": seq,  # Disabled 
     }
 
-    mqtt_publish.single(
-        topic=configure_topic(serial),
-        payload=json.dumps(payload),
-        hostname=BROKER_HOST,
-        port=BROKER_PORT,
-        qos=MQTT_QOS,
-        retain=False,
-    )
+    # Optional data payload encoding: "json" (default on the node), "bin" or
+    # "packed" (lossless delta-compressed accel, about half the size of "bin").
+    if payload_format is not None:
+        payload["format"] = payload_format
+
+    # Optional on-node spectrum summaries: "off" (default), "on" or "only".
+    if spectrum_mode is not None:
+        payload["spectrum"] = spectrum_mode
+
+    # Optional raw burst capture: "off", "threshold", "rms" or "sta_lta".
+    # Level is mg for threshold/rms and the STA/LTA ratio x10 for sta_lta.
+    if trigger_mode is not None:
+        payload["trigger"] = trigger_mode
+    if trigger_level is not None:
+        payload["trigger_level"] = trigger_level
+
+    # Optional runtime-metrics topic interval in seconds, 0 turns it off.
+    if metrics_interval_s is not None:
+        payload["metrics_s"] = metrics_interval_s
+
+    # Optional adaptive publish levels on a congested link: "auto" (default) or "off".
+    if flow_mode is not None:
+        payload["flow"] = flow_mode
 
+    # Optional batching: 1 s packets per MQTT message (binary frames) and the
+    # longest a batch may hold its oldest packet in ms, 0 = batch_s + 1 s.
+    if batch_s is not None:
+        payload["batch_s"] = batch_s
+    if batch_max_ms is not None:
+        payload["batch_max_ms"] = batch_max_ms
 
-# Publish a runtime control command to the target node.
-# publish only the command and do not include seq.
-def publish_node_control(
-    serial: str,
+    return payload
+
+
+# Send one accelerometer configuration to each node and wait for the acks.
+def publish_fleet_config(serials: list[str], config: dict, timeout_s: float = ACK_TIMEOUT_S) -> dict:
+    return _CLIENT.send("configure", config, serials, topic_for=configure_topic, timeout_s=timeout_s)
+
+
+# Send a runtime control command to each node (or once on the broadcast
+# topic when broadcast is set) and wait for the acks.
+def publish_fleet_control(
+    serials: list[str],
     cmd: str,
-    # seq: int | None = None,
-) -> None:
-    payload = {
-        "cmd": cmd,
-    }
+    broadcast: bool = False,
+    timeout_s: float = ACK_TIMEOUT_S,
+) -> dict:
+    if broadcast:
+        return _CLIENT.send(
+            cmd, {"cmd": cmd}, serials,
+            broadcast_topic=BROADCAST_CONTROL_TOPIC, timeout_s=timeout_s,
+        )
+    return _CLIENT.send(cmd, {"cmd": cmd}, serials, topic_for=control_topic, timeout_s=timeout_s)
 
-    # Old Pass 2 logic kept here for later:
-    # if seq is not None:
-    #     payload["seq"] = seq
-
-    mqtt_publish.single(
-        topic=control_topic(serial),
-        payload=json.dumps(payload),
-        hostname=BROKER_HOST,
-        port=BROKER_PORT,
-        qos=MQTT_QOS,
-        retain=False,
-    )
\ No newline at end of file
+
+# Publish an accelerometer configuration command to the target node and
+# return its ack (see publish_fleet_config()).
+def publish_accelerometer_config(serial: str, odr_index: int, range_value: int, hpf_corner: int,
+                                 timeout_s: float = ACK_TIMEOUT_S, **options) -> dict:
+    config = build_accelerometer_config(odr_index, range_value, hpf_corner, **options)
+    return publish_fleet_config([serial], config, timeout_s=timeout_s)
+
+
+# Publish a runtime control command to the target node and return its ack.
+def publish_node_control(serial: str, cmd: str, timeout_s: float = ACK_TIMEOUT_S) -> dict:
+    return publish_fleet_control([serial], cmd, timeout_s=timeout_s)
+
+
+# Schedule every configured node to start recording at the same UTC instant.
+# Nodes ack with cmd_ack "start_at" (collected here for the expected
+# serials), then report cmd_ack "start" plus the achieved offset in
+# "sync_start" when the start fires.
+def publish_fleet_start_at(epoch_us: int, serials: list[str], timeout_s: float = ACK_TIMEOUT_S) -> dict:
+    return _CLIENT.send(
+        "start_at", {"cmd": "start_at", "epoch_us": epoch_us}, serials,
+        broadcast_topic=BROADCAST_CONTROL_TOPIC, timeout_s=timeout_s,
+    )
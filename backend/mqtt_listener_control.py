@@ -3,6 +3,9 @@ from datetime import datetime, timezone
 
 import paho.mqtt.client as mqtt
 
+import fault_bus
+import fleet_status
+import live_stream
 from node_registry import get_node_by_serial, register_serial
 from settings_store import (
     ensure_node_defaults,
@@ -81,6 +84,8 @@ def on_connect(client, userdata, flags, rc):
         MQTT_CONNECTED = True
         print("[MQTT] Connected")
         client.subscribe(STATUS_TOPIC)
+        client.subscribe(live_stream.LIVE_SUBSCRIBE_TOPIC, qos=0)
+        client.subscribe(fault_bus.FAULT_BUS_TOPIC, qos=1)
     else:
         MQTT_CONNECTED = False
         print(f"[MQTT] Connection failed: {rc}")
@@ -93,6 +98,19 @@ def on_disconnect(client, userdata, rc):
 
 
 def on_message(client, userdata, msg):
+    if msg.topic.startswith("shm/live/"):
+        # Live frames from the data listener, for /api/events/sensor-data
+        # and the sensor health of /api/fleet/status
+        serial = msg.topic.split("/")[2]
+        fleet_status.note_frame(serial, msg.payload)
+        live_stream.publish(serial, msg.payload)
+        return
+
+    if msg.topic == fault_bus.FAULT_BUS_TOPIC:
+        # New fault rows from the data listener, for /api/events/faults
+        fault_bus.publish(msg.payload)
+        return
+
     payload = msg.payload.decode("utf-8", errors="ignore")
     print(f"[MQTT] {msg.topic} -> {payload}")
     handle_status(msg.topic, payload)
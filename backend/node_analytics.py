@@ -0,0 +1,489 @@
+import cmath
+import json
+import math
+import os
+import sqlite3
+import time
+from datetime import datetime
+from pathlib import Path
+from threading import Lock
+
+# Per-node health trends computed at ingest time: one row per node and
+# minute, so week- and month-long trend views read a few thousand rows
+# instead of any raw data.
+#
+#   accel    AC RMS (mean removed) and peak-to-peak per axis, in g
+#   inclin   mean roll / pitch / yaw; the endpoint adds the drift from the
+#            first minute of the range
+#   temp     mean temperature
+#   dom_hz   dominant vibration frequency and its PSD (g^2/Hz)
+#
+# The encoder shard workers fold every stored packet in, next to the plot
+# pyramid (plot_pyramid.py): accel from the packet's summary block when the
+# node sent one (accel_summary.packet_summary()), else from the samples.
+# A whole packet counts toward the minute of its first sample.
+#
+# The dominant frequency comes from the node's spectrum summaries
+# (firmware spectrum.h, wind_turbine/<serial>/spectrum) when it publishes
+# them: the strongest peak over the three axes. Otherwise the shard worker
+# keeps the last ANALYTICS_FFT_SAMPLES contiguous accel samples and, once
+# per ANALYTICS_FFT_INTERVAL_S of sample time, runs a Hann-windowed Welch
+# average of ANALYTICS_FFT_LEN-point FFTs over them, as the firmware does.
+#
+# Rows hold sums, not results, and are upserted every ANALYTICS_FLUSH_S
+# into one SQLite file per node under ANALYTICS_DIR:
+#
+#   minutes(start_s, accel_n, accel_sum_x.., accel_sq_x.., accel_mn_x..,
+#           accel_mx_x.., inclin_n, inclin_sum_roll.., temp_n, temp_sum,
+#           dom_hz, dom_psd)
+#
+# so a minute flushed in two parts, or replayed later, merges into one row,
+# and read_trends() can merge minutes to any wider bucket in SQL.
+ANALYTICS_DIR = Path("/mnt/ssd/analytics")
+ANALYTICS_FLUSH_S = float(os.getenv("SHM_ANALYTICS_FLUSH_S", "30"))
+ANALYTICS_RETENTION_S = 400 * 86400
+ANALYTICS_FFT_LEN = 512
+ANALYTICS_FFT_SAMPLES = 2 * ANALYTICS_FFT_LEN
+ANALYTICS_FFT_INTERVAL_S = float(os.getenv("SHM_ANALYTICS_FFT_S", "60"))
+ANALYTICS_MIN_HZ = 0.2          # below this is drift, not vibration
+_PRUNE_INTERVAL_S = 3600.0
+
+_ACCEL_AXES = ("x", "y", "z")
+_INCLIN_AXES = ("roll", "pitch", "yaw")
+
+_SUM_COLUMNS = (
+    ["accel_n"]
+    + [f"accel_sum_{a}" for a in _ACCEL_AXES]
+    + [f"accel_sq_{a}" for a in _ACCEL_AXES]
+    + ["inclin_n"]
+    + [f"inclin_sum_{a}" for a in _INCLIN_AXES]
+    + ["temp_n", "temp_sum"]
+)
+_MIN_COLUMNS = [f"accel_mn_{a}" for a in _ACCEL_AXES]
+_MAX_COLUMNS = [f"accel_mx_{a}" for a in _ACCEL_AXES]
+_COLUMNS = _SUM_COLUMNS + _MIN_COLUMNS + _MAX_COLUMNS + ["dom_hz", "dom_psd"]
+
+_UPSERT_SQL = (
+    f"INSERT INTO minutes (start_s, {', '.join(_COLUMNS)}) "
+    f"VALUES ({', '.join('?' * (len(_COLUMNS) + 1))}) "
+    "ON CONFLICT (start_s) DO UPDATE SET "
+    + ", ".join(
+        [f"{c} = {c} + excluded.{c}" for c in _SUM_COLUMNS]
+        + [f"{c} = min(coalesce({c}, excluded.{c}), coalesce(excluded.{c}, {c}))" for c in _MIN_COLUMNS]
+        + [f"{c} = max(coalesce({c}, excluded.{c}), coalesce(excluded.{c}, {c}))" for c in _MAX_COLUMNS]
+        + [
+            "dom_hz = CASE WHEN coalesce(excluded.dom_psd, -1) > coalesce(dom_psd, -1) "
+            "THEN excluded.dom_hz ELSE dom_hz END",
+            "dom_psd = max(coalesce(dom_psd, excluded.dom_psd), coalesce(excluded.dom_psd, dom_psd))",
+        ]
+    )
+)
+
+
+def analytics_path(serial: str) -> Path:
+    return ANALYTICS_DIR / f"analytics_{serial}.db"
+
+
+def _ensure_analytics_table(conn: sqlite3.Connection) -> None:
+    columns = ",\n".join(
+        [f"{c} INTEGER NOT NULL" if c.endswith("_n") else f"{c} REAL NOT NULL" for c in _SUM_COLUMNS]
+        + [f"{c} REAL" for c in _MIN_COLUMNS + _MAX_COLUMNS + ["dom_hz", "dom_psd"]]
+    )
+    conn.execute(
+        f"CREATE TABLE IF NOT EXISTS minutes (start_s INTEGER PRIMARY KEY, {columns}) WITHOUT ROWID"
+    )
+
+
+# Dominant frequency
+_TWIDDLES: dict = {}
+
+
+def _fft(values: list) -> list:
+    """Iterative radix-2 FFT of a real sequence (length a power of two)."""
+    n = len(values)
+    twiddles = _TWIDDLES.get(n)
+    if twiddles is None:
+        twiddles = _TWIDDLES[n] = [cmath.exp(-2j * math.pi * k / n) for k in range(n // 2)]
+
+    out = [complex(v) for v in values]
+    j = 0
+    for i in range(1, n):
+        bit = n >> 1
+        while j & bit:
+            j ^= bit
+            bit >>= 1
+        j |= bit
+        if i < j:
+            out[i], out[j] = out[j], out[i]
+
+    size = 2
+    while size <= n:
+        half = size // 2
+        step = n // size
+        for start in range(0, n, size):
+            for k in range(half):
+                t = twiddles[k * step] * out[start + k + half]
+                out[start + k + half] = out[start + k] - t
+                out[start + k] += t
+        size *= 2
+    return out
+
+
+def dominant_frequency(columns: tuple, fs: float):
+    """(Hz, PSD) of the strongest spectral peak above ANALYTICS_MIN_HZ over
+    the axes (lists of floats in g, equally spaced at fs), from a Welch
+    average of Hann-windowed ANALYTICS_FFT_LEN segments with 50 % overlap;
+    None when there are too few samples."""
+    nfft = ANALYTICS_FFT_LEN
+    if fs <= 0 or min(len(c) for c in columns) < nfft:
+        return None
+    window = [0.5 - 0.5 * math.cos(2 * math.pi * k / nfft) for k in range(nfft)]
+    scale = 2.0 / (fs * sum(w * w for w in window))
+    first_bin = max(1, math.ceil(ANALYTICS_MIN_HZ * nfft / fs))
+
+    best = None
+    for column in columns:
+        psd = [0.0] * (nfft // 2 + 1)
+        segments = 0
+        for start in range(0, len(column) - nfft + 1, nfft // 2):
+            segment = column[start:start + nfft]
+            mean = sum(segment) / nfft
+            spectrum = _fft([(v - mean) * w for v, w in zip(segment, window)])
+            for k in range(len(psd)):
+                psd[k] += abs(spectrum[k]) ** 2
+            segments += 1
+        psd = [p * scale / segments for p in psd]
+
+        k = max(range(first_bin, len(psd) - 1), key=psd.__getitem__)
+        # Parabolic interpolation between the neighbouring bins
+        a, b, c = psd[k - 1], psd[k], psd[k + 1]
+        denom = a - 2 * b + c
+        offset = 0.5 * (a - c) / denom if denom else 0.0
+        peak = ((k + offset) * fs / nfft, b)
+        if best is None or peak[1] > best[1]:
+            best = peak
+    return best
+
+
+# Writer side
+class _Minute:
+    """Sums of one minute of a node, in _COLUMNS order."""
+
+    def __init__(self):
+        self.sums = [0.0] * len(_SUM_COLUMNS)
+        self.mn = [None] * 3
+        self.mx = [None] * 3
+        self.dom = None             # (Hz, PSD)
+
+    def add_accel(self, n: int, sums: list, squares: list, mins: list, maxs: list) -> None:
+        self.sums[0] += n
+        for a in range(3):
+            self.sums[1 + a] += sums[a]
+            self.sums[4 + a] += squares[a]
+            if self.mn[a] is None or mins[a] < self.mn[a]:
+                self.mn[a] = mins[a]
+            if self.mx[a] is None or maxs[a] > self.mx[a]:
+                self.mx[a] = maxs[a]
+
+    def add_inclin(self, n: int, sums: list) -> None:
+        self.sums[7] += n
+        for a in range(3):
+            self.sums[8 + a] += sums[a]
+
+    def add_temp(self, value: float) -> None:
+        self.sums[11] += 1
+        self.sums[12] += value
+
+    def add_dominant(self, dom: tuple) -> None:
+        if self.dom is None or dom[1] > self.dom[1]:
+            self.dom = dom
+
+    def row(self, start_s: int) -> tuple:
+        dom = self.dom or (None, None)
+        return (start_s, *self.sums, *self.mn, *self.mx, *dom)
+
+
+class _NodeAnalytics:
+    """Pending minutes, FFT samples and the SQLite connection of one node."""
+
+    def __init__(self, serial: str):
+        self.serial = serial
+        self.lock = Lock()          # shard worker and ingest worker (spectrum)
+        self.conn = None
+        self.pending: dict = {}     # minute start (s) -> _Minute
+        self.last_flush = time.monotonic()
+        self.last_prune = 0.0
+        # Contiguous accel samples for the local FFT
+        self.fft_ts: list = []
+        self.fft_axes = ([], [], [])
+        self.last_fft_s = 0.0
+        self.last_spectrum_s = 0.0
+
+    def minute(self, ts_s: float) -> _Minute:
+        start = int(ts_s // 60) * 60
+        minute = self.pending.get(start)
+        if minute is None:
+            minute = self.pending[start] = _Minute()
+        return minute
+
+    def feed_fft(self, ts_us: list, axes: tuple, scale: int) -> None:
+        if not ts_us:
+            return
+        step = (ts_us[-1] - ts_us[0]) / max(1, len(ts_us) - 1)
+        if self.fft_ts and not 0 < ts_us[0] - self.fft_ts[-1] <= 3 * max(step, 1):
+            # Outage or reordering: the FFT must not span it
+            self.fft_ts.clear()
+            for column in self.fft_axes:
+                column.clear()
+
+        for i, ts in enumerate(ts_us):
+            sample = [column[i] for column in axes]
+            if None in sample:
+                self.fft_ts.clear()
+                for column in self.fft_axes:
+                    column.clear()
+                continue
+            self.fft_ts.append(ts)
+            for column, v in zip(self.fft_axes, sample):
+                column.append(v / scale)
+        if len(self.fft_ts) > ANALYTICS_FFT_SAMPLES:
+            drop = len(self.fft_ts) - ANALYTICS_FFT_SAMPLES
+            del self.fft_ts[:drop]
+            for column in self.fft_axes:
+                del column[:drop]
+
+        last_s = self.fft_ts[-1] / 1e6 if self.fft_ts else 0.0
+        if (
+            len(self.fft_ts) < ANALYTICS_FFT_SAMPLES
+            or last_s - self.last_fft_s < ANALYTICS_FFT_INTERVAL_S
+            # The node's own spectrum summaries are finer; no need for ours
+            or last_s - self.last_spectrum_s < 2 * ANALYTICS_FFT_INTERVAL_S
+        ):
+            return
+        self.last_fft_s = last_s
+        fs = (len(self.fft_ts) - 1) * 1e6 / (self.fft_ts[-1] - self.fft_ts[0])
+        dom = dominant_frequency(self.fft_axes, fs)
+        if dom is not None:
+            self.minute(last_s).add_dominant(dom)
+
+    def _connect(self) -> sqlite3.Connection:
+        if self.conn is None:
+            ANALYTICS_DIR.mkdir(parents=True, exist_ok=True)
+            self.conn = sqlite3.connect(analytics_path(self.serial), check_same_thread=False)
+            # WAL lets the backend read while the shard worker writes
+            self.conn.execute("PRAGMA journal_mode=WAL")
+            self.conn.execute("PRAGMA synchronous=NORMAL")
+            _ensure_analytics_table(self.conn)
+        return self.conn
+
+    def flush(self, now: float) -> None:
+        self.last_flush = now
+        if not self.pending:
+            return
+        rows = [minute.row(start) for start, minute in self.pending.items()]
+        self.pending = {}
+        try:
+            conn = self._connect()
+            with conn:
+                conn.executemany(_UPSERT_SQL, rows)
+                if now - self.last_prune >= _PRUNE_INTERVAL_S:
+                    self.last_prune = now
+                    conn.execute(
+                        "DELETE FROM minutes WHERE start_s < ?",
+                        (int(time.time() - ANALYTICS_RETENTION_S),),
+                    )
+        except sqlite3.Error as e:
+            # Only the trends lose these minutes; the samples are stored
+            print(f"[analytics] Failed to update {analytics_path(self.serial)}: {e}")
+            self.close()
+
+    def maybe_flush(self) -> None:
+        now = time.monotonic()
+        if now - self.last_flush >= ANALYTICS_FLUSH_S:
+            self.flush(now)
+
+    def close(self) -> None:
+        if self.conn is not None:
+            try:
+                self.conn.close()
+            except sqlite3.Error:
+                pass
+            self.conn = None
+
+
+_NODES: dict = {}
+_NODES_LOCK = Lock()
+
+
+def _node(serial: str) -> _NodeAnalytics:
+    node = _NODES.get(serial)
+    if node is None:
+        with _NODES_LOCK:
+            node = _NODES.setdefault(serial, _NodeAnalytics(serial))
+    return node
+
+
+def _column_stats(axes: tuple, scale: int):
+    # (n, sums, squares, mins, maxs) of the samples with every axis valid
+    rows = [sample for sample in zip(*axes) if None not in sample]
+    if not rows:
+        return None
+    stats = (len(rows), [], [], [], [])
+    for column in zip(*rows):
+        values = [v / scale for v in column]
+        stats[1].append(sum(values))
+        stats[2].append(sum(v * v for v in values))
+        stats[3].append(min(values))
+        stats[4].append(max(values))
+    return stats
+
+
+def note_accel(serial: str, ts_us: list, axes: tuple, scale: int, summary=None) -> None:
+    """
+    Fold one packet's accel samples into the node's trends: the encoder's
+    int columns (µs timestamps, values x scale, None for NaN) and the
+    packet's summary block, if any. Shard worker only.
+    """
+    if not ts_us:
+        return
+    if summary is not None and summary["n"] > 0:
+        n = summary["n"]
+        stats = (
+            n,
+            [m * n for m in summary["mean"]],
+            [r * r * n for r in summary["rms"]],
+            summary["min"],
+            summary["max"],
+        )
+    else:
+        stats = _column_stats(axes, scale)
+
+    node = _node(serial)
+    with node.lock:
+        if stats is not None:
+            node.minute(ts_us[0] / 1e6).add_accel(*stats)
+        node.feed_fft(ts_us, axes, scale)
+        node.maybe_flush()
+
+
+def note_inclin(serial: str, ts_us: list, axes: tuple, scale: int) -> None:
+    """Fold one packet's inclinometer columns in. Shard worker only."""
+    stats = _column_stats(axes, scale)
+    if not ts_us or stats is None:
+        return
+    node = _node(serial)
+    with node.lock:
+        node.minute(ts_us[0] / 1e6).add_inclin(stats[0], stats[1])
+
+
+def note_temp(serial: str, ts_s: float, value: float) -> None:
+    node = _node(serial)
+    with node.lock:
+        node.minute(ts_s).add_temp(value)
+
+
+def note_spectrum(serial: str, payload: bytes) -> None:
+    """Take the dominant frequency from one spectrum summary of the node."""
+    try:
+        summary = json.loads(payload)
+        ts_s = datetime.fromisoformat(str(summary["ts"]).replace("Z", "+00:00")).timestamp()
+        peaks = [
+            (float(f), float(psd))
+            for axis in _ACCEL_AXES
+            for f, psd in (summary.get(axis) or {}).get("peaks") or []
+        ]
+    except (ValueError, TypeError, KeyError, AttributeError) as e:
+        print(f"[analytics] Bad spectrum summary from {serial}: {e}")
+        return
+    if not peaks:
+        return
+
+    node = _node(serial)
+    with node.lock:
+        node.last_spectrum_s = ts_s
+        node.minute(ts_s).add_dominant(max(peaks, key=lambda peak: peak[1]))
+        node.maybe_flush()
+
+
+def service(serial: str, close: bool = False) -> None:
+    """Flush the node's pending minutes when due (always when closing) and
+    optionally drop its connection."""
+    node = _NODES.get(serial)
+    if node is None:
+        return
+    with node.lock:
+        now = time.monotonic()
+        if close or now - node.last_flush >= ANALYTICS_FLUSH_S:
+            node.flush(now)
+        if close:
+            node.close()
+
+
+# Backend side
+def read_trends(serial: str, start_s: float, end_s: float, width_s: int) -> list:
+    """
+    The node's minutes in [start_s, end_s) merged to width_s buckets (a
+    multiple of 60), oldest first; buckets without data are left out:
+
+        {"start_s", "accel_rms": [x, y, z], "accel_p2p": [..],
+         "inclin_mean": [roll, pitch, yaw], "temp", "dom_hz", "dom_psd"}
+
+    with None where a sensor had no valid sample in the bucket.
+    """
+    path = analytics_path(serial)
+    if not path.exists():
+        return []
+
+    selects = ", ".join(
+        [f"SUM({c})" for c in _SUM_COLUMNS]
+        + [f"MIN({c})" for c in _MIN_COLUMNS]
+        + [f"MAX({c})" for c in _MAX_COLUMNS]
+    )
+    try:
+        conn = sqlite3.connect(f"file:{path}?mode=ro", uri=True)
+    except sqlite3.Error:
+        return []
+    try:
+        # dom_hz is a bare column: SQLite takes it from the row with MAX(dom_psd)
+        rows = conn.execute(
+            f"""
+            SELECT (start_s / ?) * ? AS b, {selects}, dom_hz, MAX(dom_psd)
+            FROM minutes
+            WHERE start_s >= ? AND start_s < ?
+            GROUP BY b
+            ORDER BY b
+            """,
+            (width_s, width_s, int(start_s - start_s % 60), end_s),
+        ).fetchall()
+    except sqlite3.Error as e:
+        print(f"[analytics] Failed to read {path}: {e}")
+        return []
+    finally:
+        conn.close()
+
+    points = []
+    for b, accel_n, *rest in rows:
+        sums, squares = rest[0:3], rest[3:6]
+        inclin_n, inclin_sums = rest[6], rest[7:10]
+        temp_n, temp_sum = rest[10], rest[11]
+        mins, maxs = rest[12:15], rest[15:18]
+        dom_hz, dom_psd = rest[18], rest[19]
+
+        point = {"start_s": b, "accel_rms": None, "accel_p2p": None,
+                 "inclin_mean": None, "temp": None,
+                 "dom_hz": round(dom_hz, 3) if dom_hz is not None else None, "dom_psd": dom_psd}
+        if accel_n:
+            point["accel_rms"] = [
+                round(math.sqrt(max(0.0, sq / accel_n - (s / accel_n) ** 2)), 6)
+                for s, sq in zip(sums, squares)
+            ]
+            point["accel_p2p"] = [
+                round(hi - lo, 6) if lo is not None and hi is not None else None
+                for lo, hi in zip(mins, maxs)
+            ]
+        if inclin_n:
+            point["inclin_mean"] = [round(s / inclin_n, 6) for s in inclin_sums]
+        if temp_n:
+            point["temp"] = round(temp_sum / temp_n, 3)
+        points.append(point)
+    return points
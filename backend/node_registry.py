@@ -1,6 +1,10 @@
+import atexit
+import fcntl
 import json
 import math
+import threading
 import time
+from contextlib import contextmanager
 from datetime import datetime, timezone
 from pathlib import Path
 from threading import Lock
@@ -26,11 +30,42 @@ MAX_Y = 0.94
 TOP_SECTION_MAX_Y = 0.33
 MIDDLE_SECTION_MAX_Y = 0.66
 
+# register_serial() and update_sensor_runtime() run for every data packet
+# on the data listener's ingest workers, and used to read (and write) the
+# whole registry and the settings file each time. They now only update this
+# process's copy: the registry item of a serial seen before (_KNOWN) and the
+# runtime cache, and mark the serial dirty. A background thread merges the
+# dirty nodes into NODES_JSON every _FLUSH_INTERVAL (and at exit), re-reading
+# the file first so that positions or nodes written by another process (the
+# backend, the control listener) are kept, and replacing it atomically.
+#
+# Only a serial this process has not seen yet goes to disk on the packet
+# path: node ids are allocated in the file, which all processes share.
+# Those read-modify-writes hold an flock on _LOCK_PATH, so two listener
+# processes (dataStorage/listener_supervisor.py) cannot hand out the same
+# node id or drop each other's flush.
 _SENSOR_RUNTIME_CACHE = {}
 _SENSOR_RUNTIME_LOCK = Lock()
-_LAST_FLUSH_TIME = 0.0
 _FLUSH_INTERVAL = 5.0  # seconds
 
+_KNOWN: dict = {}               # serial -> registry item
+_DIRTY_SEEN: dict = {}          # serial -> last_seen not yet in NODES_JSON
+_DIRTY_RUNTIME: set = set()     # serials whose runtime is not yet in NODES_JSON
+_REGISTRY_LOCK = Lock()
+_flush_thread: Optional[threading.Thread] = None
+_LOCK_PATH = NODES_JSON.with_suffix(".lock")
+
+
+# Exclusive across processes (and threads: each call opens its own fd).
+@contextmanager
+def _file_lock():
+    with open(_LOCK_PATH, "a") as f:
+        fcntl.flock(f, fcntl.LOCK_EX)
+        try:
+            yield
+        finally:
+            fcntl.flock(f, fcntl.LOCK_UN)
+
 
 # Return the current UTC time in ISO format.
 def _now_iso() -> str:
@@ -62,6 +97,19 @@ def _is_nan_value(value) -> bool:
         return False
 
 
+# NaN check of one sample's values; numbers without float() per value.
+def _sample_has_nan(sample, start: int = 1, end: Optional[int] = None) -> bool:
+    if not isinstance(sample, list):
+        return False
+    for v in sample[start:end]:
+        if v.__class__ is float:
+            if v != v:
+                return True
+        elif v.__class__ is not int and _is_nan_value(v):
+            return True
+    return False
+
+
 # Normalize inclinometer payloads so both flat and nested packet shapes work.
 def _as_sample_list(value):
     if not isinstance(value, list) or not value:
@@ -220,14 +268,18 @@ def _build_node_response(item: dict, timeout_seconds: int) -> dict:
     }
 
 
-# Return all nodes in a frontend-ready format.
-def list_nodes(timeout_seconds: int = 60):
+# Return all nodes in a frontend-ready format; with include_runtime, each
+# with its flushed "sensor_runtime" too (one registry read for the fleet).
+def list_nodes(timeout_seconds: int = 60, include_runtime: bool = False):
     raw = _load_registry_raw()
     nodes = sorted(raw["nodes"], key=lambda item: item["node_id"])
 
     out = []
     for item in nodes:
-        out.append(_build_node_response(item, timeout_seconds))
+        node = _build_node_response(item, timeout_seconds)
+        if include_runtime:
+            node["sensor_runtime"] = item["sensor_runtime"]
+        out.append(node)
 
     return out
 
@@ -257,6 +309,22 @@ def register_serial(serial: str, seen_at: Optional[str] = None):
 
     now_iso = seen_at or _now_iso()
 
+    known = _KNOWN.get(serial)
+    if known is not None:
+        with _REGISTRY_LOCK:
+            known["last_seen"] = now_iso
+            _DIRTY_SEEN[serial] = now_iso
+        return _build_node_response(known, 60)
+
+    with _file_lock():
+        item = _register_new_serial(serial, now_iso)
+    ensure_node_defaults(item["node_id"])
+    _remember(serial, item)
+    return _build_node_response(item, 60)
+
+
+# Find or allocate the serial's registry item in NODES_JSON (file lock held).
+def _register_new_serial(serial: str, now_iso: str) -> dict:
     raw = _load_registry_raw()
     nodes = raw["nodes"]
 
@@ -264,8 +332,7 @@ def register_serial(serial: str, seen_at: Optional[str] = None):
         if item["serial"] == serial:
             item["last_seen"] = now_iso
             _save_registry_raw({"nodes": sorted(nodes, key=lambda item: item["node_id"])})
-            ensure_node_defaults(item["node_id"])
-            return _build_node_response(item, 60)
+            return item
 
     next_node_id = max((item["node_id"] for item in nodes), default=0) + 1
     default_x, default_y = _default_position(next_node_id)
@@ -282,29 +349,51 @@ def register_serial(serial: str, seen_at: Optional[str] = None):
 
     nodes.append(new_item)
     _save_registry_raw({"nodes": sorted(nodes, key=lambda item: item["node_id"])})
-    ensure_node_defaults(next_node_id)
+    return new_item
+
+
+# Keep a registered node in memory.
+def _remember(serial: str, item: dict) -> None:
+    with _REGISTRY_LOCK:
+        _KNOWN[serial] = item
+    _start_flush_thread()
+
+
+def _start_flush_thread() -> None:
+    global _flush_thread
 
-    return _build_node_response(new_item, 60)
+    with _REGISTRY_LOCK:
+        if _flush_thread is not None:
+            return
+        _flush_thread = threading.Thread(target=_flush_loop, daemon=True, name="node-registry-flush")
+        _flush_thread.start()
+    atexit.register(flush_registry)
 
 
 # Update a node's map position and return the updated node.
 def update_node_position(node_id: int, x: float, y: float):
-    raw = _load_registry_raw()
-    nodes = raw["nodes"]
+    with _file_lock():
+        raw = _load_registry_raw()
+        nodes = raw["nodes"]
 
-    for item in nodes:
-        if item["node_id"] == node_id:
-            item["x"] = _clamp_x(x)
-            item["y"] = _clamp_y(y)
-            _save_registry_raw({"nodes": sorted(nodes, key=lambda item: item["node_id"])})
-            return _build_node_response(item, 60)
+        for item in nodes:
+            if item["node_id"] == node_id:
+                item["x"] = _clamp_x(x)
+                item["y"] = _clamp_y(y)
+                _save_registry_raw({"nodes": sorted(nodes, key=lambda item: item["node_id"])})
+                return _build_node_response(item, 60)
 
     return None
 
 
 # Update the live per-sensor runtime cache using one decoded MQTT packet.
-def update_sensor_runtime(serial: str, packet: dict):
+# Returns {sensor: had NaN / outage} for the sensors in the packet.
+def update_sensor_runtime(serial: str, packet: dict) -> dict:
     now_iso = _now_iso()
+    health = {}
+
+    if _flush_thread is None:
+        _start_flush_thread()
 
     with _SENSOR_RUNTIME_LOCK:
         if serial not in _SENSOR_RUNTIME_CACHE:
@@ -316,11 +405,15 @@ def update_sensor_runtime(serial: str, packet: dict):
         if isinstance(accel, list) and accel:
             runtime["accelerometer"]["last_packet_ts"] = now_iso
 
-            accel_has_nan = any(
-                isinstance(sample, list) and any(_is_nan_value(v) for v in sample[1:4])
-                for sample in accel
-            )
+            # The node's summary block counts NaN samples; rescan only
+            # packets from firmware that does not send one.
+            summary = packet.get("s")
+            if isinstance(summary, dict) and isinstance(summary.get("nan"), int):
+                accel_has_nan = summary["nan"] > 0
+            else:
+                accel_has_nan = any(_sample_has_nan(sample, 1, 4) for sample in accel)
 
+            health["accelerometer"] = accel_has_nan
             if accel_has_nan:
                 runtime["accelerometer"]["last_nan_ts"] = now_iso
             else:
@@ -330,21 +423,32 @@ def update_sensor_runtime(serial: str, packet: dict):
         if inclin:
             runtime["inclinometer"]["last_packet_ts"] = now_iso
 
-            inclin_has_nan = any(
-                isinstance(sample, list) and any(_is_nan_value(v) for v in sample[1:])
-                for sample in inclin
-            )
+            inclin_has_nan = any(_sample_has_nan(sample) for sample in inclin)
 
+            health["inclinometer"] = inclin_has_nan
             if inclin_has_nan:
                 runtime["inclinometer"]["last_nan_ts"] = now_iso
             else:
                 runtime["inclinometer"]["last_valid_data_ts"] = now_iso
 
+        # A sensor with no data this packet is a gap entry, its array empty
+        gap_sensors = {
+            "a": "accelerometer",
+            "i": "inclinometer",
+        }
+        for gap in packet.get("g") or []:
+            if isinstance(gap, list) and len(gap) > 2 and gap[2] in gap_sensors:
+                sensor = runtime[gap_sensors[gap[2]]]
+                health[gap_sensors[gap[2]]] = True
+                sensor["last_packet_ts"] = now_iso
+                sensor["last_nan_ts"] = now_iso
+
         temp = packet.get("T")
         if isinstance(temp, list) and len(temp) > 1:
             runtime["temperature"]["last_packet_ts"] = now_iso
 
-            if _is_nan_value(temp[1]):
+            health["temperature"] = _is_nan_value(temp[1])
+            if health["temperature"]:
                 runtime["temperature"]["last_nan_ts"] = now_iso
             else:
                 runtime["temperature"]["last_valid_data_ts"] = now_iso
@@ -352,26 +456,45 @@ def update_sensor_runtime(serial: str, packet: dict):
         for sensor in runtime.values():
             sensor["updated_at"] = now_iso
 
-    _flush_runtime_to_disk()
+        _DIRTY_RUNTIME.add(serial)
 
+    return health
 
-# Flush the in-memory runtime cache to disk periodically.
-def _flush_runtime_to_disk():
-    global _LAST_FLUSH_TIME
 
-    now = time.time()
-    if now - _LAST_FLUSH_TIME < _FLUSH_INTERVAL:
+# Merge the dirty nodes' last_seen and runtime into NODES_JSON.
+def flush_registry() -> None:
+    with _REGISTRY_LOCK:
+        seen = dict(_DIRTY_SEEN)
+        _DIRTY_SEEN.clear()
+    with _SENSOR_RUNTIME_LOCK:
+        runtime = {
+            serial: {name: dict(sensor) for name, sensor in _SENSOR_RUNTIME_CACHE[serial].items()}
+            for serial in _DIRTY_RUNTIME
+        }
+        _DIRTY_RUNTIME.clear()
+    if not seen and not runtime:
         return
 
-    raw = _load_registry_raw()
+    with _file_lock():
+        raw = _load_registry_raw()
+
+        for node in raw["nodes"]:
+            serial = node["serial"]
+            if serial in seen:
+                node["last_seen"] = seen[serial]
+            if serial in runtime:
+                node["sensor_runtime"] = runtime[serial]
+
+        _save_registry_raw(raw)
 
-    for node in raw["nodes"]:
-        serial = node["serial"]
-        if serial in _SENSOR_RUNTIME_CACHE:
-            node["sensor_runtime"] = _SENSOR_RUNTIME_CACHE[serial]
 
-    _save_registry_raw(raw)
-    _LAST_FLUSH_TIME = now
+def _flush_loop() -> None:
+    while True:
+        time.sleep(_FLUSH_INTERVAL)
+        try:
+            flush_registry()
+        except Exception as e:
+            print(f"[node_registry] Registry flush failed: {e}")
 
 
 # Return one node's sensor runtime, preferring the in-memory cache.
@@ -0,0 +1,84 @@
+from array import array
+
+from sensor_export_decoder import columns_available, iter_decoded_columns, iter_decoded_records_for_export
+
+# Decode of one completed hourly file's window for the plot endpoints, run
+# in query_executor's decode processes: module level and importable without
+# main.py, and returning flat float columns, which pickle as one buffer each
+# rather than as a tuple per sample.
+#
+# Result: {"ts": [...], "values": [[...] per axis], "gaps": [start_s, ...]}
+# as array("d") columns, NaN for a missing value, samples and gap starts in
+# [start_s, end_s) only. sensor is "accel", "inclin" or "temp".
+_RECORD_FIELDS = {"accel": "accel_samples", "inclin": "inclin", "temp": "temp"}
+_AXES = {"accel": 3, "inclin": 3, "temp": 1}
+
+
+def _gap_start(gap: dict, sensor: str, start_s: float, end_s: float):
+    if not gap or gap.get("sensor") != sensor:
+        return None
+    ts = gap.get("start_s")
+    if ts is None or ts < start_s or ts >= end_s:
+        return None
+    return ts
+
+
+def _decode_columns(path: str, sensor: str, start_s: float, end_s: float, out: dict) -> None:
+    ts_out = out["ts"]
+    values_out = out["values"]
+    for block in iter_decoded_columns(path, start_s, end_s):
+        for gap in block["gaps"]:
+            ts = _gap_start(gap, sensor, start_s, end_s)
+            if ts is not None:
+                out["gaps"].append(ts)
+
+        columns = block.get(sensor)
+        if columns is None:
+            continue
+        ts = columns[0]
+        keep = (ts >= start_s) & (ts < end_s)
+        ts_out.frombytes(ts[keep].tobytes())
+        for axis, column in enumerate(columns[1:]):
+            values_out[axis].frombytes(column[keep].tobytes())
+
+
+def _decode_records(path: str, sensor: str, start_s: float, end_s: float, out: dict) -> None:
+    ts_out = out["ts"]
+    values_out = out["values"]
+    nan = float("nan")
+    field = _RECORD_FIELDS[sensor]
+
+    for rec in iter_decoded_records_for_export(path, start_s, end_s):
+        if rec.get("record_type") == "GAP":
+            ts = _gap_start(rec.get("gap"), sensor, start_s, end_s)
+            if ts is not None:
+                out["gaps"].append(ts)
+            continue
+
+        samples = rec.get(field)
+        if not samples:
+            continue
+        if sensor == "temp":
+            samples = (samples,)
+        for sample in samples:
+            ts = sample[0]
+            if ts < start_s or ts >= end_s:
+                continue
+            ts_out.append(ts)
+            for axis, column in enumerate(values_out):
+                v = sample[1 + axis]
+                column.append(nan if v is None else v)
+
+
+def decode_window(path: str, sensor: str, start_s: float, end_s: float) -> dict:
+    out = {
+        "ts": array("d"),
+        "values": [array("d") for _ in range(_AXES[sensor])],
+        "gaps": [],
+    }
+    if columns_available():
+        _decode_columns(path, sensor, start_s, end_s, out)
+    else:
+        _decode_records(path, sensor, start_s, end_s, out)
+    out["gaps"].sort()
+    return out
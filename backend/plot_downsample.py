@@ -0,0 +1,158 @@
+import math
+
+# Streaming, peak-preserving downsampling for the plot endpoints.
+#
+# The plot readers used to keep the first sample after every window / budget
+# seconds and drop the rest, which hides exactly the short peaks a
+# structural monitor is looking for. The window is now cut into `points`
+# equal time buckets and each bucket is reduced as samples arrive, in one
+# pass and with at most two buckets of samples held:
+#
+#   "lttb"    Largest-Triangle-Three-Buckets: the one real sample of each
+#             bucket that forms the largest triangle with the previously
+#             kept sample and the next bucket's average. Summed over the
+#             axes, so a peak on any axis keeps its sample.
+#   "minmax"  per-axis count / min / max / sum of the bucket: one point per
+#             bucket with the mean, and the extremes as <axis>_min /
+#             <axis>_max (the shape the pyramid buckets are served in).
+#
+# Points come back as (ts, values, mins, maxs) with one entry per axis
+# (None for a NaN sample); mins / maxs are None for lttb. A gap() marks an
+# outage: pending buckets are flushed and a (ts, None, None, None) break is
+# emitted, and the next sample starts a fresh line.
+DOWNSAMPLE_METHODS = ("lttb", "minmax")
+
+
+def merge_agg(agg, n: int, lo: float, hi: float, total: float):
+    """Fold (n, min, max, sum) into a [n, min, max, sum] aggregate; returns
+    the aggregate (a new one when agg is None). Also used by the pyramid."""
+    if agg is None:
+        return [n, lo, hi, total]
+    agg[0] += n
+    if lo < agg[1]:
+        agg[1] = lo
+    if hi > agg[2]:
+        agg[2] = hi
+    agg[3] += total
+    return agg
+
+
+class _Downsampler:
+    def __init__(self, start_s: float, end_s: float, points: int, axes: int):
+        self.start_s = start_s
+        self.width = max(1e-9, (end_s - start_s) / max(1, points))
+        self.axes = axes
+        self.out: list = []
+
+    def _bucket(self, ts: float) -> int:
+        return math.floor((ts - self.start_s) / self.width)
+
+    def gap(self, ts: float) -> None:
+        self._flush()
+        self.out.append((ts, None, None, None))
+
+    def finish(self) -> list:
+        self._flush()
+        return self.out
+
+
+class _LttbDownsampler(_Downsampler):
+    def __init__(self, start_s, end_s, points, axes):
+        super().__init__(start_s, end_s, points, axes)
+        self.anchor = None      # last kept (ts, values)
+        self.pending = []       # complete bucket waiting for the next one's average
+        self.current = []
+        self.current_idx = None
+
+    def add(self, ts: float, values: tuple) -> None:
+        if all(v is None for v in values):
+            return
+        if self.anchor is None:
+            # A line always starts on its first sample
+            self.anchor = (ts, values)
+            self.out.append((ts, values, None, None))
+            return
+        idx = self._bucket(ts)
+        if self.current_idx is not None and idx > self.current_idx:
+            if self.pending:
+                self._keep(self.pending, self._average(self.current))
+            self.pending = self.current
+            self.current = []
+        if not self.current or idx > self.current_idx:
+            self.current_idx = idx
+        self.current.append((ts, values))
+
+    def _average(self, bucket: list):
+        ts = sum(s[0] for s in bucket) / len(bucket)
+        values = []
+        for axis in range(self.axes):
+            column = [s[1][axis] for s in bucket if s[1][axis] is not None]
+            values.append(sum(column) / len(column) if column else None)
+        return ts, values
+
+    def _keep(self, bucket: list, target) -> None:
+        a_ts, a_values = self.anchor
+        c_ts, c_values = target
+        best = None
+        best_area = -1.0
+        for sample in bucket:
+            b_ts, b_values = sample
+            area = 0.0
+            for a, b, c in zip(a_values, b_values, c_values):
+                if a is None or b is None or c is None:
+                    continue
+                area += abs((b_ts - a_ts) * (c - a) - (c_ts - a_ts) * (b - a))
+            if area > best_area:
+                best, best_area = sample, area
+        self.anchor = best
+        self.out.append((best[0], best[1], None, None))
+
+    def _flush(self) -> None:
+        if self.pending:
+            self._keep(self.pending, self._average(self.current) if self.current else self.pending[-1])
+        if self.current:
+            # Last bucket of a line: no next bucket, aim at its own last sample
+            self._keep(self.current, self.current[-1])
+        self.anchor = None
+        self.pending = []
+        self.current = []
+        self.current_idx = None
+
+
+class _MinMaxDownsampler(_Downsampler):
+    def __init__(self, start_s, end_s, points, axes):
+        super().__init__(start_s, end_s, points, axes)
+        self.current_idx = None
+        self.aggs = [None] * axes
+
+    def add(self, ts: float, values: tuple) -> None:
+        idx = self._bucket(ts)
+        if self.current_idx is not None and idx > self.current_idx:
+            self._flush()
+        if self.current_idx is None or idx > self.current_idx:
+            self.current_idx = idx
+        aggs = self.aggs
+        for axis, v in enumerate(values):
+            if v is not None:
+                aggs[axis] = merge_agg(aggs[axis], 1, v, v, v)
+
+    def _flush(self) -> None:
+        if self.current_idx is not None and any(self.aggs):
+            ts = self.start_s + self.current_idx * self.width
+            means = [agg[3] / agg[0] if agg else None for agg in self.aggs]
+            mins = [agg[1] if agg else None for agg in self.aggs]
+            maxs = [agg[2] if agg else None for agg in self.aggs]
+            self.out.append((ts, means, mins, maxs))
+        self.current_idx = None
+        self.aggs = [None] * self.axes
+
+
+def make_downsampler(method: str, start_s: float, end_s: float, points: int, axes: int):
+    """A streaming downsampler reducing [start_s, end_s) to about `points`
+    points of `axes` values each: add(ts, values) in time order, gap(ts) at
+    outages, then finish() for the points."""
+    if method == "minmax":
+        return _MinMaxDownsampler(start_s, end_s, points, axes)
+    if method == "lttb":
+        return _LttbDownsampler(start_s, end_s, points, axes)
+    raise ValueError(f"Unknown downsample method: {method}")
@@ -0,0 +1,261 @@
+import os
+import sqlite3
+import time
+from bisect import bisect_left
+from pathlib import Path
+from threading import Lock
+
+from plot_downsample import merge_agg
+
+# Multi-resolution min / max / mean pyramid of the stored samples, for plots
+# over long spans.
+#
+# The plot endpoints used to decode every sample in the window and keep one
+# every window / point budget, which limits them to short windows of the
+# current hour. The encoder shard workers now fold each stored packet into
+# per-axis buckets at PYRAMID_LEVELS_S resolutions (1 s, 10 s, 1 min,
+# 10 min), in one SQLite file per node under PYRAMID_DIR:
+#
+#   buckets(sensor, axis, level, start_s, n, mn, mx, sm)
+#
+# n / mn / mx / sm are the count, min, max and sum of the valid (non-NaN)
+# samples in [start_s, start_s + level). Buckets are upserted, so a flush in
+# the middle of a bucket, a packet straddling two, or a replay into a past
+# hour all merge into the same row.
+#
+# Writer side: the shard worker owning the node holds its connection (as it
+# holds the node's hourly file) and buffers 1 s buckets for PYRAMID_FLUSH_S
+# before rolling them up into every level in one transaction.
+#
+# Reader side (backend): read_buckets() picks the coarsest level whose
+# buckets are no wider than the requested spacing and merges them in SQL to
+# at most the point budget; no raw data is read.
+PYRAMID_DIR = Path("/mnt/ssd/pyramid")
+PYRAMID_LEVELS_S = (1, 10, 60, 600)
+PYRAMID_FLUSH_S = float(os.getenv("SHM_PYRAMID_FLUSH_S", "5"))
+
+# Rows older than this are pruned per level (None = kept until the node's
+# file is deleted); checked once an hour per node.
+PYRAMID_RETENTION_S = {
+    1: 8 * 86400,
+    10: 35 * 86400,
+    60: 400 * 86400,
+    600: None,
+}
+_PRUNE_INTERVAL_S = 3600.0
+
+PYRAMID_AXES = {
+    "accel": ("x", "y", "z"),
+    "inclin": ("roll", "pitch", "yaw"),
+    "temp": ("value",),
+}
+
+_UPSERT_SQL = """
+    INSERT INTO buckets (sensor, axis, level, start_s, n, mn, mx, sm)
+    VALUES (?, ?, ?, ?, ?, ?, ?, ?)
+    ON CONFLICT (sensor, axis, level, start_s) DO UPDATE SET
+        n = n + excluded.n,
+        mn = min(mn, excluded.mn),
+        mx = max(mx, excluded.mx),
+        sm = sm + excluded.sm
+"""
+
+
+def pyramid_path(serial: str) -> Path:
+    return PYRAMID_DIR / f"pyramid_{serial}.db"
+
+
+def _ensure_pyramid_table(conn: sqlite3.Connection) -> None:
+    conn.execute(
+        """
+        CREATE TABLE IF NOT EXISTS buckets (
+            sensor TEXT NOT NULL,
+            axis INTEGER NOT NULL,
+            level INTEGER NOT NULL,
+            start_s INTEGER NOT NULL,
+            n INTEGER NOT NULL,
+            mn REAL NOT NULL,
+            mx REAL NOT NULL,
+            sm REAL NOT NULL,
+            PRIMARY KEY (sensor, axis, level, start_s)
+        ) WITHOUT ROWID
+        """
+    )
+
+
+class _NodePyramid:
+    """Pending 1 s buckets and the SQLite connection of one node."""
+
+    def __init__(self, serial: str):
+        self.serial = serial
+        self.conn = None
+        self.pending: dict = {}         # (sensor, axis, second) -> [n, mn, mx, sm]
+        self.last_flush = time.monotonic()
+        self.last_prune = 0.0
+
+    def fold(self, sensor: str, ts_us: list, axes: tuple, scale: int) -> None:
+        # ts_us is in time order within a packet: cut it into whole seconds
+        # and fold each axis slice into that second's bucket
+        pending = self.pending
+        count = len(ts_us)
+        i = 0
+        while i < count:
+            second = ts_us[i] // 1_000_000
+            j = bisect_left(ts_us, (second + 1) * 1_000_000, i + 1)
+            for axis, column in enumerate(axes):
+                values = [v for v in column[i:j] if v is not None]
+                if not values:
+                    continue
+                key = (sensor, axis, second)
+                pending[key] = merge_agg(
+                    pending.get(key), len(values),
+                    min(values) / scale, max(values) / scale, sum(values) / scale,
+                )
+            i = j
+
+    def _rows(self) -> list:
+        levels: dict = {}
+        for (sensor, axis, second), (n, lo, hi, total) in self.pending.items():
+            for level in PYRAMID_LEVELS_S:
+                key = (sensor, axis, level, second - second % level)
+                levels[key] = merge_agg(levels.get(key), n, lo, hi, total)
+        return [key + tuple(row) for key, row in levels.items()]
+
+    def _connect(self) -> sqlite3.Connection:
+        if self.conn is None:
+            PYRAMID_DIR.mkdir(parents=True, exist_ok=True)
+            self.conn = sqlite3.connect(pyramid_path(self.serial))
+            # WAL lets the backend read while the shard worker writes
+            self.conn.execute("PRAGMA journal_mode=WAL")
+            self.conn.execute("PRAGMA synchronous=NORMAL")
+            _ensure_pyramid_table(self.conn)
+        return self.conn
+
+    def _prune(self, conn: sqlite3.Connection) -> None:
+        now = time.time()
+        for level, keep_s in PYRAMID_RETENTION_S.items():
+            if keep_s is not None:
+                conn.execute(
+                    "DELETE FROM buckets WHERE level = ? AND start_s < ?",
+                    (level, int(now - keep_s)),
+                )
+
+    def flush(self, now: float) -> None:
+        self.last_flush = now
+        if not self.pending:
+            return
+        rows = self._rows()
+        self.pending = {}
+        try:
+            conn = self._connect()
+            with conn:
+                conn.executemany(_UPSERT_SQL, rows)
+                if now - self.last_prune >= _PRUNE_INTERVAL_S:
+                    self.last_prune = now
+                    self._prune(conn)
+        except sqlite3.Error as e:
+            # The samples are in the hourly file; only the overview loses them
+            print(f"[plot_pyramid] Failed to update {pyramid_path(self.serial)}: {e}")
+            self.close()
+
+    def close(self) -> None:
+        if self.conn is not None:
+            try:
+                self.conn.close()
+            except sqlite3.Error:
+                pass
+            self.conn = None
+
+
+_NODES: dict = {}
+_NODES_LOCK = Lock()
+
+
+def _node(serial: str) -> _NodePyramid:
+    node = _NODES.get(serial)
+    if node is None:
+        with _NODES_LOCK:
+            node = _NODES.setdefault(serial, _NodePyramid(serial))
+    return node
+
+
+def note_columns(serial: str, sensor: str, ts_us: list, axes: tuple, scale: int) -> None:
+    """
+    Fold one packet's samples of a sensor into the node's pyramid.
+
+    ts_us and axes are the encoder's int columns (µs timestamps, values x
+    scale, None for NaN). Call from the node's shard worker only.
+    """
+    node = _node(serial)
+    node.fold(sensor, ts_us, axes, scale)
+    now = time.monotonic()
+    if now - node.last_flush >= PYRAMID_FLUSH_S:
+        node.flush(now)
+
+
+def service(serial: str, close: bool = False) -> None:
+    """Flush the node's pending buckets when due (always when closing) and
+    optionally drop its connection. Shard worker only."""
+    node = _NODES.get(serial)
+    if node is None:
+        return
+    now = time.monotonic()
+    if close or now - node.last_flush >= PYRAMID_FLUSH_S:
+        node.flush(now)
+    if close:
+        node.close()
+
+
+# Backend side
+def pyramid_level_for(spacing_s: float):
+    """The coarsest level no wider than spacing_s, or None if even the
+    finest one is too coarse (the caller then reads raw samples)."""
+    fitting = [level for level in PYRAMID_LEVELS_S if level <= spacing_s]
+    return fitting[-1] if fitting else None
+
+
+def read_buckets(serial: str, sensor: str, start_s: float, end_s: float, spacing_s: float):
+    """
+    Buckets of one sensor in [start_s, end_s), oldest first, merged to
+    width_s (a multiple of the chosen level no wider than spacing_s):
+
+        (width_s, [(start_s, [(n, min, max, mean) or None per axis]), ...])
+
+    None when no level fits spacing_s or the node has no pyramid yet.
+    Buckets with no data are left out.
+    """
+    level = pyramid_level_for(spacing_s)
+    path = pyramid_path(serial)
+    if level is None or not path.exists():
+        return None
+    width = max(level, int(spacing_s // level) * level)
+    axes = len(PYRAMID_AXES[sensor])
+
+    try:
+        conn = sqlite3.connect(f"file:{path}?mode=ro", uri=True)
+    except sqlite3.Error:
+        return None
+    try:
+        rows = conn.execute(
+            """
+            SELECT (start_s / ?) * ? AS b, axis, SUM(n), MIN(mn), MAX(mx), SUM(sm)
+            FROM buckets
+            WHERE sensor = ? AND level = ? AND start_s >= ? AND start_s < ?
+            GROUP BY b, axis
+            ORDER BY b, axis
+            """,
+            (width, width, sensor, level, int(start_s - start_s % level), end_s),
+        ).fetchall()
+    except sqlite3.Error as e:
+        print(f"[plot_pyramid] Failed to read {path}: {e}")
+        return None
+    finally:
+        conn.close()
+
+    out = []
+    for b, axis, n, lo, hi, total in rows:
+        if not out or out[-1][0] != b:
+            out.append((b, [None] * axes))
+        if n:
+            out[-1][1][axis] = (n, lo, hi, total / n)
+    return width, out
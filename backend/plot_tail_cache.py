@@ -0,0 +1,102 @@
+import os
+from collections import deque
+from threading import Lock
+
+from sensor_export_decoder import decode_tail
+
+# Per-node decode cursor on the active hourly .bin for the live plot
+# endpoints (/api/accel, /api/inclinometer, /api/temperature).
+#
+# The dashboard polls those every few seconds. Instead of decoding the file
+# from byte 0 on every call, each node keeps the decoder cursor after the
+# last complete record (sensor_export_decoder.decode_tail()) and the most
+# recent records per sensor. A call decodes only what was appended since
+# the previous one, so its cost does not grow through the hour.
+#
+# The cache starts over when the hour (the file path) changes, and when
+# decode_tail() reports the file was rewritten under the cursor (active file
+# recovery after a listener restart truncates the tail).
+#
+# Each sensor keeps TAIL_WINDOW_S of records; a request reaching further
+# back than the cache holds gets None and falls back to the indexed decode.
+TAIL_WINDOW_S = {
+    "accel": float(os.getenv("SHM_PLOT_TAIL_ACCEL_S", "120")),
+    "inclin": 3600.0,
+    "temp": 3600.0,
+}
+
+_GAP_SENSOR_KEYS = {"accel": "accel", "inclin": "inclin"}
+
+
+class _NodeTail:
+    def __init__(self, path: str):
+        self.path = path
+        self.cursor = None
+        self.epoch = None
+        self.lock = Lock()
+        self.records = {sensor: deque() for sensor in TAIL_WINDOW_S}   # (ts, record)
+        self.held_from = {sensor: float("-inf") for sensor in TAIL_WINDOW_S}
+
+    def reset(self) -> None:
+        self.cursor = None
+        self.epoch = None
+        for sensor in TAIL_WINDOW_S:
+            self.records[sensor].clear()
+            self.held_from[sensor] = float("-inf")
+
+    def _keep(self, sensor: str, ts: float, record: dict) -> None:
+        kept = self.records[sensor]
+        kept.append((ts, record))
+        horizon = ts - TAIL_WINDOW_S[sensor]
+        while kept and kept[0][0] < horizon:
+            self.held_from[sensor] = kept.popleft()[0]
+
+    def add(self, rec: dict) -> None:
+        if rec.get("record_type") == "GAP":
+            sensor = _GAP_SENSOR_KEYS.get((rec.get("gap") or {}).get("sensor"))
+            if sensor is not None:
+                self._keep(sensor, rec["gap"]["start_s"], rec)
+            return
+
+        accel = rec.get("accel_samples")
+        if accel:
+            self._keep("accel", accel[-1][0], {"record_type": rec["record_type"], "accel_samples": accel})
+        inclin = rec.get("inclin")
+        if inclin:
+            self._keep("inclin", inclin[-1][0], {"record_type": rec["record_type"], "inclin": inclin})
+        temp = rec.get("temp")
+        if temp:
+            self._keep("temp", temp[0], {"record_type": rec["record_type"], "temp": temp})
+
+
+_NODES: dict = {}
+_NODES_LOCK = Lock()
+
+
+def records_since(serial: str, path: str, sensor: str, start_s: float):
+    """
+    Decoded records of one sensor in the active file, oldest first, in the
+    shape iter_decoded_records_for_export() yields them (only that sensor's
+    field set). None when the file cannot be followed or start_s is older
+    than the cache holds; the caller then decodes the file itself.
+    """
+    with _NODES_LOCK:
+        node = _NODES.get(serial)
+        if node is None or node.path != path:
+            node = _NODES[serial] = _NodeTail(path)
+
+    with node.lock:
+        records, cursor = decode_tail(path, node.cursor)
+        if records is None:
+            node.reset()
+            return None
+        if cursor is not None and cursor["epoch"] is not node.epoch:
+            node.reset()
+            node.epoch = cursor["epoch"]
+        node.cursor = cursor
+        for rec in records:
+            node.add(rec)
+
+        if start_s < node.held_from[sensor]:
+            return None
+        return [rec for ts, rec in node.records[sensor]]
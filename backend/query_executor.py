@@ -0,0 +1,224 @@
+import asyncio
+import multiprocessing
+import os
+import threading
+from concurrent.futures import BrokenExecutor, Future, ProcessPoolExecutor, ThreadPoolExecutor
+from functools import partial
+from typing import Any, AsyncIterator, Callable, Iterable, Optional
+
+from fastapi import HTTPException, Request
+
+import plot_decode
+
+# Executors for the heavy dashboard requests: the plot reads and the
+# sensor exports.
+#
+# Those used to be plain `def` handlers on FastAPI's shared threadpool, so a
+# few long-window plots or exports held its threads (and the GIL, decoding)
+# while health, login and every other endpoint queued behind them. Now:
+#   - plot reads run on their own QUERY_THREADS and export streams on their
+#     own EXPORT_THREADS, so neither can take the other's or the app's
+#     threads;
+#   - the decode of completed hourly files for a plot goes to
+#     DECODE_PROCESSES worker processes (plot_decode.py), in parallel across
+#     the window's files and outside the backend's GIL;
+#   - each user runs at most PER_USER_LIMIT[kind] requests of a kind at a
+#     time, more wait their turn;
+#   - identical concurrent plot requests share one run (run_query's key);
+#   - a request whose client disconnects stops its run, unless another
+#     client is waiting for the same result: run_query sets the run's cancel
+#     event, which the read loops check (QueryCancelled), and an export
+#     stream closes its generator.
+QUERY_THREADS = int(os.getenv("SHM_QUERY_THREADS", "4"))
+EXPORT_THREADS = int(os.getenv("SHM_EXPORT_THREADS", "2"))
+DECODE_PROCESSES = int(os.getenv("SHM_DECODE_PROCESSES", str(max(1, (os.cpu_count() or 2) - 1))))
+PER_USER_LIMIT = {
+    "plot": int(os.getenv("SHM_PLOT_QUERIES_PER_USER", "3")),
+    "export": int(os.getenv("SHM_EXPORTS_PER_USER", "2")),
+}
+DISCONNECT_POLL_S = 0.5
+
+_query_threads = ThreadPoolExecutor(QUERY_THREADS, thread_name_prefix="plot-query")
+_export_threads = ThreadPoolExecutor(EXPORT_THREADS, thread_name_prefix="export")
+_decode_processes: Optional[ProcessPoolExecutor] = None
+_decode_lock = threading.Lock()
+
+
+class QueryCancelled(Exception):
+    """Raised inside a run whose clients have all gone."""
+
+
+def check_cancelled(cancel: Optional[threading.Event]) -> None:
+    if cancel is not None and cancel.is_set():
+        raise QueryCancelled()
+
+
+# Decode processes
+def _decode_pool() -> Optional[ProcessPoolExecutor]:
+    global _decode_processes
+
+    if DECODE_PROCESSES <= 0:
+        return None
+    with _decode_lock:
+        if _decode_processes is None:
+            # forkserver: workers start from a clean interpreter instead of
+            # a fork of the threaded backend
+            _decode_processes = ProcessPoolExecutor(
+                DECODE_PROCESSES,
+                mp_context=multiprocessing.get_context("forkserver"),
+            )
+        return _decode_processes
+
+
+def _drop_broken_pool(e: Exception) -> None:
+    # A worker died (e.g. OOM-killed): the next decode starts a new pool
+    global _decode_processes
+    print(f"[query] Decode pool broken, decoding in thread: {e}")
+    with _decode_lock:
+        _decode_processes = None
+
+
+def submit_decode(path: str, sensor: str, start_s: float, end_s: float) -> Optional[Future]:
+    """Start plot_decode.decode_window() of one file in a decode process;
+    None when there are none (SHM_DECODE_PROCESSES=0). Collect with
+    decoded()."""
+    pool = _decode_pool()
+    if pool is None:
+        return None
+    try:
+        return pool.submit(plot_decode.decode_window, path, sensor, start_s, end_s)
+    except BrokenExecutor as e:
+        _drop_broken_pool(e)
+        return None
+
+
+def decoded(future: Optional[Future], path: str, sensor: str, start_s: float, end_s: float) -> dict:
+    """The result of submit_decode(), decoding in the calling thread when
+    there was no process for it."""
+    if future is not None:
+        try:
+            return future.result()
+        except BrokenExecutor as e:
+            _drop_broken_pool(e)
+    return plot_decode.decode_window(path, sensor, start_s, end_s)
+
+
+def shutdown() -> None:
+    with _decode_lock:
+        if _decode_processes is not None:
+            _decode_processes.shutdown(wait=False, cancel_futures=True)
+
+
+# Per-user limits
+_user_slots: dict = {}
+
+
+def _user_slot(kind: str, user: dict) -> asyncio.Semaphore:
+    key = (kind, str(user.get("username") or ""))
+    slot = _user_slots.get(key)
+    if slot is None:
+        slot = _user_slots[key] = asyncio.Semaphore(PER_USER_LIMIT[kind])
+    return slot
+
+
+# Plot queries
+class _Run:
+    def __init__(self):
+        self.cancel = threading.Event()
+        self.task: Optional[asyncio.Task] = None
+        self.waiters = 0
+
+
+_runs: dict = {}
+
+
+async def _wait_unless_disconnected(request: Request, awaitable: asyncio.Future) -> Any:
+    while True:
+        done, _ = await asyncio.wait({awaitable}, timeout=DISCONNECT_POLL_S)
+        if done:
+            return awaitable.result()
+        if await request.is_disconnected():
+            raise HTTPException(status_code=499, detail="Client closed request")
+
+
+async def run_query(
+    request: Request,
+    user: dict,
+    key: tuple,
+    fn: Callable[..., Any],
+    *args: Any,
+    **kwargs: Any,
+) -> Any:
+    """
+    fn(*args, cancel=<threading.Event>, **kwargs) on the plot query threads,
+    within the user's plot limit. A request with the same key while one is
+    running waits for that run's result instead of starting another.
+    """
+    run = _runs.get(key)
+    if run is None:
+        run = _Run()
+        slot = _user_slot("plot", user)
+        call = partial(fn, *args, cancel=run.cancel, **kwargs)
+
+        async def execute():
+            async with slot:
+                check_cancelled(run.cancel)
+                return await asyncio.get_running_loop().run_in_executor(_query_threads, call)
+
+        def finished(task: asyncio.Task) -> None:
+            if _runs.get(key) is run:
+                del _runs[key]
+            if not task.cancelled():
+                # Retrieved here too, for a cancelled run nobody awaits
+                task.exception()
+
+        run.task = asyncio.ensure_future(execute())
+        run.task.add_done_callback(finished)
+        _runs[key] = run
+
+    run.waiters += 1
+    try:
+        return await _wait_unless_disconnected(request, run.task)
+    except QueryCancelled:
+        raise HTTPException(status_code=499, detail="Client closed request")
+    finally:
+        run.waiters -= 1
+        if run.waiters == 0 and not run.task.done():
+            # Every client has gone: stop the read at its next check
+            run.cancel.set()
+            if _runs.get(key) is run:
+                del _runs[key]
+
+
+# Export streams
+async def stream(user: dict, chunks: Iterable[bytes]) -> AsyncIterator[bytes]:
+    """
+    An export body iterated on the export threads within the user's export
+    limit. Starlette stops iterating when the client disconnects; the
+    generator is then closed, which closes the files it has open.
+    """
+    iterator = iter(chunks)
+    done = object()
+    pending: Optional[Future] = None
+
+    def close_after(previous: Optional[Future]) -> None:
+        # A generator cannot be closed while next() still runs in it
+        if previous is not None:
+            try:
+                previous.result()
+            except Exception:
+                pass
+        close = getattr(iterator, "close", None)
+        if close is not None:
+            close()
+
+    async with _user_slot("export", user):
+        try:
+            while True:
+                pending = _export_threads.submit(next, iterator, done)
+                chunk = await asyncio.wrap_future(pending)
+                if chunk is done:
+                    break
+                yield chunk
+        finally:
+            _export_threads.submit(close_after, pending)
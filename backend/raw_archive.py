@@ -0,0 +1,204 @@
+from __future__ import annotations
+
+import mmap
+import os
+import struct
+from array import array
+from bisect import bisect_left
+
+# Indexed reader for the raw backup (.rawbin, dataStorage/raw_backup.py):
+# [8 bytes recv_unix_ns][4 bytes payload_len][payload] per record.
+#
+# raw_backup.iter_records() reads a file front to back, two read() calls per
+# record, so finding an hour's last minutes meant parsing the whole hour.
+# RawArchiveReader mmaps the file, keeps the offset and receive time of
+# every record and bisects to a time; payloads are memoryview slices of
+# the mapping, so nothing is copied until the caller does. Views are only
+# valid while the reader is open: keep bytes(view) for anything longer.
+#
+# The offsets are cached in <file>.rawbin.ridx: a version byte, the number
+# of bytes of the .rawbin it covers (Q), then recv_ns(Q) offset(Q) per
+# record. A file still being written is indexed from the cached length on,
+# and the cache is rewritten when it grew. A torn record at the end (the
+# writer's buffer not flushed yet) ends the index; it is picked up once
+# complete.
+#
+# Receive times are the Pi's wall clock and one node can be fed by both the
+# MQTT and the UDP receiver, so a file is only nearly sorted. Lookups
+# therefore bisect the running maximum of the times (for the first record
+# that can be in range) and the running minimum from the end (for the first
+# one after which none can be), and filter the records in between.
+RAW_INDEX_SUFFIX = ".ridx"
+RAW_INDEX_FORMAT_VERSION = 1
+
+_HEADER_STRUCT = struct.Struct("<QI")     # as raw_backup._HEADER_STRUCT
+_INDEX_HEADER = struct.Struct("<BQ")
+_INDEX_ENTRY = struct.Struct("<QQ")
+
+
+class RawArchiveReader:
+    """Random access to one .rawbin file by receive time."""
+
+    def __init__(self, path: str, use_cache: bool = True):
+        self.path = str(path)
+        self._mm = None
+        self._view = memoryview(b"")
+        self.times = array("Q")          # recv_unix_ns per record
+        self.offsets = array("Q")        # header offset per record
+        self.size = 0                    # bytes covered by the index
+
+        with open(self.path, "rb") as f:
+            length = os.fstat(f.fileno()).st_size
+            if length:
+                self._mm = mmap.mmap(f.fileno(), length, access=mmap.ACCESS_READ)
+                self._view = memoryview(self._mm)
+
+        cached = use_cache and self._load_cache()
+        added = self._scan()
+        if use_cache and (added or not cached) and self.times:
+            self._save_cache()
+        self._build_bounds()
+
+    # ---------------------------------------------------------------
+    # Index
+    # ---------------------------------------------------------------
+
+    def _load_cache(self) -> bool:
+        try:
+            with open(self.path + RAW_INDEX_SUFFIX, "rb") as f:
+                raw = f.read()
+        except OSError:
+            return False
+        if len(raw) < _INDEX_HEADER.size:
+            return False
+        version, size = _INDEX_HEADER.unpack_from(raw)
+        body = raw[_INDEX_HEADER.size:]
+        if version != RAW_INDEX_FORMAT_VERSION or len(body) % _INDEX_ENTRY.size:
+            return False
+        if size > len(self._view):
+            return False            # file was replaced or truncated
+        entries = array("Q", body)
+        if entries:
+            # Last entry must still describe the record that ends at size
+            recv_ns, offset = entries[-2], entries[-1]
+            if offset + _HEADER_STRUCT.size > size:
+                return False
+            ts, length = _HEADER_STRUCT.unpack_from(self._view, offset)
+            if ts != recv_ns or offset + _HEADER_STRUCT.size + length != size:
+                return False
+        elif size:
+            return False
+        self.times = entries[0::2]
+        self.offsets = entries[1::2]
+        self.size = size
+        return True
+
+    def _scan(self) -> int:
+        # Index complete records after self.size; returns how many were added
+        view = self._view
+        end = len(view)
+        pos = self.size
+        added = 0
+        header_size = _HEADER_STRUCT.size
+        unpack_from = _HEADER_STRUCT.unpack_from
+        while pos + header_size <= end:
+            recv_ns, length = unpack_from(view, pos)
+            if pos + header_size + length > end:
+                break
+            self.times.append(recv_ns)
+            self.offsets.append(pos)
+            pos += header_size + length
+            added += 1
+        self.size = pos
+        return added
+
+    def _save_cache(self) -> None:
+        entries = array("Q", bytes(len(self.times) * _INDEX_ENTRY.size))
+        entries[0::2] = self.times
+        entries[1::2] = self.offsets
+        path = self.path + RAW_INDEX_SUFFIX
+        tmp = path + ".tmp"
+        try:
+            with open(tmp, "wb") as f:
+                f.write(_INDEX_HEADER.pack(RAW_INDEX_FORMAT_VERSION, self.size))
+                f.write(entries.tobytes())
+            os.replace(tmp, path)
+        except OSError as e:
+            print(f"[raw_archive] Could not cache index for {os.path.basename(self.path)}: {e}")
+
+    def _build_bounds(self) -> None:
+        # Running max from the front, running min from the back
+        self._max_before = array("Q", self.times)
+        self._min_after = array("Q", self.times)
+        for i in range(1, len(self.times)):
+            if self._max_before[i] < self._max_before[i - 1]:
+                self._max_before[i] = self._max_before[i - 1]
+        for i in range(len(self.times) - 2, -1, -1):
+            if self._min_after[i] > self._min_after[i + 1]:
+                self._min_after[i] = self._min_after[i + 1]
+
+    # ---------------------------------------------------------------
+    # Access
+    # ---------------------------------------------------------------
+
+    def __len__(self) -> int:
+        return len(self.times)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def close(self) -> None:
+        self._view.release()
+        if self._mm is not None:
+            try:
+                self._mm.close()
+            except BufferError:
+                pass            # caller still holds payload views
+            self._mm = None
+
+    def first_ns(self) -> int | None:
+        return min(self.times) if self.times else None
+
+    def last_ns(self) -> int | None:
+        return max(self.times) if self.times else None
+
+    def seek(self, recv_ns: int) -> int:
+        """Index of the first record that may be received at or after recv_ns."""
+        return bisect_left(self._max_before, recv_ns)
+
+    def record(self, i: int) -> tuple[int, memoryview]:
+        """(recv_unix_ns, payload view) of record i."""
+        start = self.offsets[i] + _HEADER_STRUCT.size
+        _, length = _HEADER_STRUCT.unpack_from(self._view, self.offsets[i])
+        return self.times[i], self._view[start:start + length]
+
+    def iter_range(self, start_ns: int | None = None, end_ns: int | None = None):
+        """
+        Yield (recv_unix_ns, payload view) for records received in
+        [start_ns, end_ns), in file order. None leaves that side open.
+        """
+        lo = 0 if start_ns is None else self.seek(start_ns)
+        hi = len(self.times) if end_ns is None else bisect_left(self._min_after, end_ns)
+        times, offsets, view = self.times, self.offsets, self._view
+        header_size = _HEADER_STRUCT.size
+        unpack_from = _HEADER_STRUCT.unpack_from
+        for i in range(lo, hi):
+            recv_ns = times[i]
+            if start_ns is not None and recv_ns < start_ns:
+                continue
+            if end_ns is not None and recv_ns >= end_ns:
+                continue
+            pos = offsets[i]
+            _, length = unpack_from(view, pos)
+            yield recv_ns, view[pos + header_size:pos + header_size + length]
+
+
+def iter_raw_records(path: str, start_ns: int | None = None, end_ns: int | None = None):
+    """(recv_unix_ns, payload bytes) of one .rawbin in [start_ns, end_ns).
+    Copies each payload, so it can be used like raw_backup.iter_records()."""
+    with RawArchiveReader(path) as reader:
+        for recv_ns, payload in reader.iter_range(start_ns, end_ns):
+            yield recv_ns, bytes(payload)
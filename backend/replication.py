@@ -0,0 +1,320 @@
+import hashlib
+import json
+import os
+import socket
+import sqlite3
+import threading
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+from datetime import datetime, timezone
+
+import storage_catalog
+
+# Upstream replication of sealed storage files, so the Pi is not the only
+# copy of its site's data and nobody has to pull ZIP exports.
+#
+# A file is sealed once nothing writes it any more: an archived data hour
+# (.bin.gz / .bin.zst) or the .rawbin of a past hour. The replicator takes
+# them from the storage catalog, oldest first, skips the ones already shipped
+# with the same size and mtime (replay_raw.py rewriting an hour changes
+# both, so it is shipped again), and uploads the rest to
+# REPLICATION_URL/files/<site>/<kind>/<node>/<name>:
+#
+#   GET  -> 404, or {"size": bytes received, "sha256": ..., "complete": bool}
+#   PUT  one chunk, headers Content-Range: bytes <first>-<last>/<total> and
+#        X-Content-SHA256: <hash of the whole file>
+#        -> {"size": bytes received, "complete": bool}
+#        409 {"size": n} when the chunk does not start at n
+#        422 when the completed file does not match the hash
+#
+# so a transfer resumes where the server's copy ends, a repeated chunk or a
+# repeated file is harmless, and the server only publishes a file whose
+# hash checks out. Uploads are paced to REPLICATION_KBPS.
+#
+# Lag is the age of the oldest sealed file not yet shipped (its mtime is
+# when it was sealed); status() and /api/replication/status report it with
+# the pending count and bytes. Without SHM_REPLICATION_URL nothing runs.
+REPLICATION_URL = os.getenv("SHM_REPLICATION_URL", "").rstrip("/")
+REPLICATION_TOKEN = os.getenv("SHM_REPLICATION_TOKEN", "")
+REPLICATION_SITE = os.getenv("SHM_REPLICATION_SITE") or socket.gethostname()
+REPLICATION_KBPS = float(os.getenv("SHM_REPLICATION_KBPS", "512"))  # 0 = no cap
+REPLICATION_INTERVAL_S = 60.0
+REPLICATION_CHUNK_BYTES = 1024 * 1024
+# A sealed file younger than this may still be mid-swap; it waits a pass
+REPLICATION_SETTLE_S = 120.0
+REPLICATION_HTTP_TIMEOUT_S = 60.0
+
+REPLICATION_DB = storage_catalog.CATALOG_PATH.with_name("replication.db")
+
+_stop = threading.Event()
+_thread = None
+_status_lock = threading.Lock()
+_status = {
+    "state": "disabled",
+    "pending_files": None,
+    "pending_bytes": None,
+    "lag_s": None,
+    "oldest_pending": None,
+    "current": None,
+    "shipped_files": 0,
+    "shipped_bytes": 0,
+    "last_pass_at": None,
+    "last_shipped_at": None,
+    "last_error": None,
+}
+
+
+def _now_iso() -> str:
+    return datetime.now(timezone.utc).isoformat()
+
+
+def _set_status(**fields) -> None:
+    with _status_lock:
+        _status.update(fields)
+
+
+def status() -> dict:
+    with _status_lock:
+        return {
+            "enabled": bool(REPLICATION_URL),
+            "url": REPLICATION_URL or None,
+            "site": REPLICATION_SITE,
+            "rate_limit_kbps": REPLICATION_KBPS or None,
+            **_status,
+        }
+
+
+# -------------------------------------------------------------------
+# Shipped files
+# -------------------------------------------------------------------
+
+def _connect() -> sqlite3.Connection:
+    # Next to the catalog, and like its readers never under an unmounted SSD
+    if not REPLICATION_DB.parent.is_dir():
+        raise FileNotFoundError(f"{REPLICATION_DB.parent} not found (SSD not mounted?)")
+    conn = sqlite3.connect(REPLICATION_DB, timeout=10.0)
+    conn.execute(
+        """
+        CREATE TABLE IF NOT EXISTS shipped (
+            path TEXT PRIMARY KEY,
+            size INTEGER NOT NULL,
+            mtime_ns INTEGER NOT NULL,
+            sha256 TEXT NOT NULL,
+            shipped_at TEXT NOT NULL
+        )
+        """
+    )
+    return conn
+
+
+def _load_shipped(conn: sqlite3.Connection) -> dict:
+    return {path: (size, mtime_ns) for path, size, mtime_ns in
+            conn.execute("SELECT path, size, mtime_ns FROM shipped")}
+
+
+def _note_shipped(conn: sqlite3.Connection, path: str, st: os.stat_result, sha256: str) -> None:
+    conn.execute(
+        "INSERT OR REPLACE INTO shipped (path, size, mtime_ns, sha256, shipped_at) VALUES (?, ?, ?, ?, ?)",
+        (path, st.st_size, st.st_mtime_ns, sha256, _now_iso()),
+    )
+    conn.commit()
+
+
+# -------------------------------------------------------------------
+# Transfer
+# -------------------------------------------------------------------
+
+class _Pacer:
+    """Sleeps so that the bytes sent stay under REPLICATION_KBPS on average."""
+
+    def __init__(self, kbps: float):
+        self.bytes_per_s = kbps * 1024.0
+        self.next_at = time.monotonic()
+
+    def spend(self, n: int) -> None:
+        if self.bytes_per_s <= 0:
+            return
+        self.next_at = max(self.next_at, time.monotonic()) + n / self.bytes_per_s
+        _stop.wait(max(0.0, self.next_at - time.monotonic()))
+
+
+def _request(method: str, remote: str, body: bytes | None = None, headers: dict | None = None):
+    # (status, JSON body) of one call; network errors raise
+    req = urllib.request.Request(
+        f"{REPLICATION_URL}/files/{urllib.parse.quote(remote)}",
+        data=body,
+        method=method,
+        headers={**({"Authorization": f"Bearer {REPLICATION_TOKEN}"} if REPLICATION_TOKEN else {}),
+                 **(headers or {})},
+    )
+    try:
+        with urllib.request.urlopen(req, timeout=REPLICATION_HTTP_TIMEOUT_S) as resp:
+            status_code, raw = resp.status, resp.read()
+    except urllib.error.HTTPError as e:
+        status_code, raw = e.code, e.read()
+    try:
+        return status_code, json.loads(raw) if raw else {}
+    except ValueError:
+        return status_code, {}
+
+
+def _sha256(path: str) -> str:
+    digest = hashlib.sha256()
+    with open(path, "rb") as f:
+        for block in iter(lambda: f.read(REPLICATION_CHUNK_BYTES), b""):
+            digest.update(block)
+    return digest.hexdigest()
+
+
+def _ship(path: str, remote: str, size: int, sha256: str, pacer: _Pacer) -> bool:
+    """Upload path from where the server's copy ends; True once the server
+    has it complete."""
+    code, info = _request("GET", remote)
+    if code == 200 and info.get("sha256") == sha256:
+        if info.get("complete"):
+            return True
+        offset = int(info.get("size") or 0)
+    elif code in (200, 404):
+        offset = 0
+    else:
+        raise RuntimeError(f"GET {remote}: HTTP {code}")
+
+    with open(path, "rb") as f:
+        while offset < size and not _stop.is_set():
+            f.seek(offset)
+            chunk = f.read(min(REPLICATION_CHUNK_BYTES, size - offset))
+            if not chunk:
+                raise RuntimeError(f"{path} shorter than {size} bytes")
+            pacer.spend(len(chunk))
+            code, info = _request("PUT", remote, chunk, {
+                "Content-Type": "application/octet-stream",
+                "Content-Range": f"bytes {offset}-{offset + len(chunk) - 1}/{size}",
+                "X-Content-SHA256": sha256,
+            })
+            if code == 409:
+                # The server's copy ends elsewhere: continue from there
+                server_offset = int(info.get("size") or 0)
+                if server_offset == offset:
+                    raise RuntimeError(f"PUT {remote}: HTTP 409 at its own offset {offset}")
+                offset = server_offset
+                continue
+            if code == 422:
+                print(f"[replication] {remote}: hash mismatch upstream, will retry")
+                return False
+            if code not in (200, 201, 204):
+                raise RuntimeError(f"PUT {remote}: HTTP {code}")
+            if info.get("complete"):
+                return True
+            offset = int(info.get("size") or offset + len(chunk))
+            _set_status(current={"path": path, "bytes": offset, "size": size})
+    return False
+
+
+# -------------------------------------------------------------------
+# Passes
+# -------------------------------------------------------------------
+
+def _pending(conn: sqlite3.Connection) -> list | None:
+    """(path, kind, node, stat) of the sealed files not shipped as they
+    are now, oldest first; None while the catalog is not ready. Rows of
+    files that are gone are dropped."""
+    rows = storage_catalog.sealed_files(datetime.now().strftime("%Y%m%d_%H"))
+    if rows is None:
+        return None
+
+    shipped = _load_shipped(conn)
+    gone = set(shipped) - {row[0] for row in rows}
+    if gone:
+        conn.executemany("DELETE FROM shipped WHERE path = ?", [(path,) for path in gone])
+        conn.commit()
+
+    now = time.time()
+    pending = []
+    for path, kind, node, _hour in rows:
+        try:
+            st = os.stat(path)
+        except OSError:
+            continue
+        if st.st_size == 0 or now - st.st_mtime < REPLICATION_SETTLE_S:
+            continue
+        if shipped.get(path) == (st.st_size, st.st_mtime_ns):
+            continue
+        pending.append((path, kind, node, st))
+    return pending
+
+
+def _report_pending(pending: list) -> None:
+    oldest = min((st.st_mtime for *_, st in pending), default=None)
+    _set_status(
+        pending_files=len(pending),
+        pending_bytes=sum(st.st_size for *_, st in pending),
+        lag_s=round(time.time() - oldest, 1) if oldest is not None else 0.0,
+        oldest_pending=(datetime.fromtimestamp(oldest, timezone.utc).isoformat()
+                        if oldest is not None else None),
+    )
+
+
+def replicate_once() -> None:
+    """Ship every pending sealed file, oldest first."""
+    conn = _connect()
+    try:
+        pending = _pending(conn)
+        if pending is None:
+            _set_status(state="waiting for storage catalog", last_pass_at=_now_iso())
+            return
+        _report_pending(pending)
+        _set_status(state="shipping" if pending else "idle")
+
+        pacer = _Pacer(REPLICATION_KBPS)
+        for entry in list(pending):
+            if _stop.is_set():
+                break
+            path, kind, node, st = entry
+            remote = f"{REPLICATION_SITE}/{kind}/{node}/{os.path.basename(path)}"
+            _set_status(current={"path": path, "bytes": 0, "size": st.st_size})
+            sha256 = _sha256(path)
+            if not _ship(path, remote, st.st_size, sha256, pacer):
+                # Hash mismatch upstream (or stopping): tried again next pass
+                continue
+            _note_shipped(conn, path, st, sha256)
+            with _status_lock:
+                _status["shipped_files"] += 1
+                _status["shipped_bytes"] += st.st_size
+                _status["last_shipped_at"] = _now_iso()
+            pending.remove(entry)
+            _report_pending(pending)
+
+        _set_status(state="idle", current=None, last_pass_at=_now_iso(), last_error=None)
+    finally:
+        conn.close()
+
+
+def _run() -> None:
+    print(f"[replication] Shipping sealed files to {REPLICATION_URL} as {REPLICATION_SITE}")
+    while not _stop.is_set():
+        try:
+            replicate_once()
+        except (OSError, sqlite3.Error, RuntimeError) as e:
+            # URLError is an OSError: the uplink or the server is down
+            print(f"[replication] Pass failed: {e}")
+            _set_status(state="error", current=None, last_pass_at=_now_iso(), last_error=str(e))
+        _stop.wait(REPLICATION_INTERVAL_S)
+
+
+def start_replication() -> threading.Thread | None:
+    """Start the replication thread when SHM_REPLICATION_URL is set."""
+    global _thread
+    if not REPLICATION_URL:
+        return None
+    if _thread is None or not _thread.is_alive():
+        _stop.clear()
+        _set_status(state="starting")
+        _thread = threading.Thread(target=_run, daemon=True, name="replication")
+        _thread.start()
+    return _thread
+
+
+def stop_replication() -> None:
+    _stop.set()
@@ -2,10 +2,21 @@ from __future__ import annotations
 
 import gzip
 import io
+import os
 import struct
+import zlib
 from contextlib import ExitStack, contextmanager
+from itertools import accumulate
+from operator import itemgetter
 from typing import Dict, Generator, Any
 
+import zstd_archive
+
+try:
+    import numpy
+except ImportError:     # optional dependency: record API only without it
+    numpy = None
+
 TEMP_SCALE = 100
 ACCEL_SCALE = 10000
 INCLIN_SCALE = 10000
@@ -15,24 +26,299 @@ FLAG_ACCEL = 0x01
 FLAG_INCLIN = 0x02
 FLAG_TEMP = 0x04
 SENTINEL = 0xFF
+GAP_MARKER = 0xFE
 
 FORMAT_V1 = 1
 FORMAT_V2 = 2
 FORMAT_V3 = 3
+FORMAT_V4 = 4   # V3 + GAP records (sensor outages, encoder_storage.py)
+FORMAT_V5 = 5   # block-columnar, bit-packed accel / inclin blocks
 
-INT32_NAN_SENTINEL = -2147483648
-
-
-def read_bytes(f, n, label=""):
-    d = f.read(n)
-    if len(d) < n:
-        raise EOFError(f"EOF reading {label!r}: got {len(d)}/{n} bytes")
-    return d
-
+GAP_SENSORS = {0: "accel", 1: "inclin"}
+GAP_REASONS = {1: "disconnected", 2: "no_samples"}
 
-def read_fmt(f, fmt, label=""):
-    raw = read_bytes(f, struct.calcsize(fmt), label)
-    return struct.unpack(fmt, raw)
+INT32_NAN_SENTINEL = -2147483648
+CHANGED_TS = 0x01
+CHANGED_NAN_X = 0x10    # CHANGED_NAN_Y / _Z follow; temperature uses X
+CHANGED_NAN_TEMP = CHANGED_NAN_X
+
+# Time index sidecar (<file>.idx), written by encoder_storage.py: a version
+# byte, then offset(Q) first_ts_us(q) last_ts_us(q) flags(B) per ABSOLUTE
+# record. The offset is a byte offset in a .bin; in a .bin.gz it is a zlib
+# full-flush point (raw deflate restarts there), or a gzip member start
+# when flags has INDEX_GZ_MEMBER; in a .bin.zst it is always a frame start.
+INDEX_SUFFIX = ".idx"
+INDEX_FORMAT_VERSION = 1
+INDEX_REPLAYED = 0x80
+INDEX_GZ_MEMBER = 0x40
+_INDEX_ENTRY = struct.Struct("<QqqB")
+_ALL_SENSORS = FLAG_ACCEL | FLAG_INCLIN | FLAG_TEMP
+
+# Shared decoder for the hourly storage files: the plot endpoints, the
+# decoded export and dataStorage/decode_binary.py all read through here.
+#
+# Records are parsed out of an in-memory block with precompiled structs:
+# one iter_unpack() per run of ABSOLUTE samples, and one unpack_from() per
+# DELTA sample, whose layout is looked up by its changed mask. Parsing
+# yields raw integer rows and keeps no state, so a record torn at the end
+# of a block is simply parsed again with the next one. A row is
+#   (kind, ts, a, b, c) for accel / inclin, (kind, ts, value) for temp
+# with kind ROW_ABSOLUTE (absolute values, NaN sentinel kept), ROW_V1
+# (FORMAT_V1: ts is a delta-of-delta) or the sample's changed mask (ts and
+# values are deltas, 0 where omitted). Two APIs rebuild the samples:
+# - iter_decoded_records_for_export(): one dict per record with float
+#   tuples, sample by sample (decode_tail() likewise)
+# - iter_decoded_columns(): NumPy float64 columns per sensor for up to
+#   COLUMN_BLOCK_SAMPLES samples at a time, the deltas rebuilt as one
+#   cumulative sum per column that restarts at every absolute value
+# FORMAT_V5 accel / inclin blocks parse to a _PackedBlock instead of rows:
+# it iterates as ROW_ABSOLUTE rows for the record API and unpacks straight
+# to columns for the columnar one.
+ROW_ABSOLUTE = 0x100
+ROW_V1 = 0x200
+COLUMN_BLOCK_SAMPLES = 65536
+_READ_BLOCK_BYTES = 1 << 20
+
+_ABS_XYZ = struct.Struct("<qiii")
+_ABS_VALUE = struct.Struct("<qi")
+_V1_XYZ = struct.Struct("<ihhh")
+_V1_VALUE = struct.Struct("<ih")
+_GAP = struct.Struct("<BBqI")
+_PAD = (0, 0, 0, 0)
+_PACKED_HEAD = struct.Struct("<HqqqB")
+_PACKED_AXIS = struct.Struct("<HiiiiB")
+
+
+def _delta_layout(changed: int, nan_flags: bool) -> tuple:
+    # (struct, xyz row getter, temp row getter) of one DELTA sample. A value
+    # flagged NaN (FORMAT_V3 on) has no delta field; omitted fields are
+    # read from the zero _PAD appended to the unpacked tuple.
+    fmt = "<B"
+    slots = [0]
+    fmt += "i" if changed & CHANGED_TS else ""
+    slots.append(1 if changed & CHANGED_TS else None)
+    for axis in range(3):
+        present = changed & (0x02 << axis)
+        if nan_flags and changed & (CHANGED_NAN_X << axis):
+            present = 0
+        fmt += "h" if present else ""
+        slots.append(len(fmt) - 2 if present else None)
+    pad = len(fmt) - 1
+    slots = [pad if s is None else s for s in slots]
+    return struct.Struct(fmt), itemgetter(*slots), itemgetter(*slots[:3])
+
+
+_DELTA_V2 = tuple(_delta_layout(m, False) for m in range(256))
+_DELTA_V3 = tuple(_delta_layout(m, True) for m in range(256))
+
+
+def _parse_xyz(buf: bytes, view: memoryview, pos: int, n: int, fv: int, absolute: bool, layouts):
+    if absolute:
+        end = pos + n * _ABS_XYZ.size
+        if end > len(buf):
+            raise struct.error("record ends past the block")
+        return [(ROW_ABSOLUTE,) + s for s in _ABS_XYZ.iter_unpack(view[pos:end])], end
+    if fv == FORMAT_V1:
+        end = pos + n * _V1_XYZ.size
+        if end > len(buf):
+            raise struct.error("record ends past the block")
+        return [(ROW_V1,) + s for s in _V1_XYZ.iter_unpack(view[pos:end])], end
+
+    rows = []
+    append = rows.append
+    for _ in range(n):
+        st, xyz, _temp = layouts[buf[pos]]
+        append(xyz(st.unpack_from(buf, pos) + _PAD))
+        pos += st.size
+    return rows, pos
+
+
+def _unpack_deltas(packed, n: int, base: int, bits: int, start: int) -> list:
+    """start and the running sum of the n frame-of-reference deltas in
+    packed (see encoder_storage.FORMAT_V5)."""
+    if not bits:
+        return [start + k * base for k in range(n + 1)]
+    acc = int.from_bytes(packed, "little")
+    mask = (1 << bits) - 1
+    return list(accumulate([base + (acc >> shift & mask) for shift in range(0, n * bits, bits)], initial=start))
+
+
+def _unpack_deltas_numpy(packed, n: int, base: int, bits: int, start: int):
+    if bits:
+        flat = numpy.unpackbits(numpy.frombuffer(packed, dtype=numpy.uint8), bitorder="little")
+        weights = numpy.left_shift(1, numpy.arange(bits, dtype=numpy.int64))
+        deltas = flat[:n * bits].reshape(n, bits).astype(numpy.int64) @ weights + base
+    else:
+        deltas = numpy.full(n, base, dtype=numpy.int64)
+    out = numpy.empty(n + 1, dtype=numpy.int64)
+    out[0] = start
+    numpy.cumsum(deltas, out=out[1:])
+    out[1:] += start
+    return out
+
+
+class _PackedBlock:
+    """A FORMAT_V5 accel / inclin block: header fields and payload views."""
+
+    __slots__ = ("count", "first_us", "last_us", "ts_base", "ts_bits", "ts_packed", "axes")
+
+    def __len__(self):
+        return self.count
+
+    def __iter__(self):
+        count = self.count
+        if not count:
+            return iter(())
+        ts = _unpack_deltas(self.ts_packed, count - 1, self.ts_base, self.ts_bits, self.first_us)
+        columns = []
+        for (valid, first, base, bits), nan_map, packed in self.axes:
+            values = _unpack_deltas(packed, valid - 1, base, bits, first) if valid else []
+            if nan_map is not None:
+                nan = int.from_bytes(nan_map, "little")
+                it = iter(values)
+                values = [INT32_NAN_SENTINEL if nan >> k & 1 else next(it) for k in range(count)]
+            columns.append(values)
+        return iter([(ROW_ABSOLUTE,) + row for row in zip(ts, *columns)])
+
+    def columns(self, scale: int) -> tuple:
+        """(ts_s, a, b, c) float64 columns, NaN where missing."""
+        count = self.count
+        out = [_unpack_deltas_numpy(self.ts_packed, count - 1, self.ts_base, self.ts_bits, self.first_us) / TS_SCALE]
+        for (valid, first, base, bits), nan_map, packed in self.axes:
+            values = _unpack_deltas_numpy(packed, valid - 1, base, bits, first) / scale if valid else None
+            if nan_map is None:
+                out.append(values)
+                continue
+            column = numpy.full(count, numpy.nan)
+            if values is not None:
+                nan = numpy.unpackbits(numpy.frombuffer(nan_map, dtype=numpy.uint8), bitorder="little")
+                column[nan[:count] == 0] = values
+            out.append(column)
+        return tuple(out)
+
+
+def _parse_packed(buf: bytes, view: memoryview, pos: int):
+    block = _PackedBlock()
+    block.count, block.first_us, block.last_us, block.ts_base, block.ts_bits = _PACKED_HEAD.unpack_from(buf, pos)
+    pos += _PACKED_HEAD.size
+    count = block.count
+    heads = []
+    for _ in range(3):
+        valid, first, _mn, _mx, base, bits = _PACKED_AXIS.unpack_from(buf, pos)
+        heads.append((valid, first, base, bits))
+        pos += _PACKED_AXIS.size
+
+    map_size = (count + 7) // 8
+    nan_maps = []
+    for valid, _first, _base, _bits in heads:
+        if valid < count:
+            nan_maps.append(view[pos:pos + map_size])
+            pos += map_size
+        else:
+            nan_maps.append(None)
+
+    end = pos + (max(0, count - 1) * block.ts_bits + 7) // 8
+    block.ts_packed = view[pos:end]
+    pos = end
+    payloads = []
+    for valid, _first, _base, bits in heads:
+        end = pos + (max(0, valid - 1) * bits + 7) // 8
+        payloads.append(view[pos:end])
+        pos = end
+    if pos > len(buf):
+        raise struct.error("record ends past the block")
+    block.axes = list(zip(heads, nan_maps, payloads))
+    return block, pos
+
+
+def _parse_temp(buf: bytes, pos: int, fv: int, absolute: bool, layouts):
+    if absolute:
+        return (ROW_ABSOLUTE,) + _ABS_VALUE.unpack_from(buf, pos), pos + _ABS_VALUE.size
+    if fv == FORMAT_V1:
+        return (ROW_V1,) + _V1_VALUE.unpack_from(buf, pos), pos + _V1_VALUE.size
+    st, _xyz, temp = layouts[buf[pos]]
+    return temp(st.unpack_from(buf, pos) + _PAD), pos + st.size
+
+
+def _parse_record(buf: bytes, view: memoryview, pos: int, fv: int, layouts):
+    """
+    (raw record, end offset) of the record at buf[pos]. Raw records are
+    ("GAP", gap dict) or (record type, accel rows, inclin rows, temp row),
+    None for absent sensors. Raises IndexError / struct.error when the
+    block ends inside the record.
+    """
+    sentinel = buf[pos]
+    pos += 1
+    if sentinel == GAP_MARKER and fv >= FORMAT_V3:
+        sensor, reason, start_us, dur_us = _GAP.unpack_from(buf, pos)
+        gap = {
+            "sensor": GAP_SENSORS.get(sensor, "unknown"),
+            "reason": GAP_REASONS.get(reason, "unknown"),
+            "start_s": start_us / TS_SCALE,
+            "dur_s": dur_us / TS_SCALE,
+        }
+        return ("GAP", gap), pos + _GAP.size
+
+    absolute = sentinel == SENTINEL
+    if absolute:
+        header = buf[pos]
+        pos += 1
+    else:
+        header = sentinel
+
+    accel = inclin = temp = None
+    if fv >= FORMAT_V5:
+        # Self-contained blocks in both record types
+        if header & FLAG_ACCEL:
+            accel, pos = _parse_packed(buf, view, pos)
+        if header & FLAG_INCLIN:
+            inclin, pos = _parse_packed(buf, view, pos)
+        if header & FLAG_TEMP:
+            temp, pos = _parse_temp(buf, pos, fv, True, layouts)
+        return ("ABSOLUTE" if absolute else "DELTA", accel, inclin, temp), pos
+
+    if header & FLAG_ACCEL:
+        accel, pos = _parse_xyz(buf, view, pos + 1, buf[pos], fv, absolute, layouts)
+    if header & FLAG_INCLIN:
+        # One sample without a count before FORMAT_V3's bursts
+        if fv >= FORMAT_V3:
+            inclin, pos = _parse_xyz(buf, view, pos + 1, buf[pos], fv, absolute, layouts)
+        else:
+            inclin, pos = _parse_xyz(buf, view, pos, 1, fv, absolute, layouts)
+    if header & FLAG_TEMP:
+        temp, pos = _parse_temp(buf, pos, fv, absolute, layouts)
+    return ("ABSOLUTE" if absolute else "DELTA", accel, inclin, temp), pos
+
+
+def _iter_raw(buf: bytes, pos: int, fv: int):
+    """(raw record, end offset) of every complete record from buf[pos:]."""
+    view = memoryview(buf)
+    layouts = _DELTA_V3 if fv >= FORMAT_V3 else _DELTA_V2
+    size = len(buf)
+    while pos < size:
+        try:
+            raw, pos = _parse_record(buf, view, pos, fv, layouts)
+        except (IndexError, struct.error):
+            return
+        yield raw, pos
+
+
+def _iter_stream_raw(f, fv: int):
+    """(raw record, None) of a whole stream, read _READ_BLOCK_BYTES at a
+    time. A truncated tail record (active or interrupted file) just ends
+    the output, as in the frontend decoder."""
+    pending = b""
+    while True:
+        block = f.read(_READ_BLOCK_BYTES)
+        buf = pending + block if pending else block
+        if not buf:
+            return
+        end = 0
+        for raw, end in _iter_raw(buf, 0, fv):
+            yield raw, None
+        if not block:
+            return
+        pending = buf[end:]
 
 
 def _fresh_sensor_state():
@@ -52,393 +338,178 @@ def _fresh_decode_state():
     }
 
 
-def _reconstruct_abs_ts(f, ss: dict) -> int:
-    (ts_us,) = read_fmt(f, "<q", "abs timestamp")
-    ss["ts_us"] = ts_us
-    return ts_us
-
-
-def _decode_abs_value(raw: int, scale: int):
-    if raw == INT32_NAN_SENTINEL:
-        return None
-    return raw / scale
-
-
-def _v1_reconstruct_ts(f, ss: dict) -> int:
-    (dod,) = read_fmt(f, "<i", "v1 dod_ts")
-    delta_us = ss.get("ts_delta_prev", 0) + dod
-    ts_us = ss["ts_us"] + delta_us
-    ss["ts_us"] = ts_us
-    ss["ts_delta_prev"] = delta_us
-    return ts_us
-
-
-def _decode_accel_abs(f, state):
-    (n,) = read_fmt(f, "<B", "accel n")
-    out = []
-    prev = list(state["accel"]["xyz_prev"])
-
-    for _ in range(n):
-        ts_us = _reconstruct_abs_ts(f, state["accel"])
-        x, y, z = read_fmt(f, "<iii", "accel abs xyz")
-
-        x_value = _decode_abs_value(x, ACCEL_SCALE)
-        y_value = _decode_abs_value(y, ACCEL_SCALE)
-        z_value = _decode_abs_value(z, ACCEL_SCALE)
-
-        if x_value is not None:
-            prev[0] = x
-        if y_value is not None:
-            prev[1] = y
-        if z_value is not None:
-            prev[2] = z
-
-        out.append(
-            (
-                ts_us / TS_SCALE,
-                x_value,
-                y_value,
-                z_value,
-            )
-        )
-
-    state["accel"]["xyz_prev"] = prev
-    return out or None
-
-
-def _decode_accel_delta_v1(f, state):
-    (n,) = read_fmt(f, "<B", "accel n")
-    out = []
-    ss = state["accel"]
-    prev = ss["xyz_prev"]
-
-    for _ in range(n):
-        ts_us = _v1_reconstruct_ts(f, ss)
-        dx, dy, dz = read_fmt(f, "<hhh", "accel delta xyz")
-        cur = [prev[0] + dx, prev[1] + dy, prev[2] + dz]
-
-        out.append(
-            (
-                ts_us / TS_SCALE,
-                cur[0] / ACCEL_SCALE,
-                cur[1] / ACCEL_SCALE,
-                cur[2] / ACCEL_SCALE,
-            )
-        )
-
-        prev = cur
-
-    ss["xyz_prev"] = prev
-    return out or None
-
-
-def _decode_accel_delta(f, state):
-    (n,) = read_fmt(f, "<B", "accel n")
-    out = []
-    ss = state["accel"]
-    prev = ss["xyz_prev"]
-
-    for _ in range(n):
-        (changed,) = read_fmt(f, "<B", "accel changed")
-
-        if changed & 0x01:
-            (delta_us,) = read_fmt(f, "<i", "accel delta_ts")
-            ts_us = ss["ts_us"] + delta_us
-            ss["ts_us"] = ts_us
-        else:
-            ts_us = ss["ts_us"]
-
-        dx = read_fmt(f, "<h", "accel dx")[0] if changed & 0x02 else 0
-        dy = read_fmt(f, "<h", "accel dy")[0] if changed & 0x04 else 0
-        dz = read_fmt(f, "<h", "accel dz")[0] if changed & 0x08 else 0
-
-        cur = [prev[0] + dx, prev[1] + dy, prev[2] + dz]
-
-        out.append(
-            (
-                ts_us / TS_SCALE,
-                cur[0] / ACCEL_SCALE,
-                cur[1] / ACCEL_SCALE,
-                cur[2] / ACCEL_SCALE,
-            )
-        )
-
-        prev = cur
-
-    ss["xyz_prev"] = prev
-    return out or None
-
-
-
-def _decode_accel_delta_v3(f, state):
-    (n,) = read_fmt(f, "<B", "accel n")
+# Record API
+def _apply_xyz(rows: list, ss: dict, scale: int) -> list:
+    """(ts_s, a, b, c) samples of parsed rows (None for NaN); updates ss."""
+    ts_us = ss["ts_us"]
+    delta_prev = ss["ts_delta_prev"]
+    a, b, c = ss["xyz_prev"]
     out = []
-    ss = state["accel"]
-    prev = ss["xyz_prev"]
-
-    for _ in range(n):
-        (changed,) = read_fmt(f, "<B", "accel changed")
-
-        if changed & 0x01:
-            (delta_us,) = read_fmt(f, "<i", "accel delta_ts")
-            ts_us = ss["ts_us"] + delta_us
-            ss["ts_us"] = ts_us
+    append = out.append
+
+    for kind, t, da, db, dc in rows:
+        if kind == ROW_ABSOLUTE:
+            ts_us = t
+            nan = 0
+            if da == INT32_NAN_SENTINEL:
+                nan |= 0x10
+            else:
+                a = da
+            if db == INT32_NAN_SENTINEL:
+                nan |= 0x20
+            else:
+                b = db
+            if dc == INT32_NAN_SENTINEL:
+                nan |= 0x40
+            else:
+                c = dc
+        elif kind == ROW_V1:
+            delta_prev += t
+            ts_us += delta_prev
+            a += da
+            b += db
+            c += dc
+            nan = 0
         else:
-            ts_us = ss["ts_us"]
-
-        if changed & 0x10:
-            x = None
-        else:
-            dx = read_fmt(f, "<h", "accel dx")[0] if changed & 0x02 else 0
-            x = prev[0] + dx
-
-        if changed & 0x20:
-            y = None
-        else:
-            dy = read_fmt(f, "<h", "accel dy")[0] if changed & 0x04 else 0
-            y = prev[1] + dy
-
-        if changed & 0x40:
-            z = None
-        else:
-            dz = read_fmt(f, "<h", "accel dz")[0] if changed & 0x08 else 0
-            z = prev[2] + dz
-
-        out.append(
-            (
-                ts_us / TS_SCALE,
-                None if x is None else x / ACCEL_SCALE,
-                None if y is None else y / ACCEL_SCALE,
-                None if z is None else z / ACCEL_SCALE,
-            )
-        )
-
-        prev = [
-            prev[0] if x is None else x,
-            prev[1] if y is None else y,
-            prev[2] if z is None else z,
-        ]
-
-    ss["xyz_prev"] = prev
-    return out or None
-
-
-def _decode_inclin_abs(f, state):
-    ts_us = _reconstruct_abs_ts(f, state["inclin"])
-    roll, pitch, yaw = read_fmt(f, "<iii", "inclin abs")
-    state["inclin"]["xyz_prev"] = [roll, pitch, yaw]
-
-    return (
-        ts_us / TS_SCALE,
-        roll / INCLIN_SCALE,
-        pitch / INCLIN_SCALE,
-        yaw / INCLIN_SCALE,
-    )
-
-
-def _decode_inclin_abs_v3(f, state):
-    (n,) = read_fmt(f, "<B", "inclin n")
-    out = []
-    prev = list(state["inclin"]["xyz_prev"])
-
-    for _ in range(n):
-        ts_us = _reconstruct_abs_ts(f, state["inclin"])
-        roll, pitch, yaw = read_fmt(f, "<iii", "inclin abs")
-
-        roll_value = _decode_abs_value(roll, INCLIN_SCALE)
-        pitch_value = _decode_abs_value(pitch, INCLIN_SCALE)
-        yaw_value = _decode_abs_value(yaw, INCLIN_SCALE)
-
-        if roll_value is not None:
-            prev[0] = roll
-        if pitch_value is not None:
-            prev[1] = pitch
-        if yaw_value is not None:
-            prev[2] = yaw
-
-        out.append(
-            (
-                ts_us / TS_SCALE,
-                roll_value,
-                pitch_value,
-                yaw_value,
-            )
-        )
-
-    state["inclin"]["xyz_prev"] = prev
-    return out or None
-
-
-def _decode_inclin_delta_v1(f, state):
-    ss = state["inclin"]
-    ts_us = _v1_reconstruct_ts(f, ss)
-    dr, dp, dy = read_fmt(f, "<hhh", "inclin delta")
-    prev = ss["xyz_prev"]
-    cur = [prev[0] + dr, prev[1] + dp, prev[2] + dy]
-    ss["xyz_prev"] = cur
-
-    return (
-        ts_us / TS_SCALE,
-        cur[0] / INCLIN_SCALE,
-        cur[1] / INCLIN_SCALE,
-        cur[2] / INCLIN_SCALE,
-    )
-
-
-def _decode_inclin_delta(f, state):
-    ss = state["inclin"]
-    (changed,) = read_fmt(f, "<B", "inclin changed")
-
-    if changed & 0x01:
-        (delta_us,) = read_fmt(f, "<i", "inclin delta_ts")
-        ts_us = ss["ts_us"] + delta_us
-        ss["ts_us"] = ts_us
-    else:
-        ts_us = ss["ts_us"]
-
-    prev = ss["xyz_prev"]
-    dr = read_fmt(f, "<h", "inclin dr")[0] if changed & 0x02 else 0
-    dp = read_fmt(f, "<h", "inclin dp")[0] if changed & 0x04 else 0
-    dy = read_fmt(f, "<h", "inclin dy")[0] if changed & 0x08 else 0
-
-    cur = [prev[0] + dr, prev[1] + dp, prev[2] + dy]
-    ss["xyz_prev"] = cur
-
-    return (
-        ts_us / TS_SCALE,
-        cur[0] / INCLIN_SCALE,
-        cur[1] / INCLIN_SCALE,
-        cur[2] / INCLIN_SCALE,
-    )
-
-
-
-def _decode_inclin_delta_v3(f, state):
-    (n,) = read_fmt(f, "<B", "inclin n")
-    out = []
-    ss = state["inclin"]
-    prev = ss["xyz_prev"]
-
-    for _ in range(n):
-        (changed,) = read_fmt(f, "<B", "inclin changed")
-
-        if changed & 0x01:
-            (delta_us,) = read_fmt(f, "<i", "inclin delta_ts")
-            ts_us = ss["ts_us"] + delta_us
-            ss["ts_us"] = ts_us
-        else:
-            ts_us = ss["ts_us"]
-
-        if changed & 0x10:
-            roll = None
-        else:
-            dr = read_fmt(f, "<h", "inclin dr")[0] if changed & 0x02 else 0
-            roll = prev[0] + dr
-
-        if changed & 0x20:
-            pitch = None
-        else:
-            dp = read_fmt(f, "<h", "inclin dp")[0] if changed & 0x04 else 0
-            pitch = prev[1] + dp
-
-        if changed & 0x40:
-            yaw = None
-        else:
-            dy = read_fmt(f, "<h", "inclin dy")[0] if changed & 0x08 else 0
-            yaw = prev[2] + dy
-
-        out.append(
-            (
-                ts_us / TS_SCALE,
-                None if roll is None else roll / INCLIN_SCALE,
-                None if pitch is None else pitch / INCLIN_SCALE,
-                None if yaw is None else yaw / INCLIN_SCALE,
-            )
-        )
-
-        prev = [
-            prev[0] if roll is None else roll,
-            prev[1] if pitch is None else pitch,
-            prev[2] if yaw is None else yaw,
-        ]
-
-    ss["xyz_prev"] = prev
-    return out or None
-
-
-def _decode_temp_abs(f, state):
-    ts_us = _reconstruct_abs_ts(f, state["temp"])
-    (val,) = read_fmt(f, "<i", "temp abs")
-
-    value = _decode_abs_value(val, TEMP_SCALE)
-    if value is not None:
-        state["temp"]["val_prev"] = val
-
-    return (
-        ts_us / TS_SCALE,
-        value,
-    )
-
-
-def _decode_temp_delta_v1(f, state):
-    ss = state["temp"]
-    ts_us = _v1_reconstruct_ts(f, ss)
-    (dt,) = read_fmt(f, "<h", "temp delta")
-    val = ss["val_prev"] + dt
-    ss["val_prev"] = val
-
-    return (
-        ts_us / TS_SCALE,
-        val / TEMP_SCALE,
-    )
-
-
-def _decode_temp_delta(f, state):
-    ss = state["temp"]
-    (changed,) = read_fmt(f, "<B", "temp changed")
+            # A NaN flagged value had no delta: da etc. are 0 and the
+            # previous value carries on
+            ts_us += t
+            a += da
+            b += db
+            c += dc
+            nan = kind & 0x70
+
+        append((
+            ts_us / TS_SCALE,
+            None if nan & 0x10 else a / scale,
+            None if nan & 0x20 else b / scale,
+            None if nan & 0x40 else c / scale,
+        ))
 
-    if changed & 0x01:
-        (delta_us,) = read_fmt(f, "<i", "temp delta_ts")
-        ts_us = ss["ts_us"] + delta_us
-        ss["ts_us"] = ts_us
+    ss["ts_us"] = ts_us
+    ss["ts_delta_prev"] = delta_prev
+    ss["xyz_prev"] = [a, b, c]
+    return out
+
+
+def _apply_temp(row: tuple, ss: dict) -> tuple:
+    kind, t, dv = row
+    if kind == ROW_ABSOLUTE:
+        ss["ts_us"] = t
+        if dv == INT32_NAN_SENTINEL:
+            return (t / TS_SCALE, None)
+        ss["val_prev"] = dv
+    elif kind == ROW_V1:
+        ss["ts_delta_prev"] += t
+        ss["ts_us"] += ss["ts_delta_prev"]
+        ss["val_prev"] += dv
     else:
-        ts_us = ss["ts_us"]
-
-    if changed & 0x02:
-        (dt,) = read_fmt(f, "<h", "temp dval")
-        ss["val_prev"] = ss["val_prev"] + dt
-
-    return (
-        ts_us / TS_SCALE,
-        ss["val_prev"] / TEMP_SCALE,
-    )
+        ss["ts_us"] += t
+        if kind & CHANGED_NAN_TEMP:
+            return (ss["ts_us"] / TS_SCALE, None)
+        ss["val_prev"] += dv
+    return (ss["ts_us"] / TS_SCALE, ss["val_prev"] / TEMP_SCALE)
 
 
-def _decode_temp_delta_v3(f, state):
-    ss = state["temp"]
-    (changed,) = read_fmt(f, "<B", "temp changed")
-
-    if changed & 0x01:
-        (delta_us,) = read_fmt(f, "<i", "temp delta_ts")
-        ts_us = ss["ts_us"] + delta_us
-        ss["ts_us"] = ts_us
-    else:
-        ts_us = ss["ts_us"]
+def _apply_raw(raw: tuple, state: dict, idx: int, resynced: int) -> tuple:
+    """
+    (record dict, resynced) of one raw record.
 
-    if changed & 0x04:
-        return (
-            ts_us / TS_SCALE,
-            None,
+    resynced holds the sensors whose delta state is valid. A reader that
+    started at an index entry only has the sensors of that ABSOLUTE record;
+    the others are returned as None until an ABSOLUTE record carries them.
+    """
+    if raw[0] == "GAP":
+        return {
+            "record_index": idx,
+            "record_type": "GAP",
+            "accel_samples": None,
+            "inclin": None,
+            "temp": None,
+            "gap": raw[1],
+        }, resynced
+
+    record_type, accel, inclin, temp = raw
+    rec = {
+        "record_index": idx,
+        "record_type": record_type,
+        "accel_samples": None,
+        "inclin": None,
+        "temp": None,
+    }
+    if record_type == "ABSOLUTE":
+        resynced |= (
+            (FLAG_ACCEL if accel is not None else 0)
+            | (FLAG_INCLIN if inclin is not None else 0)
+            | (FLAG_TEMP if temp is not None else 0)
         )
 
-    if changed & 0x02:
-        (dt,) = read_fmt(f, "<h", "temp dval")
-        ss["val_prev"] = ss["val_prev"] + dt
-
-    return (
-        ts_us / TS_SCALE,
-        ss["val_prev"] / TEMP_SCALE,
-    )
+    if accel is not None:
+        samples = _apply_xyz(accel, state["accel"], ACCEL_SCALE)
+        if resynced & FLAG_ACCEL:
+            rec["accel_samples"] = samples or None
+    if inclin is not None:
+        samples = _apply_xyz(inclin, state["inclin"], INCLIN_SCALE)
+        if resynced & FLAG_INCLIN:
+            rec["inclin"] = samples or None
+    if temp is not None:
+        sample = _apply_temp(temp, state["temp"])
+        if resynced & FLAG_TEMP:
+            rec["temp"] = sample
+    return rec, resynced
+
+
+# Columnar API
+def columns_available() -> bool:
+    return numpy is not None
+
+
+def _restarting_cumsum(delta, restart, start_values, carry: int):
+    """Running sum of delta from carry that restarts at start_values
+    wherever restart is set (delta must be 0 there)."""
+    total = numpy.cumsum(delta)
+    last = numpy.maximum.accumulate(numpy.where(restart, numpy.arange(len(total)), -1))
+    return total + numpy.where(last >= 0, (start_values - total)[last], carry)
+
+
+def _sensor_columns(rows: list, ss: dict, scale: int, width: int, synced: bool, fv: int):
+    """(columns, synced) of a block's rows of one sensor: ts_s then width
+    value columns, NaN where missing; updates ss like the record API."""
+    if fv == FORMAT_V1:
+        # Delta-of-delta timestamps: rebuilt sample by sample
+        if width == 1:
+            samples = [_apply_temp(row, ss) for row in rows]
+        else:
+            samples = _apply_xyz(rows, ss, scale)
+        return tuple(numpy.array(samples, dtype=numpy.float64).T), synced
+
+    arr = numpy.array(rows, dtype=numpy.int64)
+    kind = arr[:, 0]
+    absolute = kind == ROW_ABSOLUTE
+    relative = ~absolute
+
+    ts_us = _restarting_cumsum(numpy.where(absolute, 0, arr[:, 1]), absolute, arr[:, 1], ss["ts_us"])
+    ss["ts_us"] = int(ts_us[-1])
+    columns = [ts_us / TS_SCALE]
+
+    prev = ss["xyz_prev"] if width == 3 else [ss["val_prev"]]
+    for axis in range(width):
+        raw = arr[:, 2 + axis]
+        abs_nan = absolute & (raw == INT32_NAN_SENTINEL)
+        values = _restarting_cumsum(numpy.where(absolute, 0, raw), absolute & ~abs_nan, raw, prev[axis])
+        prev[axis] = int(values[-1])
+        column = values / scale
+        column[abs_nan | (relative & ((kind & (CHANGED_NAN_X << axis)) != 0))] = numpy.nan
+        columns.append(column)
+    if width == 1:
+        ss["val_prev"] = prev[0]
+
+    if not synced:
+        # Rows before the sensor's first ABSOLUTE sample have no base
+        keep = numpy.maximum.accumulate(absolute)
+        columns = [c[keep] for c in columns]
+        synced = bool(keep[-1])
+    return tuple(columns), synced
 
 
 @contextmanager
@@ -449,6 +520,7 @@ def open_record_stream(filepath: str):
     Supported:
     - .bin
     - .bin.gz
+    - .bin.zst (needs the zstandard package)
 
     This matches the frontend decoder's file support while keeping backend
     RAM usage low by streaming instead of fully decompressing into memory.
@@ -458,28 +530,171 @@ def open_record_stream(filepath: str):
             gzip_file = stack.enter_context(gzip.open(filepath, "rb"))
             buffered = io.BufferedReader(gzip_file)
             yield buffered
+        elif filepath.endswith(".zst"):
+            raw_file = stack.enter_context(open(filepath, "rb"))
+            zst_file = stack.enter_context(zstd_archive.stream_reader(raw_file))
+            yield io.BufferedReader(zst_file)
         else:
             raw_file = stack.enter_context(open(filepath, "rb"))
             buffered = io.BufferedReader(raw_file)
             yield buffered
 
 
-def iter_decoded_records_for_export(
-    filepath: str,
-) -> Generator[Dict[str, Any], None, None]:
+def load_time_index(filepath: str) -> list[tuple]:
+    """
+    Index entries (offset, first_s, last_s, flags) of a storage file, in
+    file order. Entries past the end of the data file (not flushed yet, or
+    a torn tail) are left out; [] when there is no index.
     """
-    Streaming decoder used by the backend plot endpoints.
+    try:
+        with open(filepath + INDEX_SUFFIX, "rb") as f:
+            raw = f.read()
+        size = os.path.getsize(filepath)
+    except OSError:
+        return []
+    if not raw or raw[0] != INDEX_FORMAT_VERSION:
+        return []
+
+    usable = 1 + (len(raw) - 1) // _INDEX_ENTRY.size * _INDEX_ENTRY.size
+    entries = []
+    last_offset = 0
+    for offset, first_us, last_us, flags in _INDEX_ENTRY.iter_unpack(raw[1:usable]):
+        if offset <= last_offset or offset >= size:
+            continue
+        entries.append((offset, first_us / TS_SCALE, last_us / TS_SCALE, flags))
+        last_offset = offset
+    return entries
+
+
+def _index_runs(entries: list, start_s: float, end_s: float) -> list[tuple]:
+    """
+    Byte ranges (start, end or None for EOF, flags of the first entry)
+    covering the window, with adjacent segments merged so their delta state
+    carries over.
+
+    A live segment runs from its ABSOLUTE record to the next entry and its
+    samples end by the next live entry's first time (a live ABSOLUTE is
+    forced at least every ABSOLUTE_RECORD_INTERVAL_S). A replayed segment
+    spans only its own record's times. A run whose first record lacks a
+    sensor the file has (temperature only rides along when the packet had
+    it) starts at earlier entries until every sensor is resynced.
+    """
+    wanted = set()
+    for i, (offset, first_s, last_s, flags) in enumerate(entries):
+        if flags & INDEX_REPLAYED:
+            seg_end_s = last_s
+        else:
+            seg_end_s = float("inf")
+            for later in entries[i + 1:]:
+                if not later[3] & INDEX_REPLAYED:
+                    seg_end_s = max(last_s, later[1])
+                    break
+        if first_s < end_s and seg_end_s >= start_s:
+            wanted.add(i)
+
+    sensors = 0
+    for entry in entries:
+        sensors |= entry[3] & _ALL_SENSORS
+    for i in sorted(wanted):
+        if i - 1 in wanted:
+            continue
+        covered = entries[i][3] & _ALL_SENSORS
+        j = i - 1
+        while covered != sensors and j >= 0 and j not in wanted:
+            wanted.add(j)
+            covered |= entries[j][3] & _ALL_SENSORS
+            j -= 1
+
+    runs = []
+    for i in sorted(wanted):
+        offset, flags = entries[i][0], entries[i][3]
+        end = entries[i + 1][0] if i + 1 < len(entries) else None
+        if runs and runs[-1][1] == offset:
+            runs[-1] = (runs[-1][0], end, runs[-1][2])
+        else:
+            runs.append((offset, end, flags))
+    return runs
 
-    This now matches the frontend decoder behavior more closely:
-    - supports .bin and .bin.gz
-    - supports FORMAT_V1, FORMAT_V2, and FORMAT_V3
-    - tolerates a truncated tail record by stopping cleanly
-    - yields one decoded record at a time for low-memory processing
 
-    Export no longer uses this path. Raw export packages the storage files
-    directly without decoding.
+def _inflate_from(chunk: bytes, member_start: bool) -> bytes:
     """
-    state = _fresh_decode_state()
+    Inflate from a full-flush point (raw deflate) or a gzip member start,
+    on through any members appended after it. A torn or still-growing tail
+    just ends the output.
+    """
+    out = []
+    raw_deflate = not member_start
+    d = zlib.decompressobj(-zlib.MAX_WBITS if raw_deflate else 16 + zlib.MAX_WBITS)
+    try:
+        while chunk:
+            out.append(d.decompress(chunk))
+            if not d.eof:
+                break
+            chunk = d.unused_data
+            if raw_deflate:
+                chunk = chunk[8:]       # CRC32 + ISIZE of the member joined mid-way
+                raw_deflate = False
+            if not chunk.startswith(b"\x1f\x8b"):
+                break
+            d = zlib.decompressobj(16 + zlib.MAX_WBITS)
+    except zlib.error:
+        pass
+    return b"".join(out)
+
+
+def _indexed_runs(filepath: str, entries: list, start_s: float, end_s: float):
+    """Runs of the indexed segments covering the window (see _iter_runs());
+    returns False (having yielded nothing) when the file cannot be read
+    through its index."""
+    gz = filepath.endswith(".gz") or filepath.endswith(".gzip")
+    zst = filepath.endswith(".zst")
+
+    with open(filepath, "rb") as raw:
+        head = raw.read(entries[0][0])
+        if gz:
+            head = _inflate_from(head, member_start=True)
+        elif zst:
+            head = zstd_archive.decompress_frames(head)
+        if not head or head[0] not in (FORMAT_V3, FORMAT_V4, FORMAT_V5):
+            return False
+        fv = head[0]
+        # FORMAT_V5 records need no earlier ABSOLUTE record
+        fresh = _ALL_SENSORS if fv >= FORMAT_V5 else 0
+
+        if len(head) > 1:
+            # Records from before the first entry have no index times:
+            # decode them all
+            yield fv, _ALL_SENSORS, _iter_raw(head, 1, fv)
+
+        for begin, end, flags in _index_runs(entries, start_s, end_s):
+            raw.seek(begin)
+            chunk = raw.read() if end is None else raw.read(end - begin)
+            if gz:
+                chunk = _inflate_from(chunk, member_start=bool(flags & INDEX_GZ_MEMBER))
+            elif zst:
+                chunk = zstd_archive.decompress_frames(chunk)
+            yield fv, (flags & _ALL_SENSORS) | fresh, _iter_raw(chunk, 0, fv)
+    return True
+
+
+def _iter_runs(filepath: str, start_s: float | None, end_s: float | None):
+    """
+    (format version, resynced sensors, raw record iterator) per stretch of
+    the file that decodes from a fresh state: the indexed segments covering
+    [start_s, end_s) when a window is given and the file has a time index,
+    else the whole file as one stream.
+    """
+    if start_s is not None or end_s is not None:
+        entries = load_time_index(filepath)
+        if entries:
+            indexed = yield from _indexed_runs(
+                filepath,
+                entries,
+                float("-inf") if start_s is None else start_s,
+                float("inf") if end_s is None else end_s,
+            )
+            if indexed:
+                return
 
     with open_record_stream(filepath) as f:
         ver = f.read(1)
@@ -487,80 +702,182 @@ def iter_decoded_records_for_export(
             return
 
         fv = ver[0]
-        if fv not in (FORMAT_V1, FORMAT_V2, FORMAT_V3):
+        if fv not in (FORMAT_V1, FORMAT_V2, FORMAT_V3, FORMAT_V4, FORMAT_V5):
             # Legacy file with no explicit version byte.
             f.seek(-1, 1)
             fv = FORMAT_V1
 
-        idx = 0
+        yield fv, _ALL_SENSORS, _iter_stream_raw(f, fv)
 
-        while True:
-            b = f.read(1)
-            if not b:
-                break
 
-            sentinel = b[0]
-
-            try:
-                if sentinel == SENTINEL:
-                    (header,) = read_fmt(f, "<B", "abs header")
-                    rec = {
-                        "record_index": idx,
-                        "record_type": "ABSOLUTE",
-                        "accel_samples": None,
-                        "inclin": None,
-                        "temp": None,
-                    }
-
-                    if header & FLAG_ACCEL:
-                        rec["accel_samples"] = _decode_accel_abs(f, state)
-                    if header & FLAG_INCLIN:
-                        if fv == FORMAT_V3:
-                            rec["inclin"] = _decode_inclin_abs_v3(f, state)
-                        else:
-                            rec["inclin"] = _decode_inclin_abs(f, state)
-                    if header & FLAG_TEMP:
-                        rec["temp"] = _decode_temp_abs(f, state)
+def iter_decoded_records_for_export(
+    filepath: str,
+    start_s: float | None = None,
+    end_s: float | None = None,
+) -> Generator[Dict[str, Any], None, None]:
+    """
+    Record API: one decoded record at a time, for low-memory processing.
+
+    - supports .bin, .bin.gz and .bin.zst
+    - supports FORMAT_V1 to FORMAT_V5; a GAP record (V4 on, or a V3 file
+      resumed after the upgrade) is yielded with record_type "GAP" and
+      "gap": {"sensor", "reason", "start_s", "dur_s"}
+    - accel_samples and inclin are lists of (ts_s, x, y, z) /
+      (ts_s, roll, pitch, yaw), temp is (ts_s, value), None for NaN values
+    - tolerates a truncated tail record by stopping cleanly
+
+    With start_s / end_s and a time index next to the file, only the
+    segments that can hold samples in [start_s, end_s) are decoded (the
+    caller still filters samples by time) and record_index counts the
+    yielded records. Without an index the whole file is decoded.
+    """
+    idx = 0
+    for fv, resynced, raws in _iter_runs(filepath, start_s, end_s):
+        state = _fresh_decode_state()
+        for raw, _end in raws:
+            rec, resynced = _apply_raw(raw, state, idx, resynced)
+            yield rec
+            idx += 1
+
+
+def iter_decoded_columns(
+    filepath: str,
+    start_s: float | None = None,
+    end_s: float | None = None,
+) -> Generator[Dict[str, Any], None, None]:
+    """
+    Columnar API: the samples of consecutive records as blocks
+        {"accel": (ts_s, x, y, z), "inclin": (ts_s, roll, pitch, yaw),
+         "temp": (ts_s, value), "gaps": [gap dicts]}
+    of NumPy float64 columns, NaN for missing values, a sensor left out of
+    a block without samples. A block holds up to about COLUMN_BLOCK_SAMPLES
+    samples. Files, windows and index use are as for
+    iter_decoded_records_for_export(). Needs numpy (columns_available()).
+    """
+    if numpy is None:
+        raise RuntimeError("iter_decoded_columns() needs numpy")
+    start_us = float("-inf") if start_s is None else start_s * TS_SCALE
+    end_us = float("inf") if end_s is None else end_s * TS_SCALE
+
+    for fv, resynced, raws in _iter_runs(filepath, start_s, end_s):
+        state = _fresh_decode_state()
+        synced = {
+            "accel": bool(resynced & FLAG_ACCEL),
+            "inclin": bool(resynced & FLAG_INCLIN),
+            "temp": bool(resynced & FLAG_TEMP),
+        }
+        pending = {"accel": [], "inclin": [], "temp": []}
+        gaps = []
+        count = 0
+        packed = fv >= FORMAT_V5
+        add = list.append if packed else list.extend
+
+        def block():
+            out = {"gaps": gaps}
+            for sensor, scale, width in (("accel", ACCEL_SCALE, 3), ("inclin", INCLIN_SCALE, 3), ("temp", TEMP_SCALE, 1)):
+                rows = pending[sensor]
+                if not rows:
+                    continue
+                if packed and width == 3:
+                    # Unpacked block by block, no delta state to carry
+                    parts = [b.columns(scale) for b in rows]
+                    columns = tuple(numpy.concatenate(c) for c in zip(*parts))
                 else:
-                    header = sentinel
-                    rec = {
-                        "record_index": idx,
-                        "record_type": "DELTA",
-                        "accel_samples": None,
-                        "inclin": None,
-                        "temp": None,
-                    }
-
-                    if fv == FORMAT_V1:
-                        if header & FLAG_ACCEL:
-                            rec["accel_samples"] = _decode_accel_delta_v1(f, state)
-                        if header & FLAG_INCLIN:
-                            rec["inclin"] = _decode_inclin_delta_v1(f, state)
-                        if header & FLAG_TEMP:
-                            rec["temp"] = _decode_temp_delta_v1(f, state)
-                    elif fv == FORMAT_V2:
-                        if header & FLAG_ACCEL:
-                            rec["accel_samples"] = _decode_accel_delta(f, state)
-                        if header & FLAG_INCLIN:
-                            rec["inclin"] = _decode_inclin_delta(f, state)
-                        if header & FLAG_TEMP:
-                            rec["temp"] = _decode_temp_delta(f, state)
-                    else:
-                        if header & FLAG_ACCEL:
-                            rec["accel_samples"] = _decode_accel_delta_v3(f, state)
-                        if header & FLAG_INCLIN:
-                            rec["inclin"] = _decode_inclin_delta_v3(f, state)
-                        if header & FLAG_TEMP:
-                            rec["temp"] = _decode_temp_delta_v3(f, state)
-
-                yield rec
-                idx += 1
-
-            except EOFError:
-                # Match the frontend decoder behavior:
-                # keep all earlier decoded records and stop cleanly if the file
-                # ends mid-record, which can happen for active .bin files or
-                # interrupted/incomplete files.
-                break
-            except struct.error:
-                break
\ No newline at end of file
+                    columns, synced[sensor] = _sensor_columns(rows, state[sensor], scale, width, synced[sensor], fv)
+                if len(columns[0]):
+                    out[sensor] = columns
+            return out
+
+        for raw, _end in raws:
+            if raw[0] == "GAP":
+                gaps.append(raw[1])
+                continue
+            _type, accel, inclin, temp = raw
+            if packed:
+                # Blocks wholly outside the window are not unpacked
+                if accel and not (start_us <= accel.last_us and accel.first_us < end_us):
+                    accel = None
+                if inclin and not (start_us <= inclin.last_us and inclin.first_us < end_us):
+                    inclin = None
+            if accel:
+                add(pending["accel"], accel)
+                count += len(accel)
+            if inclin:
+                add(pending["inclin"], inclin)
+                count += len(inclin)
+            if temp is not None:
+                pending["temp"].append(temp)
+                count += 1
+            if count >= COLUMN_BLOCK_SAMPLES:
+                yield block()
+                pending = {"accel": [], "inclin": [], "temp": []}
+                gaps = []
+                count = 0
+        if count or gaps:
+            yield block()
+
+
+def _copy_decode_state(state: dict) -> dict:
+    return {
+        name: {**ss, "xyz_prev": list(ss["xyz_prev"])}
+        for name, ss in state.items()
+    }
+
+
+_TAIL_CHECK_BYTES = 16
+
+
+def decode_tail(filepath: str, cursor: dict | None):
+    """
+    Decode the complete records appended to an active .bin since cursor.
+
+    cursor is None for a first read (decodes from the start) or the value
+    returned by the previous call: the offset after the last complete
+    record, the decoder state there and the bytes just before it. Returns
+    (records, cursor). When the file no longer matches the cursor (shorter,
+    or rewritten just before the offset, as active file recovery does)
+    the cursor is dropped and the file decoded from the start again; the
+    returned cursor then has a new "epoch", telling callers to discard
+    what they kept. Returns (None, None) for files this cannot follow (missing,
+    or older than FORMAT_V3).
+    """
+    try:
+        with open(filepath, "rb") as f:
+            size = os.fstat(f.fileno()).st_size
+            if cursor is not None:
+                offset, check = cursor["offset"], cursor["check"]
+                f.seek(offset - len(check))
+                if size < offset or f.read(len(check)) != check:
+                    cursor = None
+            if cursor is None:
+                f.seek(0)
+                ver = f.read(1)
+                if not ver:
+                    return [], None
+                if ver[0] not in (FORMAT_V3, FORMAT_V4, FORMAT_V5):
+                    return None, None
+                cursor = {"offset": 1, "fv": ver[0], "state": _fresh_decode_state(),
+                          "check": ver, "epoch": object()}
+            f.seek(cursor["offset"])
+            data = f.read()
+    except OSError:
+        return None, None
+
+    # Parsing stops before a torn tail record without touching the state,
+    # so the state after the last record is the one to resume from
+    state = _copy_decode_state(cursor["state"])
+    good_end = 0
+    records = []
+    for raw, good_end in _iter_raw(data, 0, cursor["fv"]):
+        rec, _resynced = _apply_raw(raw, state, len(records), _ALL_SENSORS)
+        records.append(rec)
+
+    if good_end == 0:
+        return records, cursor
+    return records, {
+        "offset": cursor["offset"] + good_end,
+        "fv": cursor["fv"],
+        "state": state,
+        "check": (cursor["check"] + data[max(0, good_end - _TAIL_CHECK_BYTES):good_end])[-_TAIL_CHECK_BYTES:],
+        "epoch": cursor["epoch"],
+    }
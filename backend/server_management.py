@@ -10,6 +10,7 @@ from pathlib import Path
 from typing import Any, Dict, Optional
 
 import mqtt_listener_control as mqtt_listener_control
+import storage_catalog
 from export_utils import SENSOR_DATA_DIR
 
 
@@ -286,26 +287,52 @@ def clear_faults_db(faults_db_path: str | Path) -> Dict[str, Any]:
         if con is not None:
             con.close()
 
-def prune_sensor_data(older_than_days: int) -> Dict[str, Any]:
+def _prune_catalogued_files(cutoff_ts: float) -> Optional[tuple[int, int]]:
     """
-    Delete historical raw sensor files older than the requested age.
-    Only raw storage files are removed here.
+    Delete the hourly storage files of hours before cutoff_ts (by filename
+    hour) and their index sidecars, as listed by the storage catalog.
+    Returns (deleted_files, bytes_freed), or None until the catalog is ready.
     """
-    if older_than_days < 1:
-        raise ValueError("older_than_days must be at least 1.")
+    catalogued = storage_catalog.files_before(
+        "data", datetime.fromtimestamp(cutoff_ts).strftime("%Y%m%d_%H")
+    )
+    if catalogued is None:
+        return None
 
-    if not SENSOR_DATA_DIR.exists() or not SENSOR_DATA_DIR.is_dir():
-        return build_action_response(
-            action="prune-data",
-            status="skipped",
-            message="Sensor data directory is not available.",
-            deleted_files=0,
-            bytes_freed=0,
-            data_dir=str(SENSOR_DATA_DIR),
-        )
+    deleted_files = 0
+    bytes_freed = 0
+    removed: list[Path] = []
 
-    cutoff_ts = time.time() - (older_than_days * 86400)
+    for path in catalogued:
+        try:
+            size = path.stat().st_size
+            path.unlink()
+            deleted_files += 1
+            bytes_freed += size
+        except FileNotFoundError:
+            pass
+        except OSError:
+            continue
+        removed.append(path)
 
+        index_path = path.with_name(path.name + ".idx")
+        try:
+            size = index_path.stat().st_size
+            index_path.unlink()
+            deleted_files += 1
+            bytes_freed += size
+        except OSError:
+            pass
+
+    storage_catalog.note_removed(removed)
+    return deleted_files, bytes_freed
+
+
+def _prune_scanned_files(cutoff_ts: float) -> tuple[int, int]:
+    """
+    Delete hourly storage files (and their time index sidecars) last modified
+    before cutoff_ts, by listing the data directory.
+    """
     deleted_files = 0
     bytes_freed = 0
 
@@ -313,8 +340,9 @@ def prune_sensor_data(older_than_days: int) -> Dict[str, Any]:
         if not path.is_file():
             continue
 
-        # Keep pruning scoped to raw hourly storage files only.
-        if not (path.name.endswith(".bin") or path.name.endswith(".bin.gz")):
+        # Keep pruning scoped to raw hourly storage files (and their time
+        # index sidecars) only.
+        if not path.name.endswith((".bin", ".bin.gz", ".bin.zst", ".bin.idx", ".bin.gz.idx", ".bin.zst.idx")):
             continue
 
         try:
@@ -333,6 +361,35 @@ def prune_sensor_data(older_than_days: int) -> Dict[str, Any]:
         except OSError:
             continue
 
+    return deleted_files, bytes_freed
+
+
+def prune_sensor_data(older_than_days: int) -> Dict[str, Any]:
+    """
+    Delete historical raw sensor files older than the requested age.
+    Only raw storage files are removed here.
+    """
+    if older_than_days < 1:
+        raise ValueError("older_than_days must be at least 1.")
+
+    if not SENSOR_DATA_DIR.exists() or not SENSOR_DATA_DIR.is_dir():
+        return build_action_response(
+            action="prune-data",
+            status="skipped",
+            message="Sensor data directory is not available.",
+            deleted_files=0,
+            bytes_freed=0,
+            data_dir=str(SENSOR_DATA_DIR),
+        )
+
+    cutoff_ts = time.time() - (older_than_days * 86400)
+
+    # The storage catalog lists the expired files without a directory scan
+    pruned = _prune_catalogued_files(cutoff_ts)
+    if pruned is None:
+        pruned = _prune_scanned_files(cutoff_ts)
+    deleted_files, bytes_freed = pruned
+
     return build_action_response(
         action="prune-data",
         status="completed",
@@ -341,4 +398,4 @@ def prune_sensor_data(older_than_days: int) -> Dict[str, Any]:
         bytes_freed=bytes_freed,
         data_dir=str(SENSOR_DATA_DIR),
         older_than_days=older_than_days,
-    )
\ No newline at end of file
+    )
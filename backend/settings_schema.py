@@ -41,6 +41,13 @@ class SensorConfigModel(BaseModel):
     lowPassFilter: str = "none"
 
 
+# Per-node MQTT batching (firmware flow_control.h): 1 s packets per message
+# and the longest a batch may hold its oldest packet, 0 = batch_s + 1 s.
+class PublishConfigModel(BaseModel):
+    batch_s: int = Field(1, ge=1, le=10)
+    batch_max_ms: int = Field(0, ge=0, le=60000)
+
+
 class SettingsModel(BaseModel):
     site_name: str = "Cape Scott, BC"
     meta: Dict[str, Dict[str, SensorMetaModel]] = Field(default_factory=dict)
@@ -102,6 +109,7 @@ def build_default_node_config():
                 lowPassFilter="fixed",
             )
         ),
+        "publish": to_dict(PublishConfigModel()),
     }
 
 
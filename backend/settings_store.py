@@ -5,6 +5,7 @@ from settings_schema import (
     DEFAULT_SETTINGS,
     SettingsModel,
     AccelerometerConfigModel,
+    PublishConfigModel,
     build_default_node_meta,
     build_default_node_config,
     validate_model,
@@ -327,4 +328,37 @@ def mark_node_control_failed(
     settings.config[key]["accelerometer"] = accel_cfg
     save_settings(settings)
 
-    return accel_cfg
\ No newline at end of file
+    return accel_cfg
+
+
+# Per-node batching sent with every configure command; nodes created before
+# it existed get the defaults.
+def get_publish_config(node_id: int) -> PublishConfigModel:
+    settings = load_settings()
+    node_cfg = settings.config.get(str(node_id)) or {}
+    try:
+        return validate_model(PublishConfigModel, node_cfg.get("publish") or {})
+    except Exception:
+        return PublishConfigModel()
+
+
+def update_publish_config(
+    node_id: int,
+    batch_s: int | None = None,
+    batch_max_ms: int | None = None,
+) -> PublishConfigModel:
+    settings = load_settings()
+    key = str(node_id)
+
+    if key not in settings.config:
+        settings.config[key] = build_default_node_config()
+
+    current = get_publish_config(node_id)
+    updated = PublishConfigModel(
+        batch_s=current.batch_s if batch_s is None else batch_s,
+        batch_max_ms=current.batch_max_ms if batch_max_ms is None else batch_max_ms,
+    )
+
+    settings.config[key]["publish"] = to_dict(updated)
+    save_settings(settings)
+    return updated
@@ -0,0 +1,432 @@
+import atexit
+import os
+import re
+import sqlite3
+import threading
+import time
+from pathlib import Path
+
+# Catalog of the hourly storage files, so export lookups, retention and
+# per-node storage usage are indexed queries instead of directory scans.
+#
+# /mnt/ssd/data holds data_<node>_<YYYYMMDD>_<HH>.bin (.bin.gz / .bin.zst once
+# archived) and /mnt/ssd/raw/<node>/<node>_<YYYYMMDD>_<HH>.rawbin; with two
+# years of raw retention that is hundreds of thousands of files. Each one
+# has a row here:
+#
+#   files(path, kind, node, hour, codec, size, records, first_us, last_us)
+#
+# kind is "data" or "raw", hour the local YYYYMMDD_HH of the filename (the
+# writers' hour), codec "bin" / "gz" / "zst" / "rawbin". records and the
+# time range are counted by the writers; records stays NULL (unknown) for a
+# file reconcile() found rather than a writer created. size is stat()ed at
+# every flush.
+#
+# Writers (data listener process): the encoder, its archive worker and the
+# raw backup call note_file() when they create a file (written at once, so
+# a new hour is visible to exports immediately), note_records() per record
+# (batched in memory, flushed every CATALOG_FLUSH_S in one transaction),
+# note_archived() when .bin becomes .bin.gz / .bin.zst and note_removed()
+# when retention deletes. reconcile() runs once per listener start and
+# brings the table in line with the disk (files written while the listener
+# was down, deleted by hand, ...); until it has completed once, ready() is
+# False and readers fall back to the filesystem.
+#
+# Readers (backend): find_files(), files_before(), usage_by_node() and
+# sealed_files() (replication.py).
+CATALOG_PATH = Path("/mnt/ssd/catalog/storage_catalog.db")
+CATALOG_FLUSH_S = float(os.getenv("SHM_CATALOG_FLUSH_S", "30"))
+
+DATA_DIR = Path("/mnt/ssd/data")
+RAW_DIR = Path("/mnt/ssd/raw")
+
+_DATA_NAME = re.compile(r"^data_(.+)_(\d{8}_\d{2})\.bin(?:\.(gz|zst))?$")
+_RAW_NAME = re.compile(r"^(.+)_(\d{8}_\d{2})\.rawbin$")
+
+# Preferred file of an hour when more than one exists: the active .bin
+# over an archive left by an interrupted swap
+_CODEC_RANK = {"bin": 0, "gz": 1, "zst": 2, "rawbin": 0}
+
+_UPSERT_RECORDS_SQL = """
+    INSERT INTO files (path, kind, node, hour, codec, size, records, first_us, last_us)
+    VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)
+    ON CONFLICT (path) DO UPDATE SET
+        size = excluded.size,
+        records = records + excluded.records,
+        first_us = coalesce(min(first_us, excluded.first_us), first_us, excluded.first_us),
+        last_us = coalesce(max(last_us, excluded.last_us), last_us, excluded.last_us)
+"""
+
+_lock = threading.Lock()
+_conn = None
+_pending: dict = {}         # path -> [records, first_us, last_us]
+_flush_thread = None
+
+
+def parse_storage_name(name: str):
+    """(kind, node, hour, codec) of a storage filename, None for anything else
+    (index sidecars, temp files)."""
+    match = _DATA_NAME.match(name)
+    if match:
+        return "data", match.group(1), match.group(2), match.group(3) or "bin"
+    match = _RAW_NAME.match(name)
+    if match:
+        return "raw", match.group(1), match.group(2), "rawbin"
+    return None
+
+
+def _ensure_catalog_tables(conn: sqlite3.Connection) -> None:
+    conn.execute(
+        """
+        CREATE TABLE IF NOT EXISTS files (
+            path TEXT PRIMARY KEY,
+            kind TEXT NOT NULL,
+            node TEXT NOT NULL,
+            hour TEXT NOT NULL,
+            codec TEXT NOT NULL,
+            size INTEGER NOT NULL,
+            records INTEGER,
+            first_us INTEGER,
+            last_us INTEGER
+        )
+        """
+    )
+    conn.execute("CREATE INDEX IF NOT EXISTS files_node_hour ON files (kind, node, hour)")
+    conn.execute("CREATE INDEX IF NOT EXISTS files_hour ON files (kind, hour)")
+    conn.execute("CREATE TABLE IF NOT EXISTS meta (key TEXT PRIMARY KEY, value TEXT)")
+
+
+def _connect(create: bool = True) -> sqlite3.Connection:
+    """The process's connection, under _lock; raises sqlite3.Error / OSError
+    while the SSD is not there. Readers do not create the catalog (nor a
+    directory under an unmounted /mnt/ssd)."""
+    global _conn
+    if _conn is None:
+        if not create and not CATALOG_PATH.exists():
+            raise FileNotFoundError(CATALOG_PATH)
+        CATALOG_PATH.parent.mkdir(parents=True, exist_ok=True)
+        conn = sqlite3.connect(CATALOG_PATH, timeout=10.0, check_same_thread=False)
+        # WAL lets the backend read while the data listener writes
+        conn.execute("PRAGMA journal_mode=WAL")
+        conn.execute("PRAGMA synchronous=NORMAL")
+        _ensure_catalog_tables(conn)
+        conn.commit()
+        _conn = conn
+    return _conn
+
+
+def _drop_connection() -> None:
+    global _conn
+    if _conn is not None:
+        try:
+            _conn.close()
+        except sqlite3.Error:
+            pass
+        _conn = None
+
+
+def _size(path: str) -> int:
+    try:
+        return os.path.getsize(path)
+    except OSError:
+        return 0
+
+
+# -------------------------------------------------------------------
+# Writer side
+# -------------------------------------------------------------------
+
+def _start_flush_thread() -> None:
+    global _flush_thread
+    with _lock:
+        if _flush_thread is not None:
+            return
+        _flush_thread = threading.Thread(target=_flush_loop, daemon=True, name="storage-catalog")
+        _flush_thread.start()
+    atexit.register(flush)
+
+
+def _flush_loop() -> None:
+    while True:
+        time.sleep(CATALOG_FLUSH_S)
+        flush()
+
+
+def _flush_locked(conn: sqlite3.Connection) -> None:
+    global _pending
+    pending, _pending = _pending, {}
+    rows = []
+    for path, (records, first_us, last_us) in pending.items():
+        parsed = parse_storage_name(os.path.basename(path))
+        if parsed is None:
+            continue
+        kind, node, hour, codec = parsed
+        rows.append((path, kind, node, hour, codec, _size(path), records, first_us, last_us))
+    try:
+        with conn:
+            conn.executemany(_UPSERT_RECORDS_SQL, rows)
+    except sqlite3.Error:
+        # Counted again on the next flush
+        for path, counts in pending.items():
+            _merge_pending(path, *counts)
+        raise
+
+
+def _merge_pending(path: str, records: int, first_us, last_us) -> None:
+    entry = _pending.get(path)
+    if entry is None:
+        _pending[path] = [records, first_us, last_us]
+        return
+    entry[0] += records
+    if first_us is not None:
+        entry[1] = first_us if entry[1] is None else min(entry[1], first_us)
+    if last_us is not None:
+        entry[2] = last_us if entry[2] is None else max(entry[2], last_us)
+
+
+def flush() -> None:
+    """Write the counts noted since the last flush (flush thread, exit)."""
+    with _lock:
+        if not _pending:
+            return
+        try:
+            _flush_locked(_connect())
+        except (sqlite3.Error, OSError) as e:
+            _drop_connection()
+            print(f"[catalog] Flush failed: {e}")
+
+
+def note_file(path: str) -> None:
+    """A writer created path (or reopened it): catalog it now."""
+    path = os.path.abspath(path)
+    with _lock:
+        _merge_pending(path, 0, None, None)
+        try:
+            _flush_locked(_connect())
+        except (sqlite3.Error, OSError) as e:
+            _drop_connection()
+            print(f"[catalog] Could not add {os.path.basename(path)}: {e}")
+    _start_flush_thread()
+
+
+def note_records(path: str, records: int = 1, first_us: int | None = None,
+                 last_us: int | None = None) -> None:
+    """records were appended to path, spanning first_us..last_us (µs)."""
+    path = os.path.abspath(path)
+    with _lock:
+        _merge_pending(path, records, first_us, last_us)
+    _start_flush_thread()
+
+
+def note_archived(old_path: str, new_path: str) -> None:
+    """old_path (.bin) was replaced by its archive new_path: the row moves
+    over with its counts."""
+    old_path = os.path.abspath(old_path)
+    new_path = os.path.abspath(new_path)
+    parsed = parse_storage_name(os.path.basename(new_path))
+    if parsed is None:
+        return
+    with _lock:
+        try:
+            conn = _connect()
+            _flush_locked(conn)
+            with conn:
+                conn.execute("DELETE FROM files WHERE path = ?", (new_path,))
+                moved = conn.execute(
+                    "UPDATE files SET path = ?, codec = ?, size = ? WHERE path = ?",
+                    (new_path, parsed[3], _size(new_path), old_path),
+                ).rowcount
+                if not moved:
+                    conn.execute(
+                        "INSERT INTO files (path, kind, node, hour, codec, size) VALUES (?, ?, ?, ?, ?, ?)",
+                        (new_path, *parsed, _size(new_path)),
+                    )
+        except (sqlite3.Error, OSError) as e:
+            _drop_connection()
+            print(f"[catalog] Could not record archive {os.path.basename(new_path)}: {e}")
+
+
+def note_removed(paths) -> None:
+    """paths were deleted."""
+    paths = [os.path.abspath(p) for p in paths]
+    if not paths:
+        return
+    with _lock:
+        for path in paths:
+            _pending.pop(path, None)
+        try:
+            conn = _connect(create=False)
+            with conn:
+                conn.executemany("DELETE FROM files WHERE path = ?", [(p,) for p in paths])
+        except (sqlite3.Error, OSError) as e:
+            _drop_connection()
+            print(f"[catalog] Could not remove {len(paths)} row(s): {e}")
+
+
+def _scan(data_dir: Path, raw_dir: Path):
+    """Every storage file on disk: path -> (kind, node, hour, codec, size)."""
+    found = {}
+    dirs = [data_dir]
+    try:
+        dirs += [Path(e.path) for e in os.scandir(raw_dir) if e.is_dir()]
+    except OSError:
+        pass
+    for directory in dirs:
+        try:
+            entries = list(os.scandir(directory))
+        except OSError:
+            continue
+        for entry in entries:
+            parsed = parse_storage_name(entry.name)
+            if parsed is None:
+                continue
+            try:
+                size = entry.stat().st_size
+            except OSError:
+                continue
+            found[os.path.abspath(entry.path)] = parsed + (size,)
+    return found
+
+
+def reconcile(data_dir: Path = DATA_DIR, raw_dir: Path = RAW_DIR) -> bool:
+    """Bring the catalog in line with the disk (one directory scan); marks it
+    ready. Data listener start, in the background."""
+    if not data_dir.is_dir():
+        # SSD not mounted: an empty scan would empty the catalog
+        print(f"[catalog] Reconcile skipped: {data_dir} is not available")
+        return False
+    started = time.monotonic()
+    found = _scan(data_dir, raw_dir)
+    with _lock:
+        try:
+            conn = _connect()
+            _flush_locked(conn)
+            known = {path: size for path, size in conn.execute("SELECT path, size FROM files")}
+            # A file a writer created since the scan is not gone
+            gone = [(path,) for path in known if path not in found and not os.path.exists(path)]
+            new = [(path, *info) for path, info in found.items() if path not in known]
+            resized = [(info[4], path) for path, info in found.items()
+                       if path in known and known[path] != info[4]]
+            with conn:
+                conn.executemany("DELETE FROM files WHERE path = ?", gone)
+                conn.executemany(
+                    "INSERT INTO files (path, kind, node, hour, codec, size) VALUES (?, ?, ?, ?, ?, ?)",
+                    new,
+                )
+                conn.executemany("UPDATE files SET size = ? WHERE path = ?", resized)
+                conn.execute(
+                    "INSERT OR REPLACE INTO meta (key, value) VALUES ('reconciled_at', ?)",
+                    (str(int(time.time())),),
+                )
+        except (sqlite3.Error, OSError) as e:
+            _drop_connection()
+            print(f"[catalog] Reconcile failed: {e}")
+            return False
+    print(
+        f"[catalog] Reconciled {len(found)} file(s): {len(new)} added, {len(gone)} gone, "
+        f"{len(resized)} resized ({time.monotonic() - started:.1f} s)"
+    )
+    return True
+
+
+def start_reconcile() -> threading.Thread:
+    thread = threading.Thread(target=reconcile, daemon=True, name="storage-catalog-reconcile")
+    thread.start()
+    return thread
+
+
+# -------------------------------------------------------------------
+# Reader side
+# -------------------------------------------------------------------
+
+def _read(sql: str, params: tuple = ()):
+    """Rows of a query, None while the catalog is not usable."""
+    with _lock:
+        try:
+            return _connect(create=False).execute(sql, params).fetchall()
+        except (sqlite3.Error, OSError):
+            _drop_connection()
+            return None
+
+
+def ready() -> bool:
+    """True once reconcile() has completed at least once."""
+    rows = _read("SELECT value FROM meta WHERE key = 'reconciled_at'")
+    return bool(rows)
+
+
+def find_files(kind: str, node: str, start_hour: str, end_hour: str) -> list[Path] | None:
+    """The node's files with start_hour <= hour < end_hour (YYYYMMDD_HH), one
+    per hour in hour order; None when the catalog is not ready."""
+    if not ready():
+        return None
+    rows = _read(
+        "SELECT hour, codec, path FROM files WHERE kind = ? AND node = ? AND hour >= ? AND hour < ?",
+        (kind, node, start_hour, end_hour),
+    )
+    if rows is None:
+        return None
+    best: dict = {}
+    for hour, codec, path in rows:
+        current = best.get(hour)
+        if current is None or _CODEC_RANK.get(codec, 9) < _CODEC_RANK.get(current[0], 9):
+            best[hour] = (codec, path)
+    return [Path(best[hour][1]) for hour in sorted(best)]
+
+
+def files_before(kind: str, hour: str) -> list[Path] | None:
+    """Every file of kind older than hour (YYYYMMDD_HH), for retention; None
+    when the catalog is not ready."""
+    if not ready():
+        return None
+    rows = _read("SELECT path FROM files WHERE kind = ? AND hour < ? ORDER BY hour", (kind, hour))
+    if rows is None:
+        return None
+    return [Path(path) for (path,) in rows]
+
+
+def usage_by_node() -> list[dict] | None:
+    """Per node and kind: file count, bytes, records, archived files and the
+    first / last hour; None when the catalog is not ready."""
+    if not ready():
+        return None
+    rows = _read(
+        """
+        SELECT node, kind, count(*), sum(size), sum(records), count(records),
+               sum(codec IN ('gz', 'zst')), min(hour), max(hour)
+        FROM files GROUP BY node, kind ORDER BY node, kind
+        """
+    )
+    if rows is None:
+        return None
+    return [
+        {
+            "node": node,
+            "kind": kind,
+            "files": files,
+            "bytes": size or 0,
+            # Files reconcile() found and no writer has counted are left out
+            "records": records,
+            "counted_files": counted,
+            "archived_files": archived,
+            "first_hour": first_hour,
+            "last_hour": last_hour,
+        }
+        for node, kind, files, size, records, counted, archived, first_hour, last_hour in rows
+    ]
+
+
+def sealed_files(before_hour: str) -> list[tuple] | None:
+    """Files that are no longer written: archived data hours and raw hours
+    before before_hour (YYYYMMDD_HH), oldest first, as (path, kind, node,
+    hour); None when the catalog is not ready."""
+    if not ready():
+        return None
+    return _read(
+        """
+        SELECT path, kind, node, hour FROM files
+        WHERE (kind = 'data' AND codec IN ('gz', 'zst')) OR (kind = 'raw' AND hour < ?)
+        ORDER BY hour, path
+        """,
+        (before_hour,),
+    )
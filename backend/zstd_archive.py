@@ -0,0 +1,114 @@
+import os
+from pathlib import Path
+
+# zstd archive codec for finished hourly storage files (.bin.zst).
+#
+# Written by the encoder's archive worker when SHM_ARCHIVE_CODEC=zstd and
+# the zstandard package is installed (gzip stays the default: the
+# dashboard's Decoder page reads .bin / .bin.gz exports only).
+#
+# Seekable layout: one independent zstd frame per time index segment (the
+# version byte and any records before the first entry, then each ABSOLUTE
+# record up to the next one), so every .bin.zst.idx offset is a frame start
+# (flagged INDEX_GZ_MEMBER, as for appended gzip members) and a reader
+# decompresses only the frames covering its window. Store-and-forward
+# records replayed into an archived hour are appended as further frames.
+#
+# Frames are compressed with a dictionary trained per data type (the
+# storage file format version), saved once as
+# ZSTD_DICT_DIR/data_v<format>_<dict id>.dict. The frame header carries the
+# dictionary id, which is how readers find it again; a retrained dictionary
+# gets a new file and never invalidates older archives.
+try:
+    import zstandard
+except ImportError:     # optional dependency
+    zstandard = None
+
+ZSTD_DICT_DIR = Path("/mnt/ssd/zstd_dicts")
+ZSTD_LEVEL = int(os.getenv("SHM_ZSTD_LEVEL", "9"))
+ZSTD_DICT_SIZE = 64 * 1024
+ZSTD_DICT_MIN_SAMPLES = 20
+ZSTD_SAMPLE_BYTES = 64 * 1024
+
+_dicts: dict = {}       # dict id -> ZstdCompressionDict
+
+
+def available() -> bool:
+    return zstandard is not None
+
+
+def _dict_by_id(dict_id: int):
+    if not dict_id:
+        return None
+    found = _dicts.get(dict_id)
+    if found is None:
+        for path in ZSTD_DICT_DIR.glob(f"data_v*_{dict_id}.dict"):
+            found = _dicts[dict_id] = zstandard.ZstdCompressionDict(path.read_bytes())
+            break
+    return found
+
+
+def dictionary_for(format_version: int, sample_source):
+    """The data type's dictionary, trained the first time from
+    sample_source() (segments of a finished file); None while there are
+    too few segments to train on."""
+    for path in sorted(ZSTD_DICT_DIR.glob(f"data_v{format_version}_*.dict")):
+        dict_id = int(path.stem.rsplit("_", 1)[1])
+        return _dict_by_id(dict_id)
+    samples = [s[:ZSTD_SAMPLE_BYTES] for s in sample_source() if s]
+    if len(samples) < ZSTD_DICT_MIN_SAMPLES:
+        return None
+    try:
+        trained = zstandard.train_dictionary(ZSTD_DICT_SIZE, samples)
+    except zstandard.ZstdError as e:
+        print(f"[zstd_archive] Dictionary training failed: {e}")
+        return None
+    ZSTD_DICT_DIR.mkdir(parents=True, exist_ok=True)
+    path = ZSTD_DICT_DIR / f"data_v{format_version}_{trained.dict_id()}.dict"
+    tmp = path.with_suffix(".tmp")
+    tmp.write_bytes(trained.as_bytes())
+    tmp.replace(path)
+    _dicts[trained.dict_id()] = trained
+    print(f"[zstd_archive] Trained {path.name} from {len(samples)} segments")
+    return trained
+
+
+def compressor(dictionary=None):
+    return zstandard.ZstdCompressor(level=ZSTD_LEVEL, dict_data=dictionary, write_checksum=True)
+
+
+def decompress_frames(chunk: bytes) -> bytes:
+    """Decompress consecutive frames from a frame start. A torn or still
+    growing tail just ends the output."""
+    out = []
+    while chunk:
+        try:
+            params = zstandard.get_frame_parameters(chunk)
+            dctx = zstandard.ZstdDecompressor(dict_data=_dict_by_id(params.dict_id))
+            dobj = dctx.decompressobj()
+            out.append(dobj.decompress(chunk))
+        except zstandard.ZstdError:
+            break
+        if not dobj.eof:
+            break
+        chunk = dobj.unused_data
+    return b"".join(out)
+
+
+def stream_reader(f):
+    """Streaming reader over every frame of an open .bin.zst; all frames of
+    one file share the dictionary of the first."""
+    head = f.read(18)       # longest frame header
+    f.seek(0)
+    dict_id = zstandard.get_frame_parameters(head).dict_id if head else 0
+    dctx = zstandard.ZstdDecompressor(dict_data=_dict_by_id(dict_id))
+    return dctx.stream_reader(f, read_across_frames=True)
+
+
+def compressor_for_file(path: str):
+    """Compressor for frames appended to an existing .bin.zst, with the
+    dictionary its first frame uses."""
+    with open(path, "rb") as f:
+        head = f.read(18)
+    dict_id = zstandard.get_frame_parameters(head).dict_id if head else 0
+    return compressor(_dict_by_id(dict_id))
@@ -0,0 +1,99 @@
+"""
+bench_decoder.py  — decoder throughput
+--------------------------------------
+Times the shared decoder (backend/sensor_export_decoder.py) on storage files
+and prints MB/s of decoded (uncompressed) data for:
+
+  records   iter_decoded_records_for_export(), one dict per record
+  columns   iter_decoded_columns(), NumPy columns (skipped without numpy)
+  baseline  any other decoder module given with --baseline, e.g. the
+            decoders before the shared one, taken from git:
+              git show <rev>:backend/sensor_export_decoder.py > /tmp/old_backend.py
+              git show <rev>:dataStorage/decode_binary.py > /tmp/old_cli.py
+            A module is timed through iter_decoded_records_for_export() or,
+            failing that, decode_file().
+
+Each file is decoded --repeat times and the best run counts, so the page
+cache and a .gz inflate settle first. Use an hour that is not being written.
+
+Usage:
+    python bench_decoder.py <file.bin> [<file.bin.gz> ...]
+    python bench_decoder.py <file.bin> --baseline /tmp/old_backend.py --baseline /tmp/old_cli.py
+"""
+
+import argparse, importlib.util, os, sys, time
+from pathlib import Path
+
+try:
+    import sensor_export_decoder as decoder
+except ImportError:     # run from a checkout: the decoder lives in backend/
+    sys.path.insert(0, str(Path(__file__).resolve().parents[1] / "backend"))
+    import sensor_export_decoder as decoder
+
+from decode_binary import decompressed_size
+
+
+def _load_module(path: str):
+    spec = importlib.util.spec_from_file_location(Path(path).stem, path)
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+
+def _baseline_runner(module):
+    if hasattr(module, "iter_decoded_records_for_export"):
+        return lambda path: sum(1 for _ in module.iter_decoded_records_for_export(path))
+    return lambda path: len(module.decode_file(path))
+
+
+def _records(path: str) -> int:
+    return sum(1 for _ in decoder.iter_decoded_records_for_export(path))
+
+
+def _columns(path: str) -> int:
+    return sum(len(block.get("accel", ((),))[0]) for block in decoder.iter_decoded_columns(path))
+
+
+def _best_seconds(fn, path: str, repeat: int) -> float:
+    best = float("inf")
+    for _ in range(repeat):
+        t0 = time.perf_counter()
+        fn(path)
+        best = min(best, time.perf_counter() - t0)
+    return best
+
+
+def main():
+    p = argparse.ArgumentParser(description="Decoder throughput in MB/s")
+    p.add_argument("files", nargs="+")
+    p.add_argument("--baseline", action="append", default=[], metavar="DECODER.py")
+    p.add_argument("--repeat", type=int, default=3)
+    args = p.parse_args()
+
+    runners = [(Path(b).stem, _baseline_runner(_load_module(b))) for b in args.baseline]
+    runners.append(("records", _records))
+    if decoder.columns_available():
+        runners.append(("columns", _columns))
+    else:
+        print("numpy not installed: columns skipped")
+
+    totals = {name: 0.0 for name, _ in runners}
+    total_bytes = 0
+    for path in args.files:
+        if not os.path.isfile(path):
+            print(f"[ERROR] Not found: {path}", file=sys.stderr); sys.exit(1)
+        size = decompressed_size(path)
+        total_bytes += size
+        print(f"{os.path.basename(path)}  ({size:,} bytes decoded)")
+        for name, fn in runners:
+            seconds = _best_seconds(fn, path, args.repeat)
+            totals[name] += seconds
+            print(f"  {name:<20} {size / seconds / 1e6:8.2f} MB/s")
+
+    if len(args.files) > 1:
+        print(f"all files  ({total_bytes:,} bytes decoded)")
+        for name, seconds in totals.items():
+            print(f"  {name:<20} {total_bytes / seconds / 1e6:8.2f} MB/s")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,489 @@
+"""
+bench_storage.py  — storage format benchmark suite
+--------------------------------------------------
+Numbers for the hourly storage format (encoder_storage.py) on a fixed set of
+hour files, kept over time so a format or encoder change comes with its
+effect on every stage:
+
+  encode     encode_packet() (encode_packed_record and GAP records)
+             re-encoding the fixture's packets with a fresh state: MB/s
+             of output, ABSOLUTE and DELTA records/s, and whether the
+             result decodes to the same samples
+  records    backend decoder, iter_decoded_records_for_export()
+  columns    backend decoder, iter_decoded_columns() (needs numpy)
+  dashboard  the Decoder page's StorageFileDecoder (decoderCore.ts) under
+             Node, via shm-dashboard/scripts/bench-decoder.mjs (needs node
+             and `npm install` in shm-dashboard; V3 / V4 / V5 files only)
+  gzip-N / zstd-N
+             whole-file compression ratio, compress and decompress MB/s
+             (GZIP_LEVEL and ZSTD_LEVEL are what the archive worker uses;
+             zstd needs the zstandard package)
+
+MB/s is always of the uncompressed .bin. Each stage runs --repeat times and
+the best run counts.
+
+Fixtures are uncompressed .bin files in FIXTURE_DIR with a manifest.json:
+  record   copies recorded hours in (.bin, .bin.gz or .bin.zst, any format
+           version), e.g. a quiet night, a stormy afternoon, an hour with a
+           sensor outage, and the V1 / V2 / V3 files still on old nodes
+  synth    writes deterministic synthetic hours with the current encoder:
+           quiet, noisy and disconnected (gaps, NaN runs, lost packets)
+Keep the same fixture set between runs that are compared.
+
+Every run appends one line to HISTORY_FILE (time, git revision, host,
+per-fixture results) and prints the change against the previous run on the
+same machine; `history` tabulates one metric over the runs.
+
+Usage:
+    python bench_storage.py synth
+    python bench_storage.py record /mnt/ssd/data/data_3_20260412_14.bin.gz --label storm
+    python bench_storage.py run
+    python bench_storage.py run --only storm_v4 --repeat 5
+    python bench_storage.py history --metric encode.mb_s
+"""
+
+import argparse, gzip, json, math, os, platform, random, shutil, subprocess, sys, time, zlib
+from datetime import datetime, timezone
+from pathlib import Path
+
+try:
+    import sensor_export_decoder as decoder
+except ImportError:     # run from a checkout: the decoder lives in backend/
+    sys.path.insert(0, str(Path(__file__).resolve().parents[1] / "backend"))
+    import sensor_export_decoder as decoder
+
+import encoder_storage as es
+import zstd_archive
+
+BENCH_DIR = Path(os.getenv("SHM_BENCH_DIR", "/mnt/ssd/bench"))
+FIXTURE_DIR = BENCH_DIR / "fixtures"
+HISTORY_FILE = BENCH_DIR / "history.jsonl"
+DASHBOARD_DIR = Path(__file__).resolve().parents[1] / "shm-dashboard"
+
+GZIP_LEVELS = (1, es.GZIP_LEVEL, 9)
+ZSTD_LEVELS = (3, zstd_archive.ZSTD_LEVEL, 19)
+
+SYNTH_KINDS = ("quiet", "noisy", "disconnected")
+SYNTH_START_S = 1_767_225_600.0        # 2026-01-01T00:00:00Z, fixed for stable fixtures
+SYNTH_SECONDS = 3600
+SYNTH_ACCEL_HZ = 200
+SYNTH_INCL_HZ = 20
+
+_NAN = float("nan")
+_GAP_SENSOR_KEYS = {"accel": "a", "inclin": "i"}
+
+
+# ──────────────────────────────────────────────────────────────────
+# Fixtures
+# ──────────────────────────────────────────────────────────────────
+
+def _load_manifest() -> dict:
+    try:
+        return json.loads((FIXTURE_DIR / "manifest.json").read_text(encoding="utf-8"))
+    except (OSError, ValueError):
+        return {}
+
+
+def _save_manifest(manifest: dict) -> None:
+    FIXTURE_DIR.mkdir(parents=True, exist_ok=True)
+    (FIXTURE_DIR / "manifest.json").write_text(json.dumps(manifest, indent=2, sort_keys=True),
+                                               encoding="utf-8")
+
+
+def _add_fixture(manifest: dict, label: str, data: bytes, source: str) -> str:
+    version = data[0] if data and data[0] in (1, 2, 3, 4, 5) else 1
+    name = f"{label}_v{version}"
+    (FIXTURE_DIR / f"{name}.bin").write_bytes(data)
+    manifest[name] = {"label": label, "version": version, "bytes": len(data), "source": source}
+    print(f"  {name}.bin  ({len(data):,} bytes, format V{version})")
+    return name
+
+
+def cmd_record(args) -> None:
+    manifest = _load_manifest()
+    FIXTURE_DIR.mkdir(parents=True, exist_ok=True)
+    for path in args.files:
+        if not os.path.isfile(path):
+            print(f"[ERROR] Not found: {path}", file=sys.stderr); sys.exit(1)
+        with decoder.open_record_stream(path) as f:
+            data = f.read()
+        label = args.label if args.label and len(args.files) == 1 else Path(path).name.split(".")[0]
+        _add_fixture(manifest, label, data, os.path.abspath(path))
+    _save_manifest(manifest)
+
+
+def _synth_packets(kind: str):
+    """One hour of packets as normalise_sensor_timestamps() leaves them."""
+    rng = random.Random(kind)
+    noise = {"quiet": 0.0005, "noisy": 0.03, "disconnected": 0.0005}[kind]
+    vib_freq, sway_freq = 2.1, 0.05
+    accel_dt = 1.0 / SYNTH_ACCEL_HZ
+    incl_dt = 1.0 / SYNTH_INCL_HZ
+    outage_until = 0.0
+
+    for second in range(SYNTH_SECONDS):
+        base = SYNTH_START_S + second
+        data = {}
+        gaps = []
+        accel_out = False
+        if kind == "disconnected":
+            if rng.random() < 0.02:
+                continue                            # lost on the link
+            if base < outage_until or rng.random() < 0.004:
+                outage_until = max(outage_until, base + rng.randint(5, 120))
+                accel_out = True
+                gaps.append([base, 1_000_000, "a", "disconnected"])
+
+        if not accel_out:
+            nan_from = rng.randrange(SYNTH_ACCEL_HZ) if kind == "disconnected" and rng.random() < 0.05 else None
+            accel = []
+            for k in range(SYNTH_ACCEL_HZ):
+                t = base + k * accel_dt
+                if nan_from is not None and nan_from <= k < nan_from + 20:
+                    accel.append([t, _NAN, _NAN, _NAN])
+                    continue
+                amp = 0.05 * (1.0 + (3.0 * math.sin(t / 40.0) ** 8 if kind == "noisy" else 0.0))
+                vib = amp * math.sin(2 * math.pi * vib_freq * t)
+                g_x = 0.02 * math.sin(2 * math.pi * sway_freq * t)
+                accel.append([t,
+                              round(g_x + vib * 0.6 + rng.gauss(0, noise), 4),
+                              round(vib * 0.4 + rng.gauss(0, noise), 4),
+                              round(math.sqrt(1.0 - g_x * g_x) + vib * 0.1 + rng.gauss(0, noise), 4)])
+            data["a"] = accel
+
+        data["i"] = [[base + k * incl_dt,
+                      round(1.5 * math.sin(2 * math.pi * sway_freq * (base + k * incl_dt)) + rng.gauss(0, 0.01), 4),
+                      round(0.8 * math.cos(2 * math.pi * sway_freq * (base + k * incl_dt)) + rng.gauss(0, 0.01), 4),
+                      round(rng.gauss(0, 0.005), 4)]
+                     for k in range(SYNTH_INCL_HZ)]
+        data["T"] = [base, round(21.0 + 0.3 * math.sin(second / 600.0) + rng.gauss(0, 0.05), 2)]
+        if gaps:
+            data["g"] = gaps
+        yield data
+
+
+def _encode_packets(packets) -> bytes:
+    state = es._fresh_state()
+    out = bytearray([es.FILE_FORMAT_VERSION])
+    for data in packets:
+        out += es.encode_packet(data, state)[0]
+    return bytes(out)
+
+
+def cmd_synth(args) -> None:
+    manifest = _load_manifest()
+    FIXTURE_DIR.mkdir(parents=True, exist_ok=True)
+    for kind in SYNTH_KINDS:
+        name = _add_fixture(manifest, kind, _encode_packets(_synth_packets(kind)), "synth")
+        manifest[name]["synth"] = kind
+    _save_manifest(manifest)
+
+
+# ──────────────────────────────────────────────────────────────────
+# Stages
+# ──────────────────────────────────────────────────────────────────
+
+def _best_seconds(fn, repeat: int) -> float:
+    best = float("inf")
+    for _ in range(repeat):
+        t0 = time.perf_counter()
+        fn()
+        best = min(best, time.perf_counter() - t0)
+    return best
+
+
+def _packets_of(path: str) -> list:
+    """The fixture's records back as encoder input packets."""
+    packets = []
+    gaps = []
+
+    def values(sample):
+        return [sample[0]] + [_NAN if v is None else v for v in sample[1:]]
+
+    for rec in decoder.iter_decoded_records_for_export(path):
+        if rec["record_type"] == "GAP":
+            gap = rec["gap"]
+            gaps.append([gap["start_s"], int(round(gap["dur_s"] * es.TS_SCALE)),
+                         _GAP_SENSOR_KEYS.get(gap["sensor"], "a"), gap["reason"]])
+            continue
+        data = {}
+        if rec["accel_samples"]:
+            data["a"] = [values(s) for s in rec["accel_samples"]]
+        if rec["inclin"]:
+            data["i"] = [values(s) for s in rec["inclin"]]
+        if rec["temp"]:
+            data["T"] = values(rec["temp"])
+        if gaps:
+            data["g"] = gaps
+            gaps = []
+        if data:
+            packets.append(data)
+    return packets
+
+
+def _accel_samples(path: str) -> int:
+    return sum(len(rec["accel_samples"] or ()) for rec in decoder.iter_decoded_records_for_export(path))
+
+
+def bench_encode(path: str, size: int, repeat: int) -> dict:
+    packets = _packets_of(path)
+    best = None
+    for _ in range(repeat):
+        state = es._fresh_state()
+        out = bytearray([es.FILE_FORMAT_VERSION])
+        times = {True: 0.0, False: 0.0}
+        counts = {True: 0, False: 0}
+        for data in packets:
+            t0 = time.perf_counter()
+            record, absolute, _ = es.encode_packet(data, state)
+            times[absolute] += time.perf_counter() - t0
+            counts[absolute] += 1
+            out += record
+        total = times[True] + times[False]
+        if best is None or total < best[0]:
+            best = (total, times, counts, bytes(out))
+    total, times, counts, encoded = best
+
+    tmp = FIXTURE_DIR / ".encoded.bin"
+    tmp.write_bytes(encoded)
+    try:
+        roundtrip = _accel_samples(str(tmp)) == _accel_samples(path)
+    finally:
+        tmp.unlink()
+    return {
+        "mb_s": round(len(encoded) / total / 1e6, 3) if total else None,
+        "records_s": round(len(packets) / total, 1) if total else None,
+        "absolute_records_s": round(counts[True] / times[True], 1) if times[True] else None,
+        "delta_records_s": round(counts[False] / times[False], 1) if times[False] else None,
+        "bytes": len(encoded),
+        "bytes_vs_fixture": round(len(encoded) / size, 4),
+        "roundtrip": roundtrip,
+    }
+
+
+def bench_records(path: str, size: int, repeat: int) -> dict:
+    n = sum(1 for _ in decoder.iter_decoded_records_for_export(path))
+    seconds = _best_seconds(lambda: sum(1 for _ in decoder.iter_decoded_records_for_export(path)), repeat)
+    return {"mb_s": round(size / seconds / 1e6, 3), "records_s": round(n / seconds, 1)}
+
+
+def bench_columns(path: str, size: int, repeat: int) -> dict:
+    blocks = sum(1 for _ in decoder.iter_decoded_columns(path))
+    seconds = _best_seconds(lambda: sum(1 for _ in decoder.iter_decoded_columns(path)), repeat)
+    return {"mb_s": round(size / seconds / 1e6, 3), "blocks": blocks}
+
+
+def bench_dashboard(paths: list, repeat: int) -> dict:
+    """{path: result} from the Node runner, or {} with a note why not."""
+    script = DASHBOARD_DIR / "scripts" / "bench-decoder.mjs"
+    if shutil.which("node") is None:
+        print("node not installed: dashboard decoder skipped")
+        return {}
+    if not (DASHBOARD_DIR / "node_modules" / "typescript").is_dir():
+        print("shm-dashboard/node_modules missing (npm install): dashboard decoder skipped")
+        return {}
+    proc = subprocess.run(["node", str(script), "--repeat", str(repeat)] + paths,
+                          cwd=DASHBOARD_DIR, capture_output=True, text=True)
+    if proc.returncode != 0:
+        print(f"dashboard decoder failed: {proc.stderr.strip()[-500:]}")
+        return {}
+    out = {}
+    for line in proc.stdout.splitlines():
+        try:
+            row = json.loads(line)
+        except ValueError:
+            continue
+        if "error" in row:
+            out[row["file"]] = {"error": row["error"]}
+        else:
+            out[row["file"]] = {"mb_s": round(row["bytes"] / row["seconds"] / 1e6, 3),
+                                "records_s": round(row["records"] / row["seconds"], 1)}
+    return out
+
+
+def bench_codecs(data: bytes, repeat: int) -> dict:
+    out = {}
+    size = len(data)
+    codecs = [(f"gzip-{level}", lambda b, l=level: gzip.compress(b, compresslevel=l), gzip.decompress)
+              for level in GZIP_LEVELS]
+    if zstd_archive.available():
+        zstandard = zstd_archive.zstandard
+        codecs += [(f"zstd-{level}",
+                    lambda b, l=level: zstandard.ZstdCompressor(level=l).compress(b),
+                    lambda b: zstandard.ZstdDecompressor().decompress(b))
+                   for level in ZSTD_LEVELS]
+    for name, compress, decompress in codecs:
+        packed = compress(data)
+        c = _best_seconds(lambda: compress(data), repeat)
+        d = _best_seconds(lambda: decompress(packed), repeat)
+        out[name] = {
+            "ratio": round(size / len(packed), 3),
+            "compress_mb_s": round(size / c / 1e6, 2),
+            "decompress_mb_s": round(size / d / 1e6, 2),
+        }
+    return out
+
+
+# ──────────────────────────────────────────────────────────────────
+# Run / history
+# ──────────────────────────────────────────────────────────────────
+
+def _git_rev() -> str | None:
+    root = Path(__file__).resolve().parents[1]
+    try:
+        rev = subprocess.run(["git", "rev-parse", "--short", "HEAD"], cwd=root,
+                             capture_output=True, text=True, check=True).stdout.strip()
+        dirty = subprocess.run(["git", "diff", "--quiet", "HEAD", "--"], cwd=root).returncode != 0
+    except (OSError, subprocess.CalledProcessError):
+        return None
+    return rev + ("-dirty" if dirty else "")
+
+
+def _metric(result: dict, dotted: str):
+    value = result
+    for key in dotted.split("."):
+        if not isinstance(value, dict):
+            return None
+        value = value.get(key)
+    return value
+
+
+def _history() -> list:
+    try:
+        return [json.loads(line) for line in HISTORY_FILE.read_text(encoding="utf-8").splitlines() if line.strip()]
+    except (OSError, ValueError):
+        return []
+
+
+_SUMMARY_METRICS = ("encode.mb_s", "records.mb_s", "columns.mb_s", "dashboard.mb_s",
+                    f"codecs.gzip-{es.GZIP_LEVEL}.ratio")
+
+
+def _print_changes(run: dict, previous: dict) -> None:
+    print(f"\nChange against {previous['rev'] or '?'} ({previous['at'][:19]}):")
+    for name, result in run["results"].items():
+        old = previous["results"].get(name)
+        if old is None:
+            continue
+        parts = []
+        for metric in _SUMMARY_METRICS:
+            a, b = _metric(old, metric), _metric(result, metric)
+            if isinstance(a, (int, float)) and isinstance(b, (int, float)) and a:
+                parts.append(f"{metric} {(b - a) / a * 100:+.1f} %")
+        if parts:
+            print(f"  {name:<20} " + ", ".join(parts))
+
+
+def cmd_run(args) -> None:
+    manifest = _load_manifest()
+    names = [n for n in sorted(manifest) if not args.only or n in args.only]
+    if not names:
+        print(f"[ERROR] No fixtures in {FIXTURE_DIR}: run `synth` or `record` first", file=sys.stderr)
+        sys.exit(1)
+
+    paths = {name: str(FIXTURE_DIR / f"{name}.bin") for name in names}
+    dashboard = bench_dashboard(list(paths.values()), args.repeat)
+    if not decoder.columns_available():
+        print("numpy not installed: columns skipped")
+
+    results = {}
+    for name in names:
+        path = paths[name]
+        data = Path(path).read_bytes()
+        size = len(data)
+        version = data[0] if data else None
+        n_records = sum(1 for _ in decoder.iter_decoded_records_for_export(path))
+        print(f"{name}  ({size:,} bytes, V{version}, {n_records:,} records)")
+
+        result = {"version": version, "bytes": size, "records": n_records}
+        result["encode"] = bench_encode(path, size, args.repeat)
+        result["records"] = bench_records(path, size, args.repeat)
+        if decoder.columns_available():
+            result["columns"] = bench_columns(path, size, args.repeat)
+        if path in dashboard:
+            result["dashboard"] = dashboard[path]
+        result["codecs"] = bench_codecs(data, args.repeat)
+        results[name] = result
+
+        e = result["encode"]
+        print(f"  {'encode':<12} {e['mb_s']:8.2f} MB/s  {e['records_s']:10,.0f} rec/s  "
+              f"(ABSOLUTE {e['absolute_records_s'] or 0:,.0f}/s, DELTA {e['delta_records_s'] or 0:,.0f}/s, "
+              f"{e['bytes_vs_fixture']:.3f} x fixture size, roundtrip {'ok' if e['roundtrip'] else 'FAILED'})")
+        for stage in ("records", "columns", "dashboard"):
+            r = result.get(stage)
+            if r is None:
+                continue
+            if "error" in r:
+                print(f"  {stage:<12} {r['error']}")
+            else:
+                rate = f"  {r['records_s']:10,.0f} rec/s" if "records_s" in r else ""
+                print(f"  {stage:<12} {r['mb_s']:8.2f} MB/s{rate}")
+        for codec, c in result["codecs"].items():
+            print(f"  {codec:<12} ratio {c['ratio']:6.2f}  compress {c['compress_mb_s']:8.2f} MB/s  "
+                  f"decompress {c['decompress_mb_s']:8.2f} MB/s")
+
+    run = {
+        "at": datetime.now(timezone.utc).isoformat(),
+        "rev": _git_rev(),
+        "host": platform.node(),
+        "machine": platform.machine(),
+        "python": platform.python_version(),
+        "repeat": args.repeat,
+        "results": results,
+    }
+    previous = [r for r in _history() if r.get("machine") == run["machine"] and r.get("host") == run["host"]]
+    if previous:
+        _print_changes(run, previous[-1])
+    if not args.no_history:
+        BENCH_DIR.mkdir(parents=True, exist_ok=True)
+        with open(HISTORY_FILE, "a", encoding="utf-8") as f:
+            f.write(json.dumps(run, separators=(",", ":")) + "\n")
+        print(f"\nAppended to {HISTORY_FILE}")
+
+
+def cmd_history(args) -> None:
+    runs = _history()[-args.last:]
+    if not runs:
+        print(f"No runs in {HISTORY_FILE}")
+        return
+    names = sorted({name for run in runs for name in run["results"]})
+    print(f"{args.metric}")
+    print(f"{'run':<32}" + "".join(f"{name:>16}" for name in names))
+    for run in runs:
+        row = f"{run['at'][:16]} {run['rev'] or '?':<15}"
+        for name in names:
+            value = _metric(run["results"].get(name, {}), args.metric)
+            row += f"{'-' if value is None else value:>16}"
+        print(row)
+
+
+def main():
+    p = argparse.ArgumentParser(description="Storage format benchmark suite")
+    sub = p.add_subparsers(dest="command", required=True)
+
+    rec = sub.add_parser("record", help="Add recorded hour files as fixtures")
+    rec.add_argument("files", nargs="+")
+    rec.add_argument("--label", help="Fixture label (one file only; default: file name)")
+    rec.set_defaults(fn=cmd_record)
+
+    syn = sub.add_parser("synth", help="Write the synthetic fixtures")
+    syn.set_defaults(fn=cmd_synth)
+
+    run = sub.add_parser("run", help="Benchmark all fixtures and record the results")
+    run.add_argument("--only", nargs="+", metavar="FIXTURE")
+    run.add_argument("--repeat", type=int, default=3)
+    run.add_argument("--no-history", action="store_true")
+    run.set_defaults(fn=cmd_run)
+
+    hist = sub.add_parser("history", help="One metric over the recorded runs")
+    hist.add_argument("--metric", default="encode.mb_s",
+                      help="Dotted result path, e.g. records.mb_s or codecs.gzip-4.ratio")
+    hist.add_argument("--last", type=int, default=20)
+    hist.set_defaults(fn=cmd_history)
+
+    args = p.parse_args()
+    args.fn(args)
+
+
+if __name__ == "__main__":
+    main()
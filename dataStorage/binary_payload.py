@@ -0,0 +1,323 @@
+"""
+binary_payload.py
+-----------------
+Decoder for the compact binary sensor payload published by the ESP32 nodes
+when the configure command selects "format": "bin" (see firmware mqtt.h for
+the authoritative layout).
+
+The decoder rebuilds the exact dict shape of the JSON payload, including ISO
+8601 timestamps and the "g" gap list for sensors without data, so the rest
+of the pipeline (normalise_sensor_timestamps, update_sensor_runtime,
+enqueue_packet) does not need to know which format the node used. The
+listener asks for Unix-second timestamps instead (unix_ts=True), which
+normalise_sensor_timestamps() takes as they are.
+
+Frame layout, version 1 (little-endian):
+    header  32 bytes   magic, version, flags, range, serial_hash, seq,
+                       base_tick, base_utc_us, odr_hz, decim, accel_count,
+                       accel_period, incl_count, cfg_epoch
+    accel   accel_count x <iii>     raw ADXL355 counts, INT32_MIN = stream gap
+    incl    incl_count  x <hhhh>    dtick, raw X/Y/Z angle LSB
+    temp    <ih> if HAS_TEMP        dtick, centi-degC
+    send    <q>  if SEND_TS         node UTC at encoding, us
+    summary <BB3i3i3i3I> if SUMMARY real/NaN sample counts, per-axis
+                                    min, max, mean, RMS in raw counts
+    gaps    <B> n, n x <BBiI> if GAPS  sensor, reason, dtick, duration us
+
+Frame layout, version 2 ("format": "packed"): identical except that the
+accel block becomes
+    u16 accel_bytes, then per axis: <i first sample, and for every block of
+    up to 32 deltas: <B width, then the zigzag deltas bit-packed LSB first
+(see firmware accel_pack.h). Decoding is lossless: both versions yield the
+same packet dict.
+
+A node throttled to the coarse publish level sends several consecutive frames
+in one message; split_binary_frames() separates them.
+
+Usage (called from mqtt_listener_data.py):
+    from binary_payload import is_binary_payload, decode_binary_payload
+    if is_binary_payload(msg.payload):
+        data = decode_binary_payload(msg.payload, serial)
+"""
+
+import struct
+from datetime import datetime, timedelta, timezone
+
+BIN_MAGIC = 0xB5
+BIN_VERSION = 1
+BIN_VERSION_PACKED = 2              # accel block delta + zigzag + bit-packed
+ACCEL_PACK_BLOCK = 32               # firmware accel_pack.h
+
+FLAG_ACCEL_VALID = 0x01
+FLAG_INCL_VALID = 0x02
+FLAG_HAS_TEMP = 0x04
+FLAG_TEMP_VALID = 0x08
+FLAG_REPLAYED = 0x10                # stored on the node while offline, sent late
+FLAG_SEND_TS = 0x20                 # send_utc_us trailer present
+FLAG_SUMMARY = 0x40                 # per-axis accel summary trailer present
+FLAG_GAPS = 0x80                    # sensor gap list trailer present
+
+ACCEL_INVALID = -0x80000000         # MQTT_ACCEL_INVALID: gap sample, decoded as NaN
+
+_HEADER_STRUCT = struct.Struct("<BBBBIIIqHBBHBB")
+_INCL_STRUCT = struct.Struct("<hhhh")
+_TEMP_STRUCT = struct.Struct("<ih")
+_SEND_TS_STRUCT = struct.Struct("<q")
+_SUMMARY_STRUCT = struct.Struct("<BB3i3i3i3I")
+_GAP_STRUCT = struct.Struct("<BBiI")
+
+# Firmware constants mirrored here for decoding.
+TICK_US = 125                       # 8 kHz acquisition tick
+GAP_PACKET_US = 1_000_000           # MQTT_GAP_PACKET_US: one packet
+GAP_SENSORS = {0: "a", 1: "i"}      # mqtt_gap_sensor_t
+GAP_REASONS = {1: "disconnected", 2: "no_samples"}  # mqtt_gap_reason_t
+SCL3300_DEG_PER_LSB = 90.0 / 16384.0
+ADXL355_LSB_PER_G = {1: 256000.0, 2: 128000.0, 3: 64000.0}
+
+_EPOCH = datetime(1970, 1, 1, tzinfo=timezone.utc)
+_NAN = float("nan")
+
+
+def fnv1a32(text: str) -> int:
+    """32-bit FNV-1a hash, identical to the firmware serial hash."""
+    h = 0x811C9DC5
+    for b in text.encode():
+        h ^= b
+        h = (h * 0x01000193) & 0xFFFFFFFF
+    return h
+
+
+def is_binary_payload(payload: bytes) -> bool:
+    """True if the payload starts with the binary frame magic byte."""
+    return len(payload) > 0 and payload[0] == BIN_MAGIC
+
+
+def _iso_ts(base_utc_us: int, tick: int, dtick: int) -> str:
+    """ISO timestamp for base + dtick ticks, or the firmware's unsynced marker."""
+    if base_utc_us == 0:
+        return f"tick:{(tick + dtick) & 0xFFFFFFFF:08d}"
+    t = _EPOCH + timedelta(microseconds=base_utc_us + dtick * TICK_US)
+    return t.strftime("%Y-%m-%dT%H:%M:%S.%fZ")
+
+
+def _unix_ts(base_utc_us: int, tick: int, dtick: int):
+    """Unix seconds for base + dtick ticks, the same float
+    normalise_sensor_timestamps() makes of _iso_ts(); the unsynced marker as is."""
+    if base_utc_us == 0:
+        return f"tick:{(tick + dtick) & 0xFFFFFFFF:08d}"
+    return (base_utc_us + dtick * TICK_US) / 1_000_000
+
+
+def _gap(ts, base_utc_us: int, tick: int, dtick: int, dur_us: int,
+         sensor: str, reason: str) -> list:
+    """One "g" entry, as the JSON payload sends it."""
+    return [ts(base_utc_us, tick, dtick), dur_us, sensor, reason]
+
+
+def _frame_length(payload: bytes, offset: int, header: tuple) -> int:
+    """Total length of the frame starting at offset, from its header."""
+    flags, version, accel_n, incl_n = header[2], header[1], header[10], header[12]
+    if version == BIN_VERSION_PACKED:
+        (accel_bytes,) = struct.unpack_from("<H", payload, offset + _HEADER_STRUCT.size)
+        accel_len = 2 + accel_bytes
+    else:
+        accel_len = accel_n * 12
+    length = (_HEADER_STRUCT.size + accel_len + incl_n * _INCL_STRUCT.size
+              + (_TEMP_STRUCT.size if flags & FLAG_HAS_TEMP else 0)
+              + (_SEND_TS_STRUCT.size if flags & FLAG_SEND_TS else 0)
+              + (_SUMMARY_STRUCT.size if flags & FLAG_SUMMARY else 0))
+    if flags & FLAG_GAPS:
+        # The gap count is the first byte after the fixed-size trailers
+        if offset + length >= len(payload):
+            raise ValueError(f"truncated gap list at byte {offset + length}")
+        length += 1 + payload[offset + length] * _GAP_STRUCT.size
+    return length
+
+
+def unpack_accel(block: bytes, count: int) -> list:
+    """Decode an accel_pack.h block into count [x, y, z] raw count rows."""
+    axes = []
+    pos = 0
+    for _ in range(3):
+        (value,) = struct.unpack_from("<i", block, pos)
+        pos += 4
+        values = [value]
+        remaining = count - 1
+        while remaining > 0:
+            m = min(ACCEL_PACK_BLOCK, remaining)
+            width = block[pos]
+            pos += 1
+            nbytes = (m * width + 7) // 8
+            bits = int.from_bytes(block[pos:pos + nbytes], "little")
+            pos += nbytes
+            mask = (1 << width) - 1
+            for k in range(m):
+                zz = (bits >> (k * width)) & mask
+                delta = (zz >> 1) ^ -(zz & 1)
+                value = ((value + delta + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+                values.append(value)
+            remaining -= m
+        axes.append(values)
+    if pos != len(block):
+        raise ValueError(f"packed accel block length {len(block)} != decoded {pos}")
+    return [list(row) for row in zip(*axes)]
+
+
+def split_binary_frames(payload: bytes) -> list[bytes]:
+    """
+    Split a message into its binary frames.
+
+    Nodes throttled to the coarse publish level (firmware flow_control.h)
+    concatenate several 1 s frames into one message; every other message
+    holds exactly one. Frame lengths come from each header. Raises
+    ValueError if the message does not divide into whole frames.
+    """
+    frames = []
+    offset = 0
+    while offset < len(payload):
+        if len(payload) - offset < _HEADER_STRUCT.size:
+            raise ValueError(f"truncated frame header at byte {offset}")
+        header = _HEADER_STRUCT.unpack_from(payload, offset)
+        if header[0] != BIN_MAGIC or len(payload) - offset < _HEADER_STRUCT.size + 2:
+            raise ValueError(f"bad frame at byte {offset}")
+        length = _frame_length(payload, offset, header)
+        if offset + length > len(payload):
+            raise ValueError(f"bad frame at byte {offset}")
+        frames.append(payload[offset:offset + length])
+        offset += length
+    return frames
+
+
+def decode_binary_payload(payload: bytes, serial: str | None = None,
+                          unix_ts: bool = False) -> dict:
+    """
+    Decode one binary frame into the JSON-equivalent packet dict.
+
+    With unix_ts the sample and gap times are Unix seconds (float) instead
+    of ISO 8601 strings: the listener then skips formatting them only for
+    normalise_sensor_timestamps() to parse them back.
+
+    Raises ValueError on a malformed frame, unknown version, or (when serial
+    is given) a serial hash that does not match the publishing topic.
+    The returned dict also carries "seq" for gap detection, "e" (the node's
+    config epoch, as in the JSON payload), "st" (send time in UTC us, as in
+    the JSON payload) when present, "s" (the per-axis accel summary, as in
+    the JSON payload) when present, "g" (sensor gaps, as in the JSON payload;
+    the sensor's own array is then empty) and "replayed" when the frame comes
+    from the node's store-and-forward log.
+    """
+    if len(payload) < _HEADER_STRUCT.size:
+        raise ValueError(f"binary frame too short ({len(payload)} bytes)")
+
+    (magic, version, flags, range_code, serial_hash, seq, base_tick,
+     base_utc_us, odr_hz, decim, accel_n, accel_period, incl_n,
+     cfg_epoch) = _HEADER_STRUCT.unpack_from(payload, 0)
+
+    if magic != BIN_MAGIC:
+        raise ValueError(f"bad magic 0x{magic:02X}")
+    if version not in (BIN_VERSION, BIN_VERSION_PACKED):
+        raise ValueError(f"unsupported binary frame version {version}")
+    if serial is not None and serial_hash != fnv1a32(serial):
+        raise ValueError(f"serial hash mismatch for {serial}")
+
+    if version == BIN_VERSION_PACKED and len(payload) < _HEADER_STRUCT.size + 2:
+        raise ValueError(f"binary frame too short ({len(payload)} bytes)")
+    expected = _frame_length(payload, 0, (magic, version, flags, range_code, serial_hash,
+                                          seq, base_tick, base_utc_us, odr_hz, decim,
+                                          accel_n, accel_period, incl_n, cfg_epoch))
+    if len(payload) != expected:
+        raise ValueError(f"binary frame length {len(payload)} != expected {expected}")
+
+    _ts = _unix_ts if unix_ts else _iso_ts
+    offset = _HEADER_STRUCT.size
+    data: dict = {"seq": seq, "e": cfg_epoch}
+    if flags & FLAG_REPLAYED:
+        data["replayed"] = True
+
+    # ---- Acceleration ----
+    rows = None
+    if version == BIN_VERSION_PACKED:
+        (accel_bytes,) = struct.unpack_from("<H", payload, offset)
+        offset += 2
+        if accel_n > 0:
+            rows = unpack_accel(payload[offset:offset + accel_bytes], accel_n)
+        offset += accel_bytes
+    elif accel_n > 0:
+        raw = struct.unpack_from(f"<{accel_n * 3}i", payload, offset)
+        offset += accel_n * 12
+        rows = [raw[3 * k:3 * k + 3] for k in range(accel_n)]
+
+    if flags & FLAG_ACCEL_VALID and rows:
+        lsb_per_g = ADXL355_LSB_PER_G.get(range_code, ADXL355_LSB_PER_G[1])
+        data["a"] = [
+            [_ts(base_utc_us, base_tick, k * accel_period), _NAN, _NAN, _NAN]
+            if x == ACCEL_INVALID else
+            [_ts(base_utc_us, base_tick, k * accel_period),
+             x / lsb_per_g,
+             y / lsb_per_g,
+             z / lsb_per_g]
+            for k, (x, y, z) in enumerate(rows)
+        ]
+    else:
+        data["a"] = []
+
+    # ---- Inclination ----
+    if flags & FLAG_INCL_VALID and incl_n > 0:
+        incl = []
+        for _ in range(incl_n):
+            dtick, x, y, z = _INCL_STRUCT.unpack_from(payload, offset)
+            offset += _INCL_STRUCT.size
+            incl.append([_ts(base_utc_us, base_tick, dtick),
+                         x * SCL3300_DEG_PER_LSB,
+                         y * SCL3300_DEG_PER_LSB,
+                         z * SCL3300_DEG_PER_LSB])
+        data["i"] = incl
+    else:
+        data["i"] = []
+
+    # ---- Temperature ----
+    if flags & FLAG_HAS_TEMP:
+        dtick, centi = _TEMP_STRUCT.unpack_from(payload, offset)
+        offset += _TEMP_STRUCT.size
+        if flags & FLAG_TEMP_VALID:
+            data["T"] = [_ts(base_utc_us, base_tick, dtick), centi / 100.0]
+        else:
+            data["T"] = [_ts(base_utc_us, base_tick, 0), _NAN]
+
+    # ---- Send time ----
+    if flags & FLAG_SEND_TS:
+        (data["st"],) = _SEND_TS_STRUCT.unpack_from(payload, offset)
+        offset += _SEND_TS_STRUCT.size
+
+    # ---- Accel summary ----
+    if flags & FLAG_SUMMARY:
+        fields = _SUMMARY_STRUCT.unpack_from(payload, offset)
+        real, nan = fields[0], fields[1]
+        summary = {"n": real, "nan": nan}
+        if real > 0:
+            lsb_per_g = ADXL355_LSB_PER_G.get(range_code, ADXL355_LSB_PER_G[1])
+            for k, key in enumerate(("min", "max", "mean", "rms")):
+                summary[key] = [v / lsb_per_g for v in fields[2 + 3 * k:5 + 3 * k]]
+        data["s"] = summary
+        offset += _SUMMARY_STRUCT.size
+
+    # ---- Gaps ----
+    gaps = []
+    if flags & FLAG_GAPS:
+        count = payload[offset]
+        offset += 1
+        for _ in range(count):
+            sensor, reason, dtick, dur_us = _GAP_STRUCT.unpack_from(payload, offset)
+            offset += _GAP_STRUCT.size
+            gaps.append(_gap(_ts, base_utc_us, base_tick, dtick, dur_us,
+                             GAP_SENSORS.get(sensor, "a"), GAP_REASONS.get(reason, "unknown")))
+    else:
+        # Older firmware: no gap list, only the sensor's empty block
+        if not data["a"]:
+            gaps.append(_gap(_ts, base_utc_us, base_tick, 0, GAP_PACKET_US, "a", "disconnected"))
+        if not data["i"]:
+            gaps.append(_gap(_ts, base_utc_us, base_tick, 0, GAP_PACKET_US, "i", "disconnected"))
+    if gaps:
+        data["g"] = gaps
+
+    return data
@@ -28,10 +28,13 @@ FLAG_ACCEL  = 0x01
 FLAG_INCLIN = 0x02
 FLAG_TEMP   = 0x04
 SENTINEL    = 0xFF
+GAP_MARKER  = 0xFE      # v4 GAP record: sensor(B) reason(B) start(q) dur(I)
 
 FORMAT_V1 = 1
 FORMAT_V2 = 2
 FORMAT_V3 = 3
+FORMAT_V4 = 4
+FORMAT_V5 = 5           # block-columnar, bit-packed (encoder_storage.py)
 INT32_NAN_SENTINEL = -2147483648
 CHANGED_NAN_X = 0x10
 CHANGED_NAN_Y = 0x20
@@ -110,6 +113,28 @@ def _check_ts(ts_us, rec_idx, label, issues):
 # PASS 1 — Structural scan
 # ══════════════════════════════════════════════════════════════════
 
+def _packed_block(f, label, scale, show, rec_idx, issues):
+    """Header of one v5 accel / inclin block; the bit-packed payload is
+    skipped (the backend decoder unpacks it)."""
+    n, first_us, last_us, ts_base, ts_bits = read_fmt(f, "<HqqqB", f"{label} header")
+    _check_ts(first_us, rec_idx, label, issues)
+    if last_us < first_us:
+        issues.append((rec_idx, label, f"last ts {last_us} before first ts {first_us}"))
+    if show:
+        print(f"  │  {label} n={n}  ts {ts_str(first_us / TS_SCALE)} .. {ts_str(last_us / TS_SCALE)}  "
+              f"Δts base={ts_base}µs bits={ts_bits}")
+    axes = [read_fmt(f, "<HiiiiB", f"{label} axis {a}") for a in range(3)]
+    size = (max(0, n - 1) * ts_bits + 7) // 8
+    for a, (valid, first, mn, mx, base, bits) in enumerate(axes):
+        if valid < n:
+            size += (n + 7) // 8
+        size += (max(0, valid - 1) * bits + 7) // 8
+        if show:
+            print(f"  │    axis {a}: valid={valid}/{n}  first={fmt_scaled_opt(first, scale)}  "
+                  f"min={fmt_scaled_opt(mn, scale)}  max={fmt_scaled_opt(mx, scale)}  "
+                  f"Δ base={base} bits={bits}")
+    read_bytes(f, size, f"{label} packed payload")
+
 def pass1_structural(filepath, focus_record=None):
     print(f"\n{'─'*70}")
     print(f"  PASS 1 — Structural scan (raw values, no reconstruction)")
@@ -119,7 +144,7 @@ def pass1_structural(filepath, focus_record=None):
     with open_decompressed(filepath) as f:
         ver = f.read(1)
         fv  = ver[0] if ver else FORMAT_V2
-        if fv not in (FORMAT_V1, FORMAT_V2, FORMAT_V3):
+        if fv not in (FORMAT_V1, FORMAT_V2, FORMAT_V3, FORMAT_V4, FORMAT_V5):
             f.seek(-1, 1)  # no version byte — seek back, treat as v1
             fv = FORMAT_V1
         print(f"  File format: v{fv}")
@@ -132,7 +157,35 @@ def pass1_structural(filepath, focus_record=None):
             show = focus_record is None or abs(idx - focus_record) <= 2
 
             try:
-                if sentinel == SENTINEL:
+                if sentinel == GAP_MARKER and fv >= FORMAT_V3:
+                    sensor, reason, start_us, dur_us = read_fmt(f, "<BBqI", "gap record")
+                    _check_ts(start_us, idx, "GAP", issues)
+                    if show:
+                        print(f"\n  ┌─ Record #{idx}  [GAP]  offset=0x{offset:06X}")
+                        print(f"  │  sensor={sensor} reason={reason}  start={start_us}µs "
+                              f"({ts_str(start_us / TS_SCALE)})  dur={dur_us}µs")
+                        print(f"  └─")
+                elif fv >= FORMAT_V5:
+                    header = sentinel
+                    kind = "DELTA"
+                    if sentinel == SENTINEL:
+                        (header,) = read_fmt(f, "<B", "abs header")
+                        kind = "ABSOLUTE"
+                    if show:
+                        print(f"\n  ┌─ Record #{idx}  [{kind}]  offset=0x{offset:06X}")
+                        print(f"  │  header = 0x{header:02X}  flags={flag_str(header)}")
+                    if header & FLAG_ACCEL:
+                        _packed_block(f, "accel", ACCEL_SCALE, show, idx, issues)
+                    if header & FLAG_INCLIN:
+                        _packed_block(f, "inclin", INCLIN_SCALE, show, idx, issues)
+                    if header & FLAG_TEMP:
+                        ts_us, val = read_fmt(f, "<qi", "temp")
+                        _check_ts(ts_us, idx, f"{kind}/temp", issues)
+                        if show:
+                            print(f"  │  temp ts={ts_us}µs ({ts_str(ts_us / TS_SCALE)})  "
+                                  f"val={fmt_scaled_opt(val, TEMP_SCALE, '.2f')} °C")
+                    if show: print(f"  └─")
+                elif sentinel == SENTINEL:
                     (header,) = read_fmt(f, "<B", "abs header")
                     if show:
                         print(f"\n  ┌─ Record #{idx}  [ABSOLUTE]  offset=0x{offset:06X}")
@@ -352,10 +405,14 @@ def pass2_delta_trace(filepath, focus_record=None):
     with open_decompressed(filepath) as f:
         ver = f.read(1)
         fv  = ver[0] if ver else FORMAT_V2
-        if fv not in (FORMAT_V1, FORMAT_V2, FORMAT_V3):
+        if fv not in (FORMAT_V1, FORMAT_V2, FORMAT_V3, FORMAT_V4, FORMAT_V5):
             f.seek(-1, 1)  # no version byte — seek back, treat as v1
             fv = FORMAT_V1
         print(f"  File format: v{fv}")
+        if fv >= FORMAT_V5:
+            # Self-contained blocks: no delta state to trace
+            print(f"  v{fv} records carry no delta state; see pass 1")
+            return issues
         idx = 0
         while True:
             b = f.read(1)
@@ -364,7 +421,12 @@ def pass2_delta_trace(filepath, focus_record=None):
             show = focus_record is None or abs(idx - focus_record) <= 2
 
             try:
-                if sentinel == SENTINEL:
+                if sentinel == GAP_MARKER and fv >= FORMAT_V3:
+                    sensor, reason, start_us, dur_us = read_fmt(f, "<BBqI", "gap record")
+                    if show:
+                        print(f"\n  Record #{idx} [GAP]  sensor={sensor} reason={reason}  "
+                              f"{ts_str(start_us / TS_SCALE)} +{dur_us / TS_SCALE:.3f} s")
+                elif sentinel == SENTINEL:
                     (header,) = read_fmt(f, "<B", "abs header")
                     if show:
                         print(f"\n  Record #{idx} [ABSOLUTE]")
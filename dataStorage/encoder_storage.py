@@ -1,22 +1,53 @@
 import os
 import struct
-from datetime import datetime, UTC
+from datetime import datetime, timedelta, UTC
 import time
 import queue
 import threading
 import gzip
 import math
+import zlib
 
 from fault_logger import log_fault_events
+import accel_summary
+import ingest_partition
+import ingest_stats
+import metrics
+import node_analytics
+import plot_pyramid
+import storage_catalog
+import zstd_archive
 
 DATA_DIR = "/mnt/ssd/data"
 SSD_MOUNT = "/mnt/ssd"
 
-# SSD state tracking — re-evaluated on every write so mid-run unmounts
-# and re-mounts are detected automatically.
+# SSD state tracking — re-evaluated by the storage monitor thread every
+# SSD_MONITOR_INTERVAL_S (and right after a failed write), so mid-run
+# unmounts and re-mounts are detected without a statvfs per packet.
 _ssd_ok = False
+_ssd_low_space = False
 _ssd_last_warn = 0.0
 _SSD_WARN_INTERVAL = 30.0
+SSD_MONITOR_INTERVAL_S = 10.0
+
+# -------------------------------------------------------------------
+# Hourly file writers
+# -------------------------------------------------------------------
+# Each node keeps one buffered handle open on its active hourly file
+# instead of an open("ab") / close per packet. Records reach the kernel
+# when WRITER_BUFFER_BYTES fill up or WRITER_FLUSH_INTERVAL_S have passed,
+# so readers of the active hour see data at most that late; os.fsync()
+# runs every WRITER_FSYNC_INTERVAL_S and on hour rollover or shutdown. A
+# crash loses at most the unflushed tail, and _recover_active_hourly_file()
+# trims any partial record on restart. It validates only from the last
+# record the time index points at (an ABSOLUTE record at least every
+# ABSOLUTE_RECORD_INTERVAL_S), so a restart late in the hour costs the
+# same as one early in it. Writers idle for WRITER_IDLE_CLOSE_S
+# are closed by the monitor.
+WRITER_BUFFER_BYTES = 64 * 1024
+WRITER_FLUSH_INTERVAL_S = float(os.getenv("SHM_ENCODER_FLUSH_S", "2"))
+WRITER_FSYNC_INTERVAL_S = float(os.getenv("SHM_ENCODER_FSYNC_S", "30"))
+WRITER_IDLE_CLOSE_S = 300.0
 
 DELTA_NULL_THRESHOLD = 1
 INT32_NAN_SENTINEL = -2147483648
@@ -41,13 +72,68 @@ FAULT_ACTIVE_FILE_RECOVERY = 106
 FAULT_STORAGE_QUEUE_OVERFLOW = 107
 FAULT_INVALID_TIMESTAMP = 108
 
-# Queue setting used by the listener/consumer boundary.
-# QUEUE_MAX_SIZE = 1000
+# -------------------------------------------------------------------
+# Ingest queue budget
+# -------------------------------------------------------------------
+# The shard queues share one memory budget, so a stalled SSD cannot grow
+# the listener until the OOM killer takes it. Packet cost is estimated
+# from the row count (_packet_cost(), roughly what the decoded lists take
+# in CPython). When a packet does not fit, ENCODER_OVERFLOW_POLICY decides:
+#   drop_oldest   evict the oldest queued packets, from the packet's own
+#                 shard first, keeping the freshest data flowing
+#   drop_newest   refuse the incoming packet
+#   spill_raw     refuse it for encoding only; the verbatim payload is
+#                 already in the raw backup (raw_backup.py) and can be
+#                 replayed from there
+# FAULT_STORAGE_QUEUE_OVERFLOW is logged once per node per overflow
+# episode, which ends when the queues drain below QUEUE_RESUME_FRACTION of
+# the budget.
+ENCODER_QUEUE_BUDGET_BYTES = int(float(os.getenv("SHM_ENCODER_QUEUE_MB", "64")) * 1024 * 1024)
+_OVERFLOW_POLICIES = ("drop_oldest", "drop_newest", "spill_raw")
+ENCODER_OVERFLOW_POLICY = os.getenv("SHM_ENCODER_OVERFLOW", "drop_oldest")
+if ENCODER_OVERFLOW_POLICY not in _OVERFLOW_POLICIES:
+    print(f"[encoder] Unknown SHM_ENCODER_OVERFLOW={ENCODER_OVERFLOW_POLICY!r}, using drop_oldest")
+    ENCODER_OVERFLOW_POLICY = "drop_oldest"
+QUEUE_RESUME_FRACTION = 0.5
+
+_queue_guard = threading.Lock()
+_queue_bytes = 0
+_queue_peak_bytes = 0
+_queue_overflow = {"dropped_oldest": 0, "dropped_newest": 0, "spilled": 0}
+_overflowing_nodes: set[str] = set()
 
 # -------------------------------------------------------------------
-# Gzip compression settings
+# Archive compression settings
 # -------------------------------------------------------------------
+# A node's finished hour used to be gzipped on its shard worker at
+# rollover, so every node's ingest stalled at the top of the hour. The
+# rollover now only queues the file for one low-priority archive worker,
+# which compresses it to a temporary file, verifies the result against the
+# .bin (length + CRC32) and only then swaps it in and deletes the .bin.
+# Readers keep using the .bin until the swap.
+#
+# SHM_ARCHIVE_CODEC picks gzip (default; one member with a full flush per
+# indexed record) or zstd (one frame per indexed record with a trained
+# dictionary, see backend zstd_archive.py; falls back to gzip when the
+# zstandard package is missing).
 GZIP_LEVEL = 4
+_ARCHIVE_CODECS = ("gzip", "zstd")
+ARCHIVE_CODEC = os.getenv("SHM_ARCHIVE_CODEC", "gzip")
+if ARCHIVE_CODEC not in _ARCHIVE_CODECS:
+    print(f"[encoder] Unknown SHM_ARCHIVE_CODEC={ARCHIVE_CODEC!r}, using gzip")
+    ARCHIVE_CODEC = "gzip"
+elif ARCHIVE_CODEC == "zstd" and not zstd_archive.available():
+    print("[encoder] SHM_ARCHIVE_CODEC=zstd but zstandard is not installed, using gzip")
+    ARCHIVE_CODEC = "gzip"
+ARCHIVE_SUFFIXES = {"gzip": ".gz", "zstd": ".zst"}
+ARCHIVE_NICE = 10           # added to the archive worker thread's nice value
+ARCHIVE_ATTEMPTS = 3        # the .bin grew under the compressor (replay)
+
+_archive_queue: queue.Queue = queue.Queue()
+_archive_thread: threading.Thread | None = None
+# Held for the final swap, and by replay appends to a finished hour's .bin,
+# so a replayed record never lands in a .bin that is being deleted
+_archive_swap_lock = threading.Lock()
 
 # -------------------------------------------------------------------
 # Binary encoding settings
@@ -57,28 +143,113 @@ ACCEL_SCALE = 10000     # 0.0001 g -> int
 INCLIN_SCALE = 10000    # 0.0001 ° -> int
 TS_SCALE = 1_000_000    # seconds  -> µs
 
-FILE_FORMAT_VERSION = 3
+FORMAT_V4 = 4
+FORMAT_V5 = 5
+FILE_FORMAT_VERSION = FORMAT_V5
+
+# Version 4 adds GAP records: a sensor outage (firmware "g" entry) stored as
+#   0xFE | sensor(B) | reason(B) | start_us(q) | dur_us(I)
+# instead of rows of NaN samples. 0xFE is never a delta header (bits
+# 0x01-0x04 only), so readers accept GAP records in version 3 files too,
+# which is what a v3 hourly file resumed across the upgrade contains.
+GAP_MARKER = 0xFE
+GAP_SENSOR_CODES = {"a": 0, "i": 1}
+GAP_REASON_CODES = {"disconnected": 1, "no_samples": 2}
+_GAP_RECORD = struct.Struct("<BBBqI")
+
+# Version 5 keeps the record framing (GAP, ABSOLUTE 0xFF | flags, DELTA
+# flags) but stores each accel / inclin block column-wise and
+# self-contained, with no state carried between records:
+#   header   count(H) first_us(q) last_us(q) ts_base(q) ts_bits(B)
+#   per axis valid(H) first(i) min(i) max(i) base(i) bits(B)
+#            (valid samples; first / min / max are INT32_NAN_SENTINEL when
+#            there are none)
+#   NaN bitmap per axis with valid < count: ceil(count / 8) bytes, bit k
+#            (LSB first) set when sample k is NaN
+#   ts       the count - 1 deltas between timestamps, minus ts_base, in
+#            ts_bits bits each
+#   per axis the valid - 1 deltas between its valid values, minus base, in
+#            bits bits each
+# Packed fields are little-endian bit streams padded to a byte. The
+# frame-of-reference base makes every delta non-negative and the width
+# follows the block's own spread, so regular timestamps take no bits and
+# a quiet axis a few. Values are stored exactly (no DELTA_NULL_THRESHOLD).
+# Temperature is ts_us(q) value(i) in both record types. An ABSOLUTE
+# record now only marks a time index entry. Files started before the
+# upgrade keep their version: records appended to them (resumed active
+# hour, replayed packets) are encoded in that version.
+_PACKED_HEAD = struct.Struct("<HqqqB")
+_PACKED_AXIS = struct.Struct("<HiiiiB")
+_PACKED_TEMP = struct.Struct("<qi")
 
 MAX_DELTA_S = 60.0
 ABSOLUTE_RECORD_INTERVAL_S = 60.0
 INT16_MAX = 32767
 
+# Time index sidecar: <hourly file>.idx holds a version byte and one entry per
+# ABSOLUTE record (live or replayed), where decoding can restart:
+#   offset(Q) | first_ts_us(q) | last_ts_us(q) | flags(B)
+# flags carries the sensors the record resyncs (0x01 accel, 0x02 inclin,
+# 0x04 temp) and INDEX_REPLAYED for store-and-forward records, whose times
+# are out of order with the live ones. In a .bin the offset is the record's
+# byte offset (any GAP records written with it come first). Compression
+# stays one gzip member but does a zlib full flush before every indexed
+# record, so in a .bin.gz (index .bin.gz.idx) the offset is where raw
+# deflate can restart; entries for records appended later as their own
+# gzip member carry INDEX_GZ_MEMBER and point at the member. In a .bin.zst
+# every entry is a frame start and carries INDEX_GZ_MEMBER. Readers
+# (backend sensor_export_decoder.py) seek to the segments covering a window
+# and ignore entries past the end of the data file.
+INDEX_SUFFIX = ".idx"
+INDEX_FORMAT_VERSION = 1
+INDEX_REPLAYED = 0x80
+INDEX_GZ_MEMBER = 0x40
+_INDEX_ENTRY = struct.Struct("<QqqB")
+
 TS_MIN = 1_577_836_800.0   # 2020-01-01
 TS_MAX = 4_102_444_800.0   # 2100-01-01
 _clock_warn_interval = 10.0
 _last_clock_warn: dict[str, float] = {}
 
+# -------------------------------------------------------------------
+# Storage shards
+# -------------------------------------------------------------------
+# Each node is pinned to one shard: a queue and the single worker thread
+# that drains it. That worker owns the node's encoder state and hourly
+# writer, so a node's packets are written in arrival order with no lock
+# (a shared queue let two workers race on one node and forced ABSOLUTE
+# records). A shard is started per node up to ENCODER_MAX_SHARDS; after
+# that a new node joins the shard with the fewest nodes. Assignments never
+# move, which is what keeps the order. A node's hour rollover only closes
+# the finished file and queues it for the archive worker.
+ENCODER_MAX_SHARDS = max(1, int(os.getenv("SHM_ENCODER_SHARDS", "8")))
+
 node_state: dict = {}
-data_buffer: queue.Queue = queue.Queue()
-consumer_thread: threading.Thread | None = None
 consumer_threads: list[threading.Thread] = []
-_CONSUMER_WORKER_COUNT = 4
-_node_locks: dict[str, threading.Lock] = {}
-_node_locks_guard = threading.Lock()
 
 _storage_fault_state: dict[str, dict[str, bool]] = {}
 _storage_fault_state_guard = threading.Lock()
 
+_writers: dict = {}     # node_id -> _HourlyWriter, used by the node's shard
+_monitor_thread: threading.Thread | None = None
+
+# Hot-path metrics (backend metrics.py); the queue gauges are read from the
+# shards when the metrics are
+_ENCODE_S = metrics.histogram(
+    "shm_storage_encode_seconds", "Time to encode one live packet into a record", ("record",))
+_BYTES_WRITTEN = metrics.counter(
+    "shm_storage_bytes_written_total", "Bytes of live records appended to hourly files", ("node",))
+_ARCHIVE_S = metrics.histogram(
+    "shm_storage_archive_seconds", "Time to compress, verify and swap in a finished hourly file",
+    ("codec",), buckets=(0.5, 1.0, 2.5, 5.0, 10.0, 25.0, 50.0, 100.0, 250.0, 500.0))
+_OVERFLOW = metrics.counter(
+    "shm_storage_queue_overflow_total", "Packets dropped or spilled over the storage queue budget",
+    ("kind",))
+metrics.gauge("shm_storage_queue_packets", "Packets queued for the storage shards",
+              fn=lambda: sum(shard.queue.qsize() for shard in list(_shards)))
+metrics.gauge("shm_storage_queue_bytes", "Estimated memory of the queued packets",
+              fn=lambda: _queue_bytes)
+
 
 def _storage_fault_flags(node_id: str) -> dict[str, bool]:
     with _storage_fault_state_guard:
@@ -115,7 +286,7 @@ def _set_stateful_storage_fault(
 
 def _check_ssd(node_id: str | None = None) -> bool:
     """Return True if the SSD is mounted and the data directory is writable."""
-    global _ssd_ok, _ssd_last_warn
+    global _ssd_ok, _ssd_low_space, _ssd_last_warn
     mounted = os.path.isdir(SSD_MOUNT) and os.path.ismount(SSD_MOUNT)
     if mounted:
         try:
@@ -125,6 +296,7 @@ def _check_ssd(node_id: str | None = None) -> bool:
             if free_mb < 1000:
                 _warn_ssd(f"SSD critically low on space: {free_mb:.1f} MB free")
                 _ssd_ok = False
+                _ssd_low_space = True
                 if node_id:
                     _set_stateful_storage_fault(
                         node_id,
@@ -145,6 +317,7 @@ def _check_ssd(node_id: str | None = None) -> bool:
             if not _ssd_ok:
                 print("[SSD] Storage available — resuming writes.")
             _ssd_ok = True
+            _ssd_low_space = False
             if node_id:
                 _set_stateful_storage_fault(
                     node_id,
@@ -164,6 +337,7 @@ def _check_ssd(node_id: str | None = None) -> bool:
         except OSError as e:
             _warn_ssd(f"SSD mounted but not writable: {e}")
             _ssd_ok = False
+            _ssd_low_space = False
             if node_id:
                 _set_stateful_storage_fault(
                     node_id,
@@ -176,6 +350,7 @@ def _check_ssd(node_id: str | None = None) -> bool:
 
     _warn_ssd("SSD not mounted at /mnt/ssd — sensor data will not be saved.")
     _ssd_ok = False
+    _ssd_low_space = False
     if node_id:
         _set_stateful_storage_fault(
             node_id,
@@ -187,6 +362,28 @@ def _check_ssd(node_id: str | None = None) -> bool:
     return False
 
 
+def _ssd_ready(node_id: str) -> bool:
+    """SSD state from the last check, raising or clearing this node's storage
+    faults the way _check_ssd(node_id) would, without touching the disk."""
+    ok = _ssd_ok
+    _set_stateful_storage_fault(
+        node_id,
+        "storage_unavailable",
+        FAULT_STORAGE_UNAVAILABLE,
+        FAULT_STORAGE_RESTORED,
+        not ok,
+    )
+    if ok or _ssd_low_space:
+        _set_stateful_storage_fault(
+            node_id,
+            "storage_low_space",
+            FAULT_STORAGE_LOW_SPACE,
+            FAULT_STORAGE_SPACE_RECOVERED,
+            _ssd_low_space,
+        )
+    return ok
+
+
 def _ssd_ok_reset():
     global _ssd_ok
     _ssd_ok = False
@@ -204,65 +401,137 @@ def _warn_ssd(msg: str):
 _check_ssd()
 
 
+def _reject_timestamp(node_id: str, message: str) -> None:
+    now = time.monotonic()
+    last = _last_clock_warn.get(node_id, 0.0)
+    if now - last >= _clock_warn_interval:
+        _last_clock_warn[node_id] = now
+        print(f"[{node_id}] WARNING: {message}")
+        _log_storage_fault(node_id, FAULT_INVALID_TIMESTAMP)
+
+
+def _check_ts_range(ts: float, raw_t, node_id: str) -> float | None:
+    if TS_MIN <= ts <= TS_MAX:
+        return ts
+    try:
+        date_str = datetime.utcfromtimestamp(int(ts)).strftime("%Y-%m-%d")
+    except Exception:
+        date_str = "?"
+    _reject_timestamp(
+        node_id,
+        f"implausible timestamp {raw_t!r} ({date_str}) — clock not synced, packet dropped.",
+    )
+    return None
+
+
 def parse_iso_timestamp(raw_t: str, node_id: str) -> float | None:
     """Parse an ISO 8601 UTC timestamp string to Unix seconds (float)."""
     try:
         ts = datetime.strptime(
             raw_t.rstrip("Z"), "%Y-%m-%dT%H:%M:%S.%f"
-        ).replace(tzinfo=__import__("datetime").timezone.utc).timestamp()
+        ).replace(tzinfo=UTC).timestamp()
     except (ValueError, AttributeError):
-        now = time.monotonic()
-        last = _last_clock_warn.get(node_id, 0.0)
-        if now - last >= _clock_warn_interval:
-            _last_clock_warn[node_id] = now
-            print(f"[{node_id}] WARNING: cannot parse timestamp {raw_t!r} — packet dropped.")
-            _log_storage_fault(node_id, FAULT_INVALID_TIMESTAMP)
-        return None
-
-    if not (TS_MIN <= ts <= TS_MAX):
-        now = time.monotonic()
-        last = _last_clock_warn.get(node_id, 0.0)
-        if now - last >= _clock_warn_interval:
-            _last_clock_warn[node_id] = now
-            try:
-                date_str = datetime.utcfromtimestamp(int(ts)).strftime("%Y-%m-%d")
-            except Exception:
-                date_str = "?"
-            print(
-                f"[{node_id}] WARNING: implausible timestamp {raw_t!r} "
-                f"({date_str}) — clock not synced, packet dropped."
-            )
-            _log_storage_fault(node_id, FAULT_INVALID_TIMESTAMP)
+        _reject_timestamp(node_id, f"cannot parse timestamp {raw_t!r} — packet dropped.")
         return None
+    return _check_ts_range(ts, raw_t, node_id)
+
+
+# Fast path for normalise_sensor_timestamps(). The node always sends
+# "YYYY-MM-DDTHH:MM:SS.ffffffZ", and the whole-second prefix rarely changes
+# within a packet, so its epoch is cached (one (prefix, seconds) tuple,
+# replaced atomically, as several ingest workers call this) and only the
+# fraction is converted per sample. The result is computed like
+# datetime.timestamp() (whole microseconds / 10**6), so it is the same float
+# as parse_iso_timestamp() gives. Anything off the fixed layout takes
+# parse_iso_timestamp(), which also reports it.
+_iso_prefix_epoch: tuple = ("", 0)
+_UNIX_EPOCH = datetime(1970, 1, 1)
+_ONE_SECOND = timedelta(seconds=1)
+_FRAC_SCALE = (0, 100000, 10000, 1000, 100, 10, 1)      # by fraction digits
+
+
+def _parse_iso_fast(raw_t, node_id: str) -> float | None:
+    global _iso_prefix_epoch
+    if raw_t.__class__ is float or raw_t.__class__ is int:
+        # Binary frames are decoded straight to Unix seconds
+        return _check_ts_range(float(raw_t), raw_t, node_id)
+    if not isinstance(raw_t, str) or len(raw_t) < 21 or raw_t[19] != ".":
+        return parse_iso_timestamp(str(raw_t), node_id)
+    frac = raw_t[20:-1] if raw_t[-1] == "Z" else raw_t[20:]
+    if not (0 < len(frac) <= 6 and frac.isdigit()):
+        return parse_iso_timestamp(raw_t, node_id)
+
+    prefix = raw_t[:19]
+    cached_prefix, epoch_s = _iso_prefix_epoch
+    if prefix != cached_prefix:
+        if raw_t[4] != "-" or raw_t[7] != "-" or raw_t[10] != "T" or raw_t[13] != ":" or raw_t[16] != ":":
+            return parse_iso_timestamp(raw_t, node_id)
+        try:
+            epoch_s = (datetime(
+                int(raw_t[0:4]), int(raw_t[5:7]), int(raw_t[8:10]),
+                int(raw_t[11:13]), int(raw_t[14:16]), int(raw_t[17:19]),
+            ) - _UNIX_EPOCH) // _ONE_SECOND
+        except ValueError:
+            return parse_iso_timestamp(raw_t, node_id)
+        _iso_prefix_epoch = (prefix, epoch_s)
 
-    return ts
+    ts = (epoch_s * 1_000_000 + int(frac) * _FRAC_SCALE[len(frac)]) / 1_000_000
+    if TS_MIN <= ts <= TS_MAX:
+        return ts
+    return _check_ts_range(ts, raw_t, node_id)
 
 
 def normalise_sensor_timestamps(data: dict, node_id: str) -> bool:
-    """Parse ISO 8601 timestamps in-place to Unix seconds (float)."""
-    if "a" in data:
-        for sample in data["a"]:
-            ts = parse_iso_timestamp(str(sample[0]), node_id)
-            if ts is None:
-                return False
-            sample[0] = ts
-
-    if "i" in data:
-        for sample in data["i"]:
-            ts = parse_iso_timestamp(str(sample[0]), node_id)
-            if ts is None:
-                return False
-            sample[0] = ts
+    """Convert sample timestamps in-place to Unix seconds (float): ISO 8601
+    strings from JSON packets, already numeric ones from binary frames."""
+    parse = _parse_iso_fast
+    for key in ("a", "i"):
+        if key in data:
+            for sample in data[key]:
+                ts = parse(sample[0], node_id)
+                if ts is None:
+                    return False
+                sample[0] = ts
 
     if "T" in data:
-        ts = parse_iso_timestamp(str(data["T"][0]), node_id)
+        ts = parse(data["T"][0], node_id)
         if ts is None:
             return False
         data["T"][0] = ts
 
+    if "g" in data:
+        for gap in data["g"]:
+            ts = parse(gap[0], node_id)
+            if ts is None:
+                return False
+            gap[0] = ts
+
+    _compact_nan_arrays(data)
     return True
 
 
+def _compact_nan_arrays(data: dict) -> None:
+    """Turn an all-NaN sensor array (older firmware) into one gap entry."""
+    for key in ("a", "i"):
+        samples = data.get(key)
+        if not samples or not all(
+            isinstance(s, list) and len(s) >= 4 and all(_is_nan_value(v) for v in s[1:4])
+            for s in samples
+        ):
+            continue
+        if any(g[2] == key for g in data.get("g", [])):
+            data[key] = []
+            continue
+        start_s = float(samples[0][0])
+        if len(samples) > 1:
+            step_s = (float(samples[-1][0]) - start_s) / (len(samples) - 1)
+            dur_us = int(round((float(samples[-1][0]) - start_s + step_s) * TS_SCALE))
+        else:
+            dur_us = 0
+        data.setdefault("g", []).append([start_s, dur_us, key, "disconnected"])
+        data[key] = []
+
+
 def now_iso() -> str:
     return datetime.now(UTC).isoformat().replace("+00:00", "Z")
 
@@ -276,19 +545,78 @@ def _fresh_state() -> dict:
         "is_first": True,
         "header_written": False,
         "last_absolute_record_ts_us": 0,
+        "file_version": FILE_FORMAT_VERSION,
     }
 
 
-def _get_node_lock(node_id: str) -> threading.Lock:
-    """Return a per-node write lock so different nodes can write concurrently
-    while writes for the same node remain serialized.
+class _HourlyWriter:
+    """Buffered append handle on one node's active hourly file.
+
+    Only used by the node's shard worker.
     """
-    with _node_locks_guard:
-        lock = _node_locks.get(node_id)
-        if lock is None:
-            lock = threading.Lock()
-            _node_locks[node_id] = lock
-        return lock
+
+    def __init__(self, path: str):
+        self.path = path
+        self.file = open(path, "ab", buffering=WRITER_BUFFER_BYTES)
+        storage_catalog.note_file(path)
+        now = time.monotonic()
+        self.last_write = now
+        self.last_flush = now
+        self.last_fsync = now
+        self.unsynced = False
+
+    def write(self, data: bytes) -> None:
+        self.file.write(data)
+        self.last_write = time.monotonic()
+        self.unsynced = True
+
+    def maybe_flush(self, now: float) -> None:
+        """Apply the flush / fsync policy; raises OSError like write()."""
+        if now - self.last_flush >= WRITER_FLUSH_INTERVAL_S:
+            self.file.flush()
+            self.last_flush = now
+        if self.unsynced and now - self.last_fsync >= WRITER_FSYNC_INTERVAL_S:
+            self.file.flush()
+            os.fsync(self.file.fileno())
+            self.last_flush = self.last_fsync = now
+            self.unsynced = False
+
+    def close(self) -> None:
+        """Flush, fsync and close; raises OSError, but the handle is closed."""
+        try:
+            self.file.flush()
+            if self.unsynced:
+                os.fsync(self.file.fileno())
+                self.unsynced = False
+        finally:
+            try:
+                self.file.close()
+            except OSError:
+                pass
+
+
+def _close_writer(node_id: str) -> bool:
+    """Close the node's writer if open (shard worker); False if it failed."""
+    writer = _writers.pop(node_id, None)
+    if writer is None:
+        return True
+    try:
+        writer.close()
+        return True
+    except OSError as e:
+        _warn_ssd(f"closing {os.path.basename(writer.path)} failed for {node_id}: {e}")
+        _log_storage_fault(node_id, FAULT_BINARY_WRITE_FAILED)
+        return False
+
+
+def _writer_for(node_id: str, filepath: str) -> "_HourlyWriter":
+    """The node's writer on filepath, replacing a writer on another file."""
+    writer = _writers.get(node_id)
+    if writer is not None and writer.path == filepath:
+        return writer
+    _close_writer(node_id)
+    writer = _writers[node_id] = _HourlyWriter(filepath)
+    return writer
 
 
 def get_hourly_filepath(node_id: str) -> tuple[str, str]:
@@ -296,6 +624,12 @@ def get_hourly_filepath(node_id: str) -> tuple[str, str]:
     return hour_str, os.path.join(DATA_DIR, f"data_{node_id}_{hour_str}.bin")
 
 
+def get_hourly_filepath_for_ts(node_id: str, ts_s: float) -> tuple[str, str]:
+    """Hourly file that a packet captured at ts_s (Unix seconds) belongs to."""
+    hour_str = datetime.fromtimestamp(ts_s).strftime("%Y%m%d_%H")
+    return hour_str, os.path.join(DATA_DIR, f"data_{node_id}_{hour_str}.bin")
+
+
 def _is_nan_value(value) -> bool:
     try:
         return math.isnan(float(value))
@@ -313,44 +647,96 @@ def _encode_abs_component(value, scale: int):
     return int(float(value) * scale), True
 
 
-def needs_absolute_record(data: dict, state: dict) -> tuple[bool, str]:
-    """Return (True, reason) if any sensor would overflow delta_ts or clip int16."""
-    if "a" in data and len(data["a"]) > 0:
-        ts_s = float(data["a"][0][0])
-        gap = ts_s - state["accel"]["ts_us"] / TS_SCALE
-        if abs(gap) > MAX_DELTA_S:
-            return True, f"accel timestamp gap {gap:.1f} s"
+def _scale_column(samples: list, idx: int, scale: int) -> list:
+    # Scaled ints for one component, None where it is NaN
+    out = []
+    for s in samples:
+        v = float(s[idx])
+        out.append(None if v != v else int(v * scale))
+    return out
 
-        prev = list(state["accel"]["xyz_prev"])
-        for s in data["a"]:
-            for idx, (raw, scale, name) in enumerate(
-                ((s[1], ACCEL_SCALE, "x"), (s[2], ACCEL_SCALE, "y"), (s[3], ACCEL_SCALE, "z"))
-            ):
-                if _is_nan_value(raw):
-                    continue
-                cur = int(float(raw) * scale)
-                d = cur - prev[idx]
-                if abs(d) >= INT16_MAX:
-                    return True, f"accel {name} delta {d} would clip int16"
-                prev[idx] = cur
 
-    if "i" in data and len(data["i"]) > 0:
-        ts_s = float(data["i"][0][0])
-        gap = ts_s - state["inclin"]["ts_us"] / TS_SCALE
+def _sensor_columns(data: dict, key: str, scale: int) -> tuple:
+    """(ts_us, x, y, z) int columns of data[key], converted once per packet.
+
+    needs_absolute_record() and the encoders all read the same columns, so
+    they are cached on the packet (like ingest_stats' "_rx_s").
+    """
+    cache = data.setdefault("_cols", {})
+    cols = cache.get(key)
+    if cols is None:
+        samples = data[key]
+        cols = cache[key] = (
+            [int(float(s[0]) * TS_SCALE) for s in samples],
+            _scale_column(samples, 1, scale),
+            _scale_column(samples, 2, scale),
+            _scale_column(samples, 3, scale),
+        )
+    return cols
+
+
+def _note_pyramid(node_id: str, data: dict) -> None:
+    """Fold a stored packet into the node's plot pyramid (shard worker)."""
+    for key, scale, sensor in (("a", ACCEL_SCALE, "accel"), ("i", INCLIN_SCALE, "inclin")):
+        if data.get(key):
+            ts_us, x, y, z = _sensor_columns(data, key, scale)
+            plot_pyramid.note_columns(node_id, sensor, ts_us, (x, y, z), scale)
+    temp = data.get("T")
+    if temp and len(temp) > 1 and not _is_nan_value(temp[1]):
+        plot_pyramid.note_columns(
+            node_id, "temp", [int(float(temp[0]) * TS_SCALE)],
+            ([int(float(temp[1]) * TEMP_SCALE)],), TEMP_SCALE,
+        )
+
+
+def _note_analytics(node_id: str, data: dict) -> None:
+    """Fold a stored packet into the node's minute trends (shard worker)."""
+    if data.get("a"):
+        ts_us, x, y, z = _sensor_columns(data, "a", ACCEL_SCALE)
+        node_analytics.note_accel(
+            node_id, ts_us, (x, y, z), ACCEL_SCALE, accel_summary.packet_summary(data)
+        )
+    if data.get("i"):
+        ts_us, roll, pitch, yaw = _sensor_columns(data, "i", INCLIN_SCALE)
+        node_analytics.note_inclin(node_id, ts_us, (roll, pitch, yaw), INCLIN_SCALE)
+    temp = data.get("T")
+    if temp and len(temp) > 1 and not _is_nan_value(temp[1]):
+        node_analytics.note_temp(node_id, float(temp[0]), float(temp[1]))
+
+
+def _first_int16_clip(cols: tuple, prev: list):
+    """(sample, axis, delta) of the first raw delta that would clip int16, in
+    sample-major order, or None."""
+    first = None
+    for axis in range(3):
+        p = prev[axis]
+        for idx, cur in enumerate(cols[axis + 1]):
+            if cur is None:
+                continue
+            d = cur - p
+            if d >= INT16_MAX or d <= -INT16_MAX:
+                if first is None or (idx, axis) < first[:2]:
+                    first = (idx, axis, d)
+                break
+            p = cur
+    return first
+
+
+def needs_absolute_record(data: dict, state: dict) -> tuple[bool, str]:
+    """Return (True, reason) if any sensor would overflow delta_ts or clip int16."""
+    for key, scale, label, names in (
+        ("a", ACCEL_SCALE, "accel", ("x", "y", "z")),
+        ("i", INCLIN_SCALE, "inclin", ("roll", "pitch", "yaw")),
+    ):
+        if key not in data or len(data[key]) == 0:
+            continue
+        ts_s = float(data[key][0][0])
+        gap = ts_s - state[label]["ts_us"] / TS_SCALE
         if abs(gap) > MAX_DELTA_S:
-            return True, f"inclin timestamp gap {gap:.1f} s"
-        prev = list(state["inclin"]["xyz_prev"])
-        for s in data["i"]:
-            for idx, (raw, scale, name) in enumerate(
-                ((s[1], INCLIN_SCALE, "roll"), (s[2], INCLIN_SCALE, "pitch"), (s[3], INCLIN_SCALE, "yaw"))
-            ):
-                if _is_nan_value(raw):
-                    continue
-                cur = int(float(raw) * scale)
-                d = cur - prev[idx]
-                if abs(d) >= INT16_MAX:
-                    return True, f"inclin {name} delta {d} would clip int16"
-                prev[idx] = cur
+            return True, f"{label} timestamp gap {gap:.1f} s"
+        clip = _first_int16_clip(_sensor_columns(data, key, scale), state[label]["xyz_prev"])
+        if clip is not None:
+            return True, f"{label} {names[clip[1]]} delta {clip[2]} would clip int16"
 
     if "T" in data:
         ts_s = float(data["T"][0])
@@ -397,12 +783,48 @@ def _skip_v3_changed_samples(f, n: int, label_prefix: str):
             _read_exact_or_raise(f, 2, f"{label_prefix} dz")
 
 
+def _skip_packed_block(f, label: str):
+    head = _PACKED_HEAD.unpack(_read_exact_or_raise(f, _PACKED_HEAD.size, f"{label} header"))
+    count, ts_bits = head[0], head[4]
+    axes = [
+        _PACKED_AXIS.unpack(_read_exact_or_raise(f, _PACKED_AXIS.size, f"{label} axis header"))
+        for _ in range(3)
+    ]
+    size = (max(0, count - 1) * ts_bits + 7) // 8
+    for valid, _first, _mn, _mx, _base, bits in axes:
+        if valid < count:
+            size += (count + 7) // 8
+        size += (max(0, valid - 1) * bits + 7) // 8
+    _read_exact_or_raise(f, size, f"{label} packed payload")
+
+
+def _recovery_checkpoint(f, filepath: str, size: int) -> int | None:
+    """Offset of the last indexed record inside the file, where validation
+    can start; None when the index has none that checks out.
+
+    Index entries are written as their record is handed to the writer, so
+    the last ones may point past what reached the disk: only offsets below
+    the file size count, and the byte there must open an ABSOLUTE record
+    or the GAP records written ahead of it.
+    """
+    offsets = [entry[0] for entry in _read_index(filepath) if 1 <= entry[0] < size]
+    if not offsets:
+        return None
+    offset = max(offsets)
+    f.seek(offset)
+    marker = f.read(1)
+    if not marker or marker[0] not in (0xFF, GAP_MARKER):
+        return None
+    return offset
+
+
 def _recover_active_hourly_file(node_id: str, filepath: str) -> bool:
     """Prepare an existing active-hour file for safe append after restart.
 
     Returns True when the file already contains the version header and should be
     appended to without writing another FILE_FORMAT_VERSION byte.
-    Truncates any incomplete trailing record left by an unexpected stop.
+    Truncates any incomplete trailing record left by an unexpected stop,
+    reading from the last index checkpoint (the whole file without one).
     """
     if not os.path.exists(filepath):
         return False
@@ -423,7 +845,8 @@ def _recover_active_hourly_file(node_id: str, filepath: str) -> bool:
             if not version_raw:
                 return False
 
-            if version_raw[0] != FILE_FORMAT_VERSION:
+            version = version_raw[0]
+            if version not in (3, FORMAT_V4, FORMAT_V5):
                 print(
                     f"[{node_id}] WARNING: existing file {os.path.basename(filepath)} "
                     f"starts with version {version_raw[0]}, expected {FILE_FORMAT_VERSION}; "
@@ -431,7 +854,13 @@ def _recover_active_hourly_file(node_id: str, filepath: str) -> bool:
                 )
                 return True
 
-            last_good_offset = f.tell()
+            start = _recovery_checkpoint(f, filepath, size)
+            if start is None:
+                start = 1
+                print(f"[{node_id}] No usable index for {os.path.basename(filepath)}, "
+                      f"validating all {size} bytes")
+            f.seek(start)
+            last_good_offset = start
 
             while True:
                 record_start = f.tell()
@@ -440,7 +869,19 @@ def _recover_active_hourly_file(node_id: str, filepath: str) -> bool:
                     break
 
                 try:
-                    if marker[0] == 0xFF:
+                    if marker[0] == GAP_MARKER:
+                        _read_exact_or_raise(f, _GAP_RECORD.size - 1, "gap payload")
+                    elif version >= FORMAT_V5:
+                        header = marker[0]
+                        if header == 0xFF:
+                            header = _read_exact_or_raise(f, 1, "abs header")[0]
+                        if header & 0x01:
+                            _skip_packed_block(f, "accel")
+                        if header & 0x02:
+                            _skip_packed_block(f, "inclin")
+                        if header & 0x04:
+                            _read_exact_or_raise(f, _PACKED_TEMP.size, "temp payload")
+                    elif marker[0] == 0xFF:
                         header = _read_exact_or_raise(f, 1, "abs header")[0]
                         if header & 0x01:
                             n = _read_exact_or_raise(f, 1, "accel n")[0]
@@ -490,6 +931,112 @@ def _recover_active_hourly_file(node_id: str, filepath: str) -> bool:
     return True
 
 
+# -------------------------------------------------------------------
+# Record encoders
+# -------------------------------------------------------------------
+# Accel and inclinometer blocks are encoded column-wise: the packet is
+# converted to int columns once (_sensor_columns()), the per-axis delta
+# recurrence runs over plain ints, and each block is written with a single
+# struct.pack() whose format is assembled from _DELTA_FMT. The bytes are
+# identical to the former per-sample encoder.
+
+# struct format of one DELTA sample, by changed mask
+_DELTA_FMT = tuple(
+    "B"
+    + ("i" if m & CHANGED_TS else "")
+    + ("h" if m & CHANGED_X else "")
+    + ("h" if m & CHANGED_Y else "")
+    + ("h" if m & CHANGED_Z else "")
+    for m in range(256)
+)
+
+
+def _encode_abs_block(cols: tuple, ss: dict) -> bytes:
+    """ABSOLUTE samples for one sensor; updates ss ts_us / xyz_prev."""
+    ts, xs, ys, zs = cols
+    n = len(ts)
+    values = [n]
+    for t, x, y, z in zip(ts, xs, ys, zs):
+        values += (
+            t,
+            INT32_NAN_SENTINEL if x is None else x,
+            INT32_NAN_SENTINEL if y is None else y,
+            INT32_NAN_SENTINEL if z is None else z,
+        )
+    ss["ts_us"] = ts[-1]
+    prev = list(ss["xyz_prev"])
+    for axis, col in enumerate((xs, ys, zs)):
+        for v in reversed(col):
+            if v is not None:
+                prev[axis] = v
+                break
+    ss["xyz_prev"] = prev
+    return struct.pack("<B" + "qiii" * n, *values)
+
+
+def _delta_column(col: list, prev: int) -> tuple[list, int]:
+    # Thresholded deltas against the running reconstruction (None = NaN)
+    out = []
+    for cur in col:
+        if cur is None:
+            out.append(None)
+            continue
+        d = cur - prev
+        if -DELTA_NULL_THRESHOLD <= d <= DELTA_NULL_THRESHOLD:
+            d = 0
+        prev += d
+        out.append(d)
+    return out, prev
+
+
+def _clip16(d: int) -> int:
+    return 32767 if d > 32767 else -32768 if d < -32768 else d
+
+
+def _encode_delta_block(cols: tuple, ss: dict) -> bytes:
+    """DELTA samples for one sensor; updates ss ts_us / xyz_prev."""
+    ts, xs, ys, zs = cols
+    prev = ss["xyz_prev"]
+    dxs, px = _delta_column(xs, prev[0])
+    dys, py = _delta_column(ys, prev[1])
+    dzs, pz = _delta_column(zs, prev[2])
+
+    fmt = ["<B"]
+    values = [len(ts)]
+    last_ts = ss["ts_us"]
+    for t, dx, dy, dz in zip(ts, dxs, dys, dzs):
+        dt = t - last_ts
+        last_ts = t
+        changed = CHANGED_TS if dt else 0
+        if dx is None:
+            changed |= CHANGED_NAN_X
+        elif dx:
+            changed |= CHANGED_X
+        if dy is None:
+            changed |= CHANGED_NAN_Y
+        elif dy:
+            changed |= CHANGED_Y
+        if dz is None:
+            changed |= CHANGED_NAN_Z
+        elif dz:
+            changed |= CHANGED_Z
+
+        fmt.append(_DELTA_FMT[changed])
+        values.append(changed)
+        if dt:
+            values.append(dt)
+        if changed & CHANGED_X:
+            values.append(_clip16(dx))
+        if changed & CHANGED_Y:
+            values.append(_clip16(dy))
+        if changed & CHANGED_Z:
+            values.append(_clip16(dz))
+
+    ss["ts_us"] = last_ts
+    ss["xyz_prev"] = [px, py, pz]
+    return struct.pack("".join(fmt), *values)
+
+
 def encode_first_record(data: dict, state: dict) -> bytes:
     """Encode an ABSOLUTE record."""
     header = 0
@@ -497,41 +1044,11 @@ def encode_first_record(data: dict, state: dict) -> bytes:
 
     if "a" in data and len(data["a"]) > 0:
         header |= 0x01
-        samples = data["a"]
-        body += struct.pack("<B", len(samples))
-        prev = list(state["accel"]["xyz_prev"])
-        for s in samples:
-            xi, hx = _encode_abs_component(s[1], ACCEL_SCALE)
-            yi, hy = _encode_abs_component(s[2], ACCEL_SCALE)
-            zi, hz = _encode_abs_component(s[3], ACCEL_SCALE)
-            body += _abs_ts_bytes(float(s[0]), state["accel"])
-            body += struct.pack("<iii", xi, yi, zi)
-            if hx:
-                prev[0] = xi
-            if hy:
-                prev[1] = yi
-            if hz:
-                prev[2] = zi
-        state["accel"]["xyz_prev"] = prev
+        body += _encode_abs_block(_sensor_columns(data, "a", ACCEL_SCALE), state["accel"])
 
     if "i" in data and len(data["i"]) > 0:
         header |= 0x02
-        samples = data["i"]
-        body += struct.pack("<B", len(samples))
-        prev = list(state["inclin"]["xyz_prev"])
-        for s in samples:
-            ri, hr = _encode_abs_component(s[1], INCLIN_SCALE)
-            pi, hp = _encode_abs_component(s[2], INCLIN_SCALE)
-            yi, hy = _encode_abs_component(s[3], INCLIN_SCALE)
-            body += _abs_ts_bytes(float(s[0]), state["inclin"])
-            body += struct.pack("<iii", ri, pi, yi)
-            if hr:
-                prev[0] = ri
-            if hp:
-                prev[1] = pi
-            if hy:
-                prev[2] = yi
-        state["inclin"]["xyz_prev"] = prev
+        body += _encode_abs_block(_sensor_columns(data, "i", INCLIN_SCALE), state["inclin"])
 
     if "T" in data:
         header |= 0x04
@@ -552,135 +1069,11 @@ def encode_delta_record(data: dict, state: dict) -> bytes:
 
     if "a" in data and len(data["a"]) > 0:
         header |= 0x01
-        samples = data["a"]
-        body += struct.pack("<B", len(samples))
-        prev = list(state["accel"]["xyz_prev"])
-        ss = state["accel"]
-
-        for s in samples:
-            nan_x = _is_nan_value(s[1])
-            nan_y = _is_nan_value(s[2])
-            nan_z = _is_nan_value(s[3])
-
-            ts_us_new = int(float(s[0]) * TS_SCALE)
-            delta_us = ts_us_new - ss["ts_us"]
-
-            changed = 0
-            if delta_us != 0:
-                changed |= CHANGED_TS
-
-            if nan_x:
-                dx = 0
-                changed |= CHANGED_NAN_X
-            else:
-                xi = int(float(s[1]) * ACCEL_SCALE)
-                dx = _apply_null_threshold(xi - prev[0])
-                if dx != 0:
-                    changed |= CHANGED_X
-
-            if nan_y:
-                dy = 0
-                changed |= CHANGED_NAN_Y
-            else:
-                yi = int(float(s[2]) * ACCEL_SCALE)
-                dy = _apply_null_threshold(yi - prev[1])
-                if dy != 0:
-                    changed |= CHANGED_Y
-
-            if nan_z:
-                dz = 0
-                changed |= CHANGED_NAN_Z
-            else:
-                zi = int(float(s[3]) * ACCEL_SCALE)
-                dz = _apply_null_threshold(zi - prev[2])
-                if dz != 0:
-                    changed |= CHANGED_Z
-
-            body += struct.pack("<B", changed)
-            if changed & CHANGED_TS:
-                body += struct.pack("<i", delta_us)
-            if changed & CHANGED_X:
-                body += _pack_delta(dx)
-            if changed & CHANGED_Y:
-                body += _pack_delta(dy)
-            if changed & CHANGED_Z:
-                body += _pack_delta(dz)
-
-            ss["ts_us"] = ts_us_new
-            if not nan_x:
-                prev[0] += dx
-            if not nan_y:
-                prev[1] += dy
-            if not nan_z:
-                prev[2] += dz
-
-        state["accel"]["xyz_prev"] = prev
+        body += _encode_delta_block(_sensor_columns(data, "a", ACCEL_SCALE), state["accel"])
 
     if "i" in data and len(data["i"]) > 0:
         header |= 0x02
-        samples = data["i"]
-        body += struct.pack("<B", len(samples))
-        prev = list(state["inclin"]["xyz_prev"])
-        ss = state["inclin"]
-
-        for s in samples:
-            nan_r = _is_nan_value(s[1])
-            nan_p = _is_nan_value(s[2])
-            nan_y = _is_nan_value(s[3])
-
-            ts_us_new = int(float(s[0]) * TS_SCALE)
-            delta_us = ts_us_new - ss["ts_us"]
-
-            changed = 0
-            if delta_us != 0:
-                changed |= CHANGED_TS
-
-            if nan_r:
-                dr = 0
-                changed |= CHANGED_NAN_X
-            else:
-                ri = int(float(s[1]) * INCLIN_SCALE)
-                dr = _apply_null_threshold(ri - prev[0])
-                if dr != 0:
-                    changed |= CHANGED_X
-
-            if nan_p:
-                dp = 0
-                changed |= CHANGED_NAN_Y
-            else:
-                pi = int(float(s[2]) * INCLIN_SCALE)
-                dp = _apply_null_threshold(pi - prev[1])
-                if dp != 0:
-                    changed |= CHANGED_Y
-
-            if nan_y:
-                dy = 0
-                changed |= CHANGED_NAN_Z
-            else:
-                yi = int(float(s[3]) * INCLIN_SCALE)
-                dy = _apply_null_threshold(yi - prev[2])
-                if dy != 0:
-                    changed |= CHANGED_Z
-
-            body += struct.pack("<B", changed)
-            if changed & CHANGED_TS:
-                body += struct.pack("<i", delta_us)
-            if changed & CHANGED_X:
-                body += _pack_delta(dr)
-            if changed & CHANGED_Y:
-                body += _pack_delta(dp)
-            if changed & CHANGED_Z:
-                body += _pack_delta(dy)
-
-            ss["ts_us"] = ts_us_new
-            if not nan_r:
-                prev[0] += dr
-            if not nan_p:
-                prev[1] += dp
-            if not nan_y:
-                prev[2] += dy
-
-        state["inclin"]["xyz_prev"] = prev
+        body += _encode_delta_block(_sensor_columns(data, "i", INCLIN_SCALE), state["inclin"])
 
     if "T" in data:
         tv = data["T"]
@@ -717,8 +1110,108 @@ def encode_delta_record(data: dict, state: dict) -> bytes:
     return struct.pack("<B", header) + bytes(body)
 
 
+def encode_gap_records(data: dict) -> bytes:
+    """Encode the packet's gap entries as GAP records (see FILE_FORMAT_VERSION)."""
+    out = bytearray()
+    for gap in data.get("g", []):
+        try:
+            start_us = int(float(gap[0]) * TS_SCALE)
+            dur_us = max(0, min(0xFFFFFFFF, int(gap[1])))
+        except (TypeError, ValueError, IndexError):
+            continue
+        sensor = GAP_SENSOR_CODES.get(gap[2] if len(gap) > 2 else None)
+        if sensor is None:
+            continue
+        reason = GAP_REASON_CODES.get(gap[3] if len(gap) > 3 else None, 0)
+        out += _GAP_RECORD.pack(GAP_MARKER, sensor, reason, start_us, dur_us)
+    return bytes(out)
+
+
+def _pack_bits(values: list, bits: int) -> bytes:
+    """values (each below 2 ** bits) as a little-endian bit stream."""
+    if not bits or not values:
+        return b""
+    acc = 0
+    for v in reversed(values):
+        acc = (acc << bits) | v
+    return acc.to_bytes((len(values) * bits + 7) // 8, "little")
+
+
+def _for_deltas(values: list) -> tuple[int, int, bytes]:
+    """(base, bits, packed) of the deltas between consecutive values,
+    frame-of-reference bit-packed."""
+    if len(values) < 2:
+        return 0, 0, b""
+    deltas = [b - a for a, b in zip(values, values[1:])]
+    base = min(deltas)
+    bits = (max(deltas) - base).bit_length()
+    return base, bits, _pack_bits([d - base for d in deltas], bits)
+
+
+def _encode_packed_block(cols: tuple) -> bytes:
+    """One accel / inclin block in the FORMAT_V5 layout."""
+    ts = cols[0]
+    count = len(ts)
+    ts_base, ts_bits, ts_packed = _for_deltas(ts)
+
+    heads = []
+    bitmaps = []
+    payloads = []
+    for col in cols[1:]:
+        valid = [v for v in col if v is not None]
+        if valid:
+            base, bits, packed = _for_deltas(valid)
+            heads.append(_PACKED_AXIS.pack(len(valid), valid[0], min(valid), max(valid), base, bits))
+            payloads.append(packed)
+        else:
+            heads.append(_PACKED_AXIS.pack(
+                0, INT32_NAN_SENTINEL, INT32_NAN_SENTINEL, INT32_NAN_SENTINEL, 0, 0
+            ))
+        if len(valid) < count:
+            nan_bits = sum(1 << k for k, v in enumerate(col) if v is None)
+            bitmaps.append(nan_bits.to_bytes((count + 7) // 8, "little"))
+
+    return b"".join([
+        _PACKED_HEAD.pack(count, ts[0], ts[-1], ts_base, ts_bits),
+        *heads, *bitmaps, ts_packed, *payloads,
+    ])
+
+
+def encode_packed_record(data: dict, absolute: bool) -> bytes:
+    """Encode a FORMAT_V5 record; needs no encoder state."""
+    flags = 0
+    body = []
+
+    if "a" in data and len(data["a"]) > 0:
+        flags |= 0x01
+        body.append(_encode_packed_block(_sensor_columns(data, "a", ACCEL_SCALE)))
+
+    if "i" in data and len(data["i"]) > 0:
+        flags |= 0x02
+        body.append(_encode_packed_block(_sensor_columns(data, "i", INCLIN_SCALE)))
+
+    if "T" in data:
+        flags |= 0x04
+        tv = data["T"]
+        vi, _have_val = _encode_abs_component(tv[1], TEMP_SCALE)
+        body.append(_PACKED_TEMP.pack(int(float(tv[0]) * TS_SCALE), vi))
+
+    head = struct.pack("<BB", 0xFF, flags) if absolute else struct.pack("<B", flags)
+    return head + b"".join(body)
+
+
+def encode_replayed_record(data: dict, version: int = FILE_FORMAT_VERSION) -> bytes:
+    """The GAP records and one self-contained ABSOLUTE record of a packet,
+    in the target file's format version."""
+    if version >= FORMAT_V5:
+        return encode_gap_records(data) + encode_packed_record(data, True)
+    return encode_gap_records(data) + encode_first_record(data, _fresh_state())
+
+
 def _packet_max_ts_us(data: dict) -> int:
     max_ts_us = 0
+    for gap in data.get("g", []):
+        max_ts_us = max(max_ts_us, int(float(gap[0]) * TS_SCALE))
     if "a" in data and len(data["a"]) > 0:
         max_ts_us = max(max_ts_us, max(int(float(s[0]) * TS_SCALE) for s in data["a"]))
     if "i" in data and len(data["i"]) > 0:
@@ -728,162 +1221,802 @@ def _packet_max_ts_us(data: dict) -> int:
     return max_ts_us
 
 
+def _packet_ts_range_us(data: dict) -> tuple[int, int]:
+    """(earliest, latest) sample or gap start time of the packet in µs."""
+    times = [int(float(gap[0]) * TS_SCALE) for gap in data.get("g", [])]
+    for key in ("a", "i"):
+        if key in data and len(data[key]) > 0:
+            times.append(int(float(data[key][0][0]) * TS_SCALE))
+            times.append(int(float(data[key][-1][0]) * TS_SCALE))
+    if "T" in data and len(data["T"]) > 0:
+        times.append(int(float(data["T"][0]) * TS_SCALE))
+    if not times:
+        return 0, 0
+    return min(times), max(times)
+
+
+def _record_sensor_flags(data: dict) -> int:
+    flags = 0
+    if "a" in data and len(data["a"]) > 0:
+        flags |= 0x01
+    if "i" in data and len(data["i"]) > 0:
+        flags |= 0x02
+    if "T" in data:
+        flags |= 0x04
+    return flags
+
+
+def _append_index_entry(node_id: str, data_path: str, offset: int, data: dict,
+                        flags: int = 0) -> None:
+    """Index the ABSOLUTE record just written at offset. The index only
+    speeds up reads, so a failure is logged and otherwise ignored."""
+    first_us, last_us = _packet_ts_range_us(data)
+    flags |= _record_sensor_flags(data)
+    path = data_path + INDEX_SUFFIX
+    try:
+        new_file = not os.path.exists(path)
+        with open(path, "ab") as f:
+            if new_file:
+                f.write(struct.pack("<B", INDEX_FORMAT_VERSION))
+            f.write(_INDEX_ENTRY.pack(offset, first_us, last_us, flags))
+    except OSError as e:
+        print(f"[{node_id}] WARNING: index append failed for {os.path.basename(path)}: {e}")
+
+
+def _read_index(data_path: str) -> list[tuple]:
+    """Complete entries of data_path's index, [] if it has none."""
+    try:
+        with open(data_path + INDEX_SUFFIX, "rb") as f:
+            raw = f.read()
+    except OSError:
+        return []
+    if not raw or raw[0] != INDEX_FORMAT_VERSION:
+        return []
+    usable = 1 + (len(raw) - 1) // _INDEX_ENTRY.size * _INDEX_ENTRY.size
+    return list(_INDEX_ENTRY.iter_unpack(raw[1:usable]))
+
+
+def _trim_index(node_id: str, data_path: str, data_size: int) -> None:
+    """Drop index entries at or past data_size, and a torn last entry."""
+    path = data_path + INDEX_SUFFIX
+    if not os.path.exists(path):
+        return
+    entries = [e for e in _read_index(data_path) if e[0] < data_size]
+    try:
+        with open(path, "wb") as f:
+            f.write(struct.pack("<B", INDEX_FORMAT_VERSION))
+            for e in entries:
+                f.write(_INDEX_ENTRY.pack(*e))
+    except OSError as e:
+        print(f"[{node_id}] WARNING: index trim failed for {os.path.basename(path)}: {e}")
+
+
+def _remove_index(data_path: str) -> None:
+    try:
+        os.remove(data_path + INDEX_SUFFIX)
+    except FileNotFoundError:
+        pass
+    except OSError as e:
+        print(f"[SSD] WARNING: could not remove {os.path.basename(data_path)}{INDEX_SUFFIX}: {e}")
+
+
+def _append_archive_member(path: str, payload: bytes) -> int:
+    """Append payload as a new gzip member / zstd frame (by path suffix);
+    returns its offset."""
+    if path.endswith(".zst"):
+        member = zstd_archive.compressor_for_file(path).compress(payload)
+    else:
+        member = gzip.compress(payload, compresslevel=GZIP_LEVEL)
+    with open(path, "ab") as f:
+        offset = f.tell()
+        f.write(member)
+    return offset
+
+
+def _storage_file_version(path: str):
+    """The format version byte of an hourly .bin or its archive; None when
+    it is missing or unreadable."""
+    try:
+        with open(path, "rb") as f:
+            if path.endswith(".gz"):
+                head = gzip.GzipFile(fileobj=f).read(1)
+            elif path.endswith(".zst"):
+                head = zstd_archive.stream_reader(f).read(1)
+            else:
+                head = f.read(1)
+    except (OSError, EOFError, ValueError):
+        return None
+    return head[0] if head else None
+
+
+def _archived_path(bin_path: str) -> str:
+    """The archive of a finished hour: the existing one, else a new one
+    with ARCHIVE_CODEC."""
+    for suffix in (".gz", ".zst"):
+        if os.path.exists(bin_path + suffix):
+            return bin_path + suffix
+    return bin_path + ARCHIVE_SUFFIXES[ARCHIVE_CODEC]
+
+
+def _archive_gzip(bin_path: str, out_path: str, entries: list, size: int) -> list:
+    """gzip the first size bytes of bin_path into out_path; returns the
+    archive's index entries."""
+    # Full flush before each indexed record: the deflate stream is byte
+    # aligned there with an empty window, so readers can start at it
+    gz_entries = []
+    comp = zlib.compressobj(GZIP_LEVEL, zlib.DEFLATED, 16 + zlib.MAX_WBITS)
+    with open(bin_path, "rb") as f_in, open(out_path, "wb") as f_out:
+        pos = 0
+        for entry in entries + [None]:
+            end = size if entry is None else entry[0]
+            while pos < end:
+                chunk = f_in.read(min(65536, end - pos))
+                if not chunk:
+                    break
+                f_out.write(comp.compress(chunk))
+                pos += len(chunk)
+            if entry is not None:
+                f_out.write(comp.flush(zlib.Z_FULL_FLUSH))
+                gz_entries.append((f_out.tell(),) + entry[1:])
+        f_out.write(comp.flush())
+        f_out.flush()
+        os.fsync(f_out.fileno())
+    return gz_entries
+
+
+def _archive_zstd(bin_path: str, out_path: str, entries: list, size: int) -> list:
+    """zstd the first size bytes of bin_path into out_path, one frame per
+    index segment; returns the archive's index entries."""
+    bounds = [0] + [e[0] for e in entries] + [size]
+
+    def segments():
+        with open(bin_path, "rb") as f_in:
+            for begin, end in zip(bounds, bounds[1:]):
+                f_in.seek(begin)
+                yield f_in.read(end - begin)
+
+    with open(bin_path, "rb") as f_in:
+        version = f_in.read(1)
+    dictionary = zstd_archive.dictionary_for(
+        version[0] if version else FILE_FORMAT_VERSION,
+        lambda: [seg[:zstd_archive.ZSTD_SAMPLE_BYTES] for i, seg in enumerate(segments()) if i],
+    )
+    cctx = zstd_archive.compressor(dictionary)
+
+    zst_entries = []
+    with open(out_path, "wb") as f_out:
+        for i, segment in enumerate(segments()):
+            if i > 0:
+                entry = entries[i - 1]
+                zst_entries.append((f_out.tell(), entry[1], entry[2], entry[3] | INDEX_GZ_MEMBER))
+            f_out.write(cctx.compress(segment))
+        f_out.flush()
+        os.fsync(f_out.fileno())
+    return zst_entries
+
+
+def _archive_stream(codec: str, path: str):
+    if codec == "zstd":
+        return zstd_archive.stream_reader(open(path, "rb"))
+    return gzip.open(path, "rb")
+
+
+def _verify_archive(codec: str, bin_path: str, out_path: str, size: int) -> bool:
+    """True when out_path decompresses to the first size bytes of bin_path."""
+    crc_in = 0
+    with open(bin_path, "rb") as f_in:
+        remaining = size
+        while remaining:
+            chunk = f_in.read(min(1 << 20, remaining))
+            if not chunk:
+                return False
+            crc_in = zlib.crc32(chunk, crc_in)
+            remaining -= len(chunk)
+    crc_out = 0
+    length = 0
+    with _archive_stream(codec, out_path) as f_out:
+        while True:
+            chunk = f_out.read(1 << 20)
+            if not chunk:
+                break
+            crc_out = zlib.crc32(chunk, crc_out)
+            length += len(chunk)
+    return length == size and crc_out == crc_in
+
+
+def _write_index_file(path: str, entries: list) -> None:
+    tmp_path = path + ".tmp"
+    with open(tmp_path, "wb") as f:
+        f.write(struct.pack("<B", INDEX_FORMAT_VERSION))
+        for e in entries:
+            f.write(_INDEX_ENTRY.pack(*e))
+    os.replace(tmp_path, path)
+
+
 def compress_and_replace(node_id: str, bin_path: str):
+    """Archive a finished hourly file with ARCHIVE_CODEC. Archive worker."""
     if not _check_ssd(node_id):
         print(f"[{node_id}] Skipping compression of {os.path.basename(bin_path)} — SSD unavailable")
         return
-    gz_path = bin_path + ".gz"
+    codec = ARCHIVE_CODEC
+    out_path = bin_path + ARCHIVE_SUFFIXES[codec]
+    tmp_path = out_path + ".tmp"
+    started = time.perf_counter()
     try:
-        original_size = os.path.getsize(bin_path)
-        with open(bin_path, "rb") as f_in, gzip.open(gz_path, "wb", compresslevel=GZIP_LEVEL) as f_out:
-            while True:
-                chunk = f_in.read(65536)
-                if not chunk:
-                    break
-                f_out.write(chunk)
+        for _ in range(ARCHIVE_ATTEMPTS):
+            original_size = os.path.getsize(bin_path)
+            entries = [e for e in _read_index(bin_path) if 0 < e[0] < original_size]
+            if codec == "zstd":
+                out_entries = _archive_zstd(bin_path, tmp_path, entries, original_size)
+            else:
+                out_entries = _archive_gzip(bin_path, tmp_path, entries, original_size)
+            if not _verify_archive(codec, bin_path, tmp_path, original_size):
+                raise OSError(f"{os.path.basename(tmp_path)} does not match the original")
 
-        compressed_size = os.path.getsize(gz_path)
-        ratio = compressed_size / original_size * 100 if original_size else 0
-        os.remove(bin_path)
+            with _archive_swap_lock:
+                if os.path.getsize(bin_path) != original_size:
+                    # A replayed record was appended meanwhile: start over
+                    continue
+                os.replace(tmp_path, out_path)
+                if out_entries:
+                    _write_index_file(out_path + INDEX_SUFFIX, out_entries)
+                os.remove(bin_path)
+                _remove_index(bin_path)
+                storage_catalog.note_archived(bin_path, out_path)
+            break
+        else:
+            raise OSError(f"{os.path.basename(bin_path)} kept growing during compression")
 
+        _ARCHIVE_S.observe(time.perf_counter() - started, codec)
+        compressed_size = os.path.getsize(out_path)
+        ratio = compressed_size / original_size * 100 if original_size else 0
         print(
             f"[{node_id}] Compressed {os.path.basename(bin_path)} → "
-            f"{os.path.basename(gz_path)} "
+            f"{os.path.basename(out_path)} "
             f"({original_size:,} → {compressed_size:,} bytes, {ratio:.1f}%)"
         )
     except Exception as e:
         print(f"[{node_id}] WARNING: compression failed for {bin_path}: {e}")
+        try:
+            os.remove(tmp_path)
+        except OSError:
+            pass
         _log_storage_fault(node_id, FAULT_ARCHIVE_COMPRESSION_FAILED)
 
 
-def write_record(node_id: str, data: dict):
-    with _get_node_lock(node_id):
-        if not _check_ssd(node_id):
-            return
+def _archive_worker() -> None:
+    try:
+        # Linux nice values are per thread
+        tid = threading.get_native_id()
+        os.setpriority(os.PRIO_PROCESS, tid, os.getpriority(os.PRIO_PROCESS, tid) + ARCHIVE_NICE)
+    except (AttributeError, OSError) as e:
+        print(f"[encoder] Archive worker keeps normal priority: {e}")
+    while True:
+        node_id, bin_path = _archive_queue.get()
+        try:
+            if os.path.exists(bin_path):
+                compress_and_replace(node_id, bin_path)
+        except Exception as e:
+            print(f"[{node_id}] Archive worker error: {e}")
 
-        hour_str, filepath = get_hourly_filepath(node_id)
 
-        if node_id not in node_state:
-            node_state[node_id] = _fresh_state()
-        state = node_state[node_id]
+def queue_archive(node_id: str, bin_path: str) -> None:
+    """Hand a finished hourly file to the archive worker."""
+    global _archive_thread
+    if _archive_thread is None or not _archive_thread.is_alive():
+        _archive_thread = threading.Thread(target=_archive_worker, daemon=True, name="encoder-archive")
+        _archive_thread.start()
+    _archive_queue.put((node_id, bin_path))
 
-        if state["file_hour"] != hour_str:
-            if state["file_hour"] is not None:
-                old_bin = os.path.join(DATA_DIR, f"data_{node_id}_{state['file_hour']}.bin")
-                if os.path.exists(old_bin):
-                    compress_and_replace(node_id, old_bin)
 
-            state["file_hour"] = hour_str
-            state["is_first"] = True
-            state["header_written"] = False
-            state["last_absolute_record_ts_us"] = 0
+def _queue_unarchived_hours() -> None:
+    """Queue .bin files of past hours left behind by a restart (their
+    archive job was lost with the process)."""
+    current_hour = datetime.now().strftime("%Y%m%d_%H")
+    try:
+        names = sorted(os.listdir(DATA_DIR))
+    except OSError:
+        return
+    for name in names:
+        if not (name.startswith("data_") and name.endswith(".bin")):
+            continue
+        node_id, _, hour_str = name[len("data_"):-len(".bin")].rpartition("_")
+        node_id, _, day_str = node_id.rpartition("_")
+        if (node_id and f"{day_str}_{hour_str}" < current_hour
+                and ingest_partition.owns(node_id)):
+            queue_archive(node_id, os.path.join(DATA_DIR, name))
+
+
+def _append_replayed_to_bin(node_id: str, filepath: str, data: dict) -> int:
+    """Append the packet to an hourly .bin; returns the file's version."""
+    version = _storage_file_version(filepath)
+    new_file = version is None
+    if new_file:
+        _remove_index(filepath)
+        version = FILE_FORMAT_VERSION
+    with open(filepath, "ab") as f:
+        if new_file:
+            f.write(struct.pack("<B", version))
+        offset = f.tell()
+        f.write(encode_replayed_record(data, version))
+    if new_file:
+        storage_catalog.note_file(filepath)
+    _append_index_entry(node_id, filepath, offset, data, INDEX_REPLAYED)
+    storage_catalog.note_records(filepath, 1, *_packet_ts_range_us(data))
+    return version
+
+
+def _write_replayed_record(node_id: str, data: dict):
+    """Merge a store-and-forward packet into the hourly file of its own timestamp.
+
+    Replayed packets arrive out of order relative to live data, so each one is
+    written as a self-contained ABSOLUTE record. Past hours that have already
+    been archived get the record appended as a new gzip member / zstd frame,
+    which the readers take transparently. Runs on the node's shard worker.
+    """
+    packet_ts_us = _packet_max_ts_us(data)
+    if not packet_ts_us:
+        return False
 
-            if os.path.exists(filepath):
-                state["header_written"] = _recover_active_hourly_file(node_id, filepath)
-                _log_storage_fault(node_id, FAULT_ACTIVE_FILE_RECOVERY)
-                print(f"[{node_id}] Resuming hourly file: {filepath} (next record forced ABSOLUTE)")
-            else:
-                print(f"[{node_id}] New hourly file: {filepath}")
-
-        if not state["is_first"]:
-            force_abs, reason = needs_absolute_record(data, state)
-            if not force_abs:
-                packet_max_ts_us = _packet_max_ts_us(data)
-                last_abs_ts_us = state.get("last_absolute_record_ts_us", 0)
-                if (
-                    packet_max_ts_us
-                    and last_abs_ts_us
-                    and (packet_max_ts_us - last_abs_ts_us) >= int(ABSOLUTE_RECORD_INTERVAL_S * TS_SCALE)
-                ):
-                    force_abs = True
-                    reason = f"absolute refresh interval {ABSOLUTE_RECORD_INTERVAL_S:.0f} s reached"
-            if force_abs:
-                print(f"[{node_id}] Forcing ABSOLUTE record: {reason}")
-                state["is_first"] = True
+    hour_str, filepath = get_hourly_filepath_for_ts(node_id, packet_ts_us / TS_SCALE)
+    state = node_state.get(node_id)
+    live_hour, _ = get_hourly_filepath(node_id)
 
-        if state["is_first"]:
-            record = encode_first_record(data, state)
-            state["is_first"] = False
-            state["last_absolute_record_ts_us"] = _packet_max_ts_us(data)
+    try:
+        writer = _writers.get(node_id)
+        if writer is not None and writer.path == filepath:
+            # Through the open handle, so the record lands after the
+            # live records still in its buffer
+            version = state["file_version"] if state is not None else FILE_FORMAT_VERSION
+            offset = writer.file.tell()
+            writer.write(encode_replayed_record(data, version))
+            writer.maybe_flush(time.monotonic())
+            _append_index_entry(node_id, filepath, offset, data, INDEX_REPLAYED)
+            storage_catalog.note_records(filepath, 1, *_packet_ts_range_us(data))
+            if state is not None and state["file_hour"] == hour_str:
+                # The live writer's delta chain is broken by this record.
+                state["header_written"] = True
+                state["is_first"] = True
+        elif hour_str == live_hour:
+            version = _append_replayed_to_bin(node_id, filepath, data)
+            if state is not None and state["file_hour"] == hour_str:
+                state["header_written"] = True
+                state["is_first"] = True
+                state["file_version"] = version
         else:
-            record = encode_delta_record(data, state)
+            # A finished hour: its .bin while the archive worker has not
+            # swapped it out yet, else the archive
+            with _archive_swap_lock:
+                if os.path.exists(filepath):
+                    _append_replayed_to_bin(node_id, filepath, data)
+                else:
+                    archive_path = _archived_path(filepath)
+                    if os.path.exists(archive_path):
+                        version = _storage_file_version(archive_path) or FILE_FORMAT_VERSION
+                    else:
+                        _remove_index(archive_path)
+                        version = FILE_FORMAT_VERSION
+                        _append_archive_member(archive_path, struct.pack("<B", version))
+                        storage_catalog.note_file(archive_path)
+                    offset = _append_archive_member(archive_path, encode_replayed_record(data, version))
+                    _append_index_entry(node_id, archive_path, offset, data,
+                                        INDEX_REPLAYED | INDEX_GZ_MEMBER)
+                    storage_catalog.note_records(archive_path, 1, *_packet_ts_range_us(data))
+    except OSError as e:
+        _ssd_ok_reset()
+        _warn_ssd(f"replay write failed for {node_id}: {e}")
+        _log_storage_fault(node_id, FAULT_BINARY_WRITE_FAILED)
+        return False
+    return True
 
-        try:
-            with open(filepath, "ab") as f:
-                if not state["header_written"]:
-                    f.write(struct.pack("<B", FILE_FORMAT_VERSION))
-                    state["header_written"] = True
-                f.write(record)
-        except OSError as e:
-            state["header_written"] = False
+
+def encode_packet(data: dict, state: dict) -> tuple[bytes, bool, str]:
+    """
+    Encode one live packet against the node's delta state, in the format
+    version of its file (state["file_version"]), with its GAP records
+    first: (record, whether it is ABSOLUTE, why an ABSOLUTE record was
+    forced or ""). Also used by replay_raw.py to rebuild hours from the
+    raw backup byte for byte the same way.
+    """
+    reason = ""
+    packed = state.get("file_version", FILE_FORMAT_VERSION) >= FORMAT_V5
+    if not state["is_first"]:
+        # FORMAT_V5 records carry no delta state: ABSOLUTE ones only
+        # refresh the time index
+        force_abs, reason = (False, "") if packed else needs_absolute_record(data, state)
+        if not force_abs:
+            packet_max_ts_us = _packet_max_ts_us(data)
+            last_abs_ts_us = state.get("last_absolute_record_ts_us", 0)
+            if (
+                packet_max_ts_us
+                and last_abs_ts_us
+                and (packet_max_ts_us - last_abs_ts_us) >= int(ABSOLUTE_RECORD_INTERVAL_S * TS_SCALE)
+            ):
+                force_abs = True
+                reason = f"absolute refresh interval {ABSOLUTE_RECORD_INTERVAL_S:.0f} s reached"
+        if force_abs:
             state["is_first"] = True
-            _ssd_ok_reset()
-            _warn_ssd(f"write failed for {node_id}: {e}")
-            _log_storage_fault(node_id, FAULT_BINARY_WRITE_FAILED)
-            _set_stateful_storage_fault(
-                node_id,
-                "storage_unavailable",
-                FAULT_STORAGE_UNAVAILABLE,
-                FAULT_STORAGE_RESTORED,
-                True,
-            )
-
-
-def consumer_worker():
-    """Background worker that writes queued sensor packets to disk."""
-    _SSD_CHECK_INTERVAL = 60.0
-    last_ssd_check = time.monotonic()
 
+    absolute = state["is_first"]
+    if packed:
+        record = encode_packed_record(data, absolute)
+    elif absolute:
+        record = encode_first_record(data, state)
+    else:
+        record = encode_delta_record(data, state)
+    if absolute:
+        state["is_first"] = False
+        state["last_absolute_record_ts_us"] = _packet_max_ts_us(data)
+    return encode_gap_records(data) + record, absolute, reason
+
+
+def write_record(node_id: str, data: dict) -> bool:
+    """Append one packet to the node's hourly file; False if it was not stored."""
+    if not _ssd_ready(node_id):
+        _close_writer(node_id)
+        return False
+
+    if data.get("replayed"):
+        return _write_replayed_record(node_id, data)
+
+    hour_str, filepath = get_hourly_filepath(node_id)
+
+    if node_id not in node_state:
+        node_state[node_id] = _fresh_state()
+    state = node_state[node_id]
+
+    if state["file_hour"] != hour_str:
+        if state["file_hour"] is not None:
+            # Flush and fsync the finished hour before compressing it
+            _close_writer(node_id)
+            old_bin = os.path.join(DATA_DIR, f"data_{node_id}_{state['file_hour']}.bin")
+            if os.path.exists(old_bin):
+                queue_archive(node_id, old_bin)
+
+        state["file_hour"] = hour_str
+        state["is_first"] = True
+        state["header_written"] = False
+        state["last_absolute_record_ts_us"] = 0
+
+        state["file_version"] = FILE_FORMAT_VERSION
+        if os.path.exists(filepath):
+            recover_start = time.perf_counter()
+            state["header_written"] = _recover_active_hourly_file(node_id, filepath)
+            state["file_version"] = _storage_file_version(filepath) or FILE_FORMAT_VERSION
+            try:
+                _trim_index(node_id, filepath, os.path.getsize(filepath))
+            except OSError:
+                pass
+            recover_ms = (time.perf_counter() - recover_start) * 1000.0
+            _log_storage_fault(node_id, FAULT_ACTIVE_FILE_RECOVERY)
+            print(f"[{node_id}] Resuming hourly file: {filepath} (recovered in {recover_ms:.1f} ms, "
+                  f"next record forced ABSOLUTE)")
+        else:
+            _remove_index(filepath)
+            print(f"[{node_id}] New hourly file: {filepath}")
+
+    encode_start = time.perf_counter()
+    record, absolute, reason = encode_packet(data, state)
+    _ENCODE_S.observe(time.perf_counter() - encode_start,
+                      "packed" if state["file_version"] >= FORMAT_V5 else "absolute" if absolute else "delta")
+    if reason:
+        print(f"[{node_id}] Forcing ABSOLUTE record: {reason}")
+
+    try:
+        writer = _writer_for(node_id, filepath)
+        if not state["header_written"]:
+            writer.write(struct.pack("<B", state["file_version"]))
+            state["header_written"] = True
+        offset = writer.file.tell()
+        writer.write(record)
+        _BYTES_WRITTEN.inc(node_id, by=len(record))
+        writer.maybe_flush(time.monotonic())
+        if absolute:
+            _append_index_entry(node_id, filepath, offset, data)
+        storage_catalog.note_records(filepath, 1, *_packet_ts_range_us(data))
+    except OSError as e:
+        _close_writer(node_id)
+        state["header_written"] = False
+        state["is_first"] = True
+        _ssd_ok_reset()
+        _warn_ssd(f"write failed for {node_id}: {e}")
+        _log_storage_fault(node_id, FAULT_BINARY_WRITE_FAILED)
+        _set_stateful_storage_fault(
+            node_id,
+            "storage_unavailable",
+            FAULT_STORAGE_UNAVAILABLE,
+            FAULT_STORAGE_RESTORED,
+            True,
+        )
+        return False
+    return True
+
+
+class _Shard:
+    """One storage queue, its worker thread and the nodes pinned to it."""
+
+    def __init__(self, index: int):
+        self.index = index
+        self.queue: queue.Queue = queue.Queue()
+        self.nodes: list[str] = []
+        self.bytes = 0              # estimated cost of the queued packets
+        self.max_depth = 0          # high-water mark since the last report
+        self.written = 0
+        self.thread = threading.Thread(target=consumer_worker, args=(self,), daemon=True,
+                                       name=f"encoder-shard-{index}")
+
+    def snapshot(self) -> dict:
+        depth = self.queue.qsize()
+        out = {
+            "shard": self.index,
+            "nodes": list(self.nodes),
+            "depth": depth,
+            "max_depth": max(self.max_depth, depth),
+            "bytes": self.bytes,
+            "written": self.written,
+        }
+        self.max_depth = depth
+        return out
+
+
+# Control items posted to a shard queue as (None, (kind, event), 0) in
+# place of (node_id, packet, cost)
+_SERVICE = "service"        # apply the flush policy to the shard's writers
+_CLOSE = "close"            # close all of the shard's writers
+
+_shards: list[_Shard] = []
+_node_shard: dict[str, _Shard] = {}
+_shards_guard = threading.Lock()
+
+
+def _shard_for(node_id: str) -> _Shard:
+    """The node's shard, assigning one (and starting it) on first sight."""
+    shard = _node_shard.get(node_id)
+    if shard is not None:
+        return shard
+    with _shards_guard:
+        shard = _node_shard.get(node_id)
+        if shard is not None:
+            return shard
+        if len(_shards) < ENCODER_MAX_SHARDS:
+            shard = _Shard(len(_shards))
+            shard.thread.start()
+            _shards.append(shard)
+            consumer_threads.append(shard.thread)
+        else:
+            shard = min(_shards, key=lambda sh: len(sh.nodes))
+        shard.nodes.append(node_id)
+        _node_shard[node_id] = shard
+        print(f"[{node_id}] Storage shard {shard.index} ({len(shard.nodes)} node(s))")
+        return shard
+
+
+def consumer_worker(shard: _Shard):
+    """Shard worker: writes its nodes' packets to disk, in queue order."""
     while True:
-        try:
-            node_id, data = data_buffer.get(timeout=_SSD_CHECK_INTERVAL)
-        except queue.Empty:
-            _check_ssd()
-            last_ssd_check = time.monotonic()
+        node_id, data, cost = shard.queue.get()
+        _release(shard, cost)
+
+        if node_id is None:
+            try:
+                _service_writers(shard, close_all=data[0] == _CLOSE)
+            except Exception as e:
+                print(f"[SSD] Shard {shard.index} writer service error: {e}")
+            finally:
+                if data[1] is not None:
+                    data[1].set()
+                shard.queue.task_done()
             continue
 
+        ok = False
         try:
-            write_record(node_id, data)
+            ok = write_record(node_id, data)
+            if ok:
+                _note_pyramid(node_id, data)
+                _note_analytics(node_id, data)
         except Exception as e:
             print(f"Error writing record for {node_id}: {e}")
         finally:
-            data_buffer.task_done()
+            shard.written += 1
+            ingest_stats.note_stored(node_id, data, ok)
+            shard.queue.task_done()
 
-        now = time.monotonic()
-        if now - last_ssd_check >= _SSD_CHECK_INTERVAL:
-            _check_ssd()
-            last_ssd_check = now
 
+def _service_writers(shard: _Shard, close_all: bool = False) -> None:
+    """Apply the time-based flush / fsync policy to the shard's idle writers
+    and close the ones idle for WRITER_IDLE_CLOSE_S (all of them when
+    close_all), with the nodes' plot pyramids and trends. Runs on the shard worker,
+    which owns the writers."""
+    now = time.monotonic()
+    for node_id in list(shard.nodes):
+        writer = _writers.get(node_id)
+        idle = close_all or (writer is not None and now - writer.last_write >= WRITER_IDLE_CLOSE_S)
+        plot_pyramid.service(node_id, close=idle)
+        node_analytics.service(node_id, close=idle)
+        if writer is None:
+            continue
+        if idle:
+            _close_writer(node_id)
+            continue
+        try:
+            writer.maybe_flush(now)
+        except OSError as e:
+            _warn_ssd(f"flush failed for {node_id}: {e}")
+            _close_writer(node_id)
+            _ssd_ok_reset()
 
-def start_consumer_thread() -> threading.Thread:
-    """Start background consumers once and return the first worker thread."""
-    global consumer_thread, consumer_threads
 
-    alive = [t for t in consumer_threads if t.is_alive()]
-    if alive:
-        consumer_threads = alive
-        consumer_thread = consumer_threads[0]
-        return consumer_thread
+def _post_to_shards(kind: str, wait_s: float | None = None) -> None:
+    done = []
+    for shard in list(_shards):
+        event = threading.Event() if wait_s is not None else None
+        shard.queue.put((None, (kind, event), 0))
+        if event is not None:
+            done.append(event)
+    for event in done:
+        event.wait(wait_s)
 
-    consumer_threads = []
-    for idx in range(_CONSUMER_WORKER_COUNT):
-        t = threading.Thread(target=consumer_worker, daemon=True, name=f"encoder-consumer-{idx}")
-        t.start()
-        consumer_threads.append(t)
 
-    consumer_thread = consumer_threads[0]
-    return consumer_thread
+def shard_snapshot() -> list[dict]:
+    """Per-shard queue depth, high-water mark and nodes, for ingest stats."""
+    return [shard.snapshot() for shard in list(_shards)]
 
 
-def enqueue_packet(node_id: str, data: dict) -> bool:
-    """Queue a normalized packet for asynchronous binary storage."""
-    try:
-        data_buffer.put_nowait((node_id, data))
+def storage_monitor():
+    """Background SSD health check and writer flush policy, off the write path.
+
+    The monitor never touches a writer itself: it posts a control item to
+    every shard, which the shard's worker handles between packets.
+    """
+    last_check = 0.0
+    last_report = 0.0
+    while True:
+        try:
+            now = time.monotonic()
+            if now - last_check >= SSD_MONITOR_INTERVAL_S or not _ssd_ok:
+                _check_ssd()
+                last_check = now
+            _post_to_shards(_SERVICE if _ssd_ok else _CLOSE)
+            _end_overflow_episode()
+            if now - last_report >= SSD_MONITOR_INTERVAL_S:
+                ingest_stats.note_storage_shards(shard_snapshot(), queue_snapshot())
+                last_report = now
+        except Exception as e:
+            print(f"[SSD] Storage monitor error: {e}")
+        time.sleep(min(1.0, WRITER_FLUSH_INTERVAL_S))
+
+
+def close_all_writers(timeout_s: float = 10.0) -> None:
+    """Flush, fsync and close every open hourly file (call on shutdown).
+
+    Queued packets ahead of the close are written first; waits up to
+    timeout_s per shard.
+    """
+    _post_to_shards(_CLOSE, wait_s=timeout_s)
+
+
+def start_consumer_thread() -> threading.Thread:
+    """Start the storage monitor once and return it. Shard workers start
+    with the first packet of the node that needs them."""
+    global _monitor_thread
+
+    if _monitor_thread is None or not _monitor_thread.is_alive():
+        _monitor_thread = threading.Thread(target=storage_monitor, daemon=True, name="encoder-storage-monitor")
+        _monitor_thread.start()
+        _queue_unarchived_hours()
+        # Files written or deleted while the listener was down; one
+        # listener process does it for every partition
+        if ingest_partition.IS_PRIMARY:
+            storage_catalog.start_reconcile()
+    return _monitor_thread
+
+
+def _packet_cost(data: dict) -> int:
+    # ~88 B list + 24 B per float per row, plus the dict itself
+    rows = sum(len(data.get(key) or ()) for key in ("a", "i", "g", "T"))
+    return 512 + 184 * rows
+
+
+def _reserve(shard: _Shard, cost: int) -> bool:
+    global _queue_bytes, _queue_peak_bytes
+    with _queue_guard:
+        if _queue_bytes + cost > ENCODER_QUEUE_BUDGET_BYTES:
+            return False
+        _queue_bytes += cost
+        shard.bytes += cost
+        _queue_peak_bytes = max(_queue_peak_bytes, _queue_bytes)
         return True
-    except queue.Full:
+
+
+def _release(shard: _Shard, cost: int) -> None:
+    global _queue_bytes
+    if cost:
+        with _queue_guard:
+            _queue_bytes -= cost
+            shard.bytes -= cost
+
+
+def _note_overflow(node_id: str, kind: str) -> None:
+    _OVERFLOW.inc(kind)
+    with _queue_guard:
+        _queue_overflow[kind] += 1
+        first = node_id not in _overflowing_nodes
+        _overflowing_nodes.add(node_id)
+    if kind == "spilled":
+        ingest_stats.note_queue_spill(node_id)
+    else:
+        ingest_stats.note_queue_drop(node_id)
+    if first:
         print(
-            f"[{node_id}] WARNING: queue full — "
-            f"packet dropped. Check if consumer is stalled (disk full/unmounted?)."
+            f"[{node_id}] WARNING: storage queue over its {ENCODER_QUEUE_BUDGET_BYTES / (1024 * 1024):.3g} MB "
+            f"budget ({ENCODER_OVERFLOW_POLICY}) — is the SSD stalled?"
         )
         _log_storage_fault(node_id, FAULT_STORAGE_QUEUE_OVERFLOW)
-        return False
\ No newline at end of file
+
+
+def _end_overflow_episode() -> None:
+    with _queue_guard:
+        if not _overflowing_nodes or _queue_bytes > ENCODER_QUEUE_BUDGET_BYTES * QUEUE_RESUME_FRACTION:
+            return
+        nodes = sorted(_overflowing_nodes)
+        _overflowing_nodes.clear()
+    print(f"[encoder] Storage queue drained below {QUEUE_RESUME_FRACTION:.0%} of budget ({', '.join(nodes)})")
+
+
+def _evict_oldest(shard: _Shard) -> bool:
+    """Drop the oldest queued packet of the shard; False if it has none."""
+    for _ in range(shard.queue.qsize()):
+        try:
+            item = shard.queue.get_nowait()
+        except queue.Empty:
+            return False
+        node_id, _, cost = item
+        if node_id is None:
+            shard.queue.put(item)       # control items are free; keep them
+            shard.queue.task_done()
+            continue
+        _release(shard, cost)
+        shard.queue.task_done()
+        _note_overflow(node_id, "dropped_oldest")
+        return True
+    return False
+
+
+def queue_snapshot() -> dict:
+    """Budget, use, high-water mark and overflow counts of the ingest queue."""
+    with _queue_guard:
+        return {
+            "policy": ENCODER_OVERFLOW_POLICY,
+            "budget_bytes": ENCODER_QUEUE_BUDGET_BYTES,
+            "bytes": _queue_bytes,
+            "peak_bytes": _queue_peak_bytes,
+            "overflowing": sorted(_overflowing_nodes),
+            **_queue_overflow,
+        }
+
+
+def enqueue_packet(node_id: str, data: dict) -> bool:
+    """Queue a normalized packet on its node's shard for asynchronous storage.
+
+    Returns False when the overflow policy refused the packet (already
+    counted in the ingest stats).
+    """
+    shard = _shard_for(node_id)
+    cost = _packet_cost(data)
+
+    if not _reserve(shard, cost):
+        if ENCODER_OVERFLOW_POLICY == "drop_oldest":
+            while not _reserve(shard, cost):
+                victim = shard if shard.bytes > 0 else max(_shards, key=lambda sh: sh.bytes)
+                if not _evict_oldest(victim):
+                    _note_overflow(node_id, "dropped_newest")
+                    return False
+        else:
+            _note_overflow(node_id, "spilled" if ENCODER_OVERFLOW_POLICY == "spill_raw" else "dropped_newest")
+            return False
+
+    shard.queue.put((node_id, data, cost))
+    depth = shard.queue.qsize()
+    if depth > shard.max_depth:
+        shard.max_depth = depth
+    return True
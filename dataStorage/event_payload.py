@@ -0,0 +1,119 @@
+"""
+event_payload.py
+----------------
+Reassembles the chunked raw-ODR burst captures published by the nodes on
+wind_turbine/<serial>/event (see firmware event_capture.h for the
+authoritative layout) and writes each complete event to one CSV file.
+
+Chunk layout, version 1 (little-endian):
+    header  48 bytes   magic, version, trigger_mode, range, event_id,
+                       chunk_index, chunk_count, trigger_tick, trigger_utc_us,
+                       odr_hz, period_ticks, pre_samples, total_samples,
+                       first_sample, sample_count, reserved, trigger_value
+    samples sample_count x <iii>   raw ADXL355 counts
+
+Output: <DATA_DIR>/events/<serial>/<YYYYmmdd_HHMMSS>_<event_id>.csv with
+columns t_rel_us (relative to the trigger sample), x_g, y_g, z_g.
+
+Usage (called from mqtt_listener_data.py):
+    from event_payload import handle_event_chunk
+    handle_event_chunk(serial, msg.payload)
+"""
+
+import os
+import struct
+import time
+from datetime import datetime, timezone
+
+from binary_payload import ADXL355_LSB_PER_G, TICK_US
+
+EVENT_MAGIC = 0xB6
+EVENT_VERSION = 1
+
+TRIGGER_MODES = {0: "manual", 1: "threshold", 2: "rms", 3: "sta_lta"}
+
+_HEADER_STRUCT = struct.Struct("<BBBBIHHIqHHIIIHHf")
+_SAMPLE_STRUCT = struct.Struct("<iii")
+
+EVENTS_SUBDIR = "events"
+INCOMPLETE_TIMEOUT_S = 120.0        # drop events whose chunks stopped arriving
+
+# (serial, event_id, trigger_tick) -> {"header": tuple, "chunks": {idx: bytes}, "t": float}
+_pending = {}
+
+
+def _events_dir(serial: str) -> str:
+    from encoder_storage import DATA_DIR
+    return os.path.join(DATA_DIR, EVENTS_SUBDIR, serial)
+
+
+def _purge_stale(now: float) -> None:
+    for key in [k for k, v in _pending.items() if now - v["t"] > INCOMPLETE_TIMEOUT_S]:
+        ev = _pending.pop(key)
+        print(f"[event] Dropped incomplete event {key[1]} from {key[0]} "
+              f"({len(ev['chunks'])}/{ev['header'][6]} chunks)")
+
+
+def _write_event(serial: str, header: tuple, chunks: dict) -> str:
+    (_, _, mode, rng, event_id, _, chunk_count, _, utc_us, odr_hz,
+     period_ticks, pre, total, _, _, _, value) = header
+
+    lsb_per_g = ADXL355_LSB_PER_G.get(rng, ADXL355_LSB_PER_G[1])
+    step_us = period_ticks * TICK_US
+
+    if utc_us:
+        stamp = datetime.fromtimestamp(utc_us / 1e6, tz=timezone.utc).strftime("%Y%m%d_%H%M%S")
+    else:
+        stamp = "unsynced"
+
+    out_dir = _events_dir(serial)
+    os.makedirs(out_dir, exist_ok=True)
+    path = os.path.join(out_dir, f"{stamp}_{event_id}.csv")
+
+    with open(path, "w") as f:
+        f.write(f"# serial={serial} event_id={event_id} trigger={TRIGGER_MODES.get(mode, mode)} "
+                f"value={value:.6g} odr_hz={odr_hz} pre_samples={pre} total_samples={total} "
+                f"trigger_utc_us={utc_us}\n")
+        f.write("t_rel_us,x_g,y_g,z_g\n")
+        i = 0
+        for idx in range(chunk_count):
+            body = chunks[idx]
+            for x, y, z in _SAMPLE_STRUCT.iter_unpack(body):
+                f.write(f"{(i - pre) * step_us},{x / lsb_per_g:.7f},"
+                        f"{y / lsb_per_g:.7f},{z / lsb_per_g:.7f}\n")
+                i += 1
+    return path
+
+
+def handle_event_chunk(serial: str, payload: bytes) -> None:
+    """Store one chunk; write the event once every chunk has arrived."""
+    try:
+        if len(payload) < _HEADER_STRUCT.size or payload[0] != EVENT_MAGIC:
+            print(f"[event] Ignoring non-event payload from {serial}")
+            return
+        header = _HEADER_STRUCT.unpack_from(payload)
+        if header[1] != EVENT_VERSION:
+            print(f"[event] Unsupported event version {header[1]} from {serial}")
+            return
+
+        event_id, chunk_index, chunk_count, trigger_tick = header[4], header[5], header[6], header[7]
+        sample_count = header[14]
+        body = payload[_HEADER_STRUCT.size:]
+        if len(body) != sample_count * _SAMPLE_STRUCT.size or chunk_index >= chunk_count:
+            print(f"[event] Malformed chunk {chunk_index} of event {event_id} from {serial}")
+            return
+
+        now = time.monotonic()
+        _purge_stale(now)
+
+        key = (serial, event_id, trigger_tick)
+        ev = _pending.setdefault(key, {"header": header, "chunks": {}, "t": now})
+        ev["chunks"][chunk_index] = body
+        ev["t"] = now
+
+        if len(ev["chunks"]) == chunk_count:
+            del _pending[key]
+            path = _write_event(serial, ev["header"], ev["chunks"])
+            print(f"[event] Event {event_id} from {serial} written to {path}")
+    except Exception as e:
+        print(f"[event] Failed to process event chunk from {serial}: {e}")
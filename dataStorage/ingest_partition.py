@@ -0,0 +1,66 @@
+"""
+ingest_partition.py
+-------------------
+Which nodes this data listener process owns when ingest runs as several
+processes (listener_supervisor.py).
+
+One listener process is one Python interpreter: past a point, decoding,
+encoding and storage for every node on one GIL is the limit. The
+supervisor starts SHM_LISTENER_PROCESSES listeners and tells each its
+partition in SHM_INGEST_PARTITION ("index/count"). A node belongs to
+partition fnv1a32(serial) % count, the hash the nodes already put in every
+UDP datagram, so a process can drop another partition's datagrams without
+knowing their serial.
+
+A node's messages are therefore all handled by one process, in arrival
+order, as within one process each node is pinned to one ingest worker
+(ingest_pipeline.py); its hourly files, raw backup, pyramid and analytics
+databases have a single writer. Every process still subscribes to all
+node topics and drops the other partitions' messages by topic in
+on_message(), before any decoding: MQTT 5 shared subscriptions
+($share/<group>/...) hand each message to any one member of the group,
+which would split a node's packets across processes and break the order.
+
+Without SHM_INGEST_PARTITION (a listener started on its own) the process
+owns every node, as before.
+"""
+
+import os
+
+from binary_payload import fnv1a32
+
+
+def _parse(value: str) -> tuple[int, int]:
+    try:
+        index, count = (int(part) for part in value.split("/"))
+    except ValueError:
+        raise SystemExit(f"SHM_INGEST_PARTITION={value!r}: expected index/count, e.g. 0/4")
+    if count < 1 or not 0 <= index < count:
+        raise SystemExit(f"SHM_INGEST_PARTITION={value!r}: index must be 0..count-1")
+    return index, count
+
+
+PARTITION_INDEX, PARTITION_COUNT = _parse(os.getenv("SHM_INGEST_PARTITION", "0/1"))
+
+# Partition 0 also does the fleet-wide housekeeping (storage catalog
+# reconcile, raw backup retention)
+IS_PRIMARY = PARTITION_INDEX == 0
+
+
+def owns_hash(serial_hash: int) -> bool:
+    return serial_hash % PARTITION_COUNT == PARTITION_INDEX
+
+
+# Serial -> owned, so the per-message check is a dict lookup
+_owned: dict[str, bool] = {}
+
+
+def owns(serial: str) -> bool:
+    """True when this process handles the node's messages."""
+    if PARTITION_COUNT == 1:
+        return True
+    owned = _owned.get(serial)
+    if owned is None:
+        owned = _owned[serial] = owns_hash(fnv1a32(serial))
+    return owned
+
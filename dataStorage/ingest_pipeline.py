@@ -0,0 +1,260 @@
+"""
+ingest_pipeline.py
+------------------
+Staged message handling for the data listener (mqtt_listener_data.py).
+
+on_message() runs on paho's only network thread, and the UDP receiver has
+one thread too. Handling a message there (registry update, decoding,
+timestamp parsing, runtime state, raw backup, queueing for the encoder)
+stalled the network loop, so the broker buffered or dropped QoS 0 messages
+whenever one step was slow. Now both only submit (node, topic, payload,
+receive time) here and return.
+
+Stages:
+  receive  on_message() / UDP receiver -> submit(): a byte-budgeted queue
+           put, nothing else
+  handle   INGEST_WORKERS threads run the listener's handler. Every node is
+           pinned to one worker on first sight (the least loaded, as the
+           encoder's shards do), so a node's messages keep their order
+           through the raw backup and into the encoder
+  raw backup and storage
+           the raw backup writers (raw_backup.py) and the encoder shards
+           (encoder_storage.py) run on their own threads behind that
+
+The queues together hold at most INGEST_QUEUE_BUDGET_BYTES of payload. A
+message that does not fit is not handled (counted as "overflow"); its
+payload still goes to the raw backup through the overflow callback, so
+replay_raw.py can recover it.
+
+Workers are threads, not processes: the handler updates in-process state
+(ingest_stats, node runtime, live stream, encoder queues) that a process
+pool would have to ship back, while decoding one packet is cheap next to
+that. More workers keep a slow handler step (the registry or settings
+DB, a fault insert) from holding up the other nodes.
+
+Per stage, snapshot() reports queue depth, overflows, the time messages
+waited in the queue and the handling time by topic kind, with means and
+maxima since the previous report; the listener sends it to ingest_stats
+every INGEST_REPORT_INTERVAL_S.
+Handling time and receive-to-handled latency also go to the metrics
+registry (backend metrics.py) as histograms, with the overflow count and
+the queue depth.
+"""
+
+import os
+import queue
+import threading
+from time import monotonic, sleep, time_ns
+
+import ingest_stats
+import metrics
+
+INGEST_WORKERS = max(1, int(os.getenv("SHM_INGEST_WORKERS", "4")))
+INGEST_QUEUE_BUDGET_BYTES = int(float(os.getenv("SHM_INGEST_QUEUE_MB", "16")) * 1024 * 1024)
+INGEST_REPORT_INTERVAL_S = 10.0
+_OVERFLOW_WARN_INTERVAL_S = 30.0
+_ITEM_OVERHEAD_BYTES = 128      # topic, tuple and queue slot per message
+
+# Hot-path metrics (backend metrics.py), by topic kind
+_HANDLE_S = metrics.histogram(
+    "shm_ingest_handle_seconds", "Time an ingest worker spent handling one message", ("kind",))
+_LATENCY_S = metrics.histogram(
+    "shm_ingest_latency_seconds", "Time from receiving a message to the end of its handling", ("kind",))
+_OVERFLOW = metrics.counter(
+    "shm_ingest_overflow_total", "Messages not handled over the ingest queue budget")
+
+
+class _Timing:
+    """Count, mean and max of one stage's latency, reset per report."""
+
+    def __init__(self):
+        self.n = 0
+        self.total_ms = 0.0
+        self.max_ms = 0.0
+
+    def add(self, ms: float) -> None:
+        self.n += 1
+        self.total_ms += ms
+        if ms > self.max_ms:
+            self.max_ms = ms
+
+    def take(self) -> dict:
+        out = {
+            "n": self.n,
+            "ms_mean": round(self.total_ms / self.n, 3) if self.n else None,
+            "ms_max": round(self.max_ms, 3),
+        }
+        self.n = 0
+        self.total_ms = 0.0
+        self.max_ms = 0.0
+        return out
+
+
+class _Worker:
+    """One handler thread, its queue and the nodes pinned to it."""
+
+    def __init__(self, pipeline: "IngestPipeline", index: int):
+        self.index = index
+        self.queue: queue.Queue = queue.Queue()
+        self.nodes: list[str] = []
+        # Guards the counters below; never held across the handler
+        self.lock = threading.Lock()
+        self.bytes = 0
+        self.max_depth = 0
+        self.handled = 0
+        self.overflow = 0
+        self.wait = _Timing()
+        self.handle: dict[str, _Timing] = {}
+        self.thread = threading.Thread(target=pipeline._run, args=(self,), daemon=True,
+                                       name=f"ingest-{index}")
+
+    def snapshot(self) -> dict:
+        with self.lock:
+            depth = self.queue.qsize()
+            out = {
+                "worker": self.index,
+                "nodes": list(self.nodes),
+                "depth": depth,
+                "max_depth": max(self.max_depth, depth),
+                "bytes": self.bytes,
+                "handled": self.handled,
+                "overflow": self.overflow,
+                "wait": self.wait.take(),
+                "handle": {kind: t.take() for kind, t in self.handle.items()},
+            }
+            self.max_depth = depth
+        return out
+
+
+class IngestPipeline:
+    """
+    handler(node_id, topic, payload, recv_ns) runs on the node's worker;
+    overflow(node_id, topic, payload, recv_ns) runs on the submitting thread
+    for a message over the queue budget. kind_of(topic) names the handling
+    time bucket.
+    """
+
+    def __init__(self, handler, overflow=None, kind_of=None,
+                 workers: int = INGEST_WORKERS, budget_bytes: int = INGEST_QUEUE_BUDGET_BYTES):
+        self.handler = handler
+        self.overflow = overflow
+        self.kind_of = kind_of or (lambda topic: topic.rsplit("/", 1)[-1] if topic else "data")
+        self.max_workers = max(1, workers)
+        self.budget_bytes = budget_bytes
+        self._workers: list[_Worker] = []
+        self._node_worker: dict[str, _Worker] = {}
+        self._guard = threading.Lock()
+        self._last_overflow_warn = 0.0
+        self._stages: dict[str, _Timing] = {}
+        self._stages_lock = threading.Lock()
+        self._monitor: threading.Thread | None = None
+        metrics.gauge("shm_ingest_queue_messages", "Messages queued for the ingest workers",
+                      fn=lambda: sum(w.queue.qsize() for w in list(self._workers)))
+
+    def _worker_for(self, node_id: str) -> _Worker:
+        worker = self._node_worker.get(node_id)
+        if worker is not None:
+            return worker
+        with self._guard:
+            worker = self._node_worker.get(node_id)
+            if worker is not None:
+                return worker
+            if len(self._workers) < self.max_workers:
+                worker = _Worker(self, len(self._workers))
+                worker.thread.start()
+                self._workers.append(worker)
+            else:
+                worker = min(self._workers, key=lambda w: len(w.nodes))
+            worker.nodes.append(node_id)
+            self._node_worker[node_id] = worker
+            if self._monitor is None:
+                self._monitor = threading.Thread(target=self._report, daemon=True, name="ingest-monitor")
+                self._monitor.start()
+            return worker
+
+    def submit(self, node_id: str, topic: str | None, payload: bytes, recv_ns: int) -> bool:
+        """Queue one message for the node's worker; False if it was over budget."""
+        worker = self._worker_for(node_id)
+        size = len(payload) + _ITEM_OVERHEAD_BYTES
+        now = monotonic()
+        with worker.lock:
+            if worker.bytes + size > self.budget_bytes // self.max_workers:
+                worker.overflow += 1
+                warn = now - self._last_overflow_warn >= _OVERFLOW_WARN_INTERVAL_S
+                if warn:
+                    self._last_overflow_warn = now
+                fits = False
+            else:
+                worker.bytes += size
+                fits = True
+        if not fits:
+            _OVERFLOW.inc()
+            if warn:
+                print(f"[ingest] Worker {worker.index} over budget: {worker.overflow} message(s) "
+                      f"not handled so far (node {node_id})")
+            if self.overflow is not None:
+                self.overflow(node_id, topic, payload, recv_ns)
+            return False
+
+        worker.queue.put((node_id, topic, payload, recv_ns, now, size))
+        depth = worker.queue.qsize()
+        with worker.lock:
+            worker.max_depth = max(worker.max_depth, depth)
+        return True
+
+    def _run(self, worker: _Worker) -> None:
+        while True:
+            item = worker.queue.get()
+            if item is None:
+                return
+            node_id, topic, payload, recv_ns, queued_at, size = item
+            started = monotonic()
+            try:
+                self.handler(node_id, topic, payload, recv_ns)
+            except Exception as e:
+                print(f"[ingest] Error handling {topic or 'UDP frame'} from {node_id}: {e}")
+            done = monotonic()
+            kind = self.kind_of(topic)
+            _HANDLE_S.observe(done - started, kind)
+            _LATENCY_S.observe((time_ns() - recv_ns) / 1e9, kind)
+            with worker.lock:
+                worker.bytes -= size
+                worker.handled += 1
+                worker.wait.add((started - queued_at) * 1000.0)
+                timing = worker.handle.get(kind)
+                if timing is None:
+                    timing = worker.handle[kind] = _Timing()
+                timing.add((done - started) * 1000.0)
+
+    def note_stage(self, name: str, ms: float) -> None:
+        """Latency of a sub-stage timed by the handler (e.g. decoding)."""
+        with self._stages_lock:
+            timing = self._stages.get(name)
+            if timing is None:
+                timing = self._stages[name] = _Timing()
+            timing.add(ms)
+
+    def snapshot(self) -> dict:
+        with self._stages_lock:
+            stages = {name: t.take() for name, t in self._stages.items()}
+        return {
+            "workers": [w.snapshot() for w in list(self._workers)],
+            "stages": stages,
+            "budget_bytes": self.budget_bytes,
+        }
+
+    def _report(self) -> None:
+        while True:
+            sleep(INGEST_REPORT_INTERVAL_S)
+            try:
+                ingest_stats.note_ingest_pipeline(self.snapshot())
+            except Exception as e:
+                print(f"[ingest] Report failed: {e}")
+
+    def close(self, timeout_s: float = 10.0) -> None:
+        """Handle what is queued, then stop the workers."""
+        for worker in list(self._workers):
+            worker.queue.put(None)
+        deadline = monotonic() + timeout_s
+        for worker in list(self._workers):
+            worker.thread.join(max(0.0, deadline - monotonic()))
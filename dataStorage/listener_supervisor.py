@@ -0,0 +1,122 @@
+"""
+listener_supervisor.py
+----------------------
+Runs the data listener as SHM_LISTENER_PROCESSES processes (one per core by
+default), each owning the nodes of one partition (ingest_partition.py), and
+restarts any that exits.
+
+Every listener is mqtt_listener_data.py with SHM_INGEST_PARTITION=k/N in
+its environment; everything else (broker, budgets, paths) comes from the
+supervisor's environment. The budgets are per process: with N listeners the
+ingest, storage and raw backup queues may hold N times as much.
+
+A listener that exits is started again after RESTART_MIN_S, doubling up to
+RESTART_MAX_S while it keeps failing; one that stayed up STABLE_S starts
+over at the minimum. Its nodes are not handled in between: their packets
+reach no one until it is back (the nodes' store-and-forward covers a short
+gap). On SIGTERM / SIGINT every listener gets SIGINT, on which it drains
+its queues and closes its files; one still running after STOP_TIMEOUT_S is
+killed.
+
+Usage (in place of mqtt_listener_data.py, e.g. in the systemd unit):
+    python listener_supervisor.py
+    SHM_LISTENER_PROCESSES=2 python listener_supervisor.py
+"""
+
+import os
+import signal
+import subprocess
+import sys
+import time
+from pathlib import Path
+
+LISTENER = Path(__file__).resolve().with_name("mqtt_listener_data.py")
+PROCESSES = int(os.getenv("SHM_LISTENER_PROCESSES", "0")) or os.cpu_count() or 1
+
+RESTART_MIN_S = 1.0
+RESTART_MAX_S = 30.0
+STABLE_S = 60.0
+STOP_TIMEOUT_S = 15.0
+POLL_S = 1.0
+
+
+class _Listener:
+    """One listener process and its restart schedule."""
+
+    def __init__(self, index: int, count: int):
+        self.index = index
+        self.count = count
+        self.proc: subprocess.Popen | None = None
+        self.started_at = 0.0
+        self.backoff_s = RESTART_MIN_S
+        self.restart_at = 0.0
+
+    def start(self) -> None:
+        env = dict(os.environ, SHM_INGEST_PARTITION=f"{self.index}/{self.count}")
+        self.proc = subprocess.Popen([sys.executable, str(LISTENER)], env=env, cwd=LISTENER.parent)
+        self.started_at = time.monotonic()
+        print(f"[supervisor] Listener {self.index}/{self.count} started (pid {self.proc.pid})")
+
+    def check(self, now: float) -> None:
+        """Schedule a restart when the process has exited, start it when due."""
+        if self.proc is not None:
+            code = self.proc.poll()
+            if code is None:
+                return
+            uptime = now - self.started_at
+            if uptime >= STABLE_S:
+                self.backoff_s = RESTART_MIN_S
+            self.restart_at = now + self.backoff_s
+            print(f"[supervisor] Listener {self.index}/{self.count} exited with {code} "
+                  f"after {uptime:.0f} s, restarting in {self.backoff_s:.0f} s")
+            self.backoff_s = min(self.backoff_s * 2, RESTART_MAX_S)
+            self.proc = None
+        if now >= self.restart_at:
+            self.start()
+
+
+_stopping = False
+
+
+def _request_stop(signum, frame) -> None:
+    global _stopping
+    _stopping = True
+
+
+def _stop_all(listeners: list[_Listener]) -> None:
+    running = [l.proc for l in listeners if l.proc is not None and l.proc.poll() is None]
+    for proc in running:
+        # KeyboardInterrupt in the listener runs its shutdown (main())
+        proc.send_signal(signal.SIGINT)
+    deadline = time.monotonic() + STOP_TIMEOUT_S
+    for proc in running:
+        try:
+            proc.wait(max(0.0, deadline - time.monotonic()))
+        except subprocess.TimeoutExpired:
+            print(f"[supervisor] Listener pid {proc.pid} did not stop, killing it")
+            proc.kill()
+            proc.wait()
+
+
+def main() -> None:
+    signal.signal(signal.SIGTERM, _request_stop)
+    signal.signal(signal.SIGINT, _request_stop)
+
+    listeners = [_Listener(k, PROCESSES) for k in range(PROCESSES)]
+    print(f"[supervisor] Starting {PROCESSES} data listener processes")
+    for listener in listeners:
+        listener.start()
+
+    try:
+        while not _stopping:
+            time.sleep(POLL_S)
+            now = time.monotonic()
+            for listener in listeners:
+                listener.check(now)
+    finally:
+        print("[supervisor] Stopping listeners")
+        _stop_all(listeners)
+
+
+if __name__ == "__main__":
+    main()
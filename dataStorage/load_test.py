@@ -0,0 +1,879 @@
+"""
+load_test.py
+------------
+Multi-node load test of the ingest path: broker -> data listener -> SSD.
+
+Simulated nodes publish the firmware's data packets (firmware mqtt.c: JSON,
+binary v1 or packed v2 frames, one per second with 200 accel samples, 20
+inclinometer samples, temperature, "seq", "st", the accel summary "s" and
+gap list "g") to wind_turbine/<serial>/data, one MQTT connection per node
+as on site. Nodes are spread over --processes publisher processes so the
+generator itself is not the bottleneck; publish times are staggered across
+the packet period, as unsynchronised nodes are.
+
+Fault patterns, all off by default:
+  --nan-rate      fraction of accel samples sent as NaN (INT32_MIN in
+                  binary), in runs of --nan-run samples
+  --gap-rate      chance per packet that the accel or inclinometer is
+                  disconnected: empty block plus a "g" entry
+  --drop-every    mean seconds between link drops of a node; it then stays
+  --drop-s        disconnected for --drop-s and its packets for that time
+                  are skipped (seq still advances, so the listener counts
+                  them lost; they are reported as "skipped" here)
+  --jitter-ms     publish delay after the end of the packet, |N(0, jitter)|
+
+With --step the node count ramps up: --step more nodes every --step-s
+seconds until --nodes are running, so one run finds the ceiling.
+
+Measured on the listener side (run this on the Pi for the /proc figures):
+  ingest_stats  per-node counters and latency histograms of the test nodes
+                (INGEST_STATS_JSON, or /api/ingest/stats with --stats-url),
+                the ingest worker, storage shard and raw backup queues
+  /proc         listener and broker CPU (% of one core), RSS and the
+                listener's bytes written to disk; system CPU and load
+ingest_stats is flushed every 10 s, so step boundaries are only that exact:
+keep --step-s at 60 s or more.
+
+A step is healthy when nothing was lost beyond the skipped packets, nothing
+was dropped, spilled or rejected anywhere, and the p95 sample-to-disk
+latency is within INGEST_SLO_MS. The ceiling is the node count of the last
+healthy step before the first unhealthy one.
+
+The report is printed and written as JSON (--report). With --baseline, the
+steps are compared with an earlier report of the same node counts; stored
+throughput, mean latency, CPU or RSS worse by more than --tolerance, or a
+step no longer healthy, make the exit status 1.
+
+Test serials register like real nodes (node_registry); use a --prefix of
+their own and remove them from the registry after a test on a site Pi.
+
+Usage:
+    # 20 binary nodes at 200 Hz for 5 minutes, report to a file
+    python load_test.py --broker localhost --nodes 20 --format bin --duration 300 \
+        --report /home/pi/load_20.json
+
+    # Ramp 10, 20, ... 80 nodes, 2 min each, with NaN runs and link drops
+    python load_test.py --nodes 80 --step 10 --step-s 120 --nan-rate 0.01 \
+        --drop-every 600 --drop-s 20 --report /home/pi/ramp.json
+
+    # Same run after an update: fail on regressions against the last one
+    python load_test.py --nodes 80 --step 10 --step-s 120 --baseline /home/pi/ramp.json
+"""
+
+import argparse
+import heapq
+import json
+import math
+import multiprocessing as mp
+import os
+import platform
+import queue
+import random
+import struct
+import sys
+import time
+import urllib.request
+from datetime import datetime, timezone
+from pathlib import Path
+
+import paho.mqtt.client as mqtt
+
+try:
+    import ingest_stats
+except ImportError:     # run from a checkout: ingest_stats lives in backend/
+    sys.path.insert(0, str(Path(__file__).resolve().parents[1] / "backend"))
+    import ingest_stats
+
+from binary_payload import (
+    ACCEL_INVALID,
+    ACCEL_PACK_BLOCK,
+    ADXL355_LSB_PER_G,
+    BIN_MAGIC,
+    BIN_VERSION,
+    BIN_VERSION_PACKED,
+    FLAG_ACCEL_VALID,
+    FLAG_GAPS,
+    FLAG_HAS_TEMP,
+    FLAG_INCL_VALID,
+    FLAG_SEND_TS,
+    FLAG_SUMMARY,
+    FLAG_TEMP_VALID,
+    SCL3300_DEG_PER_LSB,
+    TICK_US,
+    _GAP_STRUCT,
+    _HEADER_STRUCT,
+    _INCL_STRUCT,
+    _SEND_TS_STRUCT,
+    _SUMMARY_STRUCT,
+    _TEMP_STRUCT,
+    fnv1a32,
+)
+
+# ── Defaults ──────────────────────────────────────────────────────
+DEFAULT_BROKER    = "192.168.2.2"
+DEFAULT_PORT      = 1883
+DEFAULT_PREFIX    = "loadtest-"
+DEFAULT_ACCEL_HZ  = 200     # firmware MQTT_ACCEL_BATCH_SIZE per 1 s packet
+DEFAULT_INCL_HZ   = 20
+DEFAULT_PACKET_S  = 1.0
+DEFAULT_DRAIN_S   = 25.0    # after the last publish: storage + two stats flushes
+SAMPLE_INTERVAL_S = 2.0     # /proc and ingest_stats sampling
+
+TOPIC_TEMPLATE = "wind_turbine/{node_id}/data"
+FORMATS = ("json", "bin", "packed", "mix")
+RANGE_CODE = 1              # ±2 g
+TICKS_PER_S = 1_000_000 // TICK_US
+ADXL_ODR_HZ = 4000
+
+
+# ──────────────────────────────────────────────────────────────────
+# Packets
+# ──────────────────────────────────────────────────────────────────
+
+class NodeModel:
+    """Synthetic readings of one node in raw sensor units, as the firmware
+    holds them before encoding: ADXL355 counts, SCL3300 LSB, centi-degC."""
+
+    def __init__(self, serial: str, cfg):
+        self.serial = serial
+        self.rng = random.Random(fnv1a32(serial))
+        self.lsb_per_g = ADXL355_LSB_PER_G[RANGE_CODE]
+        self.accel_hz = cfg.accel_hz
+        self.incl_hz = cfg.incl_hz
+        self.packet_s = cfg.packet_s
+        self.nan_rate = cfg.nan_rate
+        self.nan_run = max(1, cfg.nan_run)
+        self.gap_rate = cfg.gap_rate
+        self.vib_freq = 2.0 + self.rng.uniform(-0.3, 0.3)
+        self.sway_freq = 0.05 + self.rng.uniform(-0.01, 0.01)
+        self.temp_base = 25.0 + self.rng.uniform(-5.0, 5.0)
+
+    def packet(self, seq: int, end_us: int) -> dict:
+        """One packet covering the packet period that ends at end_us."""
+        n_accel = int(self.accel_hz * self.packet_s)
+        n_incl = int(self.incl_hz * self.packet_s)
+        base_us = end_us - int(self.packet_s * 1_000_000)
+        period_ticks = TICKS_PER_S // self.accel_hz
+        rng = self.rng
+
+        gap = None
+        if self.gap_rate and rng.random() < self.gap_rate:
+            gap = rng.choice(("a", "i"))
+
+        accel = []
+        if gap != "a":
+            nan = [False] * n_accel
+            if self.nan_rate:
+                # Runs, as a sensor read failure loses consecutive samples
+                starts = self.nan_rate * n_accel / self.nan_run
+                while rng.random() < starts:
+                    first = rng.randrange(n_accel)
+                    for k in range(first, min(n_accel, first + self.nan_run)):
+                        nan[k] = True
+                    starts -= 1.0
+            for k in range(n_accel):
+                if nan[k]:
+                    accel.append(None)
+                    continue
+                t = (base_us + k * period_ticks * TICK_US) / 1e6
+                g_x = 0.02 * math.sin(2 * math.pi * self.sway_freq * t)
+                vib = 0.05 * math.sin(2 * math.pi * self.vib_freq * t)
+                accel.append((
+                    int((g_x + vib * 0.6 + rng.gauss(0, 0.002)) * self.lsb_per_g),
+                    int((vib * 0.4 + rng.gauss(0, 0.002)) * self.lsb_per_g),
+                    int((math.sqrt(1.0 - g_x * g_x) + vib * 0.1 + rng.gauss(0, 0.002)) * self.lsb_per_g),
+                ))
+
+        incl = []
+        if gap != "i" and n_incl:
+            step = TICKS_PER_S * self.packet_s / n_incl
+            for k in range(n_incl):
+                t = base_us / 1e6 + k * step / TICKS_PER_S
+                sway = 2 * math.pi * self.sway_freq * t
+                incl.append((
+                    int(k * step),
+                    int((1.5 * math.sin(sway) + rng.gauss(0, 0.01)) / SCL3300_DEG_PER_LSB),
+                    int((0.8 * math.cos(sway * 0.9) + rng.gauss(0, 0.01)) / SCL3300_DEG_PER_LSB),
+                    int(rng.gauss(0, 0.005) / SCL3300_DEG_PER_LSB),
+                ))
+
+        temp = int((self.temp_base + 0.3 * math.sin(2 * math.pi * base_us / 3.6e9)
+                    + rng.gauss(0, 0.05)) * 100)
+
+        gaps = []
+        if gap is not None:
+            gaps.append((0 if gap == "a" else 1, 1, 0, int(self.packet_s * 1_000_000)))
+
+        return {
+            "seq": seq,
+            "base_us": base_us,
+            "base_tick": (seq * int(TICKS_PER_S * self.packet_s)) & 0xFFFFFFFF,
+            "period_ticks": period_ticks,
+            "accel": accel,
+            "incl": incl,
+            "temp": temp,
+            "gaps": gaps,
+        }
+
+
+def _summary(accel: list):
+    # (real, nan, mins, maxs, means, rms) in counts, as mqtt.h accel_sum
+    real = [s for s in accel if s is not None]
+    nan = len(accel) - len(real)
+    if not real:
+        return len(real), nan, None
+    axes = list(zip(*real))
+    return len(real), nan, (
+        [min(a) for a in axes],
+        [max(a) for a in axes],
+        [int(sum(a) / len(a)) for a in axes],
+        [int(math.sqrt(sum(v * v for v in a) / len(a))) for a in axes],
+    )
+
+
+class _IsoCursor:
+    """ISO 8601 times with the date part formatted once per second (as the
+    firmware's ts_iso_cursor)."""
+
+    def __init__(self):
+        self.second = None
+        self.prefix = ""
+
+    def __call__(self, utc_us: int) -> str:
+        second, us = divmod(utc_us, 1_000_000)
+        if second != self.second:
+            self.second = second
+            self.prefix = datetime.fromtimestamp(second, tz=timezone.utc).strftime("%Y-%m-%dT%H:%M:%S")
+        return f"{self.prefix}.{us:06d}Z"
+
+
+def encode_json(pkt: dict, send_us: int, lsb_per_g: float) -> bytes:
+    iso = _IsoCursor()
+    base_us = pkt["base_us"]
+    period_us = pkt["period_ticks"] * TICK_US
+    accel = []
+    for k, s in enumerate(pkt["accel"]):
+        ts = iso(base_us + k * period_us)
+        if s is None:
+            accel.append([ts, math.nan, math.nan, math.nan])
+        else:
+            accel.append([ts, round(s[0] / lsb_per_g, 4), round(s[1] / lsb_per_g, 4),
+                          round(s[2] / lsb_per_g, 4)])
+    incl = [[iso(base_us + dtick * TICK_US)] + [round(v * SCL3300_DEG_PER_LSB, 4) for v in vals]
+            for dtick, *vals in pkt["incl"]]
+    data = {
+        "a": accel,
+        "i": incl,
+        "T": [iso(base_us), pkt["temp"] / 100.0],
+        "e": 0,
+        "seq": pkt["seq"],
+        "st": send_us,
+    }
+    real, nan, stats = _summary(pkt["accel"])
+    data["s"] = {"n": real, "nan": nan}
+    if stats is not None:
+        for key, values in zip(("min", "max", "mean", "rms"), stats):
+            data["s"][key] = [round(v / lsb_per_g, 4) for v in values]
+    if pkt["gaps"]:
+        data["g"] = [[iso(base_us + dtick * TICK_US), dur_us, "i" if sensor else "a",
+                      "disconnected" if reason == 1 else "no_samples"]
+                     for sensor, reason, dtick, dur_us in pkt["gaps"]]
+    return json.dumps(data, separators=(",", ":")).encode()
+
+
+def _pack_accel(rows: list) -> bytes:
+    # firmware accel_pack.h: per axis the first sample, then zigzag deltas
+    # bit-packed LSB first in blocks of ACCEL_PACK_BLOCK with a width byte
+    out = bytearray()
+    for axis in range(3):
+        values = [r[axis] for r in rows]
+        out += struct.pack("<i", values[0])
+        prev = values[0]
+        for start in range(1, len(values), ACCEL_PACK_BLOCK):
+            zz = []
+            for v in values[start:start + ACCEL_PACK_BLOCK]:
+                d = ((v - prev + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+                zz.append(((d << 1) ^ (d >> 31)) & 0xFFFFFFFF)
+                prev = v
+            width = max(zz).bit_length()
+            bits = 0
+            for k, z in enumerate(zz):
+                bits |= z << (k * width)
+            out.append(width)
+            out += bits.to_bytes((len(zz) * width + 7) // 8, "little")
+    return bytes(out)
+
+
+def encode_binary(pkt: dict, serial: str, send_us: int, packed: bool) -> bytes:
+    rows = [s if s is not None else (ACCEL_INVALID,) * 3 for s in pkt["accel"]]
+    real, nan, stats = _summary(pkt["accel"])
+    summary = real + nan <= 255         # counts are one byte each
+
+    flags = FLAG_HAS_TEMP | FLAG_TEMP_VALID | FLAG_SEND_TS
+    if rows:
+        flags |= FLAG_ACCEL_VALID
+    if pkt["incl"]:
+        flags |= FLAG_INCL_VALID
+    if summary:
+        flags |= FLAG_SUMMARY
+    if pkt["gaps"]:
+        flags |= FLAG_GAPS
+
+    out = bytearray(_HEADER_STRUCT.pack(
+        BIN_MAGIC, BIN_VERSION_PACKED if packed else BIN_VERSION, flags, RANGE_CODE,
+        fnv1a32(serial), pkt["seq"], pkt["base_tick"], pkt["base_us"],
+        ADXL_ODR_HZ, min(255, ADXL_ODR_HZ * pkt["period_ticks"] // TICKS_PER_S),
+        len(rows), pkt["period_ticks"], len(pkt["incl"]), 0,
+    ))
+    if packed:
+        block = _pack_accel(rows) if rows else b""
+        out += struct.pack("<H", len(block)) + block
+    elif rows:
+        out += struct.pack(f"<{len(rows) * 3}i", *(v for r in rows for v in r))
+    for entry in pkt["incl"]:
+        out += _INCL_STRUCT.pack(*entry)
+    out += _TEMP_STRUCT.pack(0, pkt["temp"])
+    out += _SEND_TS_STRUCT.pack(send_us)
+    if summary:
+        mins, maxs, means, rms = stats if stats is not None else ([0] * 3,) * 4
+        out += _SUMMARY_STRUCT.pack(real, nan, *mins, *maxs, *means, *rms)
+    if pkt["gaps"]:
+        out.append(len(pkt["gaps"]))
+        for gap in pkt["gaps"]:
+            out += _GAP_STRUCT.pack(*gap)
+    return bytes(out)
+
+
+# ──────────────────────────────────────────────────────────────────
+# Publisher processes
+# ──────────────────────────────────────────────────────────────────
+
+class _SimNode:
+    def __init__(self, serial: str, start_at: float, fmt: str, cfg):
+        self.serial = serial
+        self.fmt = fmt
+        self.model = NodeModel(serial, cfg)
+        self.topic = TOPIC_TEMPLATE.format(node_id=serial)
+        self.seq = 0
+        self.due = start_at + cfg.packet_s     # end of the first packet period
+        self.client = None
+        self.down_until = 0.0
+        self.next_drop = (start_at + random.expovariate(1.0 / cfg.drop_every)
+                          if cfg.drop_every else math.inf)
+
+
+def _publisher(index: int, cfg, nodes: list, reports, stop) -> None:
+    random.seed(index)
+    counters = {"published": 0, "bytes": 0, "samples": 0, "skipped": 0,
+                "not_sent": 0, "late_max_ms": 0.0, "drops": 0}
+    sims = [_SimNode(serial, start_at, fmt, cfg) for serial, start_at, fmt in nodes]
+    for sim in sims:
+        sim.client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2, client_id=sim.serial)
+        sim.client.connect_async(cfg.broker, cfg.port, keepalive=60)
+        sim.client.loop_start()
+
+    heap = [(sim.due, i) for i, sim in enumerate(sims)]
+    heapq.heapify(heap)
+    next_report = time.time()
+    try:
+        while not stop.is_set() and heap:
+            at, i = heap[0]
+            now = time.time()
+            if now >= next_report:
+                reports.put((index, dict(counters)))
+                next_report = now + 1.0
+            if at > now:
+                time.sleep(min(at - now, 0.05))
+                continue
+            heapq.heappop(heap)
+            sim = sims[i]
+            due = sim.due
+            sim.due += cfg.packet_s
+            heapq.heappush(heap, (sim.due + (abs(random.gauss(0, cfg.jitter_ms)) / 1000.0
+                                             if cfg.jitter_ms else 0.0), i))
+
+            # Link drops: the node is gone, its packets meanwhile are lost
+            if due >= sim.next_drop and not sim.down_until:
+                sim.client.disconnect()
+                sim.down_until = due + cfg.drop_s
+                sim.next_drop = sim.down_until + random.expovariate(1.0 / cfg.drop_every)
+                counters["drops"] += 1
+            if sim.down_until:
+                if due < sim.down_until:
+                    sim.seq += 1
+                    counters["skipped"] += 1
+                    continue
+                sim.client.reconnect()
+                sim.down_until = 0.0
+
+            counters["late_max_ms"] = max(counters["late_max_ms"], (now - due) * 1000.0)
+            pkt = sim.model.packet(sim.seq, int(due * 1_000_000))
+            sim.seq += 1
+            send_us = int(time.time() * 1_000_000)
+            fmt = sim.fmt
+            if fmt == "json":
+                payload = encode_json(pkt, send_us, sim.model.lsb_per_g)
+            else:
+                payload = encode_binary(pkt, sim.serial, send_us, packed=(fmt == "packed"))
+            info = sim.client.publish(sim.topic, payload, qos=0)
+            if info.rc != mqtt.MQTT_ERR_SUCCESS:
+                counters["not_sent"] += 1
+                continue
+            counters["published"] += 1
+            counters["bytes"] += len(payload)
+            counters["samples"] += len(pkt["accel"])
+    finally:
+        reports.put((index, dict(counters)))
+        for sim in sims:
+            sim.client.disconnect()
+            sim.client.loop_stop()
+
+
+# ──────────────────────────────────────────────────────────────────
+# Listener side
+# ──────────────────────────────────────────────────────────────────
+
+def _find_pid(needle: str):
+    for entry in os.listdir("/proc"):
+        if not entry.isdigit() or int(entry) == os.getpid():
+            continue
+        try:
+            cmdline = Path(f"/proc/{entry}/cmdline").read_bytes().replace(b"\0", b" ").decode()
+        except OSError:
+            continue
+        if needle in cmdline:
+            return int(entry)
+    return None
+
+
+class _ProcSampler:
+    """CPU, RSS and disk writes of one process from /proc."""
+
+    def __init__(self, pid):
+        self.pid = pid
+        self.hz = os.sysconf("SC_CLK_TCK")
+
+    def sample(self):
+        if self.pid is None:
+            return None
+        try:
+            stat = Path(f"/proc/{self.pid}/stat").read_text()
+            status = Path(f"/proc/{self.pid}/status").read_text()
+        except OSError:
+            return None
+        fields = stat.rsplit(")", 1)[1].split()
+        out = {"t": time.time(), "cpu_s": (int(fields[11]) + int(fields[12])) / self.hz}
+        for line in status.splitlines():
+            if line.startswith("VmRSS:"):
+                out["rss_mb"] = int(line.split()[1]) / 1024.0
+        try:
+            for line in Path(f"/proc/{self.pid}/io").read_text().splitlines():
+                if line.startswith("write_bytes:"):
+                    out["write_bytes"] = int(line.split()[1])
+        except OSError:
+            pass    # other user's process: no I/O counters
+        return out
+
+
+def _system_sample():
+    try:
+        cpu = [int(v) for v in Path("/proc/stat").read_text().split("\n", 1)[0].split()[1:]]
+        load = float(Path("/proc/loadavg").read_text().split()[0])
+    except OSError:
+        return None
+    return {"busy": sum(cpu) - cpu[3] - cpu[4], "total": sum(cpu), "load1": load}
+
+
+def _load_stats(args) -> dict:
+    try:
+        if args.stats_url:
+            req = urllib.request.Request(args.stats_url)
+            if args.session:
+                req.add_header("Cookie", f"session_id={args.session}")
+            with urllib.request.urlopen(req, timeout=5) as resp:
+                return json.loads(resp.read())
+        return json.loads(Path(args.stats).read_text(encoding="utf-8"))
+    except (OSError, ValueError) as e:
+        print(f"[load_test] Could not read ingest stats: {e}")
+        return {}
+
+
+_COUNTERS = ("packets", "stored", "queue_drops", "queue_spills", "decode_errors",
+             "rejected", "store_failed")
+_HISTS = ("send_to_rx", "rx_to_disk", "sample_to_disk")
+
+
+def _node_totals(stats: dict, serials: set) -> dict:
+    """Counters and latency histograms of the test nodes, summed."""
+    nbuckets = len(ingest_stats.LATENCY_BUCKETS_MS) + 1
+    out = {name: 0 for name in _COUNTERS}
+    out["lost"] = 0
+    out["hist"] = {name: {"n": 0, "total_ms": 0.0, "counts": [0] * nbuckets} for name in _HISTS}
+    for serial, node in stats.get("nodes", {}).items():
+        if serial not in serials:
+            continue
+        for name in _COUNTERS:
+            out[name] += node.get(name, 0)
+        seq = node.get("seq", {})
+        out["lost"] += seq.get("lost", 0) + seq.get("lost_before_restarts", 0)
+        for name in _HISTS:
+            h = node.get("latency", {}).get(name)
+            if not h:
+                continue
+            merged = out["hist"][name]
+            merged["n"] += h["n"]
+            merged["total_ms"] += (h["avg_ms"] or 0.0) * h["n"]
+            for k, c in enumerate(h["counts"][:nbuckets]):
+                merged["counts"][k] += c
+    return out
+
+
+def _queue_peaks(stats: dict) -> dict:
+    pipeline = stats.get("ingest_pipeline", {})
+    workers = pipeline.get("workers", [])
+    return {
+        "ingest_depth": max((w.get("max_depth", 0) for w in workers), default=0),
+        "ingest_wait_ms": max((w.get("wait", {}).get("ms_max", 0) for w in workers), default=0),
+        "ingest_overflow": sum(w.get("overflow", 0) for w in workers),
+        "shard_depth": max((s.get("max_depth", 0) for s in stats.get("storage_shards", [])), default=0),
+        "raw_depth": max((w.get("max_depth", 0) for w in stats.get("raw_backup", [])), default=0),
+        "raw_dropped": sum(w.get("dropped", 0) for w in stats.get("raw_backup", [])),
+    }
+
+
+def _percentile(counts: list, q: float):
+    # Upper bucket bound of the q-quantile, as ingest_stats._Histogram
+    n = sum(counts)
+    if n == 0:
+        return None
+    seen = 0
+    for i, c in enumerate(counts):
+        seen += c
+        if seen >= q * n:
+            bounds = ingest_stats.LATENCY_BUCKETS_MS
+            return bounds[i] if i < len(bounds) else None
+    return None
+
+
+class _Boundary:
+    """Everything cumulative at one instant, to difference per step."""
+
+    def __init__(self, t: float, published: dict, totals: dict, queues: dict, listener, system):
+        self.t = t
+        self.published = published
+        self.totals = totals
+        self.queues = queues
+        self.listener = listener
+        self.system = system
+
+
+def _step_result(nodes: int, a: _Boundary, b: _Boundary, peaks: dict) -> dict:
+    dt = max(b.t - a.t, 1e-6)
+    pub = {k: b.published.get(k, 0) - a.published.get(k, 0) for k in b.published}
+    d = {k: b.totals[k] - a.totals[k] for k in _COUNTERS + ("lost",)}
+    latency = {}
+    for name in _HISTS:
+        ha, hb = a.totals["hist"][name], b.totals["hist"][name]
+        n = hb["n"] - ha["n"]
+        counts = [y - x for x, y in zip(ha["counts"], hb["counts"])]
+        latency[name] = {
+            "n": n,
+            "avg_ms": round((hb["total_ms"] - ha["total_ms"]) / n, 1) if n else None,
+            "p50_ms": _percentile(counts, 0.50),
+            "p95_ms": _percentile(counts, 0.95),
+            "p99_ms": _percentile(counts, 0.99),
+        }
+
+    listener = {}
+    if a.listener and b.listener:
+        listener["cpu_pct"] = round(100.0 * (b.listener["cpu_s"] - a.listener["cpu_s"]) / dt, 1)
+        listener["rss_mb_peak"] = round(peaks.get("rss_mb", 0.0), 1)
+        if "write_bytes" in a.listener and "write_bytes" in b.listener:
+            listener["disk_mb_s"] = round((b.listener["write_bytes"] - a.listener["write_bytes"]) / dt / 1e6, 3)
+    system = {}
+    if a.system and b.system:
+        total = b.system["total"] - a.system["total"]
+        system["cpu_pct"] = round(100.0 * (b.system["busy"] - a.system["busy"]) / total, 1) if total else None
+        system["load1_peak"] = peaks.get("load1")
+    if "broker_cpu_s" in peaks:
+        system["broker_cpu_pct"] = round(100.0 * peaks["broker_cpu_s"] / dt, 1)
+
+    queues = {k: v for k, v in peaks.items() if k in ("ingest_depth", "ingest_wait_ms", "shard_depth", "raw_depth")}
+    queues["ingest_overflow"] = b.queues["ingest_overflow"] - a.queues["ingest_overflow"]
+    queues["raw_dropped"] = b.queues["raw_dropped"] - a.queues["raw_dropped"]
+
+    unexplained_loss = max(0, d["lost"] - pub.get("skipped", 0))
+    errors = (d["queue_drops"] + d["queue_spills"] + d["decode_errors"] + d["rejected"]
+              + d["store_failed"] + queues["ingest_overflow"] + queues["raw_dropped"]
+              + pub.get("not_sent", 0))
+    p95 = latency["sample_to_disk"]["p95_ms"]
+    healthy = (unexplained_loss == 0 and errors == 0 and latency["sample_to_disk"]["n"] > 0
+               and p95 is not None and p95 <= ingest_stats.INGEST_SLO_MS)
+    return {
+        "nodes": nodes,
+        "seconds": round(dt, 1),
+        "published_pps": round(pub.get("published", 0) / dt, 2),
+        "published_samples_s": round(pub.get("samples", 0) / dt, 1),
+        "published_mb_s": round(pub.get("bytes", 0) / dt / 1e6, 3),
+        "stored_pps": round(d["stored"] / dt, 2),
+        "received_pps": round(d["packets"] / dt, 2),
+        "skipped": pub.get("skipped", 0),
+        "counters": d,
+        "unexplained_loss": unexplained_loss,
+        "errors": errors,
+        "latency": latency,
+        "queues": queues,
+        "listener": listener,
+        "system": system,
+        "generator_late_ms_max": round(b.published.get("late_max_ms", 0.0), 1),
+        "healthy": healthy,
+    }
+
+
+# ──────────────────────────────────────────────────────────────────
+# Report
+# ──────────────────────────────────────────────────────────────────
+
+def _print_report(report: dict) -> None:
+    print()
+    print(f"{'nodes':>5} {'pub/s':>7} {'stored/s':>8} {'MB/s':>6} {'disk':>6} "
+          f"{'s->disk p50/p95/p99 ms':>23} {'rx->disk':>8} {'q ing/shd/raw':>13} "
+          f"{'cpu%':>6} {'rss':>6} {'sys%':>5}  ok")
+    for s in report["steps"]:
+        lat = s["latency"]["sample_to_disk"]
+        pct = "/".join("-" if v is None else str(v) for v in (lat["p50_ms"], lat["p95_ms"], lat["p99_ms"]))
+        q = s["queues"]
+        print(f"{s['nodes']:>5} {s['published_pps']:>7.1f} {s['stored_pps']:>8.1f} "
+              f"{s['published_mb_s']:>6.2f} {s['listener'].get('disk_mb_s', '-'):>6} {pct:>23} "
+              f"{s['latency']['rx_to_disk']['avg_ms'] or '-':>8} "
+              f"{q.get('ingest_depth', 0)}/{q.get('shard_depth', 0)}/{q.get('raw_depth', 0):<5} "
+              f"{s['listener'].get('cpu_pct', '-'):>6} {s['listener'].get('rss_mb_peak', '-'):>6} "
+              f"{s['system'].get('cpu_pct', '-'):>5}  {'yes' if s['healthy'] else 'NO'}")
+        if not s["healthy"]:
+            print(f"        loss {s['unexplained_loss']}, errors {s['errors']} "
+                  f"(drops {s['counters']['queue_drops']}, spills {s['counters']['queue_spills']}, "
+                  f"overflow {q['ingest_overflow']}, raw dropped {q['raw_dropped']}, "
+                  f"rejected {s['counters']['rejected']}, decode {s['counters']['decode_errors']})")
+    t = report["totals"]
+    print()
+    print(f"Published {t['published']} packets ({t['skipped']} skipped by link drops), "
+          f"stored {t['stored']} after {report['config']['drain_s']:.0f} s drain "
+          f"({t['stored_ratio'] * 100 if t['stored_ratio'] is not None else 0:.2f} %)")
+    if report["ceiling_nodes"] is not None:
+        print(f"Ceiling: {report['ceiling_nodes']} node(s) healthy at "
+              f"{report['config']['accel_hz']} Hz, {report['config']['format']}")
+    else:
+        print("Ceiling: no healthy step")
+
+
+def _compare(report: dict, baseline: dict, tolerance: float) -> list[str]:
+    """Regressions of report against baseline, step by step."""
+    problems = []
+    old_steps = {s["nodes"]: s for s in baseline.get("steps", [])}
+    for s in report["steps"]:
+        old = old_steps.get(s["nodes"])
+        if old is None:
+            continue
+        n = s["nodes"]
+        if old["healthy"] and not s["healthy"]:
+            problems.append(f"{n} nodes: healthy before, not now")
+        checks = (
+            ("stored packets/s", old["stored_pps"], s["stored_pps"], False),
+            ("mean sample->disk ms", old["latency"]["sample_to_disk"]["avg_ms"],
+             s["latency"]["sample_to_disk"]["avg_ms"], True),
+            ("listener CPU %", old["listener"].get("cpu_pct"), s["listener"].get("cpu_pct"), True),
+            ("listener RSS MB", old["listener"].get("rss_mb_peak"), s["listener"].get("rss_mb_peak"), True),
+        )
+        for label, before, now, higher_is_worse in checks:
+            if not before or now is None:
+                continue
+            change = (now - before) / before
+            if (change > tolerance) if higher_is_worse else (change < -tolerance):
+                problems.append(f"{n} nodes: {label} {before} -> {now} ({change * 100:+.0f} %)")
+    if (baseline.get("ceiling_nodes") or 0) > (report.get("ceiling_nodes") or 0):
+        problems.append(f"ceiling {baseline['ceiling_nodes']} -> {report['ceiling_nodes']} node(s)")
+    return problems
+
+
+# ──────────────────────────────────────────────────────────────────
+# CLI
+# ──────────────────────────────────────────────────────────────────
+
+def main():
+    p = argparse.ArgumentParser(description="Multi-node ingest load test")
+    p.add_argument("--broker", default=DEFAULT_BROKER)
+    p.add_argument("--port", type=int, default=DEFAULT_PORT)
+    p.add_argument("--nodes", type=int, default=10, help="Node count (the last step with --step)")
+    p.add_argument("--prefix", default=DEFAULT_PREFIX, help="Serial prefix of the test nodes")
+    p.add_argument("--format", choices=FORMATS, default="bin",
+                   help="Payload format; mix cycles json/bin/packed over the nodes")
+    p.add_argument("--accel-hz", type=int, default=DEFAULT_ACCEL_HZ)
+    p.add_argument("--incl-hz", type=int, default=DEFAULT_INCL_HZ)
+    p.add_argument("--packet-s", type=float, default=DEFAULT_PACKET_S)
+    p.add_argument("--duration", type=float, default=300.0, metavar="SECONDS",
+                   help="Run length without --step")
+    p.add_argument("--step", type=int, default=0, metavar="N", help="Add N nodes per step")
+    p.add_argument("--step-s", type=float, default=120.0, metavar="SECONDS")
+    p.add_argument("--processes", type=int, default=max(1, (os.cpu_count() or 2) // 2))
+    p.add_argument("--nan-rate", type=float, default=0.0)
+    p.add_argument("--nan-run", type=int, default=20, metavar="SAMPLES")
+    p.add_argument("--gap-rate", type=float, default=0.0)
+    p.add_argument("--drop-every", type=float, default=0.0, metavar="SECONDS")
+    p.add_argument("--drop-s", type=float, default=10.0, metavar="SECONDS")
+    p.add_argument("--jitter-ms", type=float, default=0.0)
+    p.add_argument("--drain-s", type=float, default=DEFAULT_DRAIN_S)
+    p.add_argument("--stats", default=str(ingest_stats.INGEST_STATS_JSON))
+    p.add_argument("--stats-url", help="/api/ingest/stats URL when not run on the Pi")
+    p.add_argument("--session", help="session_id cookie for --stats-url")
+    p.add_argument("--listener-pid", type=int, help="Default: the mqtt_listener_data.py process")
+    p.add_argument("--report", help="Write the JSON report here")
+    p.add_argument("--baseline", help="Earlier JSON report to compare with")
+    p.add_argument("--tolerance", type=float, default=0.15)
+    args = p.parse_args()
+
+    if TICKS_PER_S % args.accel_hz:
+        p.error(f"--accel-hz must divide {TICKS_PER_S}")
+    if args.accel_hz * args.packet_s > 255 or args.incl_hz * args.packet_s > 255:
+        p.error("binary frames hold at most 255 samples per sensor")
+    if args.packet_s * TICKS_PER_S > 0x7FFF:
+        p.error("--packet-s too long for the frame's 16-bit tick offsets")
+
+    counts = (list(range(args.step, args.nodes, args.step)) + [args.nodes]) if args.step else [args.nodes]
+    step_s = args.step_s if args.step else args.duration
+    serials = [f"{args.prefix}{i:03d}" for i in range(args.nodes)]
+    formats = ("json", "bin", "packed")
+
+    # Node i starts with the first step that includes it, staggered over the period
+    t0 = time.time() + 3.0
+    plan = []
+    for i, serial in enumerate(serials):
+        step = next(k for k, n in enumerate(counts) if i < n)
+        start_at = t0 + step * step_s + (i % max(1, counts[0])) * args.packet_s / max(1, counts[0])
+        fmt = formats[i % 3] if args.format == "mix" else args.format
+        plan.append((serial, start_at, fmt))
+
+    listener_pid = args.listener_pid or _find_pid("mqtt_listener_data.py")
+    broker_pid = _find_pid("mosquitto")
+    if listener_pid is None:
+        print("[load_test] Listener process not found: no CPU / RSS / disk figures")
+    listener = _ProcSampler(listener_pid)
+    broker = _ProcSampler(broker_pid)
+    serial_set = set(serials)
+
+    print(f"Load test: {args.nodes} node(s) {args.format} at {args.accel_hz} Hz -> "
+          f"{args.broker}:{args.port}, steps {counts} x {step_s:.0f} s, "
+          f"{args.processes} publisher process(es), listener pid {listener_pid}")
+
+    reports = mp.Queue()
+    stop = mp.Event()
+    nprocs = max(1, min(args.processes, args.nodes))
+    procs = [mp.Process(target=_publisher, args=(k, args, plan[k::nprocs], reports, stop), daemon=True)
+             for k in range(nprocs)]
+    for proc in procs:
+        proc.start()
+
+    latest: dict[int, dict] = {}
+
+    def published() -> dict:
+        while True:
+            try:
+                k, c = reports.get_nowait()
+                latest[k] = c
+            except queue.Empty:
+                break
+        out = {}
+        for c in latest.values():
+            for key, v in c.items():
+                out[key] = max(out.get(key, 0.0), v) if key == "late_max_ms" else out.get(key, 0) + v
+        return out
+
+    def boundary() -> _Boundary:
+        stats = _load_stats(args)
+        return _Boundary(time.time(), published(), _node_totals(stats, serial_set),
+                         _queue_peaks(stats), listener.sample(), _system_sample())
+
+    while time.time() < t0:
+        time.sleep(0.1)
+    marks = [boundary()]
+    steps = []
+    try:
+        for k, n in enumerate(counts):
+            end = t0 + (k + 1) * step_s
+            peaks: dict = {}
+            broker_start = broker.sample()
+            while time.time() < end:
+                time.sleep(min(SAMPLE_INTERVAL_S, max(0.0, end - time.time())))
+                queues = _queue_peaks(_load_stats(args))
+                for key in ("ingest_depth", "ingest_wait_ms", "shard_depth", "raw_depth"):
+                    peaks[key] = max(peaks.get(key, 0), queues[key])
+                ls, ss = listener.sample(), _system_sample()
+                if ls:
+                    peaks["rss_mb"] = max(peaks.get("rss_mb", 0.0), ls.get("rss_mb", 0.0))
+                if ss:
+                    peaks["load1"] = max(peaks.get("load1", 0.0), ss["load1"])
+            broker_end = broker.sample()
+            if broker_start and broker_end:
+                peaks["broker_cpu_s"] = broker_end["cpu_s"] - broker_start["cpu_s"]
+            marks.append(boundary())
+            steps.append(_step_result(n, marks[-2], marks[-1], peaks))
+            s = steps[-1]
+            print(f"[load_test] {n} node(s): {s['stored_pps']:.1f} stored/s of {s['published_pps']:.1f}, "
+                  f"p95 sample->disk {s['latency']['sample_to_disk']['p95_ms']} ms, "
+                  f"listener {s['listener'].get('cpu_pct', '-')} % CPU -> "
+                  f"{'healthy' if s['healthy'] else 'NOT healthy'}")
+    except KeyboardInterrupt:
+        print("\n[load_test] Interrupted: reporting the completed steps")
+    finally:
+        stop.set()
+        for proc in procs:
+            proc.join(timeout=10)
+
+    print(f"[load_test] Publishing stopped; waiting {args.drain_s:.0f} s for the listener to drain")
+    time.sleep(args.drain_s)
+    final_pub = published()
+    final = _node_totals(_load_stats(args), serial_set)
+
+    ceiling = None
+    for s in steps:
+        if not s["healthy"]:
+            break
+        ceiling = s["nodes"]
+
+    report = {
+        "started_at": datetime.fromtimestamp(t0, tz=timezone.utc).isoformat(),
+        "host": platform.node(),
+        "machine": platform.machine(),
+        "listener_pid": listener_pid,
+        "config": {k: v for k, v in vars(args).items() if k != "session"},
+        "steps": steps,
+        "totals": {
+            "published": final_pub.get("published", 0),
+            "skipped": final_pub.get("skipped", 0),
+            "not_sent": final_pub.get("not_sent", 0),
+            "link_drops": final_pub.get("drops", 0),
+            "stored": final["stored"],
+            "stored_ratio": (round(final["stored"] / final_pub["published"], 5)
+                             if final_pub.get("published") else None),
+            "counters": {k: final[k] for k in _COUNTERS + ("lost",)},
+        },
+        "ceiling_nodes": ceiling,
+    }
+    _print_report(report)
+
+    if args.report:
+        Path(args.report).write_text(json.dumps(report, indent=2), encoding="utf-8")
+        print(f"Report written to {args.report}")
+
+    if args.baseline:
+        problems = _compare(report, json.loads(Path(args.baseline).read_text(encoding="utf-8")),
+                            args.tolerance)
+        if problems:
+            print(f"\nRegressions against {args.baseline}:")
+            for line in problems:
+                print(f"  {line}")
+            sys.exit(1)
+        print(f"\nNo regressions against {args.baseline} (tolerance {args.tolerance * 100:.0f} %)")
+
+
+if __name__ == "__main__":
+    main()
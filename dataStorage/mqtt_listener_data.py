@@ -1,16 +1,33 @@
 import json
+import time
+from datetime import datetime, timedelta
+from time import time_ns
 
 import paho.mqtt.client as mqtt
 from node_registry import update_sensor_runtime
-from fault_logger import log_fault_events
+from fault_logger import close_fault_store, log_fault_events, set_fault_row_sink
+from fault_bus import FAULT_BUS_TOPIC
+from metrics_logger import log_node_metrics
+import ingest_stats
+import accel_summary
+import ingest_partition
+import live_stream
+import metrics
+import node_analytics
 from node_registry import register_serial, serial_from_topic, get_node_by_serial
 from raw_backup import write_raw, close_all as raw_backup_close_all
+from binary_payload import is_binary_payload, decode_binary_payload, split_binary_frames
+from event_payload import handle_event_chunk
+from udp_receiver import UdpStreamReceiver
+from raw_stream import write_raw_frame, close_all as raw_stream_close_all
+from ingest_pipeline import IngestPipeline
 from settings_store import (
     apply_accelerometer_config_ack,
     update_accelerometer_runtime_state,
 )
 
 from encoder_storage import (
+    close_all_writers,
     enqueue_packet,
     normalise_sensor_timestamps,
     now_iso,
@@ -22,9 +39,35 @@ PORT = 1883
 TOPIC = "wind_turbine/+/data"
 STATUS_TOPIC = "wind_turbine/+/status"
 FAULT_TOPIC = "wind_turbine/+/faults"
+EVENT_TOPIC = "wind_turbine/+/event"
+METRICS_TOPIC = "wind_turbine/+/metrics"
+SPECTRUM_TOPIC = "wind_turbine/+/spectrum"
 KEEPALIVE_S = 60
 MAX_RECONNECT_DELAY_S = 30
 
+# Last config epoch ("e") seen per node. It changes where the node applied
+# new acquisition settings, e.g. a live range / HPF change while recording.
+_last_cfg_epoch: dict = {}
+
+# Hot-path metrics (backend metrics.py); handling time per message is
+# recorded by the ingest pipeline
+_ON_MESSAGE_S = metrics.histogram(
+    "shm_mqtt_on_message_seconds", "Time on the paho network thread per MQTT message")
+_DECODE_S = metrics.histogram(
+    "shm_ingest_decode_seconds", "Time to decode one data message", ("format",))
+
+
+def note_config_epoch(serial: str, data: dict) -> None:
+    """Log the packet boundary where a node's acquisition settings changed."""
+    epoch = data.get("e")
+    if epoch is None:
+        return
+    previous = _last_cfg_epoch.get(serial)
+    _last_cfg_epoch[serial] = epoch
+    if previous is not None and previous != epoch:
+        first = data.get("a") or [[None]]
+        print(f"[data] {serial} config epoch {previous} -> {epoch} from {first[0][0]}")
+
 
 def handle_status_message(topic: str, payload_bytes: bytes) -> None:
     """Process node status messages and update backend config/runtime state."""
@@ -41,6 +84,22 @@ def handle_status_message(topic: str, payload_bytes: bytes) -> None:
 
         seq_ack = payload.get("seq_ack")
         applied = bool(payload.get("applied"))
+
+        bench = payload.get("bench")
+        if isinstance(bench, dict):
+            # Scenario benchmark result (firmware bench.h); stage triples are
+            # [calls, avg cycles, max cycles]
+            mhz = bench.get("cpu_mhz") or 1
+            stages = " ".join(
+                f"{name}={bench[name][1] / mhz:.0f}/{bench[name][2] / mhz:.0f}us"
+                for name in ("produce", "decimate", "serialize", "publish")
+                if isinstance(bench.get(name), list) and len(bench[name]) == 3
+            )
+            print(f"[bench] {serial} {bench.get('s')}s @{bench.get('odr_hz')}Hz "
+                  f"{bench.get('format')}: {stages} packets={bench.get('packets')} "
+                  f"pub_fail={bench.get('pub_fail')} cpu_x10={bench.get('cpu_x10')} "
+                  f"heap={bench.get('heap')}"
+                  + (f" error={payload['error']}" if payload.get("error") else ""))
         has_full_config = all(key in payload for key in ("odr_index", "range", "hpf_corner"))
 
         if applied and seq_ack is not None and has_full_config:
@@ -66,6 +125,20 @@ def handle_status_message(topic: str, payload_bytes: bytes) -> None:
         print(f"Failed to process status message on {topic}: {e}")
 
 
+def offset_fault_ts(ts: str, dt_ms: int) -> str:
+    """Shift an ISO-8601 fault timestamp by dt_ms, keeping the node's format.
+
+    Tick-fallback stamps ("tick:NNN") and anything unparsable are returned as-is.
+    """
+    if not dt_ms:
+        return ts
+    try:
+        base = datetime.strptime(ts, "%Y-%m-%dT%H:%M:%S.%fZ")
+    except (TypeError, ValueError):
+        return ts
+    return (base + timedelta(milliseconds=dt_ms)).strftime("%Y-%m-%dT%H:%M:%S.%fZ")
+
+
 def handle_fault_message(topic: str, payload_bytes: bytes) -> None:
     """Process fault messages from wind_turbine/{serial}/faults."""
     try:
@@ -85,14 +158,30 @@ def handle_fault_message(topic: str, payload_bytes: bytes) -> None:
             print(f"[faults] Invalid fault format from {serial}: {faults}")
             return
 
-        fault_events = [(int(code), ts) for code in faults]
+        # Coalesced batches carry a repeat count and the ms offset of the
+        # last occurrence of each code; single-fault messages have neither.
+        counts = data.get("n") or [1] * len(faults)
+        offsets = data.get("dt") or [0] * len(faults)
+
+        fault_events = []
+        for i, code in enumerate(faults):
+            count = int(counts[i]) if i < len(counts) else 1
+            dt_ms = int(offsets[i]) if i < len(offsets) else 0
+            if count > 1:
+                print(f"[faults] {serial}: code {code} x{count} in one window")
+            fault_events.append((int(code), offset_fault_ts(ts, dt_ms)))
+
+        lost = data.get("lost")
+        if lost:
+            print(f"[faults] {serial}: {lost} fault event(s) lost on the node (queue full)")
+
         log_fault_events(serial_number=serial, fault_events=fault_events)
     except Exception as e:
         print(f"Error processing fault message on {topic}: {e}")
 
 
 def on_connect(client, userdata, flags, reason_code, properties):
-    """Subscribe to data, status, and fault topics on successful MQTT connect."""
+    """Subscribe to data, status, fault, event, metrics and spectrum topics on successful MQTT connect."""
     if reason_code == 0:
         print("[MQTT] Connected to broker")
     else:
@@ -102,6 +191,9 @@ def on_connect(client, userdata, flags, reason_code, properties):
     client.subscribe(TOPIC)
     client.subscribe(STATUS_TOPIC)
     client.subscribe(FAULT_TOPIC)
+    client.subscribe(EVENT_TOPIC)
+    client.subscribe(METRICS_TOPIC)
+    client.subscribe(SPECTRUM_TOPIC)
 
 
 def on_disconnect(client, userdata, flags, reason_code, properties):
@@ -116,45 +208,128 @@ def on_disconnect(client, userdata, flags, reason_code, properties):
 
 
 def on_message(client, userdata, msg):
-    """Handle incoming MQTT packets for status updates, fault events, and sensor data."""
-    try:
-        if msg.topic.endswith("/status"):
-            handle_status_message(msg.topic, msg.payload)
-            return
+    """paho network thread: hand the message to the node's ingest worker."""
+    recv_ns = time_ns()
+    parts = msg.topic.split("/")
+    if len(parts) < 3 or not parts[1]:
+        return
+    if not ingest_partition.owns(parts[1]):
+        # Another listener process's node (listener_supervisor.py)
+        return
+    ingest.submit(parts[1], msg.topic, msg.payload, recv_ns)
+    _ON_MESSAGE_S.observe((time_ns() - recv_ns) / 1e9)
 
-        if msg.topic.endswith("/faults"):
-            handle_fault_message(msg.topic, msg.payload)
-            return
 
-        if not msg.topic.endswith("/data"):
-            return
+def handle_message(node_id: str, topic: str | None, payload: bytes, recv_ns: int) -> None:
+    """Handle one message on the node's ingest worker; topic is None for a
+    frame from the UDP stream."""
+    if topic is None:
+        handle_data_payload(node_id, payload, recv_ns)
+        return
+
+    # Lets the UDP receiver attribute datagrams, which only carry a hash
+    udp_stream.note_serial(node_id)
+
+    if topic.endswith("/status"):
+        handle_status_message(topic, payload)
+        return
+
+    if topic.endswith("/faults"):
+        handle_fault_message(topic, payload)
+        return
+
+    if topic.endswith("/event"):
+        handle_event_chunk(serial_from_topic(topic), payload)
+        return
+
+    if topic.endswith("/metrics"):
+        log_node_metrics(serial_from_topic(topic), payload)
+        return
+
+    if topic.endswith("/spectrum"):
+        node_analytics.note_spectrum(serial_from_topic(topic), payload)
+        return
+
+    if topic.endswith("/data"):
+        handle_data_payload(node_id, payload, recv_ns)
+
+
+def spill_message(node_id: str, topic: str | None, payload: bytes, recv_ns: int) -> None:
+    """A message over the ingest queue budget: keep data in the raw backup
+    (replay_raw.py can re-encode it), drop the rest."""
+    if topic is None or topic.endswith("/data"):
+        write_raw(node_id, payload, recv_ns)
+        ingest_stats.note_queue_spill(node_id)
 
-        topic_parts = msg.topic.split("/")
-        node_id = topic_parts[1]
 
-        register_serial(node_id)
-        write_raw(node_id, msg.payload)
+def handle_data_payload(node_id: str, payload: bytes, recv_ns: int) -> None:
+    """Store and queue one data message, from MQTT or the UDP stream."""
+    register_serial(node_id)
+    write_raw(node_id, payload, recv_ns)
 
-        data = json.loads(msg.payload.decode())
+    rx_s = recv_ns / 1e9
+    decode_start = time.monotonic()
+    binary = is_binary_payload(payload)
 
+    # Nodes send either JSON or compact binary frames ("format": "bin");
+    # a node on a congested link batches several frames per message.
+    try:
+        if binary:
+            packets = [decode_binary_payload(frame, node_id, unix_ts=True)
+                       for frame in split_binary_frames(payload)]
+        else:
+            packets = [json.loads(payload.decode())]
+    except Exception:
+        ingest_stats.note_decode_error(node_id)
+        raise
+    finally:
+        decode_s = time.monotonic() - decode_start
+        ingest.note_stage("decode", decode_s * 1000.0)
+        _DECODE_S.observe(decode_s, "binary" if binary else "json")
+
+    for data in packets:
+        ingest_stats.note_received(node_id, data, rx_s)
         if not normalise_sensor_timestamps(data, node_id):
-            return
-        
-        update_sensor_runtime(node_id, data)
+            ingest_stats.note_rejected(node_id)
+            continue
+
+        note_config_epoch(node_id, data)
+        health = update_sensor_runtime(node_id, data)
+        accel_summary.note_packet(node_id, data)
+        live_stream.note_packet(node_id, data, health)
 
+        # Refusals under the queue budget are counted by the encoder
         enqueue_packet(node_id, data)
-    except Exception as e:
-        print(f"Error processing MQTT message on {msg.topic}: {e}")
+
+
+# Messages are handled off the network threads (see ingest_pipeline.py)
+ingest = IngestPipeline(handle_message, overflow=spill_message)
+
+# Nodes switched to "transport": "udp" stream data frames by multicast;
+# everything else still arrives on MQTT. "udp_raw" adds the undecimated
+# stream, written to its own files on the receiver thread (raw_stream.py).
+udp_stream = UdpStreamReceiver(
+    on_frame=lambda serial, frame: ingest.submit(serial, None, frame, time_ns()),
+    accept_hash=ingest_partition.owns_hash if ingest_partition.PARTITION_COUNT > 1 else None,
+    on_raw_frame=write_raw_frame,
+)
 
 
 def main():
+    if ingest_partition.PARTITION_COUNT > 1:
+        print(f"[data] Ingest partition {ingest_partition.PARTITION_INDEX}"
+              f"/{ingest_partition.PARTITION_COUNT}")
     start_consumer_thread()
+    udp_stream.start()
+    metrics.start_snapshot_writer()
 
     client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2)
     client.on_connect = on_connect
     client.on_disconnect = on_disconnect
     client.on_message = on_message
     client.reconnect_delay_set(min_delay=1, max_delay=MAX_RECONNECT_DELAY_S)
+    live_stream.set_sink(lambda topic, payload: client.publish(topic, payload, qos=0))
+    set_fault_row_sink(lambda rows: client.publish(FAULT_BUS_TOPIC, json.dumps(rows), qos=1))
 
     try:
         client.connect(BROKER_IP, PORT, keepalive=KEEPALIVE_S)
@@ -163,7 +338,11 @@ def main():
         print(f"[MQTT] Fatal connection error: {e}")
         raise
     finally:
+        ingest.close()
         raw_backup_close_all()
+        raw_stream_close_all()
+        close_all_writers()
+        close_fault_store()
 
 if __name__ == "__main__":
     main()
@@ -21,16 +21,26 @@ That means every append is self-delimiting:
 - payload_len  : number of bytes in the MQTT payload
 - payload      : exact raw msg.payload bytes
 
-Usage (called from delta_encoder.py):
-    from raw_backup_binary import write_raw
+Records are written by background writer threads (see "Asynchronous
+writers" below); write_raw() only queues them.
+
+Usage (called from mqtt_listener_data.py):
+    from raw_backup import write_raw
     write_raw(node_id, msg.payload)   # bytes, called in on_message
 """
 
 import os
+import queue
 import struct
 import threading
 from datetime import datetime, timedelta
-from time import time_ns, monotonic
+from time import time_ns, monotonic, sleep
+
+import ingest_partition
+import ingest_stats
+import metrics
+import storage_catalog
+from raw_archive import RAW_INDEX_SUFFIX
 
 # -------------------------------------------------------------------
 # Configuration — must match delta_encoder.py directory layout
@@ -47,63 +57,285 @@ _CLEANUP_INTERVAL_S = 24 * 3600  # every 24 hours
 _last_cleanup_monotonic = 0.0
 
 # -------------------------------------------------------------------
-# Internal state
-#
-# _handles[node_id] = {
-#   "hour": str,      # "YYYYMMDD_HH" of the open file
-#   "file": file obj, # underlying .rawbin file
-# }
+# Asynchronous writers
 # -------------------------------------------------------------------
-_handles: dict = {}
-_lock = threading.Lock()  # guards _handles across threads
+# write_raw() runs on the paho network thread (and the UDP receiver), so
+# it must not wait for the disk: it only stamps the receive time and hands
+# the payload to the node's writer shard. Each shard is one thread that
+# owns its nodes' files outright (no lock around a handle; close_all() and
+# the monitor post control items instead, as the encoder's shards do) and
+# writes through a RAW_BUFFER_BYTES buffer. The monitor thread flushes
+# the buffers every RAW_FLUSH_INTERVAL_S and fsyncs every
+# RAW_FSYNC_INTERVAL_S, so a power cut loses at most the last few seconds
+# of raw backup instead of costing an fsync per packet.
+#
+# Each shard's queue is bounded by RAW_QUEUE_BUDGET_BYTES / RAW_WRITER_SHARDS
+# of payload. A packet that does not fit is not backed up (counted as
+# "dropped"): the network thread is never blocked by a stalled SSD.
+# Queue depth, drops, write latency (receive to buffered) and the slowest
+# fsync go to ingest_stats under "raw_backup" every RAW_REPORT_INTERVAL_S.
+RAW_WRITER_SHARDS = max(1, int(os.getenv("SHM_RAW_WRITERS", "2")))
+RAW_QUEUE_BUDGET_BYTES = int(float(os.getenv("SHM_RAW_QUEUE_MB", "32")) * 1024 * 1024)
+RAW_BUFFER_BYTES = 256 * 1024
+RAW_FLUSH_INTERVAL_S = float(os.getenv("SHM_RAW_FLUSH_S", "1"))
+RAW_FSYNC_INTERVAL_S = float(os.getenv("SHM_RAW_FSYNC_S", "5"))
+RAW_IDLE_CLOSE_S = 300.0
+RAW_REPORT_INTERVAL_S = 10.0
+_DROP_WARN_INTERVAL_S = 30.0
 
 # Record header: uint64 receive time (ns), uint32 payload length
 _HEADER_STRUCT = struct.Struct("<QI")
 
+# Control items posted to a shard queue as (None, kind, event, 0) in place
+# of (node_id, recv_ns, payload, queued_at)
+_SERVICE = "service"        # flush / fsync policy and idle close
+_CLOSE = "close"            # close all of the shard's files
+
+
+class _RawFile:
+    """One node's open .rawbin file, owned by its shard's worker."""
+
+    def __init__(self, node_id: str, hour_str: str):
+        node_dir = os.path.join(RAW_DIR, node_id)
+        os.makedirs(node_dir, exist_ok=True)
+        self.path = os.path.join(node_dir, f"{node_id}_{hour_str}.rawbin")
+        self.hour = hour_str
+        self.file = open(self.path, "ab", buffering=RAW_BUFFER_BYTES)
+        storage_catalog.note_file(self.path)
+        now = monotonic()
+        self.last_write = now
+        self.last_flush = now
+        self.last_fsync = now
+        self.unflushed = False
+        self.unsynced = False
+        print(f"[raw_backup_binary] [{node_id}] Opened {self.path}")
+
+
+class _Shard:
+    """One writer thread, its hand-off queue and the nodes pinned to it."""
+
+    def __init__(self, index: int):
+        self.index = index
+        self.queue: queue.Queue = queue.Queue()
+        self.nodes: list[str] = []
+        self.files: dict[str, _RawFile] = {}      # worker thread only
+        # Guards the counters below, shared with write_raw(); never held
+        # across I/O
+        self.lock = threading.Lock()
+        self.bytes = 0
+        self.max_depth = 0
+        self.written = 0
+        self.dropped = 0
+        self.last_drop_warn = 0.0
+        self.latency_n = 0
+        self.latency_total_ms = 0.0
+        self.latency_max_ms = 0.0
+        self.fsync_max_ms = 0.0
+        self.thread = threading.Thread(target=_shard_worker, args=(self,), daemon=True,
+                                       name=f"raw-backup-{index}")
+
+    def snapshot(self) -> dict:
+        with self.lock:
+            depth = self.queue.qsize()
+            out = {
+                "shard": self.index,
+                "nodes": list(self.nodes),
+                "depth": depth,
+                "max_depth": max(self.max_depth, depth),
+                "bytes": self.bytes,
+                "written": self.written,
+                "dropped": self.dropped,
+                "latency_ms_mean": round(self.latency_total_ms / self.latency_n, 3) if self.latency_n else None,
+                "latency_ms_max": round(self.latency_max_ms, 3),
+                "fsync_ms_max": round(self.fsync_max_ms, 3),
+            }
+            # Peaks are per report
+            self.max_depth = depth
+            self.latency_n = 0
+            self.latency_total_ms = 0.0
+            self.latency_max_ms = 0.0
+            self.fsync_max_ms = 0.0
+        return out
+
+
+_shards: list[_Shard] = []
+_node_shard: dict[str, _Shard] = {}
+_shards_guard = threading.Lock()
+_monitor_thread: threading.Thread | None = None
+# Paths of open files, for the retention cleanup
+_open_paths: set[str] = set()
+_open_paths_lock = threading.Lock()
+
+# Hot-path metrics (backend metrics.py)
+_BYTES_WRITTEN = metrics.counter(
+    "shm_raw_backup_bytes_written_total", "Bytes of raw backup records written", ("node",))
+_DROPPED = metrics.counter(
+    "shm_raw_backup_dropped_total", "Payloads not backed up over the raw backup queue budget")
+_WRITE_LATENCY_S = metrics.histogram(
+    "shm_raw_backup_write_latency_seconds", "Time from queueing a payload to its record in the buffer")
+_FSYNC_S = metrics.histogram("shm_raw_backup_fsync_seconds", "Time of one raw backup fsync")
+metrics.gauge("shm_raw_backup_queue_packets", "Payloads queued for the raw backup writers",
+              fn=lambda: sum(shard.queue.qsize() for shard in list(_shards)))
+
 
 # -------------------------------------------------------------------
 # Internal helpers
 # -------------------------------------------------------------------
 
-def _open_file(node_id: str, hour_str: str) -> dict:
-    """Open a new append-only .rawbin file and return a handle dict."""
-    node_dir = os.path.join(RAW_DIR, node_id)
-    os.makedirs(node_dir, exist_ok=True)
-    path = os.path.join(node_dir, f"{node_id}_{hour_str}.rawbin")
-    f = open(path, "ab", buffering=0)  # append-only, unbuffered binary writes
-    print(f"[raw_backup_binary] [{node_id}] Opened {path}")
-    return {"hour": hour_str, "file": f}
-
-
-def _close_handle(node_id: str, handle: dict):
+def _shard_for(node_id: str) -> _Shard:
+    """The node's shard, assigning one (and starting it) on first sight."""
+    global _monitor_thread
+    shard = _node_shard.get(node_id)
+    if shard is not None:
+        return shard
+    with _shards_guard:
+        shard = _node_shard.get(node_id)
+        if shard is not None:
+            return shard
+        if len(_shards) < RAW_WRITER_SHARDS:
+            shard = _Shard(len(_shards))
+            shard.thread.start()
+            _shards.append(shard)
+        else:
+            shard = min(_shards, key=lambda sh: len(sh.nodes))
+        shard.nodes.append(node_id)
+        _node_shard[node_id] = shard
+        if _monitor_thread is None:
+            _monitor_thread = threading.Thread(target=_monitor, daemon=True, name="raw-backup-monitor")
+            _monitor_thread.start()
+        return shard
+
+
+def _close_handle(node_id: str, handle: _RawFile):
     """Flush and close an open handle. Errors are logged, not raised."""
+    with _open_paths_lock:
+        _open_paths.discard(os.path.abspath(handle.path))
     try:
-        handle["file"].flush()
-        os.fsync(handle["file"].fileno())
-        handle["file"].close()
+        handle.file.flush()
+        os.fsync(handle.file.fileno())
+        handle.file.close()
     except Exception as e:
         print(f"[raw_backup_binary] [{node_id}] Warning: error closing file: {e}")
 
 
-def _get_file(node_id: str, hour_str: str):
+def _get_file(shard: _Shard, node_id: str, hour_str: str) -> _RawFile:
     """
-    Return the active file handle for this node+hour.
-    Opens a new file (closing the previous one) when the hour changes.
-    Thread-safe.
+    Return the active file for this node+hour. Opens a new file (closing
+    the previous one) when the hour changes. Shard worker only.
     """
-    with _lock:
-        handle = _handles.get(node_id)
+    handle = shard.files.get(node_id)
+    if handle and handle.hour == hour_str:
+        return handle
+
+    # Hour rolled over or first packet for this node
+    if handle:
+        _close_handle(node_id, handle)
+        del shard.files[node_id]
+
+    handle = _RawFile(node_id, hour_str)
+    shard.files[node_id] = handle
+    with _open_paths_lock:
+        _open_paths.add(os.path.abspath(handle.path))
+    return handle
+
+
+def _service_files(shard: _Shard, close_all: bool = False) -> None:
+    """Flush / fsync policy for the shard's files; closes idle ones (all of
+    them when close_all)."""
+    now = monotonic()
+    for node_id, handle in list(shard.files.items()):
+        if close_all or now - handle.last_write >= RAW_IDLE_CLOSE_S:
+            _close_handle(node_id, handle)
+            del shard.files[node_id]
+            continue
+        try:
+            if handle.unflushed and now - handle.last_flush >= RAW_FLUSH_INTERVAL_S:
+                handle.file.flush()
+                handle.last_flush = now
+                handle.unflushed = False
+            if handle.unsynced and now - handle.last_fsync >= RAW_FSYNC_INTERVAL_S:
+                t0 = monotonic()
+                handle.file.flush()
+                os.fsync(handle.file.fileno())
+                fsync_ms = (monotonic() - t0) * 1000.0
+                _FSYNC_S.observe(fsync_ms / 1000.0)
+                handle.last_fsync = handle.last_flush = now
+                handle.unflushed = handle.unsynced = False
+                with shard.lock:
+                    shard.fsync_max_ms = max(shard.fsync_max_ms, fsync_ms)
+        except OSError as e:
+            print(f"[raw_backup_binary] [{node_id}] Warning: flush failed: {e}")
+            _close_handle(node_id, handle)
+            del shard.files[node_id]
 
-        if handle and handle["hour"] == hour_str:
-            return handle["file"]
 
-        # Hour rolled over or first packet for this node
-        if handle:
-            _close_handle(node_id, handle)
+def _shard_worker(shard: _Shard) -> None:
+    """Shard worker: appends its nodes' payloads, in arrival order."""
+    while True:
+        node_id, recv_ns, payload, queued_at = shard.queue.get()
 
-        handle = _open_file(node_id, hour_str)
-        _handles[node_id] = handle
-        return handle["file"]
+        if node_id is None:
+            try:
+                _service_files(shard, close_all=recv_ns == _CLOSE)
+            except Exception as e:
+                print(f"[raw_backup_binary] Shard {shard.index} service error: {e}")
+            finally:
+                if payload is not None:
+                    payload.set()
+            continue
+
+        hour_str = datetime.fromtimestamp(recv_ns / 1e9).strftime("%Y%m%d_%H")
+        try:
+            handle = _get_file(shard, node_id, hour_str)
+            handle.file.write(_HEADER_STRUCT.pack(recv_ns, len(payload)))
+            handle.file.write(payload)
+            _BYTES_WRITTEN.inc(node_id, by=_HEADER_STRUCT.size + len(payload))
+            handle.last_write = monotonic()
+            handle.unflushed = handle.unsynced = True
+            storage_catalog.note_records(handle.path, 1, recv_ns // 1000, recv_ns // 1000)
+        except Exception as e:
+            print(f"[raw_backup_binary] [{node_id}] Warning: write failed: {e}")
+            handle = shard.files.pop(node_id, None)
+            if handle is not None:
+                _close_handle(node_id, handle)
+
+        latency_ms = (monotonic() - queued_at) * 1000.0
+        _WRITE_LATENCY_S.observe(latency_ms / 1000.0)
+        with shard.lock:
+            shard.bytes -= len(payload) + _HEADER_STRUCT.size
+            shard.written += 1
+            shard.latency_n += 1
+            shard.latency_total_ms += latency_ms
+            shard.latency_max_ms = max(shard.latency_max_ms, latency_ms)
+
+
+def _post_to_shards(kind: str, wait_s: float | None = None) -> None:
+    done = []
+    for shard in list(_shards):
+        event = threading.Event() if wait_s is not None else None
+        shard.queue.put((None, kind, event, 0))
+        if event is not None:
+            done.append(event)
+    for event in done:
+        event.wait(wait_s)
+
+
+def _monitor() -> None:
+    """Flush policy, retention cleanup and stats, off the write path."""
+    last_report = 0.0
+    while True:
+        try:
+            _post_to_shards(_SERVICE)
+            # Retention covers every node's files: one listener process does it
+            if ingest_partition.IS_PRIMARY:
+                _cleanup_old_raw_files()
+            now = monotonic()
+            if now - last_report >= RAW_REPORT_INTERVAL_S:
+                ingest_stats.note_raw_backup(snapshot())
+                last_report = now
+        except Exception as e:
+            print(f"[raw_backup_binary] Monitor error: {e}")
+        sleep(min(1.0, RAW_FLUSH_INTERVAL_S))
 
 
 def _parse_rawbin_hour_from_name(filename: str) -> datetime | None:
@@ -128,6 +360,43 @@ def _parse_rawbin_hour_from_name(filename: str) -> datetime | None:
         return None
 
 
+def _expired_raw_files(cutoff: datetime) -> list[str] | None:
+    """Raw backup files whose hour is before cutoff: from the storage
+    catalog, or by scanning RAW_DIR until the catalog is ready. None when
+    RAW_DIR cannot be listed."""
+    listed = storage_catalog.files_before("raw", cutoff.strftime("%Y%m%d_%H"))
+    if listed is not None:
+        return [str(path) for path in listed]
+
+    try:
+        node_dirs = list(os.scandir(RAW_DIR))
+    except FileNotFoundError:
+        return None
+    except Exception as e:
+        print(f"[raw_backup_binary] Warning: cleanup scan failed: {e}")
+        return None
+
+    expired = []
+    for node_entry in node_dirs:
+        if not node_entry.is_dir():
+            continue
+
+        try:
+            file_entries = list(os.scandir(node_entry.path))
+        except Exception as e:
+            print(f"[raw_backup_binary] Warning: cleanup scan failed for {node_entry.path}: {e}")
+            continue
+
+        for file_entry in file_entries:
+            if not file_entry.is_file():
+                continue
+
+            file_dt = _parse_rawbin_hour_from_name(file_entry.name)
+            if file_dt is not None and file_dt < cutoff:
+                expired.append(file_entry.path)
+    return expired
+
+
 def _cleanup_old_raw_files(force: bool = False) -> None:
     """
     Delete raw backup files older than the retention window.
@@ -138,123 +407,122 @@ def _cleanup_old_raw_files(force: bool = False) -> None:
     now_mono = monotonic()
     if not force and (now_mono - _last_cleanup_monotonic) < _CLEANUP_INTERVAL_S:
         return
+    _last_cleanup_monotonic = now_mono
 
     cutoff = datetime.now() - timedelta(days=RAW_RETENTION_DAYS)
+    expired = _expired_raw_files(cutoff)
+    if not expired:
+        return
+
+    with _open_paths_lock:
+        open_paths = set(_open_paths)
 
-    with _lock:
-        open_paths = {
-            os.path.abspath(handle["file"].name)
-            for handle in _handles.values()
-            if "file" in handle and not handle["file"].closed
-        }
+    deleted = []
+
+    for path in expired:
+        if os.path.abspath(path) in open_paths:
+            continue
 
         try:
-            node_dirs = list(os.scandir(RAW_DIR))
+            os.remove(path)
         except FileNotFoundError:
-            _last_cleanup_monotonic = now_mono
-            return
+            pass
         except Exception as e:
-            print(f"[raw_backup_binary] Warning: cleanup scan failed: {e}")
-            _last_cleanup_monotonic = now_mono
-            return
-
-        deleted = 0
-
-        for node_entry in node_dirs:
-            if not node_entry.is_dir():
-                continue
-
-            try:
-                file_entries = list(os.scandir(node_entry.path))
-            except Exception as e:
-                print(f"[raw_backup_binary] Warning: cleanup scan failed for {node_entry.path}: {e}")
-                continue
-
-            for file_entry in file_entries:
-                if not file_entry.is_file():
-                    continue
-
-                file_dt = _parse_rawbin_hour_from_name(file_entry.name)
-                if file_dt is None:
-                    continue
-                if file_dt >= cutoff:
-                    continue
-
-                abs_path = os.path.abspath(file_entry.path)
-                if abs_path in open_paths:
-                    continue
-
-                try:
-                    os.remove(file_entry.path)
-                    deleted += 1
-                except Exception as e:
-                    print(f"[raw_backup_binary] Warning: failed to delete old raw backup {file_entry.path}: {e}")
-
-        if deleted:
-            print(
-                f"[raw_backup_binary] Cleanup removed {deleted} raw backup file(s) "
-                f"older than {RAW_RETENTION_DAYS} days."
-            )
+            print(f"[raw_backup_binary] Warning: failed to delete old raw backup {path}: {e}")
+            continue
+        deleted.append(path)
+        try:
+            os.remove(path + RAW_INDEX_SUFFIX)   # raw_archive.py index cache
+        except FileNotFoundError:
+            pass
+        except OSError as e:
+            print(f"[raw_backup_binary] Warning: failed to delete {os.path.basename(path)}{RAW_INDEX_SUFFIX}: {e}")
 
-    _last_cleanup_monotonic = now_mono
+    storage_catalog.note_removed(deleted)
+    if deleted:
+        print(
+            f"[raw_backup_binary] Cleanup removed {len(deleted)} raw backup file(s) "
+            f"older than {RAW_RETENTION_DAYS} days."
+        )
 
 
 # -------------------------------------------------------------------
 # Public API
 # -------------------------------------------------------------------
 
-def write_raw(node_id: str, payload: bytes) -> None:
+def write_raw(node_id: str, payload: bytes, recv_ns: int | None = None) -> bool:
     """
-    Append one raw MQTT payload as a framed binary record.
+    Queue one raw MQTT payload to be appended as a framed binary record.
+    Returns False when the node's writer queue is over budget and the
+    packet was not backed up.
 
     Parameters
     ----------
     node_id : str
         Sensor node identifier (e.g. "N01").
     payload : bytes
-        The exact bytes from msg.payload — written before any decoding
+        The exact bytes from msg.payload — captured before any decoding
         or validation so that dropped packets are still captured.
+    recv_ns : int, optional
+        Receive time in Unix ns, when taken on the network thread
+        (ingest_pipeline.py); now by default.
     """
     if not isinstance(payload, (bytes, bytearray, memoryview)):
         raise TypeError("payload must be bytes-like")
 
     payload = bytes(payload)
-    recv_ns = time_ns()
-    hour_str = datetime.now().strftime("%Y%m%d_%H")
-    f = _get_file(node_id, hour_str)
-    header = _HEADER_STRUCT.pack(recv_ns, len(payload))
-
-    try:
-        f.write(header)
-        f.write(payload)
-        f.flush()
-        os.fsync(f.fileno())  # durable: survives restart/power loss after write returns
-    except Exception as e:
-        print(f"[raw_backup_binary] [{node_id}] Warning: write failed: {e}")
-
-    # Periodic retention cleanup.
-    _cleanup_old_raw_files()
+    if recv_ns is None:
+        recv_ns = time_ns()
+    shard = _shard_for(node_id)
+    size = len(payload) + _HEADER_STRUCT.size
+    now = monotonic()
+
+    with shard.lock:
+        if shard.bytes + size > RAW_QUEUE_BUDGET_BYTES // RAW_WRITER_SHARDS:
+            shard.dropped += 1
+            warn = now - shard.last_drop_warn >= _DROP_WARN_INTERVAL_S
+            if warn:
+                shard.last_drop_warn = now
+            dropped = shard.dropped
+        else:
+            shard.bytes += size
+            warn = dropped = None
+    if dropped is not None:
+        _DROPPED.inc()
+        if warn:
+            print(f"[raw_backup_binary] [{node_id}] Writer {shard.index} over budget: "
+                  f"{dropped} packet(s) not backed up so far")
+        return False
+
+    shard.queue.put((node_id, recv_ns, payload, now))
+    depth = shard.queue.qsize()
+    with shard.lock:
+        shard.max_depth = max(shard.max_depth, depth)
+    return True
 
 
 def close_all() -> None:
     """
-    Flush and close all open raw backup files.
-    Call this on clean shutdown.
+    Write out the queued records, then flush and close all open raw backup
+    files. Call this on clean shutdown.
     """
-    with _lock:
-        for node_id, handle in list(_handles.items()):
-            _close_handle(node_id, handle)
-        _handles.clear()
+    _post_to_shards(_CLOSE, wait_s=10.0)
     print("[raw_backup_binary] All handles closed.")
 
 
+def snapshot() -> list[dict]:
+    """Per-writer queue and latency stats (peaks since the last call)."""
+    return [shard.snapshot() for shard in list(_shards)]
+
+
 # -------------------------------------------------------------------
 # Optional helper for replay / inspection
 # -------------------------------------------------------------------
 
 def iter_records(path: str):
     """
-    Iterate over records in a .rawbin file.
+    Iterate over records in a .rawbin file, front to back. For a time range
+    or random access use raw_archive.RawArchiveReader (mmap + index).
 
     Yields
     ------
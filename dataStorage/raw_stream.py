@@ -0,0 +1,88 @@
+"""
+raw_stream.py
+-------------
+Writes the undecimated ADXL355 stream of nodes set to "transport": "udp_raw"
+(firmware udp_stream.h), for commissioning and dynamic tests.
+
+Every raw frame is a version 1 binary frame (binary_payload.py layout) with
+decim 1 and up to 100 samples, released in seq order by the UDP receiver.
+Frames are appended verbatim to
+
+    <DATA_DIR>/raw_stream/<serial>/<serial>_YYYYmmdd_HH.bin
+
+one file per node and UTC hour (about 170 MB an hour at 4 kHz). Read a file
+back with split_binary_frames() and decode_binary_payload(). Nothing prunes
+these files: the raw stream is switched on for a test, not left running.
+
+Usage (called from the UDP receiver thread, mqtt_listener_data.py):
+    from raw_stream import write_raw_frame
+    write_raw_frame(serial, frame)
+"""
+
+import os
+import struct
+import threading
+import time
+from datetime import datetime, timezone
+
+from binary_payload import BIN_MAGIC, BIN_VERSION
+
+RAW_STREAM_SUBDIR = "raw_stream"
+FLUSH_INTERVAL_S = 1.0
+
+_HEADER = struct.Struct("<BBBBIIIqHBBHBB")
+_SAMPLE_BYTES = 12
+
+_lock = threading.Lock()
+_files = {}         # serial -> [hour_key, file, last_flush]
+
+
+def _stream_dir(serial: str) -> str:
+    from encoder_storage import DATA_DIR
+    return os.path.join(DATA_DIR, RAW_STREAM_SUBDIR, serial)
+
+
+def _hour_key(base_utc_us: int) -> str:
+    # Unsynced node (base_utc_us 0): file by the Pi's clock
+    ts = base_utc_us / 1e6 if base_utc_us else time.time()
+    return datetime.fromtimestamp(ts, tz=timezone.utc).strftime("%Y%m%d_%H")
+
+
+def write_raw_frame(serial: str, frame: bytes) -> None:
+    """Append one raw frame to the node's current hour file."""
+    if len(frame) < _HEADER.size:
+        raise ValueError(f"raw frame too short ({len(frame)} bytes)")
+    (magic, version, _, _, _, _, _, base_utc_us, _, decim, count,
+     _, incl_n, _) = _HEADER.unpack_from(frame, 0)
+    if magic != BIN_MAGIC or version != BIN_VERSION or decim != 1 or incl_n != 0:
+        raise ValueError("not a raw ODR frame")
+    if len(frame) != _HEADER.size + count * _SAMPLE_BYTES:
+        raise ValueError(f"raw frame length {len(frame)} != expected "
+                         f"{_HEADER.size + count * _SAMPLE_BYTES}")
+
+    key = _hour_key(base_utc_us)
+    now = time.monotonic()
+    with _lock:
+        entry = _files.get(serial)
+        if entry is None or entry[0] != key:
+            if entry is not None:
+                entry[1].close()
+            directory = _stream_dir(serial)
+            os.makedirs(directory, exist_ok=True)
+            path = os.path.join(directory, f"{serial}_{key}.bin")
+            print(f"[raw_stream] {serial}: writing {path}")
+            entry = _files[serial] = [key, open(path, "ab"), now]
+        entry[1].write(frame)
+        if now - entry[2] >= FLUSH_INTERVAL_S:
+            entry[1].flush()
+            entry[2] = now
+
+
+def close_all() -> None:
+    with _lock:
+        for _, f, _ in _files.values():
+            try:
+                f.close()
+            except OSError as e:
+                print(f"[raw_stream] Close failed: {e}")
+        _files.clear()
@@ -0,0 +1,303 @@
+"""
+replay_raw.py  — rebuild hourly storage files from the raw backup
+-----------------------------------------------------------------
+Re-encodes node-hours from the .rawbin archive (raw_backup.py) into fresh
+data_{node}_{YYYYMMDD}_{HH}.bin.gz / .bin.zst files, e.g. after an encoder
+change or when a stored hour is damaged (_recover_active_hourly_file() can
+only truncate one).
+
+Each raw hour is read through the indexed reader (raw_archive.py), its
+payloads decoded exactly as the listener does (JSON or binary frames,
+normalise_sensor_timestamps()) and encoded with encoder_storage's own
+encode_packet(), so a rebuilt hour is what the live path would have written
+with the packets it dropped included. Store-and-forward packets go, as a
+self-contained ABSOLUTE record, to the hour of their own timestamp when that
+hour is rebuilt too; other hours already hold them.
+
+Node-hours are encoded and then archived on --workers processes (one per
+core by default, at lowered priority). Every output is written next to its
+target as <name>.replay, verified, and swapped in with os.replace(); an
+interrupted run leaves the stored hours as they were.
+
+The live hour is never touched. A past hour whose .bin still waits for the
+listener's archive worker is skipped unless --include-pending (stop the
+data listener first then). The plot pyramid is not rebuilt.
+
+Usage:
+    python replay_raw.py --start 2026-09-01 --end 2026-10-01
+    python replay_raw.py --start 2026-09-14T06 --end 2026-09-14T09 --node N01 --node N02
+    python replay_raw.py --start 2026-09-01 --end 2026-10-01 --dry-run
+"""
+
+import argparse, json, os, sys, time
+from concurrent.futures import ProcessPoolExecutor, as_completed
+from datetime import datetime
+from pathlib import Path
+
+try:
+    import raw_archive
+except ImportError:     # run from a checkout: the reader lives in backend/
+    sys.path.insert(0, str(Path(__file__).resolve().parents[1] / "backend"))
+    import raw_archive
+
+import encoder_storage as es
+from binary_payload import is_binary_payload, decode_binary_payload, split_binary_frames
+from raw_backup import RAW_DIR, _parse_rawbin_hour_from_name
+
+REPLAY_SUFFIX = ".replay"
+REPLAY_NICE = es.ARCHIVE_NICE
+_PROGRESS_INTERVAL_S = 5.0
+
+
+def _worker_init() -> None:
+    try:
+        os.nice(REPLAY_NICE)
+    except OSError:
+        pass
+    # Timestamps rejected again must not log their faults a second time
+    es._log_storage_fault = lambda *args, **kwargs: None
+
+
+def _decode(node_id: str, payload) -> list:
+    if is_binary_payload(payload):
+        return [decode_binary_payload(frame, node_id, unix_ts=True)
+                for frame in split_binary_frames(bytes(payload))]
+    return [json.loads(bytes(payload).decode())]
+
+
+def encode_hour(node_id: str, hour_str: str, raw_path: str) -> dict:
+    """Encode one raw node-hour into <data .bin>.replay. Worker process."""
+    bin_path = os.path.join(es.DATA_DIR, f"data_{node_id}_{hour_str}.bin")
+    out_path = bin_path + REPLAY_SUFFIX
+    result = {"node": node_id, "hour": hour_str, "bin_path": bin_path, "out_path": out_path,
+              "payloads": 0, "packets": 0, "decode_errors": 0, "rejected": 0,
+              "raw_bytes": 0, "bytes": 0, "entries": [], "replayed": []}
+    state = es._fresh_state()
+
+    with raw_archive.RawArchiveReader(raw_path) as reader, \
+            open(out_path, "wb", buffering=es.WRITER_BUFFER_BYTES) as out:
+        out.write(bytes([es.FILE_FORMAT_VERSION]))
+        for _, payload in reader.iter_range():
+            result["payloads"] += 1
+            result["raw_bytes"] += len(payload)
+            try:
+                packets = _decode(node_id, payload)
+            except Exception:
+                result["decode_errors"] += 1
+                continue
+            for data in packets:
+                if not es.normalise_sensor_timestamps(data, node_id):
+                    result["rejected"] += 1
+                    continue
+                result["packets"] += 1
+                first_us, last_us = es._packet_ts_range_us(data)
+                flags = es._record_sensor_flags(data)
+
+                if data.get("replayed"):
+                    ts_us = es._packet_max_ts_us(data)
+                    if not ts_us:
+                        continue
+                    target_hour, _ = es.get_hourly_filepath_for_ts(node_id, ts_us / es.TS_SCALE)
+                    record = es.encode_replayed_record(data)
+                    result["replayed"].append((target_hour, record, first_us, last_us,
+                                               flags | es.INDEX_REPLAYED))
+                    continue
+
+                record, absolute, _ = es.encode_packet(data, state)
+                offset = out.tell()
+                out.write(record)
+                if absolute:
+                    result["entries"].append((offset, first_us, last_us, flags))
+        result["bytes"] = out.tell()
+    return result
+
+
+def _append_replayed(result: dict, replayed: list) -> None:
+    # Store-and-forward records of other raw hours that belong in this one
+    with open(result["out_path"], "ab") as out:
+        for _, record, first_us, last_us, flags in replayed:
+            result["entries"].append((out.tell(), first_us, last_us, flags))
+            out.write(record)
+        result["bytes"] = out.tell()
+
+
+def archive_hour(result: dict, dry_run: bool) -> dict:
+    """Archive a rebuilt hour and swap it in. Worker process."""
+    bin_path, out_path = result["bin_path"], result["out_path"]
+    # Keep the codec the hour is archived with
+    codec = es.ARCHIVE_CODEC
+    for name, suffix in es.ARCHIVE_SUFFIXES.items():
+        if os.path.exists(bin_path + suffix):
+            codec = name
+            break
+    archive_path = bin_path + es.ARCHIVE_SUFFIXES[codec]
+    tmp_path = archive_path + REPLAY_SUFFIX
+    entries = [e for e in result["entries"] if 0 < e[0] < result["bytes"]]
+    try:
+        if codec == "zstd":
+            out_entries = es._archive_zstd(out_path, tmp_path, entries, result["bytes"])
+        else:
+            out_entries = es._archive_gzip(out_path, tmp_path, entries, result["bytes"])
+        if not es._verify_archive(codec, out_path, tmp_path, result["bytes"]):
+            raise OSError(f"{os.path.basename(tmp_path)} does not match the re-encoded hour")
+        result["archive_path"] = archive_path
+        result["archive_bytes"] = os.path.getsize(tmp_path)
+        if dry_run:
+            return result
+
+        # Old index first: a reader in between scans the file instead of
+        # seeking with stale offsets
+        es._remove_index(archive_path)
+        os.replace(tmp_path, archive_path)
+        if out_entries:
+            es._write_index_file(archive_path + es.INDEX_SUFFIX, out_entries)
+        if os.path.exists(bin_path):
+            os.remove(bin_path)
+            es._remove_index(bin_path)
+    finally:
+        for path in (out_path, tmp_path):
+            try:
+                os.remove(path)
+            except FileNotFoundError:
+                pass
+    return result
+
+
+def _parse_hour(value: str) -> datetime:
+    for fmt in ("%Y-%m-%dT%H", "%Y-%m-%d"):
+        try:
+            return datetime.strptime(value, fmt)
+        except ValueError:
+            pass
+    raise argparse.ArgumentTypeError(f"expected YYYY-MM-DD or YYYY-MM-DDTHH, got {value!r}")
+
+
+def find_jobs(start: datetime, end: datetime, nodes: list, include_pending: bool) -> tuple[list, list]:
+    """(node, hour_str, raw_path) to rebuild in [start, end), and the hours skipped."""
+    live_hour = datetime.now().strftime("%Y%m%d_%H")
+    jobs, skipped = [], []
+    for node_entry in sorted(os.scandir(RAW_DIR), key=lambda e: e.name):
+        if not node_entry.is_dir() or (nodes and node_entry.name not in nodes):
+            continue
+        for file_entry in sorted(os.scandir(node_entry.path), key=lambda e: e.name):
+            file_dt = _parse_rawbin_hour_from_name(file_entry.name)
+            if file_dt is None or not start <= file_dt < end:
+                continue
+            hour_str = file_dt.strftime("%Y%m%d_%H")
+            bin_path = os.path.join(es.DATA_DIR, f"data_{node_entry.name}_{hour_str}.bin")
+            if hour_str >= live_hour:
+                skipped.append((node_entry.name, hour_str, "live hour"))
+            elif os.path.exists(bin_path) and not include_pending:
+                skipped.append((node_entry.name, hour_str, "awaiting the archive worker"))
+            else:
+                jobs.append((node_entry.name, hour_str, file_entry.path))
+    return jobs, skipped
+
+
+class _Progress:
+    def __init__(self, label: str, total: int):
+        self.label = label
+        self.total = total
+        self.done = 0
+        self.raw_bytes = 0
+        self.t0 = self.last = time.monotonic()
+
+    def step(self, raw_bytes: int = 0) -> None:
+        self.done += 1
+        self.raw_bytes += raw_bytes
+        now = time.monotonic()
+        if now - self.last < _PROGRESS_INTERVAL_S and self.done < self.total:
+            return
+        self.last = now
+        elapsed = now - self.t0
+        eta = elapsed / self.done * (self.total - self.done)
+        rate = f", {self.raw_bytes / elapsed / 1e6:.1f} MB/s raw" if self.raw_bytes else ""
+        print(f"[replay] {self.label} {self.done}/{self.total} node-hours{rate}, "
+              f"{elapsed:.0f} s elapsed, ~{eta:.0f} s left", flush=True)
+
+
+def main():
+    p = argparse.ArgumentParser(description="Rebuild hourly storage files from the raw backup")
+    p.add_argument("--start",   type=_parse_hour, required=True, help="first hour (local), YYYY-MM-DD[THH]")
+    p.add_argument("--end",     type=_parse_hour, required=True, help="end hour (local, exclusive)")
+    p.add_argument("--node",    action="append", default=[], help="node id (repeatable; default all)")
+    p.add_argument("--workers", type=int, default=os.cpu_count() or 1)
+    p.add_argument("--include-pending", action="store_true",
+                   help="also rebuild past hours still stored as .bin (listener stopped)")
+    p.add_argument("--dry-run", action="store_true", help="encode and archive, but keep the stored hours")
+    args = p.parse_args()
+
+    jobs, skipped = find_jobs(args.start, args.end, args.node, args.include_pending)
+    for node_id, hour_str, why in skipped:
+        print(f"[replay] Skipping {node_id} {hour_str}: {why}")
+    if not jobs:
+        print("[replay] Nothing to rebuild.")
+        return
+    print(f"[replay] Rebuilding {len(jobs)} node-hours on {args.workers} workers"
+          + (" (dry run)" if args.dry_run else ""))
+
+    totals = {"payloads": 0, "packets": 0, "decode_errors": 0, "rejected": 0,
+              "bytes": 0, "archive_bytes": 0, "failed": 0}
+    results = {}
+    with ProcessPoolExecutor(max_workers=max(1, args.workers), initializer=_worker_init) as pool:
+        progress = _Progress("encoded", len(jobs))
+        futures = {pool.submit(encode_hour, *job): job for job in jobs}
+        for future in as_completed(futures):
+            node_id, hour_str, _ = futures[future]
+            try:
+                result = future.result()
+            except Exception as e:
+                print(f"[replay] {node_id} {hour_str}: encoding failed: {e}")
+                totals["failed"] += 1
+                progress.step()
+                continue
+            results[(node_id, hour_str)] = result
+            progress.step(result["raw_bytes"])
+
+        # Store-and-forward records to the rebuilt hour of their timestamp
+        moved = 0
+        for (node_id, _), result in sorted(results.items()):
+            by_hour = {}
+            for item in result.pop("replayed"):
+                by_hour.setdefault(item[0], []).append(item)
+            for target_hour, items in by_hour.items():
+                target = results.get((node_id, target_hour))
+                if target is not None:
+                    _append_replayed(target, items)
+                    moved += len(items)
+        if moved:
+            print(f"[replay] {moved} store-and-forward records merged into their hours")
+
+        progress = _Progress("archived", len(results))
+        futures = {}
+        for key, result in results.items():
+            if result["packets"] == 0:
+                # Nothing decodable: keep what is stored
+                os.remove(result["out_path"])
+                print(f"[replay] {key[0]} {key[1]}: no packets, kept as stored")
+                progress.step()
+                continue
+            futures[pool.submit(archive_hour, result, args.dry_run)] = key
+        for future in as_completed(futures):
+            node_id, hour_str = futures[future]
+            try:
+                result = future.result()
+            except Exception as e:
+                print(f"[replay] {node_id} {hour_str}: archive / swap failed, kept as stored: {e}")
+                totals["failed"] += 1
+                progress.step()
+                continue
+            for key in ("payloads", "packets", "decode_errors", "rejected", "bytes", "archive_bytes"):
+                totals[key] += result.get(key, 0)
+            progress.step()
+
+    print(f"[replay] Done: {totals['packets']:,} packets from {totals['payloads']:,} raw payloads "
+          f"({totals['decode_errors']} undecodable, {totals['rejected']} rejected), "
+          f"{totals['bytes']:,} bytes encoded, {totals['archive_bytes']:,} archived, "
+          f"{totals['failed']} node-hours failed")
+    if totals["failed"]:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,352 @@
+"""
+test_encoder_equivalence.py
+---------------------------
+Checks that the column-wise accel/inclin encoders in encoder_storage.py
+(_encode_abs_block, _encode_delta_block, _first_int16_clip) write exactly
+what the former per-sample encoder wrote.
+
+The per-sample encode_first_record / encode_delta_record /
+needs_absolute_record are kept below as the reference. Seeded random packets
+are fed through both, and every packet compares:
+
+  - the ABSOLUTE reason from needs_absolute_record(),
+  - the bytes of an ABSOLUTE and of a DELTA record of the packet,
+  - the state (ts_us / xyz_prev / val_prev) after each encode.
+
+The packets cover NaN components, int16 clips, sub-threshold deltas,
+repeated timestamps and timestamp gaps.
+
+Usage:
+    python test_encoder_equivalence.py
+    python test_encoder_equivalence.py --seed 7 --packets 20000
+    python -m pytest test_encoder_equivalence.py
+"""
+
+import argparse, copy, math, random, struct, sys
+from pathlib import Path
+
+try:
+    import fault_logger  # noqa: F401
+except ImportError:     # run from a checkout: shared modules live in backend/
+    sys.path.insert(0, str(Path(__file__).resolve().parents[1] / "backend"))
+
+import encoder_storage as es
+
+DEFAULT_SEED = 20260415
+DEFAULT_PACKETS = 3000
+
+
+# -------------------------------------------------------------------
+# Reference: the per-sample encoder the column path replaced
+# -------------------------------------------------------------------
+
+_SENSORS = (
+    ("a", "accel", es.ACCEL_SCALE, ("x", "y", "z")),
+    ("i", "inclin", es.INCLIN_SCALE, ("roll", "pitch", "yaw")),
+)
+
+
+def ref_needs_absolute_record(data: dict, state: dict) -> tuple[bool, str]:
+    for key, label, scale, names in _SENSORS:
+        if key not in data or len(data[key]) == 0:
+            continue
+        ts_s = float(data[key][0][0])
+        gap = ts_s - state[label]["ts_us"] / es.TS_SCALE
+        if abs(gap) > es.MAX_DELTA_S:
+            return True, f"{label} timestamp gap {gap:.1f} s"
+
+        prev = list(state[label]["xyz_prev"])
+        for s in data[key]:
+            for idx, raw in enumerate((s[1], s[2], s[3])):
+                if es._is_nan_value(raw):
+                    continue
+                cur = int(float(raw) * scale)
+                d = cur - prev[idx]
+                if abs(d) >= es.INT16_MAX:
+                    return True, f"{label} {names[idx]} delta {d} would clip int16"
+                prev[idx] = cur
+
+    if "T" in data:
+        ts_s = float(data["T"][0])
+        ts_us_new = int(ts_s * es.TS_SCALE)
+        if ts_us_new != state["temp"]["ts_us"]:
+            gap = ts_s - state["temp"]["ts_us"] / es.TS_SCALE
+            if abs(gap) > es.MAX_DELTA_S:
+                return True, f"temp timestamp gap {gap:.1f} s"
+        if len(data["T"]) > 1 and not es._is_nan_value(data["T"][1]):
+            d = int(float(data["T"][1]) * es.TEMP_SCALE) - state["temp"]["val_prev"]
+            if abs(d) >= es.INT16_MAX:
+                return True, f"temp delta {d} would clip int16"
+
+    return False, ""
+
+
+def _ref_abs_block(samples: list, scale: int, ss: dict) -> bytes:
+    body = bytearray(struct.pack("<B", len(samples)))
+    prev = list(ss["xyz_prev"])
+    for s in samples:
+        values = [es._encode_abs_component(s[k], scale) for k in (1, 2, 3)]
+        body += es._abs_ts_bytes(float(s[0]), ss)
+        body += struct.pack("<iii", *(v for v, _ in values))
+        for axis, (v, have) in enumerate(values):
+            if have:
+                prev[axis] = v
+    ss["xyz_prev"] = prev
+    return bytes(body)
+
+
+def _ref_delta_block(samples: list, scale: int, ss: dict) -> bytes:
+    body = bytearray(struct.pack("<B", len(samples)))
+    prev = list(ss["xyz_prev"])
+    for s in samples:
+        ts_us_new = int(float(s[0]) * es.TS_SCALE)
+        delta_us = ts_us_new - ss["ts_us"]
+        changed = es.CHANGED_TS if delta_us != 0 else 0
+        deltas = [0, 0, 0]
+        nans = [es._is_nan_value(s[k]) for k in (1, 2, 3)]
+        for axis, (bit, nan_bit) in enumerate((
+            (es.CHANGED_X, es.CHANGED_NAN_X),
+            (es.CHANGED_Y, es.CHANGED_NAN_Y),
+            (es.CHANGED_Z, es.CHANGED_NAN_Z),
+        )):
+            if nans[axis]:
+                changed |= nan_bit
+                continue
+            cur = int(float(s[axis + 1]) * scale)
+            deltas[axis] = es._apply_null_threshold(cur - prev[axis])
+            if deltas[axis] != 0:
+                changed |= bit
+
+        body += struct.pack("<B", changed)
+        if changed & es.CHANGED_TS:
+            body += struct.pack("<i", delta_us)
+        for axis, bit in enumerate((es.CHANGED_X, es.CHANGED_Y, es.CHANGED_Z)):
+            if changed & bit:
+                body += es._pack_delta(deltas[axis])
+
+        ss["ts_us"] = ts_us_new
+        for axis in range(3):
+            if not nans[axis]:
+                prev[axis] += deltas[axis]
+    ss["xyz_prev"] = prev
+    return bytes(body)
+
+
+def ref_encode_first_record(data: dict, state: dict) -> bytes:
+    header = 0
+    body = bytearray()
+    for bit, (key, label, scale, _) in zip((0x01, 0x02), _SENSORS):
+        if key in data and len(data[key]) > 0:
+            header |= bit
+            body += _ref_abs_block(data[key], scale, state[label])
+
+    if "T" in data:
+        header |= 0x04
+        tv = data["T"]
+        vi, have_val = es._encode_abs_component(tv[1], es.TEMP_SCALE)
+        body += es._abs_ts_bytes(float(tv[0]), state["temp"])
+        body += struct.pack("<i", vi)
+        if have_val:
+            state["temp"]["val_prev"] = vi
+
+    return struct.pack("<BB", 0xFF, header) + bytes(body)
+
+
+def ref_encode_delta_record(data: dict, state: dict) -> bytes:
+    header = 0
+    body = bytearray()
+    for bit, (key, label, scale, _) in zip((0x01, 0x02), _SENSORS):
+        if key in data and len(data[key]) > 0:
+            header |= bit
+            body += _ref_delta_block(data[key], scale, state[label])
+
+    if "T" in data:
+        tv = data["T"]
+        ss = state["temp"]
+        ts_us_new = int(float(tv[0]) * es.TS_SCALE)
+        delta_us = ts_us_new - ss["ts_us"]
+        val_is_nan = es._is_nan_value(tv[1])
+
+        changed = es.CHANGED_TS if delta_us != 0 else 0
+        dt = 0
+        if val_is_nan:
+            changed |= es.CHANGED_NAN_TEMP
+        else:
+            dt = es._apply_null_threshold(int(float(tv[1]) * es.TEMP_SCALE) - ss["val_prev"])
+            if dt != 0:
+                changed |= es.CHANGED_X
+
+        ss["ts_us"] = ts_us_new
+        if changed != 0:
+            header |= 0x04
+            body += struct.pack("<B", changed)
+            if changed & es.CHANGED_TS:
+                body += struct.pack("<i", delta_us)
+            if changed & es.CHANGED_X:
+                body += es._pack_delta(dt)
+            if not val_is_nan:
+                ss["val_prev"] += dt
+
+    return struct.pack("<B", header) + bytes(body)
+
+
+# -------------------------------------------------------------------
+# Random packets
+# -------------------------------------------------------------------
+
+class _Stream:
+    """One node's random walk: accel in g, inclin in degrees, temp in °C."""
+
+    def __init__(self, rng: random.Random):
+        self.rng = rng
+        self.ts = 1_736_942_096.0
+        self.accel = [0.01, -0.02, 1.0]
+        self.inclin = [0.5, -1.2, 30.0]
+        self.temp = 21.5
+
+    def _value(self, cur: list, axis: int, scale: int) -> float:
+        r = self.rng.random()
+        if r < 0.05:
+            return math.nan
+        if r < 0.0505:
+            # Jump far enough to clip an int16 delta
+            cur[axis] += self.rng.choice((-1, 1)) * self.rng.uniform(3.3, 6.0) * 10000 / scale
+        elif r < 0.35:
+            # Within DELTA_NULL_THRESHOLD counts: nulled by the delta encoder
+            cur[axis] += self.rng.choice((-1, 0, 1)) / scale
+        else:
+            cur[axis] += self.rng.gauss(0.0, 0.002 * 10000 / scale)
+        return cur[axis]
+
+    def _samples(self, n: int, cur: list, scale: int, step_s: float) -> list:
+        out = []
+        for _ in range(n):
+            r = self.rng.random()
+            if r < 0.15:
+                pass                    # repeated timestamp
+            elif r < 0.17:
+                self.ts -= step_s       # out of order
+            else:
+                self.ts += step_s
+            out.append([round(self.ts, 6)] + [self._value(cur, k, scale) for k in range(3)])
+        return out
+
+    def packet(self) -> dict:
+        r = self.rng.random()
+        if r < 0.02:
+            self.ts += self.rng.uniform(61.0, 600.0)
+        elif r < 0.03:
+            self.ts -= self.rng.uniform(61.0, 120.0)
+
+        data = {}
+        if self.rng.random() < 0.95:
+            data["a"] = self._samples(self.rng.randint(1, 200), self.accel, es.ACCEL_SCALE, 0.005)
+        if self.rng.random() < 0.6:
+            data["i"] = self._samples(self.rng.randint(1, 20), self.inclin, es.INCLIN_SCALE, 0.1)
+        if self.rng.random() < 0.5:
+            r = self.rng.random()
+            if r < 0.1:
+                value = math.nan
+            else:
+                self.temp += self.rng.choice((0.0, 0.001, 0.05, -0.05, 400.0 if r > 0.98 else 0.0))
+                value = self.temp
+            data["T"] = [round(self.ts, 6), value]
+        return data
+
+
+# -------------------------------------------------------------------
+# Comparison
+# -------------------------------------------------------------------
+
+def _sensor_state(state: dict) -> dict:
+    return {k: state[k] for k in ("accel", "inclin", "temp")}
+
+
+def run(seed: int = DEFAULT_SEED, packets: int = DEFAULT_PACKETS) -> dict:
+    """Compare both encoders over `packets` packets; raises AssertionError
+    on the first difference. Returns counts of what was exercised."""
+    rng = random.Random(seed)
+    stream = _Stream(rng)
+    ref_state = es._fresh_state()
+    new_state = es._fresh_state()
+    counts = {"packets": 0, "absolute": 0, "clip_reasons": 0, "gap_reasons": 0,
+              "nan": 0, "samples": 0}
+
+    for n in range(packets):
+        data = stream.packet()
+        if not data:
+            continue
+        where = f"seed {seed}, packet {n}"
+
+        ref_abs, ref_reason = ref_needs_absolute_record(data, ref_state)
+        new_data = copy.deepcopy(data)      # the new path caches columns on the packet
+        new_abs, new_reason = es.needs_absolute_record(new_data, new_state)
+        assert (ref_abs, ref_reason) == (new_abs, new_reason), \
+            f"{where}: reason {ref_reason!r} != {new_reason!r}"
+
+        # Both record types from the same state, so the DELTA path also sees
+        # the clipping packets that would have gone out as ABSOLUTE. A
+        # timestamp gap does not fit delta_ts: both must refuse it.
+        for ref_fn, new_fn, kind in (
+            (ref_encode_first_record, es.encode_first_record, "ABSOLUTE"),
+            (ref_encode_delta_record, es.encode_delta_record, "DELTA"),
+        ):
+            ref_s = copy.deepcopy(ref_state)
+            new_s = copy.deepcopy(new_state)
+            try:
+                ref_bytes = ref_fn(data, ref_s)
+            except struct.error:
+                try:
+                    new_fn(new_data, new_s)
+                except struct.error:
+                    continue
+                raise AssertionError(f"{where}: {kind} encoded a packet the reference refused")
+            new_bytes = new_fn(new_data, new_s)
+            assert ref_bytes == new_bytes, f"{where}: {kind} record bytes differ"
+            assert _sensor_state(ref_s) == _sensor_state(new_s), \
+                f"{where}: state after {kind} differs: {_sensor_state(ref_s)} != {_sensor_state(new_s)}"
+
+        # Advance the way encode_packet() would
+        absolute = ref_abs or n % 50 == 0
+        if absolute:
+            ref_encode_first_record(data, ref_state)
+            es.encode_first_record(new_data, new_state)
+        else:
+            ref_encode_delta_record(data, ref_state)
+            es.encode_delta_record(new_data, new_state)
+        assert _sensor_state(ref_state) == _sensor_state(new_state), f"{where}: state differs"
+
+        counts["packets"] += 1
+        counts["absolute"] += absolute
+        counts["clip_reasons"] += "clip" in ref_reason
+        counts["gap_reasons"] += "gap" in ref_reason
+        for key in ("a", "i"):
+            for s in data.get(key, ()):
+                counts["samples"] += 1
+                counts["nan"] += any(es._is_nan_value(v) for v in s[1:])
+    return counts
+
+
+def test_encoder_equivalence():
+    counts = run()
+    # The generator must actually reach the paths under test
+    assert counts["clip_reasons"] > 0 and counts["gap_reasons"] > 0 and counts["nan"] > 0
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip())
+    parser.add_argument("--seed", type=int, default=DEFAULT_SEED)
+    parser.add_argument("--packets", type=int, default=DEFAULT_PACKETS)
+    args = parser.parse_args()
+
+    try:
+        counts = run(args.seed, args.packets)
+    except AssertionError as e:
+        print(f"FAIL: {e}")
+        return 1
+    print("OK: " + ", ".join(f"{k} {v}" for k, v in counts.items()))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,295 @@
+"""
+udp_receiver.py
+---------------
+Receiver for the optional UDP multicast data stream (firmware udp_stream.h).
+
+A node configured with "transport": "udp" sends each binary sensor frame
+(binary_payload.py layout) as one or more datagrams to UDP_GROUP:UDP_PORT
+instead of publishing it on wind_turbine/<serial>/data. Commands, status and
+faults stay on MQTT.
+
+"transport": "udp_raw" adds the undecimated ADXL355 stream: version 1 frames
+with decim 1 and up to 100 raw samples each, their own frame seq, in
+datagrams tagged UDP_MAGIC_RAW with their own dgram_seq. They go to
+on_raw_frame (raw_stream.py), not into the ingest path.
+
+Datagram layout (little-endian):
+    u8  magic        0xB6 (data frame) or 0xB7 (raw ODR frame)
+    u8  version      1
+    u8  frag_index
+    u8  frag_count
+    u32 serial_hash  FNV-1a of the node serial, as in the frame header
+    u32 dgram_seq    +1 per datagram; fragments of a frame are consecutive
+    u16 frame_len
+    u16 frag_offset
+    ... fragment bytes
+
+Per node and stream (data or raw) the receiver
+  - counts loss from dgram_seq: lost = datagrams spanned - datagrams received,
+    so a late (reordered) datagram is not counted twice,
+  - reassembles fragments, dropping frames still incomplete after
+    REASSEMBLY_TIMEOUT_S,
+  - holds complete frames in a small reorder buffer keyed by the frame seq
+    and releases them in order once REORDER_DEPTH frames are waiting or the
+    oldest has waited REORDER_TIMEOUT_S.
+
+Datagrams only carry the serial hash, so the listener reports every serial
+it sees on MQTT through note_serial(); frames from an unknown hash are
+counted and dropped until the node's status or faults arrive.
+
+With partitioned ingest (ingest_partition.py) every listener process joins
+the group (SO_REUSEADDR: each socket gets every datagram) and accept_hash
+drops the other partitions' nodes right after the header check.
+"""
+
+import socket
+import struct
+import threading
+import time
+
+from binary_payload import fnv1a32
+
+UDP_GROUP = "239.255.42.1"
+UDP_PORT = 5010
+UDP_IFACE_IP = "0.0.0.0"           # Join on every interface
+
+UDP_MAGIC = 0xB6
+UDP_MAGIC_RAW = 0xB7
+UDP_VERSION = 1
+UDP_HEADER = struct.Struct("<BBBBIIHH")
+
+REASSEMBLY_TIMEOUT_S = 1.0
+REORDER_DEPTH = 8
+REORDER_TIMEOUT_S = 0.5
+STATS_INTERVAL_S = 60.0
+RESTART_BACKSTEP = 1024            # dgram_seq this far back means a reboot
+
+_FRAME_SEQ = struct.Struct("<I")
+_FRAME_SEQ_OFFSET = 8              # seq field of the binary frame header
+
+
+def _stream_name(key: tuple) -> str:
+    serial, raw = key
+    return f"{serial}/raw" if raw else serial
+
+
+def _seq_after(a: int, b: int) -> bool:
+    """True if 32-bit sequence a comes after b (wrap-safe)."""
+    return 0 < ((a - b) & 0xFFFFFFFF) < 0x80000000
+
+
+class _NodeStream:
+    """Reassembly, reorder buffer and counters for one node."""
+
+    def __init__(self):
+        self.first_dgram = None
+        self.high_dgram = None
+        self.received = 0
+        self.reordered = 0
+        self.frames_out = 0
+        self.frames_expired = 0
+        self.frame_gaps = 0
+        self.partial = {}          # first dgram_seq -> [frame_len, {offset: bytes}, t]
+        self.ready = {}            # frame seq -> (frame, t)
+        self.next_frame = None
+
+    def lost(self) -> int:
+        if self.first_dgram is None:
+            return 0
+        span = ((self.high_dgram - self.first_dgram) & 0xFFFFFFFF) + 1
+        return max(0, span - self.received)
+
+    def is_restart(self, seq: int) -> bool:
+        """A datagram far behind the newest one: the node rebooted."""
+        return (self.high_dgram is not None and
+                ((self.high_dgram - seq) & 0xFFFFFFFF) > RESTART_BACKSTEP
+                and not _seq_after(seq, self.high_dgram))
+
+    def note_dgram(self, seq: int) -> None:
+        self.received += 1
+        if self.first_dgram is None:
+            self.first_dgram = self.high_dgram = seq
+        elif _seq_after(seq, self.high_dgram):
+            self.high_dgram = seq
+        else:
+            self.reordered += 1
+
+    def add_fragment(self, dgram_seq, frag_index, frag_count, frame_len, offset, data, now):
+        if frag_count == 1:
+            return data if len(data) == frame_len else None
+
+        key = (dgram_seq - frag_index) & 0xFFFFFFFF
+        entry = self.partial.setdefault(key, [frame_len, {}, now])
+        entry[1][offset] = data
+        if len(entry[1]) < frag_count:
+            return None
+
+        del self.partial[key]
+        frame = b"".join(entry[1][o] for o in sorted(entry[1]))
+        return frame if len(frame) == frame_len else None
+
+    def expire_partial(self, now) -> None:
+        for key in [k for k, e in self.partial.items() if now - e[2] > REASSEMBLY_TIMEOUT_S]:
+            del self.partial[key]
+            self.frames_expired += 1
+
+    def push_frame(self, frame: bytes, now) -> None:
+        if len(frame) < _FRAME_SEQ_OFFSET + 4:
+            return
+        (seq,) = _FRAME_SEQ.unpack_from(frame, _FRAME_SEQ_OFFSET)
+        if (self.next_frame is not None and
+                not _seq_after(seq, (self.next_frame - 1) & 0xFFFFFFFF)):
+            return                 # Older than what was already released
+        self.ready[seq] = (frame, now)
+
+    def _earliest_ready(self) -> int:
+        best = None
+        for seq in self.ready:
+            if best is None or _seq_after(best, seq):
+                best = seq
+        return best
+
+    def pop_ready(self, now) -> list[bytes]:
+        """Release frames in seq order; skip a missing seq once it is overdue."""
+        out = []
+        while self.ready:
+            if self.next_frame is not None and self.next_frame in self.ready:
+                seq = self.next_frame
+            else:
+                oldest_t = min(t for _, t in self.ready.values())
+                if len(self.ready) < REORDER_DEPTH and now - oldest_t < REORDER_TIMEOUT_S:
+                    break
+                seq = self._earliest_ready()
+                if self.next_frame is not None:
+                    self.frame_gaps += (seq - self.next_frame) & 0xFFFFFFFF
+            frame, _ = self.ready.pop(seq)
+            self.next_frame = (seq + 1) & 0xFFFFFFFF
+            self.frames_out += 1
+            out.append(frame)
+        return out
+
+
+class UdpStreamReceiver:
+    """Multicast listener thread; calls on_frame(serial, frame_bytes) in order,
+    and on_raw_frame(serial, frame_bytes) for the raw ODR stream (dropped
+    when None)."""
+
+    def __init__(self, on_frame, group: str = UDP_GROUP, port: int = UDP_PORT,
+                 iface_ip: str = UDP_IFACE_IP, accept_hash=None, on_raw_frame=None):
+        self.on_frame = on_frame
+        self.on_raw_frame = on_raw_frame
+        self.accept_hash = accept_hash
+        self.group = group
+        self.port = port
+        self.iface_ip = iface_ip
+        self._serials = {}
+        self._unknown = {}
+        self._nodes = {}           # (serial, raw) -> _NodeStream
+        self._lock = threading.Lock()
+        self._thread = None
+        self._last_stats = time.monotonic()
+
+    def note_serial(self, serial: str) -> None:
+        """Register a serial seen on MQTT so its datagrams can be attributed."""
+        h = fnv1a32(serial)
+        with self._lock:
+            if h not in self._serials:
+                self._serials[h] = serial
+
+    def start(self) -> threading.Thread:
+        if self._thread is not None and self._thread.is_alive():
+            return self._thread
+        self._thread = threading.Thread(target=self._run, daemon=True, name="udp-stream-rx")
+        self._thread.start()
+        return self._thread
+
+    def _open_socket(self) -> socket.socket:
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4 * 1024 * 1024)
+        sock.bind(("", self.port))
+        mreq = socket.inet_aton(self.group) + socket.inet_aton(self.iface_ip)
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+        sock.settimeout(REORDER_TIMEOUT_S / 2)
+        return sock
+
+    def _run(self) -> None:
+        try:
+            sock = self._open_socket()
+        except OSError as e:
+            print(f"[udp] Could not join {self.group}:{self.port}: {e}")
+            return
+        print(f"[udp] Listening on {self.group}:{self.port}")
+
+        while True:
+            try:
+                datagram = sock.recv(65535)
+            except socket.timeout:
+                datagram = None
+            except OSError as e:
+                print(f"[udp] Receive error: {e}")
+                time.sleep(1.0)
+                continue
+
+            now = time.monotonic()
+            if datagram is not None:
+                self._handle_datagram(datagram, now)
+            self._flush(now)
+
+            if now - self._last_stats >= STATS_INTERVAL_S:
+                self._last_stats = now
+                self._print_stats()
+
+    def _handle_datagram(self, datagram: bytes, now: float) -> None:
+        if len(datagram) < UDP_HEADER.size:
+            return
+        (magic, version, frag_index, frag_count, serial_hash, dgram_seq,
+         frame_len, offset) = UDP_HEADER.unpack_from(datagram, 0)
+        if magic not in (UDP_MAGIC, UDP_MAGIC_RAW) or version != UDP_VERSION \
+                or frag_index >= frag_count:
+            return
+        raw = magic == UDP_MAGIC_RAW
+        if raw and self.on_raw_frame is None:
+            return
+        if self.accept_hash is not None and not self.accept_hash(serial_hash):
+            return
+
+        with self._lock:
+            serial = self._serials.get(serial_hash)
+        if serial is None:
+            n = self._unknown.get(serial_hash, 0)
+            if n == 0:
+                print(f"[udp] Datagrams from unknown node hash 0x{serial_hash:08x} "
+                      f"(waiting for its MQTT status)")
+            self._unknown[serial_hash] = n + 1
+            return
+
+        key = (serial, raw)
+        stream = self._nodes.setdefault(key, _NodeStream())
+        if stream.is_restart(dgram_seq):
+            print(f"[udp] {_stream_name(key)}: sequence restarted (node rebooted?), "
+                  f"lost={stream.lost()} before restart")
+            stream = self._nodes[key] = _NodeStream()
+        stream.note_dgram(dgram_seq)
+        frame = stream.add_fragment(dgram_seq, frag_index, frag_count, frame_len,
+                                    offset, datagram[UDP_HEADER.size:], now)
+        if frame is not None:
+            stream.push_frame(frame, now)
+
+    def _flush(self, now: float) -> None:
+        for (serial, raw), stream in self._nodes.items():
+            stream.expire_partial(now)
+            handler = self.on_raw_frame if raw else self.on_frame
+            for frame in stream.pop_ready(now):
+                try:
+                    handler(serial, frame)
+                except Exception as e:
+                    print(f"[udp] Error handling frame from {_stream_name((serial, raw))}: {e}")
+
+    def _print_stats(self) -> None:
+        for key, s in self._nodes.items():
+            total = s.received + s.lost()
+            loss_pct = 100.0 * s.lost() / total if total else 0.0
+            print(f"[udp] {_stream_name(key)}: rx={s.received} lost={s.lost()} ({loss_pct:.2f}%) "
+                  f"reordered={s.reordered} frames={s.frames_out} "
+                  f"frame_gaps={s.frame_gaps} expired={s.frames_expired}")
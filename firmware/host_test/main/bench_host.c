@@ -0,0 +1,327 @@
+/**
+ * @file bench_host.c
+ * @brief Host benchmark runner: the bench.c micro-benchmarks on the build
+ *        machine.
+ *
+ * Same input and same module code as bench_run_micro(), timed with
+ * CLOCK_MONOTONIC. Reports ns/sample for the ring, the decimator at each
+ * ODR, ISO timestamps and accel_pack, and bytes/s for json_writer and the
+ * JSON, binary v1 and packed v2 packet encoders, each with the CRC32 of
+ * its output. Host numbers only compare builds on one machine; the
+ * node's own figures still come from bench_run_micro().
+ *
+ * Usage: bench_host [repeats]   (default 20)
+ */
+
+#include "host_test.h"
+#include "accel_pack.h"
+#include "decimator.h"
+#include "esp_log.h"
+#include "json_writer.h"
+#include "packet_time.h"
+#include "sensor_payload.h"
+#include "spsc_ring.h"
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_RING_SIZE         1024
+#define BENCH_RING_CHUNK        64
+#define BENCH_RING_SAMPLES      8192
+#define BENCH_DECIM_SAMPLES     16000
+#define BENCH_DECIM_MAX_OUT     4096
+#define BENCH_PACKET_SAMPLES    200
+#define BENCH_UTC_BASE_US       1760400000000000LL     /* Fixed, so digests repeat */
+
+SPSC_RING_DEFINE(bench_ring, adxl355_raw_sample_t, BENCH_RING_SIZE)
+
+static uint32_t s_repeats = 20;
+
+/* Output of the last pass, kept so the compiler cannot drop the work */
+static volatile uint32_t s_sink;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int64_t elapsed_ns(int64_t t0)
+{
+    int64_t ns = now_ns() - t0;
+    return ns > 0 ? ns : 1;
+}
+
+/******************************************************************************
+ * BENCHMARKS
+ *****************************************************************************/
+
+static void bench_ring_buffer(adxl355_raw_sample_t *src, adxl355_raw_sample_t *dst)
+{
+    static bench_ring_t ring;
+    host_test_fill_raw(src, BENCH_RING_SAMPLES, 8);
+
+    int64_t push_ns = 0, read_ns = 0;
+    for (uint32_t r = 0; r < s_repeats; r++) {
+        bench_ring_init(&ring, SPSC_DROP_NEWEST);
+        uint32_t moved = 0;
+        while (moved < BENCH_RING_SAMPLES) {
+            int64_t t0 = now_ns();
+            for (uint32_t i = 0; i < BENCH_RING_CHUNK; i++) {
+                adxl355_raw_sample_t *slot = bench_ring_claim(&ring);
+                *slot = src[moved + i];
+                bench_ring_publish(&ring);
+            }
+            int64_t t1 = now_ns();
+            moved += bench_ring_read(&ring, dst + moved, BENCH_RING_CHUNK);
+            read_ns += now_ns() - t1;
+            push_ns += t1 - t0;
+        }
+    }
+
+    uint64_t n   = (uint64_t)BENCH_RING_SAMPLES * s_repeats;
+    uint32_t crc = host_test_crc32(0, dst, BENCH_RING_SAMPLES * sizeof(*dst));
+    printf("  ring push:        %8.1f ns/sample\n", (double)push_ns / (double)n);
+    printf("  ring bulk read:   %8.1f ns/sample  crc=%08" PRIx32 "\n",
+           (double)read_ns / (double)n, crc);
+}
+
+static void bench_decimator(adxl355_raw_sample_t *src)
+{
+    static decimator_t dec;
+    static int32_t  out_buf[3][BENCH_DECIM_MAX_OUT];
+    static uint32_t out_tick[BENCH_DECIM_MAX_OUT];
+    int32_t *const out[3] = { out_buf[0], out_buf[1], out_buf[2] };
+
+    for (size_t o = 0; o < HOST_TEST_ODR_COUNT; o++) {
+        const host_test_odr_t *odr = &HOST_TEST_ODRS[o];
+        if (decimator_configure(&dec, odr->odr_hz, odr->period_ticks) != ESP_OK) {
+            printf("  decimator %4" PRIu32 " Hz: no profile\n", odr->odr_hz);
+            continue;
+        }
+        host_test_fill_raw(src, BENCH_DECIM_SAMPLES, odr->period_ticks);
+
+        uint32_t n_used = 0, n_out = 0;
+        int64_t  ns     = 0;
+        for (uint32_t r = 0; r < s_repeats; r++) {
+            decimator_reset(&dec);
+            int64_t t0 = now_ns();
+            n_out = decimator_process(&dec, src, BENCH_DECIM_SAMPLES, &n_used, out,
+                                      out_tick, BENCH_DECIM_MAX_OUT);
+            ns += elapsed_ns(t0);
+        }
+
+        uint32_t crc = 0;
+        for (int k = 0; k < 3; k++) {
+            crc = host_test_crc32(crc, out[k], n_out * sizeof(int32_t));
+        }
+        crc = host_test_crc32(crc, out_tick, n_out * sizeof(uint32_t));
+        printf("  decimator %4" PRIu32 " Hz: %8.1f ns/sample  (%" PRIu32 " in, %" PRIu32
+               " out)  crc=%08" PRIx32 "\n",
+               odr->odr_hz, (double)ns / ((double)n_used * s_repeats), n_used, n_out, crc);
+    }
+}
+
+static void bench_timestamps(void)
+{
+    char buf[TS_ISO_MIN_LEN];
+    ts_iso_cursor_t cur;
+    ts_iso_cursor_init(&cur);
+
+    uint32_t n  = BENCH_PACKET_SAMPLES * s_repeats * 100;
+    int64_t  t0 = now_ns();
+    for (uint32_t i = 0; i < n; i++) {
+        ts_iso_format(&cur, BENCH_UTC_BASE_US + (int64_t)i * 5000, buf);
+        s_sink += (uint8_t)buf[25];
+    }
+    int64_t ns = elapsed_ns(t0);
+
+    printf("  ISO timestamp:    %8.1f ns/sample  crc=%08" PRIx32 "\n",
+           (double)ns / (double)n, host_test_crc32(0, buf, TS_ISO_MIN_LEN - 1));
+}
+
+static void bench_accel_pack(const adxl355_raw_sample_t *src)
+{
+    static int32_t x[BENCH_PACKET_SAMPLES], y[BENCH_PACKET_SAMPLES], z[BENCH_PACKET_SAMPLES];
+    static uint8_t buf[ACCEL_PACK_MAX_BYTES(BENCH_PACKET_SAMPLES)];
+    const int32_t *const axis[3] = { x, y, z };
+
+    for (int i = 0; i < BENCH_PACKET_SAMPLES; i++) {
+        x[i] = src[i].raw_x;
+        y[i] = src[i].raw_y;
+        z[i] = src[i].raw_z;
+    }
+
+    uint32_t iters = s_repeats * 100;
+    size_t   len   = 0;
+    int64_t  t0    = now_ns();
+    for (uint32_t it = 0; it < iters; it++) {
+        len = accel_pack_encode(axis, BENCH_PACKET_SAMPLES, buf, sizeof(buf));
+        s_sink += buf[len - 1];
+    }
+    int64_t ns = elapsed_ns(t0);
+
+    printf("  accel_pack:       %8.1f ns/sample  %10.0f bytes/s  (%zu bytes)  crc=%08" PRIx32 "\n",
+           (double)ns / ((double)BENCH_PACKET_SAMPLES * iters),
+           (double)len * iters * 1e9 / (double)ns, len, host_test_crc32(0, buf, len));
+}
+
+static size_t json_packet(char *buf, size_t cap, const adxl355_raw_sample_t *src)
+{
+    static const char ts[] = "2025-01-15T12:34:56.000000Z";
+    json_writer_t w;
+    jw_init(&w, buf, cap);
+    if (!jw_reserve(&w, 8)) {
+        return 0;
+    }
+    jw_put_lit(&w, "{\"a\":[");
+    for (int i = 0; i < BENCH_PACKET_SAMPLES; i++) {
+        if (!jw_reserve(&w, JW_SAMPLE_MAX_LEN)) {
+            break;
+        }
+        if (i > 0) {
+            jw_putc(&w, ',');
+        }
+        jw_put_lit(&w, "[\"");
+        jw_put_raw(&w, ts, sizeof(ts) - 1);
+        jw_putc(&w, '"');
+        const int32_t v[3] = { src[i].raw_x, src[i].raw_y, src[i].raw_z };
+        for (int k = 0; k < 3; k++) {
+            jw_putc(&w, ',');
+            jw_put_fixed(&w, jw_div_round((int64_t)v[k] * 10000, 256000), 4);
+        }
+        jw_putc(&w, ']');
+    }
+    if (jw_reserve(&w, 2)) {
+        jw_put_lit(&w, "]}");
+    }
+    return w.len;
+}
+
+static void bench_json_writer(const adxl355_raw_sample_t *src)
+{
+    static char buf[BENCH_PACKET_SAMPLES * JW_SAMPLE_MAX_LEN + 16];
+
+    uint32_t iters = s_repeats * 100;
+    size_t   len   = 0;
+    int64_t  t0    = now_ns();
+    for (uint32_t it = 0; it < iters; it++) {
+        len = json_packet(buf, sizeof(buf), src);
+        s_sink += (uint8_t)buf[len - 1];
+    }
+    int64_t ns = elapsed_ns(t0);
+
+    printf("  json_writer:      %8.1f ns/sample  %10.0f bytes/s  (%zu bytes)  crc=%08" PRIx32 "\n",
+           (double)ns / ((double)BENCH_PACKET_SAMPLES * iters),
+           (double)len * iters * 1e9 / (double)ns, len, host_test_crc32(0, buf, len));
+}
+
+/** @brief A full 1 s packet at 200 Hz: 200 accel, 20 incl, one temperature. */
+static void fill_packet(mqtt_sensor_packet_t *p, const adxl355_raw_sample_t *src)
+{
+    memset(p, 0, sizeof(*p));
+
+    p->accel_count        = BENCH_PACKET_SAMPLES;
+    p->accel_valid        = true;
+    p->accel_period_ticks = 40;
+    mqtt_accel_summary_reset(&p->accel_sum);
+    for (int i = 0; i < BENCH_PACKET_SAMPLES; i++) {
+        const int32_t xyz[3] = { src[i].raw_x, src[i].raw_y, src[i].raw_z };
+        for (int k = 0; k < 3; k++) {
+            p->accel[k][i] = xyz[k];
+        }
+        mqtt_accel_summary_add(&p->accel_sum, xyz);
+    }
+    memset(p->accel_map, 0xFF, sizeof(p->accel_map));
+    mqtt_accel_summary_finish(&p->accel_sum, 0);
+
+    p->incl_count = MQTT_INCL_BATCH_SIZE;
+    p->incl_valid = true;
+    for (int i = 0; i < MQTT_INCL_BATCH_SIZE; i++) {
+        p->incl_tick[i] = (uint32_t)i * 400u;
+        p->incl[0][i]   = (int16_t)(src[i * 10].raw_x / 64);
+        p->incl[1][i]   = (int16_t)(src[i * 10].raw_y / 64);
+        p->incl[2][i]   = (int16_t)(src[i * 10].raw_z / 64);
+    }
+
+    p->has_temp        = true;
+    p->temp_valid      = true;
+    p->temperature     = 21.5f;
+    p->temp_tick       = 4000;
+    p->anchor.tick     = 0;
+    p->anchor.utc_us   = BENCH_UTC_BASE_US;
+    p->accel_lsb_per_g = 256000;
+    p->base_tick       = 0;
+    p->base_utc_us     = BENCH_UTC_BASE_US;
+    p->odr_hz          = 1000;
+    p->decim           = 5;
+    p->range           = 1;
+}
+
+/* The encoders mqtt_serialize_sensor_data() dispatches to, without the module state */
+static void bench_serializer(const char *name, mqtt_payload_format_t format,
+                             const mqtt_sensor_packet_t *p)
+{
+    static char buf[MQTT_DATA_PAYLOAD_MAX];
+
+    uint32_t iters = s_repeats * 10;
+    size_t   len   = 0;
+    size_t   total = 0;
+    int64_t  t0    = now_ns();
+    for (uint32_t it = 0; it < iters; it++) {
+        esp_err_t err = (format == MQTT_PAYLOAD_JSON)
+            ? sensor_payload_encode_json(p, buf, sizeof(buf), &len)
+            : sensor_payload_encode_binary(p, format == MQTT_PAYLOAD_PACKED, 0, buf,
+                                           sizeof(buf), &len);
+        if (err != ESP_OK) {
+            printf("  %-16s  encode failed (%s)\n", name, esp_err_to_name(err));
+            return;
+        }
+        total += len;
+    }
+    int64_t ns = elapsed_ns(t0);
+
+    printf("  %-16s  %8.1f us/packet  %10.0f bytes/s  (%zu bytes)  crc=%08" PRIx32 "\n",
+           name, (double)ns / 1000.0 / iters, (double)total * 1e9 / (double)ns, len,
+           host_test_crc32(0, buf, len));
+}
+
+/******************************************************************************
+ * MAIN
+ *****************************************************************************/
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        s_repeats = (uint32_t)strtoul(argv[1], NULL, 10);
+        if (s_repeats == 0) {
+            s_repeats = 1;
+        }
+    }
+
+    static adxl355_raw_sample_t src[BENCH_DECIM_SAMPLES];
+    static adxl355_raw_sample_t dst[BENCH_RING_SAMPLES];
+
+    printf("Host micro-benchmarks (%" PRIu32 " repeats)\n", s_repeats);
+    bench_ring_buffer(src, dst);
+    bench_decimator(src);
+    bench_timestamps();
+
+    /* 200 Hz packet input, as the serializers see it on the node */
+    host_test_fill_raw(src, BENCH_PACKET_SAMPLES, 40);
+    bench_accel_pack(src);
+    bench_json_writer(src);
+
+    static mqtt_sensor_packet_t packet;
+    fill_packet(&packet, src);
+    bench_serializer("JSON:",      MQTT_PAYLOAD_JSON,   &packet);
+    bench_serializer("binary v1:", MQTT_PAYLOAD_BINARY, &packet);
+    bench_serializer("packed v2:", MQTT_PAYLOAD_PACKED, &packet);
+
+    /* The module's own snprintf-vs-writer comparison logs at info (stderr) */
+    fflush(stdout);
+    host_log_level = ESP_LOG_INFO;
+    json_writer_benchmark();
+    return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file host_test.c
+ * @brief Shared helpers of the host tests (see host_test.h).
+ */
+
+#include "host_test.h"
+#include <string.h>
+
+static const char *s_golden_dir = ".";
+
+void host_test_fill_raw(adxl355_raw_sample_t *s, uint32_t n, uint32_t period_ticks)
+{
+    uint32_t seed = 0x12345678u;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t tick  = i * period_ticks;
+        /* 10 Hz: 800 ticks per period, +/-128000 counts peak */
+        int32_t  phase = (int32_t)(tick % 800u);
+        int32_t  tri   = (phase < 400) ? phase * 640 - 128000 : (800 - phase) * 640 - 128000;
+        int32_t  noise[3];
+        for (int k = 0; k < 3; k++) {
+            seed = seed * 1664525u + 1013904223u;
+            noise[k] = (int32_t)((seed >> 8) % 4001u) - 2000;
+        }
+        s[i].tick  = tick;
+        s[i].raw_x = tri + noise[0];
+        s[i].raw_y = (tri >> 1) + noise[1];
+        s[i].raw_z = 256000 + noise[2];
+    }
+}
+
+uint32_t host_test_crc32(uint32_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+void host_test_set_golden_dir(const char *dir)
+{
+    s_golden_dir = dir;
+}
+
+static void report_mismatch(const char *name, const char *want, size_t want_len,
+                            const char *got, size_t got_len)
+{
+    size_t i    = 0;
+    int    line = 1;
+    size_t sol  = 0;
+    while (i < want_len && i < got_len && want[i] == got[i]) {
+        if (want[i] == '\n') {
+            line++;
+            sol = i + 1;
+        }
+        i++;
+    }
+    const char *we = memchr(want + sol, '\n', want_len - sol);
+    const char *ge = memchr(got + sol, '\n', got_len - sol);
+    int wl = (int)((we ? (size_t)(we - want) : want_len) - sol);
+    int gl = (int)((ge ? (size_t)(ge - got) : got_len) - sol);
+    fprintf(stderr, "golden %s: line %d differs\n  want: %.*s\n  got:  %.*s\n",
+            name, line, wl, want + sol, gl, got + sol);
+}
+
+bool host_test_golden(const char *name, const char *text, size_t len)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.txt", s_golden_dir, name);
+
+    const char *update = getenv("HOST_TEST_UPDATE_GOLDEN");
+    if (update != NULL && strcmp(update, "1") == 0) {
+        FILE *f = fopen(path, "wb");
+        if (f == NULL || fwrite(text, 1, len, f) != len) {
+            fprintf(stderr, "golden %s: cannot write %s\n", name, path);
+            if (f != NULL) {
+                fclose(f);
+            }
+            return false;
+        }
+        fclose(f);
+        printf("golden %s: updated %s\n", name, path);
+        return true;
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "golden %s: missing %s (run with HOST_TEST_UPDATE_GOLDEN=1)\n",
+                name, path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *want = malloc(size > 0 ? (size_t)size : 1u);
+    size_t want_len = (want != NULL) ? fread(want, 1, (size_t)size, f) : 0;
+    fclose(f);
+
+    bool ok = (want != NULL && want_len == len && memcmp(want, text, len) == 0);
+    if (!ok && want != NULL) {
+        report_mismatch(name, want, want_len, text, len);
+    }
+    free(want);
+    return ok;
+}
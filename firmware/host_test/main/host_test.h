@@ -0,0 +1,66 @@
+/**
+ * @file host_test.h
+ * @brief Shared helpers of the host tests and the benchmark runner: the
+ *        deterministic input, CRC32 and the golden-file check.
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include "sensor_task.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Ticks are on the 8 kHz ADXL355 timer grid, as on the node */
+#define HOST_TEST_TICK_HZ       8000u
+
+/** One ODR profile of node_config.c (odr_hz, isr_tick_divisor). */
+typedef struct {
+    uint32_t odr_hz;
+    uint32_t period_ticks;
+} host_test_odr_t;
+
+static const host_test_odr_t HOST_TEST_ODRS[] = {
+    { 4000, 2 },
+    { 2000, 4 },
+    { 1000, 8 },
+};
+#define HOST_TEST_ODR_COUNT     (sizeof(HOST_TEST_ODRS) / sizeof(HOST_TEST_ODRS[0]))
+
+#define CHECK(cond)                                                            \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,   \
+                    #cond);                                                    \
+            exit(1);                                                           \
+        }                                                                      \
+    } while (0)
+
+/**
+ * @brief Fill n raw samples: a 10 Hz triangle of ~0.5 g plus LCG noise.
+ *
+ * The same shape as bench.c's input, but integer-only so the golden
+ * outputs do not depend on the host's libm.
+ */
+void host_test_fill_raw(adxl355_raw_sample_t *s, uint32_t n, uint32_t period_ticks);
+
+/** @brief zlib CRC32 (same value as esp_rom_crc32_le(0, ...)). */
+uint32_t host_test_crc32(uint32_t crc, const void *data, size_t len);
+
+/**
+ * @brief Compare text with golden/<name>.txt.
+ *
+ * With HOST_TEST_UPDATE_GOLDEN=1 in the environment the file is rewritten
+ * instead. A mismatch prints the first differing line and fails.
+ *
+ * @return true if the text matches (or was written).
+ */
+bool host_test_golden(const char *name, const char *text, size_t len);
+
+/** @brief Set the golden directory (argv[1] of the test executables). */
+void host_test_set_golden_dir(const char *dir);
+
+#endif // HOST_TEST_H
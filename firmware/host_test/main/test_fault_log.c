@@ -0,0 +1,151 @@
+/**
+ * @file test_fault_log.c
+ * @brief fault_log.c on the host: the real dispatcher task on a pthread,
+ *        batches captured through the publish callback.
+ *
+ * The fake clock fixes esp_timer time and the wall clock, so the batch
+ * JSON (timestamps, counts, dt, lost) is reproducible and compared with
+ * golden/fault_log.txt. The dispatcher still polls in real time.
+ *
+ * Usage: test_fault_log <golden dir>
+ */
+
+#include "host_test.h"
+#include "host_shims.h"
+#include "fault_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_BATCHES     8
+#define WAIT_MS         3000
+
+/* 2025-01-15T11:54:56Z, well past the SNTP validity threshold */
+#define WALL_START_US   1736942096000000LL
+#define MONO_START_US   10000000LL
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  s_cond = PTHREAD_COND_INITIALIZER;
+static char            s_batches[MAX_BATCHES][FAULT_LOG_BATCH_MAX * 32 + 128];
+static int             s_batch_count;
+
+static void capture_cb(const char *payload, int len)
+{
+    pthread_mutex_lock(&s_lock);
+    if (s_batch_count < MAX_BATCHES) {
+        snprintf(s_batches[s_batch_count], sizeof(s_batches[0]), "%.*s", len, payload);
+    }
+    s_batch_count++;
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_lock);
+}
+
+/** @brief Wait (real time) until count batches have arrived. */
+static bool wait_batches(int count)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += WAIT_MS / 1000;
+
+    pthread_mutex_lock(&s_lock);
+    while (s_batch_count < count) {
+        if (pthread_cond_timedwait(&s_cond, &s_lock, &deadline) != 0) {
+            break;
+        }
+    }
+    bool ok = (s_batch_count >= count);
+    pthread_mutex_unlock(&s_lock);
+    return ok;
+}
+
+/** @brief Wait (real time) until the dispatcher holds count entries. */
+static bool wait_pending(uint32_t count)
+{
+    fault_log_stats_t st;
+    for (int i = 0; i < WAIT_MS / 10; i++) {
+        fault_log_get_stats(&st);
+        if (st.pending == count) {
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return false;
+}
+
+static void record(uint8_t code, int64_t step_ms)
+{
+    fault_log_record(code);
+    host_clock_advance(step_ms * 1000);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        host_test_set_golden_dir(argv[1]);
+    }
+
+    char text[4096];
+    int  len = 0;
+    host_clock_set_fake(MONO_START_US, WALL_START_US);
+
+    /* Boot: 20 distinct codes, repeats of 7 and a storm of 8 that
+     * overflows the queue, all before the dispatcher exists */
+    for (uint8_t code = 1; code <= 20; code++) {
+        record(code, 5);
+    }
+    record(FAULT_ADXL355_DROPPED, 5);
+    record(FAULT_ADXL355_DROPPED, 5);
+    for (int i = 0; i < 50; i++) {
+        record(FAULT_SCL3300_DROPPED, 1);
+    }
+
+    fault_log_stats_t st;
+    fault_log_get_stats(&st);
+    CHECK(st.recorded == FAULT_LOG_QUEUE_SIZE);
+    CHECK(st.dropped == 72 - FAULT_LOG_QUEUE_SIZE);
+
+    /* Held, not published, until the callback exists */
+    CHECK(fault_log_init() == ESP_OK);
+    CHECK(wait_pending(20));
+    CHECK(fault_log_has_pending());
+
+    /* Registration + flush, as main.c does: 20 entries go out as 16 + 4 */
+    fault_log_set_publish_cb(capture_cb);
+    fault_log_flush_pending();
+    CHECK(wait_batches(2));
+    len += snprintf(text + len, sizeof(text) - len, "# flush\n%s\n%s\n",
+                    s_batches[0], s_batches[1]);
+
+    /* Coalescing window: two repeats publish once the oldest is 1 s old */
+    record(FAULT_SPI_ERROR, 200);
+    record(FAULT_SPI_ERROR, 0);
+    host_clock_advance(FAULT_LOG_COALESCE_MS * 1000);
+    CHECK(wait_batches(3));
+    len += snprintf(text + len, sizeof(text) - len, "# coalesce\n%s\n", s_batches[2]);
+
+    /* Codes taken into a data packet are not published again */
+    record(FAULT_MQTT_PUBLISH_FAIL, 0);
+    record(FAULT_I2C_ERROR, 0);
+    CHECK(wait_pending(2));
+    char json[64] = "{\"x\":1";
+    int  off = fault_log_append_to_json(json, sizeof(json), (int)strlen(json));
+    CHECK(off == (int)strlen(json));
+    CHECK(!fault_log_has_pending());
+    len += snprintf(text + len, sizeof(text) - len, "# append\n%s}\n", json);
+
+    host_clock_advance(2 * FAULT_LOG_COALESCE_MS * 1000);
+    vTaskDelay(pdMS_TO_TICKS(3 * FAULT_LOG_DISPATCH_POLL_MS));
+    fault_log_get_stats(&st);
+    CHECK(s_batch_count == 3);
+    len += snprintf(text + len, sizeof(text) - len,
+                    "# stats\nrecorded=%u dropped=%u coalesced=%u batches=%u pending=%u\n",
+                    (unsigned)st.recorded, (unsigned)st.dropped, (unsigned)st.coalesced,
+                    (unsigned)st.batches, (unsigned)st.pending);
+    CHECK(len < (int)sizeof(text));
+
+    bool ok = host_test_golden("fault_log", text, (size_t)len);
+    printf("test_fault_log: %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
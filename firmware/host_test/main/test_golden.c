@@ -0,0 +1,657 @@
+/**
+ * @file test_golden.c
+ * @brief Golden-output tests of the pure-logic modules: accel_pack,
+ *        json_writer, the decimator, packet_time and the sensor_payload
+ *        encoders, plus the SPSC ring's full-ring policies.
+ *
+ * Each test renders its module's output for a fixed input as text and
+ * compares it with golden/<name>.txt. These are the outputs bench.c only
+ * logs a CRC of on the node; a change here is a change on the wire.
+ *
+ * Usage: test_golden <golden dir>
+ */
+
+#include "host_test.h"
+#include "host_shims.h"
+#include "accel_pack.h"
+#include "decimator.h"
+#include "esp_log.h"
+#include "json_writer.h"
+#include "packet_time.h"
+#include "sensor_payload.h"
+#include "spsc_ring.h"
+#include <inttypes.h>
+#include <stdarg.h>
+#include <string.h>
+
+/******************************************************************************
+ * TEXT BUFFER
+ *****************************************************************************/
+
+typedef struct {
+    char   *buf;
+    size_t  len;
+    size_t  cap;
+} text_t;
+
+static void text_printf(text_t *t, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void text_printf(text_t *t, const char *fmt, ...)
+{
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(t->buf + t->len, t->cap - t->len, fmt, ap);
+        va_end(ap);
+        CHECK(n >= 0);
+        if ((size_t)n < t->cap - t->len) {
+            t->len += (size_t)n;
+            return;
+        }
+        t->cap = (t->cap + (size_t)n + 1) * 2;
+        t->buf = realloc(t->buf, t->cap);
+        CHECK(t->buf != NULL);
+    }
+}
+
+static void text_hex(text_t *t, const uint8_t *p, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        text_printf(t, "%02x%s", p[i], (i % 32 == 31 || i == n - 1) ? "\n" : "");
+    }
+}
+
+/******************************************************************************
+ * ACCEL_PACK
+ *****************************************************************************/
+
+/* Reference decoder of the accel_pack.h layout */
+static size_t unpack(const uint8_t *p, size_t len, uint32_t n, int32_t *out[3])
+{
+    const uint8_t *start = p;
+    const uint8_t *end   = p + len;
+    for (int a = 0; a < 3; a++) {
+        CHECK(end - p >= 4);
+        uint32_t prev;
+        memcpy(&prev, p, 4);
+        p += 4;
+        out[a][0] = (int32_t)prev;
+        for (uint32_t s = 1; s < n; s += ACCEL_PACK_BLOCK) {
+            uint32_t m = (n - s < ACCEL_PACK_BLOCK) ? n - s : ACCEL_PACK_BLOCK;
+            CHECK(p < end);
+            uint32_t w = *p++;
+            CHECK(w <= 32);
+            uint64_t acc   = 0;
+            uint32_t nbits = 0;
+            for (uint32_t k = 0; k < m; k++) {
+                while (nbits < w) {
+                    CHECK(p < end);
+                    acc   |= (uint64_t)*p++ << nbits;
+                    nbits += 8;
+                }
+                uint32_t zz = (w == 32) ? (uint32_t)acc : (uint32_t)acc & ((1u << w) - 1u);
+                acc   >>= w;
+                nbits -= w;
+                uint32_t delta = (zz >> 1) ^ (0u - (zz & 1u));
+                prev += delta;
+                out[a][s + k] = (int32_t)prev;
+            }
+        }
+    }
+    return (size_t)(p - start);
+}
+
+static void pack_case(text_t *t, const char *label, int32_t *x, int32_t *y, int32_t *z, uint32_t n)
+{
+    const int32_t *const axis[3] = { x, y, z };
+    size_t   cap = ACCEL_PACK_MAX_BYTES(n);
+    uint8_t *buf = malloc(cap);
+    CHECK(buf != NULL);
+
+    size_t len = accel_pack_encode(axis, n, buf, cap);
+    CHECK(len > 0 && len <= cap);
+    CHECK(accel_pack_encode(axis, n, buf, cap - 1) == 0);
+
+    int32_t *dec[3];
+    for (int a = 0; a < 3; a++) {
+        dec[a] = malloc(n * sizeof(int32_t));
+        CHECK(dec[a] != NULL);
+    }
+    CHECK(unpack(buf, len, n, dec) == len);
+    for (int a = 0; a < 3; a++) {
+        CHECK(memcmp(dec[a], axis[a], n * sizeof(int32_t)) == 0);
+        free(dec[a]);
+    }
+
+    text_printf(t, "# %s: %" PRIu32 " samples, %zu bytes\n", label, n, len);
+    text_hex(t, buf, len);
+    free(buf);
+}
+
+static bool test_accel_pack(void)
+{
+    enum { N = 200 };
+    static adxl355_raw_sample_t raw[N];
+    static int32_t x[N], y[N], z[N];
+    text_t t = { 0 };
+
+    /* 200 Hz decimated-like input: one packet of the live path */
+    host_test_fill_raw(raw, N, 40);
+    for (int i = 0; i < N; i++) {
+        x[i] = raw[i].raw_x;
+        y[i] = raw[i].raw_y;
+        z[i] = raw[i].raw_z;
+    }
+    pack_case(&t, "triangle+noise", x, y, z, N);
+
+    /* Constant axes: every block is width 0 */
+    for (int i = 0; i < 70; i++) {
+        x[i] = 0;
+        y[i] = -1;
+        z[i] = 256000;
+    }
+    pack_case(&t, "constant", x, y, z, 70);
+
+    /* Full-scale swings: width 32 and deltas that wrap modulo 2^32 */
+    for (int i = 0; i < 40; i++) {
+        x[i] = (i & 1) ? INT32_MAX : INT32_MIN;
+        y[i] = (i & 1) ? -524288 : 524287;
+        z[i] = i * 3;
+    }
+    pack_case(&t, "extremes", x, y, z, 40);
+
+    /* One sample: first values only, no blocks */
+    pack_case(&t, "single", x, y, z, 1);
+
+    CHECK(accel_pack_encode((const int32_t *const[3]){ x, y, z }, 0, (uint8_t[16]){ 0 }, 16) == 0);
+
+    bool ok = host_test_golden("accel_pack", t.buf, t.len);
+    free(t.buf);
+    return ok;
+}
+
+/******************************************************************************
+ * JSON_WRITER
+ *****************************************************************************/
+
+static bool test_json_writer(void)
+{
+    static const struct {
+        int32_t  scaled;
+        unsigned decimals;
+    } fixed[] = {
+        { 0, 0 }, { 0, 4 }, { 7, 4 }, { -7, 4 }, { 12345, 4 }, { -12345, 4 },
+        { 10000, 4 }, { 999999, 9 }, { INT32_MAX, 0 }, { INT32_MIN, 0 },
+        { INT32_MIN, 9 }, { 5, 1 },
+    };
+    static const uint64_t u64[] = { 0, 9, 10, 1736942096123456ull, UINT64_MAX };
+    static const int64_t  div[][2] = {
+        { 5, 10 }, { -5, 10 }, { 4, 10 }, { -4, 10 }, { 15, 10 }, { -15, 10 },
+        { 130000LL * 10000, 256000 }, { -130000LL * 10000, 256000 },
+    };
+
+    char buf[1024];
+    json_writer_t w;
+    jw_init(&w, buf, sizeof(buf));
+    CHECK(jw_reserve(&w, sizeof(buf) - 1));
+
+    jw_put_lit(&w, "{\"fixed\":[");
+    for (size_t i = 0; i < sizeof(fixed) / sizeof(fixed[0]); i++) {
+        if (i > 0) {
+            jw_putc(&w, ',');
+        }
+        jw_put_fixed(&w, fixed[i].scaled, fixed[i].decimals);
+    }
+    jw_put_lit(&w, "],\"u64\":[");
+    for (size_t i = 0; i < sizeof(u64) / sizeof(u64[0]); i++) {
+        if (i > 0) {
+            jw_putc(&w, ',');
+        }
+        jw_put_u64(&w, u64[i]);
+    }
+    jw_put_lit(&w, "],\"round\":[");
+    for (size_t i = 0; i < sizeof(div) / sizeof(div[0]); i++) {
+        if (i > 0) {
+            jw_putc(&w, ',');
+        }
+        jw_put_fixed(&w, jw_div_round(div[i][0], div[i][1]), 4);
+    }
+    jw_put_lit(&w, "],\"ts\":");
+    jw_put_qstr(&w, "2025-01-15T12:34:56.000000Z");
+    jw_put_lit(&w, "}\n");
+    CHECK(!w.overflow);
+
+    /* Reservation past the end latches overflow and stays latched */
+    json_writer_t small;
+    char small_buf[8];
+    jw_init(&small, small_buf, sizeof(small_buf));
+    CHECK(jw_reserve(&small, 8));
+    CHECK(!jw_reserve(&small, 9));
+    CHECK(small.overflow);
+    CHECK(!jw_reserve(&small, 1));
+
+    return host_test_golden("json_writer", buf, w.len);
+}
+
+/******************************************************************************
+ * DECIMATOR
+ *****************************************************************************/
+
+#define DECIM_RAW_SAMPLES   8000
+#define DECIM_MAX_OUT       2048
+#define DECIM_GOLDEN_ROWS   64
+#define DECIM_CHUNK         37      /* Odd size: block edges fall mid-phase */
+
+static bool test_decimator(void)
+{
+    static adxl355_raw_sample_t raw[DECIM_RAW_SAMPLES];
+    static int32_t  out_buf[2][3][DECIM_MAX_OUT];
+    static uint32_t out_tick[2][DECIM_MAX_OUT];
+    static decimator_t dec;
+    text_t t = { 0 };
+
+    /* Expected error: keep its log line out of the test output */
+    host_log_level = ESP_LOG_NONE;
+    CHECK(decimator_configure(&dec, 500, 16) == ESP_ERR_NOT_SUPPORTED);
+    host_log_level = ESP_LOG_WARN;
+
+    for (size_t o = 0; o < HOST_TEST_ODR_COUNT; o++) {
+        const host_test_odr_t *odr = &HOST_TEST_ODRS[o];
+        host_test_fill_raw(raw, DECIM_RAW_SAMPLES, odr->period_ticks);
+
+        /* One call over the whole input */
+        CHECK(decimator_configure(&dec, odr->odr_hz, odr->period_ticks) == ESP_OK);
+        decimator_reset(&dec);
+        int32_t *const out[3] = { out_buf[0][0], out_buf[0][1], out_buf[0][2] };
+        uint32_t used  = 0;
+        uint32_t n_out = decimator_process(&dec, raw, DECIM_RAW_SAMPLES, &used, out,
+                                           out_tick[0], DECIM_MAX_OUT);
+        CHECK(used == DECIM_RAW_SAMPLES);
+
+        /* The same input in small blocks must give the same output */
+        decimator_reset(&dec);
+        uint32_t n_chunked = 0;
+        for (uint32_t pos = 0; pos < DECIM_RAW_SAMPLES; ) {
+            uint32_t n = DECIM_RAW_SAMPLES - pos;
+            if (n > DECIM_CHUNK) {
+                n = DECIM_CHUNK;
+            }
+            int32_t *const part[3] = { out_buf[1][0] + n_chunked, out_buf[1][1] + n_chunked,
+                                       out_buf[1][2] + n_chunked };
+            uint32_t part_used = 0;
+            n_chunked += decimator_process(&dec, raw + pos, n, &part_used, part,
+                                           out_tick[1] + n_chunked, DECIM_MAX_OUT - n_chunked);
+            CHECK(part_used == n);
+            pos += n;
+        }
+        CHECK(n_chunked == n_out);
+        for (int k = 0; k < 3; k++) {
+            CHECK(memcmp(out_buf[0][k], out_buf[1][k], n_out * sizeof(int32_t)) == 0);
+        }
+        CHECK(memcmp(out_tick[0], out_tick[1], n_out * sizeof(uint32_t)) == 0);
+
+        /* max_out stops the pass early and reports what it consumed */
+        decimator_reset(&dec);
+        uint32_t capped_used = 0;
+        CHECK(decimator_process(&dec, raw, DECIM_RAW_SAMPLES, &capped_used, out,
+                                out_tick[0], 10) == 10);
+        CHECK(capped_used < DECIM_RAW_SAMPLES);
+
+        /* Reference run again for the golden text (the capped one overwrote it) */
+        decimator_reset(&dec);
+        n_out = decimator_process(&dec, raw, DECIM_RAW_SAMPLES, &used, out, out_tick[0],
+                                  DECIM_MAX_OUT);
+
+        uint32_t crc = 0;
+        for (int k = 0; k < 3; k++) {
+            crc = host_test_crc32(crc, out[k], n_out * sizeof(int32_t));
+        }
+        crc = host_test_crc32(crc, out_tick[0], n_out * sizeof(uint32_t));
+
+        text_printf(&t, "# odr %" PRIu32 " Hz: %" PRIu32 " in, %" PRIu32 " out, crc %08" PRIx32 "\n",
+                    odr->odr_hz, used, n_out, crc);
+        for (uint32_t i = 0; i < n_out && i < DECIM_GOLDEN_ROWS; i++) {
+            text_printf(&t, "%" PRIu32 " %" PRId32 " %" PRId32 " %" PRId32 "\n",
+                        out_tick[0][i], out[0][i], out[1][i], out[2][i]);
+        }
+    }
+
+    bool ok = host_test_golden("decimator", t.buf, t.len);
+    free(t.buf);
+    return ok;
+}
+
+/******************************************************************************
+ * PACKET_TIME
+ *****************************************************************************/
+
+#define UTC_2026_US     1767225600000000LL      /* 2026-01-01T00:00:00Z */
+
+/* Cursor output must equal a fresh cursor's: the cached prefix never leaks */
+static void iso_case(text_t *t, ts_iso_cursor_t *cur, int64_t utc_us)
+{
+    char buf[TS_ISO_MIN_LEN];
+    char ref[TS_ISO_MIN_LEN];
+    ts_iso_cursor_t fresh;
+    ts_iso_cursor_init(&fresh);
+
+    ts_iso_format(cur, utc_us, buf);
+    ts_iso_format(&fresh, utc_us, ref);
+    CHECK(strlen(buf) == TS_ISO_MIN_LEN - 1);
+    CHECK(strcmp(buf, ref) == 0);
+    text_printf(t, "%" PRId64 " %s\n", utc_us, buf);
+}
+
+static bool test_packet_time(void)
+{
+    static const int64_t utc[] = {
+        0, -1, 999999, 1000000,
+        1709164799999999LL, 1709164800000000LL,             /* into 2024-02-29 */
+        UTC_2026_US - 1500000, UTC_2026_US - 1000001,       /* cached second */
+        UTC_2026_US - 1000000, UTC_2026_US - 1,
+        UTC_2026_US,                                        /* minute, day, year */
+        UTC_2026_US + 59999999, UTC_2026_US + 60000000,
+        UTC_2026_US - 86400000000LL,                        /* back in time: rebuild */
+        4102444800000000LL,                                 /* 2100-01-01 */
+    };
+    text_t t = { 0 };
+    char buf[TS_ISO_MIN_LEN];
+
+    text_printf(&t, "# ts_iso_format, one cursor\n");
+    ts_iso_cursor_t cur;
+    ts_iso_cursor_init(&cur);
+    for (size_t i = 0; i < sizeof(utc) / sizeof(utc[0]); i++) {
+        iso_case(&t, &cur, utc[i]);
+    }
+
+    /* 5 ms samples across the year boundary, as one JSON packet renders them */
+    text_printf(&t, "# ts_format_tick, anchor tick 0xfffffff0, ticks across the wrap\n");
+    ts_anchor_t anchor = { .tick = 0xFFFFFFF0u, .utc_us = UTC_2026_US - 10000 };
+    ts_iso_cursor_init(&cur);
+    for (uint32_t k = 0; k < 6; k++) {
+        uint32_t tick = anchor.tick - 40u + k * 40u;
+        ts_format_tick(&anchor, &cur, tick, buf);
+        CHECK(ts_anchor_tick_to_utc_us(&anchor, tick) == anchor.utc_us + ((int64_t)k - 1) * 5000);
+        text_printf(&t, "%08" PRIx32 " %s\n", tick, buf);
+    }
+
+    /* Signed tick difference: half the tick range either side of the anchor */
+    CHECK(ts_anchor_tick_to_utc_us(&anchor, anchor.tick + 0x7FFFFFFFu) ==
+          anchor.utc_us + (int64_t)INT32_MAX * TS_TICK_US);
+    CHECK(ts_anchor_tick_to_utc_us(&anchor, anchor.tick + 0x80000000u) ==
+          anchor.utc_us + (int64_t)INT32_MIN * TS_TICK_US);
+
+    text_printf(&t, "# ts_format_tick, unsynced anchor\n");
+    ts_anchor_t unsynced = { .tick = 5, .utc_us = 0 };
+    CHECK(!ts_anchor_synced(&unsynced));
+    CHECK(ts_anchor_tick_to_utc_us(&unsynced, 1234) == 0);
+    ts_format_tick(&unsynced, &cur, 0, buf);
+    text_printf(&t, "%s\n", buf);
+    ts_format_tick(&unsynced, &cur, UINT32_MAX, buf);
+    text_printf(&t, "%s\n", buf);
+
+    /* Capture: tick from esp_timer, UTC from the wall clock (no SNTP event) */
+    text_printf(&t, "# ts_anchor_capture\n");
+    host_clock_set_fake(1000000000, UTC_2026_US + 123456);
+    ts_anchor_capture(&anchor);
+    CHECK(anchor.tick == 8000000u);
+    CHECK(anchor.utc_us == UTC_2026_US + 123456);
+    text_printf(&t, "tick %" PRIu32 " utc_us %" PRId64 "\n", anchor.tick, anchor.utc_us);
+    host_clock_set_fake(1000000000, 1000000000000000LL);   /* 2001: not synced */
+    ts_anchor_capture(&anchor);
+    CHECK(anchor.utc_us == 0);
+    text_printf(&t, "tick %" PRIu32 " utc_us %" PRId64 "\n", anchor.tick, anchor.utc_us);
+    host_clock_use_real();
+
+    bool ok = host_test_golden("packet_time", t.buf, t.len);
+    free(t.buf);
+    return ok;
+}
+
+/******************************************************************************
+ * SENSOR_PAYLOAD
+ *****************************************************************************/
+
+#define PAYLOAD_ACCEL_SAMPLES   24
+#define PAYLOAD_INCL_SAMPLES    3
+#define PAYLOAD_SERIAL_HASH     0x5EA1AB1Eu
+
+/*
+ * 200 Hz packet with every optional part: two NaN grid samples, incl,
+ * temperature, send time, summary and an accel gap. Sample ticks cross the
+ * 32-bit wrap and the timestamps cross a year boundary.
+ */
+static void fill_packet(mqtt_sensor_packet_t *p)
+{
+    static adxl355_raw_sample_t raw[PAYLOAD_ACCEL_SAMPLES];
+    memset(p, 0, sizeof(*p));
+    host_test_fill_raw(raw, PAYLOAD_ACCEL_SAMPLES, 40);
+
+    p->accel_count        = PAYLOAD_ACCEL_SAMPLES;
+    p->accel_valid        = true;
+    p->accel_period_ticks = 40;
+    p->base_tick          = 0xFFFFFE00u;
+    p->anchor.tick        = p->base_tick + 400;
+    p->anchor.utc_us      = UTC_2026_US - 20000;
+    p->base_utc_us        = ts_anchor_tick_to_utc_us(&p->anchor, p->base_tick);
+    mqtt_accel_summary_reset(&p->accel_sum);
+    for (int i = 0; i < PAYLOAD_ACCEL_SAMPLES; i++) {
+        if (i == 7 || i == 8) {
+            p->accel[0][i] = p->accel[1][i] = p->accel[2][i] = MQTT_ACCEL_INVALID;
+            continue;
+        }
+        const int32_t xyz[3] = { raw[i].raw_x, raw[i].raw_y, raw[i].raw_z };
+        for (int k = 0; k < 3; k++) {
+            p->accel[k][i] = xyz[k];
+        }
+        p->accel_map[i >> 5] |= 1u << (i & 31);
+        mqtt_accel_summary_add(&p->accel_sum, xyz);
+    }
+    mqtt_accel_summary_finish(&p->accel_sum, 2);
+
+    p->incl_count = PAYLOAD_INCL_SAMPLES;
+    p->incl_valid = true;
+    for (int i = 0; i < PAYLOAD_INCL_SAMPLES; i++) {
+        p->incl_tick[i] = p->base_tick + 3u + (uint32_t)i * 400u;
+        p->incl[0][i]   = (int16_t)(-16384 + i * 5000);
+        p->incl[1][i]   = (int16_t)(i * 7);
+        p->incl[2][i]   = (int16_t)(16383 - i);
+    }
+
+    p->has_temp    = true;
+    p->temp_valid  = true;
+    p->temperature = 21.37f;
+    p->temp_tick   = p->base_tick + 500;
+
+    p->gaps[0]   = (mqtt_gap_t){ .sensor = MQTT_GAP_SENSOR_ACCEL, .reason = MQTT_GAP_NO_SAMPLES,
+                                 .start_tick = p->base_tick + 280, .dur_us = 10000 };
+    p->gap_count = 1;
+
+    p->accel_lsb_per_g = 256000;
+    p->odr_hz          = 1000;
+    p->decim           = 5;
+    p->range           = 1;
+    p->cfg_epoch       = 3;
+    p->seq             = 4242;
+    p->send_utc_us     = UTC_2026_US + 987654;
+}
+
+/* Both sensors out, temperature read failed, clock not synced */
+static void fill_outage_packet(mqtt_sensor_packet_t *p)
+{
+    memset(p, 0, sizeof(*p));
+    p->base_tick   = 123456;
+    p->anchor.tick = 123456;
+    p->has_temp    = true;
+    p->temp_tick   = 123456;
+    p->gaps[0]     = (mqtt_gap_t){ .sensor = MQTT_GAP_SENSOR_ACCEL, .reason = MQTT_GAP_DISCONNECTED,
+                                   .start_tick = 123456, .dur_us = MQTT_GAP_PACKET_US };
+    p->gaps[1]     = (mqtt_gap_t){ .sensor = MQTT_GAP_SENSOR_INCL, .reason = MQTT_GAP_NO_SAMPLES,
+                                   .start_tick = 123456, .dur_us = MQTT_GAP_PACKET_US };
+    p->gap_count   = 2;
+    p->odr_hz      = 4000;
+    p->decim       = 20;
+    p->range       = 2;
+    p->seq         = 1;
+}
+
+static void payload_case(text_t *t, const char *label, const mqtt_sensor_packet_t *p)
+{
+    static char buf[MQTT_DATA_PAYLOAD_MAX];
+    size_t len = 0;
+
+    /* v1: fixed-width little-endian fields, exact size check */
+    CHECK(sensor_payload_encode_binary(p, false, PAYLOAD_SERIAL_HASH, buf, sizeof(buf), &len) == ESP_OK);
+    CHECK(len >= MQTT_BIN_HEADER_LEN && (uint8_t)buf[0] == MQTT_BIN_MAGIC && buf[1] == MQTT_BIN_VERSION);
+    host_log_level = ESP_LOG_NONE;
+    size_t short_len = 0;
+    CHECK(sensor_payload_encode_binary(p, false, PAYLOAD_SERIAL_HASH, buf, len - 1, &short_len) ==
+          ESP_ERR_NO_MEM);
+    host_log_level = ESP_LOG_WARN;
+    CHECK(sensor_payload_encode_binary(p, false, PAYLOAD_SERIAL_HASH, buf, len, &len) == ESP_OK);
+    text_printf(t, "# %s: binary v1, %zu bytes\n", label, len);
+    text_hex(t, (const uint8_t *)buf, len);
+
+    /* v2: the accel block must decode back to the packet's samples */
+    CHECK(sensor_payload_encode_binary(p, true, PAYLOAD_SERIAL_HASH, buf, sizeof(buf), &len) == ESP_OK);
+    CHECK(buf[1] == MQTT_BIN_VERSION_PACKED);
+    uint8_t accel_n = (uint8_t)buf[27];     /* header: magic .. decim, then the count */
+    if (accel_n > 0) {
+        uint16_t accel_bytes;
+        memcpy(&accel_bytes, buf + MQTT_BIN_HEADER_LEN, 2);
+        static int32_t dec[3][MQTT_ACCEL_BATCH_SIZE];
+        int32_t *out[3] = { dec[0], dec[1], dec[2] };
+        CHECK(unpack((const uint8_t *)buf + MQTT_BIN_HEADER_LEN + 2, accel_bytes, accel_n, out) ==
+              accel_bytes);
+        for (int k = 0; k < 3; k++) {
+            CHECK(memcmp(dec[k], p->accel[k], accel_n * sizeof(int32_t)) == 0);
+        }
+    }
+    text_printf(t, "# %s: binary v2, %zu bytes\n", label, len);
+    text_hex(t, (const uint8_t *)buf, len);
+
+    CHECK(sensor_payload_encode_json(p, buf, sizeof(buf), &len) == ESP_OK);
+    CHECK(len > 0 && buf[0] == '{' && buf[len - 1] == '}' && memchr(buf, '\0', len) == NULL);
+    host_log_level = ESP_LOG_NONE;
+    CHECK(sensor_payload_encode_json(p, buf, len / 2, &short_len) == ESP_ERR_NO_MEM);
+    host_log_level = ESP_LOG_WARN;
+    CHECK(sensor_payload_encode_json(p, buf, sizeof(buf), &len) == ESP_OK);
+    text_printf(t, "# %s: JSON, %zu bytes\n%.*s\n", label, len, (int)len, buf);
+}
+
+static bool test_sensor_payload(void)
+{
+    static mqtt_sensor_packet_t packet;
+    text_t t = { 0 };
+
+    fill_packet(&packet);
+    payload_case(&t, "full packet", &packet);
+    fill_outage_packet(&packet);
+    payload_case(&t, "outage, unsynced", &packet);
+
+    bool ok = host_test_golden("sensor_payload", t.buf, t.len);
+    free(t.buf);
+    return ok;
+}
+
+/******************************************************************************
+ * SPSC_RING
+ *****************************************************************************/
+
+#define RING_SIZE   8
+
+SPSC_RING_DEFINE(test_ring, uint32_t, RING_SIZE)
+
+/* Push first..first+n-1; returns how many the ring took */
+static uint32_t ring_push_seq(test_ring_t *r, uint32_t first, uint32_t n)
+{
+    uint32_t taken = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t v = first + i;
+        taken += test_ring_push(r, &v);
+    }
+    return taken;
+}
+
+/* Read everything and check it is first, first+1, ... */
+static void ring_expect_seq(test_ring_t *r, uint32_t first, uint32_t n)
+{
+    uint32_t out[RING_SIZE];
+    CHECK(test_ring_count(r) == n);
+    CHECK(test_ring_read(r, out, RING_SIZE) == n);
+    for (uint32_t i = 0; i < n; i++) {
+        CHECK(out[i] == first + i);
+    }
+    CHECK(test_ring_empty(r));
+}
+
+/*
+ * Each case starts with head and tail just below UINT32_MAX, so the free-
+ * running indices wrap while the slot index wraps around the buffer end.
+ */
+static bool test_spsc_ring(void)
+{
+    static test_ring_t ring;
+    static const uint32_t starts[] = { 0, UINT32_MAX - 2, UINT32_MAX - RING_SIZE };
+
+    for (size_t s = 0; s < sizeof(starts) / sizeof(starts[0]); s++) {
+        /* Drop-newest: a full ring keeps the oldest and counts the rest */
+        test_ring_init(&ring, SPSC_DROP_NEWEST);
+        ring.head = ring.tail = starts[s];
+        CHECK(ring_push_seq(&ring, 100, RING_SIZE + 5) == RING_SIZE);
+        CHECK(ring.overflow == 5);
+        CHECK(test_ring_claim(&ring) == NULL);
+        ring_expect_seq(&ring, 100, RING_SIZE);
+
+        /* Partial drain, then refill across the buffer end */
+        CHECK(ring_push_seq(&ring, 200, 5) == 5);
+        uint32_t out[RING_SIZE];
+        CHECK(test_ring_read(&ring, out, 3) == 3 && out[0] == 200 && out[2] == 202);
+        CHECK(ring_push_seq(&ring, 205, RING_SIZE) == RING_SIZE - 2);
+        const uint32_t *span;
+        uint32_t run = test_ring_peek(&ring, &span);
+        CHECK(run >= 1 && run <= RING_SIZE && span[0] == 203);
+        for (uint32_t i = 0; i < run; i++) {
+            CHECK(span[i] == 203 + i);
+        }
+        test_ring_commit(&ring, run);
+        ring_expect_seq(&ring, 203 + run, RING_SIZE - run);
+
+        /* Overwrite-oldest: every push lands, the oldest are evicted */
+        test_ring_init(&ring, SPSC_OVERWRITE_OLDEST);
+        ring.head = ring.tail = starts[s];
+        CHECK(ring_push_seq(&ring, 300, RING_SIZE + 5) == RING_SIZE + 5);
+        CHECK(ring.overflow == 5);
+        ring_expect_seq(&ring, 305, RING_SIZE);
+
+        CHECK(ring_push_seq(&ring, 400, 5) == 5);
+        CHECK(test_ring_read(&ring, out, 2) == 2 && out[0] == 400 && out[1] == 401);
+        CHECK(ring_push_seq(&ring, 405, RING_SIZE + 1) == RING_SIZE + 1);
+        CHECK(ring.overflow == 5 + 4);       /* 3 unread + 9 pushed into 8 slots */
+        ring_expect_seq(&ring, 406, RING_SIZE);
+        CHECK(test_ring_discard(&ring) == 0);
+    }
+    return true;
+}
+
+/******************************************************************************
+ * MAIN
+ *****************************************************************************/
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        host_test_set_golden_dir(argv[1]);
+    }
+
+    int failed = 0;
+    failed += !test_accel_pack();
+    failed += !test_json_writer();
+    failed += !test_decimator();
+    failed += !test_packet_time();
+    failed += !test_sensor_payload();
+    failed += !test_spsc_ring();
+
+    printf("test_golden: %s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,13 @@
+/**
+ * @file esp_attr.h
+ * @brief Host shim: placement attributes are meaningless off target.
+ */
+
+#ifndef HOST_SHIM_ESP_ATTR_H
+#define HOST_SHIM_ESP_ATTR_H
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define EXT_RAM_BSS_ATTR
+
+#endif // HOST_SHIM_ESP_ATTR_H
@@ -0,0 +1,11 @@
+/**
+ * @file esp_netif.h
+ * @brief Host shim: the opaque netif handle mqtt.h declares mqtt_mdns_init() with.
+ */
+
+#ifndef HOST_SHIM_ESP_NETIF_H
+#define HOST_SHIM_ESP_NETIF_H
+
+typedef struct esp_netif_obj esp_netif_t;
+
+#endif // HOST_SHIM_ESP_NETIF_H
@@ -0,0 +1,14 @@
+/**
+ * @file esp_timer.h
+ * @brief Host shim: esp_timer_get_time() from CLOCK_MONOTONIC, or a fake
+ *        clock the test steps by hand (host_shims.h).
+ */
+
+#ifndef HOST_SHIM_ESP_TIMER_H
+#define HOST_SHIM_ESP_TIMER_H
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
+
+#endif // HOST_SHIM_ESP_TIMER_H
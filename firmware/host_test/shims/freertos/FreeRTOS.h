@@ -0,0 +1,41 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host shim: the FreeRTOS types, tick macros and critical sections
+ *        the host-built modules use.
+ *
+ * A critical section is a pthread mutex, so portMUX_TYPE-protected state
+ * stays consistent between the test thread and a shimmed task thread.
+ * Ticks are milliseconds (configTICK_RATE_HZ 1000, as in sdkconfig.defaults).
+ */
+
+#ifndef HOST_SHIM_FREERTOS_H
+#define HOST_SHIM_FREERTOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+typedef int32_t  BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t  StackType_t;
+
+typedef struct { int unused; } StaticTask_t;
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              pdTRUE
+#define pdFAIL              pdFALSE
+#define portMAX_DELAY       UINT32_MAX
+#define portNUM_PROCESSORS  2
+#define configTICK_RATE_HZ  1000
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+typedef pthread_mutex_t portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    PTHREAD_MUTEX_INITIALIZER
+#define portENTER_CRITICAL(mux)         pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL(mux)          pthread_mutex_unlock(mux)
+#define portENTER_CRITICAL_ISR(mux)     pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL_ISR(mux)      pthread_mutex_unlock(mux)
+
+#endif // HOST_SHIM_FREERTOS_H
@@ -0,0 +1,24 @@
+/**
+ * @file task.h
+ * @brief Host shim: tasks are detached pthreads; task notifications are a
+ *        counting flag per task behind a condition variable.
+ */
+
+#ifndef HOST_SHIM_FREERTOS_TASK_H
+#define HOST_SHIM_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+/** @brief Start fn(arg) on its own thread; NULL if the thread cannot start. */
+TaskHandle_t host_task_create(TaskFunction_t fn, const char *name, void *arg);
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+void vTaskDelete(TaskHandle_t task);
+
+#endif // HOST_SHIM_FREERTOS_TASK_H
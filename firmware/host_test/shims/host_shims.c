@@ -0,0 +1,250 @@
+/**
+ * @file host_shims.c
+ * @brief Host implementations behind the ESP-IDF shim headers.
+ */
+
+#include "host_shims.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "mem_budget.h"
+#include "sensor_task.h"
+#include "clock_discipline.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/******************************************************************************
+ * LOG
+ *****************************************************************************/
+
+esp_log_level_t host_log_level = ESP_LOG_WARN;
+
+void host_log_write(esp_log_level_t level, const char *tag, const char *fmt, ...)
+{
+    static const char letters[] = "NEWIDV";
+    if (level > host_log_level) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "%c (%s) ", letters[level], tag);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    va_end(ap);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                return "ESP_OK";
+    case ESP_FAIL:              return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:   return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:  return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:     return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:       return "ESP_ERR_TIMEOUT";
+    default:                    return "UNKNOWN ERROR";
+    }
+}
+
+/******************************************************************************
+ * CLOCKS
+ *****************************************************************************/
+
+static atomic_bool     s_fake = false;
+static _Atomic int64_t s_fake_now_us;
+static _Atomic int64_t s_fake_wall_us;
+
+static int64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void host_clock_set_fake(int64_t now_us, int64_t wall_us)
+{
+    s_fake_now_us  = now_us;
+    s_fake_wall_us = wall_us;
+    s_fake         = true;
+}
+
+void host_clock_advance(int64_t us)
+{
+    s_fake_now_us  += us;
+    s_fake_wall_us += us;
+}
+
+void host_clock_use_real(void)
+{
+    s_fake = false;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return s_fake ? s_fake_now_us : monotonic_us();
+}
+
+int host_gettimeofday(struct timeval *tv, void *tz)
+{
+    (void)tz;
+    if (!s_fake) {
+        return gettimeofday(tv, NULL);
+    }
+    int64_t wall = s_fake_wall_us;
+    tv->tv_sec  = (time_t)(wall / 1000000);
+    tv->tv_usec = (suseconds_t)(wall % 1000000);
+    return 0;
+}
+
+/* Acquisition ticks (8 kHz) follow esp_timer time */
+uint32_t get_tick_count(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 125);
+}
+
+/* No SNTP discipline on the host: packet_time.c falls back to the wall clock */
+int64_t clock_discipline_now_utc_us(void)
+{
+    return 0;
+}
+
+/******************************************************************************
+ * TASKS
+ *****************************************************************************/
+
+struct host_task {
+    pthread_t       thread;
+    TaskFunction_t  fn;
+    void           *arg;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    uint32_t        notify;
+};
+
+static _Thread_local struct host_task *s_self;
+
+static void *task_entry(void *p)
+{
+    struct host_task *t = p;
+    s_self = t;
+    t->fn(t->arg);
+    return NULL;
+}
+
+TaskHandle_t host_task_create(TaskFunction_t fn, const char *name, void *arg)
+{
+    (void)name;
+    struct host_task *t = calloc(1, sizeof(*t));
+    if (t == NULL) {
+        return NULL;
+    }
+    t->fn  = fn;
+    t->arg = arg;
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->cond, NULL);
+    if (pthread_create(&t->thread, NULL, task_entry, t) != 0) {
+        free(t);
+        return NULL;
+    }
+    pthread_detach(t->thread);
+    return t;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+    struct host_task *t = s_self;
+    if (t == NULL) {
+        return 0;
+    }
+
+    /* Ticks are real milliseconds even while the fake clock is set */
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec  += ticks_to_wait / 1000;
+    deadline.tv_nsec += (long)(ticks_to_wait % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&t->lock);
+    while (t->notify == 0) {
+        if (pthread_cond_timedwait(&t->cond, &t->lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    uint32_t value = t->notify;
+    if (value > 0) {
+        t->notify = clear_on_exit ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&t->lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->lock);
+    task->notify++;
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = { .tv_sec = ticks / 1000, .tv_nsec = (long)(ticks % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(monotonic_us() / 1000);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL || task == s_self) {
+        pthread_exit(NULL);
+    }
+}
+
+/******************************************************************************
+ * MEMORY BUDGET
+ *****************************************************************************/
+
+/* The static storage is ignored: the thread brings its own stack */
+TaskHandle_t mem_budget_task_create(const char *subsys, const mem_task_storage_t *mem,
+                                    TaskFunction_t fn, const char *name, void *arg,
+                                    UBaseType_t priority, BaseType_t core)
+{
+    (void)subsys;
+    (void)mem;
+    (void)priority;
+    (void)core;
+    return host_task_create(fn, name, arg);
+}
+
+void *mem_budget_reserve(const char *subsys, size_t bytes, bool prefer_psram)
+{
+    (void)subsys;
+    (void)prefer_psram;
+    return malloc(bytes);
+}
+
+void mem_budget_record(const char *subsys, mem_region_t region, size_t bytes)
+{
+    (void)subsys;
+    (void)region;
+    (void)bytes;
+}
@@ -0,0 +1,28 @@
+/**
+ * @file host_shims.h
+ * @brief Test-side controls of the host shims.
+ *
+ * The fake clock drives esp_timer_get_time() (and, for sources built with
+ * -Dgettimeofday=host_gettimeofday, the wall clock) so time-dependent
+ * output such as fault batch timestamps is reproducible.
+ */
+
+#ifndef HOST_SHIMS_H
+#define HOST_SHIMS_H
+
+#include <stdint.h>
+#include <sys/time.h>
+
+/** @brief Freeze esp_timer_get_time() at now_us and the wall clock at wall_us. */
+void host_clock_set_fake(int64_t now_us, int64_t wall_us);
+
+/** @brief Move the fake clocks forward. */
+void host_clock_advance(int64_t us);
+
+/** @brief Back to CLOCK_MONOTONIC and the real wall clock. */
+void host_clock_use_real(void);
+
+/** @brief gettimeofday() that follows the fake clock while it is set. */
+int host_gettimeofday(struct timeval *tv, void *tz);
+
+#endif // HOST_SHIMS_H
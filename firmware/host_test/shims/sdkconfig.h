@@ -0,0 +1,12 @@
+/**
+ * @file sdkconfig.h
+ * @brief Host shim: Kconfig defaults the host-built modules read.
+ *
+ * Empty on purpose: every CONFIG_SHM_* the headers test has a fallback
+ * (cpu_topology.h, sensor_task.c), and the host build uses those.
+ */
+
+#ifndef HOST_SHIM_SDKCONFIG_H
+#define HOST_SHIM_SDKCONFIG_H
+
+#endif // HOST_SHIM_SDKCONFIG_H
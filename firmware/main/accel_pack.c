@@ -0,0 +1,66 @@
+/**
+ * @file accel_pack.c
+ * @brief Lossless delta + zigzag + bit-packed accel encoding (see accel_pack.h).
+ */
+
+#include "accel_pack.h"
+#include <string.h>
+
+static inline uint32_t zigzag32(uint32_t delta)
+{
+    return (delta << 1) ^ (uint32_t)((int32_t)delta >> 31);
+}
+
+static inline uint32_t bit_width(uint32_t v)
+{
+    return v ? 32u - (uint32_t)__builtin_clz(v) : 0u;
+}
+
+size_t accel_pack_encode(const int32_t *const axis[3], uint32_t n, uint8_t *out, size_t cap)
+{
+    if (n == 0 || cap < ACCEL_PACK_MAX_BYTES(n)) {
+        return 0;
+    }
+
+    uint8_t *p = out;
+    uint32_t zz[ACCEL_PACK_BLOCK];
+
+    for (int a = 0; a < 3; a++) {
+        const int32_t *v = axis[a];
+        memcpy(p, &v[0], 4);
+        p += 4;
+
+        for (uint32_t start = 1; start < n; start += ACCEL_PACK_BLOCK) {
+            uint32_t m = n - start;
+            if (m > ACCEL_PACK_BLOCK) {
+                m = ACCEL_PACK_BLOCK;
+            }
+
+            uint32_t all = 0;
+            for (uint32_t k = 0; k < m; k++) {
+                uint32_t i = start + k;
+                zz[k] = zigzag32((uint32_t)v[i] - (uint32_t)v[i - 1]);
+                all  |= zz[k];
+            }
+            uint32_t w = bit_width(all);
+            *p++ = (uint8_t)w;
+
+            /* LSB-first bit stream; at most 32 + 7 pending bits */
+            uint64_t acc   = 0;
+            uint32_t nbits = 0;
+            for (uint32_t k = 0; k < m && w > 0; k++) {
+                acc   |= (uint64_t)zz[k] << nbits;
+                nbits += w;
+                while (nbits >= 8) {
+                    *p++ = (uint8_t)acc;
+                    acc >>= 8;
+                    nbits -= 8;
+                }
+            }
+            if (nbits > 0) {
+                *p++ = (uint8_t)acc;
+            }
+        }
+    }
+    return (size_t)(p - out);
+}
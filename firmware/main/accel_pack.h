@@ -0,0 +1,48 @@
+/**
+ * @file accel_pack.h
+ * @brief Lossless delta + zigzag + bit-packed encoding of an accel batch.
+ *
+ * Used by the version 2 binary frame (mqtt.h, "format":"packed"). At 200 Hz
+ * consecutive decimated samples differ by a few hundred counts, so each
+ * delta needs 8-11 bits instead of the 32 the raw frame spends on it.
+ *
+ * Layout, per axis in x, y, z order:
+ *
+ *   i32  first sample (little-endian)
+ *   then ceil((n - 1) / ACCEL_PACK_BLOCK) blocks of:
+ *     u8   width w (0..32)
+ *     ceil(m * w / 8) bytes: m zigzag deltas of w bits each, LSB first
+ *
+ * m is ACCEL_PACK_BLOCK except for the last block. Deltas are taken modulo
+ * 2^32, so any int32 input round-trips exactly; w = 0 encodes a block of
+ * identical samples in one byte.
+ */
+
+#ifndef ACCEL_PACK_H
+#define ACCEL_PACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ACCEL_PACK_BLOCK    32
+
+/** @brief Worst-case encoded size of n samples (all blocks 32 bits wide). */
+#define ACCEL_PACK_MAX_BYTES(n) \
+    (3u * (4u + (((n) + ACCEL_PACK_BLOCK - 1u) / ACCEL_PACK_BLOCK) + 4u * (n)))
+
+/**
+ * @brief Encode n samples held one array per axis.
+ * @param axis  x, y and z arrays of n samples each
+ * @return Bytes written, or 0 if n is 0 or @p cap is too small.
+ */
+size_t accel_pack_encode(const int32_t *const axis[3], uint32_t n, uint8_t *out, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ACCEL_PACK_H
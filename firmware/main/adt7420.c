@@ -60,6 +60,42 @@ esp_err_t adt7420_init(void)
 }
 
 
+esp_err_t adt7420_read_raw(uint16_t *raw_temp)
+{
+    if (raw_temp == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (adt7420_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t reg_addr = ADT7420_REG_TEMP_MSB;
+    uint8_t data[2] = {0};
+
+    esp_err_t ret = i2c_master_transmit_receive(adt7420_handle, &reg_addr, 1, data, 2,
+                                                ADT7420_READ_TIMEOUT_MS);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // 13-bit resolution, shift out the three flag bits
+    *raw_temp = (uint16_t)(((data[0] << 8) | data[1]) >> 3);
+    return ESP_OK;
+}
+
+float adt7420_raw_to_celsius(uint16_t raw_temp)
+{
+    int16_t code = (int16_t)(raw_temp & 0x1FFF);
+
+    // Handle negative temperatures
+    if (code & 0x1000) {
+        code -= 8192;  // Sign extend for negative values
+    }
+
+    // Convert to Celsius (0.0625°C per LSB)
+    return code * 0.0625f;
+}
+
 esp_err_t adt7420_read_temperature(float *temperature)
 {
     if (temperature == NULL) {
@@ -75,17 +111,7 @@ esp_err_t adt7420_read_temperature(float *temperature)
         return ret;
     }
     
-    // Convert to temperature
-    int16_t raw_temp = (data[0] << 8) | data[1];
-    raw_temp >>= 3;  // 13-bit resolution, shift out unused bits
-    
-    // Handle negative temperatures
-    if (raw_temp & 0x1000) {
-        raw_temp -= 8192;  // Sign extend for negative values
-    }
-    
-    // Convert to Celsius (0.0625°C per LSB)
-    *temperature = raw_temp * 0.0625f;
+    *temperature = adt7420_raw_to_celsius((uint16_t)(((data[0] << 8) | data[1]) >> 3));
     
     return ESP_OK;
 }
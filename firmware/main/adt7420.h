@@ -7,6 +7,7 @@
 #define ADT7420_H
 
 #include "esp_err.h"
+#include <stdint.h>
 #include "driver/i2c_master.h"
 
 extern i2c_master_dev_handle_t adt7420_i2c_handle;
@@ -21,6 +22,10 @@ extern i2c_master_dev_handle_t adt7420_i2c_handle;
 #define ADT7420_REG_CONFIG      0x03
 #define ADT7420_REG_ID          0x0B    // Should read 0xCB
 
+// Bus timeout for the periodic read. Short enough that a dead bus cannot
+// stretch the 1 Hz slow-sensor cadence (init and self-test keep 1000 ms).
+#define ADT7420_READ_TIMEOUT_MS 100
+
 /**
  * @brief Initialize the ADT7420 sensor
  * @return ESP_OK on success
@@ -34,6 +39,22 @@ esp_err_t adt7420_init(void);
  */
 esp_err_t adt7420_read_temperature(float *temperature);
 
+/**
+ * @brief Read the raw 13-bit temperature code (no logging, short timeout)
+ *
+ * Used by the slow-sensors task, which owns the periodic read and its
+ * error reporting. Convert with adt7420_raw_to_celsius().
+ *
+ * @param raw_temp Pointer to store the 13-bit two's complement code
+ * @return ESP_OK on success, I2C error otherwise
+ */
+esp_err_t adt7420_read_raw(uint16_t *raw_temp);
+
+/**
+ * @brief Convert a raw 13-bit code to degrees Celsius (0.0625 °C per LSB)
+ */
+float adt7420_raw_to_celsius(uint16_t raw_temp);
+
 /**
  * @brief Power-on self-test: read temperature and verify it is physically plausible.
  *
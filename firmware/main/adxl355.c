@@ -68,7 +68,9 @@ static esp_err_t adxl355_read_reg(uint8_t reg, uint8_t *data, size_t len)
     t.tx_buffer = tx_buf;
     t.rx_buffer = rx_buf;
 
+    spi_bus_lock();
     esp_err_t err = spi_device_polling_transmit(s_dev, &t);
+    spi_bus_unlock();
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "read failed: reg=0x%02X len=%u err=%s",
                  reg, (unsigned)len, esp_err_to_name(err));
@@ -97,7 +99,9 @@ static esp_err_t adxl355_write_reg(uint8_t reg, uint8_t value)
     t.tx_buffer = tx_buf;
     t.rx_buffer = rx_buf;
 
+    spi_bus_lock();
     esp_err_t err = spi_device_polling_transmit(s_dev, &t);
+    spi_bus_unlock();
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "write failed: reg=0x%02X value=0x%02X err=%s",
                  reg, value, esp_err_to_name(err));
@@ -107,6 +111,27 @@ static esp_err_t adxl355_write_reg(uint8_t reg, uint8_t value)
     return ESP_OK;
 }
 
+static esp_err_t adxl355_add_device(uint32_t clock_hz)
+{
+    spi_device_interface_config_t devcfg = {
+        .clock_speed_hz = (int)clock_hz,
+        .mode = 0, /* CPOL=0, CPHA=0 */
+        .spics_io_num = SPI_CS_ADXL355_IO,
+        .queue_size = 1,
+        .flags = 0, /* full duplex */
+    };
+
+    esp_err_t err = spi_bus_add_device(spi_bus_get_host(), &devcfg, &s_dev);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "spi_bus_add_device failed: %s", esp_err_to_name(err));
+        s_dev = NULL;
+        return err;
+    }
+
+    adxl355_spi_handle = s_dev; //Expose handle for ISR access
+    return ESP_OK;
+}
+
 /* ----- Conversions ----- */
 
 static inline int32_t sign_extend_20b(uint32_t v)
@@ -145,22 +170,11 @@ esp_err_t adxl355_init(void)
     }
 
     /* Add device to shared SPI bus */
-    spi_device_interface_config_t devcfg = {
-        .clock_speed_hz = SPI_CLOCK_SPEED_HZ,
-        .mode = 0, /* CPOL=0, CPHA=0 */
-        .spics_io_num = SPI_CS_ADXL355_IO,
-        .queue_size = 1,
-        .flags = 0, /* full duplex */
-    };
-
-    esp_err_t err = spi_bus_add_device(spi_bus_get_host(), &devcfg, &s_dev);
+    esp_err_t err = adxl355_add_device(spi_bus_get_clock_hz(SPI_BUS_DEV_ADXL355));
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "spi_bus_add_device failed: %s", esp_err_to_name(err));
         return err;
     }
 
-    adxl355_spi_handle = s_dev; //Expose handle for ISR access
-
     /* Optional soft reset for a clean state */
     (void)adxl355_write_reg(ADXL355_REG_RESET, ADXL355_RESET_CODE);
     vTaskDelay(pdMS_TO_TICKS(10));
@@ -397,3 +411,42 @@ esp_err_t adxl355_write_reg_pub(uint8_t reg, uint8_t value)
 {
     return adxl355_write_reg(reg, value);
 }
+
+/* -------------------------------------------------------------------------
+ * SPI clock (spi_bus.h clock profiles)
+ * ---------------------------------------------------------------------- */
+
+esp_err_t adxl355_set_spi_clock(uint32_t clock_hz)
+{
+    if (!s_dev) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* The clock is fixed per device handle: re-add the device */
+    adxl355_spi_handle = NULL;
+    esp_err_t err = spi_bus_remove_device(s_dev);
+    if (err != ESP_OK) {
+        adxl355_spi_handle = s_dev;
+        return err;
+    }
+    s_dev = NULL;
+
+    err = adxl355_add_device(clock_hz);
+    if (err != ESP_OK) {
+        /* Keep the sensor reachable at the rate it had */
+        (void)adxl355_add_device(spi_bus_get_clock_hz(SPI_BUS_DEV_ADXL355));
+    }
+    return err;
+}
+
+bool adxl355_probe_link(void)
+{
+    /* DEVID_AD, DEVID_MST, PARTID in one auto-incrementing read */
+    uint8_t ids[3] = {0};
+    if (adxl355_read_reg(ADXL355_REG_DEVID_AD, ids, sizeof(ids)) != ESP_OK) {
+        return false;
+    }
+    return ids[0] == ADXL355_DEVID_AD_EXPECTED &&
+           ids[1] == ADXL355_DEVID_MST_EXPECTED &&
+           ids[2] == ADXL355_PARTID_EXPECTED;
+}
@@ -159,6 +159,21 @@ esp_err_t adxl355_read_reg_pub(uint8_t reg, uint8_t *data, size_t len);
  */
 esp_err_t adxl355_write_reg_pub(uint8_t reg, uint8_t value);
 
+/**
+ * @brief Re-add the device on the bus at clock_hz (spi_bus.h clock profiles).
+ *
+ * Acquisition must not be reading the sensor. On failure the device is put
+ * back at its previous rate.
+ */
+esp_err_t adxl355_set_spi_clock(uint32_t clock_hz);
+
+/**
+ * @brief One known-answer read of DEVID_AD/DEVID_MST/PARTID.
+ *
+ * @return true when all three IDs read back as expected.
+ */
+bool adxl355_probe_link(void);
+
 #ifdef __cplusplus
 }
 #endif
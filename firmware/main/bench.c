@@ -0,0 +1,638 @@
+/**
+ * @file bench.c
+ * @brief On-target micro-benchmarks (see bench.h).
+ *
+ * Buffers are heap-allocated for the duration of a run and freed before
+ * returning. The micro-benchmarks run in the caller's context; the scenario
+ * state below belongs to the bench task and its producer timer, and only
+ * s_scen_running is read from other tasks.
+ */
+
+#include "bench.h"
+#include "spsc_ring.h"
+#include "decimator.h"
+#include "packet_time.h"
+#include "node_config.h"
+#include "mqtt.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_system.h"
+#include "esp_rom_sys.h"
+#include "esp_rom_crc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static const char *TAG = "BENCH";
+
+#define BENCH_RING_SIZE         1024
+#define BENCH_RING_CHUNK        64
+#define BENCH_UTC_BASE_US       1760400000000000LL     /* Fixed, so digests repeat */
+#define BENCH_BIN_SEQ_OFFSET    8                      /* mqtt.h binary header     */
+#define BENCH_SINE_STEPS        64
+#define BENCH_RESULT_MAX        768
+#define BENCH_TOPIC_BUF_SIZE    64
+#define BENCH_MAX_TASKS         32
+
+SPSC_RING_DEFINE(bench_ring, adxl355_raw_sample_t, BENCH_RING_SIZE)
+
+/* Shared by the ring micro-benchmark and the scenario producer; never both */
+static bench_ring_t s_ring;
+
+/******************************************************************************
+ * HELPERS
+ *****************************************************************************/
+
+static uint32_t s_seed;
+
+static int32_t lcg_noise(int32_t amplitude)
+{
+    s_seed = s_seed * 1664525u + 1013904223u;
+    return (int32_t)((s_seed >> 8) % (uint32_t)(2 * amplitude + 1)) - amplitude;
+}
+
+/** @brief 10 Hz sine of ~0.5 g plus noise on each axis, 8 kHz tick grid. */
+static void fill_raw(adxl355_raw_sample_t *s, uint32_t n, uint32_t period_ticks)
+{
+    s_seed = 0x12345678u;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t tick = i * period_ticks;
+        float    ph   = 2.0f * (float)M_PI * 10.0f * (float)tick / 8000.0f;
+        int32_t  sine = (int32_t)(128000.0f * sinf(ph));
+        s[i].tick  = tick;
+        s[i].raw_x = sine + lcg_noise(2000);
+        s[i].raw_y = (sine >> 1) + lcg_noise(2000);
+        s[i].raw_z = 256000 + lcg_noise(2000);
+    }
+}
+
+static int64_t elapsed_us(int64_t t0)
+{
+    int64_t us = esp_timer_get_time() - t0;
+    return us > 0 ? us : 1;
+}
+
+/******************************************************************************
+ * BENCHMARKS
+ *****************************************************************************/
+
+static void bench_ring_buffer(adxl355_raw_sample_t *src, adxl355_raw_sample_t *dst)
+{
+    bench_ring_t *ring = &s_ring;
+    bench_ring_init(ring, SPSC_DROP_NEWEST);
+    fill_raw(src, BENCH_RING_SAMPLES, 8);
+
+    /* Producer side as the ISR does it, consumer side as the data task does */
+    int64_t  push_us = 0, read_us = 0;
+    uint32_t moved   = 0;
+    while (moved < BENCH_RING_SAMPLES) {
+        int64_t t0 = esp_timer_get_time();
+        for (uint32_t i = 0; i < BENCH_RING_CHUNK; i++) {
+            adxl355_raw_sample_t *slot = bench_ring_claim(ring);
+            *slot = src[moved + i];
+            bench_ring_publish(ring);
+        }
+        int64_t t1 = esp_timer_get_time();
+        moved += bench_ring_read(ring, dst + moved, BENCH_RING_CHUNK);
+        read_us += esp_timer_get_time() - t1;
+        push_us += t1 - t0;
+    }
+
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)dst, BENCH_RING_SAMPLES * sizeof(*dst));
+    ESP_LOGI(TAG, "  ring push:        %6lu ns/sample",
+             (unsigned long)(push_us * 1000 / BENCH_RING_SAMPLES));
+    ESP_LOGI(TAG, "  ring bulk read:   %6lu ns/sample  crc=%08lx",
+             (unsigned long)(read_us * 1000 / BENCH_RING_SAMPLES), (unsigned long)crc);
+}
+
+static void bench_decimator(adxl355_raw_sample_t *src, int32_t *out_buf, uint32_t *out_tick)
+{
+    static decimator_t dec;
+
+    for (uint8_t idx = 0; idx < NODE_CONFIG_ODR_COUNT; idx++) {
+        const adxl355_odr_config_t *odr = node_config_get_odr(idx);
+        if (odr == NULL) {
+            continue;
+        }
+        memset(&dec, 0, sizeof(dec));
+        if (decimator_configure(&dec, odr->odr_hz, odr->isr_tick_divisor) != ESP_OK) {
+            ESP_LOGW(TAG, "  decimator %lu Hz: no profile", (unsigned long)odr->odr_hz);
+            continue;
+        }
+        fill_raw(src, BENCH_DECIM_SAMPLES, odr->isr_tick_divisor);
+
+        uint32_t max_out = BENCH_DECIM_SAMPLES;
+        int32_t *const out[3] = { out_buf, out_buf + max_out, out_buf + 2 * max_out };
+
+        int64_t  t0     = esp_timer_get_time();
+        uint32_t n_used = 0;
+        uint32_t n_out  = decimator_process(&dec, src, BENCH_DECIM_SAMPLES, &n_used,
+                                            out, out_tick, max_out);
+        int64_t  us     = elapsed_us(t0);
+
+        uint32_t crc = 0;
+        for (int k = 0; k < 3; k++) {
+            crc = esp_rom_crc32_le(crc, (const uint8_t *)out[k], n_out * sizeof(int32_t));
+        }
+        crc = esp_rom_crc32_le(crc, (const uint8_t *)out_tick, n_out * sizeof(uint32_t));
+        ESP_LOGI(TAG, "  decimator %4lu Hz: %6lu ns/sample  (%lu in, %lu out)  crc=%08lx",
+                 (unsigned long)odr->odr_hz,
+                 (unsigned long)(us * 1000 / BENCH_DECIM_SAMPLES),
+                 (unsigned long)n_used, (unsigned long)n_out, (unsigned long)crc);
+    }
+}
+
+static void bench_timestamps(char *buf)
+{
+    ts_iso_cursor_t cur;
+    ts_iso_cursor_init(&cur);
+    uint32_t crc = 0;
+
+    const uint32_t n = MQTT_ACCEL_BATCH_SIZE * BENCH_PACKET_ITERATIONS;
+    int64_t t0 = esp_timer_get_time();
+    for (uint32_t i = 0; i < n; i++) {
+        ts_iso_format(&cur, BENCH_UTC_BASE_US + (int64_t)i * 5000, buf);
+    }
+    int64_t us = elapsed_us(t0);
+    crc = esp_rom_crc32_le(crc, (const uint8_t *)buf, TS_ISO_MIN_LEN - 1);
+
+    ESP_LOGI(TAG, "  ISO timestamp:    %6lu ns/sample  crc=%08lx",
+             (unsigned long)(us * 1000 / n), (unsigned long)crc);
+}
+
+/** @brief A full 1 s packet at 200 Hz: 200 accel, 20 incl, one temperature. */
+static void fill_packet(mqtt_sensor_packet_t *p)
+{
+    memset(p, 0, sizeof(*p));
+    s_seed = 0xC0FFEEu;
+
+    p->accel_count        = MQTT_ACCEL_BATCH_SIZE;
+    p->accel_valid        = true;
+    p->accel_period_ticks = 40;
+    for (int i = 0; i < MQTT_ACCEL_BATCH_SIZE; i++) {
+        float ph = 2.0f * (float)M_PI * 10.0f * (float)i / 200.0f;
+        p->accel[0][i] = (int32_t)(128000.0f * sinf(ph)) + lcg_noise(500);
+        p->accel[1][i] = lcg_noise(500);
+        p->accel[2][i] = 256000 + lcg_noise(500);
+    }
+    memset(p->accel_map, 0xFF, sizeof(p->accel_map));
+    mqtt_accel_summary_reset(&p->accel_sum);
+    for (int i = 0; i < MQTT_ACCEL_BATCH_SIZE; i++) {
+        const int32_t xyz[3] = { p->accel[0][i], p->accel[1][i], p->accel[2][i] };
+        mqtt_accel_summary_add(&p->accel_sum, xyz);
+    }
+    mqtt_accel_summary_finish(&p->accel_sum, 0);
+
+    p->incl_count = MQTT_INCL_BATCH_SIZE;
+    p->incl_valid = true;
+    for (int i = 0; i < MQTT_INCL_BATCH_SIZE; i++) {
+        p->incl_tick[i] = (uint32_t)i * 400u;
+        for (int k = 0; k < 3; k++) {
+            p->incl[k][i] = (int16_t)lcg_noise(3000);
+        }
+    }
+
+    p->has_temp        = true;
+    p->temp_valid      = true;
+    p->temperature     = 21.5f;
+    p->temp_tick       = 4000;
+    p->anchor.tick     = 0;
+    p->anchor.utc_us   = BENCH_UTC_BASE_US;
+    p->accel_lsb_per_g = 256000;
+    p->base_tick       = 0;
+    p->base_utc_us     = BENCH_UTC_BASE_US;
+    p->odr_hz          = 1000;
+    p->decim           = 5;
+    p->range           = 1;
+}
+
+static void bench_serializer(const char *name, mqtt_payload_format_t format,
+                             const mqtt_sensor_packet_t *p, char *buf)
+{
+    mqtt_set_payload_format(format);
+
+    size_t  len   = 0;
+    size_t  total = 0;
+    int64_t t0    = esp_timer_get_time();
+    for (int it = 0; it < BENCH_PACKET_ITERATIONS; it++) {
+        esp_err_t err = (format == MQTT_PAYLOAD_JSON)
+            ? mqtt_serialize_sensor_data(p, buf, MQTT_DATA_PAYLOAD_MAX, &len)
+            : mqtt_serialize_sensor_binary(p, buf, MQTT_DATA_PAYLOAD_MAX, &len);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "  %s: serialize failed (%s)", name, esp_err_to_name(err));
+            return;
+        }
+        total += len;
+    }
+    int64_t us = elapsed_us(t0);
+
+    if (format != MQTT_PAYLOAD_JSON && len >= BENCH_BIN_SEQ_OFFSET + 4) {
+        memset(buf + BENCH_BIN_SEQ_OFFSET, 0, 4);
+    }
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)buf, (uint32_t)len);
+
+    ESP_LOGI(TAG, "  %-16s  %6lu us/packet  %8lld bytes/s  (%u bytes)  crc=%08lx",
+             name, (unsigned long)(us / BENCH_PACKET_ITERATIONS),
+             (long long)total * 1000000LL / us, (unsigned)len, (unsigned long)crc);
+}
+
+/******************************************************************************
+ * SCENARIO
+ *****************************************************************************/
+
+/** Cycle counts of one stage: calls, sum and worst case. */
+typedef struct {
+    uint32_t n;
+    uint64_t sum;
+    uint32_t max;
+} stage_stat_t;
+
+static volatile bool s_scen_running = false;
+static uint32_t      s_scen_seconds;
+static uint32_t      s_scen_seq;
+
+/* Producer (esp_timer task) -- written there, read by the bench task at the end */
+static stage_stat_t  s_produce;
+static uint32_t      s_prod_tick;
+static uint32_t      s_prod_acc;
+static uint32_t      s_prod_phase;
+static uint32_t      s_prod_odr_hz;
+static uint32_t      s_prod_period_ticks;
+static int32_t       s_sine[BENCH_SINE_STEPS];
+
+static decimator_t   s_scen_decim;
+
+static inline void stage_add(stage_stat_t *st, uint32_t cycles)
+{
+    st->n++;
+    st->sum += cycles;
+    if (cycles > st->max) {
+        st->max = cycles;
+    }
+}
+
+/**
+ * @brief Stand-in for the sensor ISR: every BENCH_PRODUCE_PERIOD_US, push
+ *        the samples the configured ODR would have produced meanwhile.
+ */
+static void scenario_produce_cb(void *arg)
+{
+    uint32_t c0 = esp_cpu_get_cycle_count();
+
+    s_prod_acc += s_prod_odr_hz * BENCH_PRODUCE_PERIOD_US;
+    while (s_prod_acc >= 1000000u) {
+        s_prod_acc -= 1000000u;
+        adxl355_raw_sample_t *slot = bench_ring_claim(&s_ring);
+        if (slot != NULL) {
+            int32_t sine = s_sine[s_prod_phase++ % BENCH_SINE_STEPS];
+            slot->tick  = s_prod_tick;
+            slot->raw_x = sine;
+            slot->raw_y = sine >> 1;
+            slot->raw_z = 256000 + (sine >> 4);
+            bench_ring_publish(&s_ring);
+        }
+        s_prod_tick += s_prod_period_ticks;
+    }
+
+    stage_add(&s_produce, esp_cpu_get_cycle_count() - c0);
+}
+
+/**
+ * @brief Busy time of each core since the previous call, in 0.1 %.
+ *
+ * The IDLE task of a core runs whenever nothing else does, so its share of
+ * the run-time counter is that core's idle time.
+ */
+#if (configUSE_TRACE_FACILITY == 1) && (configGENERATE_RUN_TIME_STATS == 1)
+
+static TaskStatus_t s_task_status[BENCH_MAX_TASKS];
+
+static bool idle_counters(uint32_t idle[portNUM_PROCESSORS], uint32_t *total)
+{
+    UBaseType_t n = uxTaskGetSystemState(s_task_status, BENCH_MAX_TASKS, total);
+    if (n == 0) {
+        return false;
+    }
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        TaskHandle_t h = xTaskGetIdleTaskHandleForCore(core);
+        idle[core] = 0;
+        for (UBaseType_t i = 0; i < n; i++) {
+            if (s_task_status[i].xHandle == h) {
+                idle[core] = s_task_status[i].ulRunTimeCounter;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+#else
+
+static bool idle_counters(uint32_t idle[portNUM_PROCESSORS], uint32_t *total)
+{
+    return false;
+}
+
+#endif
+
+static int append_stage(char *buf, size_t cap, int off, const char *name,
+                        const stage_stat_t *st)
+{
+    if (off >= (int)cap) {
+        return off;
+    }
+    uint32_t avg = st->n ? (uint32_t)(st->sum / st->n) : 0;
+    return off + snprintf(buf + off, cap - off, ",\"%s\":[%lu,%lu,%lu]", name,
+                          (unsigned long)st->n, (unsigned long)avg, (unsigned long)st->max);
+}
+
+/** @brief Header fields as publish_packet() sets them for a live packet. */
+static void scenario_finish_packet(mqtt_sensor_packet_t *p, const node_runtime_config_t *cfg,
+                                   uint32_t base_tick, int64_t utc_us)
+{
+    p->accel_count        = MQTT_ACCEL_BATCH_SIZE;
+    p->accel_valid        = true;
+    p->accel_period_ticks = (uint16_t)(cfg->decim_factor * cfg->isr_tick_divisor);
+    memset(p->accel_map, 0xFF, sizeof(p->accel_map));
+    mqtt_accel_summary_reset(&p->accel_sum);
+    for (int i = 0; i < MQTT_ACCEL_BATCH_SIZE; i++) {
+        const int32_t xyz[3] = { p->accel[0][i], p->accel[1][i], p->accel[2][i] };
+        mqtt_accel_summary_add(&p->accel_sum, xyz);
+    }
+    mqtt_accel_summary_finish(&p->accel_sum, 0);
+    p->incl_valid         = false;
+    p->incl_count         = 0;
+    p->has_temp           = false;
+    p->temp_valid         = false;
+    p->anchor.tick        = base_tick;
+    p->anchor.utc_us      = utc_us;
+    p->base_tick          = base_tick;
+    p->base_utc_us        = utc_us;
+    p->odr_hz             = cfg->odr_hz;
+    p->decim              = (uint8_t)cfg->decim_factor;
+    p->range              = cfg->range;
+    p->cfg_epoch          = (uint8_t)cfg->epoch;
+    p->accel_lsb_per_g    = (uint32_t)cfg->sensitivity_lsb_g;
+}
+
+static void scenario_task(void *arg)
+{
+    /* Copied: a configure during the run must not change the run's shape */
+    const node_runtime_config_t cfg_copy = *node_config_get();
+    const node_runtime_config_t *cfg = &cfg_copy;
+    mqtt_payload_format_t format = mqtt_get_payload_format();
+
+    mqtt_sensor_packet_t *packet = malloc(sizeof(mqtt_sensor_packet_t));
+    char                 *buf    = malloc(MQTT_DATA_PAYLOAD_MAX);
+    char                 *doc    = malloc(BENCH_RESULT_MAX);
+    esp_timer_handle_t    timer  = NULL;
+    const char           *error  = NULL;
+
+    stage_stat_t decimate = {0}, serialize = {0}, publish = {0};
+    uint32_t packets = 0, pub_fail = 0, bytes = 0;
+    uint32_t heap_start = esp_get_free_heap_size();
+    uint32_t heap_min = heap_start, heap_max = heap_start;
+
+    char topic[BENCH_TOPIC_BUF_SIZE];
+    snprintf(topic, sizeof(topic), "%s/%s/%s",
+             MQTT_TOPIC_PREFIX, mqtt_get_serial_no(), BENCH_TOPIC_SUFFIX);
+
+    memset(&s_scen_decim, 0, sizeof(s_scen_decim));
+    if (packet == NULL || buf == NULL || doc == NULL) {
+        error = "out of memory";
+    } else if (decimator_configure(&s_scen_decim, cfg->odr_hz, cfg->isr_tick_divisor) != ESP_OK) {
+        error = "no decimator profile";
+    }
+
+    /* Producer state, then the timer that plays the ISR */
+    memset(&s_produce, 0, sizeof(s_produce));
+    for (int i = 0; i < BENCH_SINE_STEPS; i++) {
+        s_sine[i] = (int32_t)(128000.0f * sinf(2.0f * (float)M_PI * (float)i / BENCH_SINE_STEPS));
+    }
+    s_prod_tick         = 0;
+    s_prod_acc          = 0;
+    s_prod_phase        = 0;
+    s_prod_odr_hz       = cfg->odr_hz;
+    s_prod_period_ticks = cfg->isr_tick_divisor;
+    bench_ring_init(&s_ring, SPSC_DROP_NEWEST);
+
+    const esp_timer_create_args_t targs = {
+        .callback = scenario_produce_cb,
+        .name     = "bench_isr",
+    };
+    if (error == NULL &&
+        (esp_timer_create(&targs, &timer) != ESP_OK ||
+         esp_timer_start_periodic(timer, BENCH_PRODUCE_PERIOD_US) != ESP_OK)) {
+        error = "timer start failed";
+    }
+
+    uint32_t idle0[portNUM_PROCESSORS] = {0}, idle1[portNUM_PROCESSORS] = {0};
+    uint32_t total0 = 0, total1 = 0;
+    bool have_cpu = idle_counters(idle0, &total0);
+
+    ESP_LOGI(TAG, "Scenario: %lu s at %lu Hz, topic %s",
+             (unsigned long)s_scen_seconds, (unsigned long)cfg->odr_hz, topic);
+
+    int64_t  t_end      = esp_timer_get_time() + (int64_t)s_scen_seconds * 1000000LL;
+    int64_t  utc_base   = esp_timer_get_time();
+    uint32_t count      = 0;
+    uint32_t base_tick  = 0;
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (error == NULL && esp_timer_get_time() < t_end) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(BENCH_DRAIN_PERIOD_MS));
+
+        /* ---- Decimate one drain pass, in place on the ring ---- */
+        const adxl355_raw_sample_t *span;
+        uint32_t avail;
+        while ((avail = bench_ring_peek(&s_ring, &span)) > 0) {
+            uint32_t c0 = esp_cpu_get_cycle_count();
+            int32_t *const out[3] = { &packet->accel[0][count], &packet->accel[1][count],
+                                      &packet->accel[2][count] };
+            uint32_t used  = 0;
+            uint32_t ticks[MQTT_ACCEL_BATCH_SIZE];
+            uint32_t n_out = decimator_process(&s_scen_decim, span, avail, &used, out,
+                                               ticks, MQTT_ACCEL_BATCH_SIZE - count);
+            bench_ring_commit(&s_ring, used);
+            stage_add(&decimate, esp_cpu_get_cycle_count() - c0);
+
+            if (count == 0 && n_out > 0) {
+                base_tick = ticks[0];
+            }
+            count += n_out;
+            if (count < MQTT_ACCEL_BATCH_SIZE) {
+                continue;
+            }
+
+            /* ---- Full packet: serialize in the live format, then publish ---- */
+            scenario_finish_packet(packet, cfg, base_tick,
+                                   BENCH_UTC_BASE_US + (esp_timer_get_time() - utc_base));
+            packet->seq = packets;
+            count = 0;
+
+            size_t len = 0;
+            c0 = esp_cpu_get_cycle_count();
+            esp_err_t err = (format == MQTT_PAYLOAD_JSON)
+                ? mqtt_serialize_sensor_data(packet, buf, MQTT_DATA_PAYLOAD_MAX, &len)
+                : mqtt_serialize_sensor_binary(packet, buf, MQTT_DATA_PAYLOAD_MAX, &len);
+            stage_add(&serialize, esp_cpu_get_cycle_count() - c0);
+            if (err != ESP_OK) {
+                error = "serialize failed";
+                break;
+            }
+
+            c0 = esp_cpu_get_cycle_count();
+            err = mqtt_publish(topic, buf, (int)len);
+            stage_add(&publish, esp_cpu_get_cycle_count() - c0);
+            packets++;
+            if (err == ESP_OK) {
+                bytes += (uint32_t)len;
+            } else {
+                pub_fail++;
+            }
+        }
+
+        uint32_t heap = esp_get_free_heap_size();
+        if (heap < heap_min) heap_min = heap;
+        if (heap > heap_max) heap_max = heap;
+    }
+
+    if (timer != NULL) {
+        esp_timer_stop(timer);
+        esp_timer_delete(timer);
+    }
+    have_cpu = have_cpu && idle_counters(idle1, &total1);
+    uint32_t heap_end = esp_get_free_heap_size();
+
+    /* ---- Result document ---- */
+    if (doc != NULL) {
+        size_t cap = BENCH_RESULT_MAX;
+        int off = snprintf(doc, cap,
+                           "{\"state\":\"%s\",\"cmd_ack\":\"bench\",\"seq_ack\":%lu",
+                           node_state_str(node_config_get_state()), (unsigned long)s_scen_seq);
+        if (error != NULL) {
+            off += snprintf(doc + off, cap - off, ",\"error\":\"%s\"", error);
+        }
+        off += snprintf(doc + off, cap - off,
+                        ",\"bench\":{\"s\":%lu,\"odr_hz\":%lu,\"format\":\"%s\",\"cpu_mhz\":%lu",
+                        (unsigned long)s_scen_seconds, (unsigned long)cfg->odr_hz,
+                        format == MQTT_PAYLOAD_JSON ? "json" :
+                        format == MQTT_PAYLOAD_PACKED ? "packed" : "bin",
+                        (unsigned long)esp_rom_get_cpu_ticks_per_us());
+        off = append_stage(doc, cap, off, "produce",   &s_produce);
+        off = append_stage(doc, cap, off, "decimate",  &decimate);
+        off = append_stage(doc, cap, off, "serialize", &serialize);
+        off = append_stage(doc, cap, off, "publish",   &publish);
+        if (off < (int)cap) {
+            off += snprintf(doc + off, cap - off,
+                            ",\"packets\":%lu,\"pub_fail\":%lu,\"bytes\":%lu,\"ring_drop\":%lu,\"cpu_x10\":[",
+                            (unsigned long)packets, (unsigned long)pub_fail,
+                            (unsigned long)bytes, (unsigned long)s_ring.overflow);
+        }
+        for (int core = 0; core < portNUM_PROCESSORS && off < (int)cap; core++) {
+            long busy_x10 = -1;
+            uint32_t d_total = total1 - total0;
+            if (have_cpu && d_total > 0) {
+                uint32_t d_idle = idle1[core] - idle0[core];
+                busy_x10 = 1000 - (long)(((uint64_t)d_idle * 1000u) / d_total);
+                if (busy_x10 < 0) busy_x10 = 0;
+            }
+            off += snprintf(doc + off, cap - off, "%s%ld", core ? "," : "", busy_x10);
+        }
+        if (off < (int)cap) {
+            off += snprintf(doc + off, cap - off, "],\"heap\":[%lu,%lu,%lu,%lu]}}",
+                            (unsigned long)heap_start, (unsigned long)heap_end,
+                            (unsigned long)heap_min, (unsigned long)heap_max);
+        }
+
+        if (off >= (int)cap) {
+            ESP_LOGE(TAG, "Scenario result does not fit %d bytes", BENCH_RESULT_MAX);
+        } else {
+            ESP_LOGI(TAG, "Scenario result: %s", doc);
+            if (mqtt_publish(mqtt_get_topic_status(), doc, off) != ESP_OK) {
+                ESP_LOGW(TAG, "Scenario result not published");
+            }
+        }
+    }
+
+    free(doc);
+    free(buf);
+    free(packet);
+    s_scen_running = false;
+    vTaskDelete(NULL);
+}
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+esp_err_t bench_start_scenario(uint32_t seconds, uint32_t seq)
+{
+    if (seconds == 0 || seconds > BENCH_MAX_SECONDS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_scen_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_scen_running = true;
+    s_scen_seconds = seconds;
+    s_scen_seq     = seq;
+
+    BaseType_t ret = xTaskCreatePinnedToCore(scenario_task, "bench",
+                                             BENCH_TASK_STACK_SIZE, NULL,
+                                             BENCH_TASK_PRIORITY, NULL,
+                                             BENCH_TASK_CORE);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create bench task");
+        s_scen_running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+bool bench_is_running(void)
+{
+    return s_scen_running;
+}
+
+void bench_run_micro(void)
+{
+    adxl355_raw_sample_t *src      = malloc(BENCH_DECIM_SAMPLES * sizeof(adxl355_raw_sample_t));
+    adxl355_raw_sample_t *dst      = malloc(BENCH_RING_SAMPLES * sizeof(adxl355_raw_sample_t));
+    int32_t              *out_buf  = malloc(3 * BENCH_DECIM_SAMPLES * sizeof(int32_t));
+    uint32_t             *out_tick = malloc(BENCH_DECIM_SAMPLES * sizeof(uint32_t));
+    mqtt_sensor_packet_t *packet   = malloc(sizeof(mqtt_sensor_packet_t));
+    char                 *buf      = malloc(MQTT_DATA_PAYLOAD_MAX);
+
+    if (!src || !dst || !out_buf || !out_tick || !packet || !buf) {
+        ESP_LOGE(TAG, "Benchmark: out of memory");
+        goto done;
+    }
+
+    ESP_LOGI(TAG, "========== Micro-benchmarks ==========");
+    bench_ring_buffer(src, dst);
+    bench_decimator(src, out_buf, out_tick);
+    bench_timestamps(buf);
+
+    fill_packet(packet);
+    mqtt_payload_format_t saved = mqtt_get_payload_format();
+    bench_serializer("JSON:",      MQTT_PAYLOAD_JSON,   packet, buf);
+    bench_serializer("binary v1:", MQTT_PAYLOAD_BINARY, packet, buf);
+    bench_serializer("packed v2:", MQTT_PAYLOAD_PACKED, packet, buf);
+    mqtt_set_payload_format(saved);
+    ESP_LOGI(TAG, "======================================");
+
+done:
+    free(buf);
+    free(packet);
+    free(out_tick);
+    free(out_buf);
+    free(dst);
+    free(src);
+}
@@ -0,0 +1,115 @@
+/**
+ * @file bench.h
+ * @brief On-target micro-benchmarks of the pure-logic hot paths.
+ *
+ * Each benchmark feeds a fixed, deterministic input (LCG noise on a sine)
+ * through the real module code and logs:
+ *
+ *   - time per unit of work (ns/sample, ns/packet) from esp_timer,
+ *   - throughput for the serializers (bytes/s),
+ *   - a CRC32 digest of the output.
+ *
+ * Identical inputs must give the same digest on every build, so a change in
+ * the log between two firmware versions means the output changed, not just
+ * the speed. The binary digests skip the frame sequence field, which is
+ * global state. The asserted golden outputs live in firmware/host_test:
+ * the same modules built for the host, checked against files in golden/
+ * by ctest, plus a host runner (bench_host) of these benchmarks.
+ *
+ * Covered: the SPSC ring (claim/publish and bulk read), the decimator at
+ * each ODR profile, ISO timestamp formatting, and the JSON, binary v1 and
+ * packed v2 serializers. json_writer_benchmark() stays the
+ * snprintf-vs-writer comparison.
+ *
+ * bench_run_micro() changes the payload format while it runs and restores
+ * it afterwards, so call it only while the node is not recording.
+ *
+ * Scenario benchmark
+ * ==================
+ * The control command {"cmd":"bench","seconds":10,"seq":N} (idle or
+ * configured only) runs the live path on the node under its real network
+ * load. For "seconds", an esp_timer callback plays the ISR and pushes
+ * synthetic samples at the configured ODR into a ring. A bench task on the
+ * data task's core then drains the ring through the real decimator, fills a
+ * packet, serializes it in the current payload format and hands it to
+ * esp_mqtt_client_publish() on wind_turbine/<SERIAL>/bench, a topic the
+ * Pi does not store. The result is published on the status topic:
+ *
+ *   {"state":"configured","cmd_ack":"bench","seq_ack":7,
+ *    "bench":{"s":10,"odr_hz":1000,"format":"bin","cpu_mhz":240,
+ *      "produce":[n,avg,max],"decimate":[..],"serialize":[..],"publish":[..],
+ *      "packets":10,"pub_fail":0,"bytes":25960,"ring_drop":0,
+ *      "cpu_x10":[core0,core1],"heap":[start,end,min,max]}}
+ *
+ * Stage triples are one call each, in CPU cycles. "produce" is one timer
+ * callback, "decimate" one drain pass, "serialize" and "publish" one
+ * packet. cpu_x10 is each core's busy share over the run, in 0.1 %,
+ * derived from the IDLE tasks' run-time counters (-1 without FreeRTOS run-time
+ * stats). heap is the free heap sampled once per drain pass: max - min is the
+ * churn of the live path.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "esp_err.h"
+#include "cpu_topology.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * CONFIGURATION
+ *****************************************************************************/
+
+/**
+ * Set to 1 to run bench_run_micro() once at boot, before the network comes
+ * up. Leave at 0 for deployment.
+ */
+#define BENCH_RUN_AT_BOOT           0
+
+#define BENCH_RING_SAMPLES          8192    /**< Pushed and drained per ring pass  */
+#define BENCH_DECIM_SAMPLES         16000   /**< Raw samples per ODR profile       */
+#define BENCH_PACKET_ITERATIONS     20      /**< Serializer runs per format        */
+
+#define BENCH_TOPIC_SUFFIX          "bench"
+#define BENCH_DEFAULT_SECONDS       10
+#define BENCH_MAX_SECONDS           60
+#define BENCH_PRODUCE_PERIOD_US     1000    /**< Synthetic "ISR" period            */
+#define BENCH_DRAIN_PERIOD_MS       10      /**< Bench task pass, like the data task */
+
+/* Same core and priority as the data task, which is idle while not recording */
+#define BENCH_TASK_STACK_SIZE       6144
+#define BENCH_TASK_PRIORITY         5
+#define BENCH_TASK_CORE             SHM_CORE_ACQ
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/** @brief Run every micro-benchmark and log the results under tag "BENCH". */
+void bench_run_micro(void);
+
+/**
+ * @brief Start the scenario benchmark in its own task and return at once.
+ *
+ * The result document is published on the status topic when it finishes.
+ *
+ * @param seconds  1..BENCH_MAX_SECONDS
+ * @param seq      Echoed as seq_ack in the result
+ * @return ESP_ERR_INVALID_STATE if one is already running,
+ *         ESP_ERR_INVALID_ARG for a bad duration, ESP_ERR_NO_MEM
+ */
+esp_err_t bench_start_scenario(uint32_t seconds, uint32_t seq);
+
+/** @brief True while a scenario benchmark is running. */
+bool bench_is_running(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BENCH_H
@@ -0,0 +1,241 @@
+/**
+ * @file boot_seq.c
+ * @brief Boot orchestrator (see boot_seq.h).
+ *
+ * One event group bit per phase, set when the phase finishes. Lane tasks
+ * only read the phase table and write their own phases' results; the
+ * calling task reads the results after it has seen every bit.
+ */
+
+#include "boot_seq.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "BOOT";
+
+static const boot_phase_desc_t *s_table = NULL;
+static size_t                   s_count = 0;
+
+static EventGroupHandle_t  s_done_group = NULL;
+static boot_phase_result_t s_results[BOOT_PHASE_COUNT];
+
+static volatile uint32_t s_total_ms        = 0;
+static volatile uint32_t s_first_packet_ms = 0;
+static volatile bool     s_status_sent     = false;
+
+static inline uint32_t uptime_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+/******************************************************************************
+ * LANES
+ *****************************************************************************/
+
+static void run_phase(const boot_phase_desc_t *d)
+{
+    if (d->deps != 0u) {
+        xEventGroupWaitBits(s_done_group, d->deps, pdFALSE, pdTRUE, portMAX_DELAY);
+    }
+
+    boot_phase_result_t *r = &s_results[d->id];
+    r->start_ms = uptime_ms();
+    r->err      = d->fn();
+    r->dur_ms   = uptime_ms() - r->start_ms;
+    r->done     = true;
+
+    if (r->err == ESP_OK) {
+        ESP_LOGI(TAG, "Phase %s done in %lu ms (at %lu ms)", boot_phase_name(d->id),
+                 (unsigned long)r->dur_ms, (unsigned long)r->start_ms);
+    } else {
+        ESP_LOGW(TAG, "Phase %s failed after %lu ms: %s", boot_phase_name(d->id),
+                 (unsigned long)r->dur_ms, esp_err_to_name(r->err));
+    }
+    xEventGroupSetBits(s_done_group, BOOT_PHASE_BIT(d->id));
+}
+
+static void run_lane(uint8_t lane)
+{
+    for (size_t i = 0; i < s_count; i++) {
+        if (s_table[i].lane == lane) {
+            run_phase(&s_table[i]);
+        }
+    }
+}
+
+static void lane_task(void *arg)
+{
+    run_lane((uint8_t)(uintptr_t)arg);
+    vTaskDelete(NULL);
+}
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+esp_err_t boot_seq_run(const boot_phase_desc_t *phases, size_t count)
+{
+    if (phases == NULL || count == 0 || count > BOOT_PHASE_COUNT || s_table != NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Dependencies must be listed earlier: no phase can then wait on one
+     * that waits on it, and the table is also valid run sequentially */
+    uint32_t listed = 0;
+    for (size_t i = 0; i < count; i++) {
+        const boot_phase_desc_t *d = &phases[i];
+        if (d->id >= BOOT_PHASE_COUNT || d->fn == NULL || d->lane >= BOOT_SEQ_MAX_LANES ||
+            (listed & BOOT_PHASE_BIT(d->id)) || (d->deps & ~listed)) {
+            ESP_LOGE(TAG, "Bad boot table entry %u", (unsigned)i);
+            return ESP_ERR_INVALID_ARG;
+        }
+        listed |= BOOT_PHASE_BIT(d->id);
+    }
+
+    s_done_group = xEventGroupCreate();
+    if (s_done_group == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_table = phases;
+    s_count = count;
+
+    esp_err_t ret = ESP_OK;
+    for (uint8_t lane = 1; lane < BOOT_SEQ_MAX_LANES; lane++) {
+        char name[12];
+        snprintf(name, sizeof(name), "boot_l%u", (unsigned)lane);
+        if (xTaskCreatePinnedToCore(lane_task, name, BOOT_SEQ_LANE_STACK_SIZE,
+                                    (void *)(uintptr_t)lane, BOOT_SEQ_LANE_PRIORITY,
+                                    NULL, BOOT_SEQ_LANE_CORE) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create boot lane %u -- running it sequentially",
+                     (unsigned)lane);
+            ret = ESP_FAIL;
+            /* Table order is a valid sequential order; run from the top */
+            for (size_t i = 0; i < count; i++) {
+                if (!(xEventGroupGetBits(s_done_group) & BOOT_PHASE_BIT(phases[i].id)) &&
+                    (phases[i].lane == lane || phases[i].lane == 0)) {
+                    run_phase(&phases[i]);
+                }
+            }
+        }
+    }
+
+    /* Lane 0 phases already run by a fallback above are skipped */
+    for (size_t i = 0; i < count; i++) {
+        if (phases[i].lane == 0 &&
+            !(xEventGroupGetBits(s_done_group) & BOOT_PHASE_BIT(phases[i].id))) {
+            run_phase(&phases[i]);
+        }
+    }
+
+    xEventGroupWaitBits(s_done_group, listed, pdFALSE, pdTRUE, portMAX_DELAY);
+    s_total_ms = uptime_ms();
+
+    ESP_LOGI(TAG, "Boot phases complete at %lu ms:", (unsigned long)s_total_ms);
+    for (size_t i = 0; i < count; i++) {
+        const boot_phase_result_t *r = &s_results[phases[i].id];
+        ESP_LOGI(TAG, "  %-12s lane %u  start %6lu ms  took %6lu ms  %s",
+                 boot_phase_name(phases[i].id), (unsigned)phases[i].lane,
+                 (unsigned long)r->start_ms, (unsigned long)r->dur_ms,
+                 r->err == ESP_OK ? "ok" : esp_err_to_name(r->err));
+    }
+    return ret;
+}
+
+bool boot_seq_finished(boot_phase_t phase)
+{
+    return phase < BOOT_PHASE_COUNT && s_results[phase].done;
+}
+
+bool boot_seq_ok(boot_phase_t phase)
+{
+    return boot_seq_finished(phase) && s_results[phase].err == ESP_OK;
+}
+
+void boot_seq_get(boot_phase_t phase, boot_phase_result_t *out)
+{
+    if (out == NULL) {
+        return;
+    }
+    if (phase >= BOOT_PHASE_COUNT) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    *out = s_results[phase];
+}
+
+const char *boot_phase_name(boot_phase_t phase)
+{
+    switch (phase) {
+        case BOOT_PHASE_NETWORK:     return "network";
+        case BOOT_PHASE_MQTT:        return "mqtt";
+        case BOOT_PHASE_SNTP:        return "sntp";
+        case BOOT_PHASE_BUSES:       return "buses";
+        case BOOT_PHASE_SENSORS:     return "sensors";
+        case BOOT_PHASE_ACQUISITION: return "acquisition";
+        case BOOT_PHASE_DATA_TASK:   return "data_task";
+        default:                     return "unknown";
+    }
+}
+
+uint32_t boot_seq_total_ms(void)
+{
+    return s_total_ms;
+}
+
+void boot_seq_note_first_packet(void)
+{
+    if (s_first_packet_ms == 0) {
+        s_first_packet_ms = uptime_ms();
+        ESP_LOGI(TAG, "First data packet published %lu ms after power-on",
+                 (unsigned long)s_first_packet_ms);
+    }
+}
+
+uint32_t boot_seq_first_packet_ms(void)
+{
+    return s_first_packet_ms;
+}
+
+int boot_seq_format_status(char *buf, size_t len)
+{
+    if (s_total_ms == 0 || s_status_sent || len == 0) {
+        return 0;
+    }
+
+    int off = snprintf(buf, len, ",\"boot\":{\"total_ms\":%lu,\"first_pkt_ms\":%lu,\"phases\":{",
+                       (unsigned long)s_total_ms, (unsigned long)s_first_packet_ms);
+    bool first = true;
+    for (size_t i = 0; i < s_count && off > 0 && (size_t)off < len; i++) {
+        const boot_phase_result_t *r = &s_results[s_table[i].id];
+        off += snprintf(buf + off, len - off, "%s\"%s\":[%lu,%lu]",
+                        first ? "" : ",", boot_phase_name(s_table[i].id),
+                        (unsigned long)r->start_ms, (unsigned long)r->dur_ms);
+        first = false;
+    }
+    if (off > 0 && (size_t)off < len) {
+        off += snprintf(buf + off, len - off, "}}");
+    }
+
+    if (off < 0) {
+        return 0;
+    }
+    if ((size_t)off >= len) {
+        /* Truncated: drop the whole object rather than emit broken JSON */
+        buf[0] = '\0';
+        return 0;
+    }
+    return off;
+}
+
+void boot_seq_status_sent(void)
+{
+    if (s_total_ms != 0) {
+        s_status_sent = true;
+    }
+}
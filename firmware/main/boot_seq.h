@@ -0,0 +1,136 @@
+/**
+ * @file boot_seq.h
+ * @brief Boot orchestrator: init phases run concurrently, with dependencies
+ *        and per-phase timing.
+ *
+ * app_main() used to bring everything up strictly in line, so the sensors
+ * and acquisition waited behind DHCP, mDNS, the broker connection and the
+ * first SNTP sync (tens of seconds with the switch still booting after a
+ * power blip). Boot is now a table of phases:
+ *
+ *   lane 0 (app_main)   BUSES -> SENSORS -> ACQUISITION -> DATA_TASK
+ *   lane 1 (boot_l1)    NETWORK -> MQTT -> SNTP
+ *
+ * Each lane runs its phases in table order; lanes other than 0 run in
+ * short-lived tasks. A phase first waits for every phase in its deps mask
+ * to finish, successfully or not, so a failed dependency never deadlocks
+ * boot. A phase that needs a dependency's result checks boot_seq_ok().
+ *
+ * Every phase records its start and duration since power-on (esp_timer).
+ * The first status message published after boot carries them:
+ *
+ *   "boot":{"total_ms":..,"first_pkt_ms":..,
+ *           "phases":{"network":[start_ms,dur_ms],..,"sensors":[..]}}
+ *
+ * first_pkt_ms is power-on to the first data packet that reached the
+ * broker or the UDP stream, 0 until then; STATS and metrics report it too.
+ */
+
+#ifndef BOOT_SEQ_H
+#define BOOT_SEQ_H
+
+#include "esp_err.h"
+#include "cpu_topology.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * CONFIGURATION
+ *****************************************************************************/
+
+#define BOOT_SEQ_MAX_LANES          2
+
+/* mDNS, MQTT client and SNTP setup run on the network lane */
+#define BOOT_SEQ_LANE_STACK_SIZE    6144
+#define BOOT_SEQ_LANE_PRIORITY      5
+#define BOOT_SEQ_LANE_CORE          SHM_CORE_NET
+
+typedef enum {
+    BOOT_PHASE_NETWORK     = 0,     /**< Ethernet driver + DHCP            */
+    BOOT_PHASE_MQTT        = 1,     /**< mDNS, client, broker connection   */
+    BOOT_PHASE_SNTP        = 2,     /**< SNTP client + first sync          */
+    BOOT_PHASE_BUSES       = 3,     /**< I2C and SPI masters               */
+    BOOT_PHASE_SENSORS     = 4,     /**< Sensor init + POST                */
+    BOOT_PHASE_ACQUISITION = 5,     /**< GPTimer, rings, sync-start task   */
+    BOOT_PHASE_DATA_TASK   = 6,     /**< Data processing + publish tasks   */
+    BOOT_PHASE_COUNT
+} boot_phase_t;
+
+#define BOOT_PHASE_BIT(p)           (1u << (p))
+
+typedef esp_err_t (*boot_phase_fn_t)(void);
+
+typedef struct {
+    boot_phase_t    id;
+    boot_phase_fn_t fn;
+    uint32_t        deps;       /**< BOOT_PHASE_BIT() mask to wait for     */
+    uint8_t         lane;       /**< 0 = calling task                      */
+} boot_phase_desc_t;
+
+typedef struct {
+    bool      done;
+    esp_err_t err;
+    uint32_t  start_ms;         /**< Since power-on                        */
+    uint32_t  dur_ms;
+} boot_phase_result_t;
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * @brief Run the phase table and return when every phase has finished.
+ *
+ * Call once. A phase may only depend on phases listed before it in the
+ * table, which rules out cycles and makes table order a valid sequential
+ * order (used if a lane task cannot be created).
+ *
+ * @return ESP_OK when all phases ran (their own results are per phase),
+ *         ESP_ERR_INVALID_ARG for a bad table, ESP_FAIL if a lane task
+ *         could not be created (its phases then run on lane 0).
+ */
+esp_err_t boot_seq_run(const boot_phase_desc_t *phases, size_t count);
+
+/** @brief True once the phase has finished (whatever its result). */
+bool boot_seq_finished(boot_phase_t phase);
+
+/** @brief True once the phase has finished with ESP_OK. */
+bool boot_seq_ok(boot_phase_t phase);
+
+void boot_seq_get(boot_phase_t phase, boot_phase_result_t *out);
+
+const char *boot_phase_name(boot_phase_t phase);
+
+/** @brief Power-on to the end of boot_seq_run(), 0 while it runs. */
+uint32_t boot_seq_total_ms(void);
+
+/** @brief Record the first published data packet (cheap after the first). */
+void boot_seq_note_first_packet(void);
+
+/** @brief Power-on to the first published data packet, 0 until then. */
+uint32_t boot_seq_first_packet_ms(void);
+
+/**
+ * @brief Append ,"boot":{...} for the status message, once.
+ *
+ * Writes nothing until boot_seq_run() has returned, and nothing after
+ * boot_seq_status_sent() has been called.
+ *
+ * @return Characters written; 0 when there is nothing to add or it would
+ *         not fit (the object is never truncated).
+ */
+int boot_seq_format_status(char *buf, size_t len);
+
+/** @brief The status carrying the boot report reached the broker. */
+void boot_seq_status_sent(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BOOT_SEQ_H
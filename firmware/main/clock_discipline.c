@@ -0,0 +1,296 @@
+/**
+ * @file clock_discipline.c
+ * @brief Least-squares local -> UTC model with slewed corrections
+ *        (see clock_discipline.h).
+ *
+ * The sync-point window and the fit are touched only by the SNTP callback.
+ * Readers on any task take s_lock just long enough to copy the published
+ * model and then evaluate it on their own copy.
+ */
+
+#include "clock_discipline.h"
+
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <math.h>
+#include <string.h>
+
+static const char *TAG = "CLOCK";
+
+typedef struct {
+    int64_t ref_local_us;       /**< Local time of the newest sync point       */
+    int64_t ref_offset_us;      /**< Fitted utc - local at ref_local_us        */
+    int32_t drift_ppb;
+    int64_t slew_start_us;      /**< Local time the current slew began         */
+    int32_t slew_us;            /**< Output minus model at slew_start_us       */
+} clock_model_t;
+
+typedef struct {
+    uint32_t n;
+    uint32_t sigma_us;
+    int64_t  xbar_local_us;     /**< Mean local time of the fitted points      */
+    double   sxx;               /**< Sum of squared x deviations, us^2         */
+} clock_fit_t;
+
+static portMUX_TYPE  s_lock   = portMUX_INITIALIZER_UNLOCKED;
+static clock_model_t s_model;
+static clock_fit_t   s_fit;
+static volatile bool s_synced = false;
+
+/* SNTP callback only */
+static int64_t  s_pt_local[CLOCK_DISC_WINDOW];
+static int64_t  s_pt_offset[CLOCK_DISC_WINDOW];
+static uint32_t s_pt_count   = 0;
+static uint32_t s_pt_next    = 0;
+static uint32_t s_outlier_run = 0;
+
+static volatile uint32_t s_syncs    = 0;
+static volatile uint32_t s_steps    = 0;
+static volatile uint32_t s_outliers = 0;
+
+/******************************************************************************
+ * MODEL EVALUATION
+ *****************************************************************************/
+
+static int64_t abs64(int64_t v)
+{
+    return v < 0 ? -v : v;
+}
+
+/** @brief Part of the last correction not yet slewed in at local_us. */
+static int64_t slew_remaining(const clock_model_t *m, int64_t local_us)
+{
+    if (m->slew_us == 0) {
+        return 0;
+    }
+    int64_t done = (local_us - m->slew_start_us) * CLOCK_DISC_SLEW_PPM / 1000000;
+    if (done < 0) {
+        done = 0;
+    }
+    if (done >= abs64(m->slew_us)) {
+        return 0;
+    }
+    return (m->slew_us > 0) ? m->slew_us - done : m->slew_us + done;
+}
+
+/** @brief Fitted utc - local at local_us, without the slew term. */
+static int64_t model_offset(const clock_model_t *m, int64_t local_us)
+{
+    int64_t dx = local_us - m->ref_local_us;
+    return m->ref_offset_us + dx * m->drift_ppb / 1000000000;
+}
+
+static int64_t model_utc(const clock_model_t *m, int64_t local_us)
+{
+    return local_us + model_offset(m, local_us) + slew_remaining(m, local_us);
+}
+
+static void copy_model(clock_model_t *m, clock_fit_t *f)
+{
+    portENTER_CRITICAL(&s_lock);
+    *m = s_model;
+    if (f) {
+        *f = s_fit;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+/******************************************************************************
+ * FIT
+ *****************************************************************************/
+
+static void add_point(int64_t local_us, int64_t offset_us)
+{
+    s_pt_local[s_pt_next]  = local_us;
+    s_pt_offset[s_pt_next] = offset_us;
+    s_pt_next = (s_pt_next + 1) % CLOCK_DISC_WINDOW;
+    if (s_pt_count < CLOCK_DISC_WINDOW) {
+        s_pt_count++;
+    }
+}
+
+static void restart_window(void)
+{
+    s_pt_count = 0;
+    s_pt_next  = 0;
+}
+
+/**
+ * @brief Least-squares fit of offset vs local over the window.
+ *
+ * x and y are taken relative to the newest point so the sums stay small.
+ * Fewer than three points keep @p prior_drift_ppb: two SNTP samples 30 s
+ * apart with ~1 ms jitter cannot resolve drift better than ~30 ppm.
+ */
+static void fit_window(int64_t new_local, int64_t new_offset, int32_t prior_drift_ppb,
+                       clock_model_t *m, clock_fit_t *f)
+{
+    uint32_t n = s_pt_count;
+    double sx = 0.0, sy = 0.0;
+    for (uint32_t i = 0; i < n; i++) {
+        sx += (double)(s_pt_local[i] - new_local);
+        sy += (double)(s_pt_offset[i] - new_offset);
+    }
+    double xbar = sx / n;
+    double ybar = sy / n;
+
+    double sxx = 0.0, sxy = 0.0;
+    for (uint32_t i = 0; i < n; i++) {
+        double dx = (double)(s_pt_local[i] - new_local) - xbar;
+        double dy = (double)(s_pt_offset[i] - new_offset) - ybar;
+        sxx += dx * dx;
+        sxy += dx * dy;
+    }
+
+    double slope = (double)prior_drift_ppb * 1e-9;
+    if (n >= 3 && sxx > 0.0) {
+        slope = sxy / sxx;
+        if (slope >  CLOCK_DISC_MAX_DRIFT_PPB * 1e-9) slope =  CLOCK_DISC_MAX_DRIFT_PPB * 1e-9;
+        if (slope < -CLOCK_DISC_MAX_DRIFT_PPB * 1e-9) slope = -CLOCK_DISC_MAX_DRIFT_PPB * 1e-9;
+    }
+    double intercept = ybar - slope * xbar;     /* offset at the newest point */
+
+    uint32_t sigma = CLOCK_DISC_DEFAULT_SIGMA_US;
+    if (n >= 3) {
+        double ssr = 0.0;
+        for (uint32_t i = 0; i < n; i++) {
+            double x = (double)(s_pt_local[i] - new_local);
+            double r = (double)(s_pt_offset[i] - new_offset) - (intercept + slope * x);
+            ssr += r * r;
+        }
+        sigma = (uint32_t)sqrt(ssr / (n - 2));
+    }
+
+    memset(m, 0, sizeof(*m));
+    m->ref_local_us  = new_local;
+    m->ref_offset_us = new_offset + (int64_t)llround(intercept);
+    m->drift_ppb     = (int32_t)lround(slope * 1e9);
+
+    f->n             = n;
+    f->sigma_us      = sigma;
+    f->xbar_local_us = new_local + (int64_t)llround(xbar);
+    f->sxx           = sxx;
+}
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+void clock_discipline_on_sync(int64_t utc_us)
+{
+    int64_t local  = esp_timer_get_time();
+    int64_t offset = utc_us - local;
+    s_syncs++;
+
+    clock_model_t old;
+    copy_model(&old, NULL);
+    bool was_synced = s_synced;
+
+    /* One bad exchange (e.g. a delayed reply) should not drag the model;
+       a persistent disagreement means the reference really moved. */
+    if (was_synced && s_pt_count >= 4) {
+        int64_t resid = offset - model_offset(&old, local);
+        if (abs64(resid) > CLOCK_DISC_OUTLIER_US) {
+            if (++s_outlier_run < CLOCK_DISC_OUTLIER_RESET) {
+                s_outliers++;
+                ESP_LOGW(TAG, "Sync %+lld us off the model, ignored", (long long)resid);
+                return;
+            }
+            restart_window();
+        }
+    }
+    s_outlier_run = 0;
+
+    add_point(local, offset);
+
+    clock_model_t next;
+    clock_fit_t   fit;
+    fit_window(local, offset, was_synced ? old.drift_ppb : 0, &next, &fit);
+
+    bool step = !was_synced;
+    if (was_synced) {
+        int64_t correction = model_utc(&old, local) - model_utc(&next, local);
+        if (abs64(correction) > CLOCK_DISC_STEP_US) {
+            /* Old points describe a different reference; start over from this one */
+            restart_window();
+            add_point(local, offset);
+            fit_window(local, offset, old.drift_ppb, &next, &fit);
+            step = true;
+        } else {
+            next.slew_us       = (int32_t)correction;
+            next.slew_start_us = local;
+        }
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_model = next;
+    s_fit   = fit;
+    portEXIT_CRITICAL(&s_lock);
+    s_synced = true;
+
+    if (step) {
+        s_steps++;
+        ESP_LOGI(TAG, "Clock stepped (offset %lld us, drift %ld ppb)",
+                 (long long)next.ref_offset_us, (long)next.drift_ppb);
+    } else {
+        ESP_LOGD(TAG, "Sync: n=%lu drift=%ld ppb sigma=%lu us slew=%ld us",
+                 (unsigned long)fit.n, (long)next.drift_ppb,
+                 (unsigned long)fit.sigma_us, (long)next.slew_us);
+    }
+}
+
+int64_t clock_discipline_local_to_utc_us(int64_t local_us)
+{
+    if (!s_synced) {
+        return 0;
+    }
+    clock_model_t m;
+    copy_model(&m, NULL);
+    return model_utc(&m, local_us);
+}
+
+int64_t clock_discipline_now_utc_us(void)
+{
+    return clock_discipline_local_to_utc_us(esp_timer_get_time());
+}
+
+bool clock_discipline_is_synced(void)
+{
+    return s_synced;
+}
+
+void clock_discipline_get_stats(clock_discipline_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    stats->synced   = s_synced;
+    stats->syncs    = s_syncs;
+    stats->steps    = s_steps;
+    stats->outliers = s_outliers;
+    if (!stats->synced) {
+        return;
+    }
+
+    clock_model_t m;
+    clock_fit_t   f;
+    copy_model(&m, &f);
+
+    int64_t now   = esp_timer_get_time();
+    int64_t slew  = slew_remaining(&m, now);
+
+    /* 1-sigma error of the fitted line at "now": grows with extrapolation */
+    double var = 1.0 / (f.n ? f.n : 1);
+    if (f.n >= 3 && f.sxx > 0.0) {
+        double dx = (double)(now - f.xbar_local_us);
+        var += dx * dx / f.sxx;
+    }
+
+    stats->points    = f.n;
+    stats->drift_ppb = m.drift_ppb;
+    stats->sigma_us  = f.sigma_us;
+    stats->slew_us   = (int32_t)slew;
+    stats->err_us    = (uint32_t)(f.sigma_us * sqrt(var)) + (uint32_t)abs64(slew);
+}
@@ -0,0 +1,87 @@
+/**
+ * @file clock_discipline.h
+ * @brief Drift-and-offset model from the local timebase to SNTP UTC.
+ *
+ * Sample timestamps used to come from gettimeofday() at anchor time, so the
+ * local clock's drift between syncs and every SNTP correction showed up
+ * directly in sample times. This module keeps a least-squares fit of
+ *
+ *   utc - local = offset + drift * (local - ref)
+ *
+ * over the last CLOCK_DISC_WINDOW SNTP sync events, where local is
+ * esp_timer_get_time(). It comes from the same crystal as the acquisition
+ * GPTimer, so tick offsets stay consistent with it. packet_time.c reads UTC
+ * from the model instead of calling gettimeofday().
+ *
+ * A refit normally moves the model by a few hundred microseconds. Such
+ * changes are slewed into the output at CLOCK_DISC_SLEW_PPM, so consecutive
+ * timestamps never jump and never run backwards. Only the first sync, or a
+ * correction above CLOCK_DISC_STEP_US, steps the clock.
+ *
+ * The estimated error is reported in the status JSON as
+ * "clock":{"synced":..,"err_us":..,"drift_ppb":..,"n":..}. It combines the
+ * 1-sigma prediction error of the fit at the current time with any slew
+ * still outstanding.
+ */
+
+#ifndef CLOCK_DISCIPLINE_H
+#define CLOCK_DISCIPLINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * CONFIGURATION
+ *****************************************************************************/
+
+#define CLOCK_DISC_WINDOW           16          /**< Sync events in the fit (8 min at 30 s) */
+#define CLOCK_DISC_SLEW_PPM         200         /**< Max correction rate: 200 us per s      */
+#define CLOCK_DISC_STEP_US          50000       /**< Larger corrections restart the model   */
+#define CLOCK_DISC_OUTLIER_US       5000        /**< Sync this far off the fit is ignored    */
+#define CLOCK_DISC_OUTLIER_RESET    3           /**< ... unless it happens this many times  */
+#define CLOCK_DISC_MAX_DRIFT_PPB    500000      /**< Clamp: crystal spec is far below this  */
+#define CLOCK_DISC_DEFAULT_SIGMA_US 1000        /**< Error assumed until 3 points are fitted */
+
+typedef struct {
+    bool     synced;            /**< At least one sync event applied          */
+    uint32_t points;            /**< Sync events currently in the fit         */
+    int32_t  drift_ppb;         /**< Local clock rate error, + = local slow   */
+    uint32_t sigma_us;          /**< RMS residual of the fit                  */
+    uint32_t err_us;            /**< Estimated timestamp error now            */
+    int32_t  slew_us;           /**< Correction still being slewed in         */
+    uint32_t syncs;             /**< Sync events seen                         */
+    uint32_t steps;             /**< Model restarts (first sync, big jumps)   */
+    uint32_t outliers;          /**< Sync events rejected as outliers         */
+} clock_discipline_stats_t;
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * @brief Feed one SNTP sync event (the server time just received).
+ *
+ * Called from the SNTP notification callback. The local timestamp is taken
+ * inside, so call it as soon as the time is known.
+ */
+void clock_discipline_on_sync(int64_t utc_us);
+
+/** @brief Disciplined UTC (us) at a local esp_timer time, 0 if never synced. */
+int64_t clock_discipline_local_to_utc_us(int64_t local_us);
+
+/** @brief Disciplined UTC (us) now, 0 if never synced. */
+int64_t clock_discipline_now_utc_us(void);
+
+bool clock_discipline_is_synced(void);
+
+void clock_discipline_get_stats(clock_discipline_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CLOCK_DISCIPLINE_H
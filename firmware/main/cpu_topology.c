@@ -0,0 +1,128 @@
+/**
+ * @file cpu_topology.c
+ * @brief Core split helpers (see cpu_topology.h).
+ */
+
+#include "cpu_topology.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "CPU_TOPO";
+
+#if SHM_CORE_ACQ != 0 && SHM_CORE_ACQ != 1
+#error "CONFIG_SHM_ACQ_CORE must be 0 or 1"
+#endif
+#if SHM_ACQ_INTR_LEVEL < 1 || SHM_ACQ_INTR_LEVEL > 3
+#error "CONFIG_SHM_ACQ_INTR_LEVEL must be 1..3"
+#endif
+
+/* The IDF tasks are pinned in sdkconfig, not here: catch a split that
+ * moves acquisition onto the core they were pinned to */
+#if (SHM_CORE_NET == 1) && defined(CONFIG_LWIP_TCPIP_TASK_AFFINITY_CPU0)
+#warning "lwIP is pinned to core 0, which CONFIG_SHM_ACQ_CORE makes the acquisition core"
+#endif
+#if (SHM_CORE_NET == 1) && defined(CONFIG_MQTT_USE_CORE_0)
+#warning "esp-mqtt is pinned to core 0, which CONFIG_SHM_ACQ_CORE makes the acquisition core"
+#endif
+
+/******************************************************************************
+ * RUN ON CORE
+ *****************************************************************************/
+
+typedef struct {
+    esp_err_t         (*fn)(void *arg);
+    void              *arg;
+    esp_err_t          err;
+    SemaphoreHandle_t  done;
+} run_on_req_t;
+
+static void run_on_task(void *arg)
+{
+    run_on_req_t *req = arg;
+    req->err = req->fn(req->arg);
+    xSemaphoreGive(req->done);
+    vTaskDelete(NULL);
+}
+
+esp_err_t cpu_topology_run_on(int core, esp_err_t (*fn)(void *arg), void *arg)
+{
+    if (fn == NULL || core < 0 || core >= portNUM_PROCESSORS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (xPortGetCoreID() == core) {
+        return fn(arg);
+    }
+
+    StaticSemaphore_t done_buf;
+    run_on_req_t req = {
+        .fn   = fn,
+        .arg  = arg,
+        .err  = ESP_FAIL,
+        .done = xSemaphoreCreateBinaryStatic(&done_buf),
+    };
+
+    if (xTaskCreatePinnedToCore(run_on_task, "run_on", CPU_TOPOLOGY_RUN_STACK_SIZE, &req,
+                                uxTaskPriorityGet(NULL), NULL, core) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create helper task on core %d", core);
+        return ESP_ERR_NO_MEM;
+    }
+    xSemaphoreTake(req.done, portMAX_DELAY);
+    return req.err;
+}
+
+/******************************************************************************
+ * PER-CORE LOAD
+ *****************************************************************************/
+
+#if (configUSE_TRACE_FACILITY == 1) && (configGENERATE_RUN_TIME_STATS == 1)
+
+void cpu_topology_sample_load(cpu_load_sampler_t *s, uint16_t load_x10[portNUM_PROCESSORS])
+{
+    uint32_t total = (uint32_t)portGET_RUN_TIME_COUNTER_VALUE();
+    uint32_t idle[portNUM_PROCESSORS];
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        TaskStatus_t st;
+        vTaskGetInfo(xTaskGetIdleTaskHandleForCore(core), &st, pdFALSE, eInvalid);
+        idle[core] = st.ulRunTimeCounter;
+    }
+
+    uint32_t d_total = total - s->total;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        uint32_t d_idle = idle[core] - s->idle[core];
+        uint32_t idle_x10 = d_total ? (uint32_t)(((uint64_t)d_idle * 1000u) / d_total) : 1000u;
+        if (idle_x10 > 1000u) {
+            idle_x10 = 1000u;
+        }
+        load_x10[core] = s->primed ? (uint16_t)(1000u - idle_x10) : 0;
+        s->idle[core]  = idle[core];
+    }
+    s->total  = total;
+    s->primed = true;
+}
+
+#else
+
+void cpu_topology_sample_load(cpu_load_sampler_t *s, uint16_t load_x10[portNUM_PROCESSORS])
+{
+    (void)s;
+    memset(load_x10, 0, sizeof(uint16_t) * portNUM_PROCESSORS);
+}
+
+#endif
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+void cpu_topology_log(void)
+{
+    ESP_LOGI(TAG, "Core %d: acquisition ISRs (level %d), acquisition, decimation",
+             SHM_CORE_ACQ, SHM_ACQ_INTR_LEVEL);
+    ESP_LOGI(TAG, "Core %d: Ethernet, lwIP, MQTT, serializer, fault dispatcher",
+             SHM_CORE_NET);
+}
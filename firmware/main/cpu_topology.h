@@ -0,0 +1,120 @@
+/**
+ * @file cpu_topology.h
+ * @brief Which core runs what: acquisition on one core, networking on the
+ *        other.
+ *
+ * Task placement used to be decided module by module, so the data task,
+ * the serializer and the GPTimer / DRDY interrupts (allocated on whichever
+ * core happened to call sensor_acquisition_init(), i.e. app_main on core 0)
+ * all shared a core with the Ethernet driver, lwIP and esp-mqtt. A burst of
+ * TCP retransmits or a broker reconnect then showed up as ISR jitter and
+ * task-wake latency in the acquisition stats.
+ *
+ * The split, with the default CONFIG_SHM_ACQ_CORE = 1:
+ *
+ *   SHM_CORE_ACQ (1)   GPTimer + ADXL355 INT1 ISRs, SPI bus ISR,
+ *                      acquisition task, raw-history drain, sync start,
+ *                      data task (decimation + packet build), bench,
+ *                      spectrum FFTs (low priority)
+ *   SHM_CORE_NET (0)   EMAC ISR, lwIP tcpip, esp-mqtt, boot network lane,
+ *                      serializer, publish, event upload, fault dispatcher,
+ *                      slow sensors, SPI recovery
+ *
+ * Tasks reach a core through the *_TASK_CORE macros in their own headers,
+ * which map onto SHM_CORE_ACQ / SHM_CORE_NET. The IDF tasks are pinned by
+ * sdkconfig.defaults (lwIP, esp-mqtt); the EMAC interrupt follows the boot
+ * network lane because it is allocated on the core that installs the
+ * driver. Interrupts only run on the core they were allocated on, so the
+ * acquisition interrupts are allocated through cpu_topology_run_on().
+ *
+ * The one exception is the EMAC RX task: the ethernet_init helper creates it
+ * without a core, and it can run on either (it wakes once per frame).
+ *
+ * Both acquisition interrupts use SHM_ACQ_INTR_LEVEL (neither nests the
+ * other) and are IRAM-safe, so they keep running while a flash write on
+ * the network core has the cache disabled.
+ *
+ * Per-core load (100 % minus the core's IDLE task share) is on the STATS
+ * dump and the metrics topic ("cpu":[core0_x10,core1_x10]).
+ */
+
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * CONFIGURATION
+ *****************************************************************************/
+
+#if defined(CONFIG_SHM_ACQ_CORE)
+#define SHM_CORE_ACQ                CONFIG_SHM_ACQ_CORE
+#else
+#define SHM_CORE_ACQ                1
+#endif
+#define SHM_CORE_NET                (1 - SHM_CORE_ACQ)
+
+/* Level 1..3 (the levels C handlers may use); 2 preempts the level-1 default */
+#if defined(CONFIG_SHM_ACQ_INTR_LEVEL)
+#define SHM_ACQ_INTR_LEVEL          CONFIG_SHM_ACQ_INTR_LEVEL
+#else
+#define SHM_ACQ_INTR_LEVEL          2
+#endif
+/* ESP_INTR_FLAG_LEVELn for the same level (ESP_INTR_FLAG_LEVEL1 is 1 << 1) */
+#define SHM_ACQ_INTR_FLAG_LEVEL     (1 << SHM_ACQ_INTR_LEVEL)
+
+#define CPU_TOPOLOGY_RUN_STACK_SIZE 4096
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/** @brief Per-caller state for cpu_topology_sample_load(). */
+typedef struct {
+    bool     primed;
+    uint32_t total;                         /**< Run-time clock at last call */
+    uint32_t idle[portNUM_PROCESSORS];      /**< IDLE task run time per core */
+} cpu_load_sampler_t;
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * @brief Run fn(arg) on a given core and return its result.
+ *
+ * Calls fn directly when already on that core; otherwise runs it in a
+ * short-lived task pinned there (CPU_TOPOLOGY_RUN_STACK_SIZE, caller's
+ * priority) and blocks until it returns. Used to allocate interrupts,
+ * which stay on the core that allocated them.
+ *
+ * @return fn's result, or ESP_ERR_NO_MEM if the helper task could not be
+ *         created.
+ */
+esp_err_t cpu_topology_run_on(int core, esp_err_t (*fn)(void *arg), void *arg);
+
+/**
+ * @brief Per-core load in 0.1 % units since the previous call with @p s.
+ *
+ * The first call only primes @p s and reports 0. Needs the FreeRTOS
+ * run-time stats (CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS); without them
+ * every core reads 0.
+ */
+void cpu_topology_sample_load(cpu_load_sampler_t *s, uint16_t load_x10[portNUM_PROCESSORS]);
+
+/** @brief Log the split once at boot. */
+void cpu_topology_log(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CPU_TOPOLOGY_H
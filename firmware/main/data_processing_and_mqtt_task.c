@@ -8,53 +8,90 @@
  *  - Inclination:    20 Hz  (20 samples batched per packet)
  *  - Temperature:     1 Hz  (1 polled reading per packet)
  *
+ * This task is the build stage of publish_pipeline.h: the decimator writes
+ * each batch straight into a packet slot, which is handed off once full.
+ * Encoding and the network send run on their own tasks, so a stalled broker
+ * costs packets, never ring-buffer samples.
+ *
  * Sensor handling:
- *  - ADXL355: decimated by node_config decim_factor -> 200 Hz output,
- *    batched into node_config batch_size samples (1 second per packet).
- *    If disconnected (watchdog timeout), a NaN-filled packet is emitted
- *    every second so the Pi always sees data arriving.
+ *  - ADXL355: decimated by node_config decim_factor -> 200 Hz output
+ *    through the CIC + FIR chain in decimator.h, batched into node_config batch_size samples (1 second per packet).
+ *    If disconnected (watchdog timeout), a packet with an accel gap entry
+ *    is emitted every second so the Pi always sees data arriving.
  *  - SCL3300 (20 Hz): all samples from the ring buffer are batched into
- *    an array of up to 20 readings per packet. If disconnected, NaN is sent.
+ *    an array of up to 20 readings per packet. If disconnected (or nothing
+ *    arrived), the packet carries a gap entry instead.
  *  - ADT7420 (1 Hz): polled directly via I2C. If read fails, NaN is sent.
  *
  * Resilience:
  *  - A disconnected sensor does NOT cause a reboot or halt.
  *  - Each sensor is tracked independently. The node keeps recording the
- *    remaining sensors and sends NaN for the faulty one.
+ *    remaining sensors and sends a gap entry for the faulty one.
+ *  - Reinit of a disconnected SPI sensor runs in the recovery task
+ *    (sensor_recovery.h), so retries never stall this loop or the other
+ *    sensor.
  *  - Faults are logged via fault_log_record() for every event.
  *
  * State awareness:
  *  The task checks node_config_get_state() each loop. It only publishes when
  *  the node is in NODE_STATE_RECORDING. Otherwise it drains and discards ring
  *  buffer contents to prevent backlog.
+ *
+ * Config epochs:
+ *  The task works from its own copy of the runtime config. A config applied
+ *  live (node_config_apply_live()) takes effect at its epoch_tick: samples
+ *  before it are still processed with the old copy, the batch is closed
+ *  there as a short packet, and the next one starts with the new settings
+ *  and epoch. Any other config change restarted acquisition, so the batch in
+ *  progress is dropped.
  */
 
 #include "data_processing_and_mqtt_task.h"
+#include "mem_budget.h"
 #include "node_config.h"
 #include "sensor_task.h"
 #include "adt7420.h"
 #include "adxl355.h"
 #include "scl3300.h"
 #include "mqtt.h"
+#include "publish_pipeline.h"
+#include "store_forward.h"
+#include "flow_control.h"
+#include "spectrum.h"
+#include "decimator.h"
+#include "event_capture.h"
+#include "raw_history.h"
+#include "timing_hist.h"
+#include "packet_time.h"
 #include "fault_log.h"
+#include "slow_sensors.h"
+#include "sensor_recovery.h"
+#include "udp_stream.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_timer.h"
+#include "esp_cpu.h"
 #include <string.h>
 #include <math.h>
-#include <time.h>
-#include <sys/time.h>
 
 static const char *TAG = "DATA_PROC";
 
+MEM_BUDGET_STATIC_TASK(s_task_mem, DATA_PROCESSING_TASK_STACK_SIZE);
+
 static TaskHandle_t  s_task_handle  = NULL;
+
+/* Notification bits taken by wait_for_work(), consumed by the health check */
+static uint32_t      s_wake_bits    = 0;
 static volatile bool s_task_running = false;
 
-static volatile uint32_t s_samples_published = 0;
-static volatile uint32_t s_packets_sent      = 0;
+/* Samples dropped before reaching the pipeline (not connected / no free slot).
+ * Published counts and publish failures are kept by publish_pipeline. */
 static volatile uint32_t s_samples_dropped   = 0;
-static volatile uint32_t s_temp_read_errors  = 0;
+
+/* Packet sequence (mqtt.h): one number per completed second, published or
+ * dropped, so the Pi can tell a lost second from a quiet one. Not reset. */
+static uint32_t s_packet_seq = 0;
 
 /* Shadow overflow counts — detect new drops since the last check */
 static uint32_t s_adxl355_overflow_last = 0;
@@ -69,10 +106,16 @@ static uint32_t s_adt7420_overflow_last = 0;
  *
  * ADXL355 / SCL3300 share the SPI bus but have independent CS lines, so a
  * disconnected SCL3300 must NOT raise FAULT_SPI_ERROR for ADXL355. Each
- * sensor gets its own watchdog and its own SPI fault log.
- * ADT7420 is on I2C; read failures already set temp_valid=false and log
- * FAULT_I2C_ERROR via the existing error path, so its watchdog only needs
- * to track FAULT_ADT7420_DROPPED.
+ * sensor gets its own watchdog and its own SPI fault log, and lost / back
+ * transitions are passed to the recovery task (sensor_recovery.h).
+ *
+ * The acquisition engine also notifies this task when it takes a sensor's
+ * slots down after a run of invalid reads (sensor_task.h: SENSOR HEALTH).
+ * That trips the watchdog at once instead of after SENSOR_WATCHDOG_MS; the
+ * stalled-counter check stays as the fallback for stalls the engine cannot
+ * see (e.g. no DRDY interrupts at all).
+ * ADT7420 is on I2C and read by the slow-sensors task, which records its
+ * disconnect / reconnect faults; this task only tracks ring overflows.
  */
 #define SENSOR_WATCHDOG_MS   2000u
 
@@ -84,190 +127,383 @@ static uint32_t s_scl3300_sample_last  = 0;
 static uint32_t s_scl3300_watchdog_ms  = 0;
 static bool     s_scl3300_disconnected = false;
 
-/* ADT7420 uses I2C — no ISR sample counter, track via consecutive read errors */
-static bool     s_adt7420_disconnected = false;
-
 /*
- * Batch buffers sized for the maximum possible batch.
- * ODR=4000Hz with decim=20 -> 200 output samples/sec = 200 per packet.
- * All supported ODR settings produce exactly 200 samples/packet.
+ * The accel batch is decimated straight into a publish pipeline slot, taken
+ * when the batch starts. All supported ODR settings produce exactly 200
+ * samples/packet (MQTT_ACCEL_BATCH_SIZE).
+ *
+ * The decimator is called for at most ACCEL_CHUNK outputs at a time so their
+ * ticks fit a small stack array; place_on_grid() then checks them against
+ * the packet grid. Without a slot (link stalled, or nothing would be
+ * published) the batch still runs through the decimator, so filter state
+ * and the spectrum stay continuous, but into a scratch, and is dropped.
  */
-#define ACCEL_BATCH_MAX  200
-static float    s_accel_x[ACCEL_BATCH_MAX];
-static float    s_accel_y[ACCEL_BATCH_MAX];
-static float    s_accel_z[ACCEL_BATCH_MAX];
-static uint32_t s_accel_ticks[ACCEL_BATCH_MAX];
+#define ACCEL_CHUNK  16
+static mqtt_sensor_packet_t *s_build = NULL;
+static int32_t  s_drop_raw[3][ACCEL_CHUNK];
+
+/* Anti-alias decimation state (~2.5 KB of filter history) */
+static decimator_t s_decim;
+
+/* The config the stream is being processed with (see "Config epochs") */
+static node_runtime_config_t s_cfg;
 
 /*
  * Inclination batch buffer — accumulates all 20 SCL3300 samples per second.
  */
 #define INCL_BATCH_MAX   MQTT_INCL_BATCH_SIZE
-static float    s_incl_x[INCL_BATCH_MAX];
-static float    s_incl_y[INCL_BATCH_MAX];
-static float    s_incl_z[INCL_BATCH_MAX];
 static uint32_t s_incl_ticks[INCL_BATCH_MAX];
+static int16_t  s_incl_raw[3][INCL_BATCH_MAX];
 static int      s_incl_batch_count = 0;
 
-#define TEMP_READ_INTERVAL_MS  1000
+/*
+ * Temperature comes from the ADT7420 ring (slow_sensors.c). The last reading
+ * is held until it is older than this, or the slow-sensors task reports the
+ * sensor offline, after which packets carry NaN.
+ */
+#define TEMP_STALE_MS          2500u
 
 /*
  * Accel NaN flush: if the ADXL355 is disconnected and no accel batch has been
- * published for this long, emit a NaN-filled packet so the Pi always sees data.
+ * published for this long, emit a packet with an accel gap so the Pi always
+ * sees data.
  */
 #define ACCEL_NAN_FLUSH_MS     1000u
 static uint32_t s_last_accel_publish_ms = 0;
 
 /*
- * SPI sensor reconnection: periodically attempt to re-initialise disconnected
- * SPI sensors.  If the sensor has been physically reconnected, the init
- * sequence will succeed, the ISR will resume producing valid samples, the
- * watchdog will clear the disconnected flag, and real data will flow again.
+ * SPI sensor reconnection runs in sensor_recovery.c, driven by the watchdog
+ * transitions below. Once a reconnected sensor produces samples again the
+ * watchdog clears the disconnected flag and real data flows.
  */
-#define SENSOR_REINIT_INTERVAL_MS   5000u
-static uint32_t s_last_reinit_attempt_ms = 0;
+static uint32_t s_adxl355_reinit_gen = 0;
 
 /******************************************************************************
  * HELPERS
  *****************************************************************************/
 
-static inline float convert_adxl355_to_g(int32_t raw, float sensitivity_lsb_g)
+static void drain_ring_buffers(void)
 {
-    return (float)raw / sensitivity_lsb_g;
+    adxl355_discard_samples();
+    scl3300_discard_samples();
 }
 
-static inline float convert_scl3300_to_deg(int16_t raw)
+/** @brief Take a copy of @p cfg as the config the stream is processed with. */
+static void adopt_config(const node_runtime_config_t *cfg)
 {
-    // SCL3300 angle output registers: full-scale +-90 degrees over 16384 LSB
-    return (float)raw * (90.0f / 16384.0f);
+    s_cfg = *cfg;
+    node_config_note_in_use(s_cfg.epoch);
+
+    /* Wake about every PROCESSING_WAKE_MS of raw data at this ODR */
+    uint32_t wm = s_cfg.odr_hz * PROCESSING_WAKE_MS / 1000u;
+    sensor_data_set_watermark(wm > 0u ? wm : 1u);
 }
 
-/*
- * Format a wall-clock timestamp into buf (must be >= MQTT_TS_LEN bytes).
- * Back-calculates the exact wall time when the ISR tick was captured.
- * Falls back to "tick:NNNNNNNN" if SNTP has not yet synced.
+/**
+ * @brief Block until data is ready, a health bit is set or the timeout.
+ *
+ * Bits received are kept for the health check at the top of the loop.
  */
-static void format_ts(char *buf, uint32_t tick)
+static void wait_for_work(void)
 {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-
-    if (tv.tv_sec > 1700000000L) {
-        uint32_t current_tick = get_tick_count();
-        int64_t delta_us = (int64_t)((int32_t)(current_tick - tick)) * 125LL;
-        int64_t sample_us = (int64_t)tv.tv_sec * 1000000LL
-                            + (int64_t)tv.tv_usec - delta_us;
-
-        time_t sec = (time_t)(sample_us / 1000000LL);
-        int    us  = (int)(sample_us % 1000000LL);
-        if (us < 0) { us += 1000000; sec -= 1; }
-
-        struct tm tm_info;
-        gmtime_r(&sec, &tm_info);
-        strftime(buf, MQTT_TS_LEN, "%Y-%m-%dT%H:%M:%S", &tm_info);
-        snprintf(buf + 19, MQTT_TS_LEN - 19, ".%06dZ", us);
-    } else {
-        snprintf(buf, MQTT_TS_LEN, "tick:%08lu", (unsigned long)tick);
+    uint32_t bits = 0;
+    if (xTaskNotifyWait(0, UINT32_MAX, &bits,
+                        pdMS_TO_TICKS(PROCESSING_TIMEOUT_MS)) == pdTRUE) {
+        s_wake_bits |= bits;
     }
 }
 
-/* Static packet buffer — keeps large struct off the task stack */
-static mqtt_sensor_packet_t s_packet;
+/** @brief Number of samples at the head of a span taken before @p tick. */
+static uint32_t samples_before_tick(const adxl355_raw_sample_t *span, uint32_t n,
+                                    uint32_t tick)
+{
+    uint32_t k = 0;
+    while (k < n && (int32_t)(span[k].tick - tick) < 0) {
+        k++;
+    }
+    return k;
+}
 
-static void drain_ring_buffers(void)
+/** @brief Return the slot of a batch that will not be published. */
+static void discard_build_slot(void)
 {
-    adxl355_raw_sample_t a;
-    scl3300_raw_sample_t s;
-    while (adxl355_data_available()) adxl355_read_sample(&a);
-    while (scl3300_data_available()) scl3300_read_sample(&s);
+    if (s_build != NULL) {
+        publish_pipeline_release(s_build);
+        s_build = NULL;
+    }
 }
 
 /**
  * @brief Drain any pending SCL3300 samples into the incl batch buffers.
+ *
+ * Samples beyond the batch capacity are discarded, as before.
  */
 static void flush_scl3300_to_batch(void)
 {
-    scl3300_raw_sample_t scl_sample;
-    while (scl3300_data_available()) {
-        if (scl3300_read_sample(&scl_sample)) {
-            if (s_incl_batch_count < INCL_BATCH_MAX) {
-                s_incl_x[s_incl_batch_count]     = convert_scl3300_to_deg(scl_sample.raw_x);
-                s_incl_y[s_incl_batch_count]     = convert_scl3300_to_deg(scl_sample.raw_y);
-                s_incl_z[s_incl_batch_count]     = convert_scl3300_to_deg(scl_sample.raw_z);
-                s_incl_ticks[s_incl_batch_count] = scl_sample.tick;
-                s_incl_batch_count++;
+    scl3300_raw_sample_t chunk[INCL_BATCH_MAX];
+    uint32_t n;
+    while ((n = scl3300_read_samples(chunk, INCL_BATCH_MAX)) > 0) {
+        for (uint32_t k = 0; k < n && s_incl_batch_count < INCL_BATCH_MAX; k++) {
+            s_incl_ticks[s_incl_batch_count]  = chunk[k].tick;
+            s_incl_raw[0][s_incl_batch_count] = chunk[k].raw_x;
+            s_incl_raw[1][s_incl_batch_count] = chunk[k].raw_y;
+            s_incl_raw[2][s_incl_batch_count] = chunk[k].raw_z;
+            s_incl_batch_count++;
+        }
+    }
+}
+
+/**
+ * @brief Count a dropped packet (its sequence number is used up) and log the
+ *        running drop count at most once per second.
+ */
+static void note_dropped(int accel_count, bool accel_valid, const char *why)
+{
+    s_packet_seq++;
+    s_samples_dropped += (uint32_t)(accel_valid ? accel_count : 0);
+    static uint32_t s_last_drop_ms = 0;
+    uint32_t t = (uint32_t)(esp_timer_get_time() / 1000);
+    if ((t - s_last_drop_ms) >= 1000) {
+        s_last_drop_ms = t;
+        ESP_LOGW(TAG, "%s — dropped %lu samples total",
+                 why, (unsigned long)s_samples_dropped);
+    }
+}
+
+/**
+ * @brief Check whether a packet built now would reach the pipeline.
+ * @param why  Set to the drop reason, or NULL when nothing counts as dropped
+ *             (summary-only sites publish the spectrum topic instead).
+ */
+static bool publish_possible(const char **why)
+{
+    *why = NULL;
+    if (spectrum_get_mode() == SPECTRUM_MODE_ONLY) {
+        return false;
+    }
+
+    /* The multicast stream does not need the broker (udp_stream.h) */
+    if (udp_stream_is_enabled()) {
+        return true;
+    }
+
+    /* Offline packets go to the store-and-forward log when it exists */
+    if (!mqtt_is_connected() && !store_forward_enabled()) {
+        *why = "MQTT not ready";
+        return false;
+    }
+
+    /* Throttled below coarse (flow_control.h): raw packets are only logged */
+    if (flow_control_get_level() >= FLOW_LEVEL_SUMMARY && !store_forward_enabled()) {
+        *why = "Link throttled to summary";
+        return false;
+    }
+    return true;
+}
+
+/** @brief Account for a second of data that will not be published. */
+static void skip_packet(int accel_count, bool accel_valid, const char *why)
+{
+    s_last_accel_publish_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    if (why != NULL) {
+        note_dropped(accel_count, accel_valid, why);
+    }
+}
+
+/**
+ * @brief Take a slot for a new accel batch, if it would be published.
+ *
+ * Called once per batch, before its first output sample. Leaves s_build
+ * NULL (batch decimated into the drop scratch) when there is no point in
+ * holding a slot or none is free.
+ */
+static void open_build_slot(uint32_t period_ticks)
+{
+    const char *why;
+    if (s_build == NULL && publish_possible(&why)) {
+        s_build = publish_pipeline_acquire();
+    }
+    if (s_build != NULL) {
+        memset(s_build->accel_map, 0, sizeof(s_build->accel_map));
+        mqtt_accel_summary_reset(&s_build->accel_sum);
+        s_build->accel_period_ticks = (uint16_t)period_ticks;
+    }
+}
+
+/**
+ * @brief Put one decimator call's outputs on the packet's sample grid.
+ *
+ * The outputs were written at [count, count + n) of each axis array. Sample
+ * i of a packet belongs at base_tick + i * period; an output arriving one or
+ * more periods late (raw samples lost to a ring overflow) is moved up and
+ * the skipped slots become invalid samples. Outputs pushed past batch_size
+ * are dropped. Every sample that lands is added to the packet summary
+ * here, while it is still in cache.
+ *
+ * @return The new sample count.
+ */
+static int place_on_grid(mqtt_sensor_packet_t *pkt, int count,
+                         const uint32_t *ticks, uint32_t n, uint32_t batch_size)
+{
+    const uint32_t period = pkt->accel_period_ticks;
+    uint32_t dst[ACCEL_CHUNK];
+    uint32_t next = (uint32_t)count;
+
+    for (uint32_t k = 0; k < n; k++) {
+        if (next == 0) {
+            pkt->base_tick = ticks[0];
+        } else if (period > 0) {
+            int32_t late = (int32_t)(ticks[k] - (pkt->base_tick + next * period));
+            if (late >= (int32_t)(period / 2)) {
+                next += ((uint32_t)late + period / 2) / period;
+            }
+        }
+        dst[k] = next++;
+    }
+
+    /* Targets only ever move up, so shift from the last output down */
+    for (uint32_t k = n; k-- > 0;) {
+        uint32_t src = (uint32_t)count + k;
+        if (dst[k] == src || dst[k] >= batch_size) {
+            continue;
+        }
+        for (int a = 0; a < 3; a++) {
+            pkt->accel[a][dst[k]] = pkt->accel[a][src];
+        }
+    }
+
+    uint32_t pos = (uint32_t)count;
+    for (uint32_t k = 0; k < n && dst[k] < batch_size; k++) {
+        for (; pos < dst[k]; pos++) {
+            for (int a = 0; a < 3; a++) {
+                pkt->accel[a][pos] = MQTT_ACCEL_INVALID;
+            }
+        }
+        pkt->accel_map[pos >> 5] |= 1u << (pos & 31);
+        const int32_t xyz[3] = { pkt->accel[0][pos], pkt->accel[1][pos], pkt->accel[2][pos] };
+        mqtt_accel_summary_add(&pkt->accel_sum, xyz);
+        pos++;
+    }
+    if (next > batch_size) {
+        /* Gap ran past the end of the batch: pad it out */
+        for (; pos < batch_size; pos++) {
+            for (int a = 0; a < 3; a++) {
+                pkt->accel[a][pos] = MQTT_ACCEL_INVALID;
             }
         }
     }
+    return (int)pos;
 }
 
 /**
- * @brief Build and publish one MQTT sensor packet from the current batch buffers.
+ * @brief Complete a packet and hand it to the serialize stage.
  *
- * Handles NaN emission for disconnected sensors.
+ * @p packet is the slot the accel batch was decimated into, or NULL for a
+ * NaN-accel packet, which takes a fresh slot here. Only raw values and ticks
+ * are stored; the encoder renders timestamps. Never blocks: without a free
+ * pipeline slot the packet is dropped. Header fields come from s_cfg, the
+ * config the accel batch was built with.
  */
-static void publish_packet(int accel_count, bool accel_valid,
+static void publish_packet(mqtt_sensor_packet_t *packet,
+                           int accel_count, bool accel_valid,
                            int incl_count,  bool incl_valid,
                            bool temp_valid_arg, float current_temp,
-                           const char *current_temp_ts,
-                           uint32_t odr_hz)
+                           uint32_t current_temp_tick)
 {
-    mqtt_sensor_packet_t *packet = &s_packet;
-    memset(packet, 0, sizeof(*packet));
+    const char *why;
+    if (!publish_possible(&why)) {
+        if (packet != NULL) {
+            publish_pipeline_release(packet);
+        }
+        skip_packet(accel_count, accel_valid, why);
+        return;
+    }
 
-    /* ---- Acceleration ---- */
+    if (packet == NULL) {
+        packet = publish_pipeline_acquire();
+        if (packet == NULL) {
+            note_dropped(accel_count, accel_valid, "Publish pipeline full");
+            return;
+        }
+    }
+
+    const node_runtime_config_t *cfg = &s_cfg;
+
+    /* One wall-clock read per packet: every sample time is an integer tick
+     * offset from this anchor, so the whole packet shares a time base. */
+    ts_anchor_capture(&packet->anchor);
+
+    /* ---- Header fields ---- */
+    if (!(accel_valid && accel_count > 0)) {
+        packet->base_tick = packet->anchor.tick;    /* else set by place_on_grid() */
+    }
+    packet->base_utc_us        = ts_anchor_tick_to_utc_us(&packet->anchor, packet->base_tick);
+    packet->odr_hz             = cfg->odr_hz;
+    packet->decim              = (uint8_t)cfg->decim_factor;
+    packet->range              = cfg->range;
+    packet->cfg_epoch          = (uint8_t)cfg->epoch;
+    packet->accel_period_ticks = (uint16_t)(cfg->decim_factor * cfg->isr_tick_divisor);
+    packet->accel_lsb_per_g    = (uint32_t)cfg->sensitivity_lsb_g;
+
+    /* ---- Acceleration (already in the slot) ---- */
     packet->accel_valid = accel_valid;
-    packet->accel_count = accel_count;
+    packet->accel_count = accel_valid ? accel_count : 0;
     if (accel_valid && accel_count > 0) {
-        for (int i = 0; i < accel_count; i++) {
-            packet->accel[i].x = s_accel_x[i];
-            packet->accel[i].y = s_accel_y[i];
-            packet->accel[i].z = s_accel_z[i];
-            format_ts(packet->accel[i].ts, s_accel_ticks[i]);
-        }
+        mqtt_accel_summary_finish(&packet->accel_sum,
+                                  (uint16_t)(accel_count - packet->accel_sum.real));
+    } else {
+        mqtt_accel_summary_reset(&packet->accel_sum);
+        mqtt_accel_summary_finish(&packet->accel_sum, MQTT_ACCEL_BATCH_SIZE);
     }
 
     /* ---- Inclination (batched) ---- */
+    if (incl_count > MQTT_INCL_BATCH_SIZE) {
+        incl_count = MQTT_INCL_BATCH_SIZE;
+    }
     packet->incl_valid = incl_valid;
-    packet->incl_count = incl_count;
+    packet->incl_count = incl_valid ? incl_count : 0;
     if (incl_valid && incl_count > 0) {
-        for (int i = 0; i < incl_count && i < MQTT_INCL_BATCH_SIZE; i++) {
-            packet->incl[i].x = s_incl_x[i];
-            packet->incl[i].y = s_incl_y[i];
-            packet->incl[i].z = s_incl_z[i];
-            format_ts(packet->incl[i].ts, s_incl_ticks[i]);
+        for (int a = 0; a < 3; a++) {
+            memcpy(packet->incl[a], s_incl_raw[a], (size_t)incl_count * sizeof(int16_t));
         }
+        memcpy(packet->incl_tick, s_incl_ticks, (size_t)incl_count * sizeof(s_incl_ticks[0]));
     }
 
-    /* ---- Temperature ---- */
-    packet->has_temp   = true;
-    packet->temp_valid = temp_valid_arg;
-    if (temp_valid_arg) {
-        packet->temperature = current_temp;
-        memcpy(packet->temp_ts, current_temp_ts, MQTT_TS_LEN);
-    }
-
-    /* ---- Publish ---- */
-    esp_err_t pub_ret = mqtt_publish_sensor_data(packet);
-    if (pub_ret == ESP_OK) {
-        s_samples_published += (uint32_t)(accel_valid ? accel_count : 0);
-        s_packets_sent++;
-        s_last_accel_publish_ms = (uint32_t)(esp_timer_get_time() / 1000);
-        ESP_LOGD(TAG, "pkt#%lu accel=%d/%s incl=%d/%s temp=%s odr=%luHz",
-                 (unsigned long)s_packets_sent,
-                 accel_count, accel_valid ? "ok" : "NaN",
-                 incl_count,  incl_valid  ? "ok" : "NaN",
-                 temp_valid_arg ? "ok" : "NaN",
-                 (unsigned long)odr_hz);
-    } else {
-        s_samples_dropped += (uint32_t)(accel_valid ? accel_count : 0);
-        static uint32_t s_last_drop_ms = 0;
-        uint32_t t = (uint32_t)(esp_timer_get_time() / 1000);
-        if ((t - s_last_drop_ms) >= 1000) {
-            s_last_drop_ms = t;
-            ESP_LOGW(TAG, "MQTT not ready — dropped %lu samples total",
-                     (unsigned long)s_samples_dropped);
-        }
+    /* ---- Gaps: a sensor with nothing to send is one entry, not NaN rows ---- */
+    packet->gap_count = 0;
+    if (!(accel_valid && accel_count > 0)) {
+        packet->gaps[packet->gap_count++] = (mqtt_gap_t){
+            .sensor     = MQTT_GAP_SENSOR_ACCEL,
+            .reason     = MQTT_GAP_DISCONNECTED,
+            .start_tick = packet->base_tick,
+            .dur_us     = MQTT_GAP_PACKET_US,
+        };
     }
+    if (!(incl_valid && incl_count > 0)) {
+        packet->gaps[packet->gap_count++] = (mqtt_gap_t){
+            .sensor     = MQTT_GAP_SENSOR_INCL,
+            .reason     = s_scl3300_disconnected ? MQTT_GAP_DISCONNECTED : MQTT_GAP_NO_SAMPLES,
+            .start_tick = packet->base_tick,
+            .dur_us     = MQTT_GAP_PACKET_US,
+        };
+    }
+
+    /* ---- Temperature ---- */
+    packet->has_temp    = true;
+    packet->temp_valid  = temp_valid_arg;
+    packet->temp_tick   = temp_valid_arg ? current_temp_tick : packet->base_tick;
+    packet->temperature = temp_valid_arg ? current_temp : 0.0f;
+
+    /* ---- Hand off ---- */
+    packet->seq         = s_packet_seq++;
+    packet->send_utc_us = 0;
+    publish_pipeline_submit(packet, (uint32_t)(accel_valid ? accel_count : 0));
+    s_last_accel_publish_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    ESP_LOGD(TAG, "pkt accel=%d/%s incl=%d/%s temp=%s odr=%luHz",
+             accel_count, accel_valid ? "ok" : "NaN",
+             incl_count,  incl_valid  ? "ok" : "NaN",
+             temp_valid_arg ? "ok" : "NaN",
+             (unsigned long)cfg->odr_hz);
 }
 
 /******************************************************************************
@@ -278,34 +514,48 @@ static void data_processing_task(void *pvParameters)
 {
     ESP_LOGI(TAG, "Data processing task started");
 
-    adxl355_raw_sample_t adxl_sample;
+    adopt_config(node_config_get());
+    sensor_health_subscribe();
 
-    int      decim_count       = 0;
-    int64_t  sum_x             = 0;
-    int64_t  sum_y             = 0;
-    int64_t  sum_z             = 0;
-    uint32_t decim_first_tick  = 0;
     int      accel_batch_count = 0;
+    bool     accel_batch_open  = false;    /* open_build_slot() done for this batch */
 
-    uint32_t last_temp_read_ms = (uint32_t)(esp_timer_get_time() / 1000)
-                                 - TEMP_READ_INTERVAL_MS;
+    uint32_t last_temp_rx_ms = 0;
     float current_temp  = 0.0f;
     bool  temp_valid    = false;
-    char  current_temp_ts[MQTT_TS_LEN] = {0};
+    uint32_t current_temp_tick = 0;
 
     bool  incl_ever_received = false;
 
     uint32_t last_logged_odr = 0;
 
     s_last_accel_publish_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    uint32_t last_loop_ms   = s_last_accel_publish_ms;
 
     while (s_task_running) {
+        uint32_t loop_start_cycles = esp_cpu_get_cycle_count();
         uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
 
-        /* Snapshot runtime config — needed by both health watchdog and
-         * recording pipeline, so taken unconditionally every iteration. */
-        const node_runtime_config_t *cfg = node_config_get();
+        /* Loops are no longer evenly spaced: watchdogs count real time */
+        uint32_t elapsed_ms = now_ms - last_loop_ms;
+        last_loop_ms = now_ms;
+
+        /* Follow the published config, except that a live change while
+         * recording waits for its epoch_tick in the drain loop below. A
+         * change that restarted acquisition drops the batch in progress. */
         node_state_t state = node_config_get_state();
+        const node_runtime_config_t *latest = node_config_get();
+        if (latest->epoch != s_cfg.epoch &&
+            (state != NODE_STATE_RECORDING || !latest->live || s_adxl355_disconnected)) {
+            if (state == NODE_STATE_RECORDING) {
+                decimator_reset(&s_decim);
+                discard_build_slot();
+                accel_batch_count = 0;
+                accel_batch_open  = false;
+            }
+            adopt_config(latest);
+        }
+        const node_runtime_config_t *cfg = &s_cfg;
         uint32_t decim_factor      = cfg->decim_factor;
         uint32_t batch_size        = cfg->batch_size;
         float    sensitivity_lsb_g = cfg->sensitivity_lsb_g;
@@ -322,6 +572,18 @@ static void data_processing_task(void *pvParameters)
             uint32_t adxl_cnt = adxl355_get_sample_count();
             uint32_t scl_cnt  = scl3300_get_sample_count();
 
+            /* --- Health transitions pushed by the acquisition engine --- */
+            uint32_t health_bits = 0;
+            if (xTaskNotifyWait(0, UINT32_MAX, &health_bits, 0) != pdTRUE) {
+                health_bits = 0;
+            }
+            health_bits |= s_wake_bits;
+            s_wake_bits  = 0;
+            bool adxl_down = (health_bits & SENSOR_HEALTH_NOTIFY_BIT(SENSOR_HEALTH_ADXL355)) &&
+                             sensor_health_is_down(SENSOR_HEALTH_ADXL355);
+            bool scl_down  = (health_bits & SENSOR_HEALTH_NOTIFY_BIT(SENSOR_HEALTH_SCL3300)) &&
+                             sensor_health_is_down(SENSOR_HEALTH_SCL3300);
+
             /* --- Overflow faults --- */
             if (adxl_ov != s_adxl355_overflow_last && !s_adxl355_disconnected) {
                 fault_log_record(FAULT_ADXL355_DROPPED);
@@ -331,204 +593,110 @@ static void data_processing_task(void *pvParameters)
                 fault_log_record(FAULT_SCL3300_DROPPED);
                 s_scl3300_overflow_last = scl_ov;
             }
-            if (adt_ov != s_adt7420_overflow_last && !s_adt7420_disconnected) {
-                fault_log_record(FAULT_ADT7420_DROPPED);
+            if (adt_ov != s_adt7420_overflow_last) {
+                /* While offline the slow-sensors task has already logged it */
+                if (slow_sensors_adt7420_online()) {
+                    fault_log_record(FAULT_ADT7420_DROPPED);
+                }
                 s_adt7420_overflow_last = adt_ov;
             }
 
             /* --- ADXL355 disconnect watchdog --- */
-            if (adxl_cnt != s_adxl355_sample_last) {
+            if (adxl_cnt != s_adxl355_sample_last && !adxl_down) {
                 s_adxl355_sample_last  = adxl_cnt;
                 s_adxl355_watchdog_ms  = 0;
                 if (s_adxl355_disconnected) {
                     ESP_LOGI(TAG, "ADXL355 reconnected");
                     fault_log_record(FAULT_ADXL355_RECONNECTED);
                     s_adxl355_disconnected = false;
+                    sensor_recovery_set_lost(SENSOR_RECOVERY_ADXL355, false);
                     /* Sync shadow so stale overflow delta doesn't fire again */
                     s_adxl355_overflow_last = adxl_ov;
                 }
             } else {
-                s_adxl355_watchdog_ms += PROCESSING_INTERVAL_MS;
-                if (s_adxl355_watchdog_ms >= SENSOR_WATCHDOG_MS && !s_adxl355_disconnected) {
-                    ESP_LOGW(TAG, "ADXL355 stalled — sensor may be disconnected");
+                s_adxl355_watchdog_ms += elapsed_ms;
+                s_adxl355_sample_last  = adxl_cnt;   /* samples from before a down event */
+                if ((s_adxl355_watchdog_ms >= SENSOR_WATCHDOG_MS || adxl_down) &&
+                    !s_adxl355_disconnected) {
+                    if (adxl_down) {
+                        ESP_LOGW(TAG, "ADXL355 invalid frames — slot disabled, probing");
+                    } else {
+                        ESP_LOGW(TAG, "ADXL355 stalled — sensor may be disconnected");
+                    }
                     fault_log_record(FAULT_ADXL355_DROPPED);
                     fault_log_record(FAULT_SPI_ERROR);
                     s_adxl355_disconnected = true;
+                    sensor_recovery_set_lost(SENSOR_RECOVERY_ADXL355, true);
                 }
             }
 
             /* --- SCL3300 disconnect watchdog --- */
-            if (scl_cnt != s_scl3300_sample_last) {
+            if (scl_cnt != s_scl3300_sample_last && !scl_down) {
                 s_scl3300_sample_last  = scl_cnt;
                 s_scl3300_watchdog_ms  = 0;
                 if (s_scl3300_disconnected) {
                     ESP_LOGI(TAG, "SCL3300 reconnected");
                     fault_log_record(FAULT_SCL3300_RECONNECTED);
                     s_scl3300_disconnected = false;
+                    sensor_recovery_set_lost(SENSOR_RECOVERY_SCL3300, false);
                     /* Sync shadow so stale overflow delta doesn't fire again */
                     s_scl3300_overflow_last = scl_ov;
                 }
             } else {
-                s_scl3300_watchdog_ms += PROCESSING_INTERVAL_MS;
-                if (s_scl3300_watchdog_ms >= SENSOR_WATCHDOG_MS && !s_scl3300_disconnected) {
-                    ESP_LOGW(TAG, "SCL3300 stalled — sensor may be disconnected");
+                s_scl3300_watchdog_ms += elapsed_ms;
+                s_scl3300_sample_last  = scl_cnt;   /* samples from before a down event */
+                if ((s_scl3300_watchdog_ms >= SENSOR_WATCHDOG_MS || scl_down) &&
+                    !s_scl3300_disconnected) {
+                    if (scl_down) {
+                        ESP_LOGW(TAG, "SCL3300 invalid frames — slot disabled, probing");
+                    } else {
+                        ESP_LOGW(TAG, "SCL3300 stalled — sensor may be disconnected");
+                    }
                     fault_log_record(FAULT_SCL3300_DROPPED);
                     fault_log_record(FAULT_SPI_ERROR);
                     s_scl3300_disconnected = true;
+                    sensor_recovery_set_lost(SENSOR_RECOVERY_SCL3300, true);
                 }
             }
         }
 
         /* ------------------------------------------------------------------ */
-        /* SPI sensor reconnection: periodically attempt to reinit any        */
-        /* disconnected SPI sensor so it can recover after hot-plug.          */
+        /* ADXL355 reinitialised by the recovery task: samples and partial    */
+        /* batch from before the disconnect must not be mixed with fresh      */
+        /* post-reinit ones.                                                  */
         /* ------------------------------------------------------------------ */
-        if ((s_adxl355_disconnected || s_scl3300_disconnected) &&
-            (now_ms - s_last_reinit_attempt_ms) >= SENSOR_REINIT_INTERVAL_MS) {
-
-            s_last_reinit_attempt_ms = now_ms;
-
-            /*
-             * Inhibit ALL SPI sensor reads in the ISR for the duration of any
-             * reinit attempt. Both ADXL355 and SCL3300 share the same SPI bus,
-             * and the ISR's polling transmits from ISR context would collide
-             * with the task-context init sequence, corrupting both.
-             */
-            adxl355_isr_set_inhibit(true);
-            scl3300_isr_set_inhibit(true);
-
-            if (s_adxl355_disconnected) {
-                ESP_LOGI(TAG, "Attempting ADXL355 reinit...");
-
-                /*
-                 * Full reinit sequence mirroring adxl355_init():
-                 * soft-reset -> verify IDs -> standby -> configure -> measure.
-                 * This ensures the sensor comes up in a fully known state
-                 * rather than relying on retained register values after a
-                 * hot-plug (power may have been interrupted on disconnect).
-                 */
-                esp_err_t err = adxl355_write_reg_pub(ADXL355_REG_RESET, 0x52);
-                if (err == ESP_OK) {
-                    vTaskDelay(pdMS_TO_TICKS(10));
-
-                    uint8_t devid_ad  = 0;
-                    uint8_t devid_mst = 0;
-                    uint8_t partid    = 0;
-                    err = adxl355_read_reg_pub(ADXL355_REG_DEVID_AD,  &devid_ad,  1);
-                    if (err == ESP_OK) adxl355_read_reg_pub(ADXL355_REG_DEVID_MST, &devid_mst, 1);
-                    if (err == ESP_OK) adxl355_read_reg_pub(ADXL355_REG_PARTID,    &partid,    1);
-
-                    if (err == ESP_OK &&
-                        devid_ad  == ADXL355_DEVID_AD_EXPECTED &&
-                        devid_mst == ADXL355_DEVID_MST_EXPECTED &&
-                        partid    == ADXL355_PARTID_EXPECTED) {
-
-                        /* Full configuration sequence */
-                        const adxl355_odr_config_t *odr_cfg = node_config_get_odr(cfg->odr_index);
-                        adxl355_write_reg_pub(ADXL355_REG_POWER_CTL, ADXL355_POWER_STANDBY_BIT);
-                        vTaskDelay(pdMS_TO_TICKS(2));
-                        if (odr_cfg) {
-                            adxl355_write_reg_pub(ADXL355_REG_FILTER, odr_cfg->filter_reg);
-                        }
-                        adxl355_write_reg_pub(ADXL355_REG_INT_MAP, ADXL355_INT_RDY_EN1);
-                        adxl355_set_range(cfg->range);
-                        adxl355_write_reg_pub(ADXL355_REG_POWER_CTL, 0x00);
-
-                        /* Self-test to verify the sensing element is healthy */
-                        vTaskDelay(pdMS_TO_TICKS(5)); /* allow measurement mode to settle */
-                        bool st_passed = false;
-                        esp_err_t st_err = adxl355_selftest(&st_passed);
-                        if (st_err == ESP_OK && st_passed) {
-                            ESP_LOGI(TAG, "ADXL355 reinit + self-test OK — waiting for samples");
-                        } else {
-                            ESP_LOGW(TAG, "ADXL355 reinit OK but self-test FAILED — sensor may be damaged");
-                            fault_log_record(FAULT_ADXL355_SELFTEST_FAIL);
-                        }
-
-                        /*
-                         * Drain stale samples that accumulated in the ring
-                         * buffer during or just before reinit — mirrors the
-                         * SCL3300 pipeline reset that already does this.
-                         * Also reset the decimation accumulator so a partial
-                         * batch from before the disconnect is not mixed with
-                         * fresh post-reinit samples.
-                         */
-                        adxl355_raw_sample_t dummy_a;
-                        while (adxl355_data_available()) adxl355_read_sample(&dummy_a);
-                        decim_count       = 0;
-                        sum_x = sum_y = sum_z = 0;
-                        accel_batch_count = 0;
-
-                    } else {
-                        ESP_LOGD(TAG, "ADXL355 reinit: sensor not responding yet");
-                    }
-                }
-            }
-
-            if (s_scl3300_disconnected) {
-                ESP_LOGI(TAG, "Attempting SCL3300 reinit...");
-
-                /*
-                 * scl3300_init() runs the full datasheet Table 11 startup
-                 * sequence (SW reset, mode set, ANG_CTRL, status clear,
-                 * WHOAMI verify).  This is what we need after a hot-plug —
-                 * a partial register poke is not sufficient because the
-                 * sensor may have lost power and returned to POR state.
-                 */
-                esp_err_t err = scl3300_init();
-                if (err == ESP_OK) {
-                    /* Self-test to verify STO register and RS bits */
-                    bool st_passed = false;
-                    esp_err_t st_err = scl3300_selftest(&st_passed);
-                    if (st_err == ESP_OK && st_passed) {
-                        ESP_LOGI(TAG, "SCL3300 reinit + self-test OK — waiting for samples");
-                    } else {
-                        ESP_LOGW(TAG, "SCL3300 reinit OK but self-test FAILED — sensor may be damaged");
-                        fault_log_record(FAULT_SCL3300_SELFTEST_FAIL);
-                    }
-
-                    /* Reset ISR pipeline so it re-primes cleanly */
-                    scl3300_reset_isr_pipeline();
-                } else {
-                    ESP_LOGD(TAG, "SCL3300 reinit: sensor not responding yet");
-                }
+        {
+            uint32_t gen = sensor_recovery_get_generation(SENSOR_RECOVERY_ADXL355);
+            if (gen != s_adxl355_reinit_gen) {
+                s_adxl355_reinit_gen = gen;
+                adxl355_discard_samples();
+                spectrum_reset();
+                event_capture_reset();
+                decimator_reset(&s_decim);
+                discard_build_slot();
+                accel_batch_count = 0;
+                accel_batch_open  = false;
             }
-
-            /* Re-enable ISR reads for both sensors */
-            adxl355_isr_set_inhibit(false);
-            scl3300_isr_set_inhibit(false);
         }
 
         /* ------------------------------------------------------------------ */
-        /* Poll temperature (I2C, task context only)                          */
+        /* Latest temperature from the slow-sensors task (never blocks)       */
         /* ------------------------------------------------------------------ */
-        if ((now_ms - last_temp_read_ms) >= TEMP_READ_INTERVAL_MS) {
-            last_temp_read_ms = now_ms;
-            float tc = 0.0f;
-            esp_err_t err = adt7420_read_temperature(&tc);
-            if (err == ESP_OK) {
-                current_temp = tc;
-                temp_valid   = true;
-                s_temp_read_errors = 0;
-                if (s_adt7420_disconnected) {
-                    ESP_LOGI(TAG, "ADT7420 reconnected");
-                    fault_log_record(FAULT_ADT7420_RECONNECTED);
-                    s_adt7420_disconnected = false;
-                    /* Sync overflow shadow so a stale delta doesn't re-fire */
-                    s_adt7420_overflow_last = adt7420_get_overflow_count();
-                }
-                format_ts(current_temp_ts, get_tick_count());
-            } else {
+        {
+            adt7420_raw_sample_t temp_sample;
+            bool got_temp = false;
+            while (adt7420_read_sample(&temp_sample)) {
+                got_temp = true;
+            }
+            if (got_temp) {
+                current_temp      = adt7420_raw_to_celsius(temp_sample.raw_temp);
+                current_temp_tick = temp_sample.tick;
+                temp_valid        = true;
+                last_temp_rx_ms   = now_ms;
+            } else if (temp_valid &&
+                       (!slow_sensors_adt7420_online() ||
+                        (now_ms - last_temp_rx_ms) > TEMP_STALE_MS)) {
                 temp_valid = false;
-                s_temp_read_errors++;
-                ESP_LOGW(TAG, "Temp read failed: %s (#%lu)",
-                         esp_err_to_name(err), (unsigned long)s_temp_read_errors);
-                if (!s_adt7420_disconnected) {
-                    /* Log fault once on first failure, then stay quiet until recovery */
-                    fault_log_record(FAULT_ADT7420_DROPPED);
-                    fault_log_record(FAULT_I2C_ERROR);
-                    s_adt7420_disconnected = true;
-                }
             }
         }
 
@@ -538,16 +706,24 @@ static void data_processing_task(void *pvParameters)
         if (state != NODE_STATE_RECORDING) {
             /* Drain ring buffers so they don't fill up and overflow during idle */
             drain_ring_buffers();
-            decim_count        = 0;
-            sum_x = sum_y = sum_z = 0;
+            spectrum_reset();
+            event_capture_reset();
+            udp_stream_raw_close();
+            decimator_reset(&s_decim);
+            discard_build_slot();
             accel_batch_count  = 0;
+            accel_batch_open   = false;
             s_incl_batch_count = 0;
             incl_ever_received = false;
             s_last_accel_publish_ms = now_ms;
-            vTaskDelay(pdMS_TO_TICKS(PROCESSING_INTERVAL_MS));
+            timing_hist_record(TIMING_DATA_LOOP, esp_cpu_get_cycle_count() - loop_start_cycles);
+            wait_for_work();
             continue;
         }
 
+        /* Picks the filter profile on an ODR change; no-op otherwise */
+        decimator_configure(&s_decim, odr_hz, cfg->isr_tick_divisor);
+
         if (odr_hz != last_logged_odr) {
             ESP_LOGI(TAG, "Recording: ODR=%lu Hz decim=%lu batch=%lu sens=%.0f LSB/g",
                      (unsigned long)odr_hz, (unsigned long)decim_factor,
@@ -573,57 +749,150 @@ static void data_processing_task(void *pvParameters)
         /* ------------------------------------------------------------------ */
         /* Drain ADXL355 ring buffer — decimate and batch                     */
         /* ------------------------------------------------------------------ */
-        while (adxl355_data_available() && s_task_running) {
+        /* Walk contiguous spans of the ring in place; the read index moves
+         * once per span (or just before a publish, so a slow send does not
+         * hold already-decimated samples hostage). */
+        const adxl355_raw_sample_t *span;
+        uint32_t span_len;
+        while (s_task_running && (span_len = adxl355_peek_samples(&span)) > 0) {
 
             /* Break cleanly if state changes mid-drain */
             if (node_config_get_state() != NODE_STATE_RECORDING) {
-                decim_count = 0;
-                sum_x = sum_y = sum_z = 0;
+                decimator_reset(&s_decim);
+                discard_build_slot();
                 accel_batch_count  = 0;
+                accel_batch_open   = false;
                 s_incl_batch_count = 0;
                 break;
             }
 
-            if (!adxl355_read_sample(&adxl_sample)) break;
-
-            if (decim_count == 0) {
-                decim_first_tick = adxl_sample.tick;
+            /* Live config change: samples before its epoch_tick still belong
+             * to the current batch; at the tick the batch is closed short and
+             * everything downstream switches to the new config. */
+            uint32_t limit = span_len;
+            latest = node_config_get();
+            if (latest->epoch != s_cfg.epoch) {
+                limit = samples_before_tick(span, span_len, latest->epoch_tick);
+            }
+            if (limit == 0) {
+                if (accel_batch_count > 0) {
+                    flush_scl3300_to_batch();
+                    bool incl_valid_now = (s_incl_batch_count > 0) && !s_scl3300_disconnected;
+                    if (s_build != NULL) {
+                        publish_packet(s_build, accel_batch_count, true,
+                                       s_incl_batch_count, incl_valid_now,
+                                       temp_valid, current_temp, current_temp_tick);
+                        s_build = NULL;
+                    } else {
+                        const char *why;
+                        skip_packet(accel_batch_count, true,
+                                    publish_possible(&why) ? "Publish pipeline full" : why);
+                    }
+                    s_incl_batch_count = 0;
+                }
+                discard_build_slot();
+                accel_batch_count = 0;
+                accel_batch_open  = false;
+
+                /* Filter history in the old scale would smear the new one;
+                 * an HPF change keeps the decimator running */
+                if (latest->range != s_cfg.range) {
+                    decimator_reset(&s_decim);
+                    event_capture_reset();
+                }
+                adopt_config(latest);
+                decim_factor      = cfg->decim_factor;
+                batch_size        = cfg->batch_size;
+                sensitivity_lsb_g = cfg->sensitivity_lsb_g;
+                ESP_LOGI(TAG, "Switched to config epoch %lu at tick %lu (range=%u hpf=%u)",
+                         (unsigned long)cfg->epoch, (unsigned long)cfg->epoch_tick,
+                         cfg->range, cfg->hpf_corner);
+                continue;
             }
 
-            sum_x += (int64_t)adxl_sample.raw_x;
-            sum_y += (int64_t)adxl_sample.raw_y;
-            sum_z += (int64_t)adxl_sample.raw_z;
-            decim_count++;
-
-            if ((uint32_t)decim_count >= decim_factor) {
-                int32_t avg_x = (int32_t)(sum_x / (int64_t)decim_factor);
-                int32_t avg_y = (int32_t)(sum_y / (int64_t)decim_factor);
-                int32_t avg_z = (int32_t)(sum_z / (int64_t)decim_factor);
+            uint32_t consumed  = 0;
+            uint32_t committed = 0;
+            bool     hold      = false;
+            while (consumed < limit) {
+                if (!accel_batch_open) {
+                    /* No slot free but one will be: leave the samples in the
+                     * PSRAM history rather than decimate them into a drop */
+                    const char *why;
+                    if (s_build == NULL && raw_history_may_hold() &&
+                        publish_pipeline_free_slots() == 0 && publish_possible(&why)) {
+                        raw_history_note_hold();
+                        hold = true;
+                        break;
+                    }
+                    open_build_slot(decim_factor * cfg->isr_tick_divisor);
+                    accel_batch_open = true;
+                }
 
-                s_accel_x[accel_batch_count] = convert_adxl355_to_g(avg_x, sensitivity_lsb_g);
-                s_accel_y[accel_batch_count] = convert_adxl355_to_g(avg_y, sensitivity_lsb_g);
-                s_accel_z[accel_batch_count] = convert_adxl355_to_g(avg_z, sensitivity_lsb_g);
-                s_accel_ticks[accel_batch_count] = decim_first_tick;
-                accel_batch_count++;
+                /* Output goes straight into the slot, or the drop scratch */
+                uint32_t room = batch_size - (uint32_t)accel_batch_count;
+                if (room > ACCEL_CHUNK) {
+                    room = ACCEL_CHUNK;
+                }
+                int32_t *out[3];
+                for (int a = 0; a < 3; a++) {
+                    out[a] = (s_build != NULL) ? &s_build->accel[a][accel_batch_count]
+                                               : s_drop_raw[a];
+                }
 
-                decim_count = 0;
-                sum_x = sum_y = sum_z = 0;
+                uint32_t ticks[ACCEL_CHUNK];
+                uint32_t used;
+                uint32_t produced = decimator_process(&s_decim,
+                                                      span + consumed, limit - consumed,
+                                                      &used, out, ticks, room);
+
+                /* Burst trigger sees the raw ODR stream, ahead of decimation
+                 * (fed before the commit: it takes sequence numbers off span) */
+                if (event_capture_active()) {
+                    event_capture_feed(span + consumed, used, odr_hz,
+                                       cfg->isr_tick_divisor, sensitivity_lsb_g);
+                }
+                /* Undecimated copy for the multicast stream ("udp_raw") */
+                udp_stream_feed_raw(span + consumed, used, cfg);
+                for (uint32_t k = 0; k < produced; k++) {
+                    const int32_t xyz[3] = { out[0][k], out[1][k], out[2][k] };
+                    spectrum_feed(xyz, sensitivity_lsb_g);
+                }
+                accel_batch_count = (s_build != NULL)
+                    ? place_on_grid(s_build, accel_batch_count, ticks, produced, batch_size)
+                    : accel_batch_count + (int)produced;
+                consumed += used;
 
                 if ((uint32_t)accel_batch_count >= batch_size) {
+                    adxl355_commit_samples(consumed - committed);
+                    committed = consumed;
+
                     /* Flush any late SCL3300 samples before publishing */
                     flush_scl3300_to_batch();
 
                     bool incl_valid_now = (s_incl_batch_count > 0) && !s_scl3300_disconnected;
 
-                    publish_packet(accel_batch_count, true,
-                                   s_incl_batch_count, incl_valid_now,
-                                   temp_valid, current_temp, current_temp_ts,
-                                   odr_hz);
+                    if (s_build != NULL) {
+                        publish_packet(s_build, accel_batch_count, true,
+                                       s_incl_batch_count, incl_valid_now,
+                                       temp_valid, current_temp,
+                                       current_temp_tick);
+                        s_build = NULL;
+                    } else {
+                        /* No slot was free (or wanted) when the batch began */
+                        const char *why;
+                        skip_packet(accel_batch_count, true,
+                                    publish_possible(&why) ? "Publish pipeline full" : why);
+                    }
 
                     accel_batch_count  = 0;
+                    accel_batch_open   = false;
                     s_incl_batch_count = 0;
                 }
             }
+            adxl355_commit_samples(consumed - committed);
+            if (hold) {
+                break;
+            }
         }
 
         /* ------------------------------------------------------------------ */
@@ -638,15 +907,16 @@ static void data_processing_task(void *pvParameters)
 
             bool incl_valid_now = (s_incl_batch_count > 0) && !s_scl3300_disconnected;
 
-            publish_packet(0, false,                             /* accel = NaN */
+            publish_packet(NULL, 0, false,                       /* accel = NaN */
                            s_incl_batch_count, incl_valid_now,
-                           temp_valid, current_temp, current_temp_ts,
-                           odr_hz);
+                           temp_valid, current_temp,
+                           current_temp_tick);
 
             s_incl_batch_count = 0;
         }
 
-        vTaskDelay(pdMS_TO_TICKS(PROCESSING_INTERVAL_MS));
+        timing_hist_record(TIMING_DATA_LOOP, esp_cpu_get_cycle_count() - loop_start_cycles);
+        wait_for_work();
     }
 
     ESP_LOGI(TAG, "Data processing task stopped");
@@ -661,25 +931,44 @@ esp_err_t data_processing_and_mqtt_task_init(void)
 {
     ESP_LOGI(TAG, "Initializing data processing task...");
 
-    s_samples_published = 0;
-    s_packets_sent      = 0;
     s_samples_dropped   = 0;
-    s_temp_read_errors  = 0;
-    s_adt7420_disconnected = false;
+
+    esp_err_t err = publish_pipeline_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start publish pipeline: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    /* Non-fatal: packets carry NaN temperature without the slow-sensors task */
+    if (slow_sensors_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Slow-sensors task unavailable");
+    }
+
+    /* Non-fatal: a disconnected SPI sensor then stays NaN until reboot */
+    if (sensor_recovery_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Sensor recovery task unavailable");
+    }
+
+    /* Non-fatal: raw data still flows without the spectrum stage */
+    if (spectrum_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Spectrum stage unavailable");
+    }
+
+    /* Non-fatal: without the PSRAM tier the ISR ring is the only backlog */
+    if (raw_history_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Raw history unavailable");
+    }
+    if (event_capture_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Event capture unavailable");
+    }
 
     s_task_running = true;
 
-    BaseType_t ret = xTaskCreatePinnedToCore(
-        data_processing_task,
-        "data_proc",
-        DATA_PROCESSING_TASK_STACK_SIZE,
-        NULL,
-        DATA_PROCESSING_TASK_PRIORITY,
-        &s_task_handle,
-        DATA_PROCESSING_TASK_CORE
-    );
-
-    if (ret != pdPASS) {
+    s_task_handle = mem_budget_task_create("data_task", &s_task_mem, data_processing_task,
+                                           "data_proc", NULL, DATA_PROCESSING_TASK_PRIORITY,
+                                           DATA_PROCESSING_TASK_CORE);
+
+    if (s_task_handle == NULL) {
         ESP_LOGE(TAG, "Failed to create task");
         return ESP_FAIL;
     }
@@ -694,8 +983,12 @@ esp_err_t data_processing_and_mqtt_task_stop(void)
 {
     ESP_LOGI(TAG, "Stopping data processing task...");
     s_task_running = false;
+    if (s_task_handle != NULL) {
+        xTaskNotify(s_task_handle, SENSOR_DATA_NOTIFY_BIT, eSetBits);
+    }
     vTaskDelay(pdMS_TO_TICKS(200));
     s_task_handle = NULL;
+    publish_pipeline_stop();
     ESP_LOGI(TAG, "Task stopped");
     return ESP_OK;
 }
@@ -704,7 +997,10 @@ void data_processing_and_mqtt_task_get_stats(uint32_t *samples_published,
                                               uint32_t *packets_sent,
                                               uint32_t *samples_dropped)
 {
-    if (samples_published) *samples_published = s_samples_published;
-    if (packets_sent)      *packets_sent      = s_packets_sent;
-    if (samples_dropped)   *samples_dropped   = s_samples_dropped;
+    publish_pipeline_stats_t ps;
+    publish_pipeline_get_stats(&ps);
+
+    if (samples_published) *samples_published = ps.samples_published;
+    if (packets_sent)      *packets_sent      = ps.packets_published;
+    if (samples_dropped)   *samples_dropped   = s_samples_dropped + ps.samples_failed;
 }
@@ -17,6 +17,7 @@
 #define DATA_PROCESSING_AND_MQTT_TASK_H
 
 #include "esp_err.h"
+#include "cpu_topology.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -30,10 +31,17 @@ extern "C" {
 
 #define DATA_PROCESSING_TASK_STACK_SIZE    8192
 #define DATA_PROCESSING_TASK_PRIORITY      5
-#define DATA_PROCESSING_TASK_CORE          0
+#define DATA_PROCESSING_TASK_CORE          SHM_CORE_ACQ
 
-/** How often the processing loop wakes to drain ring buffers (ms). */
-#define PROCESSING_INTERVAL_MS             50
+/**
+ * The processing loop blocks on its notification value: a data-ready bit
+ * every PROCESSING_WAKE_MS of raw ADXL355 samples (watermark scaled to the
+ * ODR), or a sensor health transition. PROCESSING_TIMEOUT_MS is the
+ * fallback wake for the watchdogs, NaN packets and idle draining while no
+ * accelerometer data arrives.
+ */
+#define PROCESSING_WAKE_MS                 20
+#define PROCESSING_TIMEOUT_MS              200
 
 /******************************************************************************
  * PUBLIC FUNCTIONS
@@ -0,0 +1,177 @@
+/**
+ * @file decimator.c
+ * @brief CIC + compensating FIR decimation of the raw ADXL355 stream.
+ *
+ * See decimator.h for the structure. All state is owned by the caller's
+ * decimator_t; the module itself only holds the constant profile tables.
+ */
+
+#include "decimator.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "DECIM";
+
+#include "decimator_coeffs.h"
+
+_Static_assert(DECIM_CIC_ORDER <= DECIM_CIC_MAX_ORDER, "CIC order exceeds state size");
+_Static_assert(DECIM_MAX_TAPS <= DECIM_HIST_MAX_TAPS, "FIR taps exceed history size");
+
+#define PROFILE_COUNT   (sizeof(s_profiles) / sizeof(s_profiles[0]))
+
+/******************************************************************************
+ * STAGES
+ *****************************************************************************/
+
+/**
+ * One raw sample through the CIC. Returns true (and the intermediate sample
+ * in *y) on every R1-th input. Unsigned wrap-around is intentional.
+ */
+static inline bool cic_step(decimator_t *d, int axis, int32_t x, int32_t *y)
+{
+    const decim_profile_t *p = d->profile;
+    uint32_t *integ = d->integ[axis];
+    uint32_t v = (uint32_t)x;
+
+    for (int k = 0; k < p->cic_order; k++) {
+        integ[k] += v;
+        v = integ[k];
+    }
+    if (d->cic_phase + 1 < p->cic_decim) {
+        return false;
+    }
+
+    uint32_t *comb = d->comb[axis];
+    for (int k = 0; k < p->cic_order; k++) {
+        uint32_t prev = comb[k];
+        comb[k] = v;
+        v -= prev;
+    }
+    *y = (int32_t)v;
+    return true;
+}
+
+/** Symmetric FIR over the current history window (oldest first). */
+static inline int32_t fir_dot(const decimator_t *d, int axis)
+{
+    const decim_profile_t *p = d->profile;
+    const int32_t *w = &d->hist[axis][d->hist_pos];
+    const int32_t *c = p->fir_coef;
+    uint32_t L    = p->fir_taps;
+    uint32_t half = L / 2;
+
+    int64_t acc = (int64_t)c[half] * w[half];
+    for (uint32_t k = 0; k < half; k++) {
+        acc += (int64_t)c[k] * ((int64_t)w[k] + w[L - 1 - k]);
+    }
+    return (int32_t)((acc + (1LL << (DECIM_COEF_SHIFT - 1))) >> DECIM_COEF_SHIFT);
+}
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+void decimator_reset(decimator_t *d)
+{
+    const decim_profile_t *p = d->profile;
+
+    memset(d->integ, 0, sizeof(d->integ));
+    memset(d->comb,  0, sizeof(d->comb));
+    memset(d->hist,  0, sizeof(d->hist));
+    d->cic_phase = 0;
+    d->hist_pos  = 0;
+    d->fir_phase = 0;
+    d->warmup    = p ? (p->fir_taps + p->cic_order + p->fir_decim - 1) / p->fir_decim : 0;
+}
+
+esp_err_t decimator_configure(decimator_t *d, uint32_t odr_hz, uint32_t period_ticks)
+{
+    if (d->profile != NULL && d->profile->odr_hz == odr_hz) {
+        return ESP_OK;
+    }
+
+    const decim_profile_t *p = NULL;
+    for (size_t i = 0; i < PROFILE_COUNT; i++) {
+        if (s_profiles[i].odr_hz == odr_hz) {
+            p = &s_profiles[i];
+            break;
+        }
+    }
+    if (p == NULL) {
+        ESP_LOGE(TAG, "No decimation profile for ODR %lu Hz", (unsigned long)odr_hz);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    d->profile     = p;
+    d->delay_ticks = (uint32_t)p->delay_half * period_ticks / 2;
+    decimator_reset(d);
+
+    ESP_LOGI(TAG, "ODR %lu Hz: CIC%u /%u -> FIR %u taps /%u, delay %lu ticks",
+             (unsigned long)odr_hz, (unsigned)p->cic_order, (unsigned)p->cic_decim,
+             (unsigned)p->fir_taps, (unsigned)p->fir_decim,
+             (unsigned long)d->delay_ticks);
+    return ESP_OK;
+}
+
+uint32_t decimator_process(decimator_t *d,
+                           const adxl355_raw_sample_t *in, uint32_t n_in,
+                           uint32_t *n_used,
+                           int32_t *const out[3], uint32_t *out_tick,
+                           uint32_t max_out)
+{
+    const decim_profile_t *p = d->profile;
+    uint32_t produced = 0;
+    uint32_t i = 0;
+
+    if (p == NULL) {
+        *n_used = n_in;
+        return 0;
+    }
+
+    const uint32_t L = p->fir_taps;
+
+    while (i < n_in && produced < max_out) {
+        const adxl355_raw_sample_t *s = &in[i++];
+        /* cic_step() writes y[] for all three axes on the same phase; the
+         * initialiser only keeps -O3 from flagging y[1] and y[2] */
+        int32_t y[3] = { 0, 0, 0 };
+
+        if (!cic_step(d, 0, s->raw_x, &y[0])) {
+            cic_step(d, 1, s->raw_y, &y[1]);
+            cic_step(d, 2, s->raw_z, &y[2]);
+            d->cic_phase++;
+            continue;
+        }
+        cic_step(d, 1, s->raw_y, &y[1]);
+        cic_step(d, 2, s->raw_z, &y[2]);
+        d->cic_phase = 0;
+
+        /* Mirrored history: the window is always hist[pos .. pos + L - 1] */
+        for (int a = 0; a < 3; a++) {
+            d->hist[a][d->hist_pos]     = y[a];
+            d->hist[a][d->hist_pos + L] = y[a];
+        }
+        if (++d->hist_pos == L) {
+            d->hist_pos = 0;
+        }
+
+        if (++d->fir_phase < p->fir_decim) {
+            continue;
+        }
+        d->fir_phase = 0;
+
+        if (d->warmup > 0) {
+            d->warmup--;
+            continue;
+        }
+
+        out[0][produced]   = fir_dot(d, 0);
+        out[1][produced]   = fir_dot(d, 1);
+        out[2][produced]   = fir_dot(d, 2);
+        out_tick[produced] = s->tick - d->delay_ticks;
+        produced++;
+    }
+
+    *n_used = i;
+    return produced;
+}
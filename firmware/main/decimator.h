@@ -0,0 +1,103 @@
+/**
+ * @file decimator.h
+ * @brief ADXL355 ODR -> 200 Hz decimation engine (CIC + compensating FIR).
+ *
+ * Replaces the old boxcar average, whose sinc response let content around
+ * 120-280 Hz fold back into the band almost unattenuated (~-6 dB at 120 Hz
+ * for the 4 kHz ODR).
+ *
+ * Each ODR has a profile in decimator_coeffs.h (generated by
+ * firmware/tools/gen_decim_coeffs.py):
+ *
+ *   raw ODR --> CIC, order N, /R1 --> FIR, L taps, /R2 --> 200 Hz
+ *
+ *   - The CIC runs integer integrators per raw sample (int32, wrap-around
+ *     arithmetic is exact as long as the output fits) and combs per R1.
+ *   - The FIR flattens the CIC droop over 0-80 Hz and removes everything
+ *     from 120 Hz up; it is symmetric, so only (L+1)/2 multiplies are done,
+ *     and only on every R2-th intermediate sample (polyphase).
+ *   - The Q30 coefficients include 1/R1^N, so no divide is ever executed.
+ *
+ * The filters are linear phase, so every output is stamped with the tick of
+ * the raw sample that completed it minus the fixed group delay. The first
+ * outputs after a reset are withheld until the history is full.
+ *
+ * Processing is block-based: decimator_process() walks a span handed out
+ * by adxl355_peek_samples() in place and stops as soon as the caller's
+ * output batch is full, reporting how many raw samples it consumed.
+ */
+
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include "esp_err.h"
+#include "sensor_task.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** One ODR's filter chain. Instances live in decimator_coeffs.h. */
+typedef struct {
+    uint32_t       odr_hz;
+    uint8_t        cic_order;     /**< 0 = CIC stage bypassed                */
+    uint8_t        cic_decim;     /**< R1                                     */
+    uint8_t        fir_decim;     /**< R2                                     */
+    uint16_t       fir_taps;      /**< L, odd                                 */
+    const int32_t *fir_coef;      /**< L coefficients, Q30 / R1^N             */
+    uint16_t       delay_half;    /**< Group delay in half raw-sample periods */
+} decim_profile_t;
+
+#define DECIM_CIC_MAX_ORDER     3
+#define DECIM_HIST_MAX_TAPS     96
+
+typedef struct {
+    const decim_profile_t *profile;
+    uint32_t delay_ticks;                          /**< Group delay in timer ticks */
+    uint32_t integ[3][DECIM_CIC_MAX_ORDER];        /**< CIC integrators (wrapping) */
+    uint32_t comb[3][DECIM_CIC_MAX_ORDER];         /**< CIC comb delay elements    */
+    uint32_t cic_phase;
+    int32_t  hist[3][2 * DECIM_HIST_MAX_TAPS];     /**< FIR history, mirrored      */
+    uint32_t hist_pos;
+    uint32_t fir_phase;
+    uint32_t warmup;                               /**< Outputs still to withhold  */
+} decimator_t;
+
+/**
+ * @brief Select the profile for an ODR and reset the filter state.
+ *
+ * A no-op if the same ODR is already configured.
+ *
+ * @param odr_hz        Raw ADXL355 output data rate
+ * @param period_ticks  Timer ticks between raw samples (isr_tick_divisor)
+ * @return ESP_ERR_NOT_SUPPORTED if no profile exists for odr_hz.
+ */
+esp_err_t decimator_configure(decimator_t *d, uint32_t odr_hz, uint32_t period_ticks);
+
+/** @brief Clear all filter history (stream gap, reinit, leaving RECORDING). */
+void decimator_reset(decimator_t *d);
+
+/**
+ * @brief Decimate a block of raw samples.
+ *
+ * @param in        Raw samples, oldest first
+ * @param n_in      Number of samples in @p in
+ * @param n_used    Out: raw samples consumed (< n_in only if max_out was hit)
+ * @param out       Output counts per axis (x, y, z arrays), same scale as
+ *                  the raw input
+ * @param out_tick  Output timestamps, group-delay corrected
+ * @param max_out   Room left in each out array and out_tick
+ * @return Number of outputs written.
+ */
+uint32_t decimator_process(decimator_t *d,
+                           const adxl355_raw_sample_t *in, uint32_t n_in,
+                           uint32_t *n_used,
+                           int32_t *const out[3], uint32_t *out_tick,
+                           uint32_t max_out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DECIMATOR_H
@@ -0,0 +1,85 @@
+/**
+ * @file decimator_coeffs.h
+ * @brief Decimation profiles — GENERATED by firmware/tools/gen_decim_coeffs.py.
+ *
+ * Do not edit by hand; re-run the generator instead. Included only by
+ * decimator.c.
+ *
+ * CIC order 3, FIR passband 0-80 Hz (CIC droop compensated), stopband
+ * from 120 Hz, Kaiser 60 dB design, coefficients Q30 / R1^N.
+ *
+ *   ODR   R1  R2  taps  ripple   worst alias into 0-80 Hz
+ *   4000   5   4    75  0.02 dB  -55.9 dB
+ *   2000   2   5    93  0.02 dB  -53.9 dB
+ *   1000   1   5    93  0.01 dB  -60.1 dB
+ */
+
+#ifndef DECIMATOR_COEFFS_H
+#define DECIMATOR_COEFFS_H
+
+#define DECIM_CIC_ORDER      3
+#define DECIM_COEF_SHIFT     30
+#define DECIM_MAX_TAPS       93
+
+static const int32_t s_fir_4000[75] = {
+         -1152,        -13,       2452,       4742,       4443,         48,
+         -7120,     -12575,     -10963,       -127,      15700,      26579,
+         22339,        291,     -30013,     -49597,     -40821,       -625,
+         52688,      85936,      69997,       1323,     -88304,    -143646,
+       -117097,      -2937,     147220,     242626,     201767,       7658,
+       -262262,    -454863,    -407411,     -32299,     622894,    1375222,
+       1972800,    2200135,    1972800,    1375222,     622894,     -32299,
+       -407411,    -454863,    -262262,       7658,     201767,     242626,
+        147220,      -2937,    -117097,    -143646,     -88304,       1323,
+         69997,      85936,      52688,       -625,     -40821,     -49597,
+        -30013,        291,      22339,      26579,      15700,       -127,
+        -10963,     -12575,      -7120,         48,       4443,       4742,
+          2452,        -13,      -1152,
+};
+
+static const int32_t s_fir_2000[93] = {
+        -11473,        118,      21896,      45865,      58063,      44519,
+          -296,     -66601,    -128547,    -152113,    -110260,        434,
+        149973,     279153,     319777,     225318,       -282,    -290263,
+       -529443,    -595271,    -412728,       -715,     513617,     926519,
+       1031222,     709453,       3819,    -865100,   -1555960,   -1728508,
+      -1190574,     -12497,    1445699,    2622667,    2945466,    2063199,
+         40230,   -2572624,   -4835819,   -5677409,   -4237751,    -192107,
+       6063037,   13436774,   20393122,   25357175,   27156180,   25357175,
+      20393122,   13436774,    6063037,    -192107,   -4237751,   -5677409,
+      -4835819,   -2572624,      40230,    2063199,    2945466,    2622667,
+       1445699,     -12497,   -1190574,   -1728508,   -1555960,    -865100,
+          3819,     709453,    1031222,     926519,     513617,       -715,
+       -412728,    -595271,    -529443,    -290263,       -282,     225318,
+        319777,     279153,     149973,        434,    -110260,    -152113,
+       -128547,     -66601,       -296,      44519,      58063,      45865,
+         21896,        118,     -11473,
+};
+
+static const int32_t s_fir_1000[93] = {
+        -88146,       1469,     169457,     353977,     447305,     341907,
+         -4413,    -515705,    -992247,   -1171745,    -846367,       9090,
+       1162045,    2155191,    2463005,    1728407,     -15477,   -2251080,
+      -4088703,   -4584277,   -3163125,      23205,    3988406,    7158225,
+       7940175,    5430033,     -31574,   -6731318,  -12029799,  -13306114,
+      -9093671,      39640,   11289106,   20305401,   22669263,   15701372,
+        -46372,  -20249885,  -37583075,  -43716407,  -31996619,      50843,
+      49282160,  107153378,  161667346,  200537210,  214618834,  200537210,
+     161667346,  107153378,   49282160,      50843,  -31996619,  -43716407,
+     -37583075,  -20249885,     -46372,   15701372,   22669263,   20305401,
+      11289106,      39640,   -9093671,  -13306114,  -12029799,   -6731318,
+        -31574,    5430033,    7940175,    7158225,    3988406,      23205,
+      -3163125,   -4584277,   -4088703,   -2251080,     -15477,    1728407,
+       2463005,    2155191,    1162045,       9090,    -846367,   -1171745,
+       -992247,    -515705,      -4413,     341907,     447305,     353977,
+        169457,       1469,     -88146,
+};
+
+static const decim_profile_t s_profiles[] = {
+    /* odr,  cic_order, R1, R2, taps, coef, delay (half raw samples) */
+    { 4000, 3,  5, 4,  75, s_fir_4000,  382 },
+    { 2000, 3,  2, 5,  93, s_fir_2000,  187 },
+    { 1000, 0,  1, 5,  93, s_fir_1000,   92 },
+};
+
+#endif // DECIMATOR_COEFFS_H
@@ -0,0 +1,558 @@
+/**
+ * @file event_capture.c
+ * @brief Triggered raw-ODR burst capture with pre-trigger history.
+ *
+ * See event_capture.h for the trigger modes and chunk format.
+ *
+ * Ownership: the data task owns the ring and the detector in every state
+ * except UPLOADING, during which the upload task reads the frozen ring.
+ * With the PSRAM raw history enabled (raw_history.h) there is no ring of
+ * our own: the window is remembered by sample sequence and copied out of
+ * the history at upload time, while the data task keeps consuming.
+ * Everyone else (MQTT command handler, upload task on completion) only
+ * raises the s_reset_req / s_manual_req flags, which the data task acts on
+ * at its next feed.
+ */
+
+#include "event_capture.h"
+#include "mem_budget.h"
+#include "raw_history.h"
+#include "mqtt.h"
+#include "node_config.h"
+#include "packet_time.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "EVENT";
+
+MEM_BUDGET_STATIC_TASK(s_task_mem, EVENT_TASK_STACK_SIZE);
+
+#define EVENT_TOPIC_BUF_SIZE   80
+#define EVENT_CHUNK_BUF_SIZE   (EVENT_BIN_HEADER_LEN + EVENT_CHUNK_SAMPLES * 12)
+#define EVENT_RETRY_DELAY_MS   500
+
+typedef enum {
+    EV_STATE_ARMING    = 0,
+    EV_STATE_ARMED     = 1,
+    EV_STATE_CAPTURING = 2,
+    EV_STATE_UPLOADING = 3,
+} ev_state_t;
+
+/* Shared flags */
+static volatile event_trigger_mode_t s_mode  = EVENT_TRIGGER_OFF;
+static volatile int32_t              s_level = 0;
+static volatile ev_state_t           s_state = EV_STATE_ARMING;
+static volatile bool                 s_reset_req  = true;
+static volatile bool                 s_manual_req = false;
+static volatile uint32_t             s_upload_done_ms = 0;
+
+/* Ring (data task, frozen while UPLOADING); unused with the raw history */
+static int32_t (*s_ring)[3] = NULL;
+static uint32_t s_cap    = 0;          /* window limit, samples    */
+static bool     s_psram  = false;
+static bool     s_ready  = false;
+static bool     s_use_history = false;
+static uint32_t s_wi     = 0;          /* next write index         */
+static uint32_t s_filled = 0;          /* samples since re-arm     */
+
+/* Stream parameters the current window was armed with */
+static uint32_t s_odr_hz       = 0;
+static uint32_t s_period_ticks = 0;
+static uint32_t s_last_tick    = 0;
+static uint32_t s_pre          = 0;
+static uint32_t s_post         = 0;
+static uint32_t s_settle       = 0;
+
+/* Detector */
+static bool  s_dc_init = false;
+static float s_dc[3];
+static float s_ms;                     /* rms mode mean square     */
+static float s_sta, s_lta;
+static float s_k_dc, s_k_rms, s_k_sta, s_k_lta;
+
+/* Captured event (written by the data task before UPLOADING) */
+static uint32_t s_trig_wi;
+static uint32_t s_trig_seq;            /* raw history sequence     */
+static uint32_t s_trig_tick;
+static uint32_t s_after_trig;
+static float    s_trig_value;
+static uint8_t  s_trig_mode;
+static uint32_t s_event_id = 0;
+
+static TaskHandle_t s_task_handle = NULL;
+static uint8_t      s_chunk_buf[EVENT_CHUNK_BUF_SIZE];
+
+/* Stats */
+static volatile uint32_t s_events_triggered = 0;
+static volatile uint32_t s_events_uploaded  = 0;
+static volatile uint32_t s_events_failed    = 0;
+static volatile uint32_t s_chunks_published = 0;
+static volatile uint32_t s_triggers_ignored = 0;
+
+static inline uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+/******************************************************************************
+ * DETECTOR
+ *****************************************************************************/
+
+static inline float one_pole_k(uint32_t tau_ms, uint32_t odr_hz)
+{
+    float n = (float)tau_ms * (float)odr_hz / 1000.0f;
+    return (n > 1.0f) ? 1.0f / n : 1.0f;
+}
+
+/** Start a fresh window for the given stream parameters. */
+static void rearm(uint32_t odr_hz, uint32_t period_ticks)
+{
+    s_odr_hz       = odr_hz;
+    s_period_ticks = period_ticks;
+
+    s_pre  = EVENT_PRE_MS  * odr_hz / 1000u;
+    s_post = EVENT_POST_MS * odr_hz / 1000u;
+    if (s_pre + s_post > s_cap) {
+        s_pre  = (uint32_t)((uint64_t)s_cap * EVENT_PRE_MS / (EVENT_PRE_MS + EVENT_POST_MS));
+        s_post = s_cap - s_pre;
+    }
+
+    s_settle = EVENT_DC_MS * odr_hz / 1000u;
+    if (s_mode == EVENT_TRIGGER_STA_LTA && s_settle < EVENT_LTA_MS * odr_hz / 1000u) {
+        s_settle = EVENT_LTA_MS * odr_hz / 1000u;
+    }
+    if (s_settle < s_pre) {
+        s_settle = s_pre;
+    }
+
+    s_k_dc  = one_pole_k(EVENT_DC_MS,         odr_hz);
+    s_k_rms = one_pole_k(EVENT_RMS_WINDOW_MS, odr_hz);
+    s_k_sta = one_pole_k(EVENT_STA_MS,        odr_hz);
+    s_k_lta = one_pole_k(EVENT_LTA_MS,        odr_hz);
+
+    s_wi      = 0;
+    s_filled  = 0;
+    s_dc_init = false;
+    s_ms = s_sta = s_lta = 0.0f;
+    s_state   = EV_STATE_ARMING;
+}
+
+/**
+ * Update the detector with one sample (in g).
+ * @return true if the configured trigger condition holds; *value is set.
+ */
+static inline bool detect(const float g[3], float *value)
+{
+    if (!s_dc_init) {
+        memcpy(s_dc, g, sizeof(s_dc));
+        s_dc_init = true;
+    }
+
+    float e2 = 0.0f;
+    for (int a = 0; a < 3; a++) {
+        float d = g[a] - s_dc[a];
+        s_dc[a] += d * s_k_dc;
+        e2 += d * d;
+    }
+
+    float lvl = (float)s_level / 1000.0f;     /* mg -> g */
+
+    switch (s_mode) {
+        case EVENT_TRIGGER_THRESHOLD:
+            if (e2 > lvl * lvl) {
+                *value = sqrtf(e2);
+                return true;
+            }
+            return false;
+
+        case EVENT_TRIGGER_RMS:
+            s_ms += (e2 - s_ms) * s_k_rms;
+            if (s_ms > lvl * lvl) {
+                *value = sqrtf(s_ms);
+                return true;
+            }
+            return false;
+
+        case EVENT_TRIGGER_STA_LTA: {
+            s_sta += (e2 - s_sta) * s_k_sta;
+            s_lta += (e2 - s_lta) * s_k_lta;
+            float ratio = (float)s_level / 10.0f;
+            if (s_lta > 0.0f && s_sta > ratio * s_lta) {
+                *value = s_sta / s_lta;
+                return true;
+            }
+            return false;
+        }
+
+        default:
+            return false;
+    }
+}
+
+/******************************************************************************
+ * FEED (data task)
+ *****************************************************************************/
+
+void event_capture_feed(const adxl355_raw_sample_t *in, uint32_t n,
+                        uint32_t odr_hz, uint32_t period_ticks, float lsb_per_g)
+{
+    if (!s_ready || n == 0) {
+        return;
+    }
+    if (s_state == EV_STATE_UPLOADING) {
+        return;
+    }
+    if (s_reset_req || odr_hz != s_odr_hz || period_ticks != s_period_ticks) {
+        s_reset_req = false;
+        rearm(odr_hz, period_ticks);
+    }
+
+    const float inv = 1.0f / lsb_per_g;
+
+    for (uint32_t i = 0; i < n; i++) {
+        const adxl355_raw_sample_t *s = &in[i];
+
+        /* A gap (ring overflow, paused feed) would splice unrelated data */
+        if (s_filled > 0 && (uint32_t)(s->tick - s_last_tick) != s_period_ticks) {
+            if (s_state == EV_STATE_CAPTURING) {
+                ESP_LOGW(TAG, "Stream gap during capture — event %lu discarded",
+                         (unsigned long)s_event_id);
+                s_events_failed++;
+            }
+            rearm(odr_hz, period_ticks);
+        }
+        s_last_tick = s->tick;
+
+        uint32_t wi = s_wi;
+        if (!s_use_history) {
+            s_ring[s_wi][0] = s->raw_x;
+            s_ring[s_wi][1] = s->raw_y;
+            s_ring[s_wi][2] = s->raw_z;
+            if (++s_wi == s_cap) {
+                s_wi = 0;
+            }
+        }
+        s_filled++;
+
+        float g[3] = { s->raw_x * inv, s->raw_y * inv, s->raw_z * inv };
+        float value = 0.0f;
+        bool  fired = detect(g, &value);
+
+        switch (s_state) {
+            case EV_STATE_ARMING:
+                if (s_filled >= s_settle && (now_ms() - s_upload_done_ms) >= EVENT_HOLDOFF_MS) {
+                    s_state = EV_STATE_ARMED;
+                    ESP_LOGD(TAG, "Armed (%s)", event_capture_mode_str(s_mode));
+                }
+                break;
+
+            case EV_STATE_ARMED:
+                if (fired || s_manual_req) {
+                    s_trig_mode  = s_manual_req && !fired ? 0 : (uint8_t)s_mode;
+                    s_manual_req = false;
+                    s_trig_wi    = wi;
+                    s_trig_seq   = s_use_history ? raw_history_seq_of(in) + i : 0;
+                    s_trig_tick  = s->tick;
+                    s_trig_value = value;
+                    s_after_trig = 0;
+                    s_event_id++;
+                    s_events_triggered++;
+                    s_state = EV_STATE_CAPTURING;
+                    ESP_LOGI(TAG, "Event %lu triggered (value %.4f)",
+                             (unsigned long)s_event_id, value);
+                }
+                break;
+
+            case EV_STATE_CAPTURING:
+                if (++s_after_trig + 1 >= s_post) {
+                    /* Trigger sample + post - 1 after it: window complete */
+                    s_state = EV_STATE_UPLOADING;
+                    xTaskNotifyGive(s_task_handle);
+                    return;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+/******************************************************************************
+ * UPLOAD (event task)
+ *****************************************************************************/
+
+static uint8_t *put(uint8_t *p, const void *v, size_t n)
+{
+    memcpy(p, v, n);
+    return p + n;
+}
+
+/**
+ * @brief Pack count samples starting at event sample first into p.
+ * @return The advanced pointer, or NULL if the history already wrapped
+ *         over part of the window.
+ */
+static uint8_t *put_samples(uint8_t *p, uint32_t start, uint32_t first, uint32_t count)
+{
+    if (!s_use_history) {
+        /* Copy out of the ring, splitting at the wrap */
+        uint32_t idx = (start + first) % s_cap;
+        uint32_t run = s_cap - idx;
+        if (run > count) {
+            run = count;
+        }
+        p = put(p, s_ring[idx], (size_t)run * 12);
+        if (run < count) {
+            p = put(p, s_ring[0], (size_t)(count - run) * 12);
+        }
+        return p;
+    }
+
+    adxl355_raw_sample_t tmp[EVENT_HISTORY_COPY_SAMPLES];
+    uint32_t seq = s_trig_seq - s_pre + first;
+    while (count > 0) {
+        uint32_t n = (count < EVENT_HISTORY_COPY_SAMPLES) ? count : EVENT_HISTORY_COPY_SAMPLES;
+        if (raw_history_read_at(seq, tmp, n) != n) {
+            return NULL;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            const int32_t xyz[3] = { tmp[i].raw_x, tmp[i].raw_y, tmp[i].raw_z };
+            p = put(p, xyz, 12);
+        }
+        seq   += n;
+        count -= n;
+    }
+    return p;
+}
+
+static bool publish_chunk(const char *topic, size_t len)
+{
+    for (int attempt = 0; attempt < EVENT_CHUNK_RETRIES; attempt++) {
+        if (mqtt_publish(topic, (const char *)s_chunk_buf, (int)len) == ESP_OK) {
+            s_chunks_published++;
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(EVENT_RETRY_DELAY_MS));
+    }
+    return false;
+}
+
+static void upload_event(void)
+{
+    char topic[EVENT_TOPIC_BUF_SIZE];
+    snprintf(topic, sizeof(topic), "%s/%s/%s",
+             MQTT_TOPIC_PREFIX, mqtt_get_serial_no(), EVENT_TOPIC_SUFFIX);
+
+    ts_anchor_t anchor;
+    ts_anchor_capture(&anchor);
+
+    const uint32_t total  = s_pre + s_post;
+    const uint16_t chunks = (uint16_t)((total + EVENT_CHUNK_SAMPLES - 1) / EVENT_CHUNK_SAMPLES);
+    const uint32_t start  = s_use_history ? 0 : (s_trig_wi + s_cap - s_pre) % s_cap;
+
+    const int64_t  utc_us   = ts_anchor_tick_to_utc_us(&anchor, s_trig_tick);
+    const uint16_t odr      = (uint16_t)s_odr_hz;
+    const uint16_t period   = (uint16_t)s_period_ticks;
+    const uint8_t  range    = node_config_get()->range;
+    const uint16_t reserved = 0;
+
+    ESP_LOGI(TAG, "Uploading event %lu: %lu samples (%lu pre) in %u chunks",
+             (unsigned long)s_event_id, (unsigned long)total,
+             (unsigned long)s_pre, (unsigned)chunks);
+
+    for (uint16_t c = 0; c < chunks; c++) {
+        uint32_t first = (uint32_t)c * EVENT_CHUNK_SAMPLES;
+        uint16_t count = (uint16_t)((total - first) < EVENT_CHUNK_SAMPLES
+                                    ? (total - first) : EVENT_CHUNK_SAMPLES);
+
+        uint8_t *p = s_chunk_buf;
+        *p++ = EVENT_BIN_MAGIC;
+        *p++ = EVENT_BIN_VERSION;
+        *p++ = s_trig_mode;
+        *p++ = range;
+        p = put(p, &s_event_id,   4);
+        p = put(p, &c,            2);
+        p = put(p, &chunks,       2);
+        p = put(p, &s_trig_tick,  4);
+        p = put(p, &utc_us,       8);
+        p = put(p, &odr,          2);
+        p = put(p, &period,       2);
+        p = put(p, &s_pre,        4);
+        p = put(p, &total,        4);
+        p = put(p, &first,        4);
+        p = put(p, &count,        2);
+        p = put(p, &reserved,     2);
+        p = put(p, &s_trig_value, 4);
+
+        p = put_samples(p, start, first, count);
+        if (p == NULL) {
+            ESP_LOGW(TAG, "Event %lu overwritten in the raw history at chunk %u/%u",
+                     (unsigned long)s_event_id, (unsigned)c, (unsigned)chunks);
+            s_events_failed++;
+            return;
+        }
+
+        if (!publish_chunk(topic, (size_t)(p - s_chunk_buf))) {
+            ESP_LOGW(TAG, "Event %lu upload aborted at chunk %u/%u",
+                     (unsigned long)s_event_id, (unsigned)c, (unsigned)chunks);
+            s_events_failed++;
+            return;
+        }
+        vTaskDelay(pdMS_TO_TICKS(EVENT_CHUNK_INTERVAL_MS));
+    }
+
+    s_events_uploaded++;
+}
+
+static void event_task(void *pvParameters)
+{
+    (void)pvParameters;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        upload_event();
+
+        /* Hand the ring back: the data task re-arms on its next feed */
+        s_upload_done_ms = now_ms();
+        s_reset_req      = true;
+        s_state          = EV_STATE_ARMING;
+    }
+}
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+_Static_assert(EVENT_BIN_HEADER_LEN == 4 + 4 + 2 + 2 + 4 + 8 + 2 + 2 + 4 + 4 + 4 + 2 + 2 + 4,
+               "EVENT_BIN_HEADER_LEN must match the chunk header");
+
+esp_err_t event_capture_init(void)
+{
+    if (s_task_handle != NULL) {
+        s_reset_req = true;
+        return ESP_OK;
+    }
+
+    if (raw_history_enabled()) {
+        /* Half the history, so the window outlives a slow upload */
+        s_use_history = true;
+        s_cap   = raw_history_capacity() / 2u;
+        s_psram = true;
+    } else if ((s_ring = heap_caps_malloc(EVENT_HISTORY_SAMPLES * sizeof(s_ring[0]),
+                                          MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)) != NULL) {
+        s_cap   = EVENT_HISTORY_SAMPLES;
+        s_psram = true;
+    } else {
+        s_ring = heap_caps_malloc(EVENT_FALLBACK_SAMPLES * sizeof(s_ring[0]),
+                                  MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (s_ring == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate history ring");
+            return ESP_ERR_NO_MEM;
+        }
+        s_cap   = EVENT_FALLBACK_SAMPLES;
+        s_psram = false;
+        ESP_LOGW(TAG, "No PSRAM — history limited to %lu samples",
+                 (unsigned long)s_cap);
+    }
+
+    s_task_handle = mem_budget_task_create("event", &s_task_mem, event_task, "event_up",
+                                            NULL, EVENT_TASK_PRIORITY, EVENT_TASK_CORE);
+    if (s_task_handle == NULL) {
+        ESP_LOGE(TAG, "Failed to create task");
+        heap_caps_free(s_ring);
+        s_ring = NULL;
+        return ESP_FAIL;
+    }
+
+    if (s_ring != NULL) {
+        mem_budget_record("event", s_psram ? MEM_REGION_PSRAM : MEM_REGION_INTERNAL,
+                          s_cap * sizeof(s_ring[0]));
+    }
+    s_ready = true;
+    ESP_LOGI(TAG, "Event capture ready (%lu-sample %s, mode=%s)",
+             (unsigned long)s_cap,
+             s_use_history ? "raw history window" : s_psram ? "PSRAM ring" : "internal ring",
+             event_capture_mode_str(s_mode));
+    return ESP_OK;
+}
+
+esp_err_t event_capture_configure(event_trigger_mode_t mode, int32_t level)
+{
+    if (mode > EVENT_TRIGGER_STA_LTA) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (mode != EVENT_TRIGGER_OFF && level <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (mode != s_mode || level != s_level) {
+        ESP_LOGI(TAG, "Trigger -> %s level=%ld", event_capture_mode_str(mode), (long)level);
+    }
+    s_mode      = mode;
+    s_level     = level;
+    s_reset_req = true;
+    return ESP_OK;
+}
+
+event_trigger_mode_t event_capture_get_mode(void)
+{
+    return s_mode;
+}
+
+int32_t event_capture_get_level(void)
+{
+    return s_level;
+}
+
+const char *event_capture_mode_str(event_trigger_mode_t mode)
+{
+    switch (mode) {
+        case EVENT_TRIGGER_THRESHOLD: return "threshold";
+        case EVENT_TRIGGER_RMS:       return "rms";
+        case EVENT_TRIGGER_STA_LTA:   return "sta_lta";
+        default:                      return "off";
+    }
+}
+
+bool event_capture_active(void)
+{
+    return s_ready &&
+           (s_mode != EVENT_TRIGGER_OFF || s_manual_req || s_state == EV_STATE_CAPTURING);
+}
+
+esp_err_t event_capture_trigger_manual(void)
+{
+    if (!s_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_state == EV_STATE_CAPTURING || s_state == EV_STATE_UPLOADING) {
+        s_triggers_ignored++;
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_manual_req = true;
+    return ESP_OK;
+}
+
+void event_capture_reset(void)
+{
+    s_reset_req = true;
+}
+
+void event_capture_get_stats(event_capture_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    stats->events_triggered = s_events_triggered;
+    stats->events_uploaded  = s_events_uploaded;
+    stats->events_failed    = s_events_failed;
+    stats->chunks_published = s_chunks_published;
+    stats->triggers_ignored = s_triggers_ignored;
+    stats->history_samples  = s_cap;
+    stats->psram            = s_psram;
+}
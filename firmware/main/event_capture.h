@@ -0,0 +1,176 @@
+/**
+ * @file event_capture.h
+ * @brief Triggered raw-ODR burst capture with pre-trigger history.
+ *
+ * The regular data topic only carries the decimated 200 Hz stream. This
+ * module watches the raw ADXL355 stream (fed by the data task before
+ * decimation) and, when a trigger fires, uploads the full-rate window
+ * around it on wind_turbine/<SERIAL>/event:
+ *
+ *   |<-- EVENT_PRE_MS -->|<------ EVENT_POST_MS ------>|
+ *                        ^ trigger sample
+ *
+ * With the PSRAM raw history enabled (raw_history.h) the window is read
+ * straight out of it by sample sequence, and the module keeps no copy.
+ * Otherwise history lives in a ring of its own allocated from PSRAM
+ * (EVENT_HISTORY_SAMPLES), or without PSRAM a smaller internal-RAM ring
+ * and the window shrinks proportionally.
+ *
+ * Trigger modes (configure command "trigger" / "trigger_level"):
+ *   off        default, the data task skips the module entirely
+ *   threshold  |a - dc| > level mg on any single raw sample
+ *   rms        RMS of |a - dc| over EVENT_RMS_WINDOW_MS > level mg
+ *   sta_lta    STA / LTA of |a - dc|^2 > level / 10 (level 40 = ratio 4.0)
+ *
+ * The DC estimate and the averages are recursive (one-pole), so the
+ * detector costs a few float ops per raw sample and no extra memory.
+ *
+ * State machine
+ * =============
+ *   ARMING -> ARMED -> CAPTURING -> UPLOADING -> ARMING ...
+ *
+ * ARMING waits until the ring holds a full pre-trigger window and the
+ * detector has settled. CAPTURING keeps recording EVENT_POST_MS more.
+ * UPLOADING freezes the ring and hands it to a low-priority task on the network core,
+ * which publishes paced chunks between the normal 1 s packets; raw samples
+ * arriving meanwhile are not recorded.
+ *
+ * Chunk format, version 1 (little-endian, no padding):
+ *
+ *   off  size  field
+ *     0   u8   magic            EVENT_BIN_MAGIC
+ *     1   u8   version          EVENT_BIN_VERSION
+ *     2   u8   trigger_mode     event_trigger_mode_t (0 = manual)
+ *     3   u8   range            1=±2g, 2=±4g, 3=±8g (selects LSB/g)
+ *     4   u32  event_id         increments per event since boot
+ *     8   u16  chunk_index
+ *    10   u16  chunk_count
+ *    12   u32  trigger_tick     125 us acquisition tick of the trigger sample
+ *    16   i64  trigger_utc_us   UTC of trigger_tick, 0 = clock not synced
+ *    24   u16  odr_hz           raw ADXL355 ODR
+ *    26   u16  period_ticks     ticks between raw samples
+ *    28   u32  pre_samples      samples before the trigger sample
+ *    32   u32  total_samples    samples in the whole event
+ *    36   u32  first_sample     index of this chunk's first sample
+ *    40   u16  sample_count     samples in this chunk
+ *    42   u16  reserved         0
+ *    44   f32  trigger_value    detector value at the trigger (g or ratio)
+ *    48        sample_count x { i32 x, i32 y, i32 z }   raw 20-bit counts
+ *
+ * Sample i of the event was taken at trigger_tick + (i - pre_samples) *
+ * period_ticks.
+ */
+
+#ifndef EVENT_CAPTURE_H
+#define EVENT_CAPTURE_H
+
+#include "esp_err.h"
+#include "cpu_topology.h"
+#include "sensor_task.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * CONFIGURATION
+ *****************************************************************************/
+
+#define EVENT_PRE_MS                1000u
+#define EVENT_POST_MS               2000u
+
+/** PSRAM ring: (pre + post) at the 4 kHz ODR, 12 bytes per sample. */
+#define EVENT_HISTORY_SAMPLES       12000u
+/** Internal-RAM ring when no PSRAM is available (36 KB). */
+#define EVENT_FALLBACK_SAMPLES      3072u
+
+/** Stack buffer for copying out of the raw history (16 bytes per sample). */
+#define EVENT_HISTORY_COPY_SAMPLES  64u
+
+#define EVENT_RMS_WINDOW_MS         250u
+#define EVENT_STA_MS                250u
+#define EVENT_LTA_MS                10000u
+#define EVENT_DC_MS                 2000u   /**< DC tracker time constant */
+
+/** Minimum time between the end of one upload and the next trigger. */
+#define EVENT_HOLDOFF_MS            5000u
+
+#define EVENT_CHUNK_SAMPLES         256u    /**< 3120-byte messages */
+#define EVENT_CHUNK_INTERVAL_MS     20u     /**< ~150 KB/s upload pacing */
+#define EVENT_CHUNK_RETRIES         5
+
+#define EVENT_TOPIC_SUFFIX          "event"
+
+#define EVENT_BIN_MAGIC             0xB6
+#define EVENT_BIN_VERSION           1
+#define EVENT_BIN_HEADER_LEN        48
+
+#define EVENT_TASK_STACK_SIZE       4096
+#define EVENT_TASK_PRIORITY         2
+#define EVENT_TASK_CORE             SHM_CORE_NET
+
+typedef enum {
+    EVENT_TRIGGER_OFF       = 0,
+    EVENT_TRIGGER_THRESHOLD = 1,
+    EVENT_TRIGGER_RMS       = 2,
+    EVENT_TRIGGER_STA_LTA   = 3,
+} event_trigger_mode_t;
+
+typedef struct {
+    uint32_t events_triggered;
+    uint32_t events_uploaded;
+    uint32_t events_failed;      /**< Upload aborted (MQTT down too long) */
+    uint32_t chunks_published;
+    uint32_t triggers_ignored;   /**< Manual triggers while busy          */
+    uint32_t history_samples;    /**< Ring capacity (window limit)        */
+    bool     psram;              /**< Ring (or raw history) in PSRAM      */
+} event_capture_stats_t;
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/** @brief Allocate the history ring and start the upload task. */
+esp_err_t event_capture_init(void);
+
+/**
+ * @brief Select the trigger mode and level. Re-arms the detector.
+ * @param level  mg for threshold / rms, ratio x10 for sta_lta
+ * @return ESP_ERR_INVALID_ARG for a non-positive level with a mode set.
+ */
+esp_err_t event_capture_configure(event_trigger_mode_t mode, int32_t level);
+
+event_trigger_mode_t event_capture_get_mode(void);
+int32_t event_capture_get_level(void);
+
+/** @brief "off" / "threshold" / "rms" / "sta_lta" for status messages. */
+const char *event_capture_mode_str(event_trigger_mode_t mode);
+
+/** @brief True when the data task needs to call event_capture_feed(). */
+bool event_capture_active(void);
+
+/**
+ * @brief Run the detector over a span of raw samples (data task only).
+ *
+ * @param odr_hz        Current raw ODR
+ * @param period_ticks  Timer ticks between raw samples
+ * @param lsb_per_g     Current sensitivity
+ */
+void event_capture_feed(const adxl355_raw_sample_t *in, uint32_t n,
+                        uint32_t odr_hz, uint32_t period_ticks, float lsb_per_g);
+
+/** @brief Fire on the next sample regardless of the detector (control cmd). */
+esp_err_t event_capture_trigger_manual(void);
+
+/** @brief Abandon any capture in progress and re-arm (stream gap, reconfigure). */
+void event_capture_reset(void);
+
+void event_capture_get_stats(event_capture_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EVENT_CAPTURE_H
@@ -2,190 +2,390 @@
  * @file fault_log.c
  * @brief Fault logging system implementation
  *
- * Maintains a small fixed-size ring buffer of pending uint8_t fault codes.
+ * Producers (any task, any ISR, either core) push {code, timestamp} into a
+ * bounded lock-free MPSC queue. The dispatcher task is the only consumer: it
+ * merges events into a small table keyed by fault code and publishes the
+ * table as one JSON batch per coalescing window.
+ *
+ * Queue
+ * =====
+ * Bounded MPSC ring with a sequence word per slot (Vyukov). A producer
+ * claims position pos by compare-exchanging head, fills the slot, then
+ * release-stores the slot's sequence to mark it full; the consumer reads a
+ * slot only after acquiring that store. The sequence is stored relative to
+ * the slot index (seq - index) so the zero-initialised array is already the
+ * "all empty" state and fault_log_record() works before fault_log_init().
+ *
+ * Table
+ * =====
+ * Written by the dispatcher and by fault_log_append_to_json(), under
+ * s_table_lock. Publishing snapshots and clears it first, so the callback
+ * (which can block in mqtt_publish) runs without the lock.
+ *
  * No heap allocation. No strings stored on the ESP32 side — just integers.
  * The Raspberry Pi subscriber holds the lookup table for human-readable text.
  */
 
 #include "fault_log.h"
+#include "mem_budget.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "esp_attr.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdatomic.h>
 #include <sys/time.h>
 #include <string.h>
 #include <stdio.h>
 
 static const char *TAG = "FAULT_LOG";
 
+MEM_BUDGET_STATIC_TASK(s_task_mem, FAULT_LOG_TASK_STACK_SIZE);
+
+#define FAULT_LOG_QUEUE_MASK    (FAULT_LOG_QUEUE_SIZE - 1u)
+
+_Static_assert((FAULT_LOG_QUEUE_SIZE & FAULT_LOG_QUEUE_MASK) == 0,
+               "FAULT_LOG_QUEUE_SIZE must be a power of two");
+
 /******************************************************************************
  * INTERNAL STATE
  *****************************************************************************/
 
-static uint8_t           s_pending[FAULT_LOG_MAX_PENDING];
-static int               s_pending_count = 0;
-static SemaphoreHandle_t s_mutex = NULL;
-
-/* Registered callback for immediate per-fault MQTT publishing (may be NULL) */
-static fault_publish_cb_t s_publish_cb = NULL;
-
-/* Scratch buffers for per-fault JSON and topic — sized conservatively:
- *   topic: "wind_turbine/" (13) + serial (32) + "/faults" (7) + '\0' = 53 → 80
- *   json:  {"ts":"2025-01-15T12:34:56.000000Z","f":18} = ~50 chars → 96      */
-#define FAULT_JSON_BUF_SIZE    96
-#define FAULT_TOPIC_BUF_SIZE   80
+typedef struct {
+    atomic_uint seq;            /**< (sequence - slot index), see file header */
+    uint8_t     code;
+    int64_t     t_us;           /**< esp_timer time of the record() call      */
+} fault_slot_t;
+
+typedef struct {
+    uint8_t  code;
+    uint32_t count;
+    int64_t  first_us;
+    int64_t  last_us;
+} fault_entry_t;
+
+static fault_slot_t s_queue[FAULT_LOG_QUEUE_SIZE];
+static atomic_uint  s_head;                 /* producers (compare-exchange) */
+static uint32_t     s_tail;                 /* dispatcher only              */
+
+static atomic_uint  s_recorded;
+static atomic_uint  s_dropped;
+
+static portMUX_TYPE  s_table_lock = portMUX_INITIALIZER_UNLOCKED;
+static fault_entry_t s_pending[FAULT_LOG_MAX_PENDING];
+static int           s_pending_count = 0;
+
+/* Dispatcher only */
+static uint32_t s_lost_reported   = 0;
+static uint32_t s_coalesced       = 0;
+static uint32_t s_batches         = 0;
+static uint32_t s_queue_hw        = 0;
+
+static TaskHandle_t           s_task = NULL;
+static volatile bool          s_flush_requested = false;
+
+/* Registered callback for batch MQTT publishing (may be NULL) */
+static volatile fault_publish_cb_t s_publish_cb = NULL;
+
+/* Scratch buffers — sized conservatively:
+ *   ts:    "2025-01-15T12:34:56.000000Z" = 27 chars → 40
+ *   json:  ts + FAULT_LOG_BATCH_MAX x (code 4 + count 11 + dt 11) + lost → 640 */
+#define FAULT_JSON_BUF_SIZE    640
 #define FAULT_TS_BUF_SIZE      40
 
-/* Lazy-init the mutex on first use so no explicit init call is needed */
-static SemaphoreHandle_t get_mutex(void)
-{
-    if (s_mutex == NULL) {
-        s_mutex = xSemaphoreCreateMutex();
-    }
-    return s_mutex;
-}
-
 /******************************************************************************
  * INTERNAL HELPERS
  *****************************************************************************/
 
 /*
- * Format a UTC ISO-8601 timestamp into buf (>= FAULT_TS_BUF_SIZE bytes).
- * Uses gettimeofday() directly — we want the wall time of the fault event.
+ * Format the UTC ISO-8601 wall time of an event recorded at esp_timer time
+ * event_us into buf (>= FAULT_TS_BUF_SIZE bytes): gettimeofday() now, back-
+ * dated by the event's age.
  * Mirrors the 1700000000L validity threshold used in sntp_sync.c.
- * Falls back to "tick:NNNNNNNNNN" (µs from esp_timer_get_time) if SNTP
- * has not yet synced.
+ * Falls back to "tick:NNNNNNNNNN" (the event's µs tick) if SNTP has not
+ * yet synced.
  */
-static void fault_format_ts(char *buf, size_t buf_size)
+static void fault_format_ts(char *buf, size_t buf_size, int64_t event_us)
 {
     struct timeval tv;
     gettimeofday(&tv, NULL);
 
     if (tv.tv_sec > 1700000000L) {
+        int64_t wall_us = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec
+                        - (esp_timer_get_time() - event_us);
+        time_t  sec     = (time_t)(wall_us / 1000000);
+        long    usec    = (long)(wall_us % 1000000);
         struct tm tm_info;
-        gmtime_r(&tv.tv_sec, &tm_info);
+        gmtime_r(&sec, &tm_info);
         char date_buf[28];
         strftime(date_buf, sizeof(date_buf), "%Y-%m-%dT%H:%M:%S", &tm_info);
-        snprintf(buf, buf_size, "%s.%06ldZ", date_buf, (long)tv.tv_usec);
+        snprintf(buf, buf_size, "%s.%06ldZ", date_buf, usec);
     } else {
         /* SNTP not yet synced — µs tick gives a monotonic fallback reference */
-        snprintf(buf, buf_size, "tick:%08llu",
-                 (unsigned long long)(esp_timer_get_time()));
+        snprintf(buf, buf_size, "tick:%08llu", (unsigned long long)event_us);
     }
 }
 
-/******************************************************************************
- * PUBLIC FUNCTIONS
- *****************************************************************************/
+/** @brief Pop one event; false if the next slot is empty or still being filled. */
+static bool queue_pop(uint8_t *code, int64_t *t_us)
+{
+    fault_slot_t *slot = &s_queue[s_tail & FAULT_LOG_QUEUE_MASK];
+    uint32_t base = s_tail - (s_tail & FAULT_LOG_QUEUE_MASK);
+    uint32_t seq  = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (seq != base + 1u) {
+        return false;
+    }
+    *code = slot->code;
+    *t_us = slot->t_us;
+    /* Free the slot for the producer one lap ahead */
+    atomic_store_explicit(&slot->seq, base + FAULT_LOG_QUEUE_SIZE, memory_order_release);
+    s_tail++;
+    return true;
+}
 
-void fault_log_record(uint8_t fault_code)
+/** @brief Index of the entry with the oldest first occurrence. Lock held. */
+static int oldest_entry(void)
 {
-    SemaphoreHandle_t m = get_mutex();
-    if (m == NULL) {
-        return;
+    int oldest = 0;
+    for (int i = 1; i < s_pending_count; i++) {
+        if (s_pending[i].first_us < s_pending[oldest].first_us) {
+            oldest = i;
+        }
     }
+    return oldest;
+}
 
-    if (xSemaphoreTake(m, pdMS_TO_TICKS(10)) == pdTRUE) {
-        if (s_pending_count < FAULT_LOG_MAX_PENDING) {
-            s_pending[s_pending_count++] = fault_code;
-        } else {
-            /* Buffer full: shift oldest out, add newest at end */
-            memmove(&s_pending[0], &s_pending[1], FAULT_LOG_MAX_PENDING - 1);
-            s_pending[FAULT_LOG_MAX_PENDING - 1] = fault_code;
-            ESP_LOGW(TAG, "Fault buffer full — oldest fault overwritten");
+/**
+ * @brief Merge one event into the table.
+ * @return false if the table is full and the event was not merged.
+ */
+static bool table_add(uint8_t code, int64_t t_us, bool evict)
+{
+    bool merged = true;
+    bool repeat = false;
+
+    portENTER_CRITICAL(&s_table_lock);
+    int i;
+    for (i = 0; i < s_pending_count; i++) {
+        if (s_pending[i].code == code) {
+            break;
         }
-        ESP_LOGI(TAG, "Fault recorded: code=%d", fault_code);
-        xSemaphoreGive(m);
-    }
-
-    /* -------------------------------------------------------------------
-     * Immediately publish an individual fault packet via the registered
-     * callback, regardless of sensor state (idle or recording).
-     *
-     * Topic:  wind_turbine/<SERIAL>/faults
-     * Format: {"ts":"2025-01-15T12:34:56.000000Z","f":7}
-     *
-     * The callback is registered from main.c after mqtt_init() — this
-     * keeps fault_log independent of mqtt (no circular dependency).
-     * If the callback is NULL (MQTT not yet up) the fault is still safe
-     * in the pending buffer and will appear in the next data packet.
-     * ------------------------------------------------------------------- */
-    fault_publish_cb_t cb = s_publish_cb;   /* snapshot — avoids race on deinit */
-    if (cb != NULL) {
-        char ts_buf[FAULT_TS_BUF_SIZE];
-        char json_buf[FAULT_JSON_BUF_SIZE];
-
-        fault_format_ts(ts_buf, sizeof(ts_buf));
-
-        snprintf(json_buf, sizeof(json_buf),
-                 "{\"ts\":\"%s\",\"f\":%d}", ts_buf, fault_code);
-
-        cb(json_buf, (int)strlen(json_buf));
-
-        ESP_LOGI(TAG, "Fault dispatched immediately: payload=%s", json_buf);
+    }
+    if (i < s_pending_count) {
+        s_pending[i].count++;
+        if (t_us > s_pending[i].last_us) {
+            s_pending[i].last_us = t_us;
+        }
+        repeat = true;
+    } else if (s_pending_count < FAULT_LOG_MAX_PENDING || evict) {
+        if (s_pending_count == FAULT_LOG_MAX_PENDING) {
+            /* No publisher yet: make room by dropping the oldest entry */
+            int o = oldest_entry();
+            s_pending[o] = s_pending[--s_pending_count];
+        }
+        s_pending[s_pending_count++] = (fault_entry_t){
+            .code = code, .count = 1, .first_us = t_us, .last_us = t_us,
+        };
     } else {
-        ESP_LOGD(TAG, "No publish callback — fault %d in pending buffer only",
-                 fault_code);
+        merged = false;
     }
+    portEXIT_CRITICAL(&s_table_lock);
+
+    if (repeat) {
+        s_coalesced++;
+        ESP_LOGD(TAG, "Fault repeated: code=%d", code);
+    } else if (merged) {
+        ESP_LOGI(TAG, "Fault recorded: code=%d", code);
+    }
+    return merged;
 }
 
-void fault_log_set_publish_cb(fault_publish_cb_t cb)
+/** @brief esp_timer time of the oldest pending event, or -1 if none. */
+static int64_t table_oldest_us(void)
 {
-    s_publish_cb = cb;
-    ESP_LOGI(TAG, "Fault publish callback %s", cb ? "registered" : "cleared");
+    int64_t oldest = -1;
+    portENTER_CRITICAL(&s_table_lock);
+    if (s_pending_count > 0) {
+        oldest = s_pending[oldest_entry()].first_us;
+    }
+    portEXIT_CRITICAL(&s_table_lock);
+    return oldest;
 }
 
-void fault_log_flush_pending(void)
+/**
+ * @brief Publish up to FAULT_LOG_BATCH_MAX of the oldest entries as one message.
+ * @return Number of entries published (0 if nothing pending).
+ */
+static int publish_batch(fault_publish_cb_t cb)
 {
-    fault_publish_cb_t cb = s_publish_cb;
-    if (cb == NULL) {
-        return;
+    fault_entry_t batch[FAULT_LOG_BATCH_MAX];
+    int n = 0;
+
+    /* Take the oldest entries out in first-occurrence order */
+    portENTER_CRITICAL(&s_table_lock);
+    while (n < FAULT_LOG_BATCH_MAX && s_pending_count > 0) {
+        int o = oldest_entry();
+        batch[n++] = s_pending[o];
+        s_pending[o] = s_pending[--s_pending_count];
     }
+    portEXIT_CRITICAL(&s_table_lock);
 
-    SemaphoreHandle_t m = get_mutex();
-    if (m == NULL) return;
+    if (n == 0) {
+        return 0;
+    }
 
-    if (xSemaphoreTake(m, pdMS_TO_TICKS(10)) != pdTRUE) {
-        return;
+    static char json_buf[FAULT_JSON_BUF_SIZE];
+    char ts_buf[FAULT_TS_BUF_SIZE];
+    int64_t base_us = batch[0].first_us;
+    fault_format_ts(ts_buf, sizeof(ts_buf), base_us);
+
+    int off = snprintf(json_buf, sizeof(json_buf), "{\"ts\":\"%s\",\"f\":[", ts_buf);
+    for (int i = 0; i < n; i++) {
+        off += snprintf(json_buf + off, sizeof(json_buf) - off, "%s%d",
+                        i ? "," : "", batch[i].code);
+    }
+    off += snprintf(json_buf + off, sizeof(json_buf) - off, "],\"n\":[");
+    for (int i = 0; i < n; i++) {
+        off += snprintf(json_buf + off, sizeof(json_buf) - off, "%s%lu",
+                        i ? "," : "", (unsigned long)batch[i].count);
     }
+    off += snprintf(json_buf + off, sizeof(json_buf) - off, "],\"dt\":[");
+    for (int i = 0; i < n; i++) {
+        off += snprintf(json_buf + off, sizeof(json_buf) - off, "%s%lld",
+                        i ? "," : "", (long long)((batch[i].last_us - base_us) / 1000));
+    }
+    off += snprintf(json_buf + off, sizeof(json_buf) - off, "]");
 
-    int count = s_pending_count;
-    uint8_t snapshot[FAULT_LOG_MAX_PENDING];
-    memcpy(snapshot, s_pending, count);
-    s_pending_count = 0;   /* clear now so the buffer is free while we publish */
+    uint32_t dropped = atomic_load_explicit(&s_dropped, memory_order_relaxed);
+    if (dropped != s_lost_reported) {
+        off += snprintf(json_buf + off, sizeof(json_buf) - off, ",\"lost\":%lu",
+                        (unsigned long)(dropped - s_lost_reported));
+        s_lost_reported = dropped;
+    }
+    off += snprintf(json_buf + off, sizeof(json_buf) - off, "}");
 
-    xSemaphoreGive(m);
+    cb(json_buf, (int)strlen(json_buf));
+    s_batches++;
 
-    if (count == 0) {
-        return;
+    ESP_LOGI(TAG, "Fault batch dispatched: %d code(s) payload=%s", n, json_buf);
+    return n;
+}
+
+/******************************************************************************
+ * DISPATCHER TASK
+ *****************************************************************************/
+
+static void fault_log_task(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(FAULT_LOG_DISPATCH_POLL_MS));
+
+        fault_publish_cb_t cb = s_publish_cb;   /* snapshot — avoids race on deinit */
+
+        uint32_t depth = atomic_load_explicit(&s_head, memory_order_relaxed) - s_tail;
+        if (depth > s_queue_hw) {
+            s_queue_hw = depth;
+        }
+
+        uint8_t code;
+        int64_t t_us;
+        while (queue_pop(&code, &t_us)) {
+            /* Full table with a publisher: send early instead of evicting */
+            while (!table_add(code, t_us, cb == NULL)) {
+                publish_batch(cb);
+            }
+        }
+
+        if (cb == NULL) {
+            continue;
+        }
+
+        bool flush = s_flush_requested;
+        s_flush_requested = false;
+        int64_t oldest = table_oldest_us();
+        if (oldest < 0) {
+            continue;
+        }
+        if (flush ||
+            esp_timer_get_time() - oldest >= (int64_t)FAULT_LOG_COALESCE_MS * 1000) {
+            while (publish_batch(cb) > 0) {
+            }
+        }
     }
+}
 
-    ESP_LOGI(TAG, "Flushing %d buffered fault(s) accumulated before callback was ready", count);
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
 
-    char ts_buf[FAULT_TS_BUF_SIZE];
-    char json_buf[FAULT_JSON_BUF_SIZE];
+esp_err_t fault_log_init(void)
+{
+    if (s_task != NULL) {
+        return ESP_OK;
+    }
 
-    fault_format_ts(ts_buf, sizeof(ts_buf));  /* one shared timestamp for the flush batch */
+    s_task = mem_budget_task_create("fault_log", &s_task_mem, fault_log_task, "fault_log",
+                                     NULL, FAULT_LOG_TASK_PRIORITY, FAULT_LOG_TASK_CORE);
+    if (s_task == NULL) {
+        ESP_LOGE(TAG, "Failed to create fault dispatcher task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
 
-    for (int i = 0; i < count; i++) {
-        snprintf(json_buf, sizeof(json_buf),
-                 "{\"ts\":\"%s\",\"f\":%d}", ts_buf, snapshot[i]);
-        cb(json_buf, (int)strlen(json_buf));
-        ESP_LOGI(TAG, "Flushed buffered fault: code=%d payload=%s", snapshot[i], json_buf);
+void IRAM_ATTR fault_log_record(uint8_t fault_code)
+{
+    uint32_t pos = atomic_load_explicit(&s_head, memory_order_relaxed);
+    fault_slot_t *slot;
+
+    for (;;) {
+        slot = &s_queue[pos & FAULT_LOG_QUEUE_MASK];
+        uint32_t base = pos - (pos & FAULT_LOG_QUEUE_MASK);
+        int32_t  diff = (int32_t)(atomic_load_explicit(&slot->seq, memory_order_acquire) - base);
+        if (diff == 0) {
+            /* Slot free for this lap: claim it (a failed exchange reloads pos) */
+            if (atomic_compare_exchange_weak_explicit(&s_head, &pos, pos + 1u,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /* Not yet consumed from the previous lap: queue full */
+            atomic_fetch_add_explicit(&s_dropped, 1u, memory_order_relaxed);
+            return;
+        } else {
+            /* Another producer claimed pos; catch up */
+            pos = atomic_load_explicit(&s_head, memory_order_relaxed);
+        }
     }
+
+    slot->code = fault_code;
+    slot->t_us = esp_timer_get_time();
+    atomic_store_explicit(&slot->seq, pos - (pos & FAULT_LOG_QUEUE_MASK) + 1u,
+                          memory_order_release);
+    atomic_fetch_add_explicit(&s_recorded, 1u, memory_order_relaxed);
 }
 
-bool fault_log_has_pending(void)
+void fault_log_set_publish_cb(fault_publish_cb_t cb)
 {
-    SemaphoreHandle_t m = get_mutex();
-    if (m == NULL) return false;
+    s_publish_cb = cb;
+    ESP_LOGI(TAG, "Fault publish callback %s", cb ? "registered" : "cleared");
+}
 
-    bool has = false;
-    if (xSemaphoreTake(m, pdMS_TO_TICKS(10)) == pdTRUE) {
-        has = (s_pending_count > 0);
-        xSemaphoreGive(m);
+void fault_log_flush_pending(void)
+{
+    if (s_publish_cb == NULL || s_task == NULL) {
+        return;
     }
-    return has;
+    s_flush_requested = true;
+    xTaskNotifyGive(s_task);
+}
+
+bool fault_log_has_pending(void)
+{
+    return s_pending_count > 0;
 }
 
 int fault_log_append_to_json(char *buf, int buf_size, int offset)
@@ -194,26 +394,29 @@ int fault_log_append_to_json(char *buf, int buf_size, int offset)
         return offset;
     }
 
-    SemaphoreHandle_t m = get_mutex();
-    if (m == NULL) return offset;
+    uint8_t codes[FAULT_LOG_MAX_PENDING];
+    int count = 0;
 
-    if (xSemaphoreTake(m, pdMS_TO_TICKS(10)) != pdTRUE) {
-        return offset;
+    portENTER_CRITICAL(&s_table_lock);
+    for (int i = 0; i < s_pending_count; i++) {
+        codes[count++] = s_pending[i].code;
     }
+    /* Clear the pending list: these codes travel in the data packet instead */
+    s_pending_count = 0;
+    portEXIT_CRITICAL(&s_table_lock);
 
-    if (s_pending_count == 0) {
-        xSemaphoreGive(m);
+    if (count == 0) {
         return offset;
     }
 
     /* Write:  ,"f":[1,7,12]  */
     offset += snprintf(buf + offset, buf_size - offset, ",\"f\":[");
 
-    for (int i = 0; i < s_pending_count; i++) {
+    for (int i = 0; i < count; i++) {
         if (i > 0) {
             offset += snprintf(buf + offset, buf_size - offset, ",");
         }
-        offset += snprintf(buf + offset, buf_size - offset, "%d", s_pending[i]);
+        offset += snprintf(buf + offset, buf_size - offset, "%d", codes[i]);
 
         if (offset >= buf_size - 4) {
             /* Safety: stop writing if we're running out of room */
@@ -223,11 +426,19 @@ int fault_log_append_to_json(char *buf, int buf_size, int offset)
     }
 
     offset += snprintf(buf + offset, buf_size - offset, "]");
-
-    /* Clear the pending list now that they have been written into the packet */
-    s_pending_count = 0;
-
-
-    xSemaphoreGive(m);
     return offset;
 }
+
+void fault_log_get_stats(fault_log_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    stats->recorded         = atomic_load_explicit(&s_recorded, memory_order_relaxed);
+    stats->dropped          = atomic_load_explicit(&s_dropped, memory_order_relaxed);
+    stats->coalesced        = s_coalesced;
+    stats->batches          = s_batches;
+    stats->pending          = (uint32_t)s_pending_count;
+    stats->queue_high_water = s_queue_hw;
+}
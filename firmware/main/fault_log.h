@@ -30,11 +30,17 @@
  *   16 - ADT7420 init failed
  *   17 - SPI bus error (mid-run)
  *   18 - I2C bus error (mid-run)
+ *   26 - Publish level back to full rate        (flow_control.h)
+ *   27 - Publish level coarse (multi-second batching)
+ *   28 - Publish level summary (spectrum only, raw data to log)
+ *   29 - Publish level store (all data to store-and-forward log)
  */
 
 #ifndef FAULT_LOG_H
 #define FAULT_LOG_H
 
+#include "esp_err.h"
+#include "cpu_topology.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -69,64 +75,107 @@ extern "C" {
 #define FAULT_ADT7420_RECONNECTED   21
 #define FAULT_ADXL355_SELFTEST_FAIL 22
 #define FAULT_SCL3300_SELFTEST_FAIL 23
+#define FAULT_STORE_FORWARD_ERROR   24
+#define FAULT_STORE_FORWARD_FULL    25
+#define FAULT_FLOW_FULL             26   /**< + flow_level_t: 26..29 */
+#define FAULT_FLOW_COARSE           27
+#define FAULT_FLOW_SUMMARY          28
+#define FAULT_FLOW_STORE            29
 
 /******************************************************************************
  * CONFIGURATION
  *****************************************************************************/
 
-/* Maximum number of fault codes that can be pending at once.
- * If the buffer fills up, older faults are overwritten (newest wins). */
-#define FAULT_LOG_MAX_PENDING       16
+/* Lock-free event queue between fault_log_record() and the dispatcher.
+ * Power of two. A full queue drops the new event (counted in stats). */
+#define FAULT_LOG_QUEUE_SIZE        64
 
-/* Dedicated MQTT topic suffix for individual fault events.
+/* Distinct fault codes held by the dispatcher at once. Repeats of a held
+ * code only bump its count; a new code with the table full forces an early
+ * batch (or, before the publish callback exists, evicts the oldest entry). */
+#define FAULT_LOG_MAX_PENDING       32
+
+/* A batch is published once its oldest event is this old, so a storm of
+ * repeats costs at most one message per window. */
+#define FAULT_LOG_COALESCE_MS       1000
+
+/* How often the dispatcher drains the queue */
+#define FAULT_LOG_DISPATCH_POLL_MS  100
+
+/* Entries per published message; a larger table goes out as several */
+#define FAULT_LOG_BATCH_MAX         16
+
+#define FAULT_LOG_TASK_STACK_SIZE   4096
+#define FAULT_LOG_TASK_PRIORITY     2
+#define FAULT_LOG_TASK_CORE         SHM_CORE_NET
+
+/* Dedicated MQTT topic suffix for fault batches.
  * Full topic:  wind_turbine/<SERIAL>/faults
  * Subscribe to wind_turbine/+/faults to receive faults from all nodes.
  * Each message is a self-contained JSON object:
- *   {"ts":"2025-01-15T12:34:56.000000Z","f":7}
+ *   {"ts":"2025-01-15T12:34:56.000000Z","f":[7,17],"n":[42,1],"dt":[980,310]}
+ * "ts" is the wall time of the oldest event in the batch. For each code in
+ * "f", "n" is how many times it was recorded in the window and "dt" is the
+ * ms from "ts" to its LAST occurrence, so a down/up/down sequence of a
+ * stateful pair still resolves to the final state. "lost":N is added when
+ * the queue overflowed since the previous batch.
  * "ts" falls back to "tick:NNNNNNNNNN" (µs) before SNTP has synced. */
 #define FAULT_LOG_TOPIC_SUFFIX      "faults"
 
+typedef struct {
+    uint32_t recorded;          /**< fault_log_record() calls accepted      */
+    uint32_t dropped;           /**< Rejected because the queue was full    */
+    uint32_t coalesced;         /**< Events merged into an existing entry   */
+    uint32_t batches;           /**< Messages handed to the publish callback */
+    uint32_t pending;           /**< Entries waiting in the dispatcher      */
+    uint32_t queue_high_water;  /**< Max queue depth seen by the dispatcher */
+} fault_log_stats_t;
+
 /******************************************************************************
  * PUBLIC API
  *****************************************************************************/
 
 /**
- * @brief Record a fault code into the pending buffer.
+ * @brief Start the dispatcher task. Call once, early in app_main().
  *
- * Thread-safe. Can be called from any task context.
- * Do NOT call from an ISR — use the processing task to detect and log
- * faults that originate in the ISR (e.g. sample overflows).
+ * Faults recorded before this call wait in the queue.
+ */
+esp_err_t fault_log_init(void);
+
+/**
+ * @brief Record a fault code.
  *
- * If a publish callback has been registered via fault_log_set_publish_cb(),
- * each fault is also immediately dispatched as an individual MQTT packet on
- * wind_turbine/<SERIAL>/faults, regardless of sensor state (idle or recording).
- * The timestamp uses SNTP-derived UTC when available, falling back to a
- * microsecond tick string before the first SNTP sync.
+ * Lock-free and ISR-safe (IRAM): claims a queue slot with one
+ * compare-exchange, stores the code and an esp_timer timestamp, and returns.
+ * No logging, formatting or publishing happens in the caller's context; the
+ * dispatcher task coalesces repeats and publishes batches on
+ * wind_turbine/<SERIAL>/faults once a callback is registered via
+ * fault_log_set_publish_cb(), regardless of sensor state (idle or recording).
  *
  * @param fault_code  One of the FAULT_* defines above.
  */
 void fault_log_record(uint8_t fault_code);
 
 /**
- * @brief Callback type for immediate per-fault MQTT publishing.
+ * @brief Callback type for fault batch publishing.
  *
- * Called by fault_log_record() with the fully-formed JSON payload.
+ * Called from the dispatcher task with the fully-formed JSON batch.
  * The implementor (in main.c) is responsible for constructing the full
  * topic string using mqtt_get_serial_no() and FAULT_LOG_TOPIC_SUFFIX,
  * then forwarding to mqtt_publish(). This keeps fault_log free of any
  * dependency on mqtt.
  *
- * @param payload  Null-terminated JSON, e.g. {"ts":"2025-01-15T12:34:56.000000Z","f":7}
+ * @param payload  Null-terminated JSON batch (format above)
  * @param len      Length of payload in bytes (excluding null terminator).
  */
 typedef void (*fault_publish_cb_t)(const char *payload, int len);
 
 /**
- * @brief Register the callback used to immediately publish individual faults.
+ * @brief Register the callback used to publish fault batches.
  *
- * Call this from main.c after mqtt_init() succeeds. Until it is called,
- * fault_log_record() still records faults into the pending buffer — they
- * will be included in the next data packet — but no immediate publish occurs.
+ * Call this from main.c after mqtt_init() succeeds. Until it is called the
+ * dispatcher keeps coalescing faults into its pending table but publishes
+ * nothing.
  *
  * Pass NULL to unregister (e.g. before mqtt_deinit()).
  *
@@ -135,16 +184,15 @@ typedef void (*fault_publish_cb_t)(const char *payload, int len);
 void fault_log_set_publish_cb(fault_publish_cb_t cb);
 
 /**
- * @brief Immediately publish all faults currently sitting in the pending buffer.
+ * @brief Ask the dispatcher to publish everything it holds now.
  *
  * Call this once from main.c immediately after fault_log_set_publish_cb(),
- * to flush any faults that were recorded before the callback was registered
- * (e.g. boot-time reset causes, sensor init failures). Each buffered fault
- * is dispatched as an individual MQTT packet via the registered callback and
- * then removed from the pending buffer.
+ * to flush the faults recorded before the callback was registered (e.g.
+ * boot-time reset causes, sensor init failures) without waiting for the
+ * coalescing window. Returns at once; the publish happens on the
+ * dispatcher task.
  *
- * Has no effect if no callback is registered or the buffer is empty.
- * Thread-safe.
+ * Has no effect if no callback is registered or nothing is pending.
  */
 void fault_log_flush_pending(void);
 
@@ -160,7 +208,8 @@ bool fault_log_has_pending(void);
  * buffer offset. Clears the pending list after writing.
  *
  * Call this inside mqtt_publish_sensor_data() just before closing the
- * JSON object, only when fault_log_has_pending() returns true.
+ * JSON object, only when fault_log_has_pending() returns true. Codes taken
+ * here are not published again by the dispatcher.
  *
  * @param buf       Destination character buffer (the JSON being built).
  * @param buf_size  Total size of buf in bytes.
@@ -169,6 +218,8 @@ bool fault_log_has_pending(void);
  */
 int fault_log_append_to_json(char *buf, int buf_size, int offset);
 
+void fault_log_get_stats(fault_log_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
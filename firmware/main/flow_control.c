@@ -0,0 +1,199 @@
+/**
+ * @file flow_control.c
+ * @brief Backpressure-driven publish levels (see flow_control.h).
+ */
+
+#include "flow_control.h"
+#include "publish_pipeline.h"
+#include "mqtt.h"
+#include "fault_log.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "FLOW";
+
+static volatile flow_level_t s_level   = FLOW_LEVEL_FULL;
+static volatile bool         s_auto    = true;
+static volatile uint32_t     s_transitions = 0;
+
+static volatile uint32_t     s_batch_packets = 1;
+static volatile uint32_t     s_batch_max_ms  = 0;
+
+/* Publish stage only */
+static uint32_t s_latency_ema_us  = 0;
+static uint32_t s_publishes       = 0;     /**< Since the last evaluation */
+static int32_t  s_outbox_bytes    = 0;
+static uint32_t s_congested_evals = 0;
+static uint32_t s_clear_evals     = 0;
+static uint32_t s_slot_full_last  = 0;
+static uint32_t s_last_eval_ms    = 0;
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void restart_measurement(void)
+{
+    s_latency_ema_us  = 0;
+    s_publishes       = 0;
+    s_congested_evals = 0;
+    s_clear_evals     = 0;
+}
+
+static void set_level(flow_level_t level, const char *why)
+{
+    if (level == s_level) {
+        return;
+    }
+    ESP_LOGW(TAG, "Publish level %s -> %s (%s, outbox=%ld B, latency=%lu us)",
+             flow_control_level_str(s_level), flow_control_level_str(level), why,
+             (long)s_outbox_bytes, (unsigned long)s_latency_ema_us);
+    s_level = level;
+    s_transitions++;
+    restart_measurement();
+    fault_log_record((uint8_t)(FAULT_FLOW_FULL + level));
+}
+
+flow_level_t flow_control_get_level(void)
+{
+    return s_level;
+}
+
+const char *flow_control_level_str(flow_level_t level)
+{
+    switch (level) {
+        case FLOW_LEVEL_FULL:    return "full";
+        case FLOW_LEVEL_COARSE:  return "coarse";
+        case FLOW_LEVEL_SUMMARY: return "summary";
+        case FLOW_LEVEL_STORE:   return "store";
+        default:                 return "unknown";
+    }
+}
+
+void flow_control_set_auto(bool enabled)
+{
+    if (enabled == s_auto) {
+        return;
+    }
+    s_auto = enabled;
+    ESP_LOGI(TAG, "Automatic flow control %s", enabled ? "enabled" : "disabled");
+    if (!enabled) {
+        /* The level is otherwise only written by the publish stage; a racing
+         * evaluation sees s_auto false and leaves it alone. */
+        set_level(FLOW_LEVEL_FULL, "disabled");
+    }
+}
+
+bool flow_control_get_auto(void)
+{
+    return s_auto;
+}
+
+esp_err_t flow_control_set_batch(uint32_t packets, uint32_t max_ms)
+{
+    if (packets < 1 || packets > FLOW_BATCH_MAX_PACKETS || max_ms > FLOW_BATCH_MAX_HOLD_MS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (packets != s_batch_packets || max_ms != s_batch_max_ms) {
+        s_batch_packets = packets;
+        s_batch_max_ms  = max_ms;
+        ESP_LOGI(TAG, "Batching: %lu packet(s) per message, hold <= %lu ms",
+                 (unsigned long)packets, (unsigned long)flow_control_batch_hold_ms());
+    }
+    return ESP_OK;
+}
+
+uint32_t flow_control_get_batch(void)
+{
+    return s_batch_packets;
+}
+
+uint32_t flow_control_get_batch_max_ms(void)
+{
+    return s_batch_max_ms;
+}
+
+uint32_t flow_control_batch_packets(void)
+{
+    uint32_t packets = s_batch_packets;
+    if (s_level == FLOW_LEVEL_COARSE && packets < FLOW_COARSE_PACKETS) {
+        packets = FLOW_COARSE_PACKETS;
+    }
+    return packets;
+}
+
+uint32_t flow_control_batch_hold_ms(void)
+{
+    uint32_t max_ms = s_batch_max_ms;
+    return max_ms ? max_ms : (flow_control_batch_packets() + 1u) * 1000u;
+}
+
+void flow_control_note_publish(uint32_t us)
+{
+    if (s_publishes == 0 && s_latency_ema_us == 0) {
+        s_latency_ema_us = us;
+    } else {
+        /* One-pole, alpha = 1/4: a few slow sends in a row are needed */
+        int32_t diff = (int32_t)us - (int32_t)s_latency_ema_us;
+        s_latency_ema_us = (uint32_t)((int32_t)s_latency_ema_us + diff / 4);
+    }
+    s_publishes++;
+}
+
+void flow_control_update(void)
+{
+    uint32_t now = now_ms();
+    if ((now - s_last_eval_ms) < FLOW_EVAL_INTERVAL_MS) {
+        return;
+    }
+    s_last_eval_ms = now;
+
+    publish_pipeline_stats_t pipe;
+    publish_pipeline_get_stats(&pipe);
+    uint32_t new_drops = pipe.slot_full_drops - s_slot_full_last;
+    s_slot_full_last   = pipe.slot_full_drops;
+
+    if (!s_auto || !mqtt_is_connected()) {
+        restart_measurement();
+        return;
+    }
+
+    s_outbox_bytes = mqtt_get_outbox_size();
+
+    /* No data publish this interval (summary / store): judge by the outbox
+     * alone, which is what lets a quiet link step back up. */
+    bool measured  = (s_publishes > 0);
+    bool congested = s_outbox_bytes > FLOW_OUTBOX_HIGH_BYTES || new_drops > 0 ||
+                     (measured && s_latency_ema_us > FLOW_LATENCY_HIGH_US);
+    bool clear     = s_outbox_bytes <= FLOW_OUTBOX_LOW_BYTES && new_drops == 0 &&
+                     (!measured || s_latency_ema_us < FLOW_LATENCY_LOW_US);
+    s_publishes = 0;
+
+    if (congested) {
+        s_clear_evals = 0;
+        if (++s_congested_evals >= FLOW_DEGRADE_EVALS && s_level < FLOW_LEVEL_STORE) {
+            set_level((flow_level_t)(s_level + 1), "congested");
+        }
+    } else if (clear) {
+        s_congested_evals = 0;
+        if (++s_clear_evals >= FLOW_RECOVER_EVALS && s_level > FLOW_LEVEL_FULL) {
+            set_level((flow_level_t)(s_level - 1), "recovered");
+        }
+    } else {
+        /* Between the thresholds: hold the level */
+        s_congested_evals = 0;
+        s_clear_evals     = 0;
+    }
+}
+
+void flow_control_get_stats(flow_control_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    stats->level          = s_level;
+    stats->transitions    = s_transitions;
+    stats->latency_ema_us = s_latency_ema_us;
+    stats->outbox_bytes   = s_outbox_bytes;
+}
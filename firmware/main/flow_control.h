@@ -0,0 +1,144 @@
+/**
+ * @file flow_control.h
+ * @brief Backpressure-driven publish levels for congested site networks.
+ *
+ * The publish stage (publish_pipeline.h) feeds this module the time each
+ * esp_mqtt_client_publish() call blocked, and once per FLOW_EVAL_INTERVAL_MS
+ * it compares that, the esp-mqtt outbox size and new pipeline slot-full
+ * drops against the thresholds below. The result is one of four levels:
+ *
+ *   full     live packets in the configured format, backlog replay allowed
+ *   coarse   binary frames, at least FLOW_COARSE_PACKETS seconds per message
+ *   summary  raw packets go to the store-and-forward log (dropped without
+ *            the partition); only the spectrum summary stays live
+ *   store    everything goes to the log, nothing but status/faults is sent
+ *
+ * The level moves one step down after FLOW_DEGRADE_EVALS congested
+ * evaluations in a row and one step up after FLOW_RECOVER_EVALS clear ones,
+ * so a recovering link is probed one level at a time. Every transition is
+ * recorded as fault FAULT_FLOW_FULL + level so operators see it on the
+ * faults topic; counters restart after each transition.
+ *
+ * While MQTT is disconnected the level is frozen: the offline path
+ * (store_forward.h) already handles that case.
+ *
+ * Batching: independently of the level, a node can be told to pack 1..
+ * FLOW_BATCH_MAX_PACKETS one-second packets into each MQTT message
+ * (configure "batch_s"), which cuts the per-message TCP and broker work on
+ * a Pi serving many nodes. Batched messages are binary frames back to back
+ * whatever the configured format ("bin" or "packed" frames, "bin" when JSON
+ * is selected); the Pi splits them (binary_payload.split_binary_frames).
+ * A batch is sent when it holds its packets or when its oldest frame is
+ * "batch_max_ms" old, whichever comes first; 0 means one second more than
+ * the batch length, so a stalled packet stream never holds data for long.
+ * The coarse level uses the larger of batch_s and FLOW_COARSE_PACKETS.
+ *
+ * Threading: flow_control_note_publish() and flow_control_update() are
+ * only called from the publish stage task; every other caller just reads
+ * the current level.
+ */
+
+#ifndef FLOW_CONTROL_H
+#define FLOW_CONTROL_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * CONFIGURATION
+ *****************************************************************************/
+
+#define FLOW_EVAL_INTERVAL_MS       1000
+
+/** Bytes queued in the esp-mqtt outbox (client buffer.out_size is 8192). */
+#define FLOW_OUTBOX_HIGH_BYTES      16384
+#define FLOW_OUTBOX_LOW_BYTES       2048
+
+/** Smoothed blocking time of one data publish. A healthy 1 s JSON packet takes ~5 ms. */
+#define FLOW_LATENCY_HIGH_US        250000
+#define FLOW_LATENCY_LOW_US         50000
+
+#define FLOW_DEGRADE_EVALS          3       /**< ~3 s of congestion per step down */
+#define FLOW_RECOVER_EVALS          30      /**< ~30 s of clear link per step up  */
+
+/** 1 s binary frames coalesced into one message at the coarse level. */
+#define FLOW_COARSE_PACKETS         5
+
+/** Configured batching (configure "batch_s" / "batch_max_ms"). */
+#define FLOW_BATCH_MAX_PACKETS      10
+#define FLOW_BATCH_MAX_HOLD_MS      60000
+
+typedef enum {
+    FLOW_LEVEL_FULL    = 0,
+    FLOW_LEVEL_COARSE  = 1,
+    FLOW_LEVEL_SUMMARY = 2,
+    FLOW_LEVEL_STORE   = 3,
+} flow_level_t;
+
+typedef struct {
+    flow_level_t level;
+    uint32_t     transitions;
+    uint32_t     latency_ema_us;
+    int32_t      outbox_bytes;      /**< At the last evaluation */
+} flow_control_stats_t;
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/** @brief Current level; always FLOW_LEVEL_FULL while automatic control is off. */
+flow_level_t flow_control_get_level(void);
+
+/** @brief "full" / "coarse" / "summary" / "store". */
+const char *flow_control_level_str(flow_level_t level);
+
+/**
+ * @brief Enable or disable automatic level changes (configure "flow").
+ *
+ * Disabling returns to FLOW_LEVEL_FULL immediately.
+ */
+void flow_control_set_auto(bool enabled);
+
+bool flow_control_get_auto(void);
+
+/**
+ * @brief Set the packets per message and the hold bound (configure "batch_s",
+ *        "batch_max_ms").
+ *
+ * @param packets 1 (one message per packet) .. FLOW_BATCH_MAX_PACKETS
+ * @param max_ms  Oldest-frame age that forces a send, 0 = packets + 1 s,
+ *                at most FLOW_BATCH_MAX_HOLD_MS
+ * @return ESP_ERR_INVALID_ARG when out of range (nothing changes)
+ */
+esp_err_t flow_control_set_batch(uint32_t packets, uint32_t max_ms);
+
+/** @brief Configured packets per message. */
+uint32_t flow_control_get_batch(void);
+
+/** @brief Configured hold bound in ms, 0 = automatic. */
+uint32_t flow_control_get_batch_max_ms(void);
+
+/** @brief Packets per message right now: batch_s, raised at the coarse level. */
+uint32_t flow_control_batch_packets(void);
+
+/** @brief Longest a batch may hold its oldest frame right now, in ms. */
+uint32_t flow_control_batch_hold_ms(void);
+
+/** @brief Record how long one data publish call blocked (publish stage only). */
+void flow_control_note_publish(uint32_t us);
+
+/** @brief Re-evaluate the level when due (publish stage only, any rate). */
+void flow_control_update(void);
+
+void flow_control_get_stats(flow_control_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLOW_CONTROL_H
@@ -0,0 +1,175 @@
+/**
+ * @file json_writer.c
+ * @brief Integer fixed-point JSON number formatting and serializer benchmark.
+ */
+
+#include "json_writer.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *TAG = "JSON_WR";
+
+/******************************************************************************
+ * FIXED-POINT FORMATTER
+ *****************************************************************************/
+
+void jw_put_fixed(json_writer_t *w, int32_t scaled, unsigned decimals)
+{
+    /* Magnitude as unsigned so INT32_MIN is representable */
+    uint32_t mag = (scaled < 0) ? (uint32_t)0 - (uint32_t)scaled : (uint32_t)scaled;
+    if (scaled < 0) {
+        jw_putc(w, '-');
+    }
+
+    /* Digits are produced least-significant first into a small scratch
+     * buffer, then copied forward. Fraction digits are zero-padded. */
+    char tmp[12];
+    int  n = 0;
+    for (unsigned i = 0; i < decimals; i++) {
+        tmp[n++] = (char)('0' + mag % 10u);
+        mag /= 10u;
+    }
+    do {
+        tmp[n++] = (char)('0' + mag % 10u);
+        mag /= 10u;
+    } while (mag != 0u);
+
+    char *out = w->buf + w->len;
+    int   pos = 0;
+    for (int i = n - 1; i >= 0; i--) {
+        out[pos++] = tmp[i];
+        if (i == (int)decimals && decimals > 0) {
+            out[pos++] = '.';
+        }
+    }
+    w->len += (size_t)pos;
+}
+
+void jw_put_u64(json_writer_t *w, uint64_t value)
+{
+    char tmp[20];
+    int  n = 0;
+    do {
+        tmp[n++] = (char)('0' + value % 10u);
+        value /= 10u;
+    } while (value != 0u);
+
+    char *out = w->buf + w->len;
+    for (int i = n - 1; i >= 0; i--) {
+        *out++ = tmp[i];
+    }
+    w->len += (size_t)n;
+}
+
+/******************************************************************************
+ * BENCHMARK
+ *****************************************************************************/
+
+#define BENCH_SAMPLES      200
+#define BENCH_ITERATIONS   25
+#define BENCH_BUF_SIZE     20480
+#define BENCH_LSB_PER_G    256000
+
+static const char s_bench_ts[] = "2025-01-15T12:34:56.123456Z";
+
+/* Previous implementation: one snprintf("%.4f") per axis, bounds test after every record */
+static size_t bench_snprintf(char *buf, const int32_t (*raw)[3])
+{
+    int offset = 0;
+    offset += snprintf(buf + offset, BENCH_BUF_SIZE - offset, "{\"a\":[");
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        if (i > 0) {
+            offset += snprintf(buf + offset, BENCH_BUF_SIZE - offset, ",");
+        }
+        offset += snprintf(buf + offset, BENCH_BUF_SIZE - offset,
+                           "[\"%s\",%.4f,%.4f,%.4f]", s_bench_ts,
+                           (float)raw[i][0] / (float)BENCH_LSB_PER_G,
+                           (float)raw[i][1] / (float)BENCH_LSB_PER_G,
+                           (float)raw[i][2] / (float)BENCH_LSB_PER_G);
+        if (offset >= BENCH_BUF_SIZE - 200) {
+            break;
+        }
+    }
+    offset += snprintf(buf + offset, BENCH_BUF_SIZE - offset, "]}");
+    return (size_t)offset;
+}
+
+static size_t bench_writer(char *buf, const int32_t (*raw)[3])
+{
+    json_writer_t w;
+    jw_init(&w, buf, BENCH_BUF_SIZE);
+    if (!jw_reserve(&w, 8)) {
+        return 0;
+    }
+    jw_put_lit(&w, "{\"a\":[");
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        if (!jw_reserve(&w, JW_SAMPLE_MAX_LEN)) {
+            break;
+        }
+        if (i > 0) {
+            jw_putc(&w, ',');
+        }
+        jw_put_lit(&w, "[\"");
+        jw_put_raw(&w, s_bench_ts, sizeof(s_bench_ts) - 1);
+        jw_putc(&w, '"');
+        for (int k = 0; k < 3; k++) {
+            jw_putc(&w, ',');
+            jw_put_fixed(&w, jw_div_round((int64_t)raw[i][k] * 10000, BENCH_LSB_PER_G), 4);
+        }
+        jw_putc(&w, ']');
+    }
+    if (jw_reserve(&w, 2)) {
+        jw_put_lit(&w, "]}");
+    }
+    return w.len;
+}
+
+void json_writer_benchmark(void)
+{
+    char    *buf = malloc(BENCH_BUF_SIZE);
+    int32_t (*raw)[3] = malloc(sizeof(int32_t[BENCH_SAMPLES][3]));
+    if (buf == NULL || raw == NULL) {
+        ESP_LOGE(TAG, "Benchmark: out of memory");
+        free(buf);
+        free(raw);
+        return;
+    }
+
+    /* Deterministic spread over roughly +/-2 g */
+    uint32_t seed = 0x12345678u;
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        for (int k = 0; k < 3; k++) {
+            seed = seed * 1664525u + 1013904223u;
+            raw[i][k] = (int32_t)(seed >> 12) - (1 << 19);
+        }
+    }
+
+    size_t  bytes_old = 0, bytes_new = 0;
+    int64_t t0 = esp_timer_get_time();
+    for (int it = 0; it < BENCH_ITERATIONS; it++) {
+        bytes_old += bench_snprintf(buf, raw);
+    }
+    int64_t t1 = esp_timer_get_time();
+    for (int it = 0; it < BENCH_ITERATIONS; it++) {
+        bytes_new += bench_writer(buf, raw);
+    }
+    int64_t t2 = esp_timer_get_time();
+
+    int64_t us_old = (t1 - t0) > 0 ? (t1 - t0) : 1;
+    int64_t us_new = (t2 - t1) > 0 ? (t2 - t1) : 1;
+
+    ESP_LOGI(TAG, "Benchmark: %d x %d-sample accel arrays", BENCH_ITERATIONS, BENCH_SAMPLES);
+    ESP_LOGI(TAG, "  snprintf:    %7lld us  %8lld bytes/s  (%u bytes/packet)",
+             (long long)us_old, (long long)bytes_old * 1000000LL / us_old,
+             (unsigned)(bytes_old / BENCH_ITERATIONS));
+    ESP_LOGI(TAG, "  json_writer: %7lld us  %8lld bytes/s  (%u bytes/packet)",
+             (long long)us_new, (long long)bytes_new * 1000000LL / us_new,
+             (unsigned)(bytes_new / BENCH_ITERATIONS));
+    ESP_LOGI(TAG, "  speed-up:    %lld.%02lldx",
+             (long long)(us_old / us_new), (long long)((us_old * 100 / us_new) % 100));
+
+    free(raw);
+    free(buf);
+}
@@ -0,0 +1,113 @@
+/**
+ * @file json_writer.h
+ * @brief Bounds-checked-once JSON text writer with integer fixed-point output.
+ *
+ * Used by mqtt.c to build the sensor data JSON document. Numbers are written
+ * from fixed-point integers (value x 10^decimals) by a hand-written
+ * integer-to-ASCII routine, so the newlib float printf path is never entered.
+ *
+ * Bounds model: the caller reserves the worst-case size of one record with
+ * jw_reserve() and then uses the unchecked jw_put_*() calls for that record.
+ * The put calls do not look at the bounds, so every reservation's result
+ * must be checked before writing: a failed one latches overflow (every
+ * later reservation fails too) but does not stop the writes.
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Set to 1 to run json_writer_benchmark() once at boot. It prints the
+ * serializer throughput against the snprintf("%.4f") implementation it
+ * replaced. Leave at 0 for deployment.
+ */
+#define JSON_WRITER_RUN_BENCHMARK   0
+
+/** Worst case of one ["ts",x,y,z] record: 40-byte ts + 3 x 12-char numbers + framing. */
+#define JW_SAMPLE_MAX_LEN           96
+
+typedef struct {
+    char   *buf;
+    size_t  cap;
+    size_t  len;
+    bool    overflow;     /**< Latched by the first failed jw_reserve() */
+} json_writer_t;
+
+static inline void jw_init(json_writer_t *w, char *buf, size_t cap)
+{
+    w->buf      = buf;
+    w->cap      = cap;
+    w->len      = 0;
+    w->overflow = false;
+}
+
+/** @brief Reserve n bytes for the next record. False (and latched) if it will not fit. */
+static inline bool jw_reserve(json_writer_t *w, size_t n)
+{
+    if (w->overflow || (w->cap - w->len) < n) {
+        w->overflow = true;
+        return false;
+    }
+    return true;
+}
+
+static inline void jw_putc(json_writer_t *w, char c)
+{
+    w->buf[w->len++] = c;
+}
+
+static inline void jw_put_raw(json_writer_t *w, const char *s, size_t n)
+{
+    memcpy(w->buf + w->len, s, n);
+    w->len += n;
+}
+
+/** @brief Append a string literal without strlen() at runtime. */
+#define jw_put_lit(w, lit)  jw_put_raw((w), (lit), sizeof(lit) - 1)
+
+/** @brief Append a NUL-terminated string as a quoted JSON string (no escaping). */
+static inline void jw_put_qstr(json_writer_t *w, const char *s)
+{
+    jw_putc(w, '"');
+    jw_put_raw(w, s, strlen(s));
+    jw_putc(w, '"');
+}
+
+/**
+ * @brief Append a fixed-point number.
+ * @param scaled    value x 10^decimals, e.g. 12345 with decimals=4 -> "1.2345"
+ * @param decimals  0..9 fractional digits
+ */
+void jw_put_fixed(json_writer_t *w, int32_t scaled, unsigned decimals);
+
+/** @brief Append an unsigned integer of up to 20 digits (counters, UTC microseconds). */
+void jw_put_u64(json_writer_t *w, uint64_t value);
+
+/** @brief Integer division rounding half away from zero (printf differs only on exact ties). */
+static inline int32_t jw_div_round(int64_t num, int64_t den)
+{
+    return (int32_t)((num >= 0) ? (num + den / 2) / den : (num - den / 2) / den);
+}
+
+/**
+ * @brief Serializer throughput benchmark (on-target).
+ *
+ * Builds a 200-sample accel array repeatedly with the old snprintf path and
+ * with jw_put_fixed(), then logs bytes/second and the speed-up for each.
+ */
+void json_writer_benchmark(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JSON_WRITER_H */
@@ -26,6 +26,7 @@
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_heap_caps.h"
 #include "esp_idf_version.h"
 
 #include "driver/gpio.h"
@@ -36,6 +37,8 @@
 
 // Sensors
 #include "adt7420.h"
+#include "slow_sensors.h"
+#include "sensor_recovery.h"
 #include "adxl355.h"
 #include "scl3300.h"
 #include "sensor_task.h"
@@ -44,18 +47,34 @@
 #include "ethernet.h"
 #include "mqtt.h"
 #include "data_processing_and_mqtt_task.h"
+#include "publish_pipeline.h"
+#include "store_forward.h"
+#include "spectrum.h"
+#include "event_capture.h"
+#include "raw_history.h"
+#include "timing_hist.h"
+#include "metrics.h"
+#include "flow_control.h"
+#include "json_writer.h"
+#include "bench.h"
 
 // Node state machine + runtime configuration
 #include "node_config.h"
 #include "fault_log.h"
 #include "sntp_sync.h"
+#include "sync_start.h"
+#include "boot_seq.h"
+#include "cpu_topology.h"
+#include "mem_budget.h"
+#include "udp_stream.h"
 
 /******************************************************************************
  * FAULT PUBLISH CALLBACK
  * Registered with fault_log_set_publish_cb() after mqtt_init() succeeds.
  * Builds the full topic from the node serial and the FAULT_LOG_TOPIC_SUFFIX
  * defined in fault_log.h, then forwards to mqtt_publish().
- * Called from fault_log_record() on every fault, regardless of sensor state.
+ * Called from the fault dispatcher task once per coalesced batch,
+ * regardless of sensor state.
  ******************************************************************************/
 static void on_fault_publish(const char *payload, int len)
 {
@@ -69,13 +88,14 @@ static void on_fault_publish(const char *payload, int len)
              FAULT_LOG_TOPIC_SUFFIX);
     esp_err_t ret = mqtt_publish(topic, payload, len);
     if (ret != ESP_OK) {
-        ESP_LOGW("MAIN", "Immediate fault publish failed -- fault retained in pending buffer");
+        ESP_LOGW("MAIN", "Fault batch publish failed");
     }
 }
 
 static const char *TAG = "main";
 
 static volatile bool s_mqtt_started = false;  /* written from event task, read from app_main -- must be volatile */
+static bool s_last_selftest_ok = false;       /* reported by live reconfigurations, which skip it */
 
 /**
  * @brief Called by ethernet.c every time an IP address is obtained.
@@ -92,6 +112,9 @@ static void on_ethernet_got_ip(esp_netif_t *netif)
 {
     ESP_LOGI(TAG, "IP obtained -- checking MQTT/SNTP state");
 
+    /* A multicast socket bound to the old address would send nothing */
+    udp_stream_note_netif_changed();
+
     if (!s_mqtt_started) {
         ESP_LOGI(TAG, "MQTT not yet started -- initialising now");
 
@@ -121,6 +144,7 @@ static void on_ethernet_got_ip(esp_netif_t *netif)
 // Timeouts
 #define ETH_IP_TIMEOUT_MS       30000
 #define MQTT_CONNECT_TIMEOUT_MS 30000
+#define BOOT_MQTT_CONNECT_WAIT_MS 10000   /* boot waits this long for the broker */
 
 // Reboot configuration
 #define REBOOT_DELAY_MS         5000
@@ -135,6 +159,8 @@ static void on_ethernet_got_ip(esp_netif_t *netif)
 #define STATS_TASK_STACK_SIZE   4096
 #define STATS_INTERVAL_MS       10000
 
+MEM_BUDGET_STATIC_TASK(s_stats_task_mem, STATS_TASK_STACK_SIZE);
+
 // RTC memory survives reboots (not power cycles)
 RTC_NOINIT_ATTR static uint32_t s_reboot_count;
 RTC_NOINIT_ATTR static uint32_t s_reboot_magic;
@@ -233,6 +259,9 @@ static void stats_monitor_task(void *pvParameters)
 
     esp_netif_ip_info_t ip_info;
 
+    cpu_load_sampler_t cpu_load = {0};
+    uint16_t load_x10[portNUM_PROCESSORS];
+
     for (;;) {
         vTaskDelay(pdMS_TO_TICKS(STATS_INTERVAL_MS));
 
@@ -248,32 +277,152 @@ static void stats_monitor_task(void *pvParameters)
         ESP_LOGI("STATS", "============ System Statistics ============");
 
         ESP_LOGI("STATS", "--- Node State ---");
+        ESP_LOGI("STATS", "  Boot:  phases done at %lu ms, first packet at %lu ms",
+                 (unsigned long)boot_seq_total_ms(), (unsigned long)boot_seq_first_packet_ms());
         ESP_LOGI("STATS", "  State: %s", node_state_str(node_config_get_state()));
         const node_runtime_config_t *cfg = node_config_get();
         ESP_LOGI("STATS", "  ODR:   %lu Hz", (unsigned long)cfg->odr_hz);
         ESP_LOGI("STATS", "  Range: +/-%dg", (cfg->range == 1) ? 2 : (cfg->range == 2) ? 4 : 8);
         ESP_LOGI("STATS", "  Decim: %lu  Batch: %lu",
                  (unsigned long)cfg->decim_factor, (unsigned long)cfg->batch_size);
+        cpu_topology_sample_load(&cpu_load, load_x10);
+        ESP_LOGI("STATS", "  CPU:   acq core %d %u.%u%%  net core %d %u.%u%%",
+                 SHM_CORE_ACQ, load_x10[SHM_CORE_ACQ] / 10u, load_x10[SHM_CORE_ACQ] % 10u,
+                 SHM_CORE_NET, load_x10[SHM_CORE_NET] / 10u, load_x10[SHM_CORE_NET] % 10u);
 
         ESP_LOGI("STATS", "--- ISR Acquisition ---");
         ESP_LOGI("STATS", "  ADXL355 samples:  %lu", (unsigned long)adxl355_get_sample_count());
         ESP_LOGI("STATS", "  ADXL355 overflow: %lu", (unsigned long)adxl355_get_overflow_count());
+        ESP_LOGI("STATS", "  ADXL355 headroom: %lu ms (every %lu ticks)",
+                 (unsigned long)adxl355_buffer_capacity_ms(),
+                 (unsigned long)adxl355_get_tick_divisor());
+        uint32_t fifo_bursts, fifo_resyncs, fifo_full;
+        adxl355_get_fifo_diag(&fifo_bursts, &fifo_resyncs, &fifo_full);
+        ESP_LOGI("STATS", "  ADXL355 FIFO:     bursts=%lu resync=%lu full=%lu",
+                 (unsigned long)fifo_bursts, (unsigned long)fifo_resyncs, (unsigned long)fifo_full);
         ESP_LOGI("STATS", "  SCL3300 samples:  %lu", (unsigned long)scl3300_get_sample_count());
         ESP_LOGI("STATS", "  SCL3300 overflow: %lu", (unsigned long)scl3300_get_overflow_count());
         ESP_LOGI("STATS", "  ADT7420 samples:  %lu", (unsigned long)adt7420_get_sample_count());
+        slow_sensors_stats_t slow;
+        slow_sensors_get_stats(&slow);
+        ESP_LOGI("STATS", "  ADT7420 reads:    ok=%lu err=%lu ring_full=%lu (%s)",
+                 (unsigned long)slow.adt7420_reads, (unsigned long)slow.adt7420_read_errors,
+                 (unsigned long)slow.adt7420_ring_full, slow.adt7420_online ? "online" : "offline");
+        sensor_recovery_stats_t recov;
+        sensor_recovery_get_stats(&recov);
+        ESP_LOGI("STATS", "  SPI recovery:     adxl tries=%lu ok=%lu%s  scl tries=%lu ok=%lu%s",
+                 (unsigned long)recov.attempts[SENSOR_RECOVERY_ADXL355],
+                 (unsigned long)recov.reinits[SENSOR_RECOVERY_ADXL355],
+                 recov.lost[SENSOR_RECOVERY_ADXL355] ? " (lost)" : "",
+                 (unsigned long)recov.attempts[SENSOR_RECOVERY_SCL3300],
+                 (unsigned long)recov.reinits[SENSOR_RECOVERY_SCL3300],
+                 recov.lost[SENSOR_RECOVERY_SCL3300] ? " (lost)" : "");
+        ESP_LOGI("STATS", "  SPI clock:        adxl %lu Hz  scl %lu Hz  fallbacks=%lu/%lu crc_err=%lu",
+                 (unsigned long)spi_bus_get_clock_hz(SPI_BUS_DEV_ADXL355),
+                 (unsigned long)spi_bus_get_clock_hz(SPI_BUS_DEV_SCL3300),
+                 (unsigned long)recov.clock_fallbacks[SENSOR_RECOVERY_ADXL355],
+                 (unsigned long)recov.clock_fallbacks[SENSOR_RECOVERY_SCL3300],
+                 (unsigned long)scl3300_get_crc_errors());
+        sensor_health_stats_t adxl_health, scl_health;
+        sensor_health_get_stats(SENSOR_HEALTH_ADXL355, &adxl_health);
+        sensor_health_get_stats(SENSOR_HEALTH_SCL3300, &scl_health);
+        ESP_LOGI("STATS", "  SPI health:       adxl %s down=%lu probes=%lu skip=%lu  scl %s down=%lu probes=%lu skip=%lu",
+                 adxl_health.down ? "DOWN" : "up", (unsigned long)adxl_health.downs,
+                 (unsigned long)adxl_health.probes, (unsigned long)adxl_health.skipped,
+                 scl_health.down ? "DOWN" : "up", (unsigned long)scl_health.downs,
+                 (unsigned long)scl_health.probes, (unsigned long)scl_health.skipped);
+        udp_stream_stats_t ustats;
+        udp_stream_get_stats(&ustats);
+        if (ustats.enabled) {
+            ESP_LOGI("STATS", "  UDP stream:       %s port=%u frames=%lu dgrams=%lu errors=%lu",
+                     ustats.open ? "open" : "closed", (unsigned)ustats.port,
+                     (unsigned long)ustats.frames_sent, (unsigned long)ustats.datagrams_sent,
+                     (unsigned long)ustats.send_errors);
+            if (ustats.raw) {
+                ESP_LOGI("STATS", "  UDP raw stream:   frames=%lu dropped=%lu samples",
+                         (unsigned long)ustats.raw_frames_sent,
+                         (unsigned long)ustats.raw_samples_dropped);
+            }
+        }
+        fault_log_stats_t fstats;
+        fault_log_get_stats(&fstats);
+        ESP_LOGI("STATS", "  Faults:           rec=%lu merged=%lu batches=%lu pending=%lu lost=%lu q_hw=%lu/%d",
+                 (unsigned long)fstats.recorded, (unsigned long)fstats.coalesced,
+                 (unsigned long)fstats.batches, (unsigned long)fstats.pending,
+                 (unsigned long)fstats.dropped, (unsigned long)fstats.queue_high_water,
+                 FAULT_LOG_QUEUE_SIZE);
+        uint32_t hw_adxl, hw_scl, hw_adt;
+        sensor_acquisition_get_ring_high_water(&hw_adxl, &hw_scl, &hw_adt);
+        ESP_LOGI("STATS", "  Ring high-water:  adxl=%lu scl=%lu adt=%lu",
+                 (unsigned long)hw_adxl, (unsigned long)hw_scl, (unsigned long)hw_adt);
+        ESP_LOGI("STATS", "  Data wakeups:     %lu", (unsigned long)sensor_data_get_wakeups());
         ESP_LOGI("STATS", "  Total acquired:   %lu", (unsigned long)acquired);
         ESP_LOGI("STATS", "  Total dropped:    %lu", (unsigned long)dropped);
 
+        sensor_acq_timing_t timing;
+        sensor_acquisition_get_timing(&timing);
+        ESP_LOGI("STATS", "  ISR time:         max=%lu us avg=%lu ns (n=%lu)",
+                 (unsigned long)timing.isr_max_us, (unsigned long)timing.isr_avg_ns,
+                 (unsigned long)timing.isr_count);
+        if (sensor_acquisition_get_mode() == SENSOR_ACQ_MODE_TASK) {
+            ESP_LOGI("STATS", "  Task wake:        max=%lu us avg=%lu us  service max=%lu us  overruns=%lu",
+                     (unsigned long)timing.task_wake_max_us, (unsigned long)timing.task_wake_avg_us,
+                     (unsigned long)timing.task_service_max_us, (unsigned long)timing.task_slot_overruns);
+        }
+
         ESP_LOGI("STATS", "--- Ring Buffers ---");
         ESP_LOGI("STATS", "  ADXL355 pending:  %lu", (unsigned long)adxl355_samples_available());
         ESP_LOGI("STATS", "  SCL3300 pending:  %lu", (unsigned long)scl3300_samples_available());
         ESP_LOGI("STATS", "  ADT7420 pending:  %lu", (unsigned long)adt7420_samples_available());
+        raw_history_stats_t hist;
+        raw_history_get_stats(&hist);
+        if (hist.enabled) {
+            ESP_LOGI("STATS", "  Raw history:      %lu/%lu hw=%lu full=%lu holds=%lu drain max=%lu us",
+                     (unsigned long)hist.unread, (unsigned long)hist.capacity,
+                     (unsigned long)hist.high_water, (unsigned long)hist.full_passes,
+                     (unsigned long)hist.holds, (unsigned long)hist.max_drain_us);
+        }
 
         ESP_LOGI("STATS", "--- MQTT Publishing ---");
         ESP_LOGI("STATS", "  Samples published: %lu", (unsigned long)samples_published);
         ESP_LOGI("STATS", "  Packets sent:      %lu", (unsigned long)packets_sent);
         ESP_LOGI("STATS", "  Samples dropped:   %lu", (unsigned long)samples_dropped);
 
+        publish_pipeline_stats_t pipe;
+        publish_pipeline_get_stats(&pipe);
+        ESP_LOGI("STATS", "  Pipeline drops:    slot-full=%lu failed=%lu",
+                 (unsigned long)pipe.slot_full_drops, (unsigned long)pipe.packets_failed);
+        store_forward_stats_t sf;
+        store_forward_get_stats(&sf);
+        if (sf.enabled) {
+            ESP_LOGI("STATS", "  Store-and-forward: pending=%lu/%lu stored=%lu replayed=%lu overwritten=%lu errors=%lu",
+                     (unsigned long)sf.pending, (unsigned long)sf.capacity,
+                     (unsigned long)sf.stored, (unsigned long)sf.replayed,
+                     (unsigned long)sf.overwritten, (unsigned long)sf.errors);
+        }
+        flow_control_stats_t flow;
+        flow_control_get_stats(&flow);
+        ESP_LOGI("STATS", "  Flow control:      level=%s%s transitions=%lu outbox=%ld B latency=%lu us",
+                 flow_control_level_str(flow.level), flow_control_get_auto() ? "" : " (auto off)",
+                 (unsigned long)flow.transitions, (long)flow.outbox_bytes,
+                 (unsigned long)flow.latency_ema_us);
+        event_capture_stats_t ev;
+        event_capture_get_stats(&ev);
+        if (ev.history_samples > 0) {
+            ESP_LOGI("STATS", "  Event capture:     mode=%s triggered=%lu uploaded=%lu failed=%lu chunks=%lu (%lu-sample %s ring)",
+                     event_capture_mode_str(event_capture_get_mode()),
+                     (unsigned long)ev.events_triggered, (unsigned long)ev.events_uploaded,
+                     (unsigned long)ev.events_failed, (unsigned long)ev.chunks_published,
+                     (unsigned long)ev.history_samples, ev.psram ? "PSRAM" : "internal");
+        }
+        ESP_LOGI("STATS", "  Stage latency (avg/max us): build=%lu/%lu queue=%lu/%lu "
+                 "serialize=%lu/%lu publish=%lu/%lu e2e=%lu/%lu",
+                 (unsigned long)pipe.build.avg_us,      (unsigned long)pipe.build.max_us,
+                 (unsigned long)pipe.queue.avg_us,      (unsigned long)pipe.queue.max_us,
+                 (unsigned long)pipe.serialize.avg_us,  (unsigned long)pipe.serialize.max_us,
+                 (unsigned long)pipe.publish.avg_us,    (unsigned long)pipe.publish.max_us,
+                 (unsigned long)pipe.end_to_end.avg_us, (unsigned long)pipe.end_to_end.max_us);
+
         ESP_LOGI("STATS", "--- Network ---");
         if (ethernet_is_connected()) {
             ethernet_get_ip_info(&ip_info);
@@ -289,7 +438,10 @@ static void stats_monitor_task(void *pvParameters)
         }
 
         ESP_LOGI("STATS", "--- System ---");
-        ESP_LOGI("STATS", "  Free heap: %lu bytes", (unsigned long)esp_get_free_heap_size());
+        ESP_LOGI("STATS", "  Free heap: %lu bytes (internal largest block %lu, min %lu)",
+                 (unsigned long)esp_get_free_heap_size(),
+                 (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT),
+                 (unsigned long)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
         ESP_LOGI("STATS", "  Tick count: %lu", (unsigned long)get_tick_count());
         ESP_LOGI("STATS", "=============================================");
         ESP_LOGI("STATS", "");
@@ -319,6 +471,7 @@ static void print_banner(void)
     ESP_LOGI(TAG, "  - Data processing task batches & publishes");
     ESP_LOGI(TAG, "  - MQTT to Raspberry Pi");
     ESP_LOGI(TAG, "");
+    cpu_topology_log();
 }
 
 static esp_err_t init_buses(void)
@@ -449,7 +602,7 @@ static esp_err_t init_sensors(bool *temp_available)
     /*
      * Important CS logic:
      * - ADXL355 uses automatic CS in its SPI device config
-     * - SCL3300 uses manual CS
+     * - SCL3300 uses automatic CS too when SCL3300_HW_CS, manual otherwise
      * - Only do an early safety deselect of both lines here
      * - Do NOT keep manually toggling ADXL355 CS after init
      */
@@ -494,9 +647,13 @@ static esp_err_t init_sensors(bool *temp_available)
     ESP_LOGI(TAG, "POST: ADXL355 accelerometer...");
     ret = adxl355_init();
     if (ret == ESP_OK) {
+        /* Fastest reliable SPI clock, before anything streams from it */
+        spi_bus_tune_clock(SPI_BUS_DEV_ADXL355, adxl355_set_spi_clock, adxl355_probe_link);
+
         /* Self-test via existing node_config mechanism (default ODR=1kHz, +/-2g) */
         adxl355_selftest_result_t st;
         esp_err_t st_err = node_config_run_selftest(&st);
+        s_last_selftest_ok = (st_err == ESP_OK && st.passed);
         if (st_err == ESP_OK && st.passed) {
             post_adxl355_ok = true;
             ESP_LOGI(TAG, "POST: ADXL355 PASS  (delta_X=%.3fg delta_Y=%.3fg delta_Z=%.3fg)",
@@ -522,6 +679,8 @@ static esp_err_t init_sensors(bool *temp_available)
     ESP_LOGI(TAG, "POST: SCL3300 inclinometer...");
     ret = scl3300_init();
     if (ret == ESP_OK) {
+        spi_bus_tune_clock(SPI_BUS_DEV_SCL3300, scl3300_set_spi_clock, scl3300_probe_link);
+
         /* Self-test: read STO register and verify RS bits are normal */
         bool scl_st_passed = false;
         esp_err_t st_err = scl3300_selftest(&scl_st_passed);
@@ -611,6 +770,20 @@ static int32_t json_get_int(const char *json, const char *key, int32_t default_v
     return (int32_t)val;
 }
 
+static int64_t json_get_int64(const char *json, const char *key, int64_t default_val)
+{
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *p = strstr(json, pattern);
+    if (!p) return default_val;
+    p += strlen(pattern);
+    while (*p == ' ' || *p == '\t') p++;
+    char *end = NULL;
+    long long val = strtoll(p, &end, 10);
+    if (end == p) return default_val;
+    return (int64_t)val;
+}
+
 static bool json_str_equals(const char *json, const char *key, const char *expected)
 {
     char pattern[64];
@@ -638,13 +811,28 @@ static void publish_node_status(uint32_t seq_ack, bool selftest_ok,
     );
 }
 
+/** @brief Completion of a scheduled start_at, reported like a plain start. */
+static void on_sync_start_done(uint32_t seq, bool ok, const char *error_msg)
+{
+    publish_node_status(seq, ok, "start", error_msg);
+}
+
 static void on_mqtt_cmd(const char *topic, const char *payload)
 {
     ESP_LOGI("CMD", "Received on [%s]: %s", topic, payload);
+
+    /* The network lane can connect before acquisition is set up */
+    if (!boot_seq_finished(BOOT_PHASE_DATA_TASK)) {
+        publish_node_status((uint32_t)json_get_int(payload, "seq", 0), false, NULL,
+                            "node still booting, retry");
+        return;
+    }
     node_state_t state = node_config_get_state();
 
     /* ---- configure ---- */
     if (strstr(topic, "/cmd/configure")) {
+        /* New settings void any scheduled start; the Pi re-arms after configuring */
+        sync_start_cancel();
         if (state == NODE_STATE_ERROR) {
             publish_node_status(0, false, NULL, "node in error state, send reset first");
             return;
@@ -668,20 +856,170 @@ static void on_mqtt_cmd(const char *topic, const char *payload)
             return;
         }
 
-        adxl355_selftest_result_t st_result;
-        esp_err_t err = node_config_apply(
-            (uint8_t)odr_index, (uint8_t)range,
-            (uint8_t)hpf_corner, (uint32_t)seq,
-            &st_result
-        );
+        /* Optional "format":"json"|"bin"|"packed" selects the data payload
+         * encoding. Absent key keeps the current format. */
+        mqtt_payload_format_t format = mqtt_get_payload_format();
+        if (strstr(payload, "\"format\":")) {
+            if (json_str_equals(payload, "format", "bin")) {
+                format = MQTT_PAYLOAD_BINARY;
+            } else if (json_str_equals(payload, "format", "packed")) {
+                format = MQTT_PAYLOAD_PACKED;
+            } else if (json_str_equals(payload, "format", "json")) {
+                format = MQTT_PAYLOAD_JSON;
+            } else {
+                publish_node_status((uint32_t)seq, false, NULL, "invalid format");
+                return;
+            }
+        }
+
+        /* Optional "spectrum":"off"|"on"|"only" (spectrum.h). Absent key
+         * keeps the current mode. */
+        spectrum_mode_t spectrum_mode = spectrum_get_mode();
+        if (strstr(payload, "\"spectrum\":")) {
+            if (json_str_equals(payload, "spectrum", "off")) {
+                spectrum_mode = SPECTRUM_MODE_OFF;
+            } else if (json_str_equals(payload, "spectrum", "on")) {
+                spectrum_mode = SPECTRUM_MODE_ON;
+            } else if (json_str_equals(payload, "spectrum", "only")) {
+                spectrum_mode = SPECTRUM_MODE_ONLY;
+            } else {
+                publish_node_status((uint32_t)seq, false, NULL, "invalid spectrum");
+                return;
+            }
+        }
+
+        /* Optional burst trigger (event_capture.h): "trigger" selects the
+         * mode, "trigger_level" is mg (threshold / rms) or ratio x10
+         * (sta_lta). Absent keys keep the current setting. */
+        event_trigger_mode_t trig_mode = event_capture_get_mode();
+        if (strstr(payload, "\"trigger\":")) {
+            if (json_str_equals(payload, "trigger", "off")) {
+                trig_mode = EVENT_TRIGGER_OFF;
+            } else if (json_str_equals(payload, "trigger", "threshold")) {
+                trig_mode = EVENT_TRIGGER_THRESHOLD;
+            } else if (json_str_equals(payload, "trigger", "rms")) {
+                trig_mode = EVENT_TRIGGER_RMS;
+            } else if (json_str_equals(payload, "trigger", "sta_lta")) {
+                trig_mode = EVENT_TRIGGER_STA_LTA;
+            } else {
+                publish_node_status((uint32_t)seq, false, NULL, "invalid trigger");
+                return;
+            }
+        }
+        int32_t trig_level = json_get_int(payload, "trigger_level", event_capture_get_level());
+        if (trig_mode != EVENT_TRIGGER_OFF && trig_level <= 0) {
+            publish_node_status((uint32_t)seq, false, NULL, "invalid trigger_level");
+            return;
+        }
+
+        /* Optional "metrics_s" sets the metrics topic interval (metrics.h),
+         * 0 stops it. Absent key keeps the current interval. */
+        int32_t metrics_s = json_get_int(payload, "metrics_s", (int32_t)metrics_get_interval_s());
+        if (metrics_s < 0 || metrics_s > METRICS_MAX_INTERVAL_S) {
+            publish_node_status((uint32_t)seq, false, NULL, "invalid metrics_s");
+            return;
+        }
+
+        /* Optional "flow":"auto"|"off" (flow_control.h). Absent key keeps
+         * the current setting. */
+        bool flow_auto = flow_control_get_auto();
+        if (strstr(payload, "\"flow\":")) {
+            if (json_str_equals(payload, "flow", "auto")) {
+                flow_auto = true;
+            } else if (json_str_equals(payload, "flow", "off")) {
+                flow_auto = false;
+            } else {
+                publish_node_status((uint32_t)seq, false, NULL, "invalid flow");
+                return;
+            }
+        }
+
+        /* Optional "batch_s" packs that many 1 s packets into each MQTT
+         * message, "batch_max_ms" bounds how long a batch holds its oldest
+         * frame (flow_control.h). Absent keys keep the current batching. */
+        int32_t batch_s      = json_get_int(payload, "batch_s", (int32_t)flow_control_get_batch());
+        int32_t batch_max_ms = json_get_int(payload, "batch_max_ms",
+                                            (int32_t)flow_control_get_batch_max_ms());
+        if (batch_s < 1 || batch_s > FLOW_BATCH_MAX_PACKETS) {
+            publish_node_status((uint32_t)seq, false, NULL, "invalid batch_s");
+            return;
+        }
+        if (batch_max_ms < 0 || batch_max_ms > FLOW_BATCH_MAX_HOLD_MS) {
+            publish_node_status((uint32_t)seq, false, NULL, "invalid batch_max_ms");
+            return;
+        }
+
+        /* Optional "transport":"mqtt"|"udp"|"udp_raw" routes data frames to
+         * MQTT or to the multicast stream (udp_stream.h), "udp_raw" adding
+         * the undecimated ODR stream, with "udp_port" picking the
+         * destination port. Absent keys keep the current transport. */
+        bool udp_on  = udp_stream_is_enabled();
+        bool udp_raw = udp_stream_raw_enabled();
+        if (strstr(payload, "\"transport\":")) {
+            if (json_str_equals(payload, "transport", "udp")) {
+                udp_on  = true;
+                udp_raw = false;
+            } else if (json_str_equals(payload, "transport", "udp_raw")) {
+                if (!udp_stream_raw_available()) {
+                    publish_node_status((uint32_t)seq, false, NULL, "raw stream unavailable");
+                    return;
+                }
+                udp_on  = true;
+                udp_raw = true;
+            } else if (json_str_equals(payload, "transport", "mqtt")) {
+                udp_on  = false;
+                udp_raw = false;
+            } else {
+                publish_node_status((uint32_t)seq, false, NULL, "invalid transport");
+                return;
+            }
+        }
+        int32_t udp_port = json_get_int(payload, "udp_port", 0);
+        if (udp_port < 0 || udp_port > 65535) {
+            publish_node_status((uint32_t)seq, false, NULL, "invalid udp_port");
+            return;
+        }
+
+        /* Range / HPF changes while recording are applied live, without a
+         * data gap (node_config.h). An ODR change, or "selftest":true, takes
+         * the stop-reprogram-restart path; the live path reports the last
+         * self-test result. */
+        bool live = (state == NODE_STATE_RECORDING) &&
+                    ((uint8_t)odr_index == node_config_get()->odr_index) &&
+                    !strstr(payload, "\"selftest\":true");
+
+        adxl355_selftest_result_t st_result = { .passed = s_last_selftest_ok };
+        esp_err_t err;
+        if (live) {
+            err = node_config_apply_live((uint8_t)range, (uint8_t)hpf_corner, (uint32_t)seq);
+            if (err == ESP_ERR_TIMEOUT) {
+                publish_node_status((uint32_t)seq, false, NULL, "previous config still switching");
+                return;
+            }
+        } else {
+            err = node_config_apply(
+                (uint8_t)odr_index, (uint8_t)range,
+                (uint8_t)hpf_corner, (uint32_t)seq,
+                &st_result
+            );
+            s_last_selftest_ok = st_result.passed;
+        }
 
         if (err != ESP_OK) {
             publish_node_status((uint32_t)seq, false, NULL, "register write failed");
             return;
         }
 
-        /* If node was recording before reconfiguration, restart ISR */
-        if (state == NODE_STATE_RECORDING) {
+        mqtt_set_payload_format(format);
+        spectrum_set_mode(spectrum_mode);
+        event_capture_configure(trig_mode, trig_level);
+        metrics_set_interval_s((uint32_t)metrics_s);
+        flow_control_set_auto(flow_auto);
+        flow_control_set_batch((uint32_t)batch_s, (uint32_t)batch_max_ms);
+        udp_stream_set_enabled(udp_on, udp_raw, (uint16_t)udp_port);
+
+        /* If node was recording before a full reconfiguration, restart ISR */
+        if (state == NODE_STATE_RECORDING && !live) {
             esp_err_t start_err = sensor_acquisition_start();
             if (start_err != ESP_OK) {
                 fault_log_record(FAULT_SPI_ERROR);
@@ -702,6 +1040,11 @@ static void on_mqtt_cmd(const char *topic, const char *payload)
         int32_t seq = json_get_int(payload, "seq", 0);
 
         if (json_str_equals(payload, "cmd", "start")) {
+            sync_start_cancel();
+            if (bench_is_running()) {
+                publish_node_status((uint32_t)seq, false, "start", "bench running");
+                return;
+            }
             if (state == NODE_STATE_CONFIGURED) {
                 esp_err_t err = sensor_acquisition_start();
                 if (err != ESP_OK) {
@@ -723,7 +1066,25 @@ static void on_mqtt_cmd(const char *topic, const char *payload)
             return;
         }
 
+        /* Scheduled start (sync_start.h): ack now, "start" status when it fires */
+        if (json_str_equals(payload, "cmd", "start_at")) {
+            if (state != NODE_STATE_CONFIGURED) {
+                publish_node_status((uint32_t)seq, false, "start_at", "must configure before start");
+                return;
+            }
+            if (bench_is_running()) {
+                publish_node_status((uint32_t)seq, false, "start_at", "bench running");
+                return;
+            }
+            int64_t epoch_us = json_get_int64(payload, "epoch_us", 0);
+            const char *why = NULL;
+            esp_err_t err = sync_start_arm(epoch_us, (uint32_t)seq, &why);
+            publish_node_status((uint32_t)seq, err == ESP_OK, "start_at", why);
+            return;
+        }
+
         if (json_str_equals(payload, "cmd", "stop")) {
+            sync_start_cancel();
             if (state == NODE_STATE_RECORDING) {
                 sensor_acquisition_stop();
                 node_config_set_configured();
@@ -733,6 +1094,7 @@ static void on_mqtt_cmd(const char *topic, const char *payload)
         }
 
         if (json_str_equals(payload, "cmd", "init")) {
+            sync_start_cancel();
             if (state == NODE_STATE_RECORDING) {
                 sensor_acquisition_stop();
             }
@@ -742,11 +1104,13 @@ static void on_mqtt_cmd(const char *topic, const char *payload)
                 publish_node_status((uint32_t)seq, false, "init", "init failed");
                 return;
             }
+            s_last_selftest_ok = st_result.passed;
             publish_node_status((uint32_t)seq, st_result.passed, "init", NULL);
             return;
         }
 
         if (json_str_equals(payload, "cmd", "reset")) {
+            sync_start_cancel();
             if (state == NODE_STATE_RECORDING) {
                 sensor_acquisition_stop();
             }
@@ -755,6 +1119,54 @@ static void on_mqtt_cmd(const char *topic, const char *payload)
             return;
         }
 
+        /* Timing histograms work in any state, including ERROR */
+        if (json_str_equals(payload, "cmd", "timing")) {
+            esp_err_t err = timing_hist_publish();
+            publish_node_status((uint32_t)seq, err == ESP_OK, "timing",
+                                err == ESP_OK ? NULL : "timing publish failed");
+            return;
+        }
+
+        if (json_str_equals(payload, "cmd", "timing_reset")) {
+            timing_hist_reset();
+            publish_node_status((uint32_t)seq, true, "timing_reset", NULL);
+            return;
+        }
+
+        /* Scenario benchmark (bench.h): ack now, result on the status topic */
+        if (json_str_equals(payload, "cmd", "bench")) {
+            if (state != NODE_STATE_IDLE && state != NODE_STATE_CONFIGURED) {
+                publish_node_status((uint32_t)seq, false, "bench", "only while idle or configured");
+                return;
+            }
+            if (sync_start_is_armed()) {
+                publish_node_status((uint32_t)seq, false, "bench", "start_at pending");
+                return;
+            }
+            int32_t seconds = json_get_int(payload, "seconds", BENCH_DEFAULT_SECONDS);
+            esp_err_t err = bench_start_scenario(seconds > 0 ? (uint32_t)seconds : 0,
+                                                 (uint32_t)seq);
+            publish_node_status((uint32_t)seq, err == ESP_OK, "bench",
+                                err == ESP_OK ? NULL :
+                                err == ESP_ERR_INVALID_ARG ? "invalid seconds" :
+                                err == ESP_ERR_INVALID_STATE ? "bench already running" :
+                                "bench task start failed");
+            return;
+        }
+
+        if (json_str_equals(payload, "cmd", "trigger")) {
+            if (state != NODE_STATE_RECORDING) {
+                publish_node_status((uint32_t)seq, false, "trigger", "not recording");
+                return;
+            }
+            if (event_capture_trigger_manual() != ESP_OK) {
+                publish_node_status((uint32_t)seq, false, "trigger", "capture busy");
+                return;
+            }
+            publish_node_status((uint32_t)seq, true, "trigger", NULL);
+            return;
+        }
+
         ESP_LOGW("CMD", "Unknown control cmd: %s", payload);
         return;
     }
@@ -762,17 +1174,152 @@ static void on_mqtt_cmd(const char *topic, const char *payload)
     ESP_LOGW("CMD", "Unrecognised cmd topic: %s", topic);
 }
 
+/* -------------------------------------------------------------------------- */
+/* Boot phases (boot_seq.h)                                                   */
+/* -------------------------------------------------------------------------- */
+
+static bool s_boot_temp_available = false;
+
+static esp_err_t boot_network(void)
+{
+    return init_network();
+}
+
+/**
+ * MQTT is normally started by the on_ethernet_got_ip callback, which fires
+ * during ethernet_wait_for_ip(). Never call init_mqtt() while it may still
+ * run -- that races with the callback and creates two MQTT clients. Wait
+ * for it, then for the broker, so the first status can go out.
+ */
+static esp_err_t boot_mqtt(void)
+{
+    if (!boot_seq_ok(BOOT_PHASE_NETWORK)) {
+        ESP_LOGW(TAG, "Skipping MQTT init - no network (will start when IP obtained)");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* The callback fires from the event task concurrently with
+     * ethernet_wait_for_ip() unblocking. Give it up to 2 s to finish. */
+    int waited = 0;
+    while (!s_mqtt_started && waited < 2000) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+        waited += 10;
+    }
+    if (!s_mqtt_started) {
+        /* Callback didn't fire or failed -- start MQTT ourselves */
+        ESP_LOGW(TAG, "IP callback did not start MQTT -- starting directly");
+        if (init_mqtt() != ESP_OK) {
+            return ESP_FAIL;
+        }
+        s_mqtt_started = true;
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "MQTT started by IP callback (waited %d ms)", waited);
+    if (mqtt_wait_for_connection(BOOT_MQTT_CONNECT_WAIT_MS) != ESP_OK) {
+        /* Non-fatal: the client keeps retrying in the background */
+        ESP_LOGW(TAG, "Broker not reached within %d sec -- continuing boot",
+                 BOOT_MQTT_CONNECT_WAIT_MS / 1000);
+    }
+    return ESP_OK;
+}
+
+/**
+ * Wait for the first SNTP sync so the fault publisher registered after boot
+ * stamps everything in UTC. Hard timeout: 10 s.
+ */
+static esp_err_t boot_sntp(void)
+{
+    if (!boot_seq_ok(BOOT_PHASE_NETWORK)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = init_sntp();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    const int SNTP_WAIT_TIMEOUT_MS = 10000;
+    const int SNTP_WAIT_STEP_MS    = 100;
+    int waited_ms = 0;
+    while (!sntp_sync_is_valid() && waited_ms < SNTP_WAIT_TIMEOUT_MS) {
+        vTaskDelay(pdMS_TO_TICKS(SNTP_WAIT_STEP_MS));
+        waited_ms += SNTP_WAIT_STEP_MS;
+    }
+    if (sntp_sync_is_valid()) {
+        ESP_LOGI(TAG, "SNTP synced after %d ms -- packets will carry UTC timestamps",
+                 waited_ms);
+        return ESP_OK;
+    }
+    ESP_LOGW(TAG, "SNTP sync timeout (%d ms) -- using tick-relative timestamps",
+             waited_ms);
+    return ESP_ERR_TIMEOUT;
+}
+
+static esp_err_t boot_buses(void)
+{
+    if (init_buses() != ESP_OK) {
+        handle_critical_failure("Bus initialization failed (I2C or SPI)");
+    }
+    return ESP_OK;
+}
+
+static esp_err_t boot_sensors(void)
+{
+    if (init_sensors(&s_boot_temp_available) != ESP_OK) {
+        ESP_LOGW(TAG, "Sensor initialization had issues -- node will send NaN for failed sensors");
+    }
+    return ESP_OK;
+}
+
+static esp_err_t boot_acquisition(void)
+{
+    if (init_acquisition(s_boot_temp_available) != ESP_OK) {
+        handle_critical_failure("ISR acquisition initialization failed");
+    }
+    if (sync_start_init(on_sync_start_done) != ESP_OK) {
+        ESP_LOGW(TAG, "Scheduled start unavailable -- start_at will be rejected");
+    }
+    return ESP_OK;
+}
+
+static esp_err_t boot_data_task(void)
+{
+    if (init_data_processing() != ESP_OK) {
+        handle_critical_failure("Data processing task initialization failed");
+    }
+    return ESP_OK;
+}
+
+/*
+ * The Ethernet MAC is internal (no shared SPI), so the network lane only
+ * shares the fault log and the log output with the sensor lane. A phase may
+ * depend only on phases listed above it.
+ */
+static const boot_phase_desc_t s_boot_phases[] = {
+    { BOOT_PHASE_NETWORK,     boot_network,     0,                                  1 },
+    { BOOT_PHASE_MQTT,        boot_mqtt,        BOOT_PHASE_BIT(BOOT_PHASE_NETWORK), 1 },
+    { BOOT_PHASE_SNTP,        boot_sntp,        BOOT_PHASE_BIT(BOOT_PHASE_NETWORK), 1 },
+    { BOOT_PHASE_BUSES,       boot_buses,       0,                                  0 },
+    { BOOT_PHASE_SENSORS,     boot_sensors,     BOOT_PHASE_BIT(BOOT_PHASE_BUSES),   0 },
+    { BOOT_PHASE_ACQUISITION, boot_acquisition, BOOT_PHASE_BIT(BOOT_PHASE_SENSORS), 0 },
+    { BOOT_PHASE_DATA_TASK,   boot_data_task,   BOOT_PHASE_BIT(BOOT_PHASE_ACQUISITION), 0 },
+};
+
 /* -------------------------------------------------------------------------- */
 /* app_main                                                                   */
 /* -------------------------------------------------------------------------- */
 
 void app_main(void)
 {
-    bool temp_sensor_available = false;
-
     /* Initialise state machine first -- sets state to IDLE, loads defaults. */
     node_config_init();
 
+    /* Fault dispatcher next, so boot-time faults are drained and coalesced
+     * while the network comes up (they are held until MQTT is ready). */
+    if (fault_log_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Fault dispatcher unavailable -- faults will stay queued");
+    }
+
     init_reboot_counter();
 
     /* Detect and log the cause of the previous reset at boot time */
@@ -790,6 +1337,13 @@ void app_main(void)
     }
     print_banner();
 
+#if JSON_WRITER_RUN_BENCHMARK
+    json_writer_benchmark();
+#endif
+#if BENCH_RUN_AT_BOOT
+    bench_run_micro();
+#endif
+
     /* Register cmd handler BEFORE mqtt_init so no message can arrive
      * before the handler is wired up. */
     mqtt_set_cmd_handler(on_mqtt_cmd);
@@ -798,83 +1352,24 @@ void app_main(void)
      * the very first IP_EVENT_ETH_GOT_IP, including the boot-time one. */
     ethernet_set_got_ip_cb(on_ethernet_got_ip);
 
-    bool network_ok = (init_network() == ESP_OK);
-    ESP_LOGI(TAG, "");
-
-    /* MQTT is always started by on_ethernet_got_ip callback, which fires during
-     * ethernet_wait_for_ip() above. Never call init_mqtt() here directly --
-     * doing so races with the callback and creates two MQTT clients.
-     * Instead, wait briefly for the callback to complete then check the result. */
-    bool mqtt_ok = false;
-    if (network_ok) {
-        /* The callback fires from the event task concurrently with
-         * ethernet_wait_for_ip() unblocking. Give it up to 2 s to finish. */
-        int waited = 0;
-        while (!s_mqtt_started && waited < 2000) {
-            vTaskDelay(pdMS_TO_TICKS(10));
-            waited += 10;
-        }
-        if (s_mqtt_started) {
-            ESP_LOGI(TAG, "MQTT started by IP callback (waited %d ms)", waited);
-            mqtt_ok = true;
-        } else {
-            /* Callback didn't fire or failed -- start MQTT ourselves */
-            ESP_LOGW(TAG, "IP callback did not start MQTT -- starting directly");
-            mqtt_ok = (init_mqtt() == ESP_OK);
-            if (mqtt_ok) {
-                s_mqtt_started = true;
-            }
-        }
-    } else {
-        ESP_LOGW(TAG, "Skipping MQTT init - no network (will start when IP obtained)");
-    }
-    ESP_LOGI(TAG, "");
-
-    bool sntp_ok = false;
-    if (network_ok) {
-        sntp_ok = (init_sntp() == ESP_OK);
-    }
-    ESP_LOGI(TAG, "");
-
-    if (init_buses() != ESP_OK) {
-        handle_critical_failure("Bus initialization failed (I2C or SPI)");
-    }
-    ESP_LOGI(TAG, "");
-
-    if (init_sensors(&temp_sensor_available) != ESP_OK) {
-        ESP_LOGW(TAG, "Sensor initialization had issues -- node will send NaN for failed sensors");
+    /* Network and sensors come up concurrently (boot_seq.h); every phase
+     * is done, or has given up, when this returns. */
+    if (boot_seq_run(s_boot_phases, sizeof(s_boot_phases) / sizeof(s_boot_phases[0])) != ESP_OK) {
+        ESP_LOGW(TAG, "Boot phases ran degraded (see above)");
     }
     ESP_LOGI(TAG, "");
 
-    // Wait for first SNTP sync before starting ISR so every sample gets
-    // a real ISO-8601 timestamp from packet one. Hard timeout: 10 s.
-    if (sntp_ok) {
-        ESP_LOGI(TAG, "--- Waiting for first SNTP sync ---");
-        const int SNTP_WAIT_TIMEOUT_MS = 10000;
-        const int SNTP_WAIT_STEP_MS    = 100;
-        int waited_ms = 0;
-        while (!sntp_sync_is_valid() && waited_ms < SNTP_WAIT_TIMEOUT_MS) {
-            vTaskDelay(pdMS_TO_TICKS(SNTP_WAIT_STEP_MS));
-            waited_ms += SNTP_WAIT_STEP_MS;
-        }
-        if (sntp_sync_is_valid()) {
-            ESP_LOGI(TAG, "SNTP synced after %d ms -- ISR will use UTC timestamps",
-                     waited_ms);
-        } else {
-            ESP_LOGW(TAG, "SNTP sync timeout (%d ms) -- using tick-relative timestamps",
-                     waited_ms);
-        }
-        ESP_LOGI(TAG, "");
-    }
+    bool network_ok = boot_seq_ok(BOOT_PHASE_NETWORK);
+    bool mqtt_ok    = boot_seq_ok(BOOT_PHASE_MQTT);
 
     /* Register the fault publish callback only after SNTP has synced (or
      * timed out). This guarantees that every fault timestamp published on
      * wind_turbine/<SERIAL>/faults uses real UTC time, not the tick fallback.
-     * Faults that fired earlier in boot are already in the pending buffer
-     * and will be flushed with the first data packet once recording starts. */
+     * Faults that fired earlier in boot are held by the dispatcher until
+     * then. */
     if (mqtt_ok) {
         fault_log_set_publish_cb(on_fault_publish);
-        ESP_LOGI(TAG, "Fault publish callback registered -- immediate fault reporting active");
+        ESP_LOGI(TAG, "Fault publish callback registered -- fault reporting active");
         /* Flush any faults that accumulated during boot (reset cause, sensor
          * init failures, etc.) before the callback was registered. These are
          * published now with a valid UTC timestamp so the subscriber receives
@@ -882,16 +1377,6 @@ void app_main(void)
         fault_log_flush_pending();
     }
 
-    if (init_acquisition(temp_sensor_available) != ESP_OK) {
-        handle_critical_failure("ISR acquisition initialization failed");
-    }
-    ESP_LOGI(TAG, "");
-
-    if (init_data_processing() != ESP_OK) {
-        handle_critical_failure("Data processing task initialization failed");
-    }
-    ESP_LOGI(TAG, "");
-
     /* Always build the cmd topic strings so the MQTT_EVENT_CONNECTED handler
      * can re-subscribe on reconnect even if the broker wasn't reachable at boot.
      * mqtt_subscribe_cmd() will also attempt the actual subscription now if
@@ -900,23 +1385,25 @@ void app_main(void)
 
     clear_reboot_counter();
 
-    /* Publish initial IDLE status so the Pi knows the node is up */
-    if (mqtt_ok) {
-        publish_node_status(0, true, NULL, NULL);
-    }
-
     ESP_LOGI(TAG, "--- Creating Statistics Monitor ---");
-    xTaskCreate(
-        stats_monitor_task,
-        "stats_task",
-        STATS_TASK_STACK_SIZE,
-        NULL,
-        STATS_TASK_PRIORITY,
-        NULL
-    );
+    mem_budget_task_create("stats", &s_stats_task_mem, stats_monitor_task, "stats_task", NULL,
+                           STATS_TASK_PRIORITY, tskNO_AFFINITY);
     ESP_LOGI(TAG, "Statistics monitor created (interval: %d sec)", STATS_INTERVAL_MS / 1000);
+
+    if (metrics_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Metrics topic unavailable -- UART stats only");
+    }
     ESP_LOGI(TAG, "");
 
+    /* Every long-lived task and buffer exists now (mem_budget.h) */
+    mem_budget_log_report();
+
+    /* Publish initial IDLE status so the Pi knows the node is up; it
+     * carries the boot timings and the memory map */
+    if (mqtt_ok) {
+        publish_node_status(0, true, NULL, NULL);
+    }
+
     ESP_LOGI(TAG, "==============================================");
     ESP_LOGI(TAG, "  SYSTEM RUNNING -- STATE: IDLE");
     ESP_LOGI(TAG, "");
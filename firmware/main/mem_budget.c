@@ -0,0 +1,205 @@
+/**
+ * @file mem_budget.c
+ * @brief Static task storage, boot-time reservations and the memory map
+ *        (see mem_budget.h).
+ */
+
+#include "mem_budget.h"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "MEM";
+
+typedef struct {
+    const char *name;
+    uint32_t    bytes[MEM_REGION_COUNT];
+    uint16_t    tasks;
+} mem_subsys_t;
+
+/* Recorded from both boot lanes at once, hence the lock */
+static portMUX_TYPE  s_lock = portMUX_INITIALIZER_UNLOCKED;
+static mem_subsys_t  s_subsys[MEM_BUDGET_MAX_SUBSYSTEMS];
+static size_t        s_count;
+static uint32_t      s_unrecorded;      /* bytes past a full table */
+static bool          s_reported;
+static bool          s_status_sent;
+
+static const char *const s_region_name[MEM_REGION_COUNT] = {
+    "static", "internal", "psram",
+};
+
+/******************************************************************************
+ * RECORDING
+ *****************************************************************************/
+
+static void record(const char *subsys, mem_region_t region, size_t bytes, bool task)
+{
+    portENTER_CRITICAL(&s_lock);
+    mem_subsys_t *s = NULL;
+    for (size_t i = 0; i < s_count; i++) {
+        if (strcmp(s_subsys[i].name, subsys) == 0) {
+            s = &s_subsys[i];
+            break;
+        }
+    }
+    if (s == NULL && s_count < MEM_BUDGET_MAX_SUBSYSTEMS) {
+        s = &s_subsys[s_count++];
+        s->name = subsys;
+    }
+    if (s != NULL) {
+        s->bytes[region] += (uint32_t)bytes;
+        s->tasks += task ? 1u : 0u;
+    } else {
+        s_unrecorded += (uint32_t)bytes;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void mem_budget_record(const char *subsys, mem_region_t region, size_t bytes)
+{
+    if (subsys != NULL && region < MEM_REGION_COUNT && bytes > 0) {
+        record(subsys, region, bytes, false);
+    }
+}
+
+TaskHandle_t mem_budget_task_create(const char *subsys, const mem_task_storage_t *mem,
+                                    TaskFunction_t fn, const char *name, void *arg,
+                                    UBaseType_t priority, BaseType_t core)
+{
+    TaskHandle_t handle = xTaskCreateStaticPinnedToCore(fn, name, mem->stack_bytes, arg,
+                                                        priority, mem->stack, mem->tcb,
+                                                        core);
+    if (handle != NULL) {
+        record(subsys, MEM_REGION_STATIC, mem->stack_bytes + sizeof(StaticTask_t), true);
+    }
+    return handle;
+}
+
+void *mem_budget_reserve(const char *subsys, size_t bytes, bool prefer_psram)
+{
+    void *buf = NULL;
+    mem_region_t region = MEM_REGION_INTERNAL;
+
+    if (prefer_psram) {
+        buf = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        region = MEM_REGION_PSRAM;
+    }
+    if (buf == NULL) {
+        buf = heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        region = MEM_REGION_INTERNAL;
+    }
+    if (buf == NULL) {
+        ESP_LOGE(TAG, "%s: no room for %u bytes", subsys, (unsigned)bytes);
+        return NULL;
+    }
+    record(subsys, region, bytes, false);
+    return buf;
+}
+
+/******************************************************************************
+ * REPORT
+ *****************************************************************************/
+
+typedef struct {
+    uint32_t total[MEM_REGION_COUNT];
+    size_t   heap_free;
+    size_t   heap_largest;
+    size_t   heap_min;
+    size_t   psram_free;
+} mem_summary_t;
+
+static void summarize(mem_summary_t *m)
+{
+    memset(m, 0, sizeof(*m));
+    for (size_t i = 0; i < s_count; i++) {
+        for (int r = 0; r < MEM_REGION_COUNT; r++) {
+            m->total[r] += s_subsys[i].bytes[r];
+        }
+    }
+    const uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    m->heap_free    = heap_caps_get_free_size(caps);
+    m->heap_largest = heap_caps_get_largest_free_block(caps);
+    m->heap_min     = heap_caps_get_minimum_free_size(caps);
+    m->psram_free   = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+}
+
+void mem_budget_log_report(void)
+{
+    mem_summary_t m;
+    summarize(&m);
+
+    ESP_LOGI(TAG, "========== Memory map ==========");
+    ESP_LOGI(TAG, "  %-14s %8s %8s %8s  tasks", "subsystem",
+             s_region_name[0], s_region_name[1], s_region_name[2]);
+    for (size_t i = 0; i < s_count; i++) {
+        const mem_subsys_t *s = &s_subsys[i];
+        ESP_LOGI(TAG, "  %-14s %8lu %8lu %8lu  %u", s->name,
+                 (unsigned long)s->bytes[MEM_REGION_STATIC],
+                 (unsigned long)s->bytes[MEM_REGION_INTERNAL],
+                 (unsigned long)s->bytes[MEM_REGION_PSRAM], (unsigned)s->tasks);
+    }
+    ESP_LOGI(TAG, "  %-14s %8lu %8lu %8lu", "total",
+             (unsigned long)m.total[MEM_REGION_STATIC],
+             (unsigned long)m.total[MEM_REGION_INTERNAL],
+             (unsigned long)m.total[MEM_REGION_PSRAM]);
+    if (s_unrecorded > 0) {
+        ESP_LOGW(TAG, "  %lu bytes not in the map (MEM_BUDGET_MAX_SUBSYSTEMS)",
+                 (unsigned long)s_unrecorded);
+    }
+    ESP_LOGI(TAG, "  Internal heap: free=%u largest=%u min=%u  PSRAM free=%u",
+             (unsigned)m.heap_free, (unsigned)m.heap_largest,
+             (unsigned)m.heap_min, (unsigned)m.psram_free);
+    ESP_LOGI(TAG, "================================");
+
+    s_reported = true;
+}
+
+int mem_budget_format_status(char *buf, size_t len)
+{
+    if (!s_reported || s_status_sent || len == 0) {
+        return 0;
+    }
+
+    mem_summary_t m;
+    summarize(&m);
+
+    int off = snprintf(buf, len,
+                       ",\"mem\":{\"static\":%lu,\"internal\":%lu,\"psram\":%lu,"
+                       "\"heap\":[%u,%u,%u],\"psram_free\":%u,\"sub\":{",
+                       (unsigned long)m.total[MEM_REGION_STATIC],
+                       (unsigned long)m.total[MEM_REGION_INTERNAL],
+                       (unsigned long)m.total[MEM_REGION_PSRAM],
+                       (unsigned)m.heap_free, (unsigned)m.heap_largest,
+                       (unsigned)m.heap_min, (unsigned)m.psram_free);
+    for (size_t i = 0; i < s_count && off > 0 && (size_t)off < len; i++) {
+        const mem_subsys_t *s = &s_subsys[i];
+        off += snprintf(buf + off, len - off, "%s\"%s\":[%lu,%lu,%lu]",
+                        i ? "," : "", s->name,
+                        (unsigned long)s->bytes[MEM_REGION_STATIC],
+                        (unsigned long)s->bytes[MEM_REGION_INTERNAL],
+                        (unsigned long)s->bytes[MEM_REGION_PSRAM]);
+    }
+    if (off > 0 && (size_t)off < len) {
+        off += snprintf(buf + off, len - off, "}}");
+    }
+
+    if (off < 0) {
+        return 0;
+    }
+    if ((size_t)off >= len) {
+        /* Truncated: drop the whole object rather than emit broken JSON */
+        buf[0] = '\0';
+        return 0;
+    }
+    return off;
+}
+
+void mem_budget_status_sent(void)
+{
+    if (s_reported) {
+        s_status_sent = true;
+    }
+}
@@ -0,0 +1,124 @@
+/**
+ * @file mem_budget.h
+ * @brief Fixed memory budget: static task stacks, buffers reserved once at
+ *        boot, and a memory map of what each subsystem holds.
+ *
+ * The long-lived tasks used to be created with xTaskCreate and the big
+ * buffers (the 20 KB MQTT scratch, the publish pipeline's payload and
+ * coalescing buffers) malloc'd from the internal heap, next to esp-mqtt's
+ * per-message outbox allocations. Over weeks of broker reconnects the free
+ * heap crept down and split into smaller blocks. Now:
+ *
+ *   - long-lived tasks get their stack and TCB from static storage
+ *     (MEM_BUDGET_STATIC_TASK + mem_budget_task_create), so a task costs
+ *     .bss, not heap;
+ *   - buffers that live as long as the firmware come from
+ *     mem_budget_reserve(), once, before the heap has been churned; PSRAM
+ *     when the module has it and the caller allows it. They are never
+ *     freed, and a re-init reuses the same buffer;
+ *   - esp-mqtt allocations above CONFIG_SPIRAM_MALLOC_ALWAYSINTERNAL
+ *     (outbox entries for data payloads) land in PSRAM (sdkconfig.defaults),
+ *     leaving the internal heap to lwIP and the drivers.
+ *
+ * Every task, reserved buffer and large static pool is recorded under its
+ * subsystem. mem_budget_log_report() prints the map once boot is done, and
+ * the first status message after that carries it (mqtt.h):
+ *
+ *   "mem":{"static":..,"internal":..,"psram":..,
+ *          "heap":[free,largest_block,min_free],"psram_free":..,
+ *          "sub":{"pipeline":[static,internal,psram],..}}
+ *
+ * heap is the internal 8-bit heap. The largest free block against the free
+ * total is the fragmentation signal; the metrics topic tracks it too
+ * ("heap_big").
+ */
+
+#ifndef MEM_BUDGET_H
+#define MEM_BUDGET_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * CONFIGURATION
+ *****************************************************************************/
+
+#define MEM_BUDGET_MAX_SUBSYSTEMS   20
+
+typedef enum {
+    MEM_REGION_STATIC   = 0,    /**< .bss / .data: task stacks, TCBs, pools  */
+    MEM_REGION_INTERNAL = 1,    /**< Reserved once from the internal heap    */
+    MEM_REGION_PSRAM    = 2,    /**< Reserved once from PSRAM                */
+    MEM_REGION_COUNT
+} mem_region_t;
+
+/** @brief Static stack + TCB of one task (MEM_BUDGET_STATIC_TASK). */
+typedef struct {
+    StackType_t  *stack;
+    uint32_t      stack_bytes;
+    StaticTask_t *tcb;
+} mem_task_storage_t;
+
+/**
+ * @brief Declare static storage for one task at file scope:
+ *        MEM_BUDGET_STATIC_TASK(s_foo_task_mem, FOO_TASK_STACK_SIZE);
+ */
+#define MEM_BUDGET_STATIC_TASK(var, stack_bytes)                               \
+    static StackType_t var##_stack[(stack_bytes) / sizeof(StackType_t)]        \
+        __attribute__((aligned(16)));                                          \
+    static StaticTask_t var##_tcb;                                             \
+    static const mem_task_storage_t var = {                                    \
+        var##_stack, sizeof(var##_stack), &var##_tcb                           \
+    }
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * @brief Create a pinned task on its static storage and record it.
+ *
+ * The storage must not be reused while a previous task on it is still
+ * being deleted. Returns NULL only if the storage is NULL.
+ */
+TaskHandle_t mem_budget_task_create(const char *subsys, const mem_task_storage_t *mem,
+                                    TaskFunction_t fn, const char *name, void *arg,
+                                    UBaseType_t priority, BaseType_t core);
+
+/**
+ * @brief Reserve a buffer for the life of the firmware and record it.
+ *
+ * PSRAM when prefer_psram and the module has it, else the internal heap.
+ * Call once per buffer (keep the pointer across re-inits); never free it.
+ *
+ * @return The buffer, or NULL when neither heap has the room.
+ */
+void *mem_budget_reserve(const char *subsys, size_t bytes, bool prefer_psram);
+
+/** @brief Record a fixed footprint: a static pool, or a buffer allocated elsewhere. */
+void mem_budget_record(const char *subsys, mem_region_t region, size_t bytes);
+
+/** @brief Print the memory map and heap state (end of boot). */
+void mem_budget_log_report(void);
+
+/**
+ * @brief Append ,"mem":{..} to a status message; 0 once sent, or if it
+ *        does not fit in len (it then rides on the next status).
+ */
+int mem_budget_format_status(char *buf, size_t len);
+
+/** @brief The object went out: later status messages leave it off. */
+void mem_budget_status_sent(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_BUDGET_H
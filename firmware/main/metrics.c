@@ -0,0 +1,290 @@
+/**
+ * @file metrics.c
+ * @brief Periodic runtime-metrics topic (see metrics.h).
+ *
+ * Everything here runs in the metrics task: the JSON buffer, the task
+ * status snapshot and the previous run-time counters are private to it.
+ * metrics_set_interval_s() only stores the new interval and wakes it.
+ */
+
+#include "metrics.h"
+#include "mem_budget.h"
+#include "mqtt.h"
+#include "ethernet.h"
+#include "sensor_task.h"
+#include "data_processing_and_mqtt_task.h"
+#include "publish_pipeline.h"
+#include "store_forward.h"
+#include "node_config.h"
+#include "flow_control.h"
+#include "packet_time.h"
+#include "boot_seq.h"
+#include "cpu_topology.h"
+#include "spi_bus.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "METRICS";
+
+MEM_BUDGET_STATIC_TASK(s_task_mem, METRICS_TASK_STACK_SIZE);
+
+#define METRICS_TOPIC_BUF_SIZE  80
+
+static volatile uint32_t s_interval_s = METRICS_DEFAULT_INTERVAL_S;
+static TaskHandle_t      s_task       = NULL;
+
+static char s_json_buf[METRICS_JSON_MAX];
+static cpu_load_sampler_t s_cpu_load;
+
+/******************************************************************************
+ * TASK RUN-TIME STATS
+ *****************************************************************************/
+
+#if (configUSE_TRACE_FACILITY == 1) && (configGENERATE_RUN_TIME_STATS == 1)
+
+static TaskStatus_t s_task_status[METRICS_MAX_TASKS];
+
+/* Run-time counter of each task at the previous message, keyed by task number */
+static struct {
+    UBaseType_t number;
+    uint32_t    runtime;
+} s_prev[METRICS_MAX_TASKS];
+static UBaseType_t s_prev_count;
+static uint32_t    s_prev_total;
+
+static uint32_t prev_runtime(UBaseType_t number)
+{
+    for (UBaseType_t i = 0; i < s_prev_count; i++) {
+        if (s_prev[i].number == number) {
+            return s_prev[i].runtime;
+        }
+    }
+    return 0;
+}
+
+static int append_tasks(char *buf, size_t cap, int off)
+{
+    uint32_t total = 0;
+    UBaseType_t n = uxTaskGetSystemState(s_task_status, METRICS_MAX_TASKS, &total);
+    if (n == 0) {
+        /* More tasks than METRICS_MAX_TASKS; skip the map rather than guess */
+        return off;
+    }
+
+    uint32_t d_total = total - s_prev_total;
+
+    off += snprintf(buf + off, cap - off, ",\"tasks\":{");
+    for (UBaseType_t i = 0; i < n && off < (int)cap; i++) {
+        const TaskStatus_t *t = &s_task_status[i];
+        uint32_t d_task = t->ulRunTimeCounter - prev_runtime(t->xTaskNumber);
+        uint32_t cpu_x10 = d_total ? (uint32_t)(((uint64_t)d_task * 1000u) / d_total) : 0;
+
+        off += snprintf(buf + off, cap - off, "%s\"%s\":[%lu,%lu]",
+                        i ? "," : "", t->pcTaskName, (unsigned long)cpu_x10,
+                        (unsigned long)t->usStackHighWaterMark);
+    }
+    if (off < (int)cap) {
+        off += snprintf(buf + off, cap - off, "}");
+    }
+
+    for (UBaseType_t i = 0; i < n; i++) {
+        s_prev[i].number  = s_task_status[i].xTaskNumber;
+        s_prev[i].runtime = s_task_status[i].ulRunTimeCounter;
+    }
+    s_prev_count = n;
+    s_prev_total = total;
+    return off;
+}
+
+#else
+
+static int append_tasks(char *buf, size_t cap, int off)
+{
+    (void)buf;
+    (void)cap;
+    return off;
+}
+
+#endif
+
+/******************************************************************************
+ * MESSAGE
+ *****************************************************************************/
+
+static int build_metrics_json(char *buf, size_t cap)
+{
+    uint32_t samples_published, packets_sent, samples_dropped;
+    data_processing_and_mqtt_task_get_stats(&samples_published, &packets_sent, &samples_dropped);
+
+    uint32_t acquired, acq_dropped, isr_max;
+    sensor_acquisition_get_stats(&acquired, &acq_dropped, &isr_max);
+
+    uint32_t hw_adxl, hw_scl, hw_adt;
+    sensor_acquisition_get_ring_high_water(&hw_adxl, &hw_scl, &hw_adt);
+
+    uint32_t fifo_bursts, fifo_resyncs, fifo_full;
+    adxl355_get_fifo_diag(&fifo_bursts, &fifo_resyncs, &fifo_full);
+
+    publish_pipeline_stats_t pipe;
+    publish_pipeline_get_stats(&pipe);
+
+    store_forward_stats_t sf;
+    store_forward_get_stats(&sf);
+
+    char ts[TS_ISO_MIN_LEN];
+    ts_anchor_t     anchor;
+    ts_iso_cursor_t cursor;
+    ts_anchor_capture(&anchor);
+    ts_iso_cursor_init(&cursor);
+    ts_format_tick(&anchor, &cursor, anchor.tick, ts);
+
+    int off = snprintf(buf, cap,
+                       "{\"ts\":\"%s\",\"up\":%lu,\"state\":\"%s\""
+                       ",\"heap\":%lu,\"heap_min\":%lu,\"heap_big\":%lu"
+                       ",\"eth\":%d,\"mqtt\":%d,\"outbox\":%d,\"flow\":\"%s\""
+                       ",\"ring\":{\"adxl\":[%lu,%lu],\"scl\":[%lu,%lu],\"adt\":[%lu,%lu]}"
+                       ",\"ovf\":{\"adxl\":%lu,\"scl\":%lu,\"fifo_full\":%lu,\"acq_drop\":%lu}"
+                       ",\"pub\":{\"pkts\":%lu,\"samples\":%lu,\"drop\":%lu,\"fail\":%lu"
+                       ",\"slot_full\":%lu,\"sf_pending\":%lu"
+                       ",\"lat_us\":[%lu,%lu],\"e2e_us\":[%lu,%lu]}",
+                       ts, (unsigned long)(esp_timer_get_time() / 1000000),
+                       node_state_str(node_config_get_state()),
+                       (unsigned long)esp_get_free_heap_size(),
+                       (unsigned long)esp_get_minimum_free_heap_size(),
+                       (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL |
+                                                                       MALLOC_CAP_8BIT),
+                       ethernet_is_connected() ? 1 : 0, mqtt_is_connected() ? 1 : 0,
+                       mqtt_get_outbox_size(),
+                       flow_control_level_str(flow_control_get_level()),
+                       (unsigned long)adxl355_samples_available(), (unsigned long)hw_adxl,
+                       (unsigned long)scl3300_samples_available(), (unsigned long)hw_scl,
+                       (unsigned long)adt7420_samples_available(), (unsigned long)hw_adt,
+                       (unsigned long)adxl355_get_overflow_count(),
+                       (unsigned long)scl3300_get_overflow_count(),
+                       (unsigned long)fifo_full, (unsigned long)acq_dropped,
+                       (unsigned long)packets_sent, (unsigned long)samples_published,
+                       (unsigned long)samples_dropped, (unsigned long)pipe.packets_failed,
+                       (unsigned long)pipe.slot_full_drops,
+                       (unsigned long)(sf.enabled ? sf.pending : 0),
+                       (unsigned long)pipe.publish.avg_us, (unsigned long)pipe.publish.max_us,
+                       (unsigned long)pipe.end_to_end.avg_us, (unsigned long)pipe.end_to_end.max_us);
+
+    if (off < (int)cap) {
+        off += snprintf(buf + off, cap - off, ",\"boot_ms\":[%lu,%lu]",
+                        (unsigned long)boot_seq_total_ms(),
+                        (unsigned long)boot_seq_first_packet_ms());
+    }
+    if (off < (int)cap) {
+        off += snprintf(buf + off, cap - off, ",\"spi_hz\":[%lu,%lu]",
+                        (unsigned long)spi_bus_get_clock_hz(SPI_BUS_DEV_ADXL355),
+                        (unsigned long)spi_bus_get_clock_hz(SPI_BUS_DEV_SCL3300));
+    }
+    if (off < (int)cap) {
+        uint16_t load_x10[portNUM_PROCESSORS];
+        cpu_topology_sample_load(&s_cpu_load, load_x10);
+        off += snprintf(buf + off, cap - off, ",\"cpu\":[");
+        for (int core = 0; core < portNUM_PROCESSORS && off < (int)cap; core++) {
+            off += snprintf(buf + off, cap - off, "%s%u", core ? "," : "",
+                            (unsigned)load_x10[core]);
+        }
+        if (off < (int)cap) {
+            off += snprintf(buf + off, cap - off, "]");
+        }
+    }
+    if (off < (int)cap) {
+        off = append_tasks(buf, cap, off);
+    }
+    if (off < (int)cap) {
+        off += snprintf(buf + off, cap - off, "}");
+    }
+    return (off < (int)cap) ? off : -1;
+}
+
+static esp_err_t publish_metrics(void)
+{
+    int len = build_metrics_json(s_json_buf, sizeof(s_json_buf));
+    if (len < 0) {
+        ESP_LOGE(TAG, "Metrics message does not fit %d bytes", METRICS_JSON_MAX);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    char topic[METRICS_TOPIC_BUF_SIZE];
+    snprintf(topic, sizeof(topic), "%s/%s/%s",
+             MQTT_TOPIC_PREFIX, mqtt_get_serial_no(), METRICS_TOPIC_SUFFIX);
+    ESP_LOGD(TAG, "Metrics (%d bytes): %s", len, s_json_buf);
+    return mqtt_publish(topic, s_json_buf, len);
+}
+
+/******************************************************************************
+ * TASK
+ *****************************************************************************/
+
+static void metrics_task(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        uint32_t interval_s = s_interval_s;
+        TickType_t wait = interval_s ? pdMS_TO_TICKS(interval_s * 1000u) : portMAX_DELAY;
+
+        /* A notification means the interval changed: restart the wait */
+        if (ulTaskNotifyTake(pdTRUE, wait) != 0) {
+            continue;
+        }
+        if (!mqtt_is_connected()) {
+            continue;
+        }
+        if (publish_metrics() != ESP_OK) {
+            ESP_LOGW(TAG, "Metrics publish failed");
+        }
+    }
+}
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+esp_err_t metrics_init(void)
+{
+    if (s_task != NULL) {
+        return ESP_OK;
+    }
+
+    s_task = mem_budget_task_create("metrics", &s_task_mem, metrics_task, "metrics", NULL,
+                                    METRICS_TASK_PRIORITY, tskNO_AFFINITY);
+    if (s_task == NULL) {
+        ESP_LOGE(TAG, "Failed to create metrics task");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Metrics every %lu s on <serial>/%s",
+             (unsigned long)s_interval_s, METRICS_TOPIC_SUFFIX);
+    return ESP_OK;
+}
+
+esp_err_t metrics_set_interval_s(uint32_t interval_s)
+{
+    if (interval_s > METRICS_MAX_INTERVAL_S) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (interval_s != s_interval_s) {
+        s_interval_s = interval_s;
+        if (s_task != NULL) {
+            xTaskNotifyGive(s_task);
+        }
+        ESP_LOGI(TAG, "Metrics interval: %lu s (0 = off)", (unsigned long)interval_s);
+    }
+    return ESP_OK;
+}
+
+uint32_t metrics_get_interval_s(void)
+{
+    return s_interval_s;
+}
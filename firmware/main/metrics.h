@@ -0,0 +1,81 @@
+/**
+ * @file metrics.h
+ * @brief Periodic runtime-metrics topic for fleet-wide saturation monitoring.
+ *
+ * The UART stats dump in main.c is only visible with a cable attached. This
+ * module publishes the same health counters, plus FreeRTOS run-time stats,
+ * as one compact JSON message on wind_turbine/<SERIAL>/metrics every
+ * metrics_get_interval_s() seconds (configure key "metrics_s", 0 = off):
+ *
+ *   {"ts":"2026-01-01T00:00:00.000000Z","up":3600,"state":"recording",
+ *    "heap":182340,"heap_min":171208,"heap_big":110592,
+ *    "eth":1,"mqtt":1,"outbox":0,"flow":"full",
+ *    "ring":{"adxl":[pending,high_water],"scl":[..],"adt":[..]},
+ *    "ovf":{"adxl":0,"scl":0,"fifo_full":0,"acq_drop":0},
+ *    "pub":{"pkts":3600,"samples":720000,"drop":0,"fail":0,"slot_full":0,
+ *           "sf_pending":0,"lat_us":[avg,max],"e2e_us":[avg,max]},
+ *    "boot_ms":[boot_done,first_packet],"spi_hz":[adxl,scl],
+ *    "cpu":[core0_x10,core1_x10],"tasks":{"data_task":[cpu_x10,stack_free],...}}
+ *
+ * Counters are cumulative since boot so a lost message loses no
+ * information; the Pi differentiates consecutive rows. Latencies are the
+ * publish pipeline's running avg / max (publish_pipeline.h). boot_ms is
+ * power-on to the end of the boot phases and to the first published data
+ * packet (boot_seq.h), 0 until reached. heap_big is the largest free block
+ * of the internal heap: falling while heap holds steady is fragmentation
+ * (mem_budget.h). spi_hz is each sensor's current
+ * SPI clock (spi_bus.h clock profiles), lower than at boot after a fallback.
+ *
+ * cpu is each core's load since the previous message in 0.1 % units
+ * (cpu_topology.h: core 1 runs acquisition, core 0 the network stack).
+ * Task CPU is the share of one core used since the previous message in
+ * 0.1 % units (each IDLE task reads ~1000 on an idle core); stack_free is
+ * the lowest unused stack seen, in bytes. The task map is only present
+ * when FreeRTOS is built with CONFIG_FREERTOS_USE_TRACE_FACILITY and
+ * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS (see sdkconfig.defaults).
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * CONFIGURATION
+ *****************************************************************************/
+
+#define METRICS_TOPIC_SUFFIX        "metrics"
+#define METRICS_DEFAULT_INTERVAL_S  30
+#define METRICS_MAX_INTERVAL_S      3600
+#define METRICS_JSON_MAX            2048
+#define METRICS_MAX_TASKS           24
+
+#define METRICS_TASK_STACK_SIZE     4096
+#define METRICS_TASK_PRIORITY       1
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/** @brief Start the metrics task. Messages are skipped while MQTT is down. */
+esp_err_t metrics_init(void);
+
+/**
+ * @brief Set the publish interval.
+ * @param interval_s  1..METRICS_MAX_INTERVAL_S, or 0 to stop publishing
+ * @return ESP_ERR_INVALID_ARG when out of range.
+ */
+esp_err_t metrics_set_interval_s(uint32_t interval_s);
+
+uint32_t metrics_get_interval_s(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // METRICS_H
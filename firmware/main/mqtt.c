@@ -28,7 +28,19 @@
  */
 
 #include "mqtt.h"
+#include "sensor_payload.h"
 #include "fault_log.h"
+#include "store_forward.h"
+#include "spectrum.h"
+#include "event_capture.h"
+#include "metrics.h"
+#include "flow_control.h"
+#include "clock_discipline.h"
+#include "sync_start.h"
+#include "boot_seq.h"
+#include "mem_budget.h"
+#include "udp_stream.h"
+#include "node_config.h"
 #include "mqtt_client.h"
 #include "esp_log.h"
 #include "esp_mac.h"          // esp_read_mac(), ESP_MAC_ETH
@@ -37,10 +49,9 @@
 #include "nvs.h"              // nvs_open(), nvs_get_str()
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include <stdio.h>
 #include <string.h>
-#include <time.h>
-#include <sys/time.h>
 
 static const char *TAG = "MQTT";
 
@@ -65,10 +76,20 @@ static const char s_topic_cmd_all[] = "wind_turbine/all/cmd/control";
 #define CMD_PAYLOAD_MAX_LEN  256
 static char s_cmd_payload_buf[CMD_PAYLOAD_MAX_LEN];
 
-/* 200 accel samples x ~60 chars + 20 incl samples x ~60 chars + temperature + framing = ~15400 chars */
-#define JSON_BUFFER_SIZE    20480
+/* Scratch buffer for the synchronous mqtt_publish_sensor_data() path.
+ * Data normally goes through the publish pipeline's own buffers, so this
+ * one is reserved (mem_budget.h) by the first caller, not at init. */
+#define JSON_BUFFER_SIZE    MQTT_DATA_PAYLOAD_MAX
 static char *s_json_buffer = NULL;
 
+/* Status messages are built in one static buffer: they come from the
+ * command handler, the sync-start task and app_main, and with the boot
+ * timings and memory map the first one is too big for their stacks */
+#define STATUS_JSON_SIZE    1536
+static char              s_status_buf[STATUS_JSON_SIZE];
+static StaticSemaphore_t s_status_lock_mem;
+static SemaphoreHandle_t s_status_lock = NULL;
+
 /*
  * Runtime-generated identity strings.
  *
@@ -88,6 +109,12 @@ static char s_client_id[CLIENT_ID_MAX_LEN];
 static char s_topic_data[TOPIC_MAX_LEN];
 static char s_topic_status[TOPIC_MAX_LEN];
 
+/* FNV-1a of s_serial_no, stamped into every binary frame header */
+static uint32_t s_serial_hash = 0;
+
+/* Data payload encoding, selected via the configure command */
+static mqtt_payload_format_t s_payload_format = MQTT_PAYLOAD_JSON;
+
 /******************************************************************************
  * INTERNAL HELPERS
  *****************************************************************************/
@@ -162,6 +189,17 @@ static void build_mac_fallback(void)
     ESP_LOGW(TAG, "Flash a serial number via NVS to assign a proper identity.");
 }
 
+/** @brief 32-bit FNV-1a hash of a NUL-terminated string. */
+static uint32_t fnv1a32(const char *str)
+{
+    uint32_t h = 0x811C9DC5u;
+    while (*str) {
+        h ^= (uint8_t)*str++;
+        h *= 0x01000193u;
+    }
+    return h;
+}
+
 /**
  * @brief Resolve the node identity and build client ID + topic strings.
  *
@@ -178,6 +216,16 @@ static void build_identity_strings(void)
     snprintf(s_client_id,    sizeof(s_client_id),    "%s_%s",        MQTT_TOPIC_PREFIX, s_serial_no);
     snprintf(s_topic_data,   sizeof(s_topic_data),   "%s/%s/data",   MQTT_TOPIC_PREFIX, s_serial_no);
     snprintf(s_topic_status, sizeof(s_topic_status), "%s/%s/status", MQTT_TOPIC_PREFIX, s_serial_no);
+    s_serial_hash = fnv1a32(s_serial_no);
+}
+
+static const char *payload_format_str(mqtt_payload_format_t format)
+{
+    switch (format) {
+        case MQTT_PAYLOAD_BINARY: return "bin";
+        case MQTT_PAYLOAD_PACKED: return "packed";
+        default:                  return "json";
+    }
 }
 
 /******************************************************************************
@@ -209,6 +257,7 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
                 fault_log_record(FAULT_MQTT_RECONNECTED);
             }
             s_is_connected = true;
+            store_forward_on_connected();
             if (s_mqtt_event_group) {
                 xEventGroupSetBits(s_mqtt_event_group, MQTT_CONNECTED_BIT);
                 xEventGroupClearBits(s_mqtt_event_group, MQTT_DISCONNECTED_BIT);
@@ -351,11 +400,9 @@ esp_err_t mqtt_init(void)
         return ESP_ERR_NO_MEM;
     }
 
-    s_json_buffer = malloc(JSON_BUFFER_SIZE);
-    if (s_json_buffer == NULL) {
-        ESP_LOGE(TAG, "Failed to allocate JSON buffer");
-        vEventGroupDelete(s_mqtt_event_group);
-        return ESP_ERR_NO_MEM;
+    if (s_status_lock == NULL) {
+        s_status_lock = xSemaphoreCreateMutexStatic(&s_status_lock_mem);
+        mem_budget_record("mqtt", MEM_REGION_STATIC, sizeof(s_status_buf));
     }
 
     esp_mqtt_client_config_t mqtt_cfg = {
@@ -372,7 +419,6 @@ esp_err_t mqtt_init(void)
     s_mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
     if (s_mqtt_client == NULL) {
         ESP_LOGE(TAG, "Failed to create MQTT client");
-        free(s_json_buffer);
         vEventGroupDelete(s_mqtt_event_group);
         return ESP_FAIL;
     }
@@ -382,7 +428,6 @@ esp_err_t mqtt_init(void)
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to register event handler");
         esp_mqtt_client_destroy(s_mqtt_client);
-        free(s_json_buffer);
         vEventGroupDelete(s_mqtt_event_group);
         return ret;
     }
@@ -391,7 +436,6 @@ esp_err_t mqtt_init(void)
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start MQTT client");
         esp_mqtt_client_destroy(s_mqtt_client);
-        free(s_json_buffer);
         vEventGroupDelete(s_mqtt_event_group);
         return ret;
     }
@@ -405,6 +449,11 @@ bool mqtt_is_connected(void)
     return s_is_connected;
 }
 
+int mqtt_get_outbox_size(void)
+{
+    return (s_mqtt_client != NULL) ? esp_mqtt_client_get_outbox_size(s_mqtt_client) : 0;
+}
+
 esp_err_t mqtt_wait_for_connection(uint32_t timeout_ms)
 {
     if (s_mqtt_event_group == NULL) {
@@ -419,155 +468,46 @@ esp_err_t mqtt_wait_for_connection(uint32_t timeout_ms)
     return (bits & MQTT_CONNECTED_BIT) ? ESP_OK : ESP_ERR_TIMEOUT;
 }
 
-esp_err_t mqtt_publish_sensor_data(const mqtt_sensor_packet_t *packet)
+esp_err_t mqtt_serialize_sensor_data(const mqtt_sensor_packet_t *packet,
+                                     char *buf, size_t cap, size_t *out_len)
 {
-    if (!s_is_connected) {
-        return ESP_ERR_INVALID_STATE;
-    }
-
-    if (packet == NULL || s_json_buffer == NULL) {
+    if (packet == NULL || buf == NULL || out_len == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    /*
-     * JSON FORMAT:
-     * {
-     *   "a": [["ts", x, y, z], ...],           200 samples or NaN array
-     *   "i": [["ts", x, y, z], ...],           20 samples or NaN array
-     *   "T": ["ts", val] | ["ts", NaN],         1 sample
-     *   "f": [1, 7]                             optional fault codes
-     * }
-     */
-
-    int offset = 0;
-
-    /* ---- Acceleration ---- */
-    offset += snprintf(s_json_buffer + offset, JSON_BUFFER_SIZE - offset, "{\"a\":[");
-
-    if (packet->accel_valid && packet->accel_count > 0) {
-        for (int i = 0; i < packet->accel_count && i < MQTT_ACCEL_BATCH_SIZE; i++) {
-            if (i > 0) {
-                offset += snprintf(s_json_buffer + offset, JSON_BUFFER_SIZE - offset, ",");
-            }
-            offset += snprintf(s_json_buffer + offset, JSON_BUFFER_SIZE - offset,
-                               "[\"%s\",%.4f,%.4f,%.4f]",
-                               packet->accel[i].ts,
-                               packet->accel[i].x,
-                               packet->accel[i].y,
-                               packet->accel[i].z);
-
-            if (offset >= JSON_BUFFER_SIZE - 200) {
-                ESP_LOGE(TAG, "JSON buffer overflow at accel sample %d!", i);
-                return ESP_ERR_NO_MEM;
-            }
-        }
-    } else {
-        /* Sensor disconnected: emit exactly MQTT_ACCEL_BATCH_SIZE (200) NaN entries
-         * so the Pi always receives a fixed-size 200 Hz acceleration array.
-         * Timestamps are spaced 5 ms apart (1/200 Hz) starting from now. */
-        struct timeval _tv_a; gettimeofday(&_tv_a, NULL);
-        for (int i = 0; i < MQTT_ACCEL_BATCH_SIZE; i++) {
-            if (i > 0) {
-                offset += snprintf(s_json_buffer + offset, JSON_BUFFER_SIZE - offset, ",");
-            }
-            char nan_ts_a[MQTT_TS_LEN];
-            if (_tv_a.tv_sec > 1700000000L) {
-                /* Compute timestamp for this sample: base + i * 5000 us */
-                int64_t sample_us = (int64_t)_tv_a.tv_sec * 1000000LL
-                                  + (int64_t)_tv_a.tv_usec
-                                  + (int64_t)i * 5000LL;
-                time_t sec = (time_t)(sample_us / 1000000LL);
-                int    us  = (int)(sample_us % 1000000LL);
-                struct tm _tm_a; gmtime_r(&sec, &_tm_a);
-                strftime(nan_ts_a, sizeof(nan_ts_a), "%Y-%m-%dT%H:%M:%S", &_tm_a);
-                snprintf(nan_ts_a + 19, sizeof(nan_ts_a) - 19, ".%06dZ", us);
-            } else {
-                snprintf(nan_ts_a, sizeof(nan_ts_a), "tick:disconnected");
-            }
-            offset += snprintf(s_json_buffer + offset, JSON_BUFFER_SIZE - offset,
-                               "[\"%s\",NaN,NaN,NaN]", nan_ts_a);
-
-            if (offset >= JSON_BUFFER_SIZE - 200) {
-                ESP_LOGE(TAG, "JSON buffer overflow at NaN accel sample %d!", i);
-                return ESP_ERR_NO_MEM;
-            }
-        }
+    *out_len = 0;
+    if (s_payload_format != MQTT_PAYLOAD_JSON) {
+        return sensor_payload_encode_binary(packet, s_payload_format == MQTT_PAYLOAD_PACKED,
+                                            s_serial_hash, buf, cap, out_len);
     }
+    return sensor_payload_encode_json(packet, buf, cap, out_len);
+}
 
-    offset += snprintf(s_json_buffer + offset, JSON_BUFFER_SIZE - offset, "]");
+esp_err_t mqtt_serialize_sensor_binary(const mqtt_sensor_packet_t *packet,
+                                       char *buf, size_t cap, size_t *out_len)
+{
+    if (packet == NULL || buf == NULL || out_len == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    /* ---- Inclination (batched, 20 samples/sec) ---- */
-    offset += snprintf(s_json_buffer + offset, JSON_BUFFER_SIZE - offset, ",\"i\":[");
+    *out_len = 0;
+    return sensor_payload_encode_binary(packet, s_payload_format == MQTT_PAYLOAD_PACKED,
+                                        s_serial_hash, buf, cap, out_len);
+}
 
-    if (packet->incl_valid && packet->incl_count > 0) {
-        for (int i = 0; i < packet->incl_count && i < MQTT_INCL_BATCH_SIZE; i++) {
-            if (i > 0) {
-                offset += snprintf(s_json_buffer + offset, JSON_BUFFER_SIZE - offset, ",");
-            }
-            offset += snprintf(s_json_buffer + offset, JSON_BUFFER_SIZE - offset,
-                               "[\"%s\",%.4f,%.4f,%.4f]",
-                               packet->incl[i].ts,
-                               packet->incl[i].x,
-                               packet->incl[i].y,
-                               packet->incl[i].z);
-        }
-    } else {
-        /* Sensor disconnected: emit exactly MQTT_INCL_BATCH_SIZE (20) NaN entries
-         * so the Pi always receives a fixed-size 20 Hz inclination array.
-         * Timestamps are spaced 50 ms apart (1/20 Hz) starting from now. */
-        struct timeval _tv_i; gettimeofday(&_tv_i, NULL);
-        for (int i = 0; i < MQTT_INCL_BATCH_SIZE; i++) {
-            if (i > 0) {
-                offset += snprintf(s_json_buffer + offset, JSON_BUFFER_SIZE - offset, ",");
-            }
-            char nan_ts_i[MQTT_TS_LEN];
-            if (_tv_i.tv_sec > 1700000000L) {
-                /* Compute timestamp for this sample: base + i * 50000 us */
-                int64_t sample_us = (int64_t)_tv_i.tv_sec * 1000000LL
-                                  + (int64_t)_tv_i.tv_usec
-                                  + (int64_t)i * 50000LL;
-                time_t sec = (time_t)(sample_us / 1000000LL);
-                int    us  = (int)(sample_us % 1000000LL);
-                struct tm _tm_i; gmtime_r(&sec, &_tm_i);
-                strftime(nan_ts_i, sizeof(nan_ts_i), "%Y-%m-%dT%H:%M:%S", &_tm_i);
-                snprintf(nan_ts_i + 19, sizeof(nan_ts_i) - 19, ".%06dZ", us);
-            } else {
-                snprintf(nan_ts_i, sizeof(nan_ts_i), "tick:disconnected");
-            }
-            offset += snprintf(s_json_buffer + offset, JSON_BUFFER_SIZE - offset,
-                               "[\"%s\",NaN,NaN,NaN]", nan_ts_i);
-        }
+esp_err_t mqtt_publish_sensor_payload(const char *payload, size_t len)
+{
+    if (!s_is_connected) {
+        return ESP_ERR_INVALID_STATE;
     }
 
-    offset += snprintf(s_json_buffer + offset, JSON_BUFFER_SIZE - offset, "]");
-
-    /* ---- Temperature (1 sample/sec) ---- */
-    if (packet->has_temp) {
-        if (packet->temp_valid) {
-            offset += snprintf(s_json_buffer + offset, JSON_BUFFER_SIZE - offset,
-                               ",\"T\":[\"%s\",%.2f]",
-                               packet->temp_ts, packet->temperature);
-        } else {
-            /* Sensor disconnected: emit NaN with current timestamp */
-            char nan_ts_t[MQTT_TS_LEN];
-            struct timeval _tv_t; gettimeofday(&_tv_t, NULL);
-            if (_tv_t.tv_sec > 1700000000L) {
-                struct tm _tm_t; gmtime_r(&_tv_t.tv_sec, &_tm_t);
-                strftime(nan_ts_t, sizeof(nan_ts_t), "%Y-%m-%dT%H:%M:%S", &_tm_t);
-                snprintf(nan_ts_t + 19, sizeof(nan_ts_t) - 19, ".%06dZ", (int)_tv_t.tv_usec);
-            } else {
-                snprintf(nan_ts_t, sizeof(nan_ts_t), "tick:disconnected");
-            }
-            offset += snprintf(s_json_buffer + offset, JSON_BUFFER_SIZE - offset,
-                               ",\"T\":[\"%s\",NaN]", nan_ts_t);
-        }
+    if (payload == NULL || len == 0) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-    offset += snprintf(s_json_buffer + offset, JSON_BUFFER_SIZE - offset, "}");
-
     // Publish to the serial-number-derived data topic
     int msg_id = esp_mqtt_client_publish(s_mqtt_client, s_topic_data,
-                                          s_json_buffer, offset,
+                                          payload, (int)len,
                                           MQTT_PUBLISH_QOS, 0);
 
     if (msg_id < 0) {
@@ -576,15 +516,50 @@ esp_err_t mqtt_publish_sensor_data(const mqtt_sensor_packet_t *packet)
         return ESP_FAIL;
     }
 
-    ESP_LOGD(TAG, "Published %d bytes to %s (accel=%d/%s, incl=%d/%s, temp=%s)",
-             offset, s_topic_data,
-             packet->accel_count, packet->accel_valid ? "ok" : "NaN",
-             packet->incl_count,  packet->incl_valid  ? "ok" : "NaN",
-             packet->temp_valid ? "ok" : "NaN");
+    ESP_LOGD(TAG, "Published %u bytes to %s", (unsigned)len, s_topic_data);
+    return ESP_OK;
+}
+
+esp_err_t mqtt_publish_sensor_data(const mqtt_sensor_packet_t *packet)
+{
+    if (!s_is_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (s_json_buffer == NULL) {
+        s_json_buffer = mem_budget_reserve("mqtt", JSON_BUFFER_SIZE, true);
+        if (s_json_buffer == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    size_t len = 0;
+    esp_err_t ret = mqtt_serialize_sensor_data(packet, s_json_buffer,
+                                               JSON_BUFFER_SIZE, &len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return mqtt_publish_sensor_payload(s_json_buffer, len);
+}
 
+esp_err_t mqtt_set_payload_format(mqtt_payload_format_t format)
+{
+    if (format != MQTT_PAYLOAD_JSON && format != MQTT_PAYLOAD_BINARY &&
+        format != MQTT_PAYLOAD_PACKED) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (format != s_payload_format) {
+        ESP_LOGI(TAG, "Data payload format -> %s", payload_format_str(format));
+    }
+    s_payload_format = format;
     return ESP_OK;
 }
 
+mqtt_payload_format_t mqtt_get_payload_format(void)
+{
+    return s_payload_format;
+}
+
 esp_err_t mqtt_publish_status(const char *status)
 {
     if (!s_is_connected || status == NULL) {
@@ -628,11 +603,6 @@ esp_err_t mqtt_deinit(void)
         s_mqtt_client = NULL;
     }
 
-    if (s_json_buffer != NULL) {
-        free(s_json_buffer);
-        s_json_buffer = NULL;
-    }
-
     if (s_mqtt_event_group != NULL) {
         vEventGroupDelete(s_mqtt_event_group);
         s_mqtt_event_group = NULL;
@@ -652,6 +622,11 @@ const char *mqtt_get_serial_no(void)
     return s_serial_no;
 }
 
+uint32_t mqtt_get_serial_hash(void)
+{
+    return s_serial_hash;
+}
+
 const char *mqtt_get_client_id(void)
 {
     return s_client_id;
@@ -726,48 +701,117 @@ esp_err_t mqtt_publish_status_json(const char *state_str,
         return ESP_ERR_INVALID_STATE;
     }
 
-    char buf[384];
+    if (s_status_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_status_lock, portMAX_DELAY);
+
+    char *buf = s_status_buf;
     int offset = 0;
     int range_g = (range == 1) ? 2 : (range == 2) ? 4 : 8;
 
-    offset += snprintf(buf + offset, sizeof(buf) - offset,
+    offset += snprintf(buf + offset, STATUS_JSON_SIZE - offset,
                        "{\"state\":\"%s\"",
                        state_str ? state_str : "unknown");
 
     /* cmd_ack is only present for control command acknowledgements */
     if (cmd_ack && cmd_ack[0] != '\0') {
-        offset += snprintf(buf + offset, sizeof(buf) - offset,
+        offset += snprintf(buf + offset, STATUS_JSON_SIZE - offset,
                            ",\"cmd_ack\":\"%s\"", cmd_ack);
     }
 
-    offset += snprintf(buf + offset, sizeof(buf) - offset,
+    offset += snprintf(buf + offset, STATUS_JSON_SIZE - offset,
                        ",\"seq_ack\":%lu"
                        ",\"odr_hz\":%lu"
                        ",\"range_g\":%d"
                        ",\"hpf_corner\":%u"
                        ",\"output_hz\":%lu"
-                       ",\"selftest_ok\":%s",
+                       ",\"selftest_ok\":%s"
+                       ",\"format\":\"%s\""
+                       ",\"spectrum\":\"%s\""
+                       ",\"trigger\":\"%s\""
+                       ",\"trigger_level\":%ld"
+                       ",\"metrics_s\":%lu"
+                       ",\"flow\":\"%s\""
+                       ",\"flow_auto\":%s"
+                       ",\"batch_s\":%lu"
+                       ",\"batch_max_ms\":%lu"
+                       ",\"transport\":\"%s\"",
                        (unsigned long)seq_ack,
                        (unsigned long)odr_hz,
                        range_g,
                        (unsigned)hpf_corner,
                        (unsigned long)output_hz,
-                       selftest_ok ? "true" : "false");
+                       selftest_ok ? "true" : "false",
+                       payload_format_str(s_payload_format),
+                       spectrum_mode_str(spectrum_get_mode()),
+                       event_capture_mode_str(event_capture_get_mode()),
+                       (long)event_capture_get_level(),
+                       (unsigned long)metrics_get_interval_s(),
+                       flow_control_level_str(flow_control_get_level()),
+                       flow_control_get_auto() ? "true" : "false",
+                       (unsigned long)flow_control_get_batch(),
+                       (unsigned long)flow_control_get_batch_max_ms(),
+                       udp_stream_raw_enabled() ? "udp_raw" :
+                       udp_stream_is_enabled()  ? "udp" : "mqtt");
+
+    clock_discipline_stats_t clk;
+    clock_discipline_get_stats(&clk);
+    offset += snprintf(buf + offset, STATUS_JSON_SIZE - offset,
+                       ",\"clock\":{\"synced\":%s,\"err_us\":%lu,\"drift_ppb\":%ld,\"n\":%lu}",
+                       clk.synced ? "true" : "false", (unsigned long)clk.err_us,
+                       (long)clk.drift_ppb, (unsigned long)clk.points);
+
+    offset += snprintf(buf + offset, STATUS_JSON_SIZE - offset,
+                       ",\"cfg_epoch\":%lu",
+                       (unsigned long)(node_config_get()->epoch & 0xFFu));
+
+    if (udp_stream_is_enabled()) {
+        udp_stream_stats_t us;
+        udp_stream_get_stats(&us);
+        offset += snprintf(buf + offset, STATUS_JSON_SIZE - offset,
+                           ",\"udp\":{\"group\":\"%s\",\"port\":%u,\"open\":%s}",
+                           UDP_STREAM_GROUP, (unsigned)us.port, us.open ? "true" : "false");
+    }
+
+    sync_start_info_t ss;
+    sync_start_get_info(&ss);
+    if (ss.state != SYNC_START_IDLE) {
+        offset += snprintf(buf + offset, STATUS_JSON_SIZE - offset,
+                           ",\"sync_start\":{\"state\":\"%s\",\"epoch_us\":%lld,\"offset_us\":%ld}",
+                           sync_start_state_str(ss.state), (long long)ss.epoch_us,
+                           (long)ss.offset_us);
+    }
+
+    /* Phase timings and the memory map ride on the first status after
+     * boot (boot_seq.h, mem_budget.h) */
+    int boot_len = boot_seq_format_status(buf + offset, STATUS_JSON_SIZE - offset);
+    offset += boot_len;
+    int mem_len = mem_budget_format_status(buf + offset, STATUS_JSON_SIZE - offset);
+    offset += mem_len;
 
     if (error_msg && error_msg[0] != '\0') {
-        offset += snprintf(buf + offset, sizeof(buf) - offset,
+        offset += snprintf(buf + offset, STATUS_JSON_SIZE - offset,
                            ",\"error\":\"%s\"", error_msg);
     }
 
-    offset += snprintf(buf + offset, sizeof(buf) - offset, "}");
+    offset += snprintf(buf + offset, STATUS_JSON_SIZE - offset, "}");
 
     int msg_id = esp_mqtt_client_publish(s_mqtt_client, s_topic_status,
                                          buf, offset, MQTT_PUBLISH_QOS, 0);
     if (msg_id < 0) {
+        xSemaphoreGive(s_status_lock);
         ESP_LOGE(TAG, "Failed to publish status JSON");
         return ESP_FAIL;
     }
+    if (boot_len > 0) {
+        boot_seq_status_sent();
+    }
+    if (mem_len > 0) {
+        mem_budget_status_sent();
+    }
 
     ESP_LOGI(TAG, "Status -> %s: %s", s_topic_status, buf);
+    xSemaphoreGive(s_status_lock);
     return ESP_OK;
 }
\ No newline at end of file
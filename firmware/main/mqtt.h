@@ -68,6 +68,9 @@
 #include "esp_netif.h"   // esp_netif_t — needed for mqtt_mdns_init
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "packet_time.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -108,45 +111,229 @@ extern "C" {
 
 #define MQTT_TOPIC_PREFIX       "wind_turbine"
 
-/* ISO-8601 timestamp buffer. Sized to 40 so -Werror=format-truncation is
- * satisfied by the two-step strftime+snprintf approach in format_ts(). */
+/* ISO-8601 timestamp buffer. At least TS_ISO_MIN_LEN (packet_time.h); the
+ * extra headroom is kept so existing snprintf users stay truncation-clean. */
 #define MQTT_TS_LEN  40
 
+/* Largest encoded data payload:
+ * 200 accel samples x ~60 chars + 20 incl samples x ~60 chars + temperature + framing = ~15400 chars.
+ * The binary frame (2656 bytes at most) always fits. */
+#define MQTT_DATA_PAYLOAD_MAX   20480
+
+/*
+ * DATA PAYLOAD FORMAT
+ *
+ * The data topic carries either the JSON document described in
+ * mqtt_publish_sensor_data() (default) or a compact little-endian binary
+ * frame. The format is selected per node with the "format" key of the
+ * configure command ("json" / "bin" / "packed") and echoed in every status
+ * ACK. "packed" sends version 2 frames, described after version 1.
+ *
+ * Binary frame, version 1 (all fields little-endian, no padding):
+ *
+ *   off  size  field
+ *     0   u8   magic            MQTT_BIN_MAGIC (never a valid first JSON byte)
+ *     1   u8   version          MQTT_BIN_VERSION
+ *     2   u8   flags            MQTT_BIN_FLAG_*
+ *     3   u8   range            1=±2g, 2=±4g, 3=±8g (selects LSB/g)
+ *     4   u32  serial_hash      FNV-1a of the serial number string
+ *     8   u32  seq              packet sequence, see below
+ *    12   u32  base_tick        125 us acquisition tick of accel sample 0
+ *    16   i64  base_utc_us      UTC of base_tick in us, 0 = clock not synced
+ *    24   u16  odr_hz           ADXL355 ODR before decimation
+ *    26   u8   decim            raw samples per output sample
+ *    27   u8   accel_count      output samples that follow (0 = NaN block)
+ *    28   u16  accel_period     ticks between consecutive accel samples
+ *    30   u8   incl_count       inclination samples that follow
+ *    31   u8   cfg_epoch        low byte of the node config epoch; changes
+ *                            where the acquisition parameters changed
+ *    32        accel_count x { i32 x, i32 y, i32 z }      raw 20-bit counts,
+ *                            INT32_MIN on all axes = a gap in the stream (NaN)
+ *              incl_count  x { i16 dtick, i16 x, i16 y, i16 z }
+ *                            dtick relative to base_tick, angles raw LSB
+ *              if HAS_TEMP:    { i32 dtick, i16 centi_degc }
+ *              if SEND_TS:     { i64 send_utc_us }
+ *              if SUMMARY:     { u8 real, u8 nan, i32 min[3], i32 max[3],
+ *                                i32 mean[3], u32 rms[3] }      raw counts
+ *              if GAPS:        { u8 n, n x { u8 sensor, u8 reason,
+ *                                i32 dtick, u32 dur_us } }      see below
+ *
+ * A full 200-sample packet is 2656 bytes against ~15 KB of JSON; a second
+ * with both sensors offline is 117 bytes of binary or ~250 of JSON.
+ *
+ * Every data packet also carries a per-axis summary of its accel samples
+ * (JSON "s", binary SUMMARY trailer), accumulated by the build stage as it
+ * places samples on the grid: min, max, mean and RMS over the real samples,
+ * and the number of real and NaN samples (gaps, or all 200 when the sensor
+ * is disconnected). Overview plots and health checks on the Pi read the
+ * summary instead of scanning the samples.
+ *
+ * A sensor with nothing to send (disconnected, or no samples this second)
+ * is one gap entry, not an array of NaN rows: JSON "g":[["ts", dur_us,
+ * "a"|"i", "disconnected"|"no_samples"], ...] with that sensor's array
+ * empty, binary a GAPS trailer with a zero count. The gap starts at the
+ * packet's base tick and spans one packet (MQTT_GAP_PACKET_US).
+ *
+ * Every data packet, JSON ("seq", "st") or binary, carries
+ *   - seq:         per-node packet sequence, +1 per second of data the
+ *                  build stage completed since boot. A packet dropped on the
+ *                  node (pipeline full, MQTT down without a log) still uses
+ *                  its number, so any gap the Pi sees is a lost second,
+ *                  wherever it was lost. Replayed frames keep their seq.
+ *   - send_utc_us: UTC when the serialize stage encoded the packet, which
+ *                  is the start of the send path. Omitted when the clock is
+ *                  not synced.
+ *
+ * Binary frame, version 2 ("packed"): the same 32-byte header with version
+ * MQTT_BIN_VERSION_PACKED, then the accel block is replaced by
+ *
+ *    32   u16  accel_bytes      length of the packed block (0 if accel_count is 0)
+ *    34        accel_bytes of accel_pack.h encoding (lossless)
+ *              incl and temp exactly as in version 1
+ *
+ * A 200-sample packet with ~100-count sample noise packs to ~1350 bytes,
+ * about half of version 1; quieter signals pack smaller still. Version
+ * 2 also applies to the frames written to the store-and-forward log and to
+ * batched messages (flow_control.h) while "packed" is selected.
+ */
+typedef enum {
+    MQTT_PAYLOAD_JSON   = 0,
+    MQTT_PAYLOAD_BINARY = 1,
+    MQTT_PAYLOAD_PACKED = 2,
+} mqtt_payload_format_t;
+
+#define MQTT_BIN_MAGIC              0xB5
+#define MQTT_BIN_VERSION            1
+#define MQTT_BIN_VERSION_PACKED     2
+#define MQTT_BIN_HEADER_LEN         32
+#define MQTT_BIN_SUMMARY_LEN        50
+#define MQTT_BIN_GAP_LEN            10     /**< per entry, after a u8 count        */
+
+#define MQTT_BIN_FLAG_ACCEL_VALID   0x01
+#define MQTT_BIN_FLAG_INCL_VALID    0x02
+#define MQTT_BIN_FLAG_HAS_TEMP      0x04
+#define MQTT_BIN_FLAG_TEMP_VALID    0x08
+#define MQTT_BIN_FLAG_REPLAYED      0x10   /**< Stored while offline, sent late (store_forward.h) */
+#define MQTT_BIN_FLAG_SEND_TS       0x20   /**< i64 send_utc_us trailer present                   */
+#define MQTT_BIN_FLAG_SUMMARY       0x40   /**< accel summary trailer present                     */
+#define MQTT_BIN_FLAG_GAPS          0x80   /**< sensor gap list trailer present                   */
+
 /******************************************************************************
  * DATA STRUCTURES
  *****************************************************************************/
 
-typedef struct {
-    char  ts[MQTT_TS_LEN];
-    float x;
-    float y;
-    float z;
-} mqtt_accel_sample_t;
+/*
+ * Sensor data packet, struct-of-arrays. The build stage decimates straight
+ * into the per-axis accel arrays of a pipeline slot (publish_pipeline.h).
+ * Accel sample i is at base_tick + i * accel_period_ticks; a stream gap is
+ * padded with invalid samples (bit clear in accel_map, value
+ * MQTT_ACCEL_INVALID) so the grid always holds. Timestamps are rendered from
+ * anchor + tick by the JSON encoder, directly into the payload buffer.
+ */
+#define MQTT_ACCEL_MAP_WORDS    ((MQTT_ACCEL_BATCH_SIZE + 31) / 32)
+#define MQTT_ACCEL_INVALID      INT32_MIN   /**< Never a 20-bit ADXL355 count */
+
+/* Sensor outage, carried instead of rows of NaN samples (see above) */
+#define MQTT_MAX_GAPS           2
+#define MQTT_GAP_PACKET_US      1000000u
+
+typedef enum {
+    MQTT_GAP_SENSOR_ACCEL = 0,
+    MQTT_GAP_SENSOR_INCL  = 1,
+} mqtt_gap_sensor_t;
+
+typedef enum {
+    MQTT_GAP_DISCONNECTED = 1,      /**< Watchdog / recovery has the sensor offline */
+    MQTT_GAP_NO_SAMPLES   = 2,      /**< Connected, but nothing arrived this packet */
+} mqtt_gap_reason_t;
 
 typedef struct {
-    char  ts[MQTT_TS_LEN];
-    float x;
-    float y;
-    float z;
-} mqtt_incl_sample_t;
+    uint8_t  sensor;                /**< mqtt_gap_sensor_t */
+    uint8_t  reason;                /**< mqtt_gap_reason_t */
+    uint32_t start_tick;
+    uint32_t dur_us;
+} mqtt_gap_t;
+
+/* Per-axis statistics of one packet's accel samples, in raw counts. The
+ * build stage adds every real sample (mqtt_accel_summary_add());
+ * mqtt_accel_summary_finish() derives mean and RMS before the hand-off. */
+typedef struct {
+    bool     valid;             /**< false = not computed, not encoded     */
+    uint16_t real;              /**< samples in the statistics             */
+    uint16_t nan;               /**< gap / NaN samples in the packet       */
+    int32_t  min[3];
+    int32_t  max[3];
+    int32_t  mean[3];
+    uint32_t rms[3];
+    int64_t  sum[3];            /* accumulators, build stage only */
+    uint64_t sum_sq[3];
+} mqtt_accel_summary_t;
 
-/* Sensor data packet — every field carries its own timestamp */
 typedef struct {
-    mqtt_accel_sample_t accel[MQTT_ACCEL_BATCH_SIZE];
+    int32_t  accel[3][MQTT_ACCEL_BATCH_SIZE];   /**< decimated ADXL355 counts, x/y/z */
+    uint32_t accel_map[MQTT_ACCEL_MAP_WORDS];   /**< bit i set = sample i is real    */
     int  accel_count;
-    bool accel_valid;       /**< false = sensor disconnected, emit NaN array */
+    bool accel_valid;       /**< false = sensor disconnected, sent as a gap  */
+    mqtt_accel_summary_t accel_sum;
 
-    mqtt_incl_sample_t incl[MQTT_INCL_BATCH_SIZE];
+    int16_t  incl[3][MQTT_INCL_BATCH_SIZE];     /**< SCL3300 angle LSB, x/y/z */
+    uint32_t incl_tick[MQTT_INCL_BATCH_SIZE];   /**< 20 Hz, not on the accel grid */
     int  incl_count;        /**< number of valid incl samples in this packet */
-    bool incl_valid;        /**< false = sensor disconnected, emit NaN array */
+    bool incl_valid;        /**< false = no samples, sent as a gap           */
+
+    mqtt_gap_t gaps[MQTT_MAX_GAPS];             /**< one per sensor with no data */
+    uint8_t    gap_count;
+
+    bool     has_temp;
+    bool     temp_valid;
+    float    temperature;
+    uint32_t temp_tick;
+
+    /* One tick -> UTC anchor per packet: every timestamp, JSON or binary,
+     * is derived from it. */
+    ts_anchor_t anchor;
 
-    bool  has_temp;
-    bool  temp_valid;
-    char  temp_ts[MQTT_TS_LEN];
-    float temperature;
+    uint32_t accel_lsb_per_g;   /**< ADXL355 LSB/g for range  */
+    uint32_t base_tick;         /**< tick of accel sample 0, or publish tick if accel invalid */
+    int64_t  base_utc_us;       /**< UTC of base_tick in us, 0 if not synced           */
+    uint32_t odr_hz;
+    uint8_t  decim;
+    uint8_t  range;
+    uint8_t  cfg_epoch;         /**< low byte of node_runtime_config_t.epoch */
+    uint16_t accel_period_ticks;
+
+    uint32_t seq;               /**< per-node packet sequence, set by the build stage */
+    int64_t  send_utc_us;       /**< set by the serialize stage, 0 = not synced / omit */
 
 } mqtt_sensor_packet_t;
 
+static inline bool mqtt_accel_sample_real(const mqtt_sensor_packet_t *packet, int i)
+{
+    return (packet->accel_map[i >> 5] >> (i & 31)) & 1u;
+}
+
+static inline void mqtt_accel_summary_reset(mqtt_accel_summary_t *s)
+{
+    memset(s, 0, sizeof(*s));
+    for (int a = 0; a < 3; a++) {
+        s->min[a] = INT32_MAX;
+        s->max[a] = INT32_MIN;
+    }
+}
+
+/** @brief Add one real sample (x, y, z counts) to the summary. */
+static inline void mqtt_accel_summary_add(mqtt_accel_summary_t *s, const int32_t xyz[3])
+{
+    for (int a = 0; a < 3; a++) {
+        int32_t v = xyz[a];
+        if (v < s->min[a]) s->min[a] = v;
+        if (v > s->max[a]) s->max[a] = v;
+        s->sum[a]    += v;
+        s->sum_sq[a] += (uint64_t)((int64_t)v * v);
+    }
+    s->real++;
+}
+
 /******************************************************************************
  * PUBLIC FUNCTIONS
  *****************************************************************************/
@@ -182,6 +369,12 @@ esp_err_t mqtt_init(void);
 /** @brief Returns true if the client is currently connected to the broker. */
 bool mqtt_is_connected(void);
 
+/**
+ * @brief Bytes currently held in the esp-mqtt outbox (QoS 1 messages not yet
+ *        acknowledged). 0 before mqtt_init().
+ */
+int mqtt_get_outbox_size(void);
+
 /**
  * @brief Block until connected to the broker (or timeout).
  * @param timeout_ms Maximum wait time in milliseconds.
@@ -189,9 +382,67 @@ bool mqtt_is_connected(void);
  */
 esp_err_t mqtt_wait_for_connection(uint32_t timeout_ms);
 
-/** @brief Publish a structured sensor data packet. */
+/**
+ * @brief Close a packet's accel summary: mean and RMS from the sums.
+ *
+ * @param nan  NaN samples in the packet (grid gaps, or all of them for a
+ *             disconnected sensor)
+ */
+void mqtt_accel_summary_finish(mqtt_accel_summary_t *s, uint16_t nan);
+
+/**
+ * @brief Encode a sensor packet in the selected payload format.
+ *
+ * Pure CPU work: never touches the network, so it can run on a different
+ * task from mqtt_publish_sensor_payload(). In binary mode every successful
+ * call consumes one frame sequence number.
+ *
+ * @param buf      Destination, MQTT_DATA_PAYLOAD_MAX bytes is always enough
+ * @param cap      Size of buf
+ * @param out_len  Encoded length on success
+ * @return ESP_ERR_NO_MEM if the payload does not fit in cap.
+ */
+esp_err_t mqtt_serialize_sensor_data(const mqtt_sensor_packet_t *packet,
+                                     char *buf, size_t cap, size_t *out_len);
+
+/**
+ * @brief Encode a sensor packet as a binary frame regardless of the selected format.
+ *
+ * Used for packets headed for the store-and-forward log, which only holds
+ * binary frames. Takes a sequence number like mqtt_serialize_sensor_data().
+ */
+esp_err_t mqtt_serialize_sensor_binary(const mqtt_sensor_packet_t *packet,
+                                       char *buf, size_t cap, size_t *out_len);
+
+/**
+ * @brief Publish an already encoded payload to the data topic.
+ * @return ESP_ERR_INVALID_STATE when not connected, ESP_FAIL if the client
+ *         rejected the message.
+ */
+esp_err_t mqtt_publish_sensor_payload(const char *payload, size_t len);
+
+/**
+ * @brief Encode and publish a sensor packet in one call.
+ *
+ * Convenience wrapper around mqtt_serialize_sensor_data() and
+ * mqtt_publish_sensor_payload() using an internal scratch buffer. The data
+ * task uses the publish pipeline (publish_pipeline.h) instead.
+ */
 esp_err_t mqtt_publish_sensor_data(const mqtt_sensor_packet_t *packet);
 
+/**
+ * @brief Select the data topic payload encoding.
+ *
+ * Takes effect from the next mqtt_serialize_sensor_data() call. The format is
+ * not persisted; every boot starts with MQTT_PAYLOAD_JSON.
+ *
+ * @return ESP_ERR_INVALID_ARG for an unknown format.
+ */
+esp_err_t mqtt_set_payload_format(mqtt_payload_format_t format);
+
+/** @brief Return the active data topic payload encoding. */
+mqtt_payload_format_t mqtt_get_payload_format(void);
+
 /** @brief Publish a plain-text status string to the status topic. */
 esp_err_t mqtt_publish_status(const char *status);
 
@@ -240,6 +491,9 @@ void mqtt_set_cmd_handler(mqtt_cmd_handler_t handler);
  *   {"state":"recording","cmd_ack":"start","seq_ack":101,"odr_hz":1000,
  *    "range_g":2,"hpf_corner":0,"output_hz":200,"selftest_ok":true}
  *
+ * Every ACK also carries "format":"json"|"bin"|"packed" (the active payload format).
+ * The first status after boot also carries the boot memory map ("mem", mem_budget.h).
+ *
  * @param cmd_ack  If non-NULL, emitted as "cmd_ack":"<value>" (for control ACKs).
  *                 Pass NULL for configure ACKs.
  */
@@ -260,6 +514,9 @@ esp_err_t mqtt_publish_status_json(const char *state_str,
  */
 const char *mqtt_get_serial_no(void);
 
+/** @brief FNV-1a hash of the serial number, as in the binary frame header. */
+uint32_t mqtt_get_serial_hash(void);
+
 /**
  * @brief Return the generated client ID string.
  *        e.g. "wind_turbine_WT01-N03"
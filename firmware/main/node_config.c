@@ -9,6 +9,7 @@
 #include "fault_log.h"
 
 #include "esp_log.h"
+#include "esp_rom_sys.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -45,7 +46,14 @@ static const adxl355_odr_config_t s_odr_table[NODE_CONFIG_ODR_COUNT] = {
  * ---------------------------------------------------------------------- */
 
 static node_state_t       s_state  = NODE_STATE_IDLE;
-static node_runtime_config_t s_cfg = {0};
+
+/* Double-buffered runtime config: s_cfg_buf[s_active] is published, the
+ * other one is staged into. The flip happens under s_cfg_lock so the staged
+ * fields are visible before the index on the other core. */
+static node_runtime_config_t s_cfg_buf[2];
+static volatile uint32_t     s_active       = 0;
+static volatile uint32_t     s_epoch_in_use = 0;
+static portMUX_TYPE          s_cfg_lock     = portMUX_INITIALIZER_UNLOCKED;
 
 /* Sensitivity lookup per range code */
 static float sensitivity_for_range(uint8_t range)
@@ -58,6 +66,83 @@ static float sensitivity_for_range(uint8_t range)
     }
 }
 
+static node_runtime_config_t *staging_buffer(void)
+{
+    return &s_cfg_buf[s_active ^ 1u];
+}
+
+static void publish_staged(void)
+{
+    portENTER_CRITICAL(&s_cfg_lock);
+    s_active ^= 1u;
+    portEXIT_CRITICAL(&s_cfg_lock);
+}
+
+/**
+ * @brief Write FILTER and the RANGE bits, then read both back.
+ *
+ * The ADXL355 must be in standby. Does not touch s_state.
+ */
+static esp_err_t write_filter_and_range(uint8_t filter_val, uint8_t range)
+{
+    esp_err_t err = adxl355_write_reg_pub(ADXL355_REG_FILTER, filter_val);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write FILTER reg: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    /* Preserve the upper RANGE bits (interrupt polarity, I2C speed) */
+    uint8_t range_reg = 0;
+    err = adxl355_read_reg_pub(ADXL355_REG_RANGE, &range_reg, 1);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read RANGE reg: %s", esp_err_to_name(err));
+        return err;
+    }
+    range_reg = (uint8_t)((range_reg & ~0x03u) | (range & 0x03u));
+    err = adxl355_write_reg_pub(ADXL355_REG_RANGE, range_reg);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write RANGE reg: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    uint8_t rb_filter = 0, rb_range = 0;
+    adxl355_read_reg_pub(ADXL355_REG_FILTER, &rb_filter, 1);
+    adxl355_read_reg_pub(ADXL355_REG_RANGE,  &rb_range,  1);
+
+    if (rb_filter != filter_val) {
+        ESP_LOGE(TAG, "FILTER readback mismatch: wrote 0x%02X read 0x%02X",
+                 filter_val, rb_filter);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if ((rb_range & 0x03u) != (range & 0x03u)) {
+        ESP_LOGE(TAG, "RANGE readback mismatch: wrote 0x%02X read 0x%02X",
+                 range, rb_range);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    ESP_LOGI(TAG, "Register readback OK (FILTER=0x%02X RANGE=0x%02X)",
+             rb_filter, rb_range);
+    return ESP_OK;
+}
+
+/**
+ * @brief Block until just after the next SCL3300 read.
+ *
+ * The SCL3300 is read at 20 Hz, so the following ~50 ms of the shared SPI
+ * bus belong to ADXL355 reads alone. Gives up after NODE_CONFIG_QUIET_WAIT_MS
+ * (SCL3300 absent), which at worst delays one SCL3300 read by a transaction.
+ */
+static void wait_for_quiet_slot(void)
+{
+    uint32_t   start = scl3300_get_sample_count();
+    TickType_t t0    = xTaskGetTickCount();
+    while ((xTaskGetTickCount() - t0) < pdMS_TO_TICKS(NODE_CONFIG_QUIET_WAIT_MS)) {
+        if (scl3300_get_sample_count() != start) {
+            return;
+        }
+        vTaskDelay(1);
+    }
+}
+
 /* -------------------------------------------------------------------------
  * Public API
  * ---------------------------------------------------------------------- */
@@ -88,15 +173,19 @@ void node_config_init(void)
 
     /* Default: odr_index=2 (1000 Hz), ±2g, HPF off */
     const adxl355_odr_config_t *odr = &s_odr_table[2];
-    s_cfg.odr_index         = 2;
-    s_cfg.range             = NODE_RANGE_2G;
-    s_cfg.hpf_corner        = 0;
-    s_cfg.seq               = 0;
-    s_cfg.isr_tick_divisor  = odr->isr_tick_divisor;
-    s_cfg.decim_factor      = odr->decim_factor;
-    s_cfg.batch_size        = odr->batch_size;
-    s_cfg.sensitivity_lsb_g = sensitivity_for_range(NODE_RANGE_2G);
-    s_cfg.odr_hz            = odr->odr_hz;
+    node_runtime_config_t *cfg = &s_cfg_buf[0];
+    memset(s_cfg_buf, 0, sizeof(s_cfg_buf));
+    cfg->odr_index         = 2;
+    cfg->range             = NODE_RANGE_2G;
+    cfg->hpf_corner        = 0;
+    cfg->seq               = 0;
+    cfg->isr_tick_divisor  = odr->isr_tick_divisor;
+    cfg->decim_factor      = odr->decim_factor;
+    cfg->batch_size        = odr->batch_size;
+    cfg->sensitivity_lsb_g = sensitivity_for_range(NODE_RANGE_2G);
+    cfg->odr_hz            = odr->odr_hz;
+    s_active       = 0;
+    s_epoch_in_use = 0;
 
     ESP_LOGI(TAG, "Node config initialised (state=IDLE, default ODR=1000Hz, range=±2g)");
 }
@@ -108,7 +197,12 @@ node_state_t node_config_get_state(void)
 
 const node_runtime_config_t *node_config_get(void)
 {
-    return &s_cfg;
+    return &s_cfg_buf[s_active];
+}
+
+void node_config_note_in_use(uint32_t epoch)
+{
+    s_epoch_in_use = epoch;
 }
 
 esp_err_t node_config_apply(uint8_t odr_index, uint8_t range,
@@ -161,56 +255,15 @@ esp_err_t node_config_apply(uint8_t odr_index, uint8_t range,
     }
     vTaskDelay(pdMS_TO_TICKS(5));
 
-    /* --- Step 2: Write Filter register (ODR_LPF + HPF_CORNER) --- */
+    /* --- Steps 2-4: FILTER (ODR_LPF + HPF_CORNER), RANGE, read-back --- */
     uint8_t filter_val = (uint8_t)((hpf_corner << 4) | odr->filter_reg);
-    err = adxl355_write_reg_pub(ADXL355_REG_FILTER, filter_val);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to write FILTER reg: %s", esp_err_to_name(err));
-        s_state = NODE_STATE_ERROR;
-        fault_log_record(FAULT_SPI_ERROR);
-        return err;
-    }
-
-    /* --- Step 3: Write Range register (preserve upper bits) --- */
-    uint8_t range_reg = 0;
-    err = adxl355_read_reg_pub(ADXL355_REG_RANGE, &range_reg, 1);
+    err = write_filter_and_range(filter_val, range);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to read RANGE reg: %s", esp_err_to_name(err));
-        s_state = NODE_STATE_ERROR;
-        fault_log_record(FAULT_SPI_ERROR);
-        return err;
-    }
-    range_reg = (uint8_t)((range_reg & ~0x03u) | (range & 0x03u));
-    err = adxl355_write_reg_pub(ADXL355_REG_RANGE, range_reg);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to write RANGE reg: %s", esp_err_to_name(err));
         s_state = NODE_STATE_ERROR;
         fault_log_record(FAULT_SPI_ERROR);
         return err;
     }
 
-    /* --- Step 4: Read-back verification --- */
-    uint8_t rb_filter = 0, rb_range = 0;
-    adxl355_read_reg_pub(ADXL355_REG_FILTER, &rb_filter, 1);
-    adxl355_read_reg_pub(ADXL355_REG_RANGE,  &rb_range,  1);
-
-    if (rb_filter != filter_val) {
-        ESP_LOGE(TAG, "FILTER readback mismatch: wrote 0x%02X read 0x%02X",
-                 filter_val, rb_filter);
-        s_state = NODE_STATE_ERROR;
-        fault_log_record(FAULT_SPI_ERROR);
-        return ESP_ERR_INVALID_RESPONSE;
-    }
-    if ((rb_range & 0x03u) != (range & 0x03u)) {
-        ESP_LOGE(TAG, "RANGE readback mismatch: wrote 0x%02X read 0x%02X",
-                 range, rb_range);
-        s_state = NODE_STATE_ERROR;
-        fault_log_record(FAULT_SPI_ERROR);
-        return ESP_ERR_INVALID_RESPONSE;
-    }
-    ESP_LOGI(TAG, "Register readback OK (FILTER=0x%02X RANGE=0x%02X)",
-             rb_filter, rb_range);
-
     /* --- Step 5: Return to measurement mode --- */
     err = adxl355_write_reg_pub(ADXL355_REG_POWER_CTL, 0x00);
     if (err != ESP_OK) {
@@ -222,8 +275,8 @@ esp_err_t node_config_apply(uint8_t odr_index, uint8_t range,
     vTaskDelay(pdMS_TO_TICKS(5));
 
     /* --- Step 6: Optional self-test ---
-     * Must use the NEW range's sensitivity, not the old s_cfg value which
-     * hasn't been updated yet (that happens in Step 7). Pass it explicitly. */
+     * Must use the NEW range's sensitivity, not the published value which
+     * hasn't been updated yet (that happens in Step 8). Pass it explicitly. */
     if (result != NULL) {
         float new_sensitivity = sensitivity_for_range(range);
         esp_err_t st_err = node_config_run_selftest_with_sensitivity(result, new_sensitivity);
@@ -234,26 +287,123 @@ esp_err_t node_config_apply(uint8_t odr_index, uint8_t range,
         }
     }
 
-    /* --- Step 7: Update runtime config atomically --- */
-    s_cfg.odr_index         = odr_index;
-    s_cfg.range             = range;
-    s_cfg.hpf_corner        = hpf_corner;
-    s_cfg.seq               = seq;
-    s_cfg.isr_tick_divisor  = odr->isr_tick_divisor;
-    s_cfg.decim_factor      = odr->decim_factor;
-    s_cfg.batch_size        = odr->batch_size;
-    s_cfg.sensitivity_lsb_g = sensitivity_for_range(range);
-    s_cfg.odr_hz            = odr->odr_hz;
+    /* --- Step 7: Point the ISR slot schedule at the new ODR ---
+     * The ISR is stopped here (it only runs while RECORDING, and that case
+     * stopped it above), which sensor_acquisition_set_adxl355_divisor() requires. */
+    err = sensor_acquisition_set_adxl355_divisor(odr->isr_tick_divisor);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set ISR schedule: %s", esp_err_to_name(err));
+        s_state = NODE_STATE_ERROR;
+        return err;
+    }
+
+    /* --- Step 8: Stage and publish the runtime config ---
+     * The ISR is stopped and the rings flushed, so the data task drops its
+     * batch on the epoch change instead of switching at a tick. */
+    const node_runtime_config_t *cur = node_config_get();
+    node_runtime_config_t *next = staging_buffer();
+    next->odr_index         = odr_index;
+    next->range             = range;
+    next->hpf_corner        = hpf_corner;
+    next->seq               = seq;
+    next->isr_tick_divisor  = odr->isr_tick_divisor;
+    next->decim_factor      = odr->decim_factor;
+    next->batch_size        = odr->batch_size;
+    next->sensitivity_lsb_g = sensitivity_for_range(range);
+    next->odr_hz            = odr->odr_hz;
+    next->epoch             = cur->epoch + 1;
+    next->epoch_tick        = 0;
+    next->live              = false;
+    publish_staged();
 
     /* Transition to CONFIGURED. Caller decides whether to restart ISR. */
     s_state = NODE_STATE_CONFIGURED;
 
-    ESP_LOGI(TAG, "Config applied: ODR=%lu Hz decim=%lu batch=%lu sens=%.0f LSB/g",
-             (unsigned long)s_cfg.odr_hz,
-             (unsigned long)s_cfg.decim_factor,
-             (unsigned long)s_cfg.batch_size,
-             s_cfg.sensitivity_lsb_g);
+    ESP_LOGI(TAG, "Config applied: ODR=%lu Hz decim=%lu batch=%lu sens=%.0f LSB/g (epoch %lu)",
+             (unsigned long)next->odr_hz,
+             (unsigned long)next->decim_factor,
+             (unsigned long)next->batch_size,
+             next->sensitivity_lsb_g,
+             (unsigned long)next->epoch);
+
+    return ESP_OK;
+}
+
+esp_err_t node_config_apply_live(uint8_t range, uint8_t hpf_corner, uint32_t seq)
+{
+    if (range != NODE_RANGE_2G && range != NODE_RANGE_4G && range != NODE_RANGE_8G) {
+        ESP_LOGE(TAG, "Invalid range=%u (must be 1=±2g, 2=±4g, 3=±8g)", range);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (hpf_corner > 6) {
+        ESP_LOGE(TAG, "Invalid hpf_corner=%u (must be 0-6)", hpf_corner);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_state != NODE_STATE_RECORDING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const node_runtime_config_t *cur = node_config_get();
+    const adxl355_odr_config_t  *odr = node_config_get_odr(cur->odr_index);
+
+    /* The spare buffer is the data task's old config until it has switched */
+    for (uint32_t waited = 0; s_epoch_in_use != cur->epoch; waited += 10) {
+        if (waited >= NODE_CONFIG_STAGE_WAIT_MS) {
+            ESP_LOGW(TAG, "Live config rejected: epoch %lu still being switched",
+                     (unsigned long)cur->epoch);
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    node_runtime_config_t *next = staging_buffer();
+    *next = *cur;
+    next->range             = range;
+    next->hpf_corner        = hpf_corner;
+    next->seq               = seq;
+    next->sensitivity_lsb_g = sensitivity_for_range(range);
+    next->epoch             = cur->epoch + 1;
+    next->live              = true;
+
+    ESP_LOGI(TAG, "Applying live config: range=%u, HPF=%u, seq=%lu",
+             range, hpf_corner, (unsigned long)seq);
+
+    /* Quiet slot: no SCL3300 read waits on the bus lock (spi_bus.h) behind
+     * the register writes; only ADXL355 reads stop */
+    wait_for_quiet_slot();
+    if (adxl355_isr_set_inhibit(true) != ESP_OK) {
+        /* Nothing written yet: the command can be retried */
+        ESP_LOGW(TAG, "Live config rejected: ADXL355 read still in flight");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    uint8_t filter_val = (uint8_t)((hpf_corner << 4) | odr->filter_reg);
+    esp_err_t err = adxl355_write_reg_pub(ADXL355_REG_POWER_CTL, ADXL355_POWER_STANDBY_BIT);
+    if (err == ESP_OK) {
+        err = write_filter_and_range(filter_val, range);
+    }
+    if (err == ESP_OK) {
+        err = adxl355_write_reg_pub(ADXL355_REG_POWER_CTL, 0x00);
+    }
+    /* Samples converted from here on use the new settings */
+    next->epoch_tick = get_tick_count();
+    esp_rom_delay_us(NODE_CONFIG_LIVE_SETTLE_US);
+
+    if (err == ESP_OK) {
+        publish_staged();
+    }
+    adxl355_isr_set_inhibit(false);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Live config failed: %s", esp_err_to_name(err));
+        s_state = NODE_STATE_ERROR;
+        fault_log_record(FAULT_SPI_ERROR);
+        return err;
+    }
 
+    ESP_LOGI(TAG, "Live config applied at tick %lu: sens=%.0f LSB/g (epoch %lu)",
+             (unsigned long)next->epoch_tick, next->sensitivity_lsb_g,
+             (unsigned long)next->epoch);
     return ESP_OK;
 }
 
@@ -295,8 +445,8 @@ void node_config_reset(void)
  * ---------------------------------------------------------------------- */
 
 /* Internal implementation — takes sensitivity explicitly so it works correctly
- * both during node_config_apply (before s_cfg is updated) and from the public
- * API (after s_cfg is set). */
+ * both during node_config_apply (before the new config is published) and from
+ * the public API (after it is). */
 static esp_err_t run_selftest_impl(adxl355_selftest_result_t *result,
                                     float sensitivity_lsb_g)
 {
@@ -410,7 +560,7 @@ selftest_cleanup:
     return err;
 }
 
-/* Called from node_config_apply with the new range sensitivity (before s_cfg update) */
+/* Called from node_config_apply with the new range sensitivity (before it is published) */
 static esp_err_t node_config_run_selftest_with_sensitivity(
     adxl355_selftest_result_t *result, float sensitivity_lsb_g)
 {
@@ -418,9 +568,9 @@ static esp_err_t node_config_run_selftest_with_sensitivity(
     return run_selftest_impl(result, sensitivity_lsb_g);
 }
 
-/* Public API — uses current s_cfg sensitivity (valid after configure) */
+/* Public API — uses the published sensitivity (valid after configure) */
 esp_err_t node_config_run_selftest(adxl355_selftest_result_t *result)
 {
     if (result == NULL) return ESP_ERR_INVALID_ARG;
-    return run_selftest_impl(result, s_cfg.sensitivity_lsb_g);
+    return run_selftest_impl(result, node_config_get()->sensitivity_lsb_g);
 }
@@ -16,8 +16,23 @@
  *   Any state ──(sensor fault / init fail)──► ERROR
  *   ERROR ──(reset cmd)──► IDLE
  *
- * Reconfiguration always stops the ISR first. In-flight data is discarded.
- * A data gap is expected and documented behaviour.
+ * Reconfiguration that changes the ODR stops the ISR first. In-flight data
+ * is discarded and a data gap is expected and documented behaviour.
+ *
+ * Live reconfiguration
+ * ====================
+ * A range / HPF change while RECORDING goes through node_config_apply_live()
+ * instead, without stopping the ISR. The runtime config is double-buffered:
+ * the new node_runtime_config_t is staged in the spare buffer, the ADXL355
+ * registers are written in a quiet slot just after an SCL3300 read (ADXL355
+ * ISR reads inhibited for ~2 ms), and the staged config is
+ * published with the tick from which samples carry the new settings
+ * (epoch_tick). The data task keeps using its own copy of the old config up
+ * to that tick, closes the batch there and switches decimator, spectrum and
+ * batcher to the new one. Every applied config bumps the epoch, carried in
+ * each data packet ("e" in JSON, header byte 31 in binary frames), so the Pi
+ * sees exactly where the parameters changed. A range change costs the
+ * decimator warm-up (a few output samples); an HPF change costs none.
  *
  * Supported ODR settings (output always 200 Hz, decimation = ODR / 200)
  * ======================================================================
@@ -73,7 +88,7 @@ typedef struct {
     uint32_t odr_hz;             /**< ADXL355 output data rate in Hz          */
     uint8_t  filter_reg;         /**< Value for register 0x28 (ODR_LPF field) */
     uint32_t isr_tick_divisor;   /**< BASE_TIMER_FREQ_HZ (8000) / odr_hz      */
-    uint32_t decim_factor;       /**< Raw samples averaged per output sample   */
+    uint32_t decim_factor;       /**< Raw samples per output sample (decimator.h) */
     uint32_t batch_size;         /**< Output samples per MQTT packet (1 sec)   */
     float    sensitivity_lsb_g;  /**< LSB/g for the configured range           */
 } adxl355_odr_config_t;
@@ -85,9 +100,13 @@ typedef struct {
 const adxl355_odr_config_t *node_config_get_odr(uint8_t odr_index);
 
 /* -------------------------------------------------------------------------
- * Runtime configuration (applied atomically during reconfiguration)
+ * Runtime configuration (double-buffered, published atomically)
  * ---------------------------------------------------------------------- */
 
+#define NODE_CONFIG_QUIET_WAIT_MS   60      /**< Longest wait for an SCL3300 read to pass  */
+#define NODE_CONFIG_LIVE_SETTLE_US  1000    /**< Measurement-mode settle before reads resume */
+#define NODE_CONFIG_STAGE_WAIT_MS   1000    /**< Wait for the data task to free the spare buffer */
+
 /** Valid range codes — match ADXL355_RANGE_* in adxl355.h */
 #define NODE_RANGE_2G   1
 #define NODE_RANGE_4G   2
@@ -105,6 +124,11 @@ typedef struct {
     uint32_t batch_size;
     float    sensitivity_lsb_g;
     uint32_t odr_hz;
+
+    /* Stream epoch — bumped by every applied config */
+    uint32_t epoch;              /**< Carried in every data packet             */
+    uint32_t epoch_tick;         /**< First tick sampled with this config (live only) */
+    bool     live;               /**< Applied without stopping the ISR          */
 } node_runtime_config_t;
 
 /* -------------------------------------------------------------------------
@@ -134,9 +158,22 @@ void node_config_init(void);
 /** @brief Return the current node state. */
 node_state_t node_config_get_state(void);
 
-/** @brief Return a pointer to the current runtime config (read-only). */
+/**
+ * @brief Return a pointer to the latest published runtime config (read-only).
+ *
+ * The buffer stays valid until the config after next is staged; the data
+ * task holds on to older ones through node_config_note_in_use().
+ */
 const node_runtime_config_t *node_config_get(void);
 
+/**
+ * @brief Data task: report the epoch of the config it is processing with.
+ *
+ * node_config_apply_live() only restages the spare buffer once the data
+ * path has moved on to the latest epoch.
+ */
+void node_config_note_in_use(uint32_t epoch);
+
 /**
  * @brief Apply a new configuration and transition state.
  *
@@ -162,6 +199,23 @@ esp_err_t node_config_apply(uint8_t odr_index, uint8_t range,
                              uint8_t hpf_corner, uint32_t seq,
                              adxl355_selftest_result_t *result);
 
+/**
+ * @brief Change range and HPF while RECORDING without stopping the ISR.
+ *
+ * Stages the new config, writes FILTER + RANGE in a quiet slot (reads back
+ * both), then publishes it with epoch_tick set. ODR and self-test need
+ * node_config_apply(). State stays RECORDING.
+ *
+ * @param range      NODE_RANGE_2G / _4G / _8G
+ * @param hpf_corner 0=off, 1-6 per datasheet Table 44
+ * @param seq        Sequence number echoed in ACK
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG / ESP_ERR_INVALID_STATE
+ *         (not recording) / ESP_ERR_TIMEOUT (previous change still being
+ *         switched by the data task) with no change made, or a register
+ *         error → state becomes ERROR.
+ */
+esp_err_t node_config_apply_live(uint8_t range, uint8_t hpf_corner, uint32_t seq);
+
 /**
  * @brief Transition to RECORDING state.
  * Must only be called from CONFIGURED state.
@@ -0,0 +1,85 @@
+/**
+ * @file packet_time.c
+ * @brief Per-packet tick -> UTC anchor and incremental ISO-8601 formatting.
+ *
+ * See packet_time.h for the model. The formatter writes digits by hand; only
+ * the once-per-second prefix rebuild goes through gmtime_r()/strftime(), and
+ * only the unsynced fallback uses snprintf().
+ */
+
+#include "packet_time.h"
+#include "sensor_task.h"      // get_tick_count()
+#include "clock_discipline.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+/* Any tv_sec above this is a valid post-SNTP UTC timestamp (matches sntp_sync.c). */
+#define TS_VALID_UTC_THRESHOLD  1700000000L
+
+/******************************************************************************
+ * ANCHOR
+ *****************************************************************************/
+
+void ts_anchor_capture(ts_anchor_t *anchor)
+{
+    anchor->tick   = get_tick_count();
+    anchor->utc_us = clock_discipline_now_utc_us();
+    if (anchor->utc_us != 0) {
+        return;
+    }
+
+    /* No SNTP event seen yet this boot; the wall clock may still be valid
+       (e.g. kept across a software restart). */
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    if (tv.tv_sec > TS_VALID_UTC_THRESHOLD) {
+        anchor->utc_us = (int64_t)tv.tv_sec * 1000000LL + (int64_t)tv.tv_usec;
+    } else {
+        anchor->utc_us = 0;
+    }
+}
+
+/******************************************************************************
+ * ISO CURSOR
+ *****************************************************************************/
+
+void ts_iso_cursor_init(ts_iso_cursor_t *cur)
+{
+    cur->sec = (time_t)-1;
+    cur->prefix[0] = '\0';
+}
+
+void ts_iso_format(ts_iso_cursor_t *cur, int64_t utc_us, char *buf)
+{
+    time_t sec = (time_t)(utc_us / 1000000LL);
+    int    us  = (int)(utc_us % 1000000LL);
+    if (us < 0) { us += 1000000; sec -= 1; }
+
+    /* Empty prefix too: sec -1 (1969-12-31T23:59:59) is also the init marker */
+    if (sec != cur->sec || cur->prefix[0] == '\0') {
+        struct tm tm_info;
+        gmtime_r(&sec, &tm_info);
+        strftime(cur->prefix, sizeof(cur->prefix), "%Y-%m-%dT%H:%M:%S", &tm_info);
+        cur->sec = sec;
+    }
+
+    memcpy(buf, cur->prefix, 19);
+    buf[19] = '.';
+    for (int i = 25; i >= 20; i--) {
+        buf[i] = (char)('0' + us % 10);
+        us /= 10;
+    }
+    buf[26] = 'Z';
+    buf[27] = '\0';
+}
+
+void ts_format_tick(const ts_anchor_t *anchor, ts_iso_cursor_t *cur,
+                    uint32_t tick, char *buf)
+{
+    if (!ts_anchor_synced(anchor)) {
+        snprintf(buf, TS_ISO_MIN_LEN, "tick:%08lu", (unsigned long)tick);
+        return;
+    }
+    ts_iso_format(cur, ts_anchor_tick_to_utc_us(anchor, tick), buf);
+}
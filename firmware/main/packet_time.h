@@ -0,0 +1,105 @@
+/**
+ * @file packet_time.h
+ * @brief Per-packet tick -> UTC anchor and incremental ISO-8601 formatting.
+ *
+ * Every sample carries the 125 us acquisition tick it was captured on. Instead
+ * of reading the wall clock once per sample, a publisher captures one anchor
+ * (tick + UTC pair) per packet and derives every sample time as an integer
+ * tick offset from it. All samples in a packet therefore share one
+ * consistent time base. The anchor UTC comes from the disciplined
+ * local-clock model in clock_discipline.h, not from gettimeofday(), so SNTP
+ * corrections arrive as slews rather than as per-packet jumps.
+ *
+ * The ISO cursor caches the "YYYY-MM-DDTHH:MM:SS" prefix of the last second it
+ * formatted. Consecutive samples in the same second only rewrite the six
+ * fractional digits; gmtime_r() runs at most once per second boundary.
+ *
+ * Usage:
+ *   ts_anchor_t anchor;
+ *   ts_iso_cursor_t cur;
+ *   ts_anchor_capture(&anchor);
+ *   ts_iso_cursor_init(&cur);
+ *   for (...) ts_format_tick(&anchor, &cur, sample_tick, buf);
+ *
+ * Until SNTP has synced, ts_format_tick() emits "tick:NNNNNNNN" strings, the
+ * same fallback the Pi already rejects as an unsynced clock.
+ */
+
+#ifndef PACKET_TIME_H
+#define PACKET_TIME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Microseconds per acquisition tick (8 kHz base timer). */
+#define TS_TICK_US          125
+
+/** Minimum buffer size for ts_iso_format(): "YYYY-MM-DDTHH:MM:SS.ffffffZ" + NUL. */
+#define TS_ISO_MIN_LEN      28
+
+typedef struct {
+    uint32_t tick;       /**< Acquisition tick at capture                      */
+    int64_t  utc_us;     /**< UTC at capture in microseconds, 0 = not synced    */
+} ts_anchor_t;
+
+typedef struct {
+    time_t sec;          /**< Second the cached prefix belongs to, -1 = empty  */
+    char   prefix[20];   /**< "YYYY-MM-DDTHH:MM:SS" for sec                    */
+} ts_iso_cursor_t;
+
+/**
+ * @brief Capture a tick -> UTC anchor from the disciplined clock.
+ *
+ * Falls back to gettimeofday() before the first SNTP event; utc_us is left
+ * 0 if neither has a valid time yet.
+ */
+void ts_anchor_capture(ts_anchor_t *anchor);
+
+/** @brief True if the anchor carries a valid UTC time. */
+static inline bool ts_anchor_synced(const ts_anchor_t *anchor)
+{
+    return anchor->utc_us != 0;
+}
+
+/**
+ * @brief UTC (us) of an acquisition tick, derived from the anchor.
+ *
+ * Ticks slightly after the anchor (negative age) are handled via the signed
+ * 32-bit tick difference. Returns 0 if the anchor is not synced.
+ */
+static inline int64_t ts_anchor_tick_to_utc_us(const ts_anchor_t *anchor, uint32_t tick)
+{
+    if (anchor->utc_us == 0) {
+        return 0;
+    }
+    return anchor->utc_us + (int64_t)(int32_t)(tick - anchor->tick) * TS_TICK_US;
+}
+
+/** @brief Reset the cursor so the next format call rebuilds the prefix. */
+void ts_iso_cursor_init(ts_iso_cursor_t *cur);
+
+/**
+ * @brief Format a UTC microsecond time as "YYYY-MM-DDTHH:MM:SS.ffffffZ".
+ * @param buf  At least TS_ISO_MIN_LEN bytes.
+ */
+void ts_iso_format(ts_iso_cursor_t *cur, int64_t utc_us, char *buf);
+
+/**
+ * @brief Format a sample tick against an anchor.
+ *
+ * Emits the ISO string when synced, otherwise "tick:NNNNNNNN".
+ * @param buf  At least TS_ISO_MIN_LEN bytes.
+ */
+void ts_format_tick(const ts_anchor_t *anchor, ts_iso_cursor_t *cur,
+                    uint32_t tick, char *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PACKET_TIME_H */
@@ -0,0 +1,539 @@
+/**
+ * @file publish_pipeline.c
+ * @brief Three-stage packet pipeline: build -> serialize -> publish.
+ *
+ * See publish_pipeline.h for the buffer flow. While MQTT is down the
+ * serialize stage encodes binary frames and the publish stage appends them to
+ * the store-and-forward log; once reconnected it replays that backlog between
+ * live packets. The publish stage also drives flow_control.h: with batching
+ * configured or at the coarse level it coalesces binary frames into one
+ * message, at summary / store it logs them like offline packets. With the UDP transport selected
+ * (udp_stream.h) frames skip all of that and go straight to the multicast
+ * socket, which this task owns; it also sends the raw ODR frames the data
+ * task queues there ("udp_raw"). Each latency accumulator is
+ * written by exactly one task, so no locking is needed; a stats snapshot
+ * taken mid-update may be off by one packet, which is fine for diagnostics.
+ */
+
+#include "publish_pipeline.h"
+#include "store_forward.h"
+#include "flow_control.h"
+#include "udp_stream.h"
+#include "packet_time.h"
+#include "boot_seq.h"
+#include "mem_budget.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "PIPELINE";
+
+/** How long a stage task blocks on its input queue before re-checking s_running. */
+#define PIPE_POLL_MS   100
+
+/******************************************************************************
+ * BUFFERS
+ *****************************************************************************/
+
+typedef struct {
+    mqtt_sensor_packet_t packet;
+    int64_t  acquired_us;      /**< publish_pipeline_acquire() time */
+    int64_t  submitted_us;     /**< publish_pipeline_submit() time  */
+    uint32_t accel_samples;
+} pkt_slot_t;
+
+typedef struct {
+    char    *buf;
+    size_t   len;
+    int64_t  submitted_us;     /**< Carried over from the packet slot */
+    uint32_t accel_samples;
+    bool     store;            /**< Encoded for the offline log, not for sending */
+    bool     udp;              /**< Binary frame for the UDP multicast stream    */
+} payload_slot_t;
+
+/* Packet slots are static — keeps the large structs off the heap and stacks */
+static pkt_slot_t     s_pkt_slots[PUBLISH_PIPELINE_PACKET_SLOTS];
+static payload_slot_t s_payload_slots[PUBLISH_PIPELINE_PAYLOAD_SLOTS];
+
+/* Both stages delete themselves on stop; publish_pipeline_stop() gives
+   them time to exit before a restart reuses their storage */
+MEM_BUDGET_STATIC_TASK(s_ser_task_mem, PIPE_SERIALIZE_TASK_STACK_SIZE);
+MEM_BUDGET_STATIC_TASK(s_pub_task_mem, PIPE_PUBLISH_TASK_STACK_SIZE);
+
+/* Queues of slot indices */
+static QueueHandle_t s_pkt_free_q     = NULL;
+static QueueHandle_t s_ser_q          = NULL;
+static QueueHandle_t s_payload_free_q = NULL;
+static QueueHandle_t s_pub_q          = NULL;
+
+/*
+ * Batching (flow_control_batch_packets() > 1): consecutive binary frames are
+ * concatenated here and sent as one message. Offsets are kept so a failed
+ * send can still log each frame. Owned by the publish stage.
+ */
+_Static_assert(FLOW_COARSE_PACKETS <= FLOW_BATCH_MAX_PACKETS, "coarse batch exceeds the offsets table");
+
+static char    *s_coalesce_buf = NULL;
+static size_t   s_coalesce_off[FLOW_BATCH_MAX_PACKETS + 1];
+static uint32_t s_coalesce_count;
+static uint32_t s_coalesce_samples;
+static int64_t  s_coalesce_first_us;
+
+static TaskHandle_t  s_ser_task_handle = NULL;
+static TaskHandle_t  s_pub_task_handle = NULL;
+static volatile bool s_running         = false;
+
+/******************************************************************************
+ * STATISTICS
+ *****************************************************************************/
+
+typedef struct {
+    uint32_t count;
+    uint32_t last_us;
+    uint32_t max_us;
+    uint64_t total_us;
+} stage_acc_t;
+
+static stage_acc_t s_build_acc;
+static stage_acc_t s_queue_acc;
+static stage_acc_t s_serialize_acc;
+static stage_acc_t s_publish_acc;
+static stage_acc_t s_e2e_acc;
+
+static volatile uint32_t s_packets_published = 0;
+static volatile uint32_t s_samples_published = 0;
+static volatile uint32_t s_packets_failed    = 0;
+static volatile uint32_t s_samples_failed    = 0;
+static volatile uint32_t s_slot_full_drops   = 0;
+static volatile uint32_t s_packets_stored    = 0;
+static volatile uint32_t s_samples_stored    = 0;
+
+static void stage_record(stage_acc_t *acc, int64_t us)
+{
+    uint32_t v = (us > 0) ? (uint32_t)us : 0u;
+    acc->last_us   = v;
+    acc->total_us += v;
+    if (v > acc->max_us) {
+        acc->max_us = v;
+    }
+    acc->count++;
+}
+
+static void stage_snapshot(const stage_acc_t *acc, pipeline_stage_stats_t *out)
+{
+    out->count   = acc->count;
+    out->last_us = acc->last_us;
+    out->max_us  = acc->max_us;
+    out->avg_us  = acc->count ? (uint32_t)(acc->total_us / acc->count) : 0u;
+}
+
+static uint8_t pkt_slot_index(const mqtt_sensor_packet_t *packet)
+{
+    return (uint8_t)((const pkt_slot_t *)packet - s_pkt_slots);
+}
+
+/******************************************************************************
+ * STAGE TASKS
+ *****************************************************************************/
+
+static void serialize_task(void *pvParameters)
+{
+    (void)pvParameters;
+    ESP_LOGI(TAG, "Serialize stage started");
+
+    while (s_running) {
+        uint8_t pkt_idx;
+        if (xQueueReceive(s_ser_q, &pkt_idx, pdMS_TO_TICKS(PIPE_POLL_MS)) != pdTRUE) {
+            continue;
+        }
+        pkt_slot_t *ps = &s_pkt_slots[pkt_idx];
+
+        /* Block here, not in the data task, when the publish stage is stalled */
+        uint8_t pl_idx;
+        while (s_running &&
+               xQueueReceive(s_payload_free_q, &pl_idx, pdMS_TO_TICKS(PIPE_POLL_MS)) != pdTRUE) {
+        }
+        if (!s_running) {
+            break;
+        }
+        payload_slot_t *pl = &s_payload_slots[pl_idx];
+
+        int64_t t0 = esp_timer_get_time();
+        stage_record(&s_queue_acc, t0 - ps->submitted_us);
+
+        /* Offline or throttled to summary / store: the log only holds binary
+         * frames, whatever the live format. Batching is binary too.
+         * The UDP stream bypasses both: it does not depend on the broker. */
+        flow_level_t level = flow_control_get_level();
+
+        /* Send timestamp for the Pi's latency histograms (mqtt.h) */
+        ts_anchor_t now;
+        ts_anchor_capture(&now);
+        ps->packet.send_utc_us = now.utc_us;
+
+        pl->udp   = udp_stream_is_enabled();
+        pl->store = !pl->udp &&
+                    (!mqtt_is_connected() || level >= FLOW_LEVEL_SUMMARY) &&
+                    store_forward_enabled();
+        esp_err_t ret = (pl->udp || pl->store || flow_control_batch_packets() > 1)
+            ? mqtt_serialize_sensor_binary(&ps->packet, pl->buf, MQTT_DATA_PAYLOAD_MAX, &pl->len)
+            : mqtt_serialize_sensor_data(&ps->packet, pl->buf, MQTT_DATA_PAYLOAD_MAX, &pl->len);
+        stage_record(&s_serialize_acc, esp_timer_get_time() - t0);
+
+        pl->submitted_us  = ps->submitted_us;
+        pl->accel_samples = ps->accel_samples;
+        xQueueSend(s_pkt_free_q, &pkt_idx, 0);
+
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Serialize failed: %s", esp_err_to_name(ret));
+            s_packets_failed++;
+            s_samples_failed += pl->accel_samples;
+            xQueueSend(s_payload_free_q, &pl_idx, 0);
+            continue;
+        }
+        xQueueSend(s_pub_q, &pl_idx, 0);
+    }
+
+    ESP_LOGI(TAG, "Serialize stage stopped");
+    s_ser_task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+/** Append a frame to the offline log; false if it could not be kept. */
+static bool store_frame(const char *buf, size_t len, uint32_t accel_samples)
+{
+    if (store_forward_write((uint8_t *)buf, len) != ESP_OK) {
+        return false;
+    }
+    s_packets_stored++;
+    s_samples_stored += accel_samples;
+    return true;
+}
+
+static bool store_payload(payload_slot_t *pl)
+{
+    return store_frame(pl->buf, pl->len, pl->accel_samples);
+}
+
+/** Send one live message, recording latency for the stats and flow control. */
+static esp_err_t send_live(const char *buf, size_t len, int64_t submitted_us,
+                           uint32_t packets, uint32_t accel_samples)
+{
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t ret = mqtt_publish_sensor_payload(buf, len);
+    int64_t t1 = esp_timer_get_time();
+    stage_record(&s_publish_acc, t1 - t0);
+    flow_control_note_publish((uint32_t)(t1 - t0));
+
+    if (ret == ESP_OK) {
+        stage_record(&s_e2e_acc, t1 - submitted_us);
+        boot_seq_note_first_packet();
+        s_packets_published += packets;
+        s_samples_published += accel_samples;
+    }
+    return ret;
+}
+
+/** Send one frame on the UDP stream; it never feeds MQTT flow control. */
+static esp_err_t send_udp(const payload_slot_t *pl)
+{
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t ret = udp_stream_send_frame((const uint8_t *)pl->buf, pl->len);
+    int64_t t1 = esp_timer_get_time();
+    stage_record(&s_publish_acc, t1 - t0);
+
+    if (ret == ESP_OK) {
+        stage_record(&s_e2e_acc, t1 - pl->submitted_us);
+        boot_seq_note_first_packet();
+        s_packets_published++;
+        s_samples_published += pl->accel_samples;
+    }
+    return ret;
+}
+
+/** Send the coalesced frames; on a dropped link log them one by one. */
+static void coalesce_flush(void)
+{
+    if (s_coalesce_count == 0) {
+        return;
+    }
+    size_t    len = s_coalesce_off[s_coalesce_count];
+    esp_err_t ret = send_live(s_coalesce_buf, len, s_coalesce_first_us,
+                              s_coalesce_count, s_coalesce_samples);
+    if (ret != ESP_OK) {
+        for (uint32_t i = 0; i < s_coalesce_count; i++) {
+            const char *frame = s_coalesce_buf + s_coalesce_off[i];
+            size_t      flen  = s_coalesce_off[i + 1] - s_coalesce_off[i];
+            /* Per-frame sample counts are not kept; attribute the average */
+            uint32_t samples = s_coalesce_samples / s_coalesce_count;
+            if (!(ret == ESP_ERR_INVALID_STATE && store_forward_enabled() &&
+                  store_frame(frame, flen, samples))) {
+                s_packets_failed++;
+                s_samples_failed += samples;
+            }
+        }
+    }
+    s_coalesce_count   = 0;
+    s_coalesce_samples = 0;
+}
+
+static void coalesce_add(const payload_slot_t *pl)
+{
+    if (s_coalesce_count > 0 &&
+        s_coalesce_off[s_coalesce_count] + pl->len > PUBLISH_PIPELINE_COALESCE_BYTES) {
+        coalesce_flush();
+    }
+    if (s_coalesce_count == 0) {
+        s_coalesce_off[0]   = 0;
+        s_coalesce_first_us = pl->submitted_us;
+    }
+    memcpy(s_coalesce_buf + s_coalesce_off[s_coalesce_count], pl->buf, pl->len);
+    s_coalesce_off[s_coalesce_count + 1] = s_coalesce_off[s_coalesce_count] + pl->len;
+    s_coalesce_count++;
+    s_coalesce_samples += pl->accel_samples;
+
+    if (s_coalesce_count >= flow_control_batch_packets()) {
+        coalesce_flush();
+    }
+}
+
+static void publish_task(void *pvParameters)
+{
+    (void)pvParameters;
+    ESP_LOGI(TAG, "Publish stage started");
+
+    while (s_running) {
+        /* With a backlog pending, wake at the replay pace even if no live
+         * packet arrives so replay proceeds between live sends. */
+        uint32_t wait_ms = store_forward_pending() ? SF_REPLAY_INTERVAL_MS : PIPE_POLL_MS;
+        /* Raw frames fill in tens of ms and have no queue of their own to wake on */
+        if (udp_stream_raw_enabled() && wait_ms > UDP_STREAM_RAW_POLL_MS) {
+            wait_ms = UDP_STREAM_RAW_POLL_MS;
+        }
+
+        uint8_t pl_idx;
+        if (xQueueReceive(s_pub_q, &pl_idx, pdMS_TO_TICKS(wait_ms)) == pdTRUE) {
+            payload_slot_t *pl = &s_payload_slots[pl_idx];
+            bool is_bin = ((uint8_t)pl->buf[0] == MQTT_BIN_MAGIC);
+
+            udp_stream_service();
+            if (pl->udp) {
+                /* Best effort: a lost datagram is the receiver's loss count */
+                if (send_udp(pl) != ESP_OK) {
+                    s_packets_failed++;
+                    s_samples_failed += pl->accel_samples;
+                }
+            } else if (pl->store) {
+                if (!store_payload(pl)) {
+                    s_packets_failed++;
+                    s_samples_failed += pl->accel_samples;
+                }
+            } else if (is_bin && flow_control_batch_packets() > 1 &&
+                       s_coalesce_buf != NULL) {
+                coalesce_add(pl);
+            } else {
+                esp_err_t ret = send_live(pl->buf, pl->len, pl->submitted_us,
+                                          1, pl->accel_samples);
+                if (ret != ESP_OK &&
+                    !(ret == ESP_ERR_INVALID_STATE && is_bin &&
+                      store_forward_enabled() && store_payload(pl))) {
+                    /* Link dropped after encoding: a binary frame can still be
+                     * logged, a JSON document is lost */
+                    s_packets_failed++;
+                    s_samples_failed += pl->accel_samples;
+                }
+            }
+            xQueueSend(s_payload_free_q, &pl_idx, 0);
+        }
+
+        udp_stream_service();
+        udp_stream_send_raw();
+        flow_control_update();
+        /* Batching turned off or shortened, or the oldest frame reached the
+         * hold bound: do not sit on data */
+        if (s_coalesce_count > 0 &&
+            (s_coalesce_count >= flow_control_batch_packets() ||
+             esp_timer_get_time() - s_coalesce_first_us >
+                 (int64_t)flow_control_batch_hold_ms() * 1000)) {
+            coalesce_flush();
+        }
+
+        /* Replay only adds load on a throttled link */
+        if (flow_control_get_level() == FLOW_LEVEL_FULL && store_forward_replay_due()) {
+            store_forward_replay_one();
+        }
+    }
+
+    coalesce_flush();
+    ESP_LOGI(TAG, "Publish stage stopped");
+    s_pub_task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+esp_err_t publish_pipeline_init(void)
+{
+    if (s_pkt_free_q == NULL) {
+        s_pkt_free_q     = xQueueCreate(PUBLISH_PIPELINE_PACKET_SLOTS,  sizeof(uint8_t));
+        s_ser_q          = xQueueCreate(PUBLISH_PIPELINE_PACKET_SLOTS,  sizeof(uint8_t));
+        s_payload_free_q = xQueueCreate(PUBLISH_PIPELINE_PAYLOAD_SLOTS, sizeof(uint8_t));
+        s_pub_q          = xQueueCreate(PUBLISH_PIPELINE_PAYLOAD_SLOTS, sizeof(uint8_t));
+        if (!s_pkt_free_q || !s_ser_q || !s_payload_free_q || !s_pub_q) {
+            ESP_LOGE(TAG, "Failed to create pipeline queues");
+            return ESP_ERR_NO_MEM;
+        }
+        mem_budget_record("pipeline", MEM_REGION_STATIC, sizeof(s_pkt_slots));
+    } else {
+        /* Restart after publish_pipeline_stop(): every slot goes back to free */
+        xQueueReset(s_pkt_free_q);
+        xQueueReset(s_ser_q);
+        xQueueReset(s_payload_free_q);
+        xQueueReset(s_pub_q);
+    }
+
+    for (uint8_t i = 0; i < PUBLISH_PIPELINE_PAYLOAD_SLOTS; i++) {
+        if (s_payload_slots[i].buf == NULL) {
+            s_payload_slots[i].buf = mem_budget_reserve("pipeline", MQTT_DATA_PAYLOAD_MAX, true);
+        }
+        if (s_payload_slots[i].buf == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate payload buffer %u", i);
+            return ESP_ERR_NO_MEM;
+        }
+        xQueueSend(s_payload_free_q, &i, 0);
+    }
+    for (uint8_t i = 0; i < PUBLISH_PIPELINE_PACKET_SLOTS; i++) {
+        xQueueSend(s_pkt_free_q, &i, 0);
+    }
+
+    /* Optional: without it batching sends frames one by one */
+    if (s_coalesce_buf == NULL) {
+        s_coalesce_buf = mem_budget_reserve("pipeline", PUBLISH_PIPELINE_COALESCE_BYTES, true);
+        if (s_coalesce_buf == NULL) {
+            ESP_LOGW(TAG, "No memory for the coalescing buffer -- batching disabled");
+        }
+    }
+    s_coalesce_count = 0;
+
+    /* Optional: without the partition offline packets are dropped as before */
+    store_forward_init();
+
+    /* Optional: without the buffers "udp_raw" is refused */
+    udp_stream_init();
+
+    publish_pipeline_reset_stats();
+    s_running = true;
+
+    s_ser_task_handle = mem_budget_task_create("pipeline", &s_ser_task_mem, serialize_task,
+                                               "pipe_ser", NULL, PIPE_SERIALIZE_TASK_PRIORITY,
+                                               PIPE_SERIALIZE_TASK_CORE);
+    if (s_ser_task_handle == NULL) {
+        ESP_LOGE(TAG, "Failed to create serialize task");
+        s_running = false;
+        return ESP_FAIL;
+    }
+
+    s_pub_task_handle = mem_budget_task_create("pipeline", &s_pub_task_mem, publish_task,
+                                               "pipe_pub", NULL, PIPE_PUBLISH_TASK_PRIORITY,
+                                               PIPE_PUBLISH_TASK_CORE);
+    if (s_pub_task_handle == NULL) {
+        ESP_LOGE(TAG, "Failed to create publish task");
+        s_running = false;
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Pipeline started (%d packet slots, %d payload buffers; "
+             "serialize core=%d prio=%d, publish core=%d prio=%d)",
+             PUBLISH_PIPELINE_PACKET_SLOTS, PUBLISH_PIPELINE_PAYLOAD_SLOTS,
+             PIPE_SERIALIZE_TASK_CORE, PIPE_SERIALIZE_TASK_PRIORITY,
+             PIPE_PUBLISH_TASK_CORE, PIPE_PUBLISH_TASK_PRIORITY);
+    return ESP_OK;
+}
+
+esp_err_t publish_pipeline_stop(void)
+{
+    s_running = false;
+    vTaskDelay(pdMS_TO_TICKS(2 * PIPE_POLL_MS));
+    return ESP_OK;
+}
+
+uint32_t publish_pipeline_free_slots(void)
+{
+    return (s_pkt_free_q != NULL) ? (uint32_t)uxQueueMessagesWaiting(s_pkt_free_q) : 0u;
+}
+
+mqtt_sensor_packet_t *publish_pipeline_acquire(void)
+{
+    uint8_t idx;
+    if (s_pkt_free_q == NULL || xQueueReceive(s_pkt_free_q, &idx, 0) != pdTRUE) {
+        s_slot_full_drops++;
+        return NULL;
+    }
+
+    /* Not zeroed: the build stage writes every field it hands off */
+    pkt_slot_t *ps = &s_pkt_slots[idx];
+    ps->acquired_us = esp_timer_get_time();
+    return &ps->packet;
+}
+
+void publish_pipeline_submit(mqtt_sensor_packet_t *packet, uint32_t accel_samples)
+{
+    uint8_t     idx = pkt_slot_index(packet);
+    pkt_slot_t *ps  = &s_pkt_slots[idx];
+
+    ps->submitted_us  = esp_timer_get_time();
+    ps->accel_samples = accel_samples;
+    stage_record(&s_build_acc, ps->submitted_us - ps->acquired_us);
+
+    /* Cannot fail: the queue holds every slot index */
+    xQueueSend(s_ser_q, &idx, 0);
+}
+
+void publish_pipeline_release(mqtt_sensor_packet_t *packet)
+{
+    uint8_t idx = pkt_slot_index(packet);
+    xQueueSend(s_pkt_free_q, &idx, 0);
+}
+
+void publish_pipeline_get_stats(publish_pipeline_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    stage_snapshot(&s_build_acc,     &stats->build);
+    stage_snapshot(&s_queue_acc,     &stats->queue);
+    stage_snapshot(&s_serialize_acc, &stats->serialize);
+    stage_snapshot(&s_publish_acc,   &stats->publish);
+    stage_snapshot(&s_e2e_acc,       &stats->end_to_end);
+
+    stats->packets_published = s_packets_published;
+    stats->samples_published = s_samples_published;
+    stats->packets_failed    = s_packets_failed;
+    stats->samples_failed    = s_samples_failed;
+    stats->slot_full_drops   = s_slot_full_drops;
+    stats->packets_stored    = s_packets_stored;
+    stats->samples_stored    = s_samples_stored;
+}
+
+void publish_pipeline_reset_stats(void)
+{
+    memset(&s_build_acc,     0, sizeof(s_build_acc));
+    memset(&s_queue_acc,     0, sizeof(s_queue_acc));
+    memset(&s_serialize_acc, 0, sizeof(s_serialize_acc));
+    memset(&s_publish_acc,   0, sizeof(s_publish_acc));
+    memset(&s_e2e_acc,       0, sizeof(s_e2e_acc));
+
+    s_packets_published = 0;
+    s_samples_published = 0;
+    s_packets_failed    = 0;
+    s_samples_failed    = 0;
+    s_slot_full_drops   = 0;
+    s_packets_stored    = 0;
+    s_samples_stored    = 0;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file publish_pipeline.h
+ * @brief Three-stage packet pipeline: build -> serialize -> publish.
+ *
+ * Stages
+ * ======
+ *  1. Build     (data_proc task)  decimates straight into a packet slot.
+ *  2. Serialize (pipe_ser task)   encodes the packet into a payload buffer.
+ *  3. Publish   (pipe_pub task)   hands the payload to the MQTT client.
+ *
+ * Buffers are preallocated and only their indices travel through FreeRTOS
+ * queues, so no packet is ever copied between stages:
+ *
+ *   free packet slots --> build --> [ser queue] --> serialize --+
+ *          ^                                                    |
+ *          +------------------ packet slot returned ------------+
+ *
+ *   free payload bufs --> serialize --> [pub queue] --> publish --+
+ *          ^                                                      |
+ *          +------------------ payload buffer returned -----------+
+ *
+ * Backpressure
+ * ============
+ * publish_pipeline_acquire() never blocks. If the network stalls, the
+ * publish stage holds its payload buffer, the serializer waits for a free
+ * one while holding a packet slot, and once every slot is in flight the
+ * build stage simply gets NULL and counts the packet as dropped. The data
+ * task therefore keeps draining the sensor ring buffers at full rate no
+ * matter how long esp_mqtt_client_publish() takes.
+ *
+ * Before it comes to that, flow_control.h watches publish latency and the
+ * esp-mqtt outbox and steps the publish level down: coalesced binary
+ * frames, then summary only, then everything to the store-and-forward log.
+ *
+ * Offline
+ * =======
+ * While MQTT is disconnected, packets keep flowing through the pipeline but
+ * the publish stage writes them to the store-and-forward log
+ * (store_forward.h) and later replays them. Without that partition they are
+ * dropped before a slot is taken, as they always were.
+ */
+
+#ifndef PUBLISH_PIPELINE_H
+#define PUBLISH_PIPELINE_H
+
+#include "esp_err.h"
+#include "cpu_topology.h"
+#include "mqtt.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * CONFIGURATION
+ *****************************************************************************/
+
+/** Packet slots (~2.7 KB each, static). One is filled while one is encoded. */
+#define PUBLISH_PIPELINE_PACKET_SLOTS   2
+
+/** Payload buffers (MQTT_DATA_PAYLOAD_MAX each, heap). One is encoded while one is sent. */
+#define PUBLISH_PIPELINE_PAYLOAD_SLOTS  2
+
+/** Batching buffer (heap): FLOW_BATCH_MAX_PACKETS full binary frames with gap lists. */
+#define PUBLISH_PIPELINE_COALESCE_BYTES 28672
+
+/*
+ * Serialize and publish run on the network core (cpu_topology.h), next to
+ * esp-mqtt and lwIP, so encoding and socket writes never compete with
+ * decimation on the acquisition core.
+ */
+#define PIPE_SERIALIZE_TASK_STACK_SIZE  4096
+#define PIPE_SERIALIZE_TASK_PRIORITY    4
+#define PIPE_SERIALIZE_TASK_CORE        SHM_CORE_NET
+
+#define PIPE_PUBLISH_TASK_STACK_SIZE    4096
+#define PIPE_PUBLISH_TASK_PRIORITY      3
+#define PIPE_PUBLISH_TASK_CORE          SHM_CORE_NET
+
+/******************************************************************************
+ * STATISTICS
+ *****************************************************************************/
+
+/** Latency of one stage, in microseconds. */
+typedef struct {
+    uint32_t count;      /**< Packets measured            */
+    uint32_t last_us;    /**< Most recent packet          */
+    uint32_t max_us;     /**< Worst packet                */
+    uint32_t avg_us;     /**< Mean over count packets     */
+} pipeline_stage_stats_t;
+
+typedef struct {
+    pipeline_stage_stats_t build;       /**< Slot acquired -> submitted           */
+    pipeline_stage_stats_t queue;       /**< Submitted -> serializer picked it up */
+    pipeline_stage_stats_t serialize;   /**< Encoding into the payload buffer     */
+    pipeline_stage_stats_t publish;     /**< esp_mqtt_client_publish() call       */
+    pipeline_stage_stats_t end_to_end;  /**< Submitted -> published               */
+
+    uint32_t packets_published;
+    uint32_t samples_published;         /**< Accel samples in published packets  */
+    uint32_t packets_failed;            /**< Encode or publish errors             */
+    uint32_t samples_failed;
+    uint32_t slot_full_drops;           /**< acquire() found no free packet slot  */
+    uint32_t packets_stored;            /**< Written to the store-and-forward log */
+    uint32_t samples_stored;
+} publish_pipeline_stats_t;
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * @brief Allocate the payload buffers and start the serialize / publish tasks.
+ * @return ESP_ERR_NO_MEM if a buffer or queue could not be allocated.
+ */
+esp_err_t publish_pipeline_init(void);
+
+/** @brief Stop both pipeline tasks. Packets still in flight are discarded. */
+esp_err_t publish_pipeline_stop(void);
+
+/**
+ * @brief Take a free packet slot for the build stage (non-blocking).
+ *
+ * The slot is not cleared; the caller fills every field before submitting.
+ * The build stage holds it for a whole batch and decimates straight into it.
+ * Returns NULL (and counts a slot_full_drop) when every slot is still being
+ * serialized or waiting behind a stalled publish.
+ */
+mqtt_sensor_packet_t *publish_pipeline_acquire(void);
+
+/** @brief Free packet slots right now (no side effects, unlike acquire). */
+uint32_t publish_pipeline_free_slots(void);
+
+/**
+ * @brief Hand a filled slot to the serialize stage.
+ * @param accel_samples  Accel samples carried, for the published / failed counters
+ */
+void publish_pipeline_submit(mqtt_sensor_packet_t *packet, uint32_t accel_samples);
+
+/** @brief Return an acquired slot without publishing it. */
+void publish_pipeline_release(mqtt_sensor_packet_t *packet);
+
+/** @brief Snapshot the pipeline counters and per-stage latencies. */
+void publish_pipeline_get_stats(publish_pipeline_stats_t *stats);
+
+/** @brief Clear all counters and latency statistics. */
+void publish_pipeline_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PUBLISH_PIPELINE_H
@@ -0,0 +1,366 @@
+/**
+ * @file raw_history.c
+ * @brief PSRAM tier of the ADXL355 acquisition buffer (see raw_history.h).
+ *
+ * Ownership:
+ *   s_head, s_reserve, s_discard_to, s_discard_gen  drain task
+ *   s_tail, s_seen_gen                              data task (live consumer)
+ *   s_discard_req                                   set by the data task,
+ *                                                   cleared by the drain task
+ *
+ * Readers by sequence use s_reserve as a seqlock: the drain task advances it
+ * before it overwrites slots, and a reader that finds it moved past its
+ * range after copying throws the copy away.
+ */
+
+#include "raw_history.h"
+#include "mem_budget.h"
+#include "sdkconfig.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdatomic.h>
+#include <string.h>
+
+static const char *TAG = "RAW_HIST";
+
+MEM_BUDGET_STATIC_TASK(s_task_mem, RAW_HISTORY_TASK_STACK_SIZE);
+
+#if defined(CONFIG_SHM_RAW_HISTORY)
+#define RAW_HISTORY_BYTES       ((uint32_t)CONFIG_SHM_RAW_HISTORY_KB * 1024u)
+#define RAW_HISTORY_DRAIN_MS    CONFIG_SHM_RAW_HISTORY_DRAIN_MS
+#endif
+
+static adxl355_raw_sample_t *s_buf = NULL;
+static uint32_t s_cap     = 0;
+static uint32_t s_mask    = 0;
+static bool     s_enabled = false;
+
+/* Drain task */
+static _Atomic uint32_t s_head       = 0;   /* next seq to publish             */
+static _Atomic uint32_t s_reserve    = 0;   /* slots below this may be changing */
+static _Atomic uint32_t s_discard_to  = 0;
+static _Atomic uint32_t s_discard_gen = 0;
+
+/* Data task */
+static _Atomic uint32_t s_tail     = 0;
+static uint32_t         s_seen_gen = 0;
+
+static atomic_bool s_discard_req = false;
+
+/* Stats */
+static volatile uint32_t s_high_water   = 0;
+static volatile uint32_t s_drained      = 0;
+static volatile uint32_t s_full_passes  = 0;
+static volatile uint32_t s_holds        = 0;
+static volatile uint32_t s_max_drain_us = 0;
+
+/******************************************************************************
+ * DRAIN TASK
+ *****************************************************************************/
+
+#if defined(CONFIG_SHM_RAW_HISTORY)
+
+/** @brief Move everything the ISR ring holds (as far as there is room). */
+static void drain_pass(void)
+{
+    if (atomic_load_explicit(&s_discard_req, memory_order_acquire)) {
+        adxl355_isr_ring_discard();
+        atomic_store_explicit(&s_discard_to,
+                              atomic_load_explicit(&s_head, memory_order_relaxed),
+                              memory_order_relaxed);
+        atomic_fetch_add_explicit(&s_discard_gen, 1u, memory_order_release);
+        atomic_store_explicit(&s_discard_req, false, memory_order_release);
+    }
+
+    uint32_t head = atomic_load_explicit(&s_head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&s_tail, memory_order_acquire);
+    uint32_t room = s_cap - (head - tail);
+
+    const adxl355_raw_sample_t *span;
+    uint32_t n;
+    uint32_t moved = 0;
+    while ((n = adxl355_isr_ring_peek(&span)) > 0) {
+        if (room == 0) {
+            s_full_passes++;
+            break;
+        }
+        if (n > room) {
+            n = room;
+        }
+
+        /* Announce the overwrite before touching the slots */
+        atomic_store_explicit(&s_reserve, head + n, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+
+        uint32_t idx   = head & s_mask;
+        uint32_t first = s_cap - idx;
+        if (first > n) {
+            first = n;
+        }
+        memcpy(&s_buf[idx], span, first * sizeof(*span));
+        memcpy(&s_buf[0], span + first, (n - first) * sizeof(*span));
+
+        head += n;
+        room -= n;
+        atomic_store_explicit(&s_head, head, memory_order_release);
+        adxl355_isr_ring_commit(n);
+        s_drained += n;
+        moved     += n;
+    }
+    sensor_data_note_ready(moved);
+
+    uint32_t unread = head - tail;
+    if (unread > s_high_water) {
+        s_high_water = unread;
+    }
+}
+
+static void raw_history_task(void *arg)
+{
+    (void)arg;
+
+    TickType_t period = pdMS_TO_TICKS(RAW_HISTORY_DRAIN_MS);
+    if (period == 0) {
+        period = 1;
+    }
+
+    TickType_t last = xTaskGetTickCount();
+    for (;;) {
+        vTaskDelayUntil(&last, period);
+
+        int64_t t0 = esp_timer_get_time();
+        drain_pass();
+        uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+        if (us > s_max_drain_us) {
+            s_max_drain_us = us;
+        }
+    }
+}
+#endif
+
+/******************************************************************************
+ * LIVE CONSUMER (data task)
+ *****************************************************************************/
+
+/** @brief Current read index, after catching up with a completed discard. */
+static inline uint32_t live_tail(void)
+{
+    uint32_t tail = atomic_load_explicit(&s_tail, memory_order_relaxed);
+    uint32_t gen  = atomic_load_explicit(&s_discard_gen, memory_order_acquire);
+    if (gen != s_seen_gen) {
+        s_seen_gen = gen;
+        tail = atomic_load_explicit(&s_discard_to, memory_order_relaxed);
+        atomic_store_explicit(&s_tail, tail, memory_order_release);
+    }
+    return tail;
+}
+
+uint32_t raw_history_peek(const adxl355_raw_sample_t **span)
+{
+    *span = s_buf;
+    if (!s_enabled || atomic_load_explicit(&s_discard_req, memory_order_acquire)) {
+        return 0;
+    }
+
+    uint32_t tail  = live_tail();
+    uint32_t head  = atomic_load_explicit(&s_head, memory_order_acquire);
+    uint32_t idx   = tail & s_mask;
+    uint32_t n     = head - tail;
+    uint32_t first = s_cap - idx;
+    *span = &s_buf[idx];
+    return (n < first) ? n : first;
+}
+
+void raw_history_commit(uint32_t count)
+{
+    if (!s_enabled) {
+        return;
+    }
+    uint32_t tail = live_tail();
+    uint32_t head = atomic_load_explicit(&s_head, memory_order_acquire);
+    if (count > head - tail) {
+        count = head - tail;
+    }
+    atomic_store_explicit(&s_tail, tail + count, memory_order_release);
+}
+
+uint32_t raw_history_read(adxl355_raw_sample_t *buf, uint32_t max)
+{
+    uint32_t total = 0;
+    while (total < max) {
+        const adxl355_raw_sample_t *span;
+        uint32_t n = raw_history_peek(&span);
+        if (n == 0) {
+            break;
+        }
+        if (n > max - total) {
+            n = max - total;
+        }
+        memcpy(buf + total, span, n * sizeof(*span));
+        raw_history_commit(n);
+        total += n;
+    }
+    return total;
+}
+
+uint32_t raw_history_unread(void)
+{
+    if (!s_enabled || atomic_load_explicit(&s_discard_req, memory_order_acquire)) {
+        return 0;
+    }
+    /* Callable from any task, so read without catching up */
+    uint32_t tail = (atomic_load_explicit(&s_discard_gen, memory_order_acquire) != s_seen_gen)
+                    ? atomic_load_explicit(&s_discard_to, memory_order_relaxed)
+                    : atomic_load_explicit(&s_tail, memory_order_relaxed);
+    return atomic_load_explicit(&s_head, memory_order_acquire) - tail;
+}
+
+uint32_t raw_history_discard(void)
+{
+    if (!s_enabled) {
+        return 0;
+    }
+    uint32_t n = raw_history_unread();
+    atomic_store_explicit(&s_discard_req, true, memory_order_release);
+    return n;
+}
+
+uint32_t raw_history_seq_of(const adxl355_raw_sample_t *sample)
+{
+    uint32_t tail = atomic_load_explicit(&s_tail, memory_order_relaxed);
+    uint32_t idx  = (uint32_t)(sample - s_buf);
+    return tail + ((idx - (tail & s_mask)) & s_mask);
+}
+
+bool raw_history_may_hold(void)
+{
+    return s_enabled &&
+           raw_history_unread() < (uint32_t)(((uint64_t)s_cap * RAW_HISTORY_HOLD_MAX_PCT) / 100u);
+}
+
+void raw_history_note_hold(void)
+{
+    s_holds++;
+}
+
+/******************************************************************************
+ * READERS BY SEQUENCE
+ *****************************************************************************/
+
+uint32_t raw_history_read_at(uint32_t seq, adxl355_raw_sample_t *buf, uint32_t n)
+{
+    if (!s_enabled || n == 0) {
+        return 0;
+    }
+
+    uint32_t head  = atomic_load_explicit(&s_head, memory_order_acquire);
+    uint32_t ahead = head - seq;
+    if ((int32_t)ahead <= 0 || ahead > s_cap) {
+        return 0;   /* not written yet, or long overwritten */
+    }
+    if (n > ahead) {
+        n = ahead;
+    }
+
+    uint32_t idx   = seq & s_mask;
+    uint32_t first = s_cap - idx;
+    if (first > n) {
+        first = n;
+    }
+    memcpy(buf, &s_buf[idx], first * sizeof(*buf));
+    memcpy(buf + first, &s_buf[0], (n - first) * sizeof(*buf));
+
+    /* Was any of it overwritten while we copied? */
+    atomic_thread_fence(memory_order_acquire);
+    uint32_t reserve = atomic_load_explicit(&s_reserve, memory_order_relaxed);
+    if ((int32_t)(seq - (reserve - s_cap)) < 0) {
+        return 0;
+    }
+    return n;
+}
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+esp_err_t raw_history_init(void)
+{
+#if defined(CONFIG_SHM_RAW_HISTORY)
+    if (s_enabled) {
+        return ESP_OK;
+    }
+
+    /* Largest power of two that fits the configured size */
+    uint32_t cap = 1;
+    while (cap * 2u * sizeof(adxl355_raw_sample_t) <= RAW_HISTORY_BYTES) {
+        cap *= 2u;
+    }
+
+    s_buf = heap_caps_malloc(cap * sizeof(adxl355_raw_sample_t),
+                             MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (s_buf == NULL) {
+        ESP_LOGW(TAG, "No PSRAM for %lu KiB history — data task reads the ISR ring",
+                 (unsigned long)(RAW_HISTORY_BYTES / 1024u));
+        return ESP_OK;
+    }
+    s_cap  = cap;
+    s_mask = cap - 1u;
+
+    /* Whatever the ISR queued before now is from before recording */
+    adxl355_isr_ring_discard();
+
+    TaskHandle_t task = mem_budget_task_create("raw_history", &s_task_mem,
+                                                raw_history_task, "raw_hist", NULL,
+                                                RAW_HISTORY_TASK_PRIORITY,
+                                                RAW_HISTORY_TASK_CORE);
+    if (task == NULL) {
+        ESP_LOGE(TAG, "Failed to create drain task");
+        heap_caps_free(s_buf);
+        s_buf = NULL;
+        s_cap = s_mask = 0;
+        return ESP_FAIL;
+    }
+
+    s_enabled = true;
+    mem_budget_record("raw_history", MEM_REGION_PSRAM, s_cap * sizeof(adxl355_raw_sample_t));
+    sensor_data_set_external_source(true);
+    ESP_LOGI(TAG, "Raw history: %lu samples (%lu KiB PSRAM), drained every %d ms",
+             (unsigned long)s_cap,
+             (unsigned long)(s_cap * sizeof(adxl355_raw_sample_t) / 1024u),
+             RAW_HISTORY_DRAIN_MS);
+    return ESP_OK;
+#else
+    ESP_LOGI(TAG, "Raw history compiled out (CONFIG_SHM_RAW_HISTORY)");
+    return ESP_OK;
+#endif
+}
+
+bool raw_history_enabled(void)
+{
+    return s_enabled;
+}
+
+uint32_t raw_history_capacity(void)
+{
+    return s_cap;
+}
+
+void raw_history_get_stats(raw_history_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    stats->enabled      = s_enabled;
+    stats->capacity     = s_cap;
+    stats->unread       = raw_history_unread();
+    stats->high_water   = s_high_water;
+    stats->drained      = s_drained;
+    stats->full_passes  = s_full_passes;
+    stats->holds        = s_holds;
+    stats->max_drain_us = s_max_drain_us;
+}
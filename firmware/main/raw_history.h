@@ -0,0 +1,148 @@
+/**
+ * @file raw_history.h
+ * @brief PSRAM tier of the ADXL355 acquisition buffer.
+ *
+ * The ISR ring in sensor_task.c sits in internal RAM and holds well under a
+ * second at 4 kHz (CONFIG_SHM_ADXL355_RING_SAMPLES). Behind it this module
+ * keeps a much larger ring in PSRAM (CONFIG_SHM_RAW_HISTORY_KB, tens of
+ * seconds to minutes):
+ *
+ *   ISR -> ISR ring (SRAM) --drain task, memcpy--> history (PSRAM) -> data task
+ *                                                          \-> event capture
+ *
+ * Every CONFIG_SHM_RAW_HISTORY_DRAIN_MS the drain task copies whatever the
+ * ISR ring holds into the history. It never overwrites a sample the data
+ * task has not consumed yet. If the history is full of unread samples the
+ * copy stops, and the ISR ring overflows as before and counts the loss.
+ * The drain task also takes over the data-ready wakeups (sensor_task.h:
+ * DATA READY), so the data task wakes when samples are actually readable.
+ *
+ * Samples are numbered by a free-running 32-bit sequence. The data task is
+ * the live consumer: the adxl355_peek/commit/read functions in sensor_task.h
+ * route here while the history is enabled. Samples it has consumed stay
+ * readable by sequence until the drain task wraps over them, so other
+ * readers (event capture) copy their window out with raw_history_read_at()
+ * instead of keeping a ring of their own.
+ *
+ * Holding back: while no publish slot is free but publishing is possible,
+ * the data task leaves samples in the history instead of decimating them
+ * into a dropped packet, up to RAW_HISTORY_HOLD_MAX_PCT of the capacity.
+ * A publish stall shorter than that costs latency only, not data.
+ *
+ * Without CONFIG_SHM_RAW_HISTORY, or without PSRAM at runtime, the module
+ * stays disabled. The data task then reads the ISR ring directly.
+ */
+
+#ifndef RAW_HISTORY_H
+#define RAW_HISTORY_H
+
+#include "esp_err.h"
+#include "cpu_topology.h"
+#include "sensor_task.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * CONFIGURATION
+ *****************************************************************************/
+
+/** Stop holding samples back for a publish slot beyond this fill level. */
+#define RAW_HISTORY_HOLD_MAX_PCT        75u
+
+/* Above the data task, below the acquisition task */
+#define RAW_HISTORY_TASK_STACK_SIZE     2048
+#define RAW_HISTORY_TASK_PRIORITY       6
+#define RAW_HISTORY_TASK_CORE           SHM_CORE_ACQ
+
+typedef struct {
+    bool     enabled;
+    uint32_t capacity;       /**< Samples                                     */
+    uint32_t unread;         /**< Waiting for the data task                   */
+    uint32_t high_water;     /**< Max unread since boot                       */
+    uint32_t drained;        /**< Samples copied from the ISR ring            */
+    uint32_t full_passes;    /**< Drain passes that found no room             */
+    uint32_t holds;          /**< Data task passes held back for a slot       */
+    uint32_t max_drain_us;   /**< Longest drain pass                          */
+} raw_history_stats_t;
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * @brief Allocate the PSRAM ring and start the drain task.
+ *
+ * Call after sensor_acquisition_init() and before the data task starts.
+ * @return ESP_OK also when the history is compiled out or no PSRAM is
+ *         found (the module then stays disabled), ESP_FAIL if the task
+ *         cannot be created.
+ */
+esp_err_t raw_history_init(void);
+
+/** @brief True once the history is the live buffer (after raw_history_init()). */
+bool raw_history_enabled(void);
+
+uint32_t raw_history_capacity(void);
+
+/* ---- Live consumer (data task, through sensor_task.h) ---- */
+
+/** @brief Zero-copy view of the oldest contiguous run of unread samples. */
+uint32_t raw_history_peek(const adxl355_raw_sample_t **span);
+
+/** @brief Release count samples (clamped to what is unread). */
+void raw_history_commit(uint32_t count);
+
+/** @brief Copy up to max unread samples out and release them. */
+uint32_t raw_history_read(adxl355_raw_sample_t *buf, uint32_t max);
+
+/** @brief Unread samples (0 while a discard is pending). */
+uint32_t raw_history_unread(void);
+
+/**
+ * @brief Drop everything unread, in both tiers.
+ *
+ * Takes effect on the next drain pass, which also empties the ISR ring
+ * (the drain task is that ring's consumer). Until then peek returns 0, so no
+ * sample from before the call reaches the data task.
+ *
+ * @return Samples discarded from the history now
+ */
+uint32_t raw_history_discard(void);
+
+/**
+ * @brief Sequence number of an unread sample seen through raw_history_peek().
+ */
+uint32_t raw_history_seq_of(const adxl355_raw_sample_t *sample);
+
+/** @brief True while the data task should hold samples back (see above). */
+bool raw_history_may_hold(void);
+
+/** @brief Count one held-back data task pass (for the stats). */
+void raw_history_note_hold(void);
+
+/* ---- Readers by sequence (any task) ---- */
+
+/**
+ * @brief Copy samples [seq, seq + n) out of the history.
+ *
+ * Consumed samples stay readable until the drain task wraps over them.
+ * The copy is checked after the fact, so a sample overwritten while it was
+ * being copied is never returned.
+ *
+ * @return Samples copied from the front of the range (0 if seq is already
+ *         overwritten or the module is disabled). Fewer than n when the
+ *         range runs past the newest sample written.
+ */
+uint32_t raw_history_read_at(uint32_t seq, adxl355_raw_sample_t *buf, uint32_t n);
+
+void raw_history_get_stats(raw_history_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RAW_HISTORY_H
@@ -1,9 +1,12 @@
 /**
  * @file scl3300.c
- * @brief SCL3300-D01 Inclinometer Driver (SPI) - manual CS version
+ * @brief SCL3300-D01 Inclinometer Driver (SPI)
  *
- * This version uses MANUAL chip select for SCL3300 because automatic CS handling
- * on the shared SPI bus was interfering with ADXL355 transactions.
+ * Chip select is selected by SCL3300_HW_CS. The manual variant exists because
+ * a manually driven SCL3300 CS on the shared bus used to race the ADXL355
+ * transactions; with hardware CS the peripheral owns the pin, nothing else
+ * writes it, and the required CS-high gap between frames is enforced by the
+ * device pre-transfer callback instead of by GPIO toggles.
  *
  * Features:
  *  - Correct SPI command frames from Table 15
@@ -28,6 +31,8 @@
 
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
 
 #include <string.h>
 #include <inttypes.h>
@@ -44,6 +49,35 @@ static const float ACCEL_SCALE_MODE1 = 6000.0f;
 // Current mode (default Mode 1)
 static float s_current_accel_scale = ACCEL_SCALE_MODE1;
 
+#if SCL3300_HW_CS
+
+/* ---------- Hardware CS frame spacing ---------- */
+
+// End of the previous frame (esp_timer us). The SPI driver may run the
+// callbacks on either core, so the shared esp_timer is used, not CCOUNT.
+static volatile int64_t s_last_frame_end_us = 0;
+
+static void IRAM_ATTR scl3300_pre_cb(spi_transaction_t *t)
+{
+    (void)t;
+    int64_t ready = s_last_frame_end_us + SCL3300_CS_HIGH_MIN_US;
+    while (esp_timer_get_time() < ready) {
+        /* at most SCL3300_CS_HIGH_MIN_US, only between back-to-back frames */
+    }
+}
+
+static void IRAM_ATTR scl3300_post_cb(spi_transaction_t *t)
+{
+    (void)t;
+    s_last_frame_end_us = esp_timer_get_time();
+}
+
+static inline void scl3300_cs_init(void) {}
+static inline void scl3300_cs_low(void) {}
+static inline void scl3300_cs_high(void) {}
+
+#else
+
 /* ---------- Manual CS helpers ---------- */
 
 static inline void scl3300_cs_init(void)
@@ -62,11 +96,13 @@ static inline void scl3300_cs_high(void)
     gpio_set_level(SPI_CS_SCL3300_IO, 1);
 }
 
+#endif /* SCL3300_HW_CS */
+
 /**
  * @brief Transfer a 32-bit command and receive a 32-bit response
  *
  * Uses SPI_TRANS_USE_TXDATA/RXDATA to avoid dynamic allocation.
- * Uses MANUAL CS.
+ * CS per SCL3300_HW_CS.
  *
  * @param cmd 32-bit command with CRC
  * @param response Pointer to store 32-bit response (can be NULL)
@@ -90,9 +126,11 @@ static esp_err_t scl3300_transfer(uint32_t cmd, uint32_t *response)
     t.tx_data[2] = (uint8_t)((cmd >> 8) & 0xFF);
     t.tx_data[3] = (uint8_t)(cmd & 0xFF);
 
+    spi_bus_lock();
     scl3300_cs_low();
     esp_err_t ret = spi_device_polling_transmit(s_scl3300, &t);
     scl3300_cs_high();
+    spi_bus_unlock();
 
     if (ret != ESP_OK) {
         return ret;
@@ -152,6 +190,40 @@ static uint8_t scl3300_extract_rs(uint32_t spi_response)
     return (uint8_t)((spi_response >> 24) & 0x03u);
 }
 
+/**
+ * @brief Add the device to the shared bus at clock_hz
+ */
+static esp_err_t scl3300_add_device(uint32_t clock_hz)
+{
+    spi_device_interface_config_t devcfg = {
+        .clock_speed_hz = (int)clock_hz,
+        .mode = 0,              // CPOL=0, CPHA=0
+#if SCL3300_HW_CS
+        .spics_io_num = SPI_CS_SCL3300_IO,
+        .cs_ena_pretrans = 1,   // CS setup before first SCLK edge
+        .cs_ena_posttrans = 2,  // CS hold after last SCLK edge
+        .queue_size = SCL3300_SPI_QUEUE_SIZE,
+        .pre_cb = scl3300_pre_cb,
+        .post_cb = scl3300_post_cb,
+#else
+        .spics_io_num = -1,     // manual CS
+        .queue_size = 1,
+#endif
+        .command_bits = 0,
+        .address_bits = 0,
+    };
+
+    esp_err_t ret = spi_bus_add_device(spi_bus_get_host(), &devcfg, &s_scl3300);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "spi_bus_add_device failed: %s", esp_err_to_name(ret));
+        s_scl3300 = NULL;
+        return ret;
+    }
+
+    scl3300_spi_handle = s_scl3300;  // Expose handle for ISR
+    return ESP_OK;
+}
+
 /**
  * @brief Initialize the SCL3300 inclinometer
  *
@@ -165,22 +237,10 @@ esp_err_t scl3300_init(void)
     if (s_scl3300 == NULL) {
         scl3300_cs_init();
 
-        spi_device_interface_config_t devcfg = {
-            .clock_speed_hz = SCL3300_SPI_CLOCK_HZ,
-            .mode = 0,              // CPOL=0, CPHA=0
-            .spics_io_num = -1,     // manual CS
-            .queue_size = 1,
-            .command_bits = 0,
-            .address_bits = 0,
-        };
-
-        esp_err_t ret = spi_bus_add_device(spi_bus_get_host(), &devcfg, &s_scl3300);
+        esp_err_t ret = scl3300_add_device(spi_bus_get_clock_hz(SPI_BUS_DEV_SCL3300));
         if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "spi_bus_add_device failed: %s", esp_err_to_name(ret));
             return ret;
         }
-
-        scl3300_spi_handle = s_scl3300;  // Expose handle for ISR
     }
 
     // === Datasheet Table 11: Start-up Sequence ===
@@ -387,6 +447,50 @@ esp_err_t scl3300_read_whoami(uint16_t *whoami)
     return ESP_OK;
 }
 
+/**
+ * @brief Re-add the device at clock_hz (spi_bus.h clock profiles)
+ */
+esp_err_t scl3300_set_spi_clock(uint32_t clock_hz)
+{
+    if (s_scl3300 == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // The clock is fixed per device handle: re-add the device
+    scl3300_spi_handle = NULL;
+    esp_err_t ret = spi_bus_remove_device(s_scl3300);
+    if (ret != ESP_OK) {
+        scl3300_spi_handle = s_scl3300;
+        return ret;
+    }
+    s_scl3300 = NULL;
+
+    ret = scl3300_add_device(clock_hz);
+    if (ret != ESP_OK) {
+        // Keep the sensor reachable at the rate it had
+        (void)scl3300_add_device(spi_bus_get_clock_hz(SPI_BUS_DEV_SCL3300));
+    }
+    return ret;
+}
+
+/**
+ * @brief One known-answer WHOAMI read: both frames CRC-valid, ID correct
+ */
+bool scl3300_probe_link(void)
+{
+    uint32_t prev = 0;
+    uint32_t resp = 0;
+
+    if (scl3300_transfer(SCL3300_CMD_READ_WHOAMI, &prev) != ESP_OK ||
+        scl3300_transfer(SCL3300_CMD_READ_WHOAMI, &resp) != ESP_OK) {
+        return false;
+    }
+
+    return scl3300_frame_crc_ok(prev) &&
+           scl3300_frame_crc_ok(resp) &&
+           ((resp >> 8) & 0xFFFFu) == SCL3300_WHOAMI_VALUE;
+}
+
 /**
  * @brief Self-test: read the STO (self-test output) register and verify
  *        the RS bits indicate normal operation.
@@ -13,7 +13,7 @@
  * - MISO: GPIO15 (shared SPI_MISO_IO)
  * - SCLK: GPIO14 (shared SPI_SCLK_IO)
  * - SPI Mode: 0 (CPOL=0, CPHA=0)
- * - Clock: 2 MHz (recommended for best noise performance)
+ * - Clock: 2 MHz at boot, then tuned up to 4 MHz (spi_bus.h clock profiles)
  * 
  * Hardware Requirements:
  * - VDD: 3.0-3.6V
@@ -25,6 +25,7 @@
 #define SCL3300_H
 
 #include "esp_err.h"
+#include <stdbool.h>
 #include <stdint.h>
 #include "driver/spi_master.h"
 extern spi_device_handle_t scl3300_spi_handle;
@@ -33,9 +34,18 @@ extern spi_device_handle_t scl3300_spi_handle;
 extern "C" {
 #endif
 
-// Default per-device SPI clock for SCL3300 on the shared bus
-// Using 2 MHz for optimal noise performance (datasheet recommendation)
-#define SCL3300_SPI_CLOCK_HZ   (2 * 1000 * 1000)
+// The per-device SPI clock comes from the SCL3300 profile in spi_bus.c:
+// added at 2 MHz, tuned between 1 and 4 MHz after init
+
+// Chip-select ownership. 1 = the SPI peripheral drives CS (spics_io_num) and
+// frames can be queued back-to-back; 0 = legacy manual GPIO CS around every
+// frame. With hardware CS the driver's pre-transfer callback holds CS high for
+// at least SCL3300_CS_HIGH_MIN_US between frames (datasheet: 10 us minimum).
+#define SCL3300_HW_CS           1
+#define SCL3300_CS_HIGH_MIN_US  10
+
+// Transactions the driver may hold in flight: one full angle sequence
+#define SCL3300_SPI_QUEUE_SIZE  3
 
 // ============== SCL3300 Commands (Full 32-bit SPI frames with CRC) ==============
 // These values are from datasheet Table 15 - do NOT modify
@@ -90,6 +100,26 @@ extern "C" {
 #define SCL3300_RS_RESERVED         0x02u  // Reserved
 #define SCL3300_RS_ERROR            0x03u  // Error
 
+/**
+ * @brief Check the CRC byte [7:0] of a response frame.
+ *
+ * CRC-8 over bits [31:8], polynomial 0x1D, seed 0xFF, inverted; the same
+ * CRC the command frames above carry. Inline so the ISR engines can call it.
+ */
+static inline __attribute__((always_inline)) bool scl3300_frame_crc_ok(uint32_t frame)
+{
+    uint8_t crc = 0xFF;
+    for (int bit = 31; bit >= 8; bit--) {
+        uint8_t in = (uint8_t)((frame >> bit) & 1u);
+        uint8_t top = (uint8_t)(crc >> 7);
+        crc = (uint8_t)(crc << 1);
+        if (in ^ top) {
+            crc ^= 0x1D;
+        }
+    }
+    return (uint8_t)~crc == (uint8_t)(frame & 0xFFu);
+}
+
 // Data Structure for Angle Output
 typedef struct {
     float x;    // X-axis angle in degrees
@@ -183,6 +213,21 @@ esp_err_t scl3300_read_whoami(uint16_t *whoami);
  */
 esp_err_t scl3300_selftest(bool *passed);
 
+/**
+ * @brief Re-add the device on the bus at clock_hz (spi_bus.h clock profiles).
+ *
+ * Acquisition must not be reading the sensor. On failure the device is put
+ * back at its previous rate.
+ */
+esp_err_t scl3300_set_spi_clock(uint32_t clock_hz);
+
+/**
+ * @brief One known-answer read: WHOAMI, both frames CRC-checked.
+ *
+ * @return true when the frames are CRC-valid and WHOAMI reads 0x00C1.
+ */
+bool scl3300_probe_link(void);
+
 #ifdef __cplusplus
 }
 #endif
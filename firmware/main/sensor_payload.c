@@ -0,0 +1,411 @@
+/**
+ * @file sensor_payload.c
+ * @brief JSON and binary (v1 / v2) encoding of a sensor packet (see sensor_payload.h).
+ */
+
+#include "sensor_payload.h"
+#include "accel_pack.h"
+#include "json_writer.h"
+#include "esp_log.h"
+#include <math.h>
+#include <string.h>
+#include <sys/param.h>       // MIN()
+
+static const char *TAG = "PAYLOAD";
+
+/******************************************************************************
+ * ACCEL SUMMARY
+ *****************************************************************************/
+
+void mqtt_accel_summary_finish(mqtt_accel_summary_t *s, uint16_t nan)
+{
+    s->nan = nan;
+    for (int a = 0; a < 3; a++) {
+        if (s->real == 0) {
+            s->min[a] = s->max[a] = s->mean[a] = 0;
+            s->rms[a] = 0;
+            continue;
+        }
+        int64_t sum = s->sum[a];
+        int64_t n   = s->real;
+        s->mean[a] = (int32_t)((sum >= 0 ? sum + n / 2 : sum - n / 2) / n);
+        s->rms[a]  = (uint32_t)lrintf(sqrtf((float)(s->sum_sq[a] / (uint64_t)n)));
+    }
+    s->valid = true;
+}
+
+/******************************************************************************
+ * BINARY FRAME
+ *****************************************************************************/
+
+/**
+ * @brief Append n bytes to a binary frame (ESP32 is little-endian, so
+ *        native integers already match the wire format).
+ */
+static inline uint8_t *bin_put(uint8_t *p, const void *v, size_t n)
+{
+    memcpy(p, v, n);
+    return p + n;
+}
+
+/** @brief Clamp a tick delta into the i16 field used by inclination samples. */
+static inline int16_t bin_dtick16(uint32_t tick, uint32_t base_tick)
+{
+    int32_t d = (int32_t)(tick - base_tick);
+    if (d >  INT16_MAX) d = INT16_MAX;
+    if (d < -INT16_MAX) d = -INT16_MAX;
+    return (int16_t)d;
+}
+
+esp_err_t sensor_payload_encode_binary(const mqtt_sensor_packet_t *packet,
+                                       bool packed, uint32_t serial_hash,
+                                       char *buf, size_t cap, size_t *out_len)
+{
+    uint8_t accel_n = (packet->accel_valid && packet->accel_count > 0)
+                      ? (uint8_t)MIN(packet->accel_count, MQTT_ACCEL_BATCH_SIZE) : 0;
+    uint8_t incl_n  = (packet->incl_valid && packet->incl_count > 0)
+                      ? (uint8_t)MIN(packet->incl_count, MQTT_INCL_BATCH_SIZE) : 0;
+    uint8_t gap_n   = (uint8_t)MIN(packet->gap_count, MQTT_MAX_GAPS);
+
+    size_t accel_max = packed ? 2u + (accel_n ? ACCEL_PACK_MAX_BYTES(accel_n) : 0u)
+                              : (size_t)accel_n * 12u;
+    size_t need = MQTT_BIN_HEADER_LEN + accel_max
+                + (size_t)incl_n * 8u + (packet->has_temp ? 6u : 0u)
+                + (packet->send_utc_us ? 8u : 0u)
+                + (packet->accel_sum.valid ? MQTT_BIN_SUMMARY_LEN : 0u)
+                + (gap_n ? 1u + (size_t)gap_n * MQTT_BIN_GAP_LEN : 0u);
+    if (need > cap) {
+        ESP_LOGE(TAG, "Binary frame too large (%u bytes)", (unsigned)need);
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint8_t flags = 0;
+    if (accel_n > 0)          flags |= MQTT_BIN_FLAG_ACCEL_VALID;
+    if (incl_n > 0)           flags |= MQTT_BIN_FLAG_INCL_VALID;
+    if (packet->has_temp)     flags |= MQTT_BIN_FLAG_HAS_TEMP;
+    if (packet->temp_valid)   flags |= MQTT_BIN_FLAG_TEMP_VALID;
+    if (packet->send_utc_us)  flags |= MQTT_BIN_FLAG_SEND_TS;
+    if (packet->accel_sum.valid) flags |= MQTT_BIN_FLAG_SUMMARY;
+    if (gap_n > 0)            flags |= MQTT_BIN_FLAG_GAPS;
+
+    uint8_t *p = (uint8_t *)buf;
+    uint8_t  magic    = MQTT_BIN_MAGIC;
+    uint8_t  version  = packed ? MQTT_BIN_VERSION_PACKED : MQTT_BIN_VERSION;
+    uint32_t seq      = packet->seq;
+    uint16_t odr      = (uint16_t)packet->odr_hz;
+
+    p = bin_put(p, &magic,                       1);
+    p = bin_put(p, &version,                     1);
+    p = bin_put(p, &flags,                       1);
+    p = bin_put(p, &packet->range,               1);
+    p = bin_put(p, &serial_hash,                 4);
+    p = bin_put(p, &seq,                         4);
+    p = bin_put(p, &packet->base_tick,           4);
+    p = bin_put(p, &packet->base_utc_us,         8);
+    p = bin_put(p, &odr,                         2);
+    p = bin_put(p, &packet->decim,               1);
+    p = bin_put(p, &accel_n,                     1);
+    p = bin_put(p, &packet->accel_period_ticks,  2);
+    p = bin_put(p, &incl_n,                      1);
+    p = bin_put(p, &packet->cfg_epoch,           1);
+
+    /* Gap samples already hold MQTT_ACCEL_INVALID, so neither accel path
+     * needs to look at the validity map */
+    if (packed) {
+        const int32_t *const axis[3] = { packet->accel[0], packet->accel[1], packet->accel[2] };
+        uint16_t accel_bytes = accel_n
+            ? (uint16_t)accel_pack_encode(axis, accel_n, p + 2, ACCEL_PACK_MAX_BYTES(accel_n))
+            : 0;
+        p = bin_put(p, &accel_bytes, 2);
+        p += accel_bytes;
+    } else {
+        for (int i = 0; i < accel_n; i++) {
+            p = bin_put(p, &packet->accel[0][i], 4);
+            p = bin_put(p, &packet->accel[1][i], 4);
+            p = bin_put(p, &packet->accel[2][i], 4);
+        }
+    }
+
+    for (int i = 0; i < incl_n; i++) {
+        int16_t dt = bin_dtick16(packet->incl_tick[i], packet->base_tick);
+        p = bin_put(p, &dt,                  2);
+        p = bin_put(p, &packet->incl[0][i],  2);
+        p = bin_put(p, &packet->incl[1][i],  2);
+        p = bin_put(p, &packet->incl[2][i],  2);
+    }
+
+    if (packet->has_temp) {
+        int32_t dt    = (int32_t)(packet->temp_tick - packet->base_tick);
+        int16_t centi = packet->temp_valid
+                        ? (int16_t)lrintf(packet->temperature * 100.0f) : 0;
+        p = bin_put(p, &dt,    4);
+        p = bin_put(p, &centi, 2);
+    }
+
+    if (packet->send_utc_us) {
+        p = bin_put(p, &packet->send_utc_us, 8);
+    }
+
+    if (packet->accel_sum.valid) {
+        const mqtt_accel_summary_t *sum = &packet->accel_sum;
+        uint8_t real = (uint8_t)MIN(sum->real, UINT8_MAX);
+        uint8_t nan  = (uint8_t)MIN(sum->nan,  UINT8_MAX);
+        p = bin_put(p, &real,     1);
+        p = bin_put(p, &nan,      1);
+        p = bin_put(p, sum->min,  12);
+        p = bin_put(p, sum->max,  12);
+        p = bin_put(p, sum->mean, 12);
+        p = bin_put(p, sum->rms,  12);
+    }
+
+    if (gap_n > 0) {
+        p = bin_put(p, &gap_n, 1);
+        for (int i = 0; i < gap_n; i++) {
+            const mqtt_gap_t *g = &packet->gaps[i];
+            int32_t dt = (int32_t)(g->start_tick - packet->base_tick);
+            p = bin_put(p, &g->sensor, 1);
+            p = bin_put(p, &g->reason, 1);
+            p = bin_put(p, &dt,        4);
+            p = bin_put(p, &g->dur_us, 4);
+        }
+    }
+
+    *out_len = (size_t)(p - (uint8_t *)buf);
+    ESP_LOGD(TAG, "Encoded %u-byte binary frame seq=%lu (accel=%u, incl=%u)",
+             (unsigned)*out_len, (unsigned long)seq, accel_n, incl_n);
+    return ESP_OK;
+}
+
+/******************************************************************************
+ * JSON
+ *****************************************************************************/
+
+/**
+ * @brief Append a quoted sample timestamp, formatted in place in the payload.
+ *
+ * The caller has reserved JW_SAMPLE_MAX_LEN, which covers TS_ISO_MIN_LEN.
+ */
+static void jw_put_tick_ts(json_writer_t *w, const ts_anchor_t *anchor,
+                           ts_iso_cursor_t *cur, uint32_t tick)
+{
+    jw_putc(w, '"');
+    ts_format_tick(anchor, cur, tick, w->buf + w->len);
+    w->len += strlen(w->buf + w->len);
+    jw_putc(w, '"');
+}
+
+/** @brief As jw_put_tick_ts() for a UTC time; "tick:disconnected" if unsynced. */
+static void jw_put_utc_ts(json_writer_t *w, const ts_anchor_t *anchor,
+                          ts_iso_cursor_t *cur, int64_t utc_us)
+{
+    if (!ts_anchor_synced(anchor)) {
+        jw_put_lit(w, "\"tick:disconnected\"");
+        return;
+    }
+    jw_putc(w, '"');
+    ts_iso_format(cur, utc_us, w->buf + w->len);
+    w->len += TS_ISO_MIN_LEN - 1;
+    jw_putc(w, '"');
+}
+
+/** @brief Append ,"s":{...}, the packet's accel summary, in g. */
+static bool jw_put_summary(json_writer_t *w, const mqtt_sensor_packet_t *packet)
+{
+    static const char *const keys[] = { ",\"min\":[", "],\"max\":[", "],\"mean\":[", "],\"rms\":[" };
+    const mqtt_accel_summary_t *sum = &packet->accel_sum;
+    const int32_t *const cols[] = { sum->min, sum->max, sum->mean };
+    int64_t lsb_per_g = packet->accel_lsb_per_g ? packet->accel_lsb_per_g : 256000;
+
+    if (!jw_reserve(w, 256)) {
+        return false;
+    }
+    jw_put_lit(w, ",\"s\":{\"n\":");
+    jw_put_u64(w, sum->real);
+    jw_put_lit(w, ",\"nan\":");
+    jw_put_u64(w, sum->nan);
+    if (sum->real > 0) {
+        for (int c = 0; c < 4; c++) {
+            jw_put_raw(w, keys[c], strlen(keys[c]));
+            for (int a = 0; a < 3; a++) {
+                if (a > 0) {
+                    jw_putc(w, ',');
+                }
+                int64_t v = (c == 3) ? (int64_t)sum->rms[a] : (int64_t)cols[c][a];
+                jw_put_fixed(w, jw_div_round(v * 10000, lsb_per_g), 4);
+            }
+        }
+        jw_putc(w, ']');
+    }
+    jw_putc(w, '}');
+    return true;
+}
+
+esp_err_t sensor_payload_encode_json(const mqtt_sensor_packet_t *packet,
+                                     char *buf, size_t cap, size_t *out_len)
+{
+    /*
+     * JSON FORMAT:
+     * {
+     *   "a": [["ts", x, y, z], ...],           200 samples, [] if a gap below
+     *   "i": [["ts", x, y, z], ...],           20 samples, [] if a gap below
+     *   "T": ["ts", val] | ["ts", NaN],         1 sample
+     *   "e": 3,                                 config epoch (low byte)
+     *   "seq": 1234,                            packet sequence (mqtt.h)
+     *   "st": 1760400000123456,                 send UTC in us, omitted if not synced
+     *   "s": {"n": 200, "nan": 0,               accel summary (mqtt.h): real / NaN
+     *         "min": [x, y, z], "max": [..],    samples, per-axis stats in g;
+     *         "mean": [..], "rms": [..]},       only n and nan when n is 0
+     *   "g": [["ts", 1000000, "a", "disconnected"]], sensor gaps (mqtt.h),
+     *                                           omitted when there are none
+     *   "f": [1, 7]                             optional fault codes
+     * }
+     *
+     * Values are written from integer fixed-point (g and degrees x 10^4,
+     * degC x 10^2) by json_writer; bounds are checked once per record.
+     * Timestamps are rendered from the packet anchor straight into buf.
+     */
+
+    json_writer_t w;
+    jw_init(&w, buf, cap);
+
+    const ts_anchor_t *anchor = &packet->anchor;
+    ts_iso_cursor_t    cursor;
+    ts_iso_cursor_init(&cursor);
+
+    /* ---- Acceleration ---- */
+    if (!jw_reserve(&w, 8)) {
+        ESP_LOGE(TAG, "JSON buffer overflow at packet start!");
+        return ESP_ERR_NO_MEM;
+    }
+    jw_put_lit(&w, "{\"a\":[");
+
+    if (packet->accel_valid && packet->accel_count > 0) {
+        int64_t lsb_per_g = packet->accel_lsb_per_g ? packet->accel_lsb_per_g : 256000;
+        for (int i = 0; i < packet->accel_count && i < MQTT_ACCEL_BATCH_SIZE; i++) {
+            if (!jw_reserve(&w, JW_SAMPLE_MAX_LEN)) {
+                ESP_LOGE(TAG, "JSON buffer overflow at accel sample %d!", i);
+                return ESP_ERR_NO_MEM;
+            }
+            if (i > 0) {
+                jw_putc(&w, ',');
+            }
+            jw_putc(&w, '[');
+            jw_put_tick_ts(&w, anchor, &cursor,
+                           packet->base_tick + (uint32_t)i * packet->accel_period_ticks);
+            if (!mqtt_accel_sample_real(packet, i)) {
+                /* Gap in the sample stream: keep the grid, no values */
+                jw_put_lit(&w, ",NaN,NaN,NaN]");
+                continue;
+            }
+            for (int k = 0; k < 3; k++) {
+                jw_putc(&w, ',');
+                jw_put_fixed(&w, jw_div_round((int64_t)packet->accel[k][i] * 10000,
+                                              lsb_per_g), 4);
+            }
+            jw_putc(&w, ']');
+        }
+    }
+
+    /* ---- Inclination (batched, 20 samples/sec) ---- */
+    if (!jw_reserve(&w, 8)) {
+        ESP_LOGE(TAG, "JSON buffer overflow after accel samples!");
+        return ESP_ERR_NO_MEM;
+    }
+    jw_put_lit(&w, "],\"i\":[");
+
+    if (packet->incl_valid && packet->incl_count > 0) {
+        for (int i = 0; i < packet->incl_count && i < MQTT_INCL_BATCH_SIZE; i++) {
+            if (!jw_reserve(&w, JW_SAMPLE_MAX_LEN)) {
+                ESP_LOGE(TAG, "JSON buffer overflow at incl sample %d!", i);
+                return ESP_ERR_NO_MEM;
+            }
+            if (i > 0) {
+                jw_putc(&w, ',');
+            }
+            jw_putc(&w, '[');
+            jw_put_tick_ts(&w, anchor, &cursor, packet->incl_tick[i]);
+            for (int k = 0; k < 3; k++) {
+                /* 90 deg / 16384 LSB = 28125 / 512 deg x 10^-4 per LSB */
+                jw_putc(&w, ',');
+                jw_put_fixed(&w, jw_div_round((int64_t)packet->incl[k][i] * 28125, 512), 4);
+            }
+            jw_putc(&w, ']');
+        }
+    }
+
+    if (!jw_reserve(&w, 1)) {
+        ESP_LOGE(TAG, "JSON buffer overflow after incl samples!");
+        return ESP_ERR_NO_MEM;
+    }
+    jw_putc(&w, ']');
+
+    /* ---- Temperature (1 sample/sec) ---- */
+    if (packet->has_temp && jw_reserve(&w, JW_SAMPLE_MAX_LEN)) {
+        jw_put_lit(&w, ",\"T\":[");
+        if (packet->temp_valid) {
+            jw_put_tick_ts(&w, anchor, &cursor, packet->temp_tick);
+            jw_putc(&w, ',');
+            jw_put_fixed(&w, (int32_t)lrintf(packet->temperature * 100.0f), 2);
+        } else {
+            /* Sensor disconnected: emit NaN at the packet time */
+            jw_put_utc_ts(&w, anchor, &cursor, anchor->utc_us);
+            jw_put_lit(&w, ",NaN");
+        }
+        jw_putc(&w, ']');
+    }
+
+    if (!jw_reserve(&w, 64)) {
+        ESP_LOGE(TAG, "JSON buffer overflow while closing packet!");
+        return ESP_ERR_NO_MEM;
+    }
+    jw_put_lit(&w, ",\"e\":");
+    jw_put_fixed(&w, packet->cfg_epoch, 0);
+    jw_put_lit(&w, ",\"seq\":");
+    jw_put_u64(&w, packet->seq);
+    if (packet->send_utc_us > 0) {
+        jw_put_lit(&w, ",\"st\":");
+        jw_put_u64(&w, (uint64_t)packet->send_utc_us);
+    }
+    if (packet->accel_sum.valid && !jw_put_summary(&w, packet)) {
+        ESP_LOGE(TAG, "JSON buffer overflow at accel summary!");
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < packet->gap_count && i < MQTT_MAX_GAPS; i++) {
+        const mqtt_gap_t *g = &packet->gaps[i];
+        if (!jw_reserve(&w, JW_SAMPLE_MAX_LEN + 40)) {
+            ESP_LOGE(TAG, "JSON buffer overflow at gap %d!", i);
+            return ESP_ERR_NO_MEM;
+        }
+        jw_put_raw(&w, i == 0 ? ",\"g\":[[" : ",[", i == 0 ? 7 : 2);
+        jw_put_tick_ts(&w, anchor, &cursor, g->start_tick);
+        jw_putc(&w, ',');
+        jw_put_u64(&w, g->dur_us);
+        if (g->sensor == MQTT_GAP_SENSOR_INCL) {
+            jw_put_lit(&w, ",\"i\",");
+        } else {
+            jw_put_lit(&w, ",\"a\",");
+        }
+        if (g->reason == MQTT_GAP_DISCONNECTED) {
+            jw_put_lit(&w, "\"disconnected\"]");
+        } else {
+            jw_put_lit(&w, "\"no_samples\"]");
+        }
+        if (i + 1 == packet->gap_count || i + 1 == MQTT_MAX_GAPS) {
+            jw_putc(&w, ']');
+        }
+    }
+    if (!jw_reserve(&w, 1)) {
+        ESP_LOGE(TAG, "JSON buffer overflow while closing packet!");
+        return ESP_ERR_NO_MEM;
+    }
+    jw_putc(&w, '}');
+    *out_len = w.len;
+
+    ESP_LOGD(TAG, "Encoded %u bytes (accel=%d/%s, incl=%d/%s, temp=%s)",
+             (unsigned)w.len,
+             packet->accel_count, packet->accel_valid ? "ok" : "NaN",
+             packet->incl_count,  packet->incl_valid  ? "ok" : "NaN",
+             packet->temp_valid ? "ok" : "NaN");
+
+    return ESP_OK;
+}
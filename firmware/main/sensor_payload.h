@@ -0,0 +1,52 @@
+/**
+ * @file sensor_payload.h
+ * @brief Encoding of one sensor packet as a JSON document or a binary frame.
+ *
+ * Pure CPU work on an mqtt_sensor_packet_t: no network, no module state.
+ * mqtt_serialize_sensor_data() and mqtt_serialize_sensor_binary() pick the
+ * format and supply the node's serial hash; the payload layouts are
+ * documented in mqtt.h. Kept out of mqtt.c so the host build
+ * (firmware/host_test) can check the encoders against golden outputs;
+ * mqtt_accel_summary_finish() (declared in mqtt.h) lives here for the
+ * same reason.
+ */
+
+#ifndef SENSOR_PAYLOAD_H
+#define SENSOR_PAYLOAD_H
+
+#include "esp_err.h"
+#include "mqtt.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Encode a packet as a binary frame.
+ *
+ * A sensor without data has a cleared *_VALID flag, a zero count and an
+ * entry in the GAPS trailer.
+ *
+ * @param packed       Version 2 frame (accel_pack.h accel block) instead of version 1
+ * @param serial_hash  FNV-1a of the node serial, stamped into the header
+ * @return ESP_ERR_NO_MEM if the frame does not fit in cap.
+ */
+esp_err_t sensor_payload_encode_binary(const mqtt_sensor_packet_t *packet,
+                                       bool packed, uint32_t serial_hash,
+                                       char *buf, size_t cap, size_t *out_len);
+
+/**
+ * @brief Encode a packet as a JSON document.
+ * @return ESP_ERR_NO_MEM if the document does not fit in cap.
+ */
+esp_err_t sensor_payload_encode_json(const mqtt_sensor_packet_t *packet,
+                                     char *buf, size_t cap, size_t *out_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SENSOR_PAYLOAD_H
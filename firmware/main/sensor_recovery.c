@@ -0,0 +1,356 @@
+/**
+ * @file sensor_recovery.c
+ * @brief Hot-plug reinit of the SPI sensors (see sensor_recovery.h).
+ *
+ * The lost flags are written by the data task and read here; the counters
+ * are written only by the recovery task. Neither side locks.
+ */
+
+#include "sensor_recovery.h"
+#include "mem_budget.h"
+#include "sensor_task.h"
+#include "node_config.h"
+#include "adxl355.h"
+#include "scl3300.h"
+#include "spi_bus.h"
+#include "fault_log.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+
+static const char *TAG = "SENS_RECOV";
+
+MEM_BUDGET_STATIC_TASK(s_task_mem, SENSOR_RECOVERY_TASK_STACK_SIZE);
+
+static TaskHandle_t s_task = NULL;
+
+static volatile bool     s_lost[SENSOR_RECOVERY_COUNT];
+static volatile uint32_t s_attempts[SENSOR_RECOVERY_COUNT];
+static volatile uint32_t s_reinits[SENSOR_RECOVERY_COUNT];
+static int64_t           s_next_attempt_us[SENSOR_RECOVERY_COUNT];
+
+/* SPI clock fallback: error counters at the previous link check */
+static volatile uint32_t s_clock_fallbacks[SENSOR_RECOVERY_COUNT];
+static uint32_t          s_last_link_errors[SENSOR_RECOVERY_COUNT];
+static int64_t           s_next_link_check_us;
+
+/******************************************************************************
+ * SPI CLOCK FALLBACK
+ *****************************************************************************/
+
+static const spi_bus_dev_t s_spi_dev[SENSOR_RECOVERY_COUNT] = {
+    [SENSOR_RECOVERY_ADXL355] = SPI_BUS_DEV_ADXL355,
+    [SENSOR_RECOVERY_SCL3300] = SPI_BUS_DEV_SCL3300,
+};
+
+static const spi_clock_apply_fn s_spi_apply[SENSOR_RECOVERY_COUNT] = {
+    [SENSOR_RECOVERY_ADXL355] = adxl355_set_spi_clock,
+    [SENSOR_RECOVERY_SCL3300] = scl3300_set_spi_clock,
+};
+
+/** @brief Link errors since boot: bad-CRC frames / FIFO framing resyncs. */
+static uint32_t link_errors(sensor_recovery_dev_t dev)
+{
+    if (dev == SENSOR_RECOVERY_SCL3300) {
+        return scl3300_get_crc_errors();
+    }
+    uint32_t resyncs = 0;
+    adxl355_get_fifo_diag(NULL, &resyncs, NULL);
+    return resyncs;
+}
+
+/**
+ * @brief Step the sensor's SPI clock down one rate. The caller has its ISR
+ *        reads inhibited; the device handle is replaced underneath them.
+ */
+static bool clock_fallback(sensor_recovery_dev_t dev)
+{
+    /* An ISR read that passed the inhibit check just before it was set
+       still holds the old handle */
+    vTaskDelay(pdMS_TO_TICKS(SPI_CLOCK_SWITCH_DRAIN_MS) + 1);
+
+    if (!spi_bus_clock_fallback(s_spi_dev[dev], s_spi_apply[dev])) {
+        return false;
+    }
+    s_clock_fallbacks[dev]++;
+    fault_log_record(FAULT_SPI_ERROR);
+    return true;
+}
+
+/** @brief One link check on a streaming sensor (see sensor_recovery.h). */
+static void check_link(sensor_recovery_dev_t dev)
+{
+    uint32_t errors = link_errors(dev);
+    uint32_t delta  = errors - s_last_link_errors[dev];
+    s_last_link_errors[dev] = errors;
+
+    sensor_health_dev_t health = (dev == SENSOR_RECOVERY_ADXL355)
+                                 ? SENSOR_HEALTH_ADXL355 : SENSOR_HEALTH_SCL3300;
+    if (s_lost[dev] || sensor_health_is_down(health) || delta < SPI_LINK_ERROR_LIMIT) {
+        return;
+    }
+
+    ESP_LOGW(TAG, "%s: %lu link errors in %u ms, stepping SPI clock down",
+             spi_bus_clock_profile(s_spi_dev[dev])->name, (unsigned long)delta,
+             (unsigned)SPI_LINK_CHECK_INTERVAL_MS);
+    if (dev == SENSOR_RECOVERY_ADXL355) {
+        if (adxl355_isr_set_inhibit(true) != ESP_OK) {
+            ESP_LOGW(TAG, "ADXL355 read still in flight, clock step-down deferred");
+            return;
+        }
+        clock_fallback(dev);
+        adxl355_isr_set_inhibit(false);
+    } else {
+        if (scl3300_isr_set_inhibit(true) != ESP_OK) {
+            ESP_LOGW(TAG, "SCL3300 read still in flight, clock step-down deferred");
+            return;
+        }
+        clock_fallback(dev);
+        scl3300_reset_isr_pipeline();
+        scl3300_isr_set_inhibit(false);
+    }
+    /* Errors counted during the switch belong to the old rate */
+    s_last_link_errors[dev] = link_errors(dev);
+}
+
+/** @brief An ID that is neither right nor a floating bus: a corrupted read. */
+static bool id_garbled(uint32_t id, uint32_t expected, uint32_t all_ones)
+{
+    return id != expected && id != 0 && id != all_ones;
+}
+
+/******************************************************************************
+ * REINIT SEQUENCES
+ *****************************************************************************/
+
+/**
+ * @brief Full ADXL355 reinit mirroring adxl355_init():
+ *        soft-reset -> verify IDs -> standby -> configure -> measure.
+ *
+ * Brings the sensor up in a fully known state rather than relying on
+ * retained register values after a hot-plug (power may have been lost).
+ */
+static bool reinit_adxl355(void)
+{
+    esp_err_t err = adxl355_write_reg_pub(ADXL355_REG_RESET, 0x52);
+    if (err != ESP_OK) {
+        return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
+
+    uint8_t devid_ad  = 0;
+    uint8_t devid_mst = 0;
+    uint8_t partid    = 0;
+    err = adxl355_read_reg_pub(ADXL355_REG_DEVID_AD,  &devid_ad,  1);
+    if (err == ESP_OK) adxl355_read_reg_pub(ADXL355_REG_DEVID_MST, &devid_mst, 1);
+    if (err == ESP_OK) adxl355_read_reg_pub(ADXL355_REG_PARTID,    &partid,    1);
+
+    if (err != ESP_OK ||
+        devid_ad  != ADXL355_DEVID_AD_EXPECTED ||
+        devid_mst != ADXL355_DEVID_MST_EXPECTED ||
+        partid    != ADXL355_PARTID_EXPECTED) {
+        ESP_LOGD(TAG, "ADXL355 reinit: sensor not responding yet");
+        if (err == ESP_OK && id_garbled(devid_ad, ADXL355_DEVID_AD_EXPECTED, 0xFF)) {
+            clock_fallback(SENSOR_RECOVERY_ADXL355);
+        }
+        return false;
+    }
+
+    /* Configuration sequence with the published settings */
+    const node_runtime_config_t *cfg = node_config_get();
+    const adxl355_odr_config_t  *odr = node_config_get_odr(cfg->odr_index);
+    adxl355_write_reg_pub(ADXL355_REG_POWER_CTL, ADXL355_POWER_STANDBY_BIT);
+    vTaskDelay(pdMS_TO_TICKS(2));
+    if (odr) {
+        adxl355_write_reg_pub(ADXL355_REG_FILTER,
+                              (uint8_t)((cfg->hpf_corner << 4) | odr->filter_reg));
+    }
+    adxl355_write_reg_pub(ADXL355_REG_INT_MAP, ADXL355_INT_RDY_EN1);
+    adxl355_set_range(cfg->range);
+    adxl355_write_reg_pub(ADXL355_REG_POWER_CTL, 0x00);
+
+    /* Self-test to verify the sensing element is healthy */
+    vTaskDelay(pdMS_TO_TICKS(5));   /* allow measurement mode to settle */
+    bool st_passed = false;
+    esp_err_t st_err = adxl355_selftest(&st_passed);
+    if (st_err == ESP_OK && st_passed) {
+        ESP_LOGI(TAG, "ADXL355 reinit + self-test OK — waiting for samples");
+    } else {
+        ESP_LOGW(TAG, "ADXL355 reinit OK but self-test FAILED — sensor may be damaged");
+        fault_log_record(FAULT_ADXL355_SELFTEST_FAIL);
+    }
+    return true;
+}
+
+/**
+ * @brief SCL3300 reinit: scl3300_init() runs the full datasheet Table 11
+ *        startup sequence (SW reset, mode set, ANG_CTRL, status clear,
+ *        WHOAMI verify), which a power-cycled part needs.
+ */
+static bool reinit_scl3300(void)
+{
+    if (scl3300_init() != ESP_OK) {
+        ESP_LOGD(TAG, "SCL3300 reinit: sensor not responding yet");
+        return false;
+    }
+
+    /* scl3300_init() only warns on a wrong WHOAMI */
+    uint16_t whoami = 0;
+    if (scl3300_read_whoami(&whoami) == ESP_OK &&
+        id_garbled(whoami, SCL3300_WHOAMI_VALUE, 0xFFFF)) {
+        clock_fallback(SENSOR_RECOVERY_SCL3300);
+    }
+
+    /* Self-test to verify STO register and RS bits */
+    bool st_passed = false;
+    esp_err_t st_err = scl3300_selftest(&st_passed);
+    if (st_err == ESP_OK && st_passed) {
+        ESP_LOGI(TAG, "SCL3300 reinit + self-test OK — waiting for samples");
+    } else {
+        ESP_LOGW(TAG, "SCL3300 reinit OK but self-test FAILED — sensor may be damaged");
+        fault_log_record(FAULT_SCL3300_SELFTEST_FAIL);
+    }
+
+    /* Reset ISR pipeline so it re-primes cleanly */
+    scl3300_reset_isr_pipeline();
+    return true;
+}
+
+/** @brief One attempt on one sensor, with only that sensor's ISR reads off. */
+static void attempt(sensor_recovery_dev_t dev)
+{
+    s_attempts[dev]++;
+    bool ok;
+
+    if (dev == SENSOR_RECOVERY_ADXL355) {
+        ESP_LOGI(TAG, "Attempting ADXL355 reinit...");
+        if (adxl355_isr_set_inhibit(true) != ESP_OK) {
+            ESP_LOGW(TAG, "ADXL355 read still in flight, reinit skipped");
+            return;
+        }
+        ok = reinit_adxl355();
+        adxl355_isr_set_inhibit(false);
+    } else {
+        ESP_LOGI(TAG, "Attempting SCL3300 reinit...");
+        if (scl3300_isr_set_inhibit(true) != ESP_OK) {
+            ESP_LOGW(TAG, "SCL3300 read still in flight, reinit skipped");
+            return;
+        }
+        ok = reinit_scl3300();
+        scl3300_isr_set_inhibit(false);
+    }
+
+    if (ok) {
+        s_reinits[dev]++;
+    }
+}
+
+/******************************************************************************
+ * TASK
+ *****************************************************************************/
+
+static void sensor_recovery_task(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        int64_t now  = esp_timer_get_time();
+        int64_t next = INT64_MAX;
+
+        for (int dev = 0; dev < SENSOR_RECOVERY_COUNT; dev++) {
+            if (!s_lost[dev]) {
+                continue;
+            }
+            if (now >= s_next_attempt_us[dev]) {
+                attempt((sensor_recovery_dev_t)dev);
+                now = esp_timer_get_time();
+                s_next_attempt_us[dev] = now + (int64_t)SENSOR_REINIT_INTERVAL_MS * 1000;
+            }
+            if (s_next_attempt_us[dev] < next) {
+                next = s_next_attempt_us[dev];
+            }
+        }
+
+        if (now >= s_next_link_check_us) {
+            for (int dev = 0; dev < SENSOR_RECOVERY_COUNT; dev++) {
+                check_link((sensor_recovery_dev_t)dev);
+            }
+            now = esp_timer_get_time();
+            s_next_link_check_us = now + (int64_t)SPI_LINK_CHECK_INTERVAL_MS * 1000;
+        }
+        if (s_next_link_check_us < next) {
+            next = s_next_link_check_us;
+        }
+
+        /* A lost / back notification wakes us to re-plan */
+        TickType_t wait = portMAX_DELAY;
+        if (next != INT64_MAX) {
+            wait = pdMS_TO_TICKS((next - now) / 1000) + 1;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+esp_err_t sensor_recovery_init(void)
+{
+    if (s_task != NULL) {
+        return ESP_OK;
+    }
+
+    for (int dev = 0; dev < SENSOR_RECOVERY_COUNT; dev++) {
+        s_lost[dev]             = false;
+        s_next_attempt_us[dev]  = 0;
+        s_last_link_errors[dev] = link_errors((sensor_recovery_dev_t)dev);
+    }
+    s_next_link_check_us = esp_timer_get_time() + (int64_t)SPI_LINK_CHECK_INTERVAL_MS * 1000;
+
+    s_task = mem_budget_task_create("recovery", &s_task_mem, sensor_recovery_task,
+                                     "sens_recov", NULL, SENSOR_RECOVERY_TASK_PRIORITY,
+                                     SENSOR_RECOVERY_TASK_CORE);
+    if (s_task == NULL) {
+        ESP_LOGE(TAG, "Failed to create sensor recovery task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void sensor_recovery_set_lost(sensor_recovery_dev_t dev, bool lost)
+{
+    if (dev >= SENSOR_RECOVERY_COUNT || s_lost[dev] == lost) {
+        return;
+    }
+    if (lost) {
+        /* First attempt straight away; the watchdog already waited */
+        s_next_attempt_us[dev] = 0;
+    }
+    s_lost[dev] = lost;
+    if (s_task != NULL) {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+uint32_t sensor_recovery_get_generation(sensor_recovery_dev_t dev)
+{
+    return (dev < SENSOR_RECOVERY_COUNT) ? s_reinits[dev] : 0;
+}
+
+void sensor_recovery_get_stats(sensor_recovery_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    for (int dev = 0; dev < SENSOR_RECOVERY_COUNT; dev++) {
+        stats->lost[dev]     = s_lost[dev];
+        stats->attempts[dev] = s_attempts[dev];
+        stats->reinits[dev]  = s_reinits[dev];
+        stats->clock_fallbacks[dev] = s_clock_fallbacks[dev];
+    }
+}
@@ -0,0 +1,90 @@
+/**
+ * @file sensor_recovery.h
+ * @brief Low-priority task that re-initialises hot-plugged SPI sensors.
+ *
+ * Hot-plug recovery used to run inline in the data-processing loop with the
+ * ISR reads of BOTH SPI sensors inhibited, so every retry (soft reset,
+ * settling delays, self-test) froze the healthy sensor too, and stalled the
+ * loop that drains it. The data task's per-sensor watchdog now only reports
+ * lost / back transitions here. While a sensor stays lost this task retries
+ * every SENSOR_REINIT_INTERVAL_MS, inhibiting the ISR reads of that sensor
+ * alone. Register access goes through the spi_bus.h lock one transaction at
+ * a time, so the other sensor keeps streaming at full rate.
+ *
+ * A successful ADXL355 reinit bumps a generation counter. The data task
+ * owns the ring consumer side and the decimation pipeline, so it does the
+ * post-reinit flush when it sees the counter change.
+ *
+ * The task also owns the run-time SPI clock fallback (spi_bus.h clock
+ * profiles). Every SPI_LINK_CHECK_INTERVAL_MS it compares each streaming
+ * sensor's link error counters with the previous check: SCL3300 frames
+ * rejected for a bad CRC, ADXL355 FIFO bursts that lost framing. At
+ * SPI_LINK_ERROR_LIMIT or more the sensor's clock steps down one rate,
+ * with its ISR reads inhibited across the switch. A reinit whose ID read
+ * comes back as garbage, rather than the floating bus of an unplugged
+ * sensor, steps the clock down too.
+ */
+
+#ifndef SENSOR_RECOVERY_H
+#define SENSOR_RECOVERY_H
+
+#include "esp_err.h"
+#include "cpu_topology.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * CONFIGURATION
+ *****************************************************************************/
+
+#define SENSOR_REINIT_INTERVAL_MS           5000u   /**< Retry period while a sensor is lost */
+#define SPI_LINK_CHECK_INTERVAL_MS          10000u  /**< Link error counter check period */
+#define SPI_LINK_ERROR_LIMIT                3u      /**< Errors per check that step the clock down */
+#define SPI_CLOCK_SWITCH_DRAIN_MS           10u     /**< Lets an ISR read already past the inhibit finish */
+
+#define SENSOR_RECOVERY_TASK_STACK_SIZE     4096
+#define SENSOR_RECOVERY_TASK_PRIORITY       1
+#define SENSOR_RECOVERY_TASK_CORE           SHM_CORE_NET
+
+typedef enum {
+    SENSOR_RECOVERY_ADXL355 = 0,
+    SENSOR_RECOVERY_SCL3300 = 1,
+    SENSOR_RECOVERY_COUNT
+} sensor_recovery_dev_t;
+
+typedef struct {
+    bool     lost[SENSOR_RECOVERY_COUNT];       /**< Watchdog currently tripped        */
+    uint32_t attempts[SENSOR_RECOVERY_COUNT];   /**< Reinit attempts since boot        */
+    uint32_t reinits[SENSOR_RECOVERY_COUNT];    /**< Attempts where the sensor answered */
+    uint32_t clock_fallbacks[SENSOR_RECOVERY_COUNT]; /**< SPI clock step-downs since boot */
+} sensor_recovery_stats_t;
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/** @brief Start the recovery task. Call after sensor_acquisition_init(). */
+esp_err_t sensor_recovery_init(void);
+
+/**
+ * @brief Report a watchdog transition (data task).
+ *
+ * lost = true starts the retries, the first one straight away; lost = false
+ * (samples flowing again) stops them.
+ */
+void sensor_recovery_set_lost(sensor_recovery_dev_t dev, bool lost);
+
+/** @brief Incremented after each reinit in which the sensor answered. */
+uint32_t sensor_recovery_get_generation(sensor_recovery_dev_t dev);
+
+void sensor_recovery_get_stats(sensor_recovery_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SENSOR_RECOVERY_H
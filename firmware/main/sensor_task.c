@@ -5,32 +5,96 @@
  * Design Philosophy:
  * ================================================
  * 1. SINGLE ISR driven by GPTimer frequency (8000 Hz)
- * 2. Staggered sensor sampling to prevent conflicts
+ * 2. Staggered sensor sampling to prevent conflicts, from one declarative
+ *    slot table (SENSOR_SLOT_TABLE) precomputed into a per-tick phase lookup
  * 3. Raw data collection ONLY in ISR
  * 4. Ring buffers provide lock-free handoff to processing tasks
  * 5. Processing happens OUTSIDE the ISR
  *
  * Sensor Configuration:
  * =====================
- * - ADXL355: 1000 Hz (samples every 8 ticks)
+ * - ADXL355: runtime ODR (4000/2000/1000 Hz -> every 2/4/8 ticks), set by
+ *            sensor_acquisition_set_adxl355_divisor() from node_config
  * - SCL3300: 20 Hz   (samples every 400 ticks)
- * - ADT7420: 1 Hz    (NOT read in ISR; left commented out)
+ * - ADT7420: 1 Hz    (slow-sensors task, not the ISR)
+ *
+ * ADXL355 FIFO burst mode:
+ * ========================
+ * With ADXL355_USE_FIFO_BURST enabled the ISR does not read XDATA once per
+ * sample. The ADXL355 keeps filling its 96-entry (32-sample) FIFO at its own
+ * ODR; every ADXL355_FIFO_POLL_SAMPLES sample periods the ISR reads FIFO_ENTRIES and then
+ * pulls every complete X/Y/Z triple out of FIFO_DATA in ONE multi-byte
+ * transaction. Ticks are reconstructed backwards from the drain tick using
+ * the sample period, so the newest sample carries the current tick.
+ *
+ * A burst can take longer than one 125 us tick at low SPI clocks, so the
+ * alarm is re-armed at an absolute count each tick instead of auto-reloading.
+ * Overrun ticks then fire back-to-back instead of being lost, and
+ * tick_counter stays a faithful 8000 Hz clock.
+ *
+ * DRDY acquisition mode:
+ * ======================
+ * Selected with sensor_acquisition_set_mode() before init. The ADXL355 INT1
+ * GPIO interrupt services the accelerometer (FIFO watermark or DATA_RDY) and
+ * the GPTimer runs only at SCL3300_RATE_HZ. Ticks are derived from esp_timer
+ * so sample stamps keep the 125 us unit.
+ *
+ * TASK acquisition mode:
+ * ======================
+ * The 8 kHz ISR keeps the slot schedule but performs no SPI at all: it
+ * stamps the tick, sets a notification bit per due sensor and wakes a
+ * highest-priority acquisition task pinned to the acquisition core. That
+ * task issues the ADXL355 and SCL3300 reads back-to-back through
+ * spi_device_queue_trans() and spi_device_get_trans_result() (DMA), so SPI
+ * time no longer delays lower-priority interrupts on that core.
+ *
+ * The ISRs, the acquisition task and the data task all run on SHM_CORE_ACQ;
+ * Ethernet, lwIP and MQTT are on the other core (cpu_topology.h).
+ *
+ * ISR execution time is measured in every mode (CPU cycle counter); TASK
+ * mode also records ISR-to-task wake latency. See sensor_acquisition_get_timing().
+ *
+ * Sensor health:
+ * ==============
+ * K consecutive invalid reads mark a sensor down; its slots are then
+ * skipped apart from exponential-backoff probes, so an unplugged part stops
+ * costing bus time and ISR cycles every slot. Transitions are pushed to the
+ * subscribed task (the data task's watchdog). See sensor_task.h.
  *
  * CS ownership model:
  * ===================
  * - ADXL355: automatic CS handled by SPI device config
- * - SCL3300: manual CS handled explicitly
+ * - SCL3300: automatic CS when SCL3300_HW_CS (scl3300.h), manual otherwise
+ *
+ * SCL3300 angle sequence:
+ * =======================
+ * The three rolling angle frames are prebuilt transaction descriptors
+ * (s_scl_seq), so a 20 Hz slot does no memset or command packing. With
+ * hardware CS, TASK mode queues all three to the DMA driver at once and
+ * collects the results; ISR engines poll them back-to-back inside the one
+ * slot ISR entry. The device pre-transfer callback guarantees the CS-high
+ * gap between frames either way.
  *
  * Important:
  * ==========
  * - Do NOT manually toggle ADXL355 CS in ISR
- * - Do keep SCL3300 CS manual and explicit
- * - Temperature ISR block remains commented out
+ * - With SCL3300_HW_CS = 0, keep SCL3300 CS manual and explicit
+ * - ADT7420 is never read here; the slow-sensors task fills its ring
  */
 
 #include "sensor_task.h"
+#include "raw_history.h"
+#include "timing_hist.h"
+#include "cpu_topology.h"
+#include "sdkconfig.h"
 #include "driver/gptimer.h"
 #include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "driver/spi_master.h"
 #include "driver/i2c_master.h"
@@ -41,10 +105,12 @@
 #include "soc/i2c_struct.h"
 
 #include "spi_bus.h"
+#include "spsc_ring.h"
 #include "i2c_bus.h"
 #include "adt7420.h"
 #include "adxl355.h"
 #include "scl3300.h"
+#include "mem_budget.h"
 
 #include <string.h>
 #include <stdbool.h>
@@ -59,22 +125,130 @@ static const char *TAG = "sensor_task";
 #define BASE_TIMER_FREQ_HZ      8000
 #define TIMER_PERIOD_US         125
 
-#define ADXL355_RATE_HZ         1000
 #define SCL3300_RATE_HZ         20
 #define ADT7420_RATE_HZ         1
 
-#define ADXL355_TICK_DIVISOR    (BASE_TIMER_FREQ_HZ / ADXL355_RATE_HZ)
+/* ADXL355 rate is runtime-selectable; this is only the boot default (1000 Hz).
+   Valid divisors are powers of two in [ADXL355_MIN_TICK_DIVISOR, BASE_TIMER_FREQ_HZ]
+   so the slot test stays a mask and never lands on the odd SCL3300 slot. */
+#define ADXL355_DEFAULT_TICK_DIVISOR    8
+#define ADXL355_MIN_TICK_DIVISOR        2
 #define SCL3300_TICK_DIVISOR    (BASE_TIMER_FREQ_HZ / SCL3300_RATE_HZ)
-#define ADT7420_TICK_DIVISOR    (BASE_TIMER_FREQ_HZ / ADT7420_RATE_HZ)
 
 #define ADXL355_OFFSET          0
 #define SCL3300_OFFSET          1
-#define ADT7420_OFFSET          2
 
+/*
+ * Timer-slot sensors. One row per sensor the 8 kHz tick services:
+ *
+ *   X(name, period_ticks, offset, inhibit_flag, service_fn)
+ *
+ * name also selects SENSOR_HEALTH_<name> and the SLOT_<name> bit. Periods
+ * may be runtime values; sensor_slot_schedule_build() folds every row into
+ * the s_slot_sched phase table whenever one changes (timer stopped), so the
+ * ISR only looks up the current phase. Adding a sensor is a row here, a
+ * health slot and its service function.
+ */
+#if ADXL355_USE_FIFO_BURST
+#define ADXL355_SLOT_PERIOD     s_adxl_fifo_poll_ticks
+#else
+#define ADXL355_SLOT_PERIOD     s_adxl_tick_divisor
+#endif
+
+#define SENSOR_SLOT_TABLE(X)                                                         \
+    X(ADXL355, ADXL355_SLOT_PERIOD,  ADXL355_OFFSET, s_adxl355_isr_inhibit, adxl355_isr_service) \
+    X(SCL3300, SCL3300_TICK_DIVISOR, SCL3300_OFFSET, s_scl3300_isr_inhibit, scl3300_isr_service)
+
+/*
+ * Phase table length cap (one byte per tick of the hyperperiod, DRAM).
+ * LCM(400, FIFO poll ticks) is 400/800/1600 at 4000/2000/1000 Hz and 3200
+ * at 500 Hz; slower ADXL355 rates are rejected.
+ */
+#define SENSOR_SLOT_MAX_PHASES  3200u
+
+/* ISR ring sizes (Kconfig.projbuild). These always live in internal RAM;
+   the large ADXL355 backlog is the PSRAM tier behind it (raw_history.h). */
+#ifdef CONFIG_SHM_ADXL355_RING_SAMPLES
+#define ADXL355_BUFFER_SIZE     CONFIG_SHM_ADXL355_RING_SAMPLES
+#else
 #define ADXL355_BUFFER_SIZE     4096
+#endif
+#ifdef CONFIG_SHM_SCL3300_RING_SAMPLES
+#define SCL3300_BUFFER_SIZE     CONFIG_SHM_SCL3300_RING_SAMPLES
+#else
 #define SCL3300_BUFFER_SIZE     128
+#endif
 #define ADT7420_BUFFER_SIZE     16
 
+/*
+ * The ADXL355 ring is sized for the highest ODR, where it holds the least
+ * time; at 2000 / 1000 Hz the same ring holds 2x / 4x as long. Minimum
+ * headroom at ADXL355_MAX_ODR_HZ:
+ * - without the PSRAM history, the ring is the whole backlog the data
+ *   task can fall behind by: ADXL355_RING_BACKLOG_MS.
+ * - with it, the ring only has to bridge drain periods:
+ *   ADXL355_RING_DRAIN_HEADROOM_MS. The history holds the backlog
+ *   (32 s at 4 kHz by default).
+ * The compile-time check covers the configured sizes. The function
+ * sensor_acquisition_set_adxl355_divisor() warns when the active ODR
+ * leaves less than that, e.g. when the history is compiled in but PSRAM
+ * is missing at runtime.
+ */
+#define ADXL355_MAX_ODR_HZ              4000u
+#define ADXL355_RING_BACKLOG_MS         1000u
+#define ADXL355_RING_DRAIN_HEADROOM_MS  250u
+#if defined(CONFIG_SHM_RAW_HISTORY)
+#define ADXL355_RING_MIN_HEADROOM_MS    ADXL355_RING_DRAIN_HEADROOM_MS
+#else
+#define ADXL355_RING_MIN_HEADROOM_MS    ADXL355_RING_BACKLOG_MS
+#endif
+_Static_assert((uint64_t)ADXL355_BUFFER_SIZE * 1000u >=
+               (uint64_t)ADXL355_MAX_ODR_HZ * ADXL355_RING_MIN_HEADROOM_MS,
+               "ADXL355 ISR ring too small for the highest ODR (CONFIG_SHM_ADXL355_RING_SAMPLES)");
+
+/*
+ * ADXL355 FIFO burst drain. Set ADXL355_USE_FIFO_BURST to 0 to fall back to
+ * one XDATA poll per sample.
+ *
+ * The FIFO is drained every ADXL355_FIFO_POLL_SAMPLES sample periods, so the
+ * poll interval follows the ODR (2/4/8 ms at 4000/2000/1000 Hz) and a normal
+ * drain is 8 samples: a quarter of the 32-sample FIFO and half of
+ * ADXL355_FIFO_MAX_BURST_SAMPLES, which bounds a single transaction. Anything
+ * left over is picked up on the next poll. Must be a power of two.
+ */
+#define ADXL355_USE_FIFO_BURST          1
+#define ADXL355_FIFO_POLL_SAMPLES       8
+#define ADXL355_FIFO_MAX_BURST_SAMPLES  16
+
+/*
+ * DRDY mode: the ADXL355 interrupts at a FIFO watermark (FIFO burst) or on
+ * every DATA_RDY, and the GPTimer only runs the SCL3300 at SCL3300_RATE_HZ.
+ */
+#define ADXL355_DRDY_WATERMARK_SAMPLES  8
+
+/*
+ * TASK mode: acquisition task placement. It shares the acquisition core
+ * with the timer ISR and the data task; the network stack is on the other
+ * core (cpu_topology.h).
+ */
+#define ACQ_TASK_STACK_SIZE     4096
+#define ACQ_TASK_PRIORITY       (configMAX_PRIORITIES - 1)
+#define ACQ_TASK_CORE           SHM_CORE_ACQ
+/* Longest a reinit waits for a sensor service in flight (one is < 1 ms) */
+#define ACQ_TASK_IDLE_TIMEOUT_MS    50
+
+#define SCL3300_DRDY_TIMER_PERIOD_US    (1000000 / SCL3300_RATE_HZ)
+#define ADXL355_FIFO_CAPACITY_ENTRIES   96
+#define ADXL355_FIFO_BYTES_PER_ENTRY    3
+#define ADXL355_FIFO_ENTRIES_PER_SAMPLE 3
+#define ADXL355_FIFO_BURST_BYTES        (1 + ADXL355_FIFO_MAX_BURST_SAMPLES * \
+                                         ADXL355_FIFO_ENTRIES_PER_SAMPLE *   \
+                                         ADXL355_FIFO_BYTES_PER_ENTRY)
+
+/* FIFO_DATA low-byte flags (datasheet Table 32) */
+#define ADXL355_FIFO_X_MARKER   0x01
+#define ADXL355_FIFO_EMPTY      0x02
+
 /******************************************************************************
  * SCL3300 COMMANDS
  *****************************************************************************/
@@ -87,38 +261,46 @@ static const char *TAG = "sensor_task";
 #define SCL3300_CMD_Y           0x280000CDu   // READ_ANG_Y
 #define SCL3300_CMD_Z           0x2C0000CBu   // READ_ANG_Z
 
+/* Rolling angle sequence order: each frame returns the previous command */
+#define SCL3300_SEQ_Y           0
+#define SCL3300_SEQ_Z           1
+#define SCL3300_SEQ_X           2
+#define SCL3300_SEQ_FRAMES      3
+
+#define SCL3300_FRAME(cmd) {                                        \
+    .flags    = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA,        \
+    .length   = 32,                                                 \
+    .rxlength = 32,                                                 \
+    .tx_data  = { (uint8_t)((cmd) >> 24), (uint8_t)((cmd) >> 16),   \
+                  (uint8_t)((cmd) >> 8),  (uint8_t)(cmd) },         \
+}
+
+#if SCL3300_HW_CS
+/* The peripheral owns the SCL3300 CS pin; nothing to deselect by hand */
+#define SCL3300_CS_DESELECT()   ((void)0)
+#else
+#define SCL3300_CS_DESELECT()   gpio_set_level(SPI_CS_SCL3300_IO, 1)
+#endif
+
 /******************************************************************************
  * DATA STRUCTURES
  *****************************************************************************/
 
-typedef struct {
-    adxl355_raw_sample_t buffer[ADXL355_BUFFER_SIZE];
-    volatile uint32_t write_index;
-    volatile uint32_t read_index;
-    volatile uint32_t overflow_count;
-} adxl355_ring_buffer_t;
-
-typedef struct {
-    scl3300_raw_sample_t buffer[SCL3300_BUFFER_SIZE];
-    volatile uint32_t write_index;
-    volatile uint32_t read_index;
-    volatile uint32_t overflow_count;
-} scl3300_ring_buffer_t;
-
-typedef struct {
-    adt7420_raw_sample_t buffer[ADT7420_BUFFER_SIZE];
-    volatile uint32_t write_index;
-    volatile uint32_t read_index;
-    volatile uint32_t overflow_count;
-} adt7420_ring_buffer_t;
+/* One SPSC ring per sensor: ISR (or acquisition task) produces, the data
+   processing task consumes. See spsc_ring.h for the ordering guarantees. */
+SPSC_RING_DEFINE(adxl355_ring, adxl355_raw_sample_t, ADXL355_BUFFER_SIZE)
+SPSC_RING_DEFINE(scl3300_ring, scl3300_raw_sample_t, SCL3300_BUFFER_SIZE)
+SPSC_RING_DEFINE(adt7420_ring, adt7420_raw_sample_t, ADT7420_BUFFER_SIZE)
 
 /******************************************************************************
  * GLOBAL VARIABLES
  *****************************************************************************/
 
-static adxl355_ring_buffer_t adxl355_ring_buffer = {0};
-static scl3300_ring_buffer_t scl3300_ring_buffer = {0};
-static adt7420_ring_buffer_t adt7420_ring_buffer = {0};
+static adxl355_ring_t adxl355_ring_buffer;
+static scl3300_ring_t scl3300_ring_buffer;
+static adt7420_ring_t adt7420_ring_buffer;
+
+MEM_BUDGET_STATIC_TASK(s_acq_task_mem, ACQ_TASK_STACK_SIZE);
 
 static gptimer_handle_t s_timer = NULL;
 
@@ -128,6 +310,72 @@ static volatile uint32_t adxl355_sample_count = 0;
 static volatile uint32_t scl3300_sample_count = 0;
 static volatile uint32_t adt7420_sample_count = 0;
 
+/*
+ * ADXL355 slot schedule. Only changed while the timer is stopped
+ * (sensor_acquisition_set_adxl355_divisor), read by the ISR.
+ */
+static volatile uint32_t s_adxl_tick_divisor     = ADXL355_DEFAULT_TICK_DIVISOR;
+static volatile uint32_t s_adxl_fifo_poll_ticks  = ADXL355_DEFAULT_TICK_DIVISOR * ADXL355_FIFO_POLL_SAMPLES;
+static bool              s_timer_running         = false;
+
+/* Acquisition engine, fixed once sensor_acquisition_init() has run */
+static sensor_acq_mode_t s_acq_mode      = SENSOR_ACQ_BOOT_MODE;
+static bool              s_acq_initialized = false;
+static volatile int64_t  s_tick_epoch_us = 0;   /* DRDY mode tick 0 */
+static volatile int64_t  s_start_local_us = 0;  /* esp_timer at the last gptimer_start() */
+
+/* Slot indices and bits, one per SENSOR_SLOT_TABLE row */
+typedef enum {
+#define X(name, period, offset, inhibit, service) SLOT_IDX_##name,
+    SENSOR_SLOT_TABLE(X)
+#undef X
+    SLOT_COUNT
+} sensor_slot_t;
+
+#define SLOT_BIT(name)          (1u << SLOT_IDX_##name)
+
+_Static_assert(SLOT_COUNT <= 8, "s_slot_sched holds one bit per slot in a byte");
+
+/*
+ * Precomputed schedule: s_slot_sched[tick % s_slot_len] has the bits of the
+ * sensors due on that tick. s_slot_phase tracks tick_counter % s_slot_len
+ * so the ISR needs no division. Rebuilt only while the timer is stopped.
+ */
+static DRAM_ATTR uint8_t  s_slot_sched[SENSOR_SLOT_MAX_PHASES];
+static uint32_t           s_slot_len   = 1;
+static volatile uint32_t  s_slot_phase = 0;
+
+/* TASK mode handoff: ticks stamped by the ISR for the pending slots */
+static TaskHandle_t      s_acq_task           = NULL;
+static volatile uint32_t s_task_slot_tick[SLOT_COUNT];
+static volatile uint32_t s_task_pending       = 0;  /* bits notified, not yet picked up */
+/* Low 32 bits of esp_timer at the last notify: one aligned store, so the
+   task never reads it half-written (a 64-bit value is two stores on
+   Xtensa). Differences wrap correctly for 71 minutes. */
+static volatile uint32_t s_task_notify_us     = 0;
+/* Held by the acquisition task across each round of sensor services */
+static SemaphoreHandle_t s_task_service_lock  = NULL;
+static StaticSemaphore_t s_task_service_lock_buf;
+
+/*
+ * Timing statistics. ISR times are in CPU cycles (same core at entry and
+ * exit); wake latency and task service time are esp_timer microseconds,
+ * which do not count the cycles an interrupt steals in between.
+ */
+static volatile uint32_t s_isr_cycles_max     = 0;
+static volatile uint64_t s_isr_cycles_sum     = 0;
+static volatile uint32_t s_isr_count          = 0;
+static volatile uint32_t s_task_wake_us_max   = 0;
+static volatile uint64_t s_task_wake_us_sum   = 0;
+static volatile uint32_t s_task_wake_count    = 0;
+static volatile uint32_t s_task_service_us_max= 0;
+static volatile uint32_t s_task_slot_overruns = 0;  /* slot fired while still pending */
+
+/* Tick jitter: cycle count at the previous alarm ISR entry (timing_hist.h) */
+static volatile uint32_t s_jitter_last_cycles   = 0;
+static volatile bool     s_jitter_last_valid    = false;
+static volatile uint32_t s_jitter_period_cycles = 0;
+
 static bool s_temp_available = false;
 
 extern spi_device_handle_t adxl355_spi_handle;
@@ -147,6 +395,50 @@ static bool s_scl_discard_first_sample = true;
 static volatile bool s_adxl355_isr_inhibit = false;
 static volatile bool s_scl3300_isr_inhibit = false;
 
+/*
+ * Per-sensor health (sensor_task.h: SENSOR HEALTH). Written by the service
+ * path (ISR, or the acquisition task in TASK mode); task context only
+ * rewinds next_probe_tick when an inhibit is released or ticks restart.
+ * Lives in .data, not flash, since the ISR reads the limits.
+ */
+#define HEALTH_PROBE_MIN_TICKS  (SENSOR_HEALTH_PROBE_MIN_MS * (BASE_TIMER_FREQ_HZ / 1000))
+#define HEALTH_PROBE_MAX_TICKS  (SENSOR_HEALTH_PROBE_MAX_MS * (BASE_TIMER_FREQ_HZ / 1000))
+
+typedef enum {
+    HEALTH_NO_INFO = 0,     /* nothing read (ring full, pipeline prime) */
+    HEALTH_ANSWERED,
+    HEALTH_INVALID,
+} health_obs_t;
+
+typedef struct {
+    uint32_t          limit;
+    volatile bool     down;
+    volatile uint32_t invalid_run;
+    volatile uint32_t probe_ticks;
+    volatile uint32_t next_probe_tick;
+    volatile uint32_t downs;
+    volatile uint32_t ups;
+    volatile uint32_t probes;
+    volatile uint32_t skipped;
+} sensor_health_t;
+
+static sensor_health_t s_health[SENSOR_HEALTH_COUNT] = {
+    [SENSOR_HEALTH_ADXL355] = { .limit = ADXL355_HEALTH_INVALID_LIMIT },
+    [SENSOR_HEALTH_SCL3300] = { .limit = SCL3300_HEALTH_INVALID_LIMIT },
+};
+static TaskHandle_t s_health_notify_task = NULL;
+
+/*
+ * Data-ready wakeups (sensor_task.h: DATA READY), sent to the same
+ * subscriber. s_data_pending is only touched by the one active producer:
+ * the ADXL355 service path, or the raw-history drain task once it is the
+ * tier the data task reads.
+ */
+static volatile uint32_t s_data_watermark = 0;
+static volatile uint32_t s_data_pending   = 0;
+static volatile bool     s_data_external  = false;
+static volatile uint32_t s_data_wakeups   = 0;
+
 /*
  * ISR-safe diagnostic counters for SCL3300 pipeline.
  * Written only from ISR; read from task context for logging.
@@ -157,12 +449,103 @@ static volatile uint32_t s_scl_prime_count  = 0; // pipeline priming calls
 static volatile uint32_t s_scl_discard_count= 0; // first-sample discards
 static volatile uint32_t s_scl_valid_count  = 0; // read returned true -> pushed to ring buf
 static volatile uint32_t s_scl_invalid_count= 0; // read returned false (not prime, not discard)
+static volatile uint32_t s_scl_crc_errors   = 0; // frames with RS=01 but a bad CRC (link errors)
 static volatile uint32_t s_scl_overflow_dbg = 0; // ring buffer full at ISR time
 
+/*
+ * ADXL355 FIFO burst state. Written only from ISR (except the flush request,
+ * which task context sets before enabling reads again).
+ */
+static volatile bool     s_adxl_fifo_flush_pending = true;
+static volatile uint32_t s_adxl_fifo_bursts        = 0; // bursts that returned >= 1 sample
+static volatile uint32_t s_adxl_fifo_resyncs       = 0; // bursts that started off an X marker
+static volatile uint32_t s_adxl_fifo_full_events   = 0; // FIFO found full (possible overrun)
+
+/* Prebuilt SCL3300 angle frames; only rx_data changes between slots */
+static DRAM_ATTR spi_transaction_t s_scl_seq[SCL3300_SEQ_FRAMES] = {
+    [SCL3300_SEQ_Y] = SCL3300_FRAME(SCL3300_CMD_Y),
+    [SCL3300_SEQ_Z] = SCL3300_FRAME(SCL3300_CMD_Z),
+    [SCL3300_SEQ_X] = SCL3300_FRAME(SCL3300_CMD_X),
+};
+
+/* DMA-capable burst buffers: too large for the ISR stack */
+static DMA_ATTR uint8_t s_adxl_fifo_tx[ADXL355_FIFO_BURST_BYTES];
+static DMA_ATTR uint8_t s_adxl_fifo_rx[ADXL355_FIFO_BURST_BYTES];
+
 /******************************************************************************
  * ACCESS FUNCTIONS FOR ISR
  *****************************************************************************/
 
+/**
+ * @brief Issue one SPI transaction for the active acquisition engine.
+ *
+ * ISR engines use polling transmit (the only option in interrupt context),
+ * under the spi_bus.h lock so a task-context register access is never cut
+ * in half. TASK mode queues the transaction for the DMA driver and blocks
+ * the acquisition task on the result instead of spinning.
+ */
+static inline esp_err_t IRAM_ATTR acq_spi_transfer(spi_device_handle_t dev, spi_transaction_t *t)
+{
+    if (s_acq_mode == SENSOR_ACQ_MODE_TASK) {
+        esp_err_t err = spi_device_queue_trans(dev, t, portMAX_DELAY);
+        if (err != ESP_OK) {
+            return err;
+        }
+        spi_transaction_t *done = NULL;
+        return spi_device_get_trans_result(dev, &done, portMAX_DELAY);
+    }
+    spi_bus_lock_from_isr();
+    esp_err_t err = spi_device_polling_transmit(dev, t);
+    spi_bus_unlock_from_isr();
+    return err;
+}
+
+/** @brief Hold the bus across a manual-CS frame (ISR engines only). */
+static inline void IRAM_ATTR acq_bus_lock(void)
+{
+    if (s_acq_mode != SENSOR_ACQ_MODE_TASK) {
+        spi_bus_lock_from_isr();
+    }
+}
+
+static inline void IRAM_ATTR acq_bus_unlock(void)
+{
+    if (s_acq_mode != SENSOR_ACQ_MODE_TASK) {
+        spi_bus_unlock_from_isr();
+    }
+}
+
+/** @brief Record one ISR execution time (cycles since entry). */
+static inline void IRAM_ATTR isr_timing_end(uint32_t start_cycles)
+{
+    uint32_t dt = esp_cpu_get_cycle_count() - start_cycles;
+    if (dt > s_isr_cycles_max) {
+        s_isr_cycles_max = dt;
+    }
+    s_isr_cycles_sum += dt;
+    s_isr_count++;
+    timing_hist_record(TIMING_ISR, dt);
+}
+
+/** @brief Record |entry interval - nominal period| for the alarm ISRs. */
+static inline void IRAM_ATTR isr_jitter_sample(uint32_t entry_cycles)
+{
+    if (s_jitter_last_valid) {
+        uint32_t dt  = entry_cycles - s_jitter_last_cycles;
+        uint32_t nom = s_jitter_period_cycles;
+        timing_hist_record(TIMING_TICK_JITTER, dt > nom ? dt - nom : nom - dt);
+    }
+    s_jitter_last_cycles = entry_cycles;
+    s_jitter_last_valid  = true;
+}
+
+/** @brief Unpack one left-justified 20-bit ADXL355 axis (DATA3..DATA1). */
+static inline int32_t IRAM_ATTR adxl355_unpack_20b(const uint8_t *p)
+{
+    uint32_t u = ((uint32_t)p[0] << 12) | ((uint32_t)p[1] << 4) | ((uint32_t)p[2] >> 4);
+    return (u & 0x80000u) ? (int32_t)(u | 0xFFF00000u) : (int32_t)u;
+}
+
 static inline bool IRAM_ATTR read_adxl355_raw(int32_t *raw_x, int32_t *raw_y, int32_t *raw_z)
 {
     uint8_t tx[10] = {0};
@@ -176,14 +559,12 @@ static inline bool IRAM_ATTR read_adxl355_raw(int32_t *raw_x, int32_t *raw_y, in
     t.tx_buffer = tx;
     t.rx_buffer = rx;
 
-#ifdef SPI_CS_SCL3300_IO
     /* Force the OTHER SPI device inactive. */
-    gpio_set_level(SPI_CS_SCL3300_IO, 1);
-#endif
+    SCL3300_CS_DESELECT();
 
     /* Do NOT manually drive ADXL355 CS here.
        ADXL355 uses automatic CS in its driver config. */
-    spi_device_polling_transmit(adxl355_spi_handle, &t);
+    acq_spi_transfer(adxl355_spi_handle, &t);
 
     /*
      * Detect disconnected sensor: if all data bytes are identical (all 0xFF
@@ -198,48 +579,210 @@ static inline bool IRAM_ATTR read_adxl355_raw(int32_t *raw_x, int32_t *raw_y, in
         return false;
     }
 
-    uint32_t x_u = ((uint32_t)rx[1] << 12) | ((uint32_t)rx[2] << 4) | ((uint32_t)rx[3] >> 4);
-    uint32_t y_u = ((uint32_t)rx[4] << 12) | ((uint32_t)rx[5] << 4) | ((uint32_t)rx[6] >> 4);
-    uint32_t z_u = ((uint32_t)rx[7] << 12) | ((uint32_t)rx[8] << 4) | ((uint32_t)rx[9] >> 4);
-
-    *raw_x = (x_u & 0x80000u) ? (int32_t)(x_u | 0xFFF00000u) : (int32_t)x_u;
-    *raw_y = (y_u & 0x80000u) ? (int32_t)(y_u | 0xFFF00000u) : (int32_t)y_u;
-    *raw_z = (z_u & 0x80000u) ? (int32_t)(z_u | 0xFFF00000u) : (int32_t)z_u;
+    *raw_x = adxl355_unpack_20b(&rx[1]);
+    *raw_y = adxl355_unpack_20b(&rx[4]);
+    *raw_z = adxl355_unpack_20b(&rx[7]);
 
     return true;
 }
 
-static inline void IRAM_ATTR scl3300_isr_transfer(uint32_t cmd, uint32_t *resp_out)
+#if ADXL355_USE_FIFO_BURST
+/**
+ * @brief Read FIFO_ENTRIES (number of queued axis entries, 0..96).
+ *
+ * Returns 0 for anything above the FIFO capacity: a floating MISO line reads
+ * back as 0x7F/0xFF, which must not be treated as a full FIFO.
+ */
+static inline uint32_t IRAM_ATTR adxl355_fifo_entries_isr(void)
 {
     spi_transaction_t t;
     memset(&t, 0, sizeof(t));
-
     t.flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
-    t.length = 32;
-    t.rxlength = 32;
+    t.length = 16;
+    t.tx_data[0] = (ADXL355_REG_FIFO_ENTRIES << 1) | 0x01;
 
-    t.tx_data[0] = (uint8_t)((cmd >> 24) & 0xFF);
-    t.tx_data[1] = (uint8_t)((cmd >> 16) & 0xFF);
-    t.tx_data[2] = (uint8_t)((cmd >> 8) & 0xFF);
-    t.tx_data[3] = (uint8_t)(cmd & 0xFF);
+    SCL3300_CS_DESELECT();
+    acq_spi_transfer(adxl355_spi_handle, &t);
 
-#ifdef SPI_CS_SCL3300_IO
-    gpio_set_level(SPI_CS_SCL3300_IO, 1);
-    gpio_set_level(SPI_CS_SCL3300_IO, 0);
-#endif
+    uint32_t entries = t.rx_data[1] & 0x7Fu;
+    return (entries > ADXL355_FIFO_CAPACITY_ENTRIES) ? 0u : entries;
+}
+
+/**
+ * @brief Pull up to ADXL355_FIFO_MAX_BURST_SAMPLES samples out of FIFO_DATA in
+ *        a single transaction and push them into the ring buffer.
+ *
+ * FIFO_DATA does not auto-increment, so one long read returns consecutive
+ * FIFO entries. Every sample is three entries (X, Y, Z); the X entry has the
+ * X marker bit set. Parsing starts at the first X marker so a burst that
+ * begins mid-sample (e.g. FIFO_ENTRIES read while the part was writing)
+ * only costs the partial sample rather than shifting every axis after it.
+ *
+ * @param now_tick     Tick of the newest sample in the FIFO. A capped burst
+ *                     reads the oldest samples, so they are stamped by their
+ *                     position in the whole FIFO, not in the burst.
+ * @param period_ticks Sample period in ticks (BASE_TIMER_FREQ_HZ / ODR)
+ * @param discard      true to empty the FIFO without storing (stale data)
+ * @return HEALTH_INVALID if the FIFO held no complete sample. Polls are
+ *         ADXL355_FIFO_POLL_SAMPLES periods apart, so a measuring part
+ *         always has one queued; an empty FIFO is a floating MISO line.
+ */
+static inline health_obs_t IRAM_ATTR drain_adxl355_fifo(uint32_t now_tick,
+                                                        uint32_t period_ticks,
+                                                        bool discard)
+{
+    uint32_t entries = adxl355_fifo_entries_isr();
+    if (entries >= ADXL355_FIFO_CAPACITY_ENTRIES) {
+        s_adxl_fifo_full_events++;
+    }
+
+    /* avail counts what is queued; n is what this burst reads (oldest first) */
+    const uint32_t avail = entries / ADXL355_FIFO_ENTRIES_PER_SAMPLE;
+    uint32_t n = avail;
+    if (n == 0u) {
+        if (discard) {
+            s_adxl_fifo_flush_pending = false;
+        }
+        return HEALTH_INVALID;
+    }
+    if (n > ADXL355_FIFO_MAX_BURST_SAMPLES) {
+        n = ADXL355_FIFO_MAX_BURST_SAMPLES;
+    }
 
-    spi_device_polling_transmit(scl3300_spi_handle, &t);
+    const uint32_t data_bytes = n * ADXL355_FIFO_ENTRIES_PER_SAMPLE * ADXL355_FIFO_BYTES_PER_ENTRY;
 
-#ifdef SPI_CS_SCL3300_IO
-    gpio_set_level(SPI_CS_SCL3300_IO, 1);
-#endif
+    s_adxl_fifo_tx[0] = (ADXL355_REG_FIFO_DATA << 1) | 0x01;
+
+    spi_transaction_t t;
+    memset(&t, 0, sizeof(t));
+    t.length = (1u + data_bytes) * 8u;
+    t.tx_buffer = s_adxl_fifo_tx;
+    t.rx_buffer = s_adxl_fifo_rx;
+
+    acq_spi_transfer(adxl355_spi_handle, &t);
+
+    if (discard) {
+        /* Keep flushing on following polls until the FIFO reads back empty */
+        if (entries < (ADXL355_FIFO_MAX_BURST_SAMPLES * ADXL355_FIFO_ENTRIES_PER_SAMPLE)) {
+            s_adxl_fifo_flush_pending = false;
+        }
+        return HEALTH_ANSWERED;
+    }
+
+    const uint8_t *data = &s_adxl_fifo_rx[1];
+    const uint32_t total_entries = n * ADXL355_FIFO_ENTRIES_PER_SAMPLE;
+
+    uint32_t first = 0;
+    while (first < total_entries &&
+           !(data[first * ADXL355_FIFO_BYTES_PER_ENTRY + 2] & ADXL355_FIFO_X_MARKER)) {
+        first++;
+    }
+    if (first != 0u) {
+        s_adxl_fifo_resyncs++;
+    }
+
+    uint32_t complete = (total_entries - first) / ADXL355_FIFO_ENTRIES_PER_SAMPLE;
+    if (complete == 0u) {
+        return HEALTH_ANSWERED;
+    }
+
+    /* FIFO position of the first complete sample: a skipped partial one
+     * still took a sample period */
+    const uint32_t first_sample_index =
+        (first + ADXL355_FIFO_ENTRIES_PER_SAMPLE - 1u) / ADXL355_FIFO_ENTRIES_PER_SAMPLE;
+
+    uint32_t pushed = 0;
+    for (uint32_t k = 0; k < complete; k++) {
+        const uint8_t *e = &data[(first + k * ADXL355_FIFO_ENTRIES_PER_SAMPLE) * ADXL355_FIFO_BYTES_PER_ENTRY];
+
+        if ((e[2] & ADXL355_FIFO_EMPTY) || (e[5] & ADXL355_FIFO_EMPTY) || (e[8] & ADXL355_FIFO_EMPTY)) {
+            break;
+        }
+        if (!(e[2] & ADXL355_FIFO_X_MARKER)) {
+            s_adxl_fifo_resyncs++;
+            break;
+        }
+
+        adxl355_raw_sample_t *slot = adxl355_ring_claim(&adxl355_ring_buffer);
+        if (slot == NULL) {
+            continue;
+        }
+
+        slot->tick  = now_tick - (avail - 1u - first_sample_index - k) * period_ticks;
+        slot->raw_x = adxl355_unpack_20b(&e[0]);
+        slot->raw_y = adxl355_unpack_20b(&e[3]);
+        slot->raw_z = adxl355_unpack_20b(&e[6]);
+
+        adxl355_ring_publish(&adxl355_ring_buffer);
+        adxl355_sample_count++;
+        pushed++;
+    }
+
+    if (pushed) {
+        s_adxl_fifo_bursts++;
+    }
+    return HEALTH_ANSWERED;
+}
+#endif /* ADXL355_USE_FIFO_BURST */
+
+/** @brief 32-bit response of a completed SCL3300 frame (MSB first on the wire). */
+static inline uint32_t IRAM_ATTR scl3300_frame_resp(const spi_transaction_t *t)
+{
+    return ((uint32_t)t->rx_data[0] << 24) |
+           ((uint32_t)t->rx_data[1] << 16) |
+           ((uint32_t)t->rx_data[2] << 8)  |
+           (uint32_t)t->rx_data[3];
+}
+
+/**
+ * @brief Run frames [first, first + count) of the prebuilt angle sequence.
+ *
+ * @return false if any frame failed to transfer; rx_data then holds stale
+ *         bytes from the previous slot and must not be used.
+ */
+static inline bool IRAM_ATTR scl3300_run_sequence(uint32_t first, uint32_t count)
+{
+    bool ok = true;
+
+#if SCL3300_HW_CS
+    if (s_acq_mode == SENSOR_ACQ_MODE_TASK) {
+        /* Whole sequence in the driver queue; CS rises between frames */
+        uint32_t queued = 0;
+        for (; queued < count; queued++) {
+            if (spi_device_queue_trans(scl3300_spi_handle, &s_scl_seq[first + queued],
+                                       portMAX_DELAY) != ESP_OK) {
+                ok = false;
+                break;
+            }
+        }
+        for (uint32_t i = 0; i < queued; i++) {
+            spi_transaction_t *done = NULL;
+            if (spi_device_get_trans_result(scl3300_spi_handle, &done, portMAX_DELAY) != ESP_OK) {
+                ok = false;
+            }
+        }
+        return ok;
+    }
 
-    if (resp_out) {
-        *resp_out = ((uint32_t)t.rx_data[0] << 24) |
-                    ((uint32_t)t.rx_data[1] << 16) |
-                    ((uint32_t)t.rx_data[2] << 8)  |
-                    (uint32_t)t.rx_data[3];
+    for (uint32_t i = 0; i < count; i++) {
+        if (acq_spi_transfer(scl3300_spi_handle, &s_scl_seq[first + i]) != ESP_OK) {
+            ok = false;
+        }
+    }
+#else
+    for (uint32_t i = 0; i < count; i++) {
+        acq_bus_lock();
+        gpio_set_level(SPI_CS_SCL3300_IO, 1);
+        gpio_set_level(SPI_CS_SCL3300_IO, 0);
+        if (acq_spi_transfer(scl3300_spi_handle, &s_scl_seq[first + i]) != ESP_OK) {
+            ok = false;
+        }
+        gpio_set_level(SPI_CS_SCL3300_IO, 1);
+        acq_bus_unlock();
     }
+#endif
+
+    return ok;
 }
 
 /**
@@ -275,19 +818,23 @@ static inline int16_t IRAM_ATTR scl3300_unpack_raw16(uint32_t resp)
 
 static inline void IRAM_ATTR scl3300_prime_pipeline_once(void)
 {
-    uint32_t dummy;
-    scl3300_isr_transfer(SCL3300_CMD_X, &dummy);
+    /* Send X only; its response arrives with the first Y frame */
+    scl3300_run_sequence(SCL3300_SEQ_X, 1);
     s_scl_pipeline_primed = true;
     s_scl_discard_first_sample = true;
     s_scl_prime_count++;
 }
 
-static inline bool IRAM_ATTR read_scl3300_raw(int16_t *raw_x, int16_t *raw_y, int16_t *raw_z)
+/**
+ * @brief One rolling SCL3300 read.
+ *
+ * @param[out] obs HEALTH_ANSWERED once three valid frames came back (even if
+ *                 the sample is the post-prime discard), HEALTH_INVALID on a
+ *                 failed transfer or bad frame; untouched while priming.
+ */
+static inline bool IRAM_ATTR read_scl3300_raw(int16_t *raw_x, int16_t *raw_y, int16_t *raw_z,
+                                              health_obs_t *obs)
 {
-    uint32_t resp_x;
-    uint32_t resp_y;
-    uint32_t resp_z;
-
     if (!s_scl_pipeline_primed) {
         scl3300_prime_pipeline_once();
         return false;
@@ -297,9 +844,15 @@ static inline bool IRAM_ATTR read_scl3300_raw(int16_t *raw_x, int16_t *raw_y, in
        send Y -> receive X
        send Z -> receive Y
        send X -> receive Z */
-    scl3300_isr_transfer(SCL3300_CMD_Y, &resp_x);
-    scl3300_isr_transfer(SCL3300_CMD_Z, &resp_y);
-    scl3300_isr_transfer(SCL3300_CMD_X, &resp_z);
+    if (!scl3300_run_sequence(SCL3300_SEQ_Y, SCL3300_SEQ_FRAMES)) {
+        s_scl_invalid_count++;
+        *obs = HEALTH_INVALID;
+        return false;
+    }
+
+    uint32_t resp_x = scl3300_frame_resp(&s_scl_seq[SCL3300_SEQ_Y]);
+    uint32_t resp_y = scl3300_frame_resp(&s_scl_seq[SCL3300_SEQ_Z]);
+    uint32_t resp_z = scl3300_frame_resp(&s_scl_seq[SCL3300_SEQ_X]);
 
     /* Validate all three response frames. If any frame has bad RS bits
        or looks like a disconnected sensor, reject the whole sample. */
@@ -307,8 +860,20 @@ static inline bool IRAM_ATTR read_scl3300_raw(int16_t *raw_x, int16_t *raw_y, in
         !scl3300_response_valid(resp_y) ||
         !scl3300_response_valid(resp_z)) {
         s_scl_invalid_count++;
+        *obs = HEALTH_INVALID;
+        return false;
+    }
+    /* Frames that look valid but fail CRC were corrupted on the wire: the
+       SPI clock fallback in sensor_recovery.c counts these */
+    if (!scl3300_frame_crc_ok(resp_x) ||
+        !scl3300_frame_crc_ok(resp_y) ||
+        !scl3300_frame_crc_ok(resp_z)) {
+        s_scl_crc_errors++;
+        s_scl_invalid_count++;
+        *obs = HEALTH_INVALID;
         return false;
     }
+    *obs = HEALTH_ANSWERED;
 
     *raw_x = scl3300_unpack_raw16(resp_x);
     *raw_y = scl3300_unpack_raw16(resp_y);
@@ -324,160 +889,555 @@ static inline bool IRAM_ATTR read_scl3300_raw(int16_t *raw_x, int16_t *raw_y, in
     return true;
 }
 
-static inline void IRAM_ATTR read_adt7420_raw(uint16_t *raw_temp)
+/******************************************************************************
+ * SLOT SCHEDULE
+ *****************************************************************************/
+
+static uint32_t gcd_u32(uint32_t a, uint32_t b)
+{
+    while (b != 0u) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/**
+ * @brief Fold SENSOR_SLOT_TABLE into the phase table (timer stopped).
+ *
+ * The table spans the LCM of all slot periods; a sensor is due on phase p
+ * when p % period == offset % period, the same ticks the old per-sensor
+ * modulo tests picked.
+ *
+ * @return ESP_ERR_INVALID_SIZE if the hyperperiod exceeds
+ *         SENSOR_SLOT_MAX_PHASES (the previous table is kept).
+ */
+static esp_err_t sensor_slot_schedule_build(void)
 {
-    /* Intentionally unused in ISR */
-    *raw_temp = 0;
+    uint64_t len = 1;
+#define X(name, period, offset, inhibit, service)                               \
+    len = len / gcd_u32((uint32_t)len, (uint32_t)(period)) * (uint32_t)(period); \
+    if (len > SENSOR_SLOT_MAX_PHASES) {                                         \
+        ESP_LOGE(TAG, "Slot schedule for " #name " period %lu exceeds %u phases", \
+                 (unsigned long)(period), SENSOR_SLOT_MAX_PHASES);               \
+        return ESP_ERR_INVALID_SIZE;                                            \
+    }
+    SENSOR_SLOT_TABLE(X)
+#undef X
+
+    memset(s_slot_sched, 0, sizeof(s_slot_sched));
+#define X(name, period, offset, inhibit, service)                               \
+    for (uint32_t p = (uint32_t)(offset) % (uint32_t)(period); p < len;         \
+         p += (uint32_t)(period)) {                                             \
+        s_slot_sched[p] |= (uint8_t)SLOT_BIT(name);                             \
+    }
+    SENSOR_SLOT_TABLE(X)
+#undef X
+
+    s_slot_len   = (uint32_t)len;
+    s_slot_phase = tick_counter % s_slot_len;
+    return ESP_OK;
 }
 
 /******************************************************************************
  * ISR
  *****************************************************************************/
 
-static bool IRAM_ATTR timer_isr_handler(gptimer_handle_t timer,
-                                        const gptimer_alarm_event_data_t *edata,
-                                        void *user_ctx)
+/**
+ * @brief Current acquisition tick (125 us units) for stamping samples.
+ *
+ * Timer mode counts alarms. DRDY mode has no 8 kHz alarm, so the tick is
+ * derived from esp_timer with the same 125 us resolution; everything
+ * downstream (TICKS_TO_US, packet_time anchors) works unchanged.
+ */
+static inline uint32_t IRAM_ATTR acquisition_tick_now(void)
 {
-    (void)timer;
-    (void)edata;
-    (void)user_ctx;
-
-    tick_counter++;
-
-    uint32_t next_write_index;
-    uint32_t current_read_index;
+    if (s_acq_mode == SENSOR_ACQ_MODE_DRDY) {
+        return (uint32_t)((esp_timer_get_time() - s_tick_epoch_us) / TIMER_PERIOD_US);
+    }
+    return tick_counter;
+}
 
-    /* ADXL355 @ 1000 Hz */
-    if (!s_adxl355_isr_inhibit &&
-        ((tick_counter - ADXL355_OFFSET) & (ADXL355_TICK_DIVISOR - 1u)) == 0u)
-    {
-        next_write_index = (adxl355_ring_buffer.write_index + 1u) & (ADXL355_BUFFER_SIZE - 1u);
-        current_read_index = adxl355_ring_buffer.read_index;
+/**
+ * @brief True if the sensor's slot should be serviced: always while up,
+ *        only when the next probe is due while down. No side effects, so
+ *        the TASK-mode ISR can use it to skip the wakeup.
+ */
+static inline bool IRAM_ATTR health_slot_open(const sensor_health_t *h, uint32_t tick)
+{
+    return !h->down || (int32_t)(tick - h->next_probe_tick) >= 0;
+}
 
-        if (next_write_index == current_read_index)
-        {
-            adxl355_ring_buffer.overflow_count++;
-        }
-        else
-        {
-            int32_t rx, ry, rz;
-            bool valid = read_adxl355_raw(&rx, &ry, &rz);
-
-            if (valid) {
-                adxl355_ring_buffer.buffer[adxl355_ring_buffer.write_index].tick = tick_counter;
-                adxl355_ring_buffer.buffer[adxl355_ring_buffer.write_index].raw_x = rx;
-                adxl355_ring_buffer.buffer[adxl355_ring_buffer.write_index].raw_y = ry;
-                adxl355_ring_buffer.buffer[adxl355_ring_buffer.write_index].raw_z = rz;
-
-                adxl355_ring_buffer.write_index = next_write_index;
-                adxl355_sample_count++;
-            }
-            /* If invalid (disconnected sensor), sample is silently dropped.
-             * The watchdog in data_processing_task detects the stalled
-             * sample_count and emits NaN packets + fault codes. */
-        }
+/** @brief health_slot_open() for the service path, counting probes and skips. */
+static inline bool IRAM_ATTR health_slot_take(sensor_health_t *h, uint32_t tick)
+{
+    if (!h->down) {
+        return true;
+    }
+    if ((int32_t)(tick - h->next_probe_tick) < 0) {
+        h->skipped++;
+        return false;
     }
+    h->probes++;
+    return true;
+}
 
-    /* SCL3300 @ 20 Hz */
-    if (!s_scl3300_isr_inhibit &&
-        ((tick_counter - SCL3300_OFFSET) % SCL3300_TICK_DIVISOR) == 0u)
-    {
-        s_scl_isr_fired++;
+static void IRAM_ATTR subscriber_notify(uint32_t bits)
+{
+    TaskHandle_t task = s_health_notify_task;
+    if (task == NULL) {
+        return;
+    }
+    if (xPortInIsrContext()) {
+        /* The subscriber is lower priority than anything that calls this
+         * from an ISR, so the yield can wait for the next tick */
+        xTaskNotifyFromISR(task, bits, eSetBits, NULL);
+    } else {
+        xTaskNotify(task, bits, eSetBits);
+    }
+}
 
-        int16_t raw_x = 0;
-        int16_t raw_y = 0;
-        int16_t raw_z = 0;
+static void IRAM_ATTR health_notify(sensor_health_dev_t dev)
+{
+    subscriber_notify(SENSOR_HEALTH_NOTIFY_BIT(dev));
+}
 
-        next_write_index = (scl3300_ring_buffer.write_index + 1u) & (SCL3300_BUFFER_SIZE - 1u);
-        current_read_index = scl3300_ring_buffer.read_index;
+void IRAM_ATTR sensor_data_note_ready(uint32_t n)
+{
+    uint32_t wm = s_data_watermark;
+    if (wm == 0u || n == 0u) {
+        return;
+    }
+    uint32_t pending = s_data_pending + n;
+    if (pending >= wm) {
+        pending = 0;
+        s_data_wakeups++;
+        subscriber_notify(SENSOR_DATA_NOTIFY_BIT);
+    }
+    s_data_pending = pending;
+}
 
-        if (next_write_index == current_read_index)
-        {
-            scl3300_ring_buffer.overflow_count++;
-            s_scl_overflow_dbg++;
-        }
-        else
-        {
-            bool valid = read_scl3300_raw(&raw_x, &raw_y, &raw_z);
-
-            if (valid)
-            {
-                scl3300_ring_buffer.buffer[scl3300_ring_buffer.write_index].tick = tick_counter;
-                scl3300_ring_buffer.buffer[scl3300_ring_buffer.write_index].raw_x = raw_x;
-                scl3300_ring_buffer.buffer[scl3300_ring_buffer.write_index].raw_y = raw_y;
-                scl3300_ring_buffer.buffer[scl3300_ring_buffer.write_index].raw_z = raw_z;
-
-                scl3300_ring_buffer.write_index = next_write_index;
-                scl3300_sample_count++;
-            }
+/** @brief Fold one read result into the sensor's health state. */
+static inline void IRAM_ATTR health_note(sensor_health_dev_t dev, health_obs_t obs, uint32_t tick)
+{
+    sensor_health_t *h = &s_health[dev];
+
+    if (obs == HEALTH_ANSWERED) {
+        h->invalid_run = 0;
+        if (h->down) {
+            h->down = false;
+            h->ups++;
+            health_notify(dev);
         }
+        return;
+    }
+    if (obs != HEALTH_INVALID) {
+        return;
     }
 
-    /*
-    // ADT7420 Sampling (1 Hz - every 8000 ticks)
-    // Intentionally left commented out.
-    if (s_temp_available && ((tick_counter - ADT7420_OFFSET) % ADT7420_TICK_DIVISOR) == 0u)
-    {
-        next_write_index = (adt7420_ring_buffer.write_index + 1u) & (ADT7420_BUFFER_SIZE - 1u);
-        current_read_index = adt7420_ring_buffer.read_index;
+    if (h->invalid_run < UINT32_MAX) {
+        h->invalid_run++;
+    }
+    if (h->down) {
+        /* Unanswered probe: back off */
+        uint32_t next = h->probe_ticks * 2u;
+        h->probe_ticks = (next > HEALTH_PROBE_MAX_TICKS) ? HEALTH_PROBE_MAX_TICKS : next;
+        h->next_probe_tick = tick + h->probe_ticks;
+    } else if (h->invalid_run >= h->limit) {
+        h->down = true;
+        h->downs++;
+        h->probe_ticks = HEALTH_PROBE_MIN_TICKS;
+        h->next_probe_tick = tick + h->probe_ticks;
+        health_notify(dev);
+    }
+}
 
-        if (next_write_index == current_read_index)
-        {
-            adt7420_ring_buffer.overflow_count++;
-        }
-        else
-        {
-            adt7420_ring_buffer.buffer[adt7420_ring_buffer.write_index].tick = tick_counter;
-            read_adt7420_raw(&adt7420_ring_buffer.buffer[adt7420_ring_buffer.write_index].raw_temp);
-            adt7420_ring_buffer.write_index = next_write_index;
-            adt7420_sample_count++;
-        }
+/** @brief Read one ADXL355 XDATA sample and push it with the given tick. */
+static inline health_obs_t IRAM_ATTR adxl355_isr_poll_one(uint32_t tick)
+{
+    adxl355_raw_sample_t *slot = adxl355_ring_claim(&adxl355_ring_buffer);
+    if (slot == NULL) {
+        return HEALTH_NO_INFO;
     }
-    */
 
-    return false;
+    int32_t rx, ry, rz;
+    bool valid = read_adxl355_raw(&rx, &ry, &rz);
+
+    if (valid) {
+        slot->tick  = tick;
+        slot->raw_x = rx;
+        slot->raw_y = ry;
+        slot->raw_z = rz;
+
+        adxl355_ring_publish(&adxl355_ring_buffer);
+        adxl355_sample_count++;
+        return HEALTH_ANSWERED;
+    }
+    /* Invalid (disconnected sensor): the sample is dropped and counted
+     * toward the health limit, which disables the slot and notifies the
+     * data task. */
+    return HEALTH_INVALID;
 }
 
-/******************************************************************************
- * INITIALIZATION
- *****************************************************************************/
+/** @brief One ADXL355 service slot: FIFO drain or single poll. */
+static inline void IRAM_ATTR adxl355_isr_service(uint32_t tick)
+{
+    if (!health_slot_take(&s_health[SENSOR_HEALTH_ADXL355], tick)) {
+        return;
+    }
 
-esp_err_t sensor_acquisition_init(bool temp_sensor_available)
+    uint32_t t0 = esp_cpu_get_cycle_count();
+    uint32_t before = adxl355_sample_count;
+#if ADXL355_USE_FIFO_BURST
+    health_obs_t obs = drain_adxl355_fifo(tick, s_adxl_tick_divisor, s_adxl_fifo_flush_pending);
+#else
+    health_obs_t obs = adxl355_isr_poll_one(tick);
+#endif
+    health_note(SENSOR_HEALTH_ADXL355, obs, tick);
+    if (!s_data_external) {
+        sensor_data_note_ready(adxl355_sample_count - before);
+    }
+    timing_hist_record(TIMING_SPI_ADXL355, esp_cpu_get_cycle_count() - t0);
+}
+
+/** @brief One SCL3300 service slot: rolling read and ring-buffer push. */
+static inline health_obs_t IRAM_ATTR scl3300_isr_service_inner(uint32_t tick)
 {
-    esp_err_t ret;
+    s_scl_isr_fired++;
 
-    s_temp_available = temp_sensor_available;
+    int16_t raw_x = 0;
+    int16_t raw_y = 0;
+    int16_t raw_z = 0;
 
-    ESP_LOGI(TAG, "Initializing ISR-based sensor acquisition...");
-    ESP_LOGI(TAG, "  Base timer: %d Hz (%d us period)", BASE_TIMER_FREQ_HZ, TIMER_PERIOD_US);
-    ESP_LOGI(TAG, "  ADXL355: %d Hz (every %d ticks, offset %d)",
-             ADXL355_RATE_HZ, ADXL355_TICK_DIVISOR, ADXL355_OFFSET);
-    ESP_LOGI(TAG, "  SCL3300: %d Hz (every %d ticks, offset %d)",
-             SCL3300_RATE_HZ, SCL3300_TICK_DIVISOR, SCL3300_OFFSET);
-    ESP_LOGI(TAG, "  ADT7420: %d Hz (every %d ticks, offset %d)",
-             ADT7420_RATE_HZ, ADT7420_TICK_DIVISOR, ADT7420_OFFSET);
+    scl3300_raw_sample_t *slot = scl3300_ring_claim(&scl3300_ring_buffer);
+    if (slot == NULL)
+    {
+        s_scl_overflow_dbg++;
+        return HEALTH_NO_INFO;
+    }
 
-    memset(&adxl355_ring_buffer, 0, sizeof(adxl355_ring_buffer));
-    memset(&scl3300_ring_buffer, 0, sizeof(scl3300_ring_buffer));
-    memset(&adt7420_ring_buffer, 0, sizeof(adt7420_ring_buffer));
+    health_obs_t obs = HEALTH_NO_INFO;
+    bool valid = read_scl3300_raw(&raw_x, &raw_y, &raw_z, &obs);
 
-    tick_counter = 0;
-    adxl355_sample_count = 0;
-    scl3300_sample_count = 0;
-    adt7420_sample_count = 0;
+    if (valid)
+    {
+        slot->tick  = tick;
+        slot->raw_x = raw_x;
+        slot->raw_y = raw_y;
+        slot->raw_z = raw_z;
 
-    s_scl_pipeline_primed = false;
-    s_scl_discard_first_sample = true;
+        scl3300_ring_publish(&scl3300_ring_buffer);
+        scl3300_sample_count++;
+    }
+    return obs;
+}
 
-#ifdef SPI_CS_SCL3300_IO
-    gpio_set_direction(SPI_CS_SCL3300_IO, GPIO_MODE_OUTPUT);
-    gpio_set_level(SPI_CS_SCL3300_IO, 1);
+/** @brief SCL3300 service slot, timed for the spi_scl3300 histogram. */
+static inline void IRAM_ATTR scl3300_isr_service(uint32_t tick)
+{
+    if (!health_slot_take(&s_health[SENSOR_HEALTH_SCL3300], tick)) {
+        return;
+    }
+
+    uint32_t t0 = esp_cpu_get_cycle_count();
+    health_note(SENSOR_HEALTH_SCL3300, scl3300_isr_service_inner(tick), tick);
+    timing_hist_record(TIMING_SPI_SCL3300, esp_cpu_get_cycle_count() - t0);
+}
+
+/** @brief Advance the schedule one tick and return the due slot bits. */
+static inline uint32_t IRAM_ATTR slot_schedule_next(void)
+{
+    uint32_t phase = s_slot_phase + 1u;
+    if (phase == s_slot_len) {
+        phase = 0;
+    }
+    s_slot_phase = phase;
+    return s_slot_sched[phase];
+}
+
+static bool IRAM_ATTR timer_isr_handler(gptimer_handle_t timer,
+                                        const gptimer_alarm_event_data_t *edata,
+                                        void *user_ctx)
+{
+    (void)user_ctx;
+    uint32_t isr_start = esp_cpu_get_cycle_count();
+    isr_jitter_sample(isr_start);
+
+    /* Re-arm one period after the alarm that fired (not after "now") so a
+       long burst never stretches the tick grid. */
+    gptimer_alarm_config_t next_alarm = {
+        .alarm_count = edata->alarm_value + TIMER_PERIOD_US,
+    };
+    gptimer_set_alarm_action(timer, &next_alarm);
+
+    tick_counter++;
+
+    uint32_t due = slot_schedule_next();
+    if (due != 0u) {
+        const uint32_t tick = tick_counter;
+#define X(name, period, offset, inhibit, service)                   \
+        if ((due & SLOT_BIT(name)) && !(inhibit)) {                 \
+            service(tick);                                          \
+        }
+        SENSOR_SLOT_TABLE(X)
+#undef X
+    }
+
+    isr_timing_end(isr_start);
+    return false;
+}
+
+/**
+ * @brief TASK mode: 8 kHz slot ISR with no SPI.
+ *
+ * Same slot schedule as timer_isr_handler; due sensors are handed to the
+ * acquisition task with their tick. If a slot comes due while the previous
+ * one is still pending the tick is overwritten and the overrun counted.
+ */
+static bool IRAM_ATTR task_mode_timer_isr_handler(gptimer_handle_t timer,
+                                                  const gptimer_alarm_event_data_t *edata,
+                                                  void *user_ctx)
+{
+    (void)user_ctx;
+    uint32_t isr_start = esp_cpu_get_cycle_count();
+    isr_jitter_sample(isr_start);
+
+    gptimer_alarm_config_t next_alarm = {
+        .alarm_count = edata->alarm_value + TIMER_PERIOD_US,
+    };
+    gptimer_set_alarm_action(timer, &next_alarm);
+
+    tick_counter++;
+
+    uint32_t slots = slot_schedule_next();
+    uint32_t due   = 0;
+    if (slots != 0u) {
+        const uint32_t tick = tick_counter;
+        /* A down sensor's skipped slots do not wake the task at all */
+#define X(name, period, offset, inhibit, service)                                   \
+        if ((slots & SLOT_BIT(name)) && !(inhibit)) {                               \
+            if (health_slot_open(&s_health[SENSOR_HEALTH_##name], tick)) {          \
+                s_task_slot_tick[SLOT_IDX_##name] = tick;                           \
+                due |= SLOT_BIT(name);                                              \
+            } else {                                                                \
+                s_health[SENSOR_HEALTH_##name].skipped++;                           \
+            }                                                                       \
+        }
+        SENSOR_SLOT_TABLE(X)
+#undef X
+    }
+
+    BaseType_t higher_woken = pdFALSE;
+    if (due) {
+        if (s_task_pending & due) {
+            s_task_slot_overruns++;
+        }
+        s_task_pending |= due;
+        s_task_notify_us = (uint32_t)esp_timer_get_time();
+        xTaskNotifyFromISR(s_acq_task, due, eSetBits, &higher_woken);
+    }
+
+    isr_timing_end(isr_start);
+    return higher_woken == pdTRUE;
+}
+
+/**
+ * @brief TASK mode acquisition task (SHM_CORE_ACQ, highest priority).
+ *
+ * Services every notified sensor back-to-back: the ADXL355 burst/poll is
+ * queued first, then the three SCL3300 frames. With hardware CS the angle
+ * frames are queued as one sequence; with manual CS the task waits for each
+ * result before toggling CS for the next.
+ */
+static void acquisition_task(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+        s_task_pending &= ~bits;
+
+        int64_t wake_us = esp_timer_get_time();
+        uint32_t latency = (uint32_t)wake_us - s_task_notify_us;
+        if (latency > s_task_wake_us_max) {
+            s_task_wake_us_max = latency;
+        }
+        s_task_wake_us_sum += latency;
+        s_task_wake_count++;
+
+        xSemaphoreTake(s_task_service_lock, portMAX_DELAY);
+
+#define X(name, period, offset, inhibit, service)                   \
+        if ((bits & SLOT_BIT(name)) && !(inhibit)) {                \
+            service(s_task_slot_tick[SLOT_IDX_##name]);             \
+        }
+        SENSOR_SLOT_TABLE(X)
+#undef X
+
+        xSemaphoreGive(s_task_service_lock);
+
+        uint32_t service = (uint32_t)(esp_timer_get_time() - wake_us);
+        if (service > s_task_service_us_max) {
+            s_task_service_us_max = service;
+        }
+    }
+}
+
+/**
+ * @brief Wait until the acquisition task is outside a sensor service.
+ *
+ * Inhibit flags are checked by the task before each service, but a service
+ * already in flight must finish before task-context reinit touches the bus.
+ * Blocks on the task's service lock (priority inheritance lifts the caller
+ * for the moment it holds it).
+ *
+ * @return ESP_ERR_TIMEOUT if a service is still running after
+ *         ACQ_TASK_IDLE_TIMEOUT_MS
+ */
+static esp_err_t acquisition_task_wait_idle(void)
+{
+    if (s_task_service_lock == NULL) {
+        return ESP_OK;
+    }
+    if (xSemaphoreTake(s_task_service_lock, pdMS_TO_TICKS(ACQ_TASK_IDLE_TIMEOUT_MS)) != pdTRUE) {
+        ESP_LOGE(TAG, "Acquisition task still servicing after %d ms", ACQ_TASK_IDLE_TIMEOUT_MS);
+        return ESP_ERR_TIMEOUT;
+    }
+    xSemaphoreGive(s_task_service_lock);
+    return ESP_OK;
+}
+
+/**
+ * @brief DRDY mode: SCL3300-only timer at SCL3300_RATE_HZ.
+ *
+ * Same absolute re-arm scheme as timer_isr_handler, but one alarm per
+ * inclinometer sample instead of one per 125 us tick.
+ */
+static bool IRAM_ATTR drdy_mode_timer_isr_handler(gptimer_handle_t timer,
+                                                  const gptimer_alarm_event_data_t *edata,
+                                                  void *user_ctx)
+{
+    (void)user_ctx;
+    uint32_t isr_start = esp_cpu_get_cycle_count();
+    isr_jitter_sample(isr_start);
+
+    gptimer_alarm_config_t next_alarm = {
+        .alarm_count = edata->alarm_value + SCL3300_DRDY_TIMER_PERIOD_US,
+    };
+    gptimer_set_alarm_action(timer, &next_alarm);
+
+    if (!s_scl3300_isr_inhibit) {
+        scl3300_isr_service(acquisition_tick_now());
+    }
+
+    isr_timing_end(isr_start);
+    return false;
+}
+
+/**
+ * @brief DRDY mode: ADXL355 INT1 handler.
+ *
+ * With FIFO burst enabled INT1 carries FIFO_FULL (watermark) and is level
+ * triggered: the drain empties the FIFO below the watermark, which releases
+ * the line. Without FIFO burst INT1 carries DATA_RDY and is edge triggered.
+ *
+ * GPIO and timer interrupts are both allocated at SHM_ACQ_INTR_LEVEL on the
+ * acquisition core,
+ * so this never preempts an SCL3300 transfer mid-frame (or vice versa).
+ */
+static void IRAM_ATTR adxl355_int1_isr_handler(void *arg)
+{
+    (void)arg;
+
+    if (s_adxl355_isr_inhibit) {
+        return;
+    }
+    uint32_t isr_start = esp_cpu_get_cycle_count();
+    adxl355_isr_service(acquisition_tick_now());
+    isr_timing_end(isr_start);
+}
+
+/**
+ * @brief Program the ADXL355 interrupt routing for DRDY mode (task context).
+ *
+ * Also called when an ISR inhibit is released, because a reinit rewrites
+ * INT_MAP back to the driver default.
+ */
+static esp_err_t adxl355_configure_drdy_int(void)
+{
+#if ADXL355_USE_FIFO_BURST
+    esp_err_t err = adxl355_write_reg_pub(ADXL355_REG_FIFO_SAMPLES,
+                                          ADXL355_DRDY_WATERMARK_SAMPLES * ADXL355_FIFO_ENTRIES_PER_SAMPLE);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return adxl355_write_reg_pub(ADXL355_REG_INT_MAP, ADXL355_INT_FULL_EN1);
+#else
+    return adxl355_write_reg_pub(ADXL355_REG_INT_MAP, ADXL355_INT_RDY_EN1);
 #endif
+}
+
+static esp_err_t adxl355_int1_gpio_init(void)
+{
+    gpio_config_t io = {
+        .pin_bit_mask = (1ULL << ADXL355_INT1_IO),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,      /* INT1 is active low (INT_POL=0) */
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+#if ADXL355_USE_FIFO_BURST
+        .intr_type = GPIO_INTR_LOW_LEVEL,
+#else
+        .intr_type = GPIO_INTR_NEGEDGE,
+#endif
+    };
+    esp_err_t ret = gpio_config(&io);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = gpio_install_isr_service(ESP_INTR_FLAG_IRAM | SHM_ACQ_INTR_FLAG_LEVEL);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {   /* already installed is fine */
+        return ret;
+    }
+
+    ret = gpio_isr_handler_add(ADXL355_INT1_IO, adxl355_int1_isr_handler, NULL);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    /* Armed in sensor_acquisition_start() */
+    return gpio_intr_disable(ADXL355_INT1_IO);
+}
+
+/**
+ * @brief Install the INT1 GPIO ISR (DRDY mode) and create the GPTimer.
+ *
+ * Runs on SHM_CORE_ACQ: both interrupts are allocated on the core that
+ * calls this and are serviced there from then on.
+ */
+static esp_err_t acq_alloc_interrupts(void *arg)
+{
+    (void)arg;
+    esp_err_t ret;
+    bool drdy = (s_acq_mode == SENSOR_ACQ_MODE_DRDY);
+
+    if (drdy) {
+        ret = adxl355_int1_gpio_init();
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to set up ADXL355 INT1 GPIO%d: %s",
+                     ADXL355_INT1_IO, esp_err_to_name(ret));
+            return ret;
+        }
+    }
 
     gptimer_config_t timer_config = {
         .clk_src = GPTIMER_CLK_SRC_DEFAULT,
         .direction = GPTIMER_COUNT_UP,
         .resolution_hz = 1000000,
+        /* Same level as the GPIO ISR so neither nests the other */
+        .intr_priority = SHM_ACQ_INTR_LEVEL,
     };
 
     ret = gptimer_new_timer(&timer_config, &s_timer);
@@ -487,7 +1447,9 @@ esp_err_t sensor_acquisition_init(bool temp_sensor_available)
     }
 
     gptimer_event_callbacks_t cbs = {
-        .on_alarm = timer_isr_handler,
+        .on_alarm = drdy ? drdy_mode_timer_isr_handler :
+                    (s_acq_mode == SENSOR_ACQ_MODE_TASK) ? task_mode_timer_isr_handler :
+                    timer_isr_handler,
     };
     ret = gptimer_register_event_callbacks(s_timer, &cbs, NULL);
     if (ret != ESP_OK) {
@@ -497,10 +1459,10 @@ esp_err_t sensor_acquisition_init(bool temp_sensor_available)
         return ret;
     }
 
+    /* No auto-reload: the ISR re-arms at alarm_value + period (see header) */
     gptimer_alarm_config_t alarm_config = {
-        .reload_count = 0,
-        .alarm_count = TIMER_PERIOD_US,
-        .flags.auto_reload_on_alarm = true,
+        .alarm_count = drdy ? SCL3300_DRDY_TIMER_PERIOD_US : TIMER_PERIOD_US,
+        .flags.auto_reload_on_alarm = false,
     };
     ret = gptimer_set_alarm_action(s_timer, &alarm_config);
     if (ret != ESP_OK) {
@@ -518,6 +1480,99 @@ esp_err_t sensor_acquisition_init(bool temp_sensor_available)
         return ret;
     }
 
+    ESP_LOGI(TAG, "  Interrupts: core %d, level %d", xPortGetCoreID(), SHM_ACQ_INTR_LEVEL);
+    return ESP_OK;
+}
+
+/******************************************************************************
+ * INITIALIZATION
+ *****************************************************************************/
+
+esp_err_t sensor_acquisition_init(bool temp_sensor_available)
+{
+    esp_err_t ret;
+
+    s_temp_available = temp_sensor_available;
+
+    ESP_LOGI(TAG, "Initializing ISR-based sensor acquisition...");
+    if (s_acq_mode == SENSOR_ACQ_MODE_DRDY) {
+        ESP_LOGI(TAG, "  Mode: DRDY (ADXL355 INT1 on GPIO%d, SCL3300 timer %d us)",
+                 ADXL355_INT1_IO, SCL3300_DRDY_TIMER_PERIOD_US);
+    } else if (s_acq_mode == SENSOR_ACQ_MODE_TASK) {
+        ESP_LOGI(TAG, "  Mode: TASK (SPI in acquisition task, core %d, priority %d)",
+                 ACQ_TASK_CORE, ACQ_TASK_PRIORITY);
+    } else {
+        ESP_LOGI(TAG, "  Mode: TIMER");
+    }
+    ESP_LOGI(TAG, "  Base timer: %d Hz (%d us period)", BASE_TIMER_FREQ_HZ, TIMER_PERIOD_US);
+#if ADXL355_USE_FIFO_BURST
+    ESP_LOGI(TAG, "  ADXL355: %lu Hz (FIFO drain every %lu ticks, max %d samples/burst, offset %d)",
+             (unsigned long)(BASE_TIMER_FREQ_HZ / s_adxl_tick_divisor),
+             (unsigned long)s_adxl_fifo_poll_ticks, ADXL355_FIFO_MAX_BURST_SAMPLES, ADXL355_OFFSET);
+#else
+    ESP_LOGI(TAG, "  ADXL355: %lu Hz (every %lu ticks, offset %d)",
+             (unsigned long)(BASE_TIMER_FREQ_HZ / s_adxl_tick_divisor),
+             (unsigned long)s_adxl_tick_divisor, ADXL355_OFFSET);
+#endif
+    ESP_LOGI(TAG, "  SCL3300: %d Hz (every %d ticks, offset %d)",
+             SCL3300_RATE_HZ, SCL3300_TICK_DIVISOR, SCL3300_OFFSET);
+    ESP_LOGI(TAG, "  ADT7420: %d Hz (slow-sensors task%s)",
+             ADT7420_RATE_HZ, s_temp_available ? "" : ", sensor absent at boot");
+
+    /* From here on the ISR engines share the bus with task-context access */
+    spi_bus_set_isr_access(s_acq_mode != SENSOR_ACQ_MODE_TASK);
+
+    adxl355_ring_init(&adxl355_ring_buffer, SPSC_DROP_NEWEST);
+    scl3300_ring_init(&scl3300_ring_buffer, SPSC_DROP_NEWEST);
+    adt7420_ring_init(&adt7420_ring_buffer, SPSC_DROP_NEWEST);
+
+    tick_counter = 0;
+    adxl355_sample_count = 0;
+    scl3300_sample_count = 0;
+    adt7420_sample_count = 0;
+
+    ret = sensor_slot_schedule_build();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ESP_LOGI(TAG, "  Slot schedule: %lu-tick phase table, %d timer slots",
+             (unsigned long)s_slot_len, SLOT_COUNT);
+
+    s_scl_pipeline_primed = false;
+    s_scl_discard_first_sample = true;
+
+    s_adxl_fifo_flush_pending = true;
+    s_adxl_fifo_bursts        = 0;
+    s_adxl_fifo_resyncs       = 0;
+    s_adxl_fifo_full_events   = 0;
+
+#if !SCL3300_HW_CS
+    gpio_set_direction(SPI_CS_SCL3300_IO, GPIO_MODE_OUTPUT);
+    gpio_set_level(SPI_CS_SCL3300_IO, 1);
+#endif
+
+    if (s_acq_mode == SENSOR_ACQ_MODE_TASK && s_acq_task == NULL) {
+        s_task_service_lock = xSemaphoreCreateMutexStatic(&s_task_service_lock_buf);
+        s_acq_task = mem_budget_task_create("acquisition", &s_acq_task_mem, acquisition_task,
+                                            "acq_task", NULL, ACQ_TASK_PRIORITY,
+                                            ACQ_TASK_CORE);
+        if (s_acq_task == NULL) {
+            ESP_LOGE(TAG, "Failed to create acquisition task");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    mem_budget_record("acquisition", MEM_REGION_STATIC,
+                      sizeof(adxl355_ring_buffer) + sizeof(scl3300_ring_buffer) +
+                      sizeof(adt7420_ring_buffer));
+
+    /* The boot lane calling us may be on the network core */
+    ret = cpu_topology_run_on(SHM_CORE_ACQ, acq_alloc_interrupts, NULL);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    s_acq_initialized = true;
+
     ESP_LOGI(TAG, "Sensor acquisition initialized successfully");
     ESP_LOGI(TAG, "Ring buffer sizes: ADXL=%d, SCL=%d, ADT=%d",
              ADXL355_BUFFER_SIZE, SCL3300_BUFFER_SIZE, ADT7420_BUFFER_SIZE);
@@ -526,6 +1581,11 @@ esp_err_t sensor_acquisition_init(bool temp_sensor_available)
 }
 
 esp_err_t sensor_acquisition_start(void)
+{
+    return sensor_acquisition_start_at(0);
+}
+
+esp_err_t sensor_acquisition_start_at(int64_t local_us)
 {
     if (s_timer == NULL) {
         ESP_LOGE(TAG, "Timer not initialized");
@@ -534,11 +1594,52 @@ esp_err_t sensor_acquisition_start(void)
 
     sensor_acquisition_reset_stats();
 
-    esp_err_t ret = gptimer_start(s_timer);
+    /* Whatever accumulated in the ADXL355 FIFO while stopped has no valid
+       tick; empty it on the first drain. */
+    s_adxl_fifo_flush_pending = true;
+
+    esp_err_t ret;
+
+    if (s_acq_mode == SENSOR_ACQ_MODE_DRDY) {
+        ret = adxl355_configure_drdy_int();
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to route ADXL355 INT1: %s", esp_err_to_name(ret));
+            return ret;
+        }
+    }
+
+    /* Nominal alarm spacing for the tick_jitter histogram */
+    s_jitter_period_cycles = esp_rom_get_cpu_ticks_per_us() *
+                             (s_acq_mode == SENSOR_ACQ_MODE_DRDY ? SCL3300_DRDY_TIMER_PERIOD_US
+                                                                 : TIMER_PERIOD_US);
+    s_jitter_last_valid = false;
+
+    /* Rewind so the first alarm lands exactly one period after the start
+       instant; otherwise the grid keeps the phase of the previous run. */
+    gptimer_alarm_config_t first_alarm = {
+        .alarm_count = (s_acq_mode == SENSOR_ACQ_MODE_DRDY) ? SCL3300_DRDY_TIMER_PERIOD_US
+                                                            : TIMER_PERIOD_US,
+        .flags.auto_reload_on_alarm = false,
+    };
+    gptimer_set_raw_count(s_timer, 0);
+    gptimer_set_alarm_action(s_timer, &first_alarm);
+
+    /* Scheduled start: everything slow is done, wait out the last stretch */
+    while (local_us > 0 && esp_timer_get_time() < local_us) {
+    }
+
+    s_start_local_us = esp_timer_get_time();
+    s_tick_epoch_us  = s_start_local_us;
+    ret = gptimer_start(s_timer);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start timer: %s", esp_err_to_name(ret));
         return ret;
     }
+    s_timer_running = true;
+
+    if (s_acq_mode == SENSOR_ACQ_MODE_DRDY) {
+        gpio_intr_enable(ADXL355_INT1_IO);
+    }
 
     ESP_LOGI(TAG, "Sensor acquisition STARTED");
     return ESP_OK;
@@ -550,120 +1651,198 @@ esp_err_t sensor_acquisition_stop(void)
         return ESP_OK;
     }
 
+    if (s_acq_mode == SENSOR_ACQ_MODE_DRDY) {
+        gpio_intr_disable(ADXL355_INT1_IO);
+    }
+
     esp_err_t ret = gptimer_stop(s_timer);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to stop timer: %s", esp_err_to_name(ret));
         return ret;
     }
+    s_timer_running = false;
 
     ESP_LOGI(TAG, "Sensor acquisition STOPPED");
     return ESP_OK;
 }
 
+esp_err_t sensor_acquisition_set_adxl355_divisor(uint32_t tick_divisor)
+{
+    if (tick_divisor < ADXL355_MIN_TICK_DIVISOR ||
+        tick_divisor > BASE_TIMER_FREQ_HZ ||
+        (tick_divisor & (tick_divisor - 1u)) != 0u) {
+        ESP_LOGE(TAG, "Invalid ADXL355 tick divisor %lu (power of two >= %d required)",
+                 (unsigned long)tick_divisor, ADXL355_MIN_TICK_DIVISOR);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_timer_running) {
+        ESP_LOGE(TAG, "ADXL355 rate change requested while acquisition is running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t old_divisor = s_adxl_tick_divisor;
+    s_adxl_tick_divisor    = tick_divisor;
+    s_adxl_fifo_poll_ticks = tick_divisor * ADXL355_FIFO_POLL_SAMPLES;
+    if (sensor_slot_schedule_build() != ESP_OK) {
+        s_adxl_tick_divisor    = old_divisor;
+        s_adxl_fifo_poll_ticks = old_divisor * ADXL355_FIFO_POLL_SAMPLES;
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Samples still queued were taken at the old rate and would be decimated
+       with the wrong factor; drop them. The ISR is stopped so this is safe. */
+    adxl355_discard_samples();
+    s_adxl_fifo_flush_pending = true;
+
+    uint32_t capacity_ms = adxl355_buffer_capacity_ms();
+    ESP_LOGI(TAG, "ADXL355 schedule: %lu Hz (every %lu ticks), ring buffer holds %lu ms",
+             (unsigned long)(BASE_TIMER_FREQ_HZ / tick_divisor),
+             (unsigned long)tick_divisor,
+             (unsigned long)capacity_ms);
+    uint32_t backlog_ms = raw_history_enabled() ? ADXL355_RING_DRAIN_HEADROOM_MS
+                                                : ADXL355_RING_BACKLOG_MS;
+    if (capacity_ms < backlog_ms) {
+        ESP_LOGW(TAG, "ADXL355 backlog of %lu ms at %lu Hz is below the %lu ms target; "
+                 "raise CONFIG_SHM_ADXL355_RING_SAMPLES",
+                 (unsigned long)capacity_ms,
+                 (unsigned long)(BASE_TIMER_FREQ_HZ / tick_divisor),
+                 (unsigned long)backlog_ms);
+    }
+    return ESP_OK;
+}
+
+uint32_t adxl355_get_tick_divisor(void)
+{
+    return s_adxl_tick_divisor;
+}
+
 /******************************************************************************
  * RING BUFFER ACCESS FUNCTIONS
  *****************************************************************************/
 
+/*
+ * ADXL355 consumer side. With the PSRAM history enabled the drain task is
+ * the ISR ring's consumer and the data task reads the history instead.
+ */
+
 bool adxl355_data_available(void)
 {
-    return (adxl355_ring_buffer.write_index != adxl355_ring_buffer.read_index);
+    return adxl355_samples_available() > 0u;
 }
 
 bool adxl355_read_sample(adxl355_raw_sample_t *sample)
 {
-    if (!adxl355_data_available())
-    {
-        return false;
-    }
+    return adxl355_read_samples(sample, 1u) == 1u;
+}
 
-    *sample = adxl355_ring_buffer.buffer[adxl355_ring_buffer.read_index];
-    adxl355_ring_buffer.read_index =
-        (adxl355_ring_buffer.read_index + 1u) & (ADXL355_BUFFER_SIZE - 1u);
+uint32_t adxl355_read_samples(adxl355_raw_sample_t *buf, uint32_t max)
+{
+    if (raw_history_enabled()) {
+        return raw_history_read(buf, max);
+    }
+    return adxl355_ring_read(&adxl355_ring_buffer, buf, max);
+}
 
-    return true;
+uint32_t adxl355_peek_samples(const adxl355_raw_sample_t **span)
+{
+    if (raw_history_enabled()) {
+        return raw_history_peek(span);
+    }
+    return adxl355_ring_peek(&adxl355_ring_buffer, span);
 }
 
-uint32_t adxl355_samples_available(void)
+void adxl355_commit_samples(uint32_t count)
 {
-    uint32_t write = adxl355_ring_buffer.write_index;
-    uint32_t read = adxl355_ring_buffer.read_index;
+    if (raw_history_enabled()) {
+        raw_history_commit(count);
+        return;
+    }
+    adxl355_ring_commit(&adxl355_ring_buffer, count);
+}
 
-    if (write >= read)
-    {
-        return write - read;
+uint32_t adxl355_discard_samples(void)
+{
+    if (raw_history_enabled()) {
+        return raw_history_discard();
     }
-    else
-    {
-        return ADXL355_BUFFER_SIZE - read + write;
+    return adxl355_ring_discard(&adxl355_ring_buffer);
+}
+
+uint32_t adxl355_samples_available(void)
+{
+    uint32_t n = adxl355_ring_count(&adxl355_ring_buffer);
+    if (raw_history_enabled()) {
+        n += raw_history_unread();
     }
+    return n;
+}
+
+uint32_t adxl355_isr_ring_peek(const adxl355_raw_sample_t **span)
+{
+    return adxl355_ring_peek(&adxl355_ring_buffer, span);
+}
+
+void adxl355_isr_ring_commit(uint32_t count)
+{
+    adxl355_ring_commit(&adxl355_ring_buffer, count);
+}
+
+uint32_t adxl355_isr_ring_discard(void)
+{
+    return adxl355_ring_discard(&adxl355_ring_buffer);
 }
 
 bool scl3300_data_available(void)
 {
-    return (scl3300_ring_buffer.write_index != scl3300_ring_buffer.read_index);
+    return !scl3300_ring_empty(&scl3300_ring_buffer);
 }
 
 bool scl3300_read_sample(scl3300_raw_sample_t *sample)
 {
-    if (!scl3300_data_available())
-    {
-        return false;
-    }
+    return scl3300_ring_pop(&scl3300_ring_buffer, sample);
+}
 
-    *sample = scl3300_ring_buffer.buffer[scl3300_ring_buffer.read_index];
-    scl3300_ring_buffer.read_index =
-        (scl3300_ring_buffer.read_index + 1u) & (SCL3300_BUFFER_SIZE - 1u);
+uint32_t scl3300_read_samples(scl3300_raw_sample_t *buf, uint32_t max)
+{
+    return scl3300_ring_read(&scl3300_ring_buffer, buf, max);
+}
 
-    return true;
+uint32_t scl3300_discard_samples(void)
+{
+    return scl3300_ring_discard(&scl3300_ring_buffer);
 }
 
 uint32_t scl3300_samples_available(void)
 {
-    uint32_t write = scl3300_ring_buffer.write_index;
-    uint32_t read = scl3300_ring_buffer.read_index;
-
-    if (write >= read)
-    {
-        return write - read;
-    }
-    else
-    {
-        return SCL3300_BUFFER_SIZE - read + write;
-    }
+    return scl3300_ring_count(&scl3300_ring_buffer);
 }
 
 bool adt7420_data_available(void)
 {
-    return (adt7420_ring_buffer.write_index != adt7420_ring_buffer.read_index);
+    return !adt7420_ring_empty(&adt7420_ring_buffer);
 }
 
-bool adt7420_read_sample(adt7420_raw_sample_t *sample)
+bool adt7420_push_sample(uint32_t tick, uint16_t raw_temp)
 {
-    if (!adt7420_data_available())
-    {
+    adt7420_raw_sample_t *slot = adt7420_ring_claim(&adt7420_ring_buffer);
+    if (slot == NULL) {
         return false;
     }
-
-    *sample = adt7420_ring_buffer.buffer[adt7420_ring_buffer.read_index];
-    adt7420_ring_buffer.read_index =
-        (adt7420_ring_buffer.read_index + 1u) & (ADT7420_BUFFER_SIZE - 1u);
-
+    slot->tick     = tick;
+    slot->raw_temp = raw_temp;
+    adt7420_ring_publish(&adt7420_ring_buffer);
+    adt7420_sample_count++;
     return true;
 }
 
-uint32_t adt7420_samples_available(void)
+bool adt7420_read_sample(adt7420_raw_sample_t *sample)
 {
-    uint32_t write = adt7420_ring_buffer.write_index;
-    uint32_t read = adt7420_ring_buffer.read_index;
+    return adt7420_ring_pop(&adt7420_ring_buffer, sample);
+}
 
-    if (write >= read)
-    {
-        return write - read;
-    }
-    else
-    {
-        return ADT7420_BUFFER_SIZE - read + write;
-    }
+uint32_t adt7420_samples_available(void)
+{
+    return adt7420_ring_count(&adt7420_ring_buffer);
 }
 
 /******************************************************************************
@@ -678,12 +1857,12 @@ void sensor_acquisition_get_stats(uint32_t *samples_acquired,
         *samples_acquired = adxl355_sample_count + scl3300_sample_count + adt7420_sample_count;
     }
     if (samples_dropped) {
-        *samples_dropped = adxl355_ring_buffer.overflow_count +
-                           scl3300_ring_buffer.overflow_count +
-                           adt7420_ring_buffer.overflow_count;
+        *samples_dropped = adxl355_ring_buffer.overflow +
+                           scl3300_ring_buffer.overflow +
+                           adt7420_ring_buffer.overflow;
     }
     if (max_acquisition_time_us) {
-        *max_acquisition_time_us = 0;
+        *max_acquisition_time_us = s_isr_cycles_max / esp_rom_get_cpu_ticks_per_us();
     }
 }
 
@@ -693,11 +1872,34 @@ void sensor_acquisition_reset_stats(void)
     scl3300_sample_count = 0;
     adt7420_sample_count = 0;
 
-    adxl355_ring_buffer.overflow_count = 0;
-    scl3300_ring_buffer.overflow_count = 0;
-    adt7420_ring_buffer.overflow_count = 0;
+    adxl355_ring_buffer.overflow   = 0;
+    scl3300_ring_buffer.overflow   = 0;
+    adt7420_ring_buffer.overflow   = 0;
+    adxl355_ring_buffer.high_water = 0;
+    scl3300_ring_buffer.high_water = 0;
+    adt7420_ring_buffer.high_water = 0;
 
     tick_counter = 0;
+    s_slot_phase = 0;
+    s_tick_epoch_us = esp_timer_get_time();
+
+    s_isr_cycles_max      = 0;
+    s_isr_cycles_sum      = 0;
+    s_isr_count           = 0;
+    s_task_wake_us_max    = 0;
+    s_task_wake_us_sum    = 0;
+    s_task_wake_count     = 0;
+    s_task_service_us_max = 0;
+    s_task_slot_overruns  = 0;
+
+    /* Ticks restart from 0, so a pending probe is due straight away */
+    for (int dev = 0; dev < SENSOR_HEALTH_COUNT; dev++) {
+        s_health[dev].next_probe_tick = 0;
+        s_health[dev].downs   = 0;
+        s_health[dev].ups     = 0;
+        s_health[dev].probes  = 0;
+        s_health[dev].skipped = 0;
+    }
 
     /*
      * Do NOT reset s_scl_pipeline_primed or s_scl_discard_first_sample here.
@@ -722,29 +1924,92 @@ void scl3300_reset_isr_pipeline(void)
     s_scl_discard_first_sample = true;
 }
 
-void adxl355_isr_set_inhibit(bool inhibit)
+/**
+ * @brief Probe a down sensor on its next slot with the backoff restarted
+ *        (task context, while its ISR reads are still inhibited).
+ */
+static void health_rearm(sensor_health_dev_t dev)
 {
-    s_adxl355_isr_inhibit = inhibit;
+    s_health[dev].probe_ticks     = HEALTH_PROBE_MIN_TICKS;
+    s_health[dev].next_probe_tick = acquisition_tick_now();
 }
 
-void scl3300_isr_set_inhibit(bool inhibit)
+esp_err_t adxl355_isr_set_inhibit(bool inhibit)
 {
+    bool drdy_armed = (s_acq_mode == SENSOR_ACQ_MODE_DRDY) && s_timer_running;
+
+    if (inhibit) {
+        s_adxl355_isr_inhibit = true;
+        if (s_acq_mode == SENSOR_ACQ_MODE_TASK && acquisition_task_wait_idle() != ESP_OK) {
+            /* The caller must not touch the bus: reads resume as before */
+            s_adxl355_isr_inhibit = false;
+            return ESP_ERR_TIMEOUT;
+        }
+        /* A level-triggered INT1 would storm while reads are inhibited */
+        if (drdy_armed) {
+            gpio_intr_disable(ADXL355_INT1_IO);
+        }
+        return ESP_OK;
+    }
+
+    /* Reinit may leave stale FIFO entries; flush before resuming */
+    s_adxl_fifo_flush_pending = true;
+    health_rearm(SENSOR_HEALTH_ADXL355);
+
+    if (drdy_armed) {
+        /* Reinit restores the driver's default INT_MAP; re-route INT1 */
+        if (adxl355_configure_drdy_int() != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to re-route ADXL355 INT1 after reinit");
+        }
+        s_adxl355_isr_inhibit = false;
+        gpio_intr_enable(ADXL355_INT1_IO);
+        return ESP_OK;
+    }
+
+    s_adxl355_isr_inhibit = false;
+    return ESP_OK;
+}
+
+esp_err_t scl3300_isr_set_inhibit(bool inhibit)
+{
+    if (!inhibit) {
+        health_rearm(SENSOR_HEALTH_SCL3300);
+    }
     s_scl3300_isr_inhibit = inhibit;
+    if (inhibit && s_acq_mode == SENSOR_ACQ_MODE_TASK && acquisition_task_wait_idle() != ESP_OK) {
+        s_scl3300_isr_inhibit = false;
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
 }
 
 uint32_t adxl355_get_overflow_count(void)
 {
-    return adxl355_ring_buffer.overflow_count;
+    return adxl355_ring_buffer.overflow;
+}
+
+uint32_t adxl355_buffer_capacity_ms(void)
+{
+    uint64_t samples = adxl355_ring_capacity() + raw_history_capacity();
+    return (uint32_t)((samples * s_adxl_tick_divisor * 1000u) / BASE_TIMER_FREQ_HZ);
 }
 
 uint32_t scl3300_get_overflow_count(void)
 {
-    return scl3300_ring_buffer.overflow_count;
+    return scl3300_ring_buffer.overflow;
 }
 
 uint32_t adt7420_get_overflow_count(void)
 {
-    return adt7420_ring_buffer.overflow_count;
+    return adt7420_ring_buffer.overflow;
+}
+
+void sensor_acquisition_get_ring_high_water(uint32_t *adxl355, uint32_t *scl3300,
+                                            uint32_t *adt7420)
+{
+    if (adxl355) *adxl355 = adxl355_ring_buffer.high_water;
+    if (scl3300) *scl3300 = scl3300_ring_buffer.high_water;
+    if (adt7420) *adt7420 = adt7420_ring_buffer.high_water;
 }
 
 uint32_t adxl355_get_sample_count(void)
@@ -764,7 +2029,31 @@ uint32_t adt7420_get_sample_count(void)
 
 uint32_t get_tick_count(void)
 {
-    return tick_counter;
+    return acquisition_tick_now();
+}
+
+int64_t sensor_acquisition_get_start_us(void)
+{
+    return s_start_local_us;
+}
+
+esp_err_t sensor_acquisition_set_mode(sensor_acq_mode_t mode)
+{
+    if (mode != SENSOR_ACQ_MODE_TIMER && mode != SENSOR_ACQ_MODE_DRDY &&
+        mode != SENSOR_ACQ_MODE_TASK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_acq_initialized) {
+        ESP_LOGE(TAG, "Acquisition mode must be selected before sensor_acquisition_init()");
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_acq_mode = mode;
+    return ESP_OK;
+}
+
+sensor_acq_mode_t sensor_acquisition_get_mode(void)
+{
+    return s_acq_mode;
 }
 
 void scl3300_get_isr_diag(uint32_t *isr_fired,
@@ -780,4 +2069,84 @@ void scl3300_get_isr_diag(uint32_t *isr_fired,
     if (valid_count)   *valid_count   = s_scl_valid_count;
     if (invalid_count) *invalid_count = s_scl_invalid_count;
     if (overflow_dbg)  *overflow_dbg  = s_scl_overflow_dbg;
-}
\ No newline at end of file
+}
+
+uint32_t scl3300_get_crc_errors(void)
+{
+    return s_scl_crc_errors;
+}
+
+void adxl355_get_fifo_diag(uint32_t *bursts,
+                           uint32_t *resyncs,
+                           uint32_t *full_events)
+{
+    if (bursts)      *bursts      = s_adxl_fifo_bursts;
+    if (resyncs)     *resyncs     = s_adxl_fifo_resyncs;
+    if (full_events) *full_events = s_adxl_fifo_full_events;
+}
+
+void sensor_acquisition_get_timing(sensor_acq_timing_t *timing)
+{
+    if (timing == NULL) {
+        return;
+    }
+
+    uint32_t cyc_per_us = esp_rom_get_cpu_ticks_per_us();
+    uint32_t isr_count  = s_isr_count;
+    uint32_t wake_count = s_task_wake_count;
+
+    timing->isr_count          = isr_count;
+    timing->isr_max_us         = s_isr_cycles_max / cyc_per_us;
+    timing->isr_avg_ns         = isr_count ?
+        (uint32_t)((s_isr_cycles_sum * 1000u) / ((uint64_t)isr_count * cyc_per_us)) : 0;
+    timing->task_wake_max_us   = s_task_wake_us_max;
+    timing->task_wake_avg_us   = wake_count ? (uint32_t)(s_task_wake_us_sum / wake_count) : 0;
+    timing->task_service_max_us= s_task_service_us_max;
+    timing->task_slot_overruns = s_task_slot_overruns;
+}
+
+void sensor_health_subscribe(void)
+{
+    s_health_notify_task = xTaskGetCurrentTaskHandle();
+}
+
+void sensor_data_set_watermark(uint32_t samples)
+{
+    s_data_pending   = 0;
+    s_data_watermark = samples;
+}
+
+void sensor_data_set_external_source(bool external)
+{
+    s_data_pending  = 0;
+    s_data_external = external;
+}
+
+uint32_t sensor_data_get_wakeups(void)
+{
+    return s_data_wakeups;
+}
+
+bool sensor_health_is_down(sensor_health_dev_t dev)
+{
+    return (dev < SENSOR_HEALTH_COUNT) && s_health[dev].down;
+}
+
+void sensor_health_get_stats(sensor_health_dev_t dev, sensor_health_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (dev >= SENSOR_HEALTH_COUNT) {
+        return;
+    }
+    const sensor_health_t *h = &s_health[dev];
+    stats->down        = h->down;
+    stats->invalid_run = h->invalid_run;
+    stats->probe_ms    = h->down ? h->probe_ticks / (BASE_TIMER_FREQ_HZ / 1000) : 0;
+    stats->downs       = h->downs;
+    stats->ups         = h->ups;
+    stats->probes      = h->probes;
+    stats->skipped     = h->skipped;
+}
@@ -7,7 +7,7 @@
  * 1. SINGLE ISR driven by GPTimer at high frequency (8000 Hz)
  * 2. Staggered sensor sampling to prevent bus conflicts
  * 3. Raw data collection ONLY in ISR
- * 4. Lock-free ring buffers for each sensor
+ * 4. Lock-free SPSC ring buffers for each sensor (spsc_ring.h)
  * 5. Minimal ISR overhead
  * 6. Processing happens OUTSIDE the ISR in separate tasks
  *
@@ -19,6 +19,8 @@
  * 4. In your processing task:
  *    - Check if data available: adxl355_data_available()
  *    - Read raw sample: adxl355_read_sample(&raw_sample)
+ *    - Or in bulk: adxl355_read_samples(buf, max), or zero-copy with
+ *      adxl355_peek_samples(&span) + adxl355_commit_samples(n)
  *    - Convert to real units using sensor driver conversion functions
  *    - Package and send via MQTT/Ethernet
  */
@@ -34,6 +36,34 @@
 extern "C" {
 #endif
 
+/******************************************************************************
+ * ACQUISITION ENGINE SELECTION
+ *****************************************************************************/
+
+/**
+ * @brief How sensor reads are scheduled
+ *
+ * - TIMER: one GPTimer ISR at 8000 Hz services every sensor on a fixed slot
+ *          schedule (default).
+ * - DRDY:  the ADXL355 INT1 pin (spi_bus.h: ADXL355_INT1_IO) interrupts when
+ *          data is ready, or at a FIFO watermark when FIFO burst is enabled;
+ *          the GPTimer only fires at the SCL3300 rate. Sample timing follows
+ *          the ADXL355 clock and the thousands of empty 125 us ticks go away.
+ * - TASK:  the 8000 Hz ISR only stamps ticks and notifies an acquisition
+ *          task on the acquisition core, which performs all SPI via queued DMA
+ *          transactions. Keeps the ISR to a few microseconds.
+ */
+typedef enum {
+    SENSOR_ACQ_MODE_TIMER = 0,
+    SENSOR_ACQ_MODE_DRDY  = 1,
+    SENSOR_ACQ_MODE_TASK  = 2,
+} sensor_acq_mode_t;
+
+/** Engine used unless sensor_acquisition_set_mode() is called before init. */
+#ifndef SENSOR_ACQ_BOOT_MODE
+#define SENSOR_ACQ_BOOT_MODE    SENSOR_ACQ_MODE_TIMER
+#endif
+
 /******************************************************************************
  * RAW DATA STRUCTURES
  * 
@@ -92,6 +122,22 @@ typedef struct {
  */
 esp_err_t sensor_acquisition_init(bool temp_sensor_available);
 
+/**
+ * @brief Select the acquisition engine
+ *
+ * Must be called before sensor_acquisition_init(); the engine cannot change
+ * afterwards because the timer and GPIO interrupt are set up there.
+ *
+ * @return
+ *     - ESP_OK: Mode stored
+ *     - ESP_ERR_INVALID_ARG: Unknown mode
+ *     - ESP_ERR_INVALID_STATE: Acquisition already initialized
+ */
+esp_err_t sensor_acquisition_set_mode(sensor_acq_mode_t mode);
+
+/** @brief Get the selected acquisition engine */
+sensor_acq_mode_t sensor_acquisition_get_mode(void);
+
 /**
  * @brief Start sensor acquisition
  *
@@ -103,6 +149,19 @@ esp_err_t sensor_acquisition_init(bool temp_sensor_available);
  */
 esp_err_t sensor_acquisition_start(void);
 
+/**
+ * @brief Start sensor acquisition at a local esp_timer instant
+ *
+ * Does all preparation first, then busy-waits until @p local_us and starts
+ * the timer, so tick 0 is at local_us and tick 1 one period later. The wait
+ * runs in the caller; keep it short (see sync_start.h). local_us <= 0 or in
+ * the past starts immediately, which is what sensor_acquisition_start() does.
+ */
+esp_err_t sensor_acquisition_start_at(int64_t local_us);
+
+/** @brief esp_timer time (us) the acquisition timer was last started at. */
+int64_t sensor_acquisition_get_start_us(void);
+
 /**
  * @brief Stop sensor acquisition
  *
@@ -115,11 +174,40 @@ esp_err_t sensor_acquisition_start(void);
  */
 esp_err_t sensor_acquisition_stop(void);
 
+/**
+ * @brief Set the ADXL355 acquisition rate as a divisor of the 8000 Hz tick
+ *
+ * Pass node_runtime_config_t.isr_tick_divisor (2/4/8 for 4000/2000/1000 Hz)
+ * so the ISR delivers raw samples at the configured ODR. Must be a power of
+ * two >= 2. Only allowed while acquisition is stopped; any samples still in
+ * the ADXL355 ring buffer are discarded because they belong to the old rate.
+ *
+ * The slot schedule is rebuilt as a phase table over the LCM of all slot
+ * periods, capped at 3200 ticks, which limits FIFO-burst builds to 500 Hz
+ * and above.
+ *
+ * @return
+ *     - ESP_OK: Schedule updated
+ *     - ESP_ERR_INVALID_ARG: Divisor not a power of two in range, or the
+ *       resulting schedule does not fit the phase table
+ *     - ESP_ERR_INVALID_STATE: Acquisition is running
+ */
+esp_err_t sensor_acquisition_set_adxl355_divisor(uint32_t tick_divisor);
+
+/**
+ * @brief Get the active ADXL355 tick divisor (ticks between samples)
+ */
+uint32_t adxl355_get_tick_divisor(void);
+
 /******************************************************************************
  * ADXL355 RING BUFFER ACCESS
  * 
- * Sample rate: 1000 Hz
- * Buffer size: 4096 samples (~2 seconds)
+ * Sample rate: runtime (1000 Hz default, up to 4000 Hz)
+ * ISR ring:    CONFIG_SHM_ADXL355_RING_SAMPLES in internal RAM
+ *
+ * With the PSRAM history enabled (raw_history.h) these functions read the
+ * history, which a drain task fills from the ISR ring; otherwise they read
+ * the ISR ring directly. Either way the data task is the only caller.
  *****************************************************************************/
 
 /**
@@ -136,12 +224,56 @@ bool adxl355_data_available(void);
  */
 bool adxl355_read_sample(adxl355_raw_sample_t *sample);
 
+/**
+ * @brief Copy up to max samples out of the ADXL355 ring buffer
+ *
+ * The read index is updated once for the whole batch.
+ *
+ * @param[out] buf Destination array of at least max entries
+ * @param[in]  max Capacity of buf
+ * @return Number of samples copied (0 if empty)
+ */
+uint32_t adxl355_read_samples(adxl355_raw_sample_t *buf, uint32_t max);
+
+/**
+ * @brief Zero-copy view of the oldest contiguous run of ADXL355 samples
+ *
+ * The run stops at the end of the underlying array; after committing it, a
+ * second peek returns the wrapped remainder. The samples stay owned by the
+ * ring until adxl355_commit_samples() releases them, so the ISR will not
+ * overwrite them in the meantime.
+ *
+ * @param[out] span Set to the first unread sample
+ * @return Number of contiguous samples at *span (0 if empty)
+ */
+uint32_t adxl355_peek_samples(const adxl355_raw_sample_t **span);
+
+/**
+ * @brief Release samples obtained with adxl355_peek_samples()
+ * @param[in] count Samples consumed (clamped to what is available)
+ */
+void adxl355_commit_samples(uint32_t count);
+
+/**
+ * @brief Drop every unread ADXL355 sample with a single index jump
+ * @return Number of samples discarded
+ */
+uint32_t adxl355_discard_samples(void);
+
 /**
  * @brief Get number of samples currently in ADXL355 ring buffer
  * @return Number of unread samples
  */
 uint32_t adxl355_samples_available(void);
 
+/**
+ * @brief Consumer side of the ISR ring itself, for the raw_history.c drain
+ *        task only (it replaces the data task as that ring's consumer).
+ */
+uint32_t adxl355_isr_ring_peek(const adxl355_raw_sample_t **span);
+void     adxl355_isr_ring_commit(uint32_t count);
+uint32_t adxl355_isr_ring_discard(void);
+
 /**
  * @brief Get ADXL355 buffer overflow count
  * 
@@ -152,6 +284,15 @@ uint32_t adxl355_samples_available(void);
  */
 uint32_t adxl355_get_overflow_count(void);
 
+/**
+ * @brief Ring buffer headroom in milliseconds at the active ADXL355 rate
+ *
+ * The buffer size is fixed, so the time the processing task may stall before
+ * overflowing shrinks as the ODR goes up. Includes the PSRAM history when
+ * it is enabled.
+ */
+uint32_t adxl355_buffer_capacity_ms(void);
+
 /**
  * @brief Get total number of ADXL355 samples acquired since start
  * @return Total sample count
@@ -179,6 +320,18 @@ bool scl3300_data_available(void);
  */
 bool scl3300_read_sample(scl3300_raw_sample_t *sample);
 
+/**
+ * @brief Copy up to max samples out of the SCL3300 ring buffer
+ * @return Number of samples copied (0 if empty)
+ */
+uint32_t scl3300_read_samples(scl3300_raw_sample_t *buf, uint32_t max);
+
+/**
+ * @brief Drop every unread SCL3300 sample with a single index jump
+ * @return Number of samples discarded
+ */
+uint32_t scl3300_discard_samples(void);
+
 /**
  * @brief Get number of samples currently in SCL3300 ring buffer
  * @return Number of unread samples
@@ -202,8 +355,20 @@ uint32_t scl3300_get_sample_count(void);
  * 
  * Sample rate: 1 Hz
  * Buffer size: 16 samples (16 seconds)
+ *
+ * Produced by the slow-sensors task (slow_sensors.h), not the ISR: an I2C
+ * read can block for its full timeout and must never sit in the SPI path.
  *****************************************************************************/
 
+/**
+ * @brief Push one ADT7420 sample (slow-sensors task only, single producer)
+ *
+ * @param tick     Acquisition tick the read was started on
+ * @param raw_temp Raw 13-bit temperature code
+ * @return false if the ring was full and the sample was dropped
+ */
+bool adt7420_push_sample(uint32_t tick, uint16_t raw_temp);
+
 /**
  * @brief Check if ADT7420 data is available in ring buffer
  * @return true if at least one sample is available
@@ -236,6 +401,16 @@ uint32_t adt7420_get_overflow_count(void);
  */
 uint32_t adt7420_get_sample_count(void);
 
+/**
+ * @brief Highest fill level each ring buffer has reached since the last
+ *        sensor_acquisition_reset_stats(). Any pointer may be NULL.
+ *
+ * A high-water mark close to the buffer size means the consumer is
+ * falling behind even if nothing has overflowed yet.
+ */
+void sensor_acquisition_get_ring_high_water(uint32_t *adxl355, uint32_t *scl3300,
+                                            uint32_t *adt7420);
+
 /******************************************************************************
  * STATISTICS AND DIAGNOSTICS
  *****************************************************************************/
@@ -251,6 +426,27 @@ void sensor_acquisition_get_stats(uint32_t *samples_acquired,
                                    uint32_t *samples_dropped,
                                    uint32_t *max_acquisition_time_us);
 
+/**
+ * @brief ISR and acquisition-task timing (jitter indicators)
+ */
+typedef struct {
+    uint32_t isr_count;           /**< ISR invocations measured               */
+    uint32_t isr_max_us;          /**< Longest ISR execution                   */
+    uint32_t isr_avg_ns;          /**< Mean ISR execution                      */
+    uint32_t task_wake_max_us;    /**< TASK mode: worst ISR -> task latency    */
+    uint32_t task_wake_avg_us;    /**< TASK mode: mean ISR -> task latency     */
+    uint32_t task_service_max_us; /**< TASK mode: longest SPI service pass     */
+    uint32_t task_slot_overruns;  /**< TASK mode: slots that fired while the
+                                       previous one was still pending          */
+} sensor_acq_timing_t;
+
+/**
+ * @brief Get ISR / acquisition-task timing since the last stats reset
+ *
+ * @param[out] timing Filled with timing statistics
+ */
+void sensor_acquisition_get_timing(sensor_acq_timing_t *timing);
+
 /**
  * @brief Reset acquisition statistics
  * 
@@ -274,8 +470,12 @@ void scl3300_reset_isr_pipeline(void);
  * Set to true before reinitialising the ADXL355 from task context so the
  * ISR does not issue SPI transactions that would collide with the init
  * sequence. Set back to false after reinit completes.
+ *
+ * @return ESP_ERR_TIMEOUT if, in TASK mode, a read already in flight did
+ *         not finish in time; reads stay enabled and the caller must not
+ *         reinit. Always ESP_OK for inhibit = false.
  */
-void adxl355_isr_set_inhibit(bool inhibit);
+esp_err_t adxl355_isr_set_inhibit(bool inhibit);
 
 /**
  * @brief Inhibit/allow SCL3300 reads in the ISR.
@@ -283,12 +483,105 @@ void adxl355_isr_set_inhibit(bool inhibit);
  * Set to true before reinitialising the SCL3300 from task context so the
  * ISR does not issue SPI transactions that would collide with the init
  * sequence. Set back to false after reinit completes.
+ *
+ * @return as adxl355_isr_set_inhibit()
+ */
+esp_err_t scl3300_isr_set_inhibit(bool inhibit);
+
+/******************************************************************************
+ * SENSOR HEALTH
+ *
+ * An unplugged SPI sensor answers every read with a floating MISO line
+ * (all-0xFF / all-0x00 frames, FIFO_ENTRIES reading back empty). Rather than
+ * issuing a full transaction for it on every slot, the acquisition engine
+ * counts consecutive invalid reads per sensor. After the sensor's limit it
+ * marks the sensor down and stops servicing its slots, except for one probe
+ * read after a backoff that starts at SENSOR_HEALTH_PROBE_MIN_MS and doubles
+ * after every unanswered probe up to SENSOR_HEALTH_PROBE_MAX_MS. The first
+ * valid read marks the sensor up and restores every slot.
+ *
+ * Releasing a reinit inhibit (sensor_recovery.c) re-arms the probe at once,
+ * so a sensor brought back by a reinit resumes without waiting out the
+ * backoff.
+ *
+ * Each down / up transition sets SENSOR_HEALTH_NOTIFY_BIT(dev) in the
+ * notification value of the task that called sensor_health_subscribe().
+ *****************************************************************************/
+
+#define ADXL355_HEALTH_INVALID_LIMIT    32u     /**< Bad reads (polls in FIFO mode) before down */
+#define SCL3300_HEALTH_INVALID_LIMIT    6u      /**< Bad reads before down (300 ms at 20 Hz)    */
+#define SENSOR_HEALTH_PROBE_MIN_MS      20u     /**< First probe interval once down             */
+#define SENSOR_HEALTH_PROBE_MAX_MS      1000u   /**< Backoff ceiling                            */
+
+typedef enum {
+    SENSOR_HEALTH_ADXL355 = 0,
+    SENSOR_HEALTH_SCL3300 = 1,
+    SENSOR_HEALTH_COUNT
+} sensor_health_dev_t;
+
+#define SENSOR_HEALTH_NOTIFY_BIT(dev)   (1u << (dev))
+#define SENSOR_HEALTH_NOTIFY_ALL        ((1u << SENSOR_HEALTH_COUNT) - 1u)
+
+typedef struct {
+    bool     down;          /**< Slots disabled, probing                    */
+    uint32_t invalid_run;   /**< Consecutive invalid reads                  */
+    uint32_t probe_ms;      /**< Current probe interval (while down)        */
+    uint32_t downs;         /**< Up -> down transitions since the last reset */
+    uint32_t ups;           /**< Down -> up transitions                     */
+    uint32_t probes;        /**< Probe reads issued while down              */
+    uint32_t skipped;       /**< Slots skipped while down                   */
+} sensor_health_stats_t;
+
+/**
+ * @brief Send health transitions to the calling task.
+ *
+ * Bits are set with eSetBits on notification index 0, from the ISR or the
+ * TASK-mode acquisition task. Only one task can subscribe; the last caller
+ * wins.
+ */
+void sensor_health_subscribe(void);
+
+/** @brief True while the sensor's slots are disabled. */
+bool sensor_health_is_down(sensor_health_dev_t dev);
+
+void sensor_health_get_stats(sensor_health_dev_t dev, sensor_health_stats_t *stats);
+
+/******************************************************************************
+ * DATA READY
+ *
+ * The subscriber (sensor_health_subscribe()) also gets SENSOR_DATA_NOTIFY_BIT
+ * once every watermark ADXL355 samples have reached the buffer it reads, so
+ * it can block on its notification value instead of polling the rings.
+ * The producer is the ADXL355 service path (ISR, INT1 handler or TASK-mode
+ * acquisition task), or the raw-history drain task once that is the tier
+ * the data task consumes (raw_history.h).
+ *****************************************************************************/
+
+#define SENSOR_DATA_NOTIFY_BIT          (1u << 8)
+
+/** @brief Samples per wakeup; 0 (default) sends none. */
+void sensor_data_set_watermark(uint32_t samples);
+
+/**
+ * @brief Hand the data-ready count to another producer.
+ *
+ * With external set the service path stops counting and the other tier
+ * reports its own arrivals through sensor_data_note_ready().
  */
-void scl3300_isr_set_inhibit(bool inhibit);
+void sensor_data_set_external_source(bool external);
+
+/** @brief Count n samples made available; notifies at the watermark. ISR-safe. */
+void sensor_data_note_ready(uint32_t n);
+
+/** @brief Data-ready notifications sent since boot. */
+uint32_t sensor_data_get_wakeups(void);
 
 /**
  * @brief Get current timer tick count
  * 
+ * In DRDY mode there is no 8 kHz alarm; the count is derived from esp_timer
+ * with the same 125 us resolution.
+ *
  * @return Current tick count (increments at 8000 Hz)
  */
 uint32_t get_tick_count(void);
@@ -313,6 +606,23 @@ void scl3300_get_isr_diag(uint32_t *isr_fired,
                            uint32_t *invalid_count,
                            uint32_t *overflow_dbg);
 
+/** @brief SCL3300 frames rejected for a bad CRC (invalid_count includes them). */
+uint32_t scl3300_get_crc_errors(void);
+
+/**
+ * @brief Get ADXL355 FIFO burst diagnostics
+ *
+ * Only meaningful when the FIFO burst drain is compiled in
+ * (ADXL355_USE_FIFO_BURST in sensor_task.c); otherwise all counters stay 0.
+ *
+ * @param[out] bursts      FIFO drains that delivered at least one sample
+ * @param[out] resyncs     Drains that had to skip to the next X marker
+ * @param[out] full_events Drains that found the FIFO full (samples may be lost)
+ */
+void adxl355_get_fifo_diag(uint32_t *bursts,
+                           uint32_t *resyncs,
+                           uint32_t *full_events);
+
 /******************************************************************************
  * CONVERSION HELPER MACROS
  * 
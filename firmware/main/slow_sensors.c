@@ -0,0 +1,118 @@
+/**
+ * @file slow_sensors.c
+ * @brief Low-priority I2C sensor polling (see slow_sensors.h).
+ *
+ * The counters and the online flag are written only by the slow-sensors
+ * task; other tasks read them without locking.
+ */
+
+#include "slow_sensors.h"
+#include "mem_budget.h"
+#include "sensor_task.h"
+#include "adt7420.h"
+#include "fault_log.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+static const char *TAG = "SLOW_SENS";
+
+MEM_BUDGET_STATIC_TASK(s_task_mem, SLOW_SENSORS_TASK_STACK_SIZE);
+
+static TaskHandle_t s_task = NULL;
+
+static volatile bool     s_adt7420_online      = true;
+static volatile uint32_t s_adt7420_reads       = 0;
+static volatile uint32_t s_adt7420_read_errors = 0;
+static volatile uint32_t s_adt7420_ring_full   = 0;
+
+/******************************************************************************
+ * ADT7420
+ *****************************************************************************/
+
+static void poll_adt7420(void)
+{
+    /* Stamp the start of the read: that is when the result register was sampled */
+    uint32_t tick = get_tick_count();
+    uint16_t raw  = 0;
+
+    esp_err_t err = adt7420_read_raw(&raw);
+    if (err != ESP_OK) {
+        s_adt7420_read_errors++;
+        ESP_LOGW(TAG, "ADT7420 read failed: %s (#%lu)",
+                 esp_err_to_name(err), (unsigned long)s_adt7420_read_errors);
+        if (s_adt7420_online) {
+            /* Log fault once on first failure, then stay quiet until recovery */
+            fault_log_record(FAULT_ADT7420_DROPPED);
+            fault_log_record(FAULT_I2C_ERROR);
+            s_adt7420_online = false;
+        }
+        return;
+    }
+
+    if (!s_adt7420_online) {
+        ESP_LOGI(TAG, "ADT7420 reconnected");
+        fault_log_record(FAULT_ADT7420_RECONNECTED);
+        s_adt7420_online = true;
+    }
+
+    s_adt7420_reads++;
+    if (!adt7420_push_sample(tick, raw)) {
+        s_adt7420_ring_full++;
+    }
+}
+
+/******************************************************************************
+ * TASK
+ *****************************************************************************/
+
+static void slow_sensors_task(void *arg)
+{
+    (void)arg;
+
+    TickType_t last_wake = xTaskGetTickCount();
+    for (;;) {
+        poll_adt7420();
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(SLOW_SENSORS_PERIOD_MS));
+    }
+}
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+esp_err_t slow_sensors_init(void)
+{
+    if (s_task != NULL) {
+        return ESP_OK;
+    }
+
+    s_task = mem_budget_task_create("slow_sensors", &s_task_mem, slow_sensors_task,
+                                     "slow_sens", NULL, SLOW_SENSORS_TASK_PRIORITY,
+                                     SLOW_SENSORS_TASK_CORE);
+    if (s_task == NULL) {
+        ESP_LOGE(TAG, "Failed to create slow-sensors task");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Slow sensors every %d ms (priority=%d, core=%d)",
+             SLOW_SENSORS_PERIOD_MS, SLOW_SENSORS_TASK_PRIORITY, SLOW_SENSORS_TASK_CORE);
+    return ESP_OK;
+}
+
+bool slow_sensors_adt7420_online(void)
+{
+    return s_adt7420_online;
+}
+
+void slow_sensors_get_stats(slow_sensors_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    stats->adt7420_reads       = s_adt7420_reads;
+    stats->adt7420_read_errors = s_adt7420_read_errors;
+    stats->adt7420_ring_full   = s_adt7420_ring_full;
+    stats->adt7420_online      = s_adt7420_online;
+}
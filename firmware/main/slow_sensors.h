@@ -0,0 +1,68 @@
+/**
+ * @file slow_sensors.h
+ * @brief Low-priority task that owns the slow I2C sensors (ADT7420).
+ *
+ * The ADT7420 used to be read synchronously from the data-processing loop,
+ * so an unplugged sensor blocked the same loop that drains the ADXL355 ring
+ * for the full I2C timeout every second. This task does the read instead and
+ * deposits {tick, raw} samples into the ADT7420 ring (sensor_task.h); the
+ * data task only ever pops the ring, which never blocks.
+ *
+ * Disconnect / reconnect faults (FAULT_ADT7420_DROPPED + FAULT_I2C_ERROR,
+ * FAULT_ADT7420_RECONNECTED) are raised here, once per transition.
+ *
+ * Future slow sensors are polled from the same task.
+ */
+
+#ifndef SLOW_SENSORS_H
+#define SLOW_SENSORS_H
+
+#include "esp_err.h"
+#include "cpu_topology.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * CONFIGURATION
+ *****************************************************************************/
+
+#define SLOW_SENSORS_PERIOD_MS          1000    /**< ADT7420 at 1 Hz */
+
+#define SLOW_SENSORS_TASK_STACK_SIZE    3072
+#define SLOW_SENSORS_TASK_PRIORITY      1
+#define SLOW_SENSORS_TASK_CORE          SHM_CORE_NET
+
+typedef struct {
+    uint32_t adt7420_reads;         /**< Successful reads (pushed or dropped) */
+    uint32_t adt7420_read_errors;   /**< Failed reads since boot            */
+    uint32_t adt7420_ring_full;     /**< Reads dropped on a full ring       */
+    bool     adt7420_online;        /**< Last read succeeded                */
+} slow_sensors_stats_t;
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * @brief Start the slow-sensors task.
+ *
+ * Call after sensor_acquisition_init() (the ADT7420 ring must exist). If
+ * the ADT7420 was absent at boot every read fails fast with
+ * ESP_ERR_INVALID_STATE and temperature stays NaN, as before.
+ */
+esp_err_t slow_sensors_init(void);
+
+/** @brief False from the first failed ADT7420 read until the next good one. */
+bool slow_sensors_adt7420_online(void);
+
+void slow_sensors_get_stats(slow_sensors_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SLOW_SENSORS_H
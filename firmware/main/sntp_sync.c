@@ -5,13 +5,17 @@
  * Uses ESP-IDF's built-in SNTP client (lwIP SNTP, no extra component needed).
  * On successful sync the system clock is set via settimeofday() by the SNTP
  * stack internally, making gettimeofday() return correct UTC time throughout
- * the firmware — including in format_ts() in data_processing_and_mqtt_task.c.
+ * the firmware — including in the per-packet anchors of packet_time.c.
  *
  * Sync mode is SMOOTH (slew-only, never step) so the clock advances
  * monotonically and tick-to-wall back-calculations remain valid across syncs.
+ *
+ * Every sync event is also fed to clock_discipline.c, whose fitted model is
+ * what sample timestamps actually use.
  */
 
 #include "sntp_sync.h"
+#include "clock_discipline.h"
 #include "esp_log.h"
 #include "esp_sntp.h"
 #include <sys/time.h>
@@ -27,6 +31,8 @@ static const char *TAG = "SNTP";
 
 static void sntp_sync_cb(struct timeval *tv)
 {
+    clock_discipline_on_sync((int64_t)tv->tv_sec * 1000000LL + (int64_t)tv->tv_usec);
+
     struct tm tm_info;
     gmtime_r(&tv->tv_sec, &tm_info);
     ESP_LOGI(TAG, "SNTP sync complete: %04d-%02d-%02dT%02d:%02d:%02dZ",
@@ -47,7 +53,7 @@ esp_err_t sntp_sync_init(void)
 
     /* SMOOTH mode slews the clock gradually — never steps it.
      * This keeps gettimeofday() monotonic so tick back-calculations
-     * in format_ts() are never invalidated by a sudden time jump. */
+     * in packet_time.c are never invalidated by a sudden time jump. */
     sntp_set_sync_mode(SNTP_SYNC_MODE_SMOOTH);
 
     /* Re-sync every SNTP_SYNC_POLL_INTERVAL_MS milliseconds. */
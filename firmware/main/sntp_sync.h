@@ -7,8 +7,8 @@
  *   1. Call sntp_sync_init() once, after ethernet is up and mDNS is ready
  *      (i.e. after mqtt_mdns_init() has been called).
  *   2. Call sntp_sync_is_valid() to check whether the first sync has occurred.
- *      format_ts() in data_processing_and_mqtt_task.c uses gettimeofday()
- *      directly and falls back to tick-relative strings until this returns true.
+ *      ts_anchor_capture() in packet_time.c uses gettimeofday() directly and
+ *      falls back to tick-relative strings until this returns true.
  */
 
 #ifndef SNTP_SYNC_H
@@ -0,0 +1,429 @@
+/**
+ * @file spectrum.c
+ * @brief Welch PSD, band energies, peaks and RMS over the decimated accel stream.
+ *
+ * See spectrum.h for the output format. The data task is the only producer
+ * of s_ring and this module's task the only consumer. Resets requested by
+ * other tasks are latched in s_reset_req and carried out by the consumer,
+ * which is the only side allowed to discard ring contents.
+ */
+
+#include "spectrum.h"
+#include "mem_budget.h"
+#include "spsc_ring.h"
+#include "mqtt.h"
+#include "flow_control.h"
+#include "packet_time.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "SPECTRUM";
+
+MEM_BUDGET_STATIC_TASK(s_task_mem, SPECTRUM_TASK_STACK_SIZE);
+
+#define SPEC_HOP            (SPECTRUM_FFT_LEN / 2)     /* 50 % overlap */
+#define SPEC_BINS           (SPECTRUM_FFT_LEN / 2 + 1) /* one-sided     */
+#define SPEC_LOG2_N         9
+#define SPEC_POLL_MS        100
+#define SPEC_JSON_BUF_SIZE  1024
+#define SPEC_TOPIC_BUF_SIZE 80
+
+_Static_assert((1 << SPEC_LOG2_N) == SPECTRUM_FFT_LEN, "SPEC_LOG2_N must match SPECTRUM_FFT_LEN");
+
+typedef struct {
+    float v[3];
+} spectrum_sample_t;
+
+/* 2.56 s of headroom at 200 Hz */
+SPSC_RING_DEFINE(spectrum_ring, spectrum_sample_t, 512)
+
+static spectrum_ring_t s_ring;
+
+static volatile spectrum_mode_t s_mode      = SPECTRUM_MODE_OFF;
+static volatile bool            s_reset_req = false;
+static TaskHandle_t             s_task_handle = NULL;
+
+/* The summary flow level (flow_control.h) turns the summary on even when
+ * the configured mode is off; the store level keeps it off the network. */
+static bool spectrum_running(void)
+{
+    return s_mode != SPECTRUM_MODE_OFF || flow_control_get_level() == FLOW_LEVEL_SUMMARY;
+}
+
+/* Band edges in Hz: SPECTRUM_NUM_BANDS bands between consecutive entries */
+static const float s_band_hz[SPECTRUM_NUM_BANDS + 1] = {
+    0.2f, 1.0f, 2.0f, 5.0f, 10.0f, 20.0f, 50.0f, 100.0f
+};
+
+/* Tables */
+static float s_window[SPECTRUM_FFT_LEN];
+static float s_cos[SPECTRUM_FFT_LEN / 2];
+static float s_sin[SPECTRUM_FFT_LEN / 2];
+static float s_window_power;                    /* sum(w^2) */
+
+/* Consumer state */
+static float    s_hist[3][SPECTRUM_FFT_LEN];    /* current window, oldest first */
+static int      s_fill = 0;
+static float    s_psd_acc[3][SPEC_BINS];
+static uint32_t s_psd_count = 0;
+static double   s_sum[3];
+static double   s_sumsq[3];
+static uint32_t s_rms_count = 0;
+
+/* FFT scratch */
+static float s_re[SPECTRUM_FFT_LEN];
+static float s_im[SPECTRUM_FFT_LEN];
+
+static char s_json_buf[SPEC_JSON_BUF_SIZE];
+
+/******************************************************************************
+ * FFT
+ *****************************************************************************/
+
+static void build_tables(void)
+{
+    s_window_power = 0.0f;
+    for (int i = 0; i < SPECTRUM_FFT_LEN; i++) {
+        /* Periodic Hann */
+        s_window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * (float)i / (float)SPECTRUM_FFT_LEN);
+        s_window_power += s_window[i] * s_window[i];
+    }
+    for (int i = 0; i < SPECTRUM_FFT_LEN / 2; i++) {
+        float a = -2.0f * (float)M_PI * (float)i / (float)SPECTRUM_FFT_LEN;
+        s_cos[i] = cosf(a);
+        s_sin[i] = sinf(a);
+    }
+}
+
+/** In-place iterative radix-2 DIT FFT of s_re / s_im. */
+static void fft_radix2(float *re, float *im)
+{
+    /* Bit-reversal permutation */
+    for (uint32_t i = 0, j = 0; i < SPECTRUM_FFT_LEN; i++) {
+        if (i < j) {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+        uint32_t bit = SPECTRUM_FFT_LEN >> 1;
+        while (j & bit) {
+            j ^= bit;
+            bit >>= 1;
+        }
+        j |= bit;
+    }
+
+    for (uint32_t len = 2; len <= SPECTRUM_FFT_LEN; len <<= 1) {
+        uint32_t half   = len >> 1;
+        uint32_t stride = SPECTRUM_FFT_LEN / len;
+        for (uint32_t base = 0; base < SPECTRUM_FFT_LEN; base += len) {
+            for (uint32_t k = 0; k < half; k++) {
+                float wr = s_cos[k * stride];
+                float wi = s_sin[k * stride];
+                uint32_t a = base + k;
+                uint32_t b = a + half;
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+/******************************************************************************
+ * ACCUMULATION
+ *****************************************************************************/
+
+static void clear_state(void)
+{
+    s_fill      = 0;
+    s_psd_count = 0;
+    s_rms_count = 0;
+    memset(s_psd_acc, 0, sizeof(s_psd_acc));
+    memset(s_sum,     0, sizeof(s_sum));
+    memset(s_sumsq,   0, sizeof(s_sumsq));
+}
+
+/** Window the full history, FFT each axis and add |X|^2 to the Welch sum. */
+static void process_window(void)
+{
+    for (int axis = 0; axis < 3; axis++) {
+        const float *x = s_hist[axis];
+
+        float mean = 0.0f;
+        for (int i = 0; i < SPECTRUM_FFT_LEN; i++) {
+            mean += x[i];
+        }
+        mean /= (float)SPECTRUM_FFT_LEN;
+
+        for (int i = 0; i < SPECTRUM_FFT_LEN; i++) {
+            s_re[i] = (x[i] - mean) * s_window[i];
+            s_im[i] = 0.0f;
+        }
+        fft_radix2(s_re, s_im);
+
+        for (int k = 0; k < SPEC_BINS; k++) {
+            s_psd_acc[axis][k] += s_re[k] * s_re[k] + s_im[k] * s_im[k];
+        }
+    }
+    s_psd_count++;
+
+    /* Slide by one hop */
+    for (int axis = 0; axis < 3; axis++) {
+        memmove(s_hist[axis], s_hist[axis] + SPEC_HOP, SPEC_HOP * sizeof(float));
+    }
+    s_fill = SPEC_HOP;
+}
+
+static void consume_sample(const spectrum_sample_t *s)
+{
+    for (int axis = 0; axis < 3; axis++) {
+        s_hist[axis][s_fill] = s->v[axis];
+        s_sum[axis]   += s->v[axis];
+        s_sumsq[axis] += (double)s->v[axis] * s->v[axis];
+    }
+    s_rms_count++;
+    if (++s_fill == SPECTRUM_FFT_LEN) {
+        process_window();
+    }
+}
+
+/******************************************************************************
+ * SUMMARY
+ *****************************************************************************/
+
+/** One-sided PSD of bin k in g^2/Hz, averaged over the Welch segments. */
+static inline float psd_bin(int axis, int k)
+{
+    float scale = 1.0f / ((float)s_psd_count * (float)SPECTRUM_FS_HZ * s_window_power);
+    float p = s_psd_acc[axis][k] * scale;
+    return (k == 0 || k == SPEC_BINS - 1) ? p : 2.0f * p;
+}
+
+static int append_axis(char *buf, int size, int off, int axis, const char *name)
+{
+    const float df = (float)SPECTRUM_FS_HZ / (float)SPECTRUM_FFT_LEN;
+
+    double mean = s_sum[axis] / s_rms_count;
+    double var  = s_sumsq[axis] / s_rms_count - mean * mean;
+    float  rms  = (float)sqrt(var > 0.0 ? var : 0.0);
+
+    off += snprintf(buf + off, size - off, ",\"%s\":{\"rms\":%.6f,\"band\":[", name, rms);
+
+    for (int b = 0; b < SPECTRUM_NUM_BANDS; b++) {
+        int k0 = (int)ceilf(s_band_hz[b] / df);
+        int k1 = (int)ceilf(s_band_hz[b + 1] / df);
+        if (k1 > SPEC_BINS) {
+            k1 = SPEC_BINS;
+        }
+        float e = 0.0f;
+        for (int k = k0; k < k1; k++) {
+            e += psd_bin(axis, k) * df;
+        }
+        off += snprintf(buf + off, size - off, "%s%.3e", b ? "," : "", e);
+    }
+
+    /* Strongest local maxima above the lowest band edge */
+    int   peak_k[SPECTRUM_NUM_PEAKS];
+    float peak_p[SPECTRUM_NUM_PEAKS];
+    for (int i = 0; i < SPECTRUM_NUM_PEAKS; i++) {
+        peak_k[i] = -1;
+        peak_p[i] = 0.0f;
+    }
+    int k_min = (int)ceilf(s_band_hz[0] / df);
+    if (k_min < 1) {
+        k_min = 1;
+    }
+    for (int k = k_min; k < SPEC_BINS - 1; k++) {
+        float p = psd_bin(axis, k);
+        if (p <= psd_bin(axis, k - 1) || p < psd_bin(axis, k + 1)) {
+            continue;
+        }
+        for (int i = 0; i < SPECTRUM_NUM_PEAKS; i++) {
+            if (peak_k[i] < 0 || p > peak_p[i]) {
+                for (int j = SPECTRUM_NUM_PEAKS - 1; j > i; j--) {
+                    peak_k[j] = peak_k[j - 1];
+                    peak_p[j] = peak_p[j - 1];
+                }
+                peak_k[i] = k;
+                peak_p[i] = p;
+                break;
+            }
+        }
+    }
+
+    off += snprintf(buf + off, size - off, "],\"peaks\":[");
+    for (int i = 0; i < SPECTRUM_NUM_PEAKS && peak_k[i] >= 0; i++) {
+        int   k = peak_k[i];
+        float a = psd_bin(axis, k - 1), b = peak_p[i], c = psd_bin(axis, k + 1);
+        float den   = a - 2.0f * b + c;
+        float delta = (den != 0.0f) ? 0.5f * (a - c) / den : 0.0f;
+        off += snprintf(buf + off, size - off, "%s[%.3f,%.3e]",
+                        i ? "," : "", ((float)k + delta) * df, b);
+    }
+    off += snprintf(buf + off, size - off, "]}");
+    return off;
+}
+
+static void publish_summary(void)
+{
+    char ts[TS_ISO_MIN_LEN];
+    ts_anchor_t     anchor;
+    ts_iso_cursor_t cursor;
+    ts_anchor_capture(&anchor);
+    ts_iso_cursor_init(&cursor);
+    ts_format_tick(&anchor, &cursor, anchor.tick, ts);
+
+    int off = snprintf(s_json_buf, sizeof(s_json_buf),
+                       "{\"ts\":\"%s\",\"fs\":%d,\"nfft\":%d,\"avg\":%lu,\"df\":%.6f,\"band_hz\":[",
+                       ts, SPECTRUM_FS_HZ, SPECTRUM_FFT_LEN, (unsigned long)s_psd_count,
+                       (double)SPECTRUM_FS_HZ / SPECTRUM_FFT_LEN);
+    for (int b = 0; b <= SPECTRUM_NUM_BANDS; b++) {
+        off += snprintf(s_json_buf + off, sizeof(s_json_buf) - off, "%s%g",
+                        b ? "," : "", (double)s_band_hz[b]);
+    }
+    off += snprintf(s_json_buf + off, sizeof(s_json_buf) - off, "]");
+    off = append_axis(s_json_buf, sizeof(s_json_buf), off, 0, "x");
+    off = append_axis(s_json_buf, sizeof(s_json_buf), off, 1, "y");
+    off = append_axis(s_json_buf, sizeof(s_json_buf), off, 2, "z");
+    off += snprintf(s_json_buf + off, sizeof(s_json_buf) - off, "}");
+
+    if (off >= (int)sizeof(s_json_buf)) {
+        ESP_LOGE(TAG, "Summary truncated (%d bytes)", off);
+        return;
+    }
+
+    char topic[SPEC_TOPIC_BUF_SIZE];
+    snprintf(topic, sizeof(topic), "%s/%s/%s",
+             MQTT_TOPIC_PREFIX, mqtt_get_serial_no(), SPECTRUM_TOPIC_SUFFIX);
+    esp_err_t err = mqtt_publish(topic, s_json_buf, off);
+    ESP_LOGD(TAG, "Spectrum (%d segments, %d bytes): %s",
+             (int)s_psd_count, off, esp_err_to_name(err));
+}
+
+/******************************************************************************
+ * TASK
+ *****************************************************************************/
+
+static void spectrum_task(void *pvParameters)
+{
+    (void)pvParameters;
+    uint32_t last_publish_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    spectrum_sample_t chunk[32];
+
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(SPEC_POLL_MS));
+        uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+        if (s_reset_req || !spectrum_running()) {
+            s_reset_req = false;
+            spectrum_ring_discard(&s_ring);
+            clear_state();
+            last_publish_ms = now_ms;
+            continue;
+        }
+
+        uint32_t n;
+        while ((n = spectrum_ring_read(&s_ring, chunk, 32)) > 0) {
+            for (uint32_t i = 0; i < n; i++) {
+                consume_sample(&chunk[i]);
+            }
+        }
+
+        if ((now_ms - last_publish_ms) >= SPECTRUM_PUBLISH_INTERVAL_MS) {
+            last_publish_ms = now_ms;
+            if (s_psd_count > 0 && mqtt_is_connected() &&
+                flow_control_get_level() != FLOW_LEVEL_STORE) {
+                publish_summary();
+            }
+            /* Next interval starts fresh; the sliding window carries over */
+            s_psd_count = 0;
+            s_rms_count = 0;
+            memset(s_psd_acc, 0, sizeof(s_psd_acc));
+            memset(s_sum,     0, sizeof(s_sum));
+            memset(s_sumsq,   0, sizeof(s_sumsq));
+        }
+    }
+}
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+esp_err_t spectrum_init(void)
+{
+    if (s_task_handle != NULL) {
+        /* Task survives data task restarts; just start a fresh window */
+        s_reset_req = true;
+        return ESP_OK;
+    }
+
+    build_tables();
+    spectrum_ring_init(&s_ring, SPSC_DROP_NEWEST);
+    clear_state();
+
+    s_task_handle = mem_budget_task_create("spectrum", &s_task_mem, spectrum_task,
+                                            "spectrum", NULL, SPECTRUM_TASK_PRIORITY,
+                                            SPECTRUM_TASK_CORE);
+    if (s_task_handle == NULL) {
+        ESP_LOGE(TAG, "Failed to create task");
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Spectrum stage ready (nfft=%d, interval=%lu ms, mode=%s)",
+             SPECTRUM_FFT_LEN, (unsigned long)SPECTRUM_PUBLISH_INTERVAL_MS,
+             spectrum_mode_str(s_mode));
+    return ESP_OK;
+}
+
+void spectrum_set_mode(spectrum_mode_t mode)
+{
+    if (mode != s_mode) {
+        ESP_LOGI(TAG, "Spectrum mode -> %s", spectrum_mode_str(mode));
+        s_mode      = mode;
+        s_reset_req = true;
+    }
+}
+
+spectrum_mode_t spectrum_get_mode(void)
+{
+    return s_mode;
+}
+
+const char *spectrum_mode_str(spectrum_mode_t mode)
+{
+    switch (mode) {
+        case SPECTRUM_MODE_ON:   return "on";
+        case SPECTRUM_MODE_ONLY: return "only";
+        default:                 return "off";
+    }
+}
+
+void spectrum_feed(const int32_t raw[3], float lsb_per_g)
+{
+    if (!spectrum_running() || s_task_handle == NULL) {
+        return;
+    }
+    spectrum_sample_t *slot = spectrum_ring_claim(&s_ring);
+    if (slot == NULL) {
+        /* Consumer fell behind: the window would span a gap */
+        s_reset_req = true;
+        return;
+    }
+    float inv = 1.0f / lsb_per_g;
+    slot->v[0] = (float)raw[0] * inv;
+    slot->v[1] = (float)raw[1] * inv;
+    slot->v[2] = (float)raw[2] * inv;
+    spectrum_ring_publish(&s_ring);
+}
+
+void spectrum_reset(void)
+{
+    s_reset_req = true;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file spectrum.h
+ * @brief Optional on-node spectral summary of the decimated 200 Hz accel stream.
+ *
+ * The data task pushes every decimated accel sample (in g) into a lock-free
+ * ring; a low-priority task on the acquisition core runs Hann-windowed
+ * 512-point FFTs with 50 % overlap (Welch averaging) and publishes one
+ * summary per SPECTRUM_PUBLISH_INTERVAL_MS on wind_turbine/<SERIAL>/spectrum:
+ *
+ *   {"ts":"2025-01-15T12:34:56.000000Z","fs":200,"nfft":512,"avg":14,
+ *    "df":0.390625,"band_hz":[0.2,1,2,5,10,20,50,100],
+ *    "x":{"rms":0.012345,"band":[e0,...,e6],"peaks":[[f,psd],[f,psd],[f,psd]]},
+ *    "y":{...},"z":{...}}
+ *
+ *   rms    AC RMS over the interval (g, mean removed)
+ *   band   energy per band (g^2), the integral of the one-sided PSD
+ *   peaks  strongest local PSD maxima above band_hz[0], frequency refined by
+ *          parabolic interpolation (Hz, g^2/Hz)
+ *
+ * Modes (configure command "spectrum":"off"|"on"|"only"):
+ *   OFF   no spectral processing (default, zero cost for the data task)
+ *   ON    spectrum published alongside the normal data topic
+ *   ONLY  summary-only: the data topic is suppressed for low-bandwidth sites
+ *
+ * The summary flow level (flow_control.h) runs the spectrum as if ON while
+ * the link is congested; the store level holds summaries back.
+ *
+ * The FFT is a small in-place radix-2 routine rather than esp-dsp: at
+ * 3 x 512 points every 1.28 s the cost is well under 1 % of one core, which
+ * does not justify a new managed component.
+ */
+
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include "esp_err.h"
+#include "cpu_topology.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * CONFIGURATION
+ *****************************************************************************/
+
+#define SPECTRUM_FS_HZ                  200     /**< Decimated output rate */
+#define SPECTRUM_FFT_LEN                512     /**< 2.56 s window, 0.39 Hz bins */
+#define SPECTRUM_PUBLISH_INTERVAL_MS    10000u
+#define SPECTRUM_NUM_BANDS              7
+#define SPECTRUM_NUM_PEAKS              3
+
+#define SPECTRUM_TOPIC_SUFFIX           "spectrum"
+
+#define SPECTRUM_TASK_STACK_SIZE        4096
+#define SPECTRUM_TASK_PRIORITY          2
+#define SPECTRUM_TASK_CORE              SHM_CORE_ACQ
+
+typedef enum {
+    SPECTRUM_MODE_OFF  = 0,
+    SPECTRUM_MODE_ON   = 1,
+    SPECTRUM_MODE_ONLY = 2,
+} spectrum_mode_t;
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/** @brief Build the window / twiddle tables and start the spectrum task. */
+esp_err_t spectrum_init(void);
+
+/** @brief Select the mode. Switching clears any partial accumulation. */
+void spectrum_set_mode(spectrum_mode_t mode);
+
+spectrum_mode_t spectrum_get_mode(void);
+
+/** @brief "off" / "on" / "only" for status messages. */
+const char *spectrum_mode_str(spectrum_mode_t mode);
+
+/**
+ * @brief Push one decimated accel sample (data task only).
+ *
+ * Returns immediately when the mode is OFF. A full ring drops the sample and
+ * restarts the current window so no FFT ever spans a discontinuity.
+ */
+void spectrum_feed(const int32_t raw[3], float lsb_per_g);
+
+/**
+ * @brief Discard the current window and interval (stream gap, reconfigure, idle).
+ */
+void spectrum_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SPECTRUM_H
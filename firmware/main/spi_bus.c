@@ -4,7 +4,10 @@
  */
 
 #include "spi_bus.h"
+#include "cpu_topology.h"
 #include "esp_log.h"
+#include "esp_idf_version.h"
+#include "esp_attr.h"
 #include "driver/gpio.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -12,6 +15,26 @@
 static const char *TAG = "SPI_BUS";
 static bool spi_bus_initialized = false;
 
+/* Task / ISR arbitration (spi_bus.h). s_isr_access only changes at init. */
+static portMUX_TYPE  s_bus_mux    = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool s_isr_access = false;
+
+/* Clock profiles (spi_bus.h) */
+static const spi_clock_profile_t s_profiles[SPI_BUS_DEV_COUNT] = {
+    [SPI_BUS_DEV_ADXL355] = { "ADXL355", 1000000,  1000000, 10000000 },
+    [SPI_BUS_DEV_SCL3300] = { "SCL3300", 2000000,  1000000,  4000000 },
+};
+
+static const uint32_t s_clock_steps_hz[] = {
+    1000000, 2000000, 4000000, 5000000, 8000000, 10000000,
+};
+#define CLOCK_STEP_COUNT (sizeof(s_clock_steps_hz) / sizeof(s_clock_steps_hz[0]))
+
+static volatile uint32_t s_clock_hz[SPI_BUS_DEV_COUNT] = {
+    [SPI_BUS_DEV_ADXL355] = 1000000,
+    [SPI_BUS_DEV_SCL3300] = 2000000,
+};
+
 static void spi_force_all_cs_high(void)
 {
     gpio_config_t io = {
@@ -46,6 +69,10 @@ esp_err_t spi_bus_init(void)
         .quadwp_io_num = -1,
         .quadhd_io_num = -1,
         .max_transfer_sz = SPI_MAX_TRANSFER_BYTES,
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0)
+        /* Transaction-done interrupt next to the acquisition task */
+        .isr_cpu_id = (esp_intr_cpu_affinity_t)(ESP_INTR_CPU_AFFINITY_0 + SHM_CORE_ACQ),
+#endif
     };
 
     esp_err_t ret = spi_bus_initialize(SPI_BUS_HOST, &bus_config, SPI_DMA_CH_AUTO);
@@ -64,4 +91,140 @@ esp_err_t spi_bus_init(void)
 spi_host_device_t spi_bus_get_host(void)
 {
     return SPI_BUS_HOST;
-}
\ No newline at end of file
+}
+void spi_bus_set_isr_access(bool isr_access)
+{
+    s_isr_access = isr_access;
+}
+
+void spi_bus_lock(void)
+{
+    if (s_isr_access) {
+        portENTER_CRITICAL(&s_bus_mux);
+    }
+}
+
+void spi_bus_unlock(void)
+{
+    if (s_isr_access) {
+        portEXIT_CRITICAL(&s_bus_mux);
+    }
+}
+
+void IRAM_ATTR spi_bus_lock_from_isr(void)
+{
+    portENTER_CRITICAL_ISR(&s_bus_mux);
+}
+
+void IRAM_ATTR spi_bus_unlock_from_isr(void)
+{
+    portEXIT_CRITICAL_ISR(&s_bus_mux);
+}
+
+/*** CLOCK PROFILES ***/
+
+const spi_clock_profile_t *spi_bus_clock_profile(spi_bus_dev_t dev)
+{
+    return &s_profiles[dev];
+}
+
+uint32_t spi_bus_get_clock_hz(spi_bus_dev_t dev)
+{
+    return s_clock_hz[dev];
+}
+
+static esp_err_t clock_apply(spi_bus_dev_t dev, spi_clock_apply_fn apply, uint32_t hz)
+{
+    if (hz == s_clock_hz[dev]) {
+        return ESP_OK;
+    }
+    esp_err_t err = apply(hz);
+    if (err == ESP_OK) {
+        s_clock_hz[dev] = hz;
+    } else {
+        ESP_LOGE(TAG, "%s: switching to %lu Hz failed: %s", s_profiles[dev].name,
+                 (unsigned long)hz, esp_err_to_name(err));
+    }
+    return err;
+}
+
+static bool clock_probe_clean(spi_clock_probe_fn probe)
+{
+    for (int i = 0; i < SPI_CLOCK_TUNE_READS; i++) {
+        if (!probe()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Largest step below hz within the profile, 0 when there is none */
+static uint32_t clock_step_below(const spi_clock_profile_t *p, uint32_t hz)
+{
+    uint32_t below = 0;
+    for (size_t i = 0; i < CLOCK_STEP_COUNT; i++) {
+        uint32_t step = s_clock_steps_hz[i];
+        if (step >= hz) {
+            break;
+        }
+        if (step >= p->min_hz) {
+            below = step;
+        }
+    }
+    return below;
+}
+
+uint32_t spi_bus_tune_clock(spi_bus_dev_t dev, spi_clock_apply_fn apply,
+                            spi_clock_probe_fn probe)
+{
+    const spi_clock_profile_t *p = &s_profiles[dev];
+    uint32_t clean_hz = 0;
+
+    for (size_t i = 0; i < CLOCK_STEP_COUNT; i++) {
+        uint32_t hz = s_clock_steps_hz[i];
+        if (hz < p->min_hz) {
+            continue;
+        }
+        if (hz > p->max_hz || clock_apply(dev, apply, hz) != ESP_OK) {
+            break;
+        }
+        if (!clock_probe_clean(probe)) {
+            ESP_LOGW(TAG, "%s: probe failed at %lu Hz", p->name, (unsigned long)hz);
+            break;
+        }
+        clean_hz = hz;
+    }
+
+    uint32_t hz = p->min_hz;
+    if (clean_hz == 0) {
+        ESP_LOGW(TAG, "%s: no clean rate, staying at %lu Hz", p->name, (unsigned long)hz);
+    } else if (clean_hz < p->max_hz && clock_step_below(p, clean_hz) != 0) {
+        hz = clock_step_below(p, clean_hz);
+    } else {
+        hz = clean_hz;
+    }
+
+    if (clock_apply(dev, apply, hz) != ESP_OK) {
+        /* Back at whatever rate the last successful switch left */
+        hz = s_clock_hz[dev];
+    }
+    ESP_LOGI(TAG, "%s: SPI clock %lu Hz (fastest clean %lu Hz)", p->name,
+             (unsigned long)hz, (unsigned long)clean_hz);
+    return hz;
+}
+
+bool spi_bus_clock_fallback(spi_bus_dev_t dev, spi_clock_apply_fn apply)
+{
+    const spi_clock_profile_t *p = &s_profiles[dev];
+    uint32_t from = s_clock_hz[dev];
+    uint32_t hz = clock_step_below(p, from);
+    if (hz == 0) {
+        return false;
+    }
+    if (clock_apply(dev, apply, hz) != ESP_OK) {
+        return false;
+    }
+    ESP_LOGW(TAG, "%s: SPI clock stepped down %lu -> %lu Hz", p->name,
+             (unsigned long)from, (unsigned long)hz);
+    return true;
+}
@@ -8,6 +8,8 @@
 
 #include "esp_err.h"
 #include "driver/spi_master.h"
+#include <stdbool.h>
+#include <stdint.h>
 
 // ============== SPI Host Selection ==============
 // SPI2_HOST is HSPI on ESP32. Keep consistent across project.
@@ -20,13 +22,32 @@
 #define SPI_SCLK_IO             14      // Clock
 #define SPI_CS_ADXL355_IO       5       // Chip Select for accelerometer
 #define SPI_CS_SCL3300_IO       4       // Chip Select for inclinometer
+#define ADXL355_INT1_IO         33      // ADXL355 INT1 (DRDY acquisition mode only)
 
-// ============== SPI Clock Speed ==============
-// ADXL355 supports up to ~10 MHz. 8 MHz is a robust default.
-#define SPI_CLOCK_SPEED_HZ      (1*1000*1000)  // 1 MHz
+// ============== SPI Clock Profiles ==============
+// Each sensor has its own clock on the shared bus (per-device
+// clock_speed_hz), bounded by a profile: added at boot_hz, tuned by
+// spi_bus_tune_clock() within [min_hz, max_hz] (ADXL355 datasheet: 10 MHz,
+// SCL3300: 4 MHz). Rates are 80 MHz / n so the divider hits them exactly.
+typedef enum {
+    SPI_BUS_DEV_ADXL355 = 0,
+    SPI_BUS_DEV_SCL3300,
+    SPI_BUS_DEV_COUNT
+} spi_bus_dev_t;
 
-// Keep transfers small + deterministic (ADXL355 accel read = 1 cmd + 9 bytes = 10 bytes)
-#define SPI_MAX_TRANSFER_BYTES  32
+typedef struct {
+    const char *name;
+    uint32_t    boot_hz;    // rate the driver adds the device at
+    uint32_t    min_hz;     // never tuned or stepped below
+    uint32_t    max_hz;     // datasheet limit
+} spi_clock_profile_t;
+
+// Known-answer reads per step while tuning; every one must come back clean
+#define SPI_CLOCK_TUNE_READS    64
+
+// Largest transfer is the ADXL355 FIFO burst: 1 cmd + 16 samples x 9 bytes = 145 bytes
+// (single XDATA read = 1 cmd + 9 bytes = 10 bytes)
+#define SPI_MAX_TRANSFER_BYTES  160
 
 /**
  * @brief Initialize the SPI bus (shared by ADXL355 and SCL3300).
@@ -40,4 +61,65 @@ esp_err_t spi_bus_init(void);
  */
 spi_host_device_t spi_bus_get_host(void);
 
+// ============== Task / ISR Arbitration ==============
+// The ISR acquisition engines (sensor_task.h) poll the bus from interrupt
+// context, where the driver's own bus lock cannot be waited on. Every
+// task-context register access (adxl355.c, scl3300.c) therefore holds
+// spi_bus_lock() for exactly one transaction, chip select included: a
+// spinlock shared with the ISR, so either side waits at most one
+// transaction (~1.2 ms for a full ADXL355 FIFO burst at 1 MHz, a tenth of
+// that at 10 MHz; ~80 us for a register read). In TASK mode the acquisition task uses the driver queue,
+// which the driver arbitrates against other tasks, and the lock is a no-op.
+
+/**
+ * @brief Select whether interrupt handlers access the bus directly.
+ *
+ * Called once by sensor_acquisition_init() for the chosen engine, before
+ * any acquisition ISR runs.
+ */
+void spi_bus_set_isr_access(bool isr_access);
+
+/** @brief Take the bus for one task-context transaction (see above). */
+void spi_bus_lock(void);
+void spi_bus_unlock(void);
+
+/** @brief ISR side of the same lock. Nestable on one core. */
+void spi_bus_lock_from_isr(void);
+void spi_bus_unlock_from_isr(void);
+
+// ============== Clock Tuning ==============
+// After a sensor's init (before acquisition starts), spi_bus_tune_clock()
+// steps its clock up from min_hz, running SPI_CLOCK_TUNE_READS known-answer
+// reads (ID registers, CRC-checked frames) at each rate until one fails or
+// max_hz is reached. The device settles one step below the fastest clean
+// rate, for margin over temperature and cable; a device clean up to max_hz
+// runs at max_hz. At run time sensor_recovery.c watches the link error
+// counters and calls spi_bus_clock_fallback() to step a device down.
+
+/** @brief Re-add the device at hz; the driver's set-clock function. */
+typedef esp_err_t (*spi_clock_apply_fn)(uint32_t hz);
+
+/** @brief One known-answer read: true when it came back correct. */
+typedef bool (*spi_clock_probe_fn)(void);
+
+const spi_clock_profile_t *spi_bus_clock_profile(spi_bus_dev_t dev);
+
+/** @brief The device's current clock (boot_hz until tuned). */
+uint32_t spi_bus_get_clock_hz(spi_bus_dev_t dev);
+
+/**
+ * @brief Tune the device's clock as above. Acquisition must not be reading
+ * the device. Returns the chosen rate; if even min_hz fails the probe the
+ * device is left at min_hz.
+ */
+uint32_t spi_bus_tune_clock(spi_bus_dev_t dev, spi_clock_apply_fn apply,
+                            spi_clock_probe_fn probe);
+
+/**
+ * @brief Step the device one rate down, not below min_hz. The caller keeps
+ * acquisition off the device across the call. Returns false when it was
+ * already at min_hz or re-adding it failed.
+ */
+bool spi_bus_clock_fallback(spi_bus_dev_t dev, spi_clock_apply_fn apply);
+
 #endif // SPI_BUS_H
\ No newline at end of file
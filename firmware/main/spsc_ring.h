@@ -0,0 +1,233 @@
+/**
+ * @file spsc_ring.h
+ * @brief Macro-generated lock-free single-producer / single-consumer ring.
+ *
+ * SPSC_RING_DEFINE(name, type, size) generates a ring type `name_t` and a set
+ * of always-inline functions `name_*()` for one element type. Intended use is
+ * an ISR (or a dedicated acquisition task) as the only producer and one task
+ * as the only consumer, possibly on the other core.
+ *
+ * Design
+ * ======
+ * - size must be a power of two; indices are free-running uint32 counters
+ *   masked on access, so all size slots are usable and count = head - tail.
+ * - head is written only by the producer, tail only by the consumer (except
+ *   under SPSC_OVERWRITE_OLDEST, see below). They live on separate cache lines
+ *   together with the fields their owner writes, so the two cores never
+ *   contend on one line.
+ * - Memory ordering: the producer fills a slot, then publishes head with a
+ *   release store; the consumer loads head with acquire before reading slots.
+ *   Symmetrically the consumer releases tail after it is done with slots and
+ *   the producer acquires tail before reusing them. volatile alone gives no
+ *   such guarantee between cores.
+ * - Every function is always_inline so ISR callers stay in IRAM.
+ *
+ * Overflow policies
+ * =================
+ * - SPSC_DROP_NEWEST: a full ring rejects the new element (claim returns
+ *   NULL) and counts it in overflow. The consumer owns every unread element,
+ *   so zero-copy peek/commit is safe.
+ * - SPSC_OVERWRITE_OLDEST: a full ring advances tail itself (compare-exchange)
+ *   and counts the lost element in overflow. Consumers must then use pop /
+ *   read, which copy first and validate with compare-exchange; peek spans may
+ *   be overwritten underneath the reader.
+ *
+ * Usage
+ * =====
+ *   SPSC_RING_DEFINE(accel_ring, accel_sample_t, 1024)
+ *   static accel_ring_t s_ring;
+ *   accel_ring_init(&s_ring, SPSC_DROP_NEWEST);
+ *
+ *   // producer
+ *   accel_sample_t *slot = accel_ring_claim(&s_ring);
+ *   if (slot) { fill(slot); accel_ring_publish(&s_ring); }
+ *
+ *   // consumer
+ *   n = accel_ring_read(&s_ring, buf, max);
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Alignment used to keep producer and consumer fields on separate lines. */
+#define SPSC_RING_CACHE_LINE    64
+
+typedef enum {
+    SPSC_DROP_NEWEST      = 0,   /**< Full ring rejects the new element   */
+    SPSC_OVERWRITE_OLDEST = 1,   /**< Full ring discards the oldest element */
+} spsc_policy_t;
+
+#define SPSC_INLINE  static inline __attribute__((always_inline))
+
+#define SPSC_RING_DEFINE(name, type, size)                                          \
+    _Static_assert(((size) & ((size) - 1u)) == 0u && (size) > 0u,                   \
+                   #name ": size must be a power of two");                          \
+                                                                                    \
+    typedef struct {                                                                \
+        /* Producer line */                                                         \
+        _Alignas(SPSC_RING_CACHE_LINE) _Atomic uint32_t head;                       \
+        uint32_t overflow;        /**< elements dropped or overwritten */           \
+        uint32_t high_water;      /**< max fill level observed         */           \
+        spsc_policy_t policy;                                                       \
+        /* Consumer line */                                                         \
+        _Alignas(SPSC_RING_CACHE_LINE) _Atomic uint32_t tail;                       \
+        /* Storage */                                                               \
+        _Alignas(SPSC_RING_CACHE_LINE) type buf[(size)];                            \
+    } name##_t;                                                                     \
+                                                                                    \
+    SPSC_INLINE void name##_init(name##_t *r, spsc_policy_t policy)                 \
+    {                                                                               \
+        atomic_store_explicit(&r->head, 0u, memory_order_relaxed);                  \
+        atomic_store_explicit(&r->tail, 0u, memory_order_relaxed);                  \
+        r->overflow   = 0u;                                                         \
+        r->high_water = 0u;                                                         \
+        r->policy     = policy;                                                     \
+        atomic_thread_fence(memory_order_release);                                  \
+    }                                                                               \
+                                                                                    \
+    SPSC_INLINE uint32_t name##_capacity(void)                                      \
+    {                                                                               \
+        return (size);                                                              \
+    }                                                                               \
+                                                                                    \
+    /* ---- Producer side ---- */                                                  \
+                                                                                    \
+    /** Slot for the next element, or NULL if full under SPSC_DROP_NEWEST. */      \
+    SPSC_INLINE type *name##_claim(name##_t *r)                                     \
+    {                                                                               \
+        uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);       \
+        uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);       \
+        if ((head - tail) >= (size)) {                                              \
+            r->overflow++;                                                          \
+            if (r->policy == SPSC_DROP_NEWEST) {                                    \
+                return NULL;                                                        \
+            }                                                                       \
+            /* Evict the oldest; losing the race means the consumer freed it */     \
+            atomic_compare_exchange_strong_explicit(&r->tail, &tail, tail + 1u,     \
+                                                    memory_order_acq_rel,           \
+                                                    memory_order_acquire);          \
+        }                                                                           \
+        return &r->buf[head & ((size) - 1u)];                                       \
+    }                                                                               \
+                                                                                    \
+    /** Make the claimed slot visible to the consumer. */                          \
+    SPSC_INLINE void name##_publish(name##_t *r)                                    \
+    {                                                                               \
+        uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed) + 1u;  \
+        uint32_t fill = head - atomic_load_explicit(&r->tail, memory_order_relaxed);\
+        if (fill > r->high_water) {                                                 \
+            r->high_water = fill;                                                   \
+        }                                                                           \
+        atomic_store_explicit(&r->head, head, memory_order_release);                \
+    }                                                                               \
+                                                                                    \
+    /** Copying push. Returns false if the element was dropped. */                 \
+    SPSC_INLINE bool name##_push(name##_t *r, const type *item)                     \
+    {                                                                               \
+        type *slot = name##_claim(r);                                               \
+        if (slot == NULL) {                                                         \
+            return false;                                                           \
+        }                                                                           \
+        *slot = *item;                                                              \
+        name##_publish(r);                                                          \
+        return true;                                                                \
+    }                                                                               \
+                                                                                    \
+    /* ---- Consumer side ---- */                                                  \
+                                                                                    \
+    SPSC_INLINE uint32_t name##_count(name##_t *r)                                  \
+    {                                                                               \
+        uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);       \
+        uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);       \
+        return head - tail;                                                         \
+    }                                                                               \
+                                                                                    \
+    SPSC_INLINE bool name##_empty(name##_t *r)                                      \
+    {                                                                               \
+        return name##_count(r) == 0u;                                               \
+    }                                                                               \
+                                                                                    \
+    /** Copy up to max elements out; tail moves once for the batch. */             \
+    SPSC_INLINE uint32_t name##_read(name##_t *r, type *out, uint32_t max)          \
+    {                                                                               \
+        for (;;) {                                                                  \
+            uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);   \
+            uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);   \
+            uint32_t n    = head - tail;                                            \
+            if (n > max) {                                                          \
+                n = max;                                                            \
+            }                                                                       \
+            if (n == 0u) {                                                          \
+                return 0u;                                                          \
+            }                                                                       \
+            uint32_t idx   = tail & ((size) - 1u);                                  \
+            uint32_t first = (size) - idx;                                          \
+            if (first > n) {                                                        \
+                first = n;                                                          \
+            }                                                                       \
+            memcpy(out, &r->buf[idx], first * sizeof(type));                        \
+            memcpy(out + first, &r->buf[0], (n - first) * sizeof(type));            \
+            if (r->policy == SPSC_DROP_NEWEST) {                                    \
+                atomic_store_explicit(&r->tail, tail + n, memory_order_release);    \
+                return n;                                                           \
+            }                                                                       \
+            /* Producer may have evicted what we copied: retry if tail moved */     \
+            if (atomic_compare_exchange_strong_explicit(&r->tail, &tail, tail + n,  \
+                                                        memory_order_acq_rel,       \
+                                                        memory_order_acquire)) {    \
+                return n;                                                           \
+            }                                                                       \
+        }                                                                           \
+    }                                                                               \
+                                                                                    \
+    SPSC_INLINE bool name##_pop(name##_t *r, type *out)                             \
+    {                                                                               \
+        return name##_read(r, out, 1u) == 1u;                                       \
+    }                                                                               \
+                                                                                    \
+    /** Zero-copy view of the oldest contiguous run (SPSC_DROP_NEWEST only). */    \
+    SPSC_INLINE uint32_t name##_peek(name##_t *r, const type **span)                \
+    {                                                                               \
+        uint32_t tail  = atomic_load_explicit(&r->tail, memory_order_relaxed);      \
+        uint32_t head  = atomic_load_explicit(&r->head, memory_order_acquire);      \
+        uint32_t idx   = tail & ((size) - 1u);                                      \
+        uint32_t n     = head - tail;                                               \
+        uint32_t first = (size) - idx;                                              \
+        *span = &r->buf[idx];                                                       \
+        return (n < first) ? n : first;                                             \
+    }                                                                               \
+                                                                                    \
+    /** Release count elements (clamped to what is available). */                 \
+    SPSC_INLINE void name##_commit(name##_t *r, uint32_t count)                     \
+    {                                                                               \
+        uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);       \
+        uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);       \
+        if (count > head - tail) {                                                  \
+            count = head - tail;                                                    \
+        }                                                                           \
+        atomic_store_explicit(&r->tail, tail + count, memory_order_release);        \
+    }                                                                               \
+                                                                                    \
+    /** Drop every unread element in one jump; returns how many. */                \
+    SPSC_INLINE uint32_t name##_discard(name##_t *r)                                \
+    {                                                                               \
+        uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);       \
+        uint32_t tail = atomic_exchange_explicit(&r->tail, head,                    \
+                                                 memory_order_acq_rel);             \
+        return head - tail;                                                         \
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPSC_RING_H */
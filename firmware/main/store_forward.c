@@ -0,0 +1,294 @@
+/**
+ * @file store_forward.c
+ * @brief Flash-backed store-and-forward log for sensor packets.
+ *
+ * See store_forward.h for the record layout. All flash access happens on the
+ * publish stage task; the only cross-task entry point is
+ * store_forward_on_connected(), which just records a timestamp.
+ */
+
+#include "store_forward.h"
+#include "mqtt.h"
+#include "fault_log.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include <string.h>
+
+static const char *TAG = "STORE_FWD";
+
+#define SF_CONSUMED_PENDING   0xFFFFFFFFu
+#define SF_CONSUMED_DONE      0x00000000u
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t log_seq;
+    uint16_t len;
+    uint16_t reserved;
+    uint32_t crc32;
+    uint32_t consumed;
+} sf_record_header_t;
+
+_Static_assert(sizeof(sf_record_header_t) == SF_RECORD_HEADER_LEN,
+               "sf_record_header_t must match SF_RECORD_HEADER_LEN");
+
+static const esp_partition_t *s_part = NULL;
+static uint32_t s_slots    = 0;      /* records the partition holds */
+static uint32_t s_head     = 0;      /* next slot to write          */
+static uint32_t s_tail     = 0;      /* oldest pending slot         */
+static uint32_t s_next_seq = 1;
+
+static volatile uint32_t s_pending     = 0;
+static volatile uint32_t s_stored      = 0;
+static volatile uint32_t s_replayed    = 0;
+static volatile uint32_t s_overwritten = 0;
+static volatile uint32_t s_errors      = 0;
+
+static bool              s_full_reported  = false;   /* one FULL fault per outage */
+static volatile uint32_t s_connected_ms   = 0;
+static uint32_t          s_last_replay_ms = 0;
+
+/* One sector of scratch, shared by write and replay (both on the publish task) */
+static uint8_t s_slot_buf[SF_SLOT_SIZE];
+
+static inline uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static inline size_t slot_offset(uint32_t slot)
+{
+    return (size_t)slot * SF_SLOT_SIZE;
+}
+
+static bool read_header(uint32_t slot, sf_record_header_t *hdr)
+{
+    if (esp_partition_read(s_part, slot_offset(slot), hdr, sizeof(*hdr)) != ESP_OK) {
+        return false;
+    }
+    return hdr->magic == SF_RECORD_MAGIC && hdr->len > 0 && hdr->len <= SF_MAX_FRAME_LEN;
+}
+
+/******************************************************************************
+ * INIT / RECOVERY
+ *****************************************************************************/
+
+esp_err_t store_forward_init(void)
+{
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                      SF_PARTITION_SUBTYPE, SF_PARTITION_LABEL);
+    if (s_part == NULL) {
+        ESP_LOGW(TAG, "No '%s' partition — offline packets will be dropped",
+                 SF_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    s_slots = s_part->size / SF_SLOT_SIZE;
+    if (s_slots < 2) {
+        ESP_LOGE(TAG, "Partition '%s' too small (%lu bytes)",
+                 SF_PARTITION_LABEL, (unsigned long)s_part->size);
+        s_part = NULL;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    /* Newest record = highest log_seq among valid headers */
+    sf_record_header_t hdr;
+    bool     found    = false;
+    uint32_t max_seq  = 0;
+    uint32_t max_slot = 0;
+    for (uint32_t i = 0; i < s_slots; i++) {
+        if (read_header(i, &hdr) && (!found || hdr.log_seq > max_seq)) {
+            found    = true;
+            max_seq  = hdr.log_seq;
+            max_slot = i;
+        }
+    }
+
+    s_pending = 0;
+    if (!found) {
+        s_head     = 0;
+        s_tail     = 0;
+        s_next_seq = 1;
+    } else {
+        s_head     = (max_slot + 1) % s_slots;
+        s_next_seq = max_seq + 1;
+
+        /* Pending records are the unconsumed run ending at the newest one */
+        uint32_t slot   = max_slot;
+        uint32_t expect = max_seq;
+        while (s_pending < s_slots &&
+               read_header(slot, &hdr) &&
+               hdr.log_seq == expect &&
+               hdr.consumed == SF_CONSUMED_PENDING) {
+            s_pending++;
+            slot = (slot + s_slots - 1) % s_slots;
+            expect--;
+        }
+        s_tail = (s_head + s_slots - s_pending) % s_slots;
+    }
+
+    ESP_LOGI(TAG, "Log '%s': %lu slots, %lu pending from before boot",
+             SF_PARTITION_LABEL, (unsigned long)s_slots, (unsigned long)s_pending);
+    return ESP_OK;
+}
+
+bool store_forward_enabled(void)
+{
+    return s_part != NULL;
+}
+
+/******************************************************************************
+ * WRITE
+ *****************************************************************************/
+
+esp_err_t store_forward_write(uint8_t *frame, size_t len)
+{
+    if (s_part == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (frame == NULL || len == 0 || len > SF_MAX_FRAME_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    frame[2] |= MQTT_BIN_FLAG_REPLAYED;
+
+    if (s_pending == s_slots) {
+        /* Full: the slot about to be erased is the oldest pending record */
+        s_tail = (s_tail + 1) % s_slots;
+        s_pending--;
+        s_overwritten++;
+        if (!s_full_reported) {
+            ESP_LOGW(TAG, "Log full — overwriting oldest stored packets");
+            fault_log_record(FAULT_STORE_FORWARD_FULL);
+            s_full_reported = true;
+        }
+    }
+
+    uint32_t slot = s_head;
+    esp_err_t err = esp_partition_erase_range(s_part, slot_offset(slot), SF_SLOT_SIZE);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Erase slot %lu failed: %s", (unsigned long)slot, esp_err_to_name(err));
+        s_errors++;
+        fault_log_record(FAULT_STORE_FORWARD_ERROR);
+        return err;
+    }
+
+    sf_record_header_t hdr = {
+        .magic    = SF_RECORD_MAGIC,
+        .log_seq  = s_next_seq,
+        .len      = (uint16_t)len,
+        .reserved = 0xFFFF,
+        .crc32    = esp_rom_crc32_le(0, frame, (uint32_t)len),
+        .consumed = SF_CONSUMED_PENDING,
+    };
+    memcpy(s_slot_buf, &hdr, sizeof(hdr));
+    memcpy(s_slot_buf + sizeof(hdr), frame, len);
+
+    /* Flash writes are word-sized; pad with the erased value */
+    size_t total  = sizeof(hdr) + len;
+    size_t padded = (total + 3u) & ~(size_t)3u;
+    memset(s_slot_buf + total, 0xFF, padded - total);
+
+    err = esp_partition_write(s_part, slot_offset(slot), s_slot_buf, padded);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Write slot %lu failed: %s", (unsigned long)slot, esp_err_to_name(err));
+        s_errors++;
+        fault_log_record(FAULT_STORE_FORWARD_ERROR);
+        return err;
+    }
+
+    s_head = (s_head + 1) % s_slots;
+    s_next_seq++;
+    s_pending++;
+    s_stored++;
+    return ESP_OK;
+}
+
+/******************************************************************************
+ * REPLAY
+ *****************************************************************************/
+
+void store_forward_on_connected(void)
+{
+    s_connected_ms = now_ms();
+    if (s_pending > 0) {
+        ESP_LOGI(TAG, "Broker connected — %lu stored packets to replay",
+                 (unsigned long)s_pending);
+    }
+}
+
+bool store_forward_replay_due(void)
+{
+    if (s_part == NULL || s_pending == 0 || !mqtt_is_connected()) {
+        return false;
+    }
+    uint32_t now = now_ms();
+    return (now - s_connected_ms)   >= SF_REPLAY_SETTLE_MS &&
+           (now - s_last_replay_ms) >= SF_REPLAY_INTERVAL_MS;
+}
+
+esp_err_t store_forward_replay_one(void)
+{
+    if (s_part == NULL || s_pending == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_last_replay_ms = now_ms();
+
+    uint32_t slot = s_tail;
+    sf_record_header_t hdr;
+    bool ok = read_header(slot, &hdr) &&
+              esp_partition_read(s_part, slot_offset(slot) + sizeof(hdr),
+                                 s_slot_buf, hdr.len) == ESP_OK &&
+              esp_rom_crc32_le(0, s_slot_buf, hdr.len) == hdr.crc32;
+    if (!ok) {
+        /* Corrupt record: skip it rather than wedge the replay forever */
+        ESP_LOGW(TAG, "Slot %lu unreadable or bad CRC — skipped", (unsigned long)slot);
+        s_errors++;
+        s_tail = (s_tail + 1) % s_slots;
+        s_pending--;
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    esp_err_t err = mqtt_publish_sensor_payload((const char *)s_slot_buf, hdr.len);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    const uint32_t done = SF_CONSUMED_DONE;
+    esp_partition_write(s_part, slot_offset(slot) + offsetof(sf_record_header_t, consumed),
+                        &done, sizeof(done));
+
+    s_tail = (s_tail + 1) % s_slots;
+    s_pending--;
+    s_replayed++;
+
+    if (s_pending == 0) {
+        s_full_reported = false;
+        ESP_LOGI(TAG, "Backlog replayed (%lu packets since boot)", (unsigned long)s_replayed);
+    }
+    return ESP_OK;
+}
+
+/******************************************************************************
+ * STATS
+ *****************************************************************************/
+
+uint32_t store_forward_pending(void)
+{
+    return s_pending;
+}
+
+void store_forward_get_stats(store_forward_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    stats->enabled     = (s_part != NULL);
+    stats->capacity    = s_slots;
+    stats->pending     = s_pending;
+    stats->stored      = s_stored;
+    stats->replayed    = s_replayed;
+    stats->overwritten = s_overwritten;
+    stats->errors      = s_errors;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file store_forward.h
+ * @brief Flash-backed store-and-forward log for sensor packets.
+ *
+ * While MQTT is down the publish pipeline encodes every packet as a binary
+ * frame (mqtt.h, "Binary frame") and appends it here instead of dropping it.
+ * Once MQTT_EVENT_CONNECTED has fired and the link has settled, the publish
+ * stage replays the backlog oldest-first at SF_REPLAY_INTERVAL_MS per frame,
+ * interleaved with live packets, so a catch-up never starves live data.
+ *
+ * Replayed frames carry MQTT_BIN_FLAG_REPLAYED and keep their original seq
+ * and base_utc_us, so the Pi can file them into the hourly file they belong
+ * to rather than the current one.
+ *
+ * Storage
+ * =======
+ * A dedicated data partition (label SF_PARTITION_LABEL, see partitions.csv)
+ * is used as a circular log of one record per 4 KB flash sector:
+ *
+ *   off  size  field
+ *     0   u32  magic       SF_RECORD_MAGIC
+ *     4   u32  log_seq     monotonically increasing, survives reboots
+ *     8   u16  len         frame bytes that follow the header
+ *    10   u16  reserved    0xFFFF
+ *    12   u32  crc32       esp_rom_crc32_le over the frame
+ *    16   u32  consumed    0xFFFFFFFF = pending, 0 = replayed
+ *    20        frame
+ *
+ * Marking a record replayed only clears bits, so it needs no erase. The log
+ * is rebuilt by scanning the sector headers at boot, so packets stored before
+ * a power cut are still replayed. When the log is full the oldest pending
+ * record is overwritten and counted in overwritten.
+ *
+ * If the partition is missing the module stays disabled and the pipeline
+ * falls back to dropping packets while offline, as before.
+ */
+
+#ifndef STORE_FORWARD_H
+#define STORE_FORWARD_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * CONFIGURATION
+ *****************************************************************************/
+
+#define SF_PARTITION_LABEL      "sfwd"
+#define SF_PARTITION_SUBTYPE    0x40        /**< First custom data subtype */
+
+#define SF_SLOT_SIZE            4096        /**< One record per flash sector */
+#define SF_RECORD_HEADER_LEN    20
+#define SF_RECORD_MAGIC         0x44574653u /**< "SFWD" little-endian */
+
+/** Largest frame a slot can hold (a full binary packet is 2656 bytes). */
+#define SF_MAX_FRAME_LEN        (SF_SLOT_SIZE - SF_RECORD_HEADER_LEN)
+
+/** Replay pacing: 4 frames/s drains a backlog at 3x the live packet rate. */
+#define SF_REPLAY_INTERVAL_MS   250u
+
+/** Hold off replay this long after MQTT_EVENT_CONNECTED so a flapping link
+ *  does not burn replay attempts. */
+#define SF_REPLAY_SETTLE_MS     2000u
+
+/******************************************************************************
+ * STATISTICS
+ *****************************************************************************/
+
+typedef struct {
+    bool     enabled;        /**< Partition found and scanned               */
+    uint32_t capacity;       /**< Records the partition can hold            */
+    uint32_t pending;        /**< Records waiting to be replayed            */
+    uint32_t stored;         /**< Records written since boot                */
+    uint32_t replayed;       /**< Records published and marked consumed     */
+    uint32_t overwritten;    /**< Pending records lost to a full log        */
+    uint32_t errors;         /**< Flash or CRC errors                       */
+} store_forward_stats_t;
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * @brief Locate the partition and rebuild the log from its sector headers.
+ * @return ESP_ERR_NOT_FOUND if the partition does not exist (module disabled).
+ */
+esp_err_t store_forward_init(void);
+
+/** @brief True if the partition was found; packets can be stored. */
+bool store_forward_enabled(void);
+
+/**
+ * @brief Append one binary frame to the log.
+ *
+ * Sets MQTT_BIN_FLAG_REPLAYED in the frame (in place) before writing. Erases
+ * one flash sector, so call only from the publish stage task.
+ *
+ * @return ESP_ERR_INVALID_SIZE if len exceeds SF_MAX_FRAME_LEN.
+ */
+esp_err_t store_forward_write(uint8_t *frame, size_t len);
+
+/**
+ * @brief Note a broker (re)connection. Called from the MQTT event handler.
+ */
+void store_forward_on_connected(void);
+
+/** @brief True if a backlog exists, MQTT is up and the replay pacing allows one more frame. */
+bool store_forward_replay_due(void);
+
+/**
+ * @brief Publish the oldest pending frame and mark it consumed on success.
+ *
+ * Call only from the publish stage task.
+ * @return ESP_ERR_NOT_FOUND if nothing is pending.
+ */
+esp_err_t store_forward_replay_one(void);
+
+/** @brief Number of records waiting to be replayed. */
+uint32_t store_forward_pending(void);
+
+/** @brief Snapshot the counters. */
+void store_forward_get_stats(store_forward_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STORE_FORWARD_H
@@ -0,0 +1,243 @@
+/**
+ * @file sync_start.c
+ * @brief Scheduled acquisition start (see sync_start.h).
+ *
+ * The armed epoch and state are shared between the MQTT task (arm/cancel)
+ * and the sync-start task (fire) under s_lock. A cancel that lands during
+ * the final SYNC_START_SPIN_US spin is too late: the start goes ahead and
+ * the caller's stop/reset handles the node as if it had started normally.
+ */
+
+#include "sync_start.h"
+#include "mem_budget.h"
+#include "sensor_task.h"
+#include "clock_discipline.h"
+#include "node_config.h"
+#include "fault_log.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+
+static const char *TAG = "SYNC_START";
+
+MEM_BUDGET_STATIC_TASK(s_task_mem, SYNC_START_TASK_STACK_SIZE);
+
+static TaskHandle_t         s_task    = NULL;
+static sync_start_done_cb_t s_done_cb = NULL;
+
+static portMUX_TYPE      s_lock = portMUX_INITIALIZER_UNLOCKED;
+static sync_start_info_t s_info;
+
+/******************************************************************************
+ * HELPERS
+ *****************************************************************************/
+
+/** @brief Local esp_timer time the disciplined clock maps to utc_us. */
+static int64_t utc_to_local_us(int64_t utc_us)
+{
+    int64_t local = esp_timer_get_time();
+    /* The model is local + offset(local) with |d offset/d local| << 1, so two
+       fixed-point steps land well inside a microsecond. */
+    for (int i = 0; i < 2; i++) {
+        local += utc_us - clock_discipline_local_to_utc_us(local);
+    }
+    return local;
+}
+
+static void finish(uint32_t seq, sync_start_state_t state, int32_t offset_us,
+                   const char *error_msg)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_info.state     = state;
+    s_info.offset_us = offset_us;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (s_done_cb) {
+        s_done_cb(seq, state == SYNC_START_STARTED, error_msg);
+    }
+}
+
+/******************************************************************************
+ * TASK
+ *****************************************************************************/
+
+static void fire(int64_t epoch_us, uint32_t seq)
+{
+    if (node_config_get_state() != NODE_STATE_CONFIGURED) {
+        ESP_LOGW(TAG, "Scheduled start skipped: state '%s'",
+                 node_state_str(node_config_get_state()));
+        finish(seq, SYNC_START_FAILED, 0, "not configured at start time");
+        return;
+    }
+
+    int64_t target = utc_to_local_us(epoch_us);
+    if (esp_timer_get_time() > target + SYNC_START_MAX_LATE_US) {
+        /* A late start would put this node's grid out of phase with the fleet */
+        ESP_LOGW(TAG, "Scheduled start missed by %lld us",
+                 (long long)(esp_timer_get_time() - target));
+        finish(seq, SYNC_START_FAILED, 0, "missed start time");
+        return;
+    }
+
+    esp_err_t err = sensor_acquisition_start_at(target);
+    if (err != ESP_OK) {
+        fault_log_record(FAULT_SPI_ERROR);
+        node_config_set_error(FAULT_SPI_ERROR);
+        finish(seq, SYNC_START_FAILED, 0, "ISR start failed");
+        return;
+    }
+    node_config_set_recording();
+
+    int64_t offset = clock_discipline_local_to_utc_us(sensor_acquisition_get_start_us()) - epoch_us;
+    ESP_LOGI(TAG, "Started at epoch %lld us (offset %+lld us)",
+             (long long)epoch_us, (long long)offset);
+    finish(seq, SYNC_START_STARTED, (int32_t)offset, NULL);
+}
+
+static void sync_start_task(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        /* Sleep in steps until the spin window; any notify (cancel, re-arm)
+           wakes us to re-read the schedule. The target is recomputed each
+           time so a clock slew while waiting is followed. */
+        for (;;) {
+            portENTER_CRITICAL(&s_lock);
+            bool     armed = (s_info.state == SYNC_START_ARMED);
+            int64_t  epoch = s_info.epoch_us;
+            uint32_t seq   = s_info.seq;
+            portEXIT_CRITICAL(&s_lock);
+            if (!armed) {
+                break;
+            }
+
+            int64_t wait_us = utc_to_local_us(epoch) - SYNC_START_SPIN_US - esp_timer_get_time();
+            TickType_t ticks = pdMS_TO_TICKS(wait_us / 1000);
+            if (wait_us > 0 && ticks > 0) {
+                ulTaskNotifyTake(pdTRUE, ticks);
+                continue;
+            }
+
+            portENTER_CRITICAL(&s_lock);
+            armed = (s_info.state == SYNC_START_ARMED && s_info.epoch_us == epoch);
+            portEXIT_CRITICAL(&s_lock);
+            if (armed) {
+                fire(epoch, seq);
+            }
+            break;
+        }
+    }
+}
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+esp_err_t sync_start_init(sync_start_done_cb_t done_cb)
+{
+    s_done_cb = done_cb;
+    if (s_task != NULL) {
+        return ESP_OK;
+    }
+
+    memset(&s_info, 0, sizeof(s_info));
+
+    s_task = mem_budget_task_create("sync_start", &s_task_mem, sync_start_task,
+                                     "sync_start", NULL, SYNC_START_TASK_PRIORITY,
+                                     SYNC_START_TASK_CORE);
+    if (s_task == NULL) {
+        ESP_LOGE(TAG, "Failed to create sync-start task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t sync_start_arm(int64_t epoch_utc_us, uint32_t seq, const char **error_msg)
+{
+    const char *why = NULL;
+    esp_err_t   err = ESP_OK;
+
+    if (s_task == NULL) {
+        why = "sync start unavailable";
+        err = ESP_ERR_INVALID_STATE;
+    } else if (!clock_discipline_is_synced()) {
+        why = "clock not synced";
+        err = ESP_ERR_INVALID_STATE;
+    } else {
+        int64_t lead_us = epoch_utc_us - clock_discipline_now_utc_us();
+        if (lead_us < (int64_t)SYNC_START_MIN_LEAD_MS * 1000) {
+            why = "start time too soon";
+            err = ESP_ERR_INVALID_ARG;
+        } else if (lead_us > (int64_t)SYNC_START_MAX_LEAD_S * 1000000) {
+            why = "start time too far ahead";
+            err = ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "start_at rejected: %s", why);
+        if (error_msg) {
+            *error_msg = why;
+        }
+        return err;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_info.state     = SYNC_START_ARMED;
+    s_info.epoch_us  = epoch_utc_us;
+    s_info.offset_us = 0;
+    s_info.seq       = seq;
+    portEXIT_CRITICAL(&s_lock);
+    xTaskNotifyGive(s_task);
+
+    ESP_LOGI(TAG, "Armed for epoch %lld us", (long long)epoch_utc_us);
+    return ESP_OK;
+}
+
+void sync_start_cancel(void)
+{
+    bool was_armed;
+    portENTER_CRITICAL(&s_lock);
+    was_armed = (s_info.state == SYNC_START_ARMED);
+    if (was_armed) {
+        s_info.state = SYNC_START_IDLE;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (was_armed) {
+        xTaskNotifyGive(s_task);
+        ESP_LOGI(TAG, "Scheduled start cancelled");
+    }
+}
+
+bool sync_start_is_armed(void)
+{
+    return s_info.state == SYNC_START_ARMED;
+}
+
+void sync_start_get_info(sync_start_info_t *info)
+{
+    if (info == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *info = s_info;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+const char *sync_start_state_str(sync_start_state_t state)
+{
+    switch (state) {
+        case SYNC_START_IDLE:    return "idle";
+        case SYNC_START_ARMED:   return "armed";
+        case SYNC_START_STARTED: return "started";
+        case SYNC_START_FAILED:  return "failed";
+        default:                 return "unknown";
+    }
+}
@@ -0,0 +1,101 @@
+/**
+ * @file sync_start.h
+ * @brief Scheduled acquisition start at a fleet-wide UTC epoch.
+ *
+ * Each node used to start recording whenever it processed its own "start"
+ * command, so tick 0 landed at an unrelated instant on every node. The
+ * "start_at" control command (normally sent on wind_turbine/all/cmd/control)
+ * carries a future UTC epoch instead:
+ *
+ *   {"cmd":"start_at","epoch_us":1760400000000000,"seq":7}
+ *
+ * The epoch is mapped to a local esp_timer instant through the disciplined
+ * clock (clock_discipline.h). The sync-start task sleeps until
+ * SYNC_START_SPIN_US before it, then sensor_acquisition_start_at() does the
+ * preparation and spins out the rest, so the first tick is one period after
+ * the epoch on every node, to within each node's clock error.
+ *
+ * The command is acked at once (cmd_ack "start_at"). When the start fires,
+ * a second status with cmd_ack "start" reports the result, and the status
+ * JSON carries "sync_start":{"state":..,"epoch_us":..,"offset_us":..} where
+ * offset_us is the achieved start minus the epoch on the node's own clock.
+ */
+
+#ifndef SYNC_START_H
+#define SYNC_START_H
+
+#include "esp_err.h"
+#include "cpu_topology.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * CONFIGURATION
+ *****************************************************************************/
+
+#define SYNC_START_MIN_LEAD_MS      100     /**< Epoch must be at least this far ahead */
+#define SYNC_START_MAX_LEAD_S       600     /**< ... and at most this far              */
+#define SYNC_START_SPIN_US          20000   /**< Busy-wait window before the epoch     */
+#define SYNC_START_MAX_LATE_US      1000    /**< Woke later than this: do not start    */
+
+/* Above every task except acquisition, so the wake-up is not delayed */
+#define SYNC_START_TASK_STACK_SIZE  4096
+#define SYNC_START_TASK_PRIORITY    (configMAX_PRIORITIES - 2)
+#define SYNC_START_TASK_CORE        SHM_CORE_ACQ
+
+typedef enum {
+    SYNC_START_IDLE    = 0,     /**< Nothing scheduled                      */
+    SYNC_START_ARMED   = 1,     /**< Waiting for epoch_us                   */
+    SYNC_START_STARTED = 2,     /**< Last scheduled start fired             */
+    SYNC_START_FAILED  = 3,     /**< Last scheduled start did not happen    */
+} sync_start_state_t;
+
+typedef struct {
+    sync_start_state_t state;
+    int64_t  epoch_us;          /**< Requested UTC start                    */
+    int32_t  offset_us;         /**< Achieved start - epoch (STARTED only)  */
+    uint32_t seq;               /**< seq of the start_at command            */
+} sync_start_info_t;
+
+/** @brief Called from the sync-start task when a scheduled start fires or fails. */
+typedef void (*sync_start_done_cb_t)(uint32_t seq, bool ok, const char *error_msg);
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/** @brief Create the sync-start task. Call once, after sensor_acquisition_init(). */
+esp_err_t sync_start_init(sync_start_done_cb_t done_cb);
+
+/**
+ * @brief Schedule acquisition to start at a UTC epoch.
+ *
+ * Replaces any start already armed. The node must be CONFIGURED when the
+ * start fires; that is checked again at the epoch.
+ *
+ * @param epoch_utc_us  Start instant, microseconds since the Unix epoch
+ * @param seq           Echoed in the completion status
+ * @param error_msg     Set to a short reason on failure (may be NULL)
+ * @return ESP_OK if armed, ESP_ERR_INVALID_STATE if the clock is not synced,
+ *         ESP_ERR_INVALID_ARG if the epoch is too soon or too far ahead
+ */
+esp_err_t sync_start_arm(int64_t epoch_utc_us, uint32_t seq, const char **error_msg);
+
+/** @brief Drop an armed start (stop, reset, configure, manual start). */
+void sync_start_cancel(void);
+
+bool sync_start_is_armed(void);
+
+void sync_start_get_info(sync_start_info_t *info);
+
+const char *sync_start_state_str(sync_start_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SYNC_START_H
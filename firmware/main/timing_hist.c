@@ -0,0 +1,121 @@
+/**
+ * @file timing_hist.c
+ * @brief Log2-bucketed timing histograms (see timing_hist.h).
+ */
+
+#include "timing_hist.h"
+#include "mqtt.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "TIMING";
+
+#define TIMING_TOPIC_BUF_SIZE  80
+
+/* Read and reset from task context, written from the measured context */
+static volatile timing_hist_t s_hist[TIMING_HIST_COUNT];
+
+static char s_json_buf[TIMING_HIST_JSON_MAX];
+
+static const char *const s_names[TIMING_HIST_COUNT] = {
+    [TIMING_ISR]         = "isr",
+    [TIMING_SPI_ADXL355] = "spi_adxl355",
+    [TIMING_SPI_SCL3300] = "spi_scl3300",
+    [TIMING_TICK_JITTER] = "tick_jitter",
+    [TIMING_DATA_LOOP]   = "data_loop",
+};
+
+void IRAM_ATTR timing_hist_record(timing_hist_id_t id, uint32_t cycles)
+{
+    volatile timing_hist_t *h = &s_hist[id];
+
+    uint32_t b = (cycles == 0) ? 0 : 31u - (uint32_t)__builtin_clz(cycles);
+    if (b >= TIMING_HIST_BUCKETS) {
+        b = TIMING_HIST_BUCKETS - 1;
+    }
+    h->bucket[b]++;
+    h->count++;
+    h->sum += cycles;
+    if (cycles > h->max) {
+        h->max = cycles;
+    }
+}
+
+void timing_hist_get(timing_hist_id_t id, timing_hist_t *out)
+{
+    if (id >= TIMING_HIST_COUNT || out == NULL) {
+        return;
+    }
+    /* Field-by-field copy: the writer may be mid-update, which can only skew
+     * one sample and is acceptable for diagnostics. */
+    volatile const timing_hist_t *h = &s_hist[id];
+    out->count = h->count;
+    out->max   = h->max;
+    out->sum   = h->sum;
+    for (int b = 0; b < TIMING_HIST_BUCKETS; b++) {
+        out->bucket[b] = h->bucket[b];
+    }
+}
+
+void timing_hist_reset(void)
+{
+    for (int i = 0; i < TIMING_HIST_COUNT; i++) {
+        volatile timing_hist_t *h = &s_hist[i];
+        h->count = 0;
+        h->max   = 0;
+        h->sum   = 0;
+        for (int b = 0; b < TIMING_HIST_BUCKETS; b++) {
+            h->bucket[b] = 0;
+        }
+    }
+    ESP_LOGI(TAG, "Timing histograms reset");
+}
+
+const char *timing_hist_name(timing_hist_id_t id)
+{
+    return (id < TIMING_HIST_COUNT) ? s_names[id] : "unknown";
+}
+
+int timing_hist_to_json(char *buf, size_t cap)
+{
+    int off = snprintf(buf, cap, "{\"cpu_mhz\":%lu,\"unit\":\"cycles\"",
+                       (unsigned long)esp_rom_get_cpu_ticks_per_us());
+
+    for (int i = 0; i < TIMING_HIST_COUNT && off < (int)cap; i++) {
+        timing_hist_t h;
+        timing_hist_get((timing_hist_id_t)i, &h);
+        uint32_t avg = h.count ? (uint32_t)(h.sum / h.count) : 0;
+
+        off += snprintf(buf + off, cap - off, ",\"%s\":{\"n\":%lu,\"max\":%lu,\"avg\":%lu,\"b\":[",
+                        s_names[i], (unsigned long)h.count,
+                        (unsigned long)h.max, (unsigned long)avg);
+        for (int b = 0; b < TIMING_HIST_BUCKETS && off < (int)cap; b++) {
+            off += snprintf(buf + off, cap - off, "%s%lu", b ? "," : "",
+                            (unsigned long)h.bucket[b]);
+        }
+        if (off < (int)cap) {
+            off += snprintf(buf + off, cap - off, "]}");
+        }
+    }
+    if (off < (int)cap) {
+        off += snprintf(buf + off, cap - off, "}");
+    }
+    return (off < (int)cap) ? off : -1;
+}
+
+esp_err_t timing_hist_publish(void)
+{
+    int len = timing_hist_to_json(s_json_buf, sizeof(s_json_buf));
+    if (len < 0) {
+        ESP_LOGE(TAG, "Timing snapshot does not fit %d bytes", TIMING_HIST_JSON_MAX);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    char topic[TIMING_TOPIC_BUF_SIZE];
+    snprintf(topic, sizeof(topic), "%s/%s/%s",
+             MQTT_TOPIC_PREFIX, mqtt_get_serial_no(), TIMING_HIST_TOPIC_SUFFIX);
+    return mqtt_publish(topic, s_json_buf, len);
+}
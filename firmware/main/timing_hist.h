@@ -0,0 +1,86 @@
+/**
+ * @file timing_hist.h
+ * @brief Log2-bucketed timing histograms for field validation of the ISR path.
+ *
+ * Durations are taken with esp_cpu_get_cycle_count() on the core that runs
+ * the measured code and recorded in CPU cycles:
+ *
+ *   isr            acquisition ISR execution (every engine)
+ *   spi_adxl355    one ADXL355 service (FIFO burst or single poll)
+ *   spi_scl3300    one SCL3300 service (three rolling frames)
+ *   tick_jitter    |ISR entry interval - nominal period|
+ *   data_loop      one data task iteration, excluding its sleep
+ *
+ * Bucket b counts values v with floor(log2(v)) == b (v = 0 goes to bucket
+ * 0); the last bucket also collects everything larger. At 240 MHz bucket 7
+ * is 0.53-1.07 us and bucket 23 is 35-70 ms.
+ *
+ * The snapshot is published on demand on wind_turbine/<SERIAL>/timing
+ * (control command {"cmd":"timing"}; {"cmd":"timing_reset"} clears it):
+ *
+ *   {"cpu_mhz":240,"unit":"cycles",
+ *    "isr":{"n":123456,"max":4321,"avg":812,"b":[0,0,...,24 counts]},
+ *    "spi_adxl355":{...},"spi_scl3300":{...},"tick_jitter":{...},
+ *    "data_loop":{...}}
+ *
+ * Each histogram has a single writer (the ISR, the acquisition task or the
+ * data task), so recording is a handful of plain stores with no locking.
+ */
+
+#ifndef TIMING_HIST_H
+#define TIMING_HIST_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TIMING_HIST_BUCKETS         24
+#define TIMING_HIST_TOPIC_SUFFIX    "timing"
+#define TIMING_HIST_JSON_MAX        2048
+
+typedef enum {
+    TIMING_ISR = 0,
+    TIMING_SPI_ADXL355,
+    TIMING_SPI_SCL3300,
+    TIMING_TICK_JITTER,
+    TIMING_DATA_LOOP,
+    TIMING_HIST_COUNT,
+} timing_hist_id_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t bucket[TIMING_HIST_BUCKETS];
+} timing_hist_t;
+
+/** @brief Add one measurement in CPU cycles. IRAM-safe. */
+void timing_hist_record(timing_hist_id_t id, uint32_t cycles);
+
+/** @brief Copy one histogram. */
+void timing_hist_get(timing_hist_id_t id, timing_hist_t *out);
+
+/** @brief Clear every histogram. */
+void timing_hist_reset(void);
+
+/** @brief Short name used as the JSON key ("isr", "spi_adxl355", ...). */
+const char *timing_hist_name(timing_hist_id_t id);
+
+/**
+ * @brief Serialise all histograms as described above.
+ * @return Bytes written, or -1 if @p cap is too small.
+ */
+int timing_hist_to_json(char *buf, size_t cap);
+
+/** @brief Publish the snapshot on the timing topic. */
+esp_err_t timing_hist_publish(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIMING_HIST_H
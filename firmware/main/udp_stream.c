@@ -0,0 +1,404 @@
+/**
+ * @file udp_stream.c
+ * @brief UDP multicast transport for binary sensor frames (see udp_stream.h).
+ *
+ * s_enabled / s_raw / s_port / s_reopen are written by command handlers and
+ * read by the publish stage; the open raw frame belongs to the data task;
+ * everything else, the socket included, belongs to the publish stage task.
+ * Raw frame slots move between the two tasks through the free / ready
+ * queues, like the publish pipeline's.
+ */
+
+#include "udp_stream.h"
+#include "ethernet.h"
+#include "mqtt.h"
+#include "mem_budget.h"
+#include "packet_time.h"
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "lwip/sockets.h"
+#include "lwip/inet.h"
+#include <string.h>
+#include <errno.h>
+
+static const char *TAG = "UDP_STREAM";
+
+/* Requests (any task) */
+static volatile bool     s_enabled = false;
+static volatile bool     s_raw     = false;
+static volatile uint16_t s_port    = UDP_STREAM_DEFAULT_PORT;
+static volatile bool     s_reopen  = false;
+
+/* Publish stage only */
+static int                s_sock          = -1;
+static uint16_t           s_open_port     = 0;
+static struct sockaddr_in s_dest;
+static uint32_t           s_dgram_seq     = 0;
+static uint32_t           s_raw_dgram_seq = 0;
+static uint8_t            s_dgram[UDP_STREAM_HEADER_LEN + UDP_STREAM_MAX_PAYLOAD];
+
+/* Raw frame slots, reserved by udp_stream_init() */
+#define RAW_FRAME_MAX   (MQTT_BIN_HEADER_LEN + UDP_STREAM_RAW_FRAME_SAMPLES * 12)
+#define RAW_COUNT_OFF   27          /* accel_count byte of the frame header */
+_Static_assert(RAW_FRAME_MAX <= UDP_STREAM_MAX_PAYLOAD, "a raw frame must fit one datagram");
+_Static_assert(UDP_STREAM_RAW_FRAME_SAMPLES <= UINT8_MAX, "accel_count is a u8");
+
+static uint8_t      *s_raw_buf     = NULL;
+static QueueHandle_t s_raw_free_q  = NULL;
+static QueueHandle_t s_raw_ready_q = NULL;
+
+/* Data task only: the frame being filled */
+static int      s_raw_open = -1;        /* slot index, -1 = none */
+static uint8_t  s_raw_count;
+static uint32_t s_raw_next_tick;
+static uint32_t s_raw_epoch;
+static uint32_t s_raw_seq = 0;
+
+static volatile uint32_t s_frames_sent     = 0;
+static volatile uint32_t s_datagrams_sent  = 0;
+static volatile uint32_t s_bytes_sent      = 0;
+static volatile uint32_t s_send_errors     = 0;
+static volatile uint32_t s_open_errors     = 0;
+static volatile uint32_t s_raw_frames_sent = 0;
+static volatile uint32_t s_raw_slot_drops  = 0;   /* data task     */
+static volatile uint32_t s_raw_send_drops  = 0;   /* publish stage */
+
+/******************************************************************************
+ * SOCKET
+ *****************************************************************************/
+
+static void close_socket(void)
+{
+    if (s_sock >= 0) {
+        close(s_sock);
+        s_sock = -1;
+        ESP_LOGI(TAG, "Multicast stream closed");
+    }
+}
+
+/** @brief Open a non-blocking multicast sender on the Ethernet interface. */
+static esp_err_t open_socket(uint16_t port)
+{
+    esp_netif_ip_info_t ip_info;
+    if (ethernet_get_ip_info(&ip_info) != ESP_OK || ip_info.ip.addr == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "socket() failed: errno %d", errno);
+        return ESP_FAIL;
+    }
+
+    /* Source address and multicast egress both pinned to the Ethernet netif */
+    struct sockaddr_in local = {
+        .sin_family      = AF_INET,
+        .sin_port        = 0,
+        .sin_addr.s_addr = ip_info.ip.addr,
+    };
+    struct in_addr iface = { .s_addr = ip_info.ip.addr };
+    uint8_t ttl  = UDP_STREAM_TTL;
+    uint8_t loop = 0;
+
+    if (bind(sock, (struct sockaddr *)&local, sizeof(local)) < 0 ||
+        setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface)) < 0 ||
+        setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0 ||
+        setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0) {
+        ESP_LOGE(TAG, "Multicast socket setup failed: errno %d", errno);
+        close(sock);
+        return ESP_FAIL;
+    }
+
+    memset(&s_dest, 0, sizeof(s_dest));
+    s_dest.sin_family      = AF_INET;
+    s_dest.sin_port        = htons(port);
+    s_dest.sin_addr.s_addr = inet_addr(UDP_STREAM_GROUP);
+
+    s_sock      = sock;
+    s_open_port = port;
+    ESP_LOGI(TAG, "Multicast stream open -> %s:%u", UDP_STREAM_GROUP, (unsigned)port);
+    return ESP_OK;
+}
+
+/**
+ * @brief Send a frame as datagrams tagged magic, numbered from *dgram_seq.
+ * @return ESP_ERR_INVALID_STATE if the socket is not open, ESP_FAIL if a
+ *         fragment could not be sent
+ */
+static esp_err_t send_datagrams(uint8_t magic, uint32_t *dgram_seq,
+                                const uint8_t *frame, size_t len)
+{
+    if (s_sock < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (frame == NULL || len == 0 || len > UINT16_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t  frag_count  = (uint8_t)((len + UDP_STREAM_MAX_PAYLOAD - 1) / UDP_STREAM_MAX_PAYLOAD);
+    uint32_t serial_hash = mqtt_get_serial_hash();
+    uint16_t frame_len   = (uint16_t)len;
+    esp_err_t ret = ESP_OK;
+
+    for (uint8_t i = 0; i < frag_count; i++) {
+        uint16_t off  = (uint16_t)(i * UDP_STREAM_MAX_PAYLOAD);
+        size_t   flen = (len - off < UDP_STREAM_MAX_PAYLOAD) ? len - off : UDP_STREAM_MAX_PAYLOAD;
+        uint32_t seq  = (*dgram_seq)++;
+
+        uint8_t *p = s_dgram;
+        p[0] = magic;
+        p[1] = UDP_STREAM_VERSION;
+        p[2] = i;
+        p[3] = frag_count;
+        memcpy(p + 4,  &serial_hash, 4);
+        memcpy(p + 8,  &seq,         4);
+        memcpy(p + 12, &frame_len,   2);
+        memcpy(p + 14, &off,         2);
+        memcpy(p + UDP_STREAM_HEADER_LEN, frame + off, flen);
+
+        /* Never block the publish stage: a full lwIP queue costs this datagram */
+        int sent = sendto(s_sock, s_dgram, UDP_STREAM_HEADER_LEN + flen, MSG_DONTWAIT,
+                          (struct sockaddr *)&s_dest, sizeof(s_dest));
+        if (sent < 0) {
+            s_send_errors++;
+            ESP_LOGD(TAG, "sendto failed: errno %d", errno);
+            ret = ESP_FAIL;
+            continue;
+        }
+        s_datagrams_sent++;
+        s_bytes_sent += (uint32_t)sent;
+    }
+    return ret;
+}
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+esp_err_t udp_stream_init(void)
+{
+    if (s_raw_buf != NULL) {
+        return ESP_OK;
+    }
+    if (s_raw_free_q == NULL) {
+        s_raw_free_q  = xQueueCreate(UDP_STREAM_RAW_SLOTS, sizeof(uint8_t));
+        s_raw_ready_q = xQueueCreate(UDP_STREAM_RAW_SLOTS, sizeof(uint8_t));
+    }
+    uint8_t *buf = (s_raw_free_q && s_raw_ready_q)
+        ? mem_budget_reserve("udp_stream", UDP_STREAM_RAW_SLOTS * RAW_FRAME_MAX, true)
+        : NULL;
+    if (buf == NULL) {
+        ESP_LOGW(TAG, "No memory for raw frame buffers -- raw stream unavailable");
+        return ESP_ERR_NO_MEM;
+    }
+    for (uint8_t i = 0; i < UDP_STREAM_RAW_SLOTS; i++) {
+        xQueueSend(s_raw_free_q, &i, 0);
+    }
+    s_raw_buf = buf;
+    return ESP_OK;
+}
+
+bool udp_stream_raw_available(void)
+{
+    return s_raw_buf != NULL;
+}
+
+void udp_stream_set_enabled(bool enable, bool raw, uint16_t port)
+{
+    raw = raw && enable && udp_stream_raw_available();
+    if (port != 0) {
+        s_port = port;
+    }
+    if (enable != s_enabled || raw != s_raw) {
+        ESP_LOGI(TAG, "Data transport -> %s", raw ? "udp_raw" : enable ? "udp" : "mqtt");
+    }
+    s_enabled = enable;
+    s_raw     = raw;
+}
+
+bool udp_stream_is_enabled(void)
+{
+    return s_enabled;
+}
+
+bool udp_stream_raw_enabled(void)
+{
+    return s_raw;
+}
+
+void udp_stream_note_netif_changed(void)
+{
+    s_reopen = true;
+}
+
+void udp_stream_service(void)
+{
+    bool     want = s_enabled;
+    uint16_t port = s_port;
+
+    if (s_sock >= 0 && (!want || s_reopen || port != s_open_port)) {
+        close_socket();
+    }
+    s_reopen = false;
+
+    if (want && s_sock < 0) {
+        esp_err_t err = open_socket(port);
+        if (err == ESP_FAIL) {
+            s_open_errors++;
+        }
+        /* ESP_ERR_INVALID_STATE (no IP yet): retried on the next call */
+    }
+}
+
+esp_err_t udp_stream_send_frame(const uint8_t *frame, size_t len)
+{
+    esp_err_t ret = send_datagrams(UDP_STREAM_MAGIC, &s_dgram_seq, frame, len);
+    if (ret == ESP_OK) {
+        s_frames_sent++;
+    }
+    return ret;
+}
+
+/******************************************************************************
+ * RAW ODR STREAM
+ *****************************************************************************/
+
+static inline uint8_t *raw_slot(int idx)
+{
+    return s_raw_buf + (size_t)idx * RAW_FRAME_MAX;
+}
+
+/** Start a frame at sample s; false if every slot is queued or in flight. */
+static bool raw_frame_open(const adxl355_raw_sample_t *s, const node_runtime_config_t *cfg)
+{
+    uint8_t idx;
+    if (xQueueReceive(s_raw_free_q, &idx, 0) != pdTRUE) {
+        return false;
+    }
+
+    /* mqtt.h version 1 header; seq, base_utc_us and accel_count on close */
+    uint8_t *p = raw_slot(idx);
+    uint32_t serial_hash = mqtt_get_serial_hash();
+    uint16_t odr_hz      = (uint16_t)cfg->odr_hz;
+    uint16_t period      = (uint16_t)cfg->isr_tick_divisor;
+    p[0]  = MQTT_BIN_MAGIC;
+    p[1]  = MQTT_BIN_VERSION;
+    p[2]  = MQTT_BIN_FLAG_ACCEL_VALID;
+    p[3]  = cfg->range;
+    memcpy(p + 4,  &serial_hash, 4);
+    memcpy(p + 12, &s->tick,     4);
+    memcpy(p + 24, &odr_hz,      2);
+    p[26] = 1;                              /* decim */
+    memcpy(p + 28, &period,      2);
+    p[30] = 0;                              /* incl_count */
+    p[31] = (uint8_t)cfg->epoch;
+
+    s_raw_open      = idx;
+    s_raw_count     = 0;
+    s_raw_next_tick = s->tick;
+    s_raw_epoch     = cfg->epoch;
+    return true;
+}
+
+void udp_stream_raw_close(void)
+{
+    if (s_raw_open < 0) {
+        return;
+    }
+    uint8_t *p = raw_slot(s_raw_open);
+    uint32_t base_tick;
+    memcpy(&base_tick, p + 12, 4);
+
+    ts_anchor_t anchor;
+    ts_anchor_capture(&anchor);
+    int64_t base_utc_us = ts_anchor_tick_to_utc_us(&anchor, base_tick);
+    uint32_t seq        = s_raw_seq++;
+    memcpy(p + 8,  &seq,         4);
+    memcpy(p + 16, &base_utc_us, 8);
+    p[RAW_COUNT_OFF] = s_raw_count;
+
+    /* Cannot fail: the queue holds every slot index */
+    uint8_t idx = (uint8_t)s_raw_open;
+    xQueueSend(s_raw_ready_q, &idx, 0);
+    s_raw_open = -1;
+}
+
+void udp_stream_feed_raw(const adxl355_raw_sample_t *in, uint32_t n,
+                         const node_runtime_config_t *cfg)
+{
+    if (!s_raw) {
+        if (s_raw_open >= 0) {
+            uint8_t idx = (uint8_t)s_raw_open;
+            xQueueSend(s_raw_free_q, &idx, 0);
+            s_raw_open = -1;
+        }
+        return;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        const adxl355_raw_sample_t *s = &in[i];
+
+        /* A frame is a run of consecutive samples under one config */
+        if (s_raw_open >= 0 && (s->tick != s_raw_next_tick || cfg->epoch != s_raw_epoch)) {
+            udp_stream_raw_close();
+        }
+        if (s_raw_open < 0 && !raw_frame_open(s, cfg)) {
+            s_raw_slot_drops += n - i;
+            return;
+        }
+
+        uint8_t *p = raw_slot(s_raw_open) + MQTT_BIN_HEADER_LEN + (size_t)s_raw_count * 12;
+        memcpy(p,     &s->raw_x, 4);
+        memcpy(p + 4, &s->raw_y, 4);
+        memcpy(p + 8, &s->raw_z, 4);
+        s_raw_count++;
+        s_raw_next_tick = s->tick + cfg->isr_tick_divisor;
+
+        if (s_raw_count == UDP_STREAM_RAW_FRAME_SAMPLES) {
+            udp_stream_raw_close();
+        }
+    }
+}
+
+void udp_stream_send_raw(void)
+{
+    if (s_raw_ready_q == NULL) {
+        return;
+    }
+    uint8_t idx;
+    while (xQueueReceive(s_raw_ready_q, &idx, 0) == pdTRUE) {
+        const uint8_t *frame = raw_slot(idx);
+        uint8_t        count = frame[RAW_COUNT_OFF];
+        size_t         len   = MQTT_BIN_HEADER_LEN + (size_t)count * 12;
+
+        /* Best effort, like the decimated frames: a switched-off stream or
+         * a closed socket costs the frame */
+        if (s_raw && send_datagrams(UDP_STREAM_MAGIC_RAW, &s_raw_dgram_seq, frame, len) == ESP_OK) {
+            s_raw_frames_sent++;
+        } else {
+            s_raw_send_drops += count;
+        }
+        xQueueSend(s_raw_free_q, &idx, 0);
+    }
+}
+
+void udp_stream_get_stats(udp_stream_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    stats->enabled             = s_enabled;
+    stats->open                = (s_sock >= 0);
+    stats->port                = s_port;
+    stats->frames_sent         = s_frames_sent;
+    stats->datagrams_sent      = s_datagrams_sent;
+    stats->bytes_sent          = s_bytes_sent;
+    stats->send_errors         = s_send_errors;
+    stats->open_errors         = s_open_errors;
+    stats->raw                 = s_raw;
+    stats->raw_frames_sent     = s_raw_frames_sent;
+    stats->raw_samples_dropped = s_raw_slot_drops + s_raw_send_drops;
+}
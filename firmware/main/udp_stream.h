@@ -0,0 +1,171 @@
+/**
+ * @file udp_stream.h
+ * @brief Optional UDP multicast transport for data frames and the raw ODR stream.
+ *
+ * MQTT over TCP to the Pi broker serialises every data packet behind the
+ * previous one, so a burst of retransmissions stalls the whole stream.
+ * When enabled ("transport":"udp" in a configure command), the publish
+ * stage sends each binary frame (mqtt.h layout, v1 or packed v2) as UDP
+ * datagrams to UDP_STREAM_GROUP:port on the Ethernet netif instead. MQTT
+ * keeps carrying commands, status, faults, spectra and events, and data
+ * again as soon as the transport is switched back to "mqtt".
+ *
+ * Datagrams are fire-and-forget: no store-and-forward, no flow control, no
+ * retransmission. A frame larger than UDP_STREAM_MAX_PAYLOAD is split into
+ * fragments so the IP layer never fragments. Each datagram starts with
+ * (little-endian):
+ *
+ *   offset size field
+ *     0    u8   magic         UDP_STREAM_MAGIC
+ *     1    u8   version       UDP_STREAM_VERSION
+ *     2    u8   frag_index    0 .. frag_count-1
+ *     3    u8   frag_count
+ *     4    u32  serial_hash   same FNV-1a as the binary frame header
+ *     8    u32  dgram_seq     +1 per datagram sent by this node
+ *    12    u16  frame_len     bytes of the whole binary frame
+ *    14    u16  frag_offset   where this fragment goes in the frame
+ *    16         fragment bytes
+ *
+ * Fragments of one frame carry consecutive dgram_seq values, so the frame
+ * is identified by dgram_seq - frag_index. Gaps in dgram_seq give the
+ * receiver (dataStorage/udp_receiver.py) its loss count; the frame seq in
+ * the binary header orders frames.
+ *
+ * Those frames are the regular data packets: one per second, decimated to
+ * 200 Hz. "transport":"udp_raw" adds the undecimated ADXL355 stream (1-4 kHz)
+ * for commissioning and dynamic tests. The data task hands every raw sample
+ * it consumes to udp_stream_feed_raw(), which packs runs of up to
+ * UDP_STREAM_RAW_FRAME_SAMPLES consecutive samples into version 1 binary
+ * frames with decim 1, accel_period = ticks per raw sample, flags
+ * ACCEL_VALID only (no incl, temp or trailers) and a seq of their own. A
+ * tick discontinuity or a config epoch change starts a new frame. A raw
+ * frame always fits one datagram; raw datagrams carry UDP_STREAM_MAGIC_RAW
+ * and their own dgram_seq, so the receiver keeps loss and order per stream.
+ * Raw frames queue in UDP_STREAM_RAW_SLOTS buffers between the data task
+ * and the publish stage; when none is free the samples are counted as
+ * dropped and the decimated packets are unaffected.
+ *
+ * Threading: udp_stream_set_enabled() and udp_stream_note_netif_changed()
+ * only post requests. The socket is opened, used and closed by the publish
+ * stage task alone, in udp_stream_service(), udp_stream_send_frame() and
+ * udp_stream_send_raw(). The open raw frame belongs to the data task.
+ */
+
+#ifndef UDP_STREAM_H
+#define UDP_STREAM_H
+
+#include "esp_err.h"
+#include "sensor_task.h"
+#include "node_config.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * CONFIGURATION
+ *****************************************************************************/
+
+#define UDP_STREAM_GROUP            "239.255.42.1"  /**< Administratively scoped */
+#define UDP_STREAM_DEFAULT_PORT     5010
+#define UDP_STREAM_TTL              1               /**< Never routed off the segment */
+
+#define UDP_STREAM_MAGIC            0xB6
+#define UDP_STREAM_MAGIC_RAW        0xB7            /**< Datagram of the raw ODR stream */
+#define UDP_STREAM_VERSION          1
+#define UDP_STREAM_HEADER_LEN       16
+
+/** Keeps header + fragment + IP/UDP headers inside a 1500-byte Ethernet MTU. */
+#define UDP_STREAM_MAX_PAYLOAD      1400
+
+/** Raw samples per raw frame: 32 + 100 x 12 = 1232 bytes, one datagram;
+ *  25 ms of data at 4 kHz, 100 ms at 1 kHz. */
+#define UDP_STREAM_RAW_FRAME_SAMPLES 100
+/** Raw frames queued for the publish stage (200 ms at 4 kHz) */
+#define UDP_STREAM_RAW_SLOTS        8
+/** Publish stage poll interval while the raw stream is on */
+#define UDP_STREAM_RAW_POLL_MS      10
+
+typedef struct {
+    bool     enabled;           /**< Requested by command                  */
+    bool     open;              /**< Socket currently open                 */
+    uint16_t port;
+    uint32_t frames_sent;
+    uint32_t datagrams_sent;
+    uint32_t bytes_sent;
+    uint32_t send_errors;       /**< sendto() failures (e.g. no buffers)   */
+    uint32_t open_errors;
+    bool     raw;               /**< Raw ODR stream requested              */
+    uint32_t raw_frames_sent;
+    uint32_t raw_samples_dropped; /**< No free raw slot, or not sent     */
+} udp_stream_stats_t;
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * @brief Reserve the raw frame buffers and queues (boot, once).
+ * @return ESP_ERR_NO_MEM if they cannot be allocated; "udp_raw" is then
+ *         refused and the decimated UDP transport still works
+ */
+esp_err_t udp_stream_init(void);
+
+/** @brief True if udp_stream_init() got the raw frame buffers. */
+bool udp_stream_raw_available(void);
+
+/**
+ * @brief Switch data frames to UDP (true) or back to MQTT (false).
+ * @param raw   Also stream the undecimated samples (needs enable and
+ *              udp_stream_raw_available())
+ * @param port  Destination UDP port; 0 keeps the current one
+ */
+void udp_stream_set_enabled(bool enable, bool raw, uint16_t port);
+
+/** @brief True while data frames are routed to UDP. */
+bool udp_stream_is_enabled(void);
+
+/** @brief True while the raw ODR stream is on (implies udp_stream_is_enabled()). */
+bool udp_stream_raw_enabled(void);
+
+/** @brief Re-open the socket on the next service call (new IP address). */
+void udp_stream_note_netif_changed(void);
+
+/**
+ * @brief Apply pending enable / port / netif requests (publish stage only).
+ */
+void udp_stream_service(void);
+
+/**
+ * @brief Send one binary frame as one or more datagrams (publish stage only).
+ * @return ESP_ERR_INVALID_STATE if the socket is not open, ESP_FAIL if a
+ *         fragment could not be sent
+ */
+esp_err_t udp_stream_send_frame(const uint8_t *frame, size_t len);
+
+/**
+ * @brief Pack raw samples into raw frames (data task only).
+ *
+ * Call with every span the data task consumes while recording; a no-op
+ * while the raw stream is off. @p cfg is the config the span was sampled
+ * with.
+ */
+void udp_stream_feed_raw(const adxl355_raw_sample_t *in, uint32_t n,
+                         const node_runtime_config_t *cfg);
+
+/** @brief Hand the partly filled raw frame to the publish stage (data task only). */
+void udp_stream_raw_close(void);
+
+/** @brief Send every queued raw frame (publish stage only). */
+void udp_stream_send_raw(void);
+
+void udp_stream_get_stats(udp_stream_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UDP_STREAM_H
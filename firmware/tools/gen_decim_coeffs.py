@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""
+Generate firmware/main/decimator_coeffs.h — the CIC + compensating FIR
+decimation profiles used by decimator.c, one per ADXL355 ODR setting.
+
+Each profile decimates ODR -> 200 Hz in two stages:
+
+  1. CIC (order CIC_ORDER, decimation R1) at the raw ODR. Integer
+     adds only, run once per raw sample; bypassed when R1 == 1.
+  2. Linear-phase FIR (decimation R2) at ODR / R1. Its passband is shaped
+     as 1 / H_cic(f) to flatten the CIC droop, and only every R2-th output
+     is computed (polyphase).
+
+The FIR is designed by frequency sampling with a Kaiser window and stored
+in Q30 with the CIC gain R1^N folded in, so the firmware never divides.
+
+Pure Python (no numpy), so it runs anywhere the IDF Python does:
+
+    python3 firmware/tools/gen_decim_coeffs.py > firmware/main/decimator_coeffs.h
+"""
+
+import math
+
+OUT_HZ     = 200
+PASS_HZ    = 80.0          # flat (CIC-compensated) up to here
+STOP_HZ    = 120.0         # first frequency that aliases back under PASS_HZ
+ATTEN_DB   = 60.0          # Kaiser design target
+CIC_ORDER  = 3             # 20-bit input + 3*log2(R1) bits must fit int32 (R1 <= 10)
+COEF_SHIFT = 30
+
+# (odr_hz, R1 (CIC), R2 (FIR)). R1 * R2 == odr / OUT_HZ. R1 is kept small
+# enough that the CIC's own aliases (around multiples of ODR / R1) stay
+# below ~-54 dB; a third-order CIC decimating all the way to 400 Hz only
+# manages ~-36 dB near the band edge.
+PROFILES = [
+    (4000,  5, 4),
+    (2000,  2, 5),
+    (1000,  1, 5),         # odd factor: no 400 Hz intermediate, FIR does it all
+]
+
+GRID = 4096
+
+
+def i0(x):
+    s, t, k = 1.0, 1.0, 1
+    while t > 1e-12 * s:
+        t *= (x / (2.0 * k)) ** 2
+        s += t
+        k += 1
+    return s
+
+
+def cic_mag(f, odr, r, n):
+    if r == 1 or f == 0.0:
+        return 1.0
+    num = math.sin(math.pi * f * r / odr)
+    den = r * math.sin(math.pi * f / odr)
+    return abs(num / den) ** n
+
+
+def kaiser_taps(fs):
+    dw = 2.0 * math.pi * (STOP_HZ - PASS_HZ) / fs
+    n = int(math.ceil((ATTEN_DB - 7.95) / (2.285 * dw))) + 1
+    return n | 1           # odd length -> integer group delay
+
+
+def design(odr, r1, r2):
+    fs = odr / r1
+    taps = kaiser_taps(fs)
+    beta = 0.1102 * (ATTEN_DB - 8.7)
+    c = (taps - 1) / 2.0
+
+    # Brick-wall at the transition centre; the Kaiser window spreads it
+    # over PASS_HZ..STOP_HZ.
+    cut = 0.5 * (PASS_HZ + STOP_HZ)
+
+    def desired(f):
+        return 1.0 / cic_mag(f, odr, r1, CIC_ORDER) if f < cut else 0.0
+
+    df = (fs / 2.0) / GRID
+    d = [desired((k + 0.5) * df) for k in range(GRID)]
+    h = []
+    for i in range(taps):
+        m = i - c
+        acc = sum(d[k] * math.cos(2.0 * math.pi * (k + 0.5) * df * m / fs)
+                  for k in range(GRID))
+        w = i0(beta * math.sqrt(1.0 - (m / c) ** 2)) / i0(beta)
+        h.append(2.0 * acc * df / fs * w)
+    dc = sum(h)
+    h = [x / dc for x in h]
+    return fs, taps, h
+
+
+def fir_mag(h, f, fs):
+    re = sum(x * math.cos(2.0 * math.pi * f * i / fs) for i, x in enumerate(h))
+    im = sum(x * math.sin(2.0 * math.pi * f * i / fs) for i, x in enumerate(h))
+    return math.hypot(re, im)
+
+
+def evaluate(odr, r1, fs, h):
+    total = lambda f: cic_mag(f, odr, r1, CIC_ORDER) * fir_mag(h, f, fs)
+    passband = [total(f) for f in [PASS_HZ * k / 40.0 for k in range(41)]]
+    ripple = 20.0 * math.log10(max(passband) / min(passband))
+    worst = 0.0
+    f = STOP_HZ
+    while f <= odr / 2.0:
+        fold = f % OUT_HZ
+        if fold <= PASS_HZ or fold >= OUT_HZ - PASS_HZ:
+            worst = max(worst, total(f))
+        f += 0.5
+    return ripple, 20.0 * math.log10(worst)
+
+
+def main():
+    print("/**")
+    print(" * @file decimator_coeffs.h")
+    print(" * @brief Decimation profiles — GENERATED by firmware/tools/gen_decim_coeffs.py.")
+    print(" *")
+    print(" * Do not edit by hand; re-run the generator instead. Included only by")
+    print(" * decimator.c.")
+    print(" *")
+    print(" * CIC order %d, FIR passband 0-%g Hz (CIC droop compensated), stopband" % (CIC_ORDER, PASS_HZ))
+    print(" * from %g Hz, Kaiser %g dB design, coefficients Q%d / R1^N." % (STOP_HZ, ATTEN_DB, COEF_SHIFT))
+    print(" *")
+    print(" *   ODR   R1  R2  taps  ripple   worst alias into 0-%g Hz" % PASS_HZ)
+    rows = []
+    for odr, r1, r2 in PROFILES:
+        fs, taps, h = design(odr, r1, r2)
+        ripple, alias = evaluate(odr, r1, fs, h)
+        rows.append((odr, r1, r2, taps, h))
+        print(" *  %5d  %2d  %2d  %4d  %.2f dB  %.1f dB" % (odr, r1, r2, taps, ripple, alias))
+    print(" */")
+    print()
+    print("#ifndef DECIMATOR_COEFFS_H")
+    print("#define DECIMATOR_COEFFS_H")
+    print()
+    print("#define DECIM_CIC_ORDER      %d" % CIC_ORDER)
+    print("#define DECIM_COEF_SHIFT     %d" % COEF_SHIFT)
+    print("#define DECIM_MAX_TAPS       %d" % max(r[3] for r in rows))
+    print()
+    for odr, r1, r2, taps, h in rows:
+        gain = r1 ** CIC_ORDER if r1 > 1 else 1
+        q = [int(round(x * (1 << COEF_SHIFT) / gain)) for x in h]
+        print("static const int32_t s_fir_%d[%d] = {" % (odr, taps))
+        for i in range(0, taps, 6):
+            print("    " + ", ".join("%10d" % v for v in q[i:i + 6]) + ",")
+        print("};")
+        print()
+    print("static const decim_profile_t s_profiles[] = {")
+    print("    /* odr,  cic_order, R1, R2, taps, coef, delay (half raw samples) */")
+    for odr, r1, r2, taps, h in rows:
+        n = CIC_ORDER if r1 > 1 else 0
+        delay_half = n * (r1 - 1) + r1 * (taps - 1)
+        print("    { %4d, %d, %2d, %d, %3d, s_fir_%d, %4d }," % (odr, n, r1, r2, taps, odr, delay_half))
+    print("};")
+    print()
+    print("#endif // DECIMATOR_COEFFS_H")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,73 @@
+// Times the Decoder page's storage file decoder (StorageFileDecoder in
+// src/Pages/Decoder/decoderCore.ts, without the CSV writers) on uncompressed
+// .bin files, for dataStorage/bench_storage.py. Node cannot import .ts
+// directly, so the module is transpiled with the project's TypeScript into
+// node_modules/.cache first. The file is pushed in 64 KiB chunks, as the
+// page's worker receives it from the file stream.
+//
+//   node scripts/bench-decoder.mjs [--repeat N] <file.bin> [...]
+//
+// Prints one JSON line per file: {"file", "bytes", "records", "seconds"},
+// the best of --repeat runs, or {"file", "error"} for a file it cannot
+// decode (V1 / V2 files are not supported by the page).
+import { mkdirSync, readFileSync, writeFileSync } from "node:fs";
+import { dirname, join } from "node:path";
+import { fileURLToPath, pathToFileURL } from "node:url";
+import ts from "typescript";
+
+const root = join(dirname(fileURLToPath(import.meta.url)), "..");
+const source = join(root, "src", "Pages", "Decoder", "decoderCore.ts");
+const cacheDir = join(root, "node_modules", ".cache", "bench-decoder");
+const target = join(cacheDir, "decoderCore.mjs");
+const CHUNK_BYTES = 64 * 1024;
+
+const args = process.argv.slice(2);
+let repeat = 3;
+const files = [];
+for (let i = 0; i < args.length; i++) {
+  if (args[i] === "--repeat") {
+    repeat = Math.max(1, Number(args[++i]));
+  } else {
+    files.push(args[i]);
+  }
+}
+if (files.length === 0) {
+  console.error("usage: node scripts/bench-decoder.mjs [--repeat N] <file.bin> [...]");
+  process.exit(2);
+}
+
+const { outputText } = ts.transpileModule(readFileSync(source, "utf8"), {
+  compilerOptions: {
+    module: ts.ModuleKind.ESNext,
+    target: ts.ScriptTarget.ES2022,
+  },
+});
+mkdirSync(cacheDir, { recursive: true });
+writeFileSync(target, outputText);
+const { StorageFileDecoder } = await import(pathToFileURL(target).href);
+
+function decodeRecords(bytes) {
+  const decoder = new StorageFileDecoder(() => {});
+  for (let offset = 0; offset < bytes.length; offset += CHUNK_BYTES) {
+    decoder.push(bytes.subarray(offset, offset + CHUNK_BYTES));
+  }
+  decoder.finish();
+  return decoder.sink.records;
+}
+
+for (const file of files) {
+  const bytes = new Uint8Array(readFileSync(file));
+  try {
+    let best = Infinity;
+    let records = 0;
+    for (let run = 0; run < repeat; run++) {
+      const started = process.hrtime.bigint();
+      records = decodeRecords(bytes);
+      best = Math.min(best, Number(process.hrtime.bigint() - started) / 1e9);
+    }
+    console.log(JSON.stringify({ file, bytes: bytes.byteLength, records, seconds: best }));
+  } catch (error) {
+    const reason = error instanceof Error ? error.message : String(error);
+    console.log(JSON.stringify({ file, error: reason }));
+  }
+}
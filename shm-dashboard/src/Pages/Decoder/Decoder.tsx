@@ -29,6 +29,7 @@ function formatProgressLabel(progress: ProgressSnapshot) {
 
 export default function DecoderPage() {
   const fileInputRef = useRef<HTMLInputElement | null>(null);
+  const abortRef = useRef<AbortController | null>(null);
 
   const [queueEntries, setQueueEntries] = useState<RawInputEntry[]>([]);
   const [summary, setSummary] = useState<QueueSummary>({
@@ -87,24 +88,41 @@ export default function DecoderPage() {
       return;
     }
 
+    const controller = new AbortController();
+    abortRef.current = controller;
     setProcessing(true);
     setError("");
     setResult(null);
 
     try {
-      const nextResult = await decodeEntriesToCsv(queueEntries, outputMode, setProgress);
+      const nextResult = await decodeEntriesToCsv(
+        queueEntries,
+        outputMode,
+        setProgress,
+        controller.signal
+      );
       setResult(nextResult);
 
       if (!nextResult.downloadedFileName && nextResult.failures.length > 0) {
         setError("No decoded CSV files were generated. Review the failure details below.");
       }
     } catch (err) {
-      setError(err instanceof Error ? err.message : "Decoding failed.");
+      if (err instanceof DOMException && err.name === "AbortError") {
+        setProgress(EMPTY_PROGRESS);
+        setError("Decoding cancelled.");
+      } else {
+        setError(err instanceof Error ? err.message : "Decoding failed.");
+      }
     } finally {
+      abortRef.current = null;
       setProcessing(false);
     }
   }
 
+  function handleCancel() {
+    abortRef.current?.abort();
+  }
+
   function handleClear() {
     setQueueEntries([]);
     setSummary({
@@ -224,6 +242,11 @@ export default function DecoderPage() {
           >
             Add Files
           </button>
+          {processing && (
+            <button type="button" className="decoder-secondary-btn" onClick={handleCancel}>
+              Cancel
+            </button>
+          )}
           <button
             type="button"
             className="decoder-primary-btn"
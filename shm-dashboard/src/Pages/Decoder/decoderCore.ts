@@ -0,0 +1,1164 @@
+// Decoding for the Decoder page, run in decoderWorker.ts. Storage files
+// (.bin, V3 to V5) and raw backups (.rawbin) are pushed in whatever chunks
+// the (decompressing) file stream yields, and samples come out in batches of
+// typed-array columns per sensor, which the CSV writers below turn into Blob
+// parts. A file is never held in memory whole and no object is made per
+// sample, so multi-hour files decode in bounded memory.
+
+export type DecodeOutputMode = "sensor" | "node";
+
+export type DecodedOutputFile = {
+  fileName: string;
+  bytes: number;
+};
+
+export type DecodeSuccess = {
+  entryName: string;
+  outputFiles: DecodedOutputFile[];
+};
+
+export type DecodeFailure = {
+  entryName: string;
+  reason: string;
+};
+
+export type ProgressSnapshot = {
+  phase: "idle" | "reading" | "decoding" | "packaging" | "done";
+  completed: number;
+  total: number;
+  percent: number;
+  currentLabel: string;
+};
+
+export type SensorKind = "accel" | "inclin" | "temp";
+
+// One batch of one sensor's samples as struct-of-arrays: tsUs[i] with
+// values[axis][i] (x/y/z g, roll/pitch/yaw deg, or temperature degC). NaN is
+// a missing value, including the single empty row a sensor outage decodes to.
+export type SensorColumns = {
+  length: number;
+  tsUs: Float64Array;
+  values: Float64Array[];
+};
+
+export type ColumnBatch = Record<SensorKind, SensorColumns>;
+
+export type CsvOutput = {
+  fileName: string;
+  blob: Blob;
+};
+
+// Samples per batch over all sensors, about five minutes of a 200 Hz node.
+export const BATCH_SAMPLES = 65536;
+
+const TEMP_SCALE = 100;
+const ACCEL_SCALE = 10000;
+const INCLIN_SCALE = 10000;
+const TS_SCALE = 1_000_000;
+
+const FLAG_ACCEL = 0x01;
+const FLAG_INCLIN = 0x02;
+const FLAG_TEMP = 0x04;
+const SENTINEL = 0xff;
+// V4 GAP record: sensor(B) reason(B) start_us(q) dur_us(I), a sensor outage
+// stored instead of NaN rows. Also found in V3 files resumed after the upgrade.
+const GAP_MARKER = 0xfe;
+const GAP_SENSOR_ACCEL = 0;
+const GAP_SENSOR_INCLIN = 1;
+
+const FORMAT_V3 = 3;
+const FORMAT_V4 = 4;
+// V5: accel / inclin stored as self-contained column blocks of bit-packed
+// frame-of-reference deltas (layout in encoder_storage.py).
+const FORMAT_V5 = 5;
+
+const INT32_NAN_SENTINEL = -2147483648;
+const CHANGED_NAN_X = 0x10;
+const CHANGED_NAN_Y = 0x20;
+const CHANGED_NAN_Z = 0x40;
+const CHANGED_NAN_TEMP = 0x10;
+
+const SENSOR_KINDS: SensorKind[] = ["accel", "inclin", "temp"];
+
+const CSV_TYPE = "text/csv;charset=utf-8";
+// Formatted batches kept as strings before they are folded into one Blob,
+// which the browser may keep off the JS heap.
+const CSV_FOLD_PARTS = 16;
+
+const SENSOR_CSV: Record<SensorKind, { suffix: string; header: string; decimals: number }> = {
+  accel: {
+    suffix: "_accelerometer.csv",
+    header: "timestamp_iso,timestamp_us,x_g,y_g,z_g",
+    decimals: 4,
+  },
+  inclin: {
+    suffix: "_inclinometer.csv",
+    header: "timestamp_iso,timestamp_us,roll_deg,pitch_deg,yaw_deg",
+    decimals: 4,
+  },
+  temp: {
+    suffix: "_temperature.csv",
+    header: "timestamp_iso,timestamp_us,temp_c",
+    decimals: 2,
+  },
+};
+
+const NODE_CSV_HEADER =
+  "timestamp_iso,timestamp_us,sensor_type,x_g,y_g,z_g,roll_deg,pitch_deg,yaw_deg,temp_c";
+const NODE_SENSOR_TYPES: Record<SensorKind, string> = {
+  accel: "accelerometer",
+  inclin: "inclinometer",
+  temp: "temperature",
+};
+
+type SensorState = {
+  tsUs: number;
+  xyzPrev: [number, number, number];
+  valPrev: number;
+};
+
+type DecodeState = {
+  accel: SensorState;
+  inclin: SensorState;
+  temp: SensorState;
+};
+
+type AccelSample = {
+  tsUs: number;
+  x: number | null;
+  y: number | null;
+  z: number | null;
+};
+
+type InclinSample = {
+  tsUs: number;
+  roll: number | null;
+  pitch: number | null;
+  yaw: number | null;
+};
+
+type TempSample = {
+  tsUs: number;
+  tempC: number | null;
+};
+
+class BinaryReader {
+  private view: DataView;
+  offset = 0;
+
+  constructor(bytes: Uint8Array) {
+    this.view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+  }
+
+  hasRemaining() {
+    return this.offset < this.view.byteLength;
+  }
+
+  private ensure(bytes: number, label: string) {
+    if (this.offset + bytes > this.view.byteLength) {
+      throw new Error(`EOF reading ${label} at byte ${this.offset}.`);
+    }
+  }
+
+  readUint8(label: string) {
+    this.ensure(1, label);
+    const value = this.view.getUint8(this.offset);
+    this.offset += 1;
+    return value;
+  }
+
+  readUint16(label: string) {
+    this.ensure(2, label);
+    const value = this.view.getUint16(this.offset, true);
+    this.offset += 2;
+    return value;
+  }
+
+  readUint32(label: string) {
+    this.ensure(4, label);
+    const value = this.view.getUint32(this.offset, true);
+    this.offset += 4;
+    return value;
+  }
+
+  readInt16(label: string) {
+    this.ensure(2, label);
+    const value = this.view.getInt16(this.offset, true);
+    this.offset += 2;
+    return value;
+  }
+
+  readInt32(label: string) {
+    this.ensure(4, label);
+    const value = this.view.getInt32(this.offset, true);
+    this.offset += 4;
+    return value;
+  }
+
+  readInt64(label: string) {
+    this.ensure(8, label);
+    const value = Number(this.view.getBigInt64(this.offset, true));
+    this.offset += 8;
+    return value;
+  }
+
+  readUint64(label: string) {
+    this.ensure(8, label);
+    const value = Number(this.view.getBigUint64(this.offset, true));
+    this.offset += 8;
+    return value;
+  }
+
+  // A view into the chunk, not a copy.
+  readBytes(length: number, label: string) {
+    this.ensure(length, label);
+    const start = this.offset;
+    this.offset += length;
+    return new Uint8Array(this.view.buffer, this.view.byteOffset + start, length);
+  }
+}
+
+// Growable columns for one sensor.
+class ColumnBuilder {
+  length = 0;
+  private tsUs: Float64Array;
+  private values: Float64Array[];
+
+  constructor(width: number, capacity = 1024) {
+    this.tsUs = new Float64Array(capacity);
+    this.values = Array.from({ length: width }, () => new Float64Array(capacity));
+  }
+
+  private grow() {
+    const capacity = this.tsUs.length * 2;
+    const tsUs = new Float64Array(capacity);
+    tsUs.set(this.tsUs);
+    this.tsUs = tsUs;
+    this.values = this.values.map((column) => {
+      const next = new Float64Array(capacity);
+      next.set(column);
+      return next;
+    });
+  }
+
+  push(tsUs: number, a: number, b = NaN, c = NaN) {
+    if (this.length === this.tsUs.length) {
+      this.grow();
+    }
+    const index = this.length;
+    this.tsUs[index] = tsUs;
+    this.values[0][index] = a;
+    if (this.values.length === 3) {
+      this.values[1][index] = b;
+      this.values[2][index] = c;
+    }
+    this.length = index + 1;
+  }
+
+  // Hand the filled part over and continue in new arrays.
+  take(): SensorColumns {
+    const length = this.length;
+    const columns: SensorColumns = {
+      length,
+      tsUs: this.tsUs.subarray(0, length),
+      values: this.values.map((column) => column.subarray(0, length)),
+    };
+    if (length > 0) {
+      const capacity = this.tsUs.length;
+      this.tsUs = new Float64Array(capacity);
+      this.values = this.values.map(() => new Float64Array(capacity));
+      this.length = 0;
+    }
+    return columns;
+  }
+}
+
+// Collects one file's samples and hands them on in batches. Batches end on
+// record boundaries; a record that turns out to be cut short is rolled back.
+export class SampleSink {
+  readonly accel = new ColumnBuilder(3);
+  readonly inclin = new ColumnBuilder(3);
+  readonly temp = new ColumnBuilder(1);
+  records = 0;
+  private readonly onBatch: (batch: ColumnBatch) => void;
+  private readonly batchSamples: number;
+
+  constructor(onBatch: (batch: ColumnBatch) => void, batchSamples = BATCH_SAMPLES) {
+    this.onBatch = onBatch;
+    this.batchSamples = batchSamples;
+  }
+
+  get pending() {
+    return this.accel.length + this.inclin.length + this.temp.length;
+  }
+
+  mark(): [number, number, number] {
+    return [this.accel.length, this.inclin.length, this.temp.length];
+  }
+
+  rollback(mark: [number, number, number]) {
+    [this.accel.length, this.inclin.length, this.temp.length] = mark;
+  }
+
+  endRecord() {
+    this.records += 1;
+    if (this.pending >= this.batchSamples) {
+      this.flush();
+    }
+  }
+
+  flush() {
+    if (this.pending === 0) {
+      return;
+    }
+    this.onBatch({
+      accel: this.accel.take(),
+      inclin: this.inclin.take(),
+      temp: this.temp.take(),
+    });
+  }
+}
+
+function joinPending(pending: Uint8Array | null, chunk: Uint8Array) {
+  if (!pending) {
+    return chunk;
+  }
+  const bytes = new Uint8Array(pending.length + chunk.length);
+  bytes.set(pending);
+  bytes.set(chunk, pending.length);
+  return bytes;
+}
+
+function isTruncatedTailError(error: unknown) {
+  return error instanceof Error && error.message.startsWith("EOF reading ");
+}
+
+function freshSensorState(): SensorState {
+  return {
+    tsUs: 0,
+    xyzPrev: [0, 0, 0],
+    valPrev: 0,
+  };
+}
+
+function freshDecodeState(): DecodeState {
+  return {
+    accel: freshSensorState(),
+    inclin: freshSensorState(),
+    temp: freshSensorState(),
+  };
+}
+
+function copySensorState(state: SensorState): SensorState {
+  return { ...state, xyzPrev: [...state.xyzPrev] };
+}
+
+function copyDecodeState(state: DecodeState): DecodeState {
+  return {
+    accel: copySensorState(state.accel),
+    inclin: copySensorState(state.inclin),
+    temp: copySensorState(state.temp),
+  };
+}
+
+// Decode absolute accelerometer / inclinometer bursts.
+function decodeXyzAbsolute(
+  reader: BinaryReader,
+  sensor: SensorState,
+  out: ColumnBuilder,
+  scale: number,
+  label: string
+) {
+  const count = reader.readUint8(`${label} count`);
+  const prev = sensor.xyzPrev;
+
+  for (let index = 0; index < count; index += 1) {
+    const tsUs = reader.readInt64(`${label} absolute timestamp`);
+    sensor.tsUs = tsUs;
+    const x = reader.readInt32(label);
+    const y = reader.readInt32(label);
+    const z = reader.readInt32(label);
+
+    if (x !== INT32_NAN_SENTINEL) prev[0] = x;
+    if (y !== INT32_NAN_SENTINEL) prev[1] = y;
+    if (z !== INT32_NAN_SENTINEL) prev[2] = z;
+
+    out.push(
+      tsUs,
+      x === INT32_NAN_SENTINEL ? NaN : x / scale,
+      y === INT32_NAN_SENTINEL ? NaN : y / scale,
+      z === INT32_NAN_SENTINEL ? NaN : z / scale
+    );
+  }
+}
+
+// Decode V3 accelerometer / inclinometer deltas with NaN flags.
+function decodeXyzDelta(
+  reader: BinaryReader,
+  sensor: SensorState,
+  out: ColumnBuilder,
+  scale: number,
+  label: string
+) {
+  const count = reader.readUint8(`${label} count`);
+  const prev = sensor.xyzPrev;
+
+  for (let index = 0; index < count; index += 1) {
+    const changed = reader.readUint8(`${label} changed`);
+
+    if (changed & 0x01) {
+      sensor.tsUs += reader.readInt32(`${label} delta_ts`);
+    }
+
+    let x = NaN;
+    let y = NaN;
+    let z = NaN;
+    if (!(changed & CHANGED_NAN_X)) {
+      if (changed & 0x02) prev[0] += reader.readInt16(`${label} delta`);
+      x = prev[0] / scale;
+    }
+    if (!(changed & CHANGED_NAN_Y)) {
+      if (changed & 0x04) prev[1] += reader.readInt16(`${label} delta`);
+      y = prev[1] / scale;
+    }
+    if (!(changed & CHANGED_NAN_Z)) {
+      if (changed & 0x08) prev[2] += reader.readInt16(`${label} delta`);
+      z = prev[2] / scale;
+    }
+
+    out.push(sensor.tsUs, x, y, z);
+  }
+}
+
+// Fill out[0..n] with start and the running sum of the n packed deltas, each
+// `bits` bits (little-endian bit order) plus base. Widths up to 24 bits go
+// through a 32-bit bit buffer; wider ones (timestamp gaps) are summed in
+// doubles, as they can pass 32 bits.
+function unpackDeltas(
+  bytes: Uint8Array,
+  n: number,
+  base: number,
+  bits: number,
+  start: number,
+  out: Float64Array
+) {
+  let value = start;
+  out[0] = start;
+  if (bits <= 24) {
+    const mask = (1 << bits) - 1;
+    let buffer = 0;
+    let buffered = 0;
+    let byteIndex = 0;
+    for (let index = 1; index <= n; index += 1) {
+      while (buffered < bits) {
+        buffer |= bytes[byteIndex++] << buffered;
+        buffered += 8;
+      }
+      value += base + (buffer & mask);
+      buffer >>>= bits;
+      buffered -= bits;
+      out[index] = value;
+    }
+    return;
+  }
+
+  let bitPos = 0;
+  for (let index = 1; index <= n; index += 1) {
+    let delta = 0;
+    let weight = 1;
+    let remaining = bits;
+    while (remaining > 0) {
+      const shift = bitPos & 7;
+      const take = Math.min(8 - shift, remaining);
+      delta += ((bytes[bitPos >> 3] >> shift) & ((1 << take) - 1)) * weight;
+      weight *= 2 ** take;
+      remaining -= take;
+      bitPos += take;
+    }
+    value += base + delta;
+    out[index] = value;
+  }
+}
+
+// Decode a V5 accelerometer / inclinometer block.
+function decodeXyzPacked(reader: BinaryReader, out: ColumnBuilder, scale: number, label: string) {
+  const count = reader.readUint16(`${label} count`);
+  const firstUs = reader.readInt64(`${label} first timestamp`);
+  reader.readInt64(`${label} last timestamp`);
+  const tsBase = reader.readInt64(`${label} timestamp base`);
+  const tsBits = reader.readUint8(`${label} timestamp bits`);
+
+  const axes = [0, 1, 2].map(() => {
+    const valid = reader.readUint16(`${label} valid count`);
+    const first = reader.readInt32(`${label} first value`);
+    reader.readInt32(`${label} min`);
+    reader.readInt32(`${label} max`);
+    const base = reader.readInt32(`${label} delta base`);
+    const bits = reader.readUint8(`${label} delta bits`);
+    return { valid, first, base, bits };
+  });
+  const nanMaps = axes.map((axis) =>
+    axis.valid < count ? reader.readBytes(Math.ceil(count / 8), `${label} NaN bitmap`) : null
+  );
+  const tsBytes = reader.readBytes(Math.ceil((Math.max(0, count - 1) * tsBits) / 8), `${label} timestamps`);
+  const payloads = axes.map((axis) =>
+    reader.readBytes(Math.ceil((Math.max(0, axis.valid - 1) * axis.bits) / 8), `${label} values`)
+  );
+  if (count === 0) {
+    return;
+  }
+
+  const tsUs = new Float64Array(count);
+  unpackDeltas(tsBytes, count - 1, tsBase, tsBits, firstUs, tsUs);
+  const columns = axes.map((axis, index) => {
+    const values = new Float64Array(axis.valid);
+    if (axis.valid > 0) {
+      unpackDeltas(payloads[index], axis.valid - 1, axis.base, axis.bits, axis.first, values);
+    }
+    const nanMap = nanMaps[index];
+    if (!nanMap) {
+      return values.map((value) => value / scale);
+    }
+    const column = new Float64Array(count);
+    let next = 0;
+    for (let k = 0; k < count; k += 1) {
+      column[k] = (nanMap[k >> 3] >> (k & 7)) & 1 ? NaN : values[next++] / scale;
+    }
+    return column;
+  });
+
+  for (let k = 0; k < count; k += 1) {
+    out.push(tsUs[k], columns[0][k], columns[1][k], columns[2][k]);
+  }
+}
+
+// Decode absolute temperature samples.
+function decodeTempAbsolute(reader: BinaryReader, sensor: SensorState, out: ColumnBuilder) {
+  const tsUs = reader.readInt64("temp absolute timestamp");
+  sensor.tsUs = tsUs;
+  const tempRaw = reader.readInt32("temp value");
+
+  if (tempRaw === INT32_NAN_SENTINEL) {
+    out.push(tsUs, NaN);
+    return;
+  }
+
+  sensor.valPrev = tempRaw;
+  out.push(tsUs, tempRaw / TEMP_SCALE);
+}
+
+// Decode V3 temperature deltas with NaN flags.
+function decodeTempDelta(reader: BinaryReader, sensor: SensorState, out: ColumnBuilder) {
+  const changed = reader.readUint8("temp changed");
+
+  if (changed & 0x01) {
+    sensor.tsUs += reader.readInt32("temp delta_ts");
+  }
+
+  if (changed & CHANGED_NAN_TEMP) {
+    out.push(sensor.tsUs, NaN);
+    return;
+  }
+
+  if (changed & 0x02) {
+    sensor.valPrev += reader.readInt16("temp delta");
+  }
+  out.push(sensor.tsUs, sensor.valPrev / TEMP_SCALE);
+}
+
+// Decode one ABSOLUTE, DELTA or GAP record into the sink.
+function decodeRecord(
+  reader: BinaryReader,
+  state: DecodeState,
+  sink: SampleSink,
+  formatVersion: number
+) {
+  const headerOrSentinel = reader.readUint8("record header");
+
+  if (headerOrSentinel === GAP_MARKER) {
+    const sensor = reader.readUint8("gap sensor");
+    reader.readUint8("gap reason");
+    const tsUs = reader.readInt64("gap start");
+    reader.readUint32("gap duration");
+
+    if (sensor === GAP_SENSOR_ACCEL) {
+      sink.accel.push(tsUs, NaN, NaN, NaN);
+    } else if (sensor === GAP_SENSOR_INCLIN) {
+      sink.inclin.push(tsUs, NaN, NaN, NaN);
+    }
+    return;
+  }
+
+  const isAbsolute = headerOrSentinel === SENTINEL;
+  const header = isAbsolute ? reader.readUint8("absolute header") : headerOrSentinel;
+
+  if (formatVersion >= FORMAT_V5) {
+    // Both record types hold the same self-contained blocks
+    if (header & FLAG_ACCEL) {
+      decodeXyzPacked(reader, sink.accel, ACCEL_SCALE, "accel");
+    }
+    if (header & FLAG_INCLIN) {
+      decodeXyzPacked(reader, sink.inclin, INCLIN_SCALE, "inclin");
+    }
+    if (header & FLAG_TEMP) {
+      decodeTempAbsolute(reader, state.temp, sink.temp);
+    }
+    return;
+  }
+
+  const decodeXyz = isAbsolute ? decodeXyzAbsolute : decodeXyzDelta;
+
+  if (header & FLAG_ACCEL) {
+    decodeXyz(reader, state.accel, sink.accel, ACCEL_SCALE, "accel");
+  }
+  if (header & FLAG_INCLIN) {
+    decodeXyz(reader, state.inclin, sink.inclin, INCLIN_SCALE, "inclin");
+  }
+  if (header & FLAG_TEMP) {
+    if (isAbsolute) {
+      decodeTempAbsolute(reader, state.temp, sink.temp);
+    } else {
+      decodeTempDelta(reader, state.temp, sink.temp);
+    }
+  }
+}
+
+// Decodes a V3 to V5 storage file pushed in chunks. A record cut by a chunk
+// boundary is decoded again once the rest has arrived; one cut by the end of
+// the file (an hour still being written) ends the decode.
+export class StorageFileDecoder {
+  readonly sink: SampleSink;
+  private pending: Uint8Array | null = null;
+  private formatVersion = 0;
+  private state = freshDecodeState();
+
+  constructor(onBatch: (batch: ColumnBatch) => void, batchSamples = BATCH_SAMPLES) {
+    this.sink = new SampleSink(onBatch, batchSamples);
+  }
+
+  push(chunk: Uint8Array) {
+    const bytes = joinPending(this.pending, chunk);
+    const reader = new BinaryReader(bytes);
+
+    if (this.formatVersion === 0) {
+      if (bytes.length === 0) {
+        return;
+      }
+      const formatVersion = reader.readUint8("file format version");
+      if (formatVersion !== FORMAT_V3 && formatVersion !== FORMAT_V4 && formatVersion !== FORMAT_V5) {
+        throw new Error(
+          `Unsupported decoder format version ${formatVersion}. Expected V3, V4 or V5.`
+        );
+      }
+      this.formatVersion = formatVersion;
+    }
+
+    while (reader.hasRemaining()) {
+      const start = reader.offset;
+      const saved = copyDecodeState(this.state);
+      const mark = this.sink.mark();
+      try {
+        decodeRecord(reader, this.state, this.sink, this.formatVersion);
+      } catch (error) {
+        if (!isTruncatedTailError(error)) {
+          throw error;
+        }
+        this.state = saved;
+        this.sink.rollback(mark);
+        this.pending = bytes.slice(start);
+        return;
+      }
+      this.sink.endRecord();
+    }
+    this.pending = null;
+  }
+
+  finish() {
+    if (this.pending) {
+      console.warn(
+        `Decoder stopped at truncated record #${this.sink.records}: ${this.pending.length} byte(s) left.`
+      );
+      this.pending = null;
+    }
+    this.sink.flush();
+  }
+}
+
+function isFiniteNumber(value: unknown): value is number {
+  return typeof value === "number" && Number.isFinite(value);
+}
+
+function normalizeNumericValue(value: unknown): number | null {
+  if (value == null) {
+    return null;
+  }
+
+  if (typeof value === "number") {
+    return Number.isFinite(value) ? value : null;
+  }
+
+  if (typeof value === "string") {
+    const trimmed = value.trim();
+    if (!trimmed) {
+      return null;
+    }
+
+    const parsed = Number(trimmed);
+    return Number.isFinite(parsed) ? parsed : null;
+  }
+
+  return null;
+}
+
+function isTimestampLike(value: unknown) {
+  if (typeof value === "string") {
+    const trimmed = value.trim();
+    if (!trimmed) {
+      return false;
+    }
+
+    if (!Number.isNaN(Date.parse(trimmed))) {
+      return true;
+    }
+
+    return Number.isFinite(Number(trimmed));
+  }
+
+  return isFiniteNumber(value);
+}
+
+function parseTimestampValueToUs(value: unknown, fallbackUs: number) {
+  if (typeof value === "string") {
+    const trimmed = value.trim();
+    if (!trimmed) {
+      return fallbackUs;
+    }
+
+    const parsedDate = Date.parse(trimmed);
+    if (!Number.isNaN(parsedDate)) {
+      return Math.trunc(parsedDate * 1000);
+    }
+
+    const numeric = Number(trimmed);
+    if (!Number.isFinite(numeric)) {
+      return fallbackUs;
+    }
+
+    return parseTimestampValueToUs(numeric, fallbackUs);
+  }
+
+  if (!isFiniteNumber(value)) {
+    return fallbackUs;
+  }
+
+  if (value >= 1e14) {
+    return Math.trunc(value);
+  }
+
+  if (value >= 1e11) {
+    return Math.trunc(value * 1000);
+  }
+
+  if (value >= 1e9) {
+    return Math.trunc(value * TS_SCALE);
+  }
+
+  return fallbackUs;
+}
+
+function parseRawPacketTimestampUs(packet: Record<string, unknown>, fallbackUs: number) {
+  const packetTs = packet.t ?? packet.ts ?? packet.timestamp;
+  return parseTimestampValueToUs(packetTs, fallbackUs);
+}
+
+function buildRawAccelSample(sample: unknown[], fallbackUs: number): AccelSample | null {
+  if (sample.length >= 4 && isTimestampLike(sample[0])) {
+    return {
+      tsUs: parseTimestampValueToUs(sample[0], fallbackUs),
+      x: normalizeNumericValue(sample[1]),
+      y: normalizeNumericValue(sample[2]),
+      z: normalizeNumericValue(sample[3]),
+    };
+  }
+
+  if (sample.length >= 3) {
+    return {
+      tsUs: fallbackUs,
+      x: normalizeNumericValue(sample[0]),
+      y: normalizeNumericValue(sample[1]),
+      z: normalizeNumericValue(sample[2]),
+    };
+  }
+
+  return null;
+}
+
+function buildRawInclinSample(sample: unknown[], fallbackUs: number): InclinSample | null {
+  if (sample.length >= 4 && isTimestampLike(sample[0])) {
+    return {
+      tsUs: parseTimestampValueToUs(sample[0], fallbackUs),
+      roll: normalizeNumericValue(sample[1]),
+      pitch: normalizeNumericValue(sample[2]),
+      yaw: normalizeNumericValue(sample[3]),
+    };
+  }
+
+  if (sample.length >= 3) {
+    return {
+      tsUs: fallbackUs,
+      roll: normalizeNumericValue(sample[0]),
+      pitch: normalizeNumericValue(sample[1]),
+      yaw: normalizeNumericValue(sample[2]),
+    };
+  }
+
+  return null;
+}
+
+function buildRawTempSample(value: unknown, fallbackUs: number): TempSample | null {
+  if (value == null) {
+    return null;
+  }
+
+  if (Array.isArray(value)) {
+    if (value.length >= 2 && isTimestampLike(value[0])) {
+      return {
+        tsUs: parseTimestampValueToUs(value[0], fallbackUs),
+        tempC: normalizeNumericValue(value[1]),
+      };
+    }
+
+    if (value.length >= 1) {
+      return {
+        tsUs: fallbackUs,
+        tempC: normalizeNumericValue(value[value.length - 1]),
+      };
+    }
+
+    return null;
+  }
+
+  return {
+    tsUs: fallbackUs,
+    tempC: normalizeNumericValue(value),
+  };
+}
+
+// A single [ts?, a, b, c] sample or a list of them.
+function normalizeRawSampleEntries(value: unknown): unknown[][] {
+  if (!Array.isArray(value) || value.length === 0) {
+    return [];
+  }
+
+  if (Array.isArray(value[0])) {
+    return value.filter((entry): entry is unknown[] => Array.isArray(entry));
+  }
+
+  return [value];
+}
+
+// Decodes a raw backup (.rawbin: recv_ns(Q) length(I) JSON payload frames)
+// pushed in chunks. Payloads that do not parse are skipped.
+export class RawArchiveDecoder {
+  readonly sink: SampleSink;
+  private pending: Uint8Array | null = null;
+  private textDecoder = new TextDecoder();
+  private frameIndex = 0;
+
+  constructor(onBatch: (batch: ColumnBatch) => void, batchSamples = BATCH_SAMPLES) {
+    this.sink = new SampleSink(onBatch, batchSamples);
+  }
+
+  push(chunk: Uint8Array) {
+    const bytes = joinPending(this.pending, chunk);
+    const reader = new BinaryReader(bytes);
+
+    while (reader.hasRemaining()) {
+      const start = reader.offset;
+      let recvNs: number;
+      let payload: Uint8Array;
+      try {
+        recvNs = reader.readUint64("raw receive timestamp");
+        const payloadLength = reader.readUint32("raw payload length");
+        payload = reader.readBytes(payloadLength, "raw payload");
+      } catch (error) {
+        if (!isTruncatedTailError(error)) {
+          throw error;
+        }
+        this.pending = bytes.slice(start);
+        return;
+      }
+      this.decodeFrame(payload, recvNs);
+    }
+    this.pending = null;
+  }
+
+  private decodeFrame(payload: Uint8Array, recvNs: number) {
+    const sink = this.sink;
+    const mark = sink.mark();
+
+    try {
+      const fallbackUs = Math.trunc(recvNs / 1000);
+      const packet = JSON.parse(this.textDecoder.decode(payload)) as Record<string, unknown>;
+      const packetTsUs = parseRawPacketTimestampUs(packet, fallbackUs);
+
+      for (const entry of normalizeRawSampleEntries(packet.a)) {
+        const sample = buildRawAccelSample(entry, packetTsUs);
+        if (sample) {
+          sink.accel.push(sample.tsUs, sample.x ?? NaN, sample.y ?? NaN, sample.z ?? NaN);
+        }
+      }
+
+      for (const entry of normalizeRawSampleEntries(packet.i)) {
+        const sample = buildRawInclinSample(entry, packetTsUs);
+        if (sample) {
+          sink.inclin.push(sample.tsUs, sample.roll ?? NaN, sample.pitch ?? NaN, sample.yaw ?? NaN);
+        }
+      }
+
+      // A sensor outage is one "g" entry; it decodes as one empty row
+      if (Array.isArray(packet.g)) {
+        for (const gap of packet.g) {
+          if (!Array.isArray(gap) || gap.length < 3 || !isTimestampLike(gap[0])) {
+            continue;
+          }
+          const tsUs = parseTimestampValueToUs(gap[0], packetTsUs);
+          if (gap[2] === "a") {
+            sink.accel.push(tsUs, NaN, NaN, NaN);
+          } else if (gap[2] === "i") {
+            sink.inclin.push(tsUs, NaN, NaN, NaN);
+          }
+        }
+      }
+
+      const temp = buildRawTempSample(packet.T, packetTsUs);
+      if (temp) {
+        sink.temp.push(temp.tsUs, temp.tempC ?? NaN);
+      }
+    } catch (error) {
+      sink.rollback(mark);
+      console.warn(
+        `Raw decoder skipped record #${this.frameIndex}: ${
+          error instanceof Error ? error.message : String(error)
+        }`
+      );
+    }
+
+    this.frameIndex += 1;
+    if (sink.pending > mark[0] + mark[1] + mark[2]) {
+      sink.endRecord();
+    }
+  }
+
+  finish() {
+    if (this.pending) {
+      console.warn(
+        `Raw decoder stopped at truncated record #${this.frameIndex}: ${this.pending.length} byte(s) left.`
+      );
+      this.pending = null;
+    }
+    this.sink.flush();
+  }
+}
+
+function formatTimestampIso(tsUs: number) {
+  return new Date(tsUs / 1000).toISOString();
+}
+
+function formatOptionalValue(value: number, decimals: number) {
+  return Number.isNaN(value) ? "" : value.toFixed(decimals);
+}
+
+// One CSV output built from formatted batches.
+class CsvFile {
+  readonly fileName: string;
+  private parts: BlobPart[];
+
+  constructor(fileName: string, header: string) {
+    this.fileName = fileName;
+    this.parts = [`${header}\n`];
+  }
+
+  append(lines: string[]) {
+    if (lines.length === 0) {
+      return;
+    }
+    this.parts.push(`${lines.join("\n")}\n`);
+    if (this.parts.length >= CSV_FOLD_PARTS) {
+      this.parts = [new Blob(this.parts)];
+    }
+  }
+
+  output(): CsvOutput {
+    return {
+      fileName: this.fileName,
+      blob: new Blob(this.parts, { type: CSV_TYPE }),
+    };
+  }
+}
+
+export type CsvWriter = {
+  write(batch: ColumnBatch): void;
+  finish(records: number): CsvOutput[];
+};
+
+// One CSV per sensor that has samples.
+class SensorCsvWriter implements CsvWriter {
+  private readonly baseName: string;
+  private files: Partial<Record<SensorKind, CsvFile>> = {};
+
+  constructor(baseName: string) {
+    this.baseName = baseName;
+  }
+
+  write(batch: ColumnBatch) {
+    for (const kind of SENSOR_KINDS) {
+      const columns = batch[kind];
+      if (columns.length === 0) {
+        continue;
+      }
+
+      const { suffix, header, decimals } = SENSOR_CSV[kind];
+      const file = (this.files[kind] ??= new CsvFile(`${this.baseName}${suffix}`, header));
+      const lines: string[] = [];
+      for (let index = 0; index < columns.length; index += 1) {
+        const tsUs = columns.tsUs[index];
+        const fields = [formatTimestampIso(tsUs), tsUs.toString()];
+        for (const column of columns.values) {
+          fields.push(formatOptionalValue(column[index], decimals));
+        }
+        lines.push(fields.join(","));
+      }
+      file.append(lines);
+    }
+  }
+
+  finish() {
+    const outputs: CsvOutput[] = [];
+    for (const kind of SENSOR_KINDS) {
+      const file = this.files[kind];
+      if (file) {
+        outputs.push(file.output());
+      }
+    }
+    return outputs;
+  }
+}
+
+function concatColumns(a: SensorColumns, b: SensorColumns): SensorColumns {
+  if (a.length === 0) return b;
+  if (b.length === 0) return a;
+
+  const length = a.length + b.length;
+  const join = (x: Float64Array, y: Float64Array) => {
+    const out = new Float64Array(length);
+    out.set(x);
+    out.set(y, x.length);
+    return out;
+  };
+  return {
+    length,
+    tsUs: join(a.tsUs, b.tsUs),
+    values: a.values.map((column, axis) => join(column, b.values[axis])),
+  };
+}
+
+function columnsAfter(columns: SensorColumns, watermark: number): SensorColumns {
+  const keep: number[] = [];
+  for (let index = 0; index < columns.length; index += 1) {
+    if (columns.tsUs[index] > watermark) {
+      keep.push(index);
+    }
+  }
+  const pick = (column: Float64Array) => Float64Array.from(keep, (index) => column[index]);
+  return {
+    length: keep.length,
+    tsUs: pick(columns.tsUs),
+    values: columns.values.map(pick),
+  };
+}
+
+// One CSV of all sensors ordered by timestamp. Batches are merged as they
+// arrive: rows up to the earliest of the sensors' last timestamps in a batch
+// are final, later ones may still interleave with the next batch and wait.
+class NodeCsvWriter implements CsvWriter {
+  private readonly file: CsvFile;
+  private carry: ColumnBatch | null = null;
+
+  constructor(baseName: string) {
+    this.file = new CsvFile(`${baseName}.csv`, NODE_CSV_HEADER);
+  }
+
+  write(batch: ColumnBatch) {
+    let watermark = Infinity;
+    for (const kind of SENSOR_KINDS) {
+      const columns = batch[kind];
+      if (columns.length > 0) {
+        watermark = Math.min(watermark, columns.tsUs[columns.length - 1]);
+      }
+    }
+
+    const carry = this.carry;
+    const merged: ColumnBatch = carry
+      ? {
+          accel: concatColumns(carry.accel, batch.accel),
+          inclin: concatColumns(carry.inclin, batch.inclin),
+          temp: concatColumns(carry.temp, batch.temp),
+        }
+      : batch;
+    this.writeRows(merged, watermark);
+    this.carry = {
+      accel: columnsAfter(merged.accel, watermark),
+      inclin: columnsAfter(merged.inclin, watermark),
+      temp: columnsAfter(merged.temp, watermark),
+    };
+  }
+
+  private writeRows(batch: ColumnBatch, watermark: number) {
+    const rows: [number, SensorKind, number][] = [];
+    for (const kind of SENSOR_KINDS) {
+      const { tsUs, length } = batch[kind];
+      for (let index = 0; index < length; index += 1) {
+        if (tsUs[index] <= watermark) {
+          rows.push([tsUs[index], kind, index]);
+        }
+      }
+    }
+    rows.sort((a, b) => a[0] - b[0]);
+
+    const lines: string[] = [];
+    for (const [tsUs, kind, index] of rows) {
+      const values = batch[kind].values;
+      const xyz = kind === "accel" ? values : null;
+      const rpy = kind === "inclin" ? values : null;
+      const temp = kind === "temp" ? values[0][index] : NaN;
+      lines.push(
+        [
+          formatTimestampIso(tsUs),
+          tsUs.toString(),
+          NODE_SENSOR_TYPES[kind],
+          formatOptionalValue(xyz ? xyz[0][index] : NaN, 4),
+          formatOptionalValue(xyz ? xyz[1][index] : NaN, 4),
+          formatOptionalValue(xyz ? xyz[2][index] : NaN, 4),
+          formatOptionalValue(rpy ? rpy[0][index] : NaN, 4),
+          formatOptionalValue(rpy ? rpy[1][index] : NaN, 4),
+          formatOptionalValue(rpy ? rpy[2][index] : NaN, 4),
+          formatOptionalValue(temp, 2),
+        ].join(",")
+      );
+    }
+    this.file.append(lines);
+  }
+
+  finish(records: number) {
+    if (this.carry) {
+      this.writeRows(this.carry, Infinity);
+      this.carry = null;
+    }
+    return records > 0 ? [this.file.output()] : [];
+  }
+}
+
+export function createCsvWriter(baseName: string, outputMode: DecodeOutputMode): CsvWriter {
+  return outputMode === "node" ? new NodeCsvWriter(baseName) : new SensorCsvWriter(baseName);
+}
@@ -0,0 +1,201 @@
+// Decoder page worker. Streams each queued file (through gzip for .bin.gz)
+// into the chunked decoders of decoderCore.ts, writes the CSV output as Blobs
+// and returns a single CSV or a ZIP, so the page stays responsive whatever
+// the file size. The page cancels a run by terminating the worker.
+import JSZip from "jszip";
+import {
+  createCsvWriter,
+  RawArchiveDecoder,
+  StorageFileDecoder,
+  type CsvOutput,
+  type DecodeFailure,
+  type DecodeOutputMode,
+  type DecodeSuccess,
+  type ProgressSnapshot,
+} from "./decoderCore";
+
+export type DecoderWorkerEntry = {
+  file: File;
+  entryName: string;
+  displayName: string;
+};
+
+export type DecoderWorkerRequest = {
+  entries: DecoderWorkerEntry[];
+  outputMode: DecodeOutputMode;
+};
+
+export type DecoderWorkerMessage =
+  | { type: "progress"; progress: ProgressSnapshot }
+  | {
+      type: "done";
+      successes: DecodeSuccess[];
+      failures: DecodeFailure[];
+      artifact: CsvOutput | null;
+    }
+  | { type: "error"; message: string };
+
+const PROGRESS_INTERVAL_MS = 100;
+
+function post(message: DecoderWorkerMessage) {
+  self.postMessage(message);
+}
+
+// Strip only the known decoder file suffixes from output names.
+function normalizeRawOutputBaseName(name: string) {
+  return name
+    .replace(/\.bin\.gz$/i, "")
+    .replace(/\.rawbin$/i, "")
+    .replace(/\.bin$/i, "");
+}
+
+// Decode one file as it is read; onRead gets the (compressed) bytes read.
+async function decodeEntryToCsv(
+  entry: DecoderWorkerEntry,
+  outputMode: DecodeOutputMode,
+  onRead: (bytesRead: number) => void
+): Promise<CsvOutput[]> {
+  let bytesRead = 0;
+  let stream: ReadableStream<Uint8Array<ArrayBuffer>> = entry.file.stream().pipeThrough(
+    new TransformStream<Uint8Array<ArrayBuffer>, Uint8Array<ArrayBuffer>>({
+      transform(chunk, controller) {
+        bytesRead += chunk.byteLength;
+        onRead(bytesRead);
+        controller.enqueue(chunk);
+      },
+    })
+  );
+
+  if (entry.entryName.toLowerCase().endsWith(".bin.gz")) {
+    if (typeof DecompressionStream === "undefined") {
+      throw new Error(
+        "This browser does not support gzip decompression in the decoder page."
+      );
+    }
+    stream = stream.pipeThrough(new DecompressionStream("gzip"));
+  }
+
+  const writer = createCsvWriter(normalizeRawOutputBaseName(entry.entryName), outputMode);
+  const onBatch = writer.write.bind(writer);
+  const decoder = entry.entryName.toLowerCase().endsWith(".rawbin")
+    ? new RawArchiveDecoder(onBatch)
+    : new StorageFileDecoder(onBatch);
+
+  const reader = stream.getReader();
+  for (;;) {
+    const { done, value } = await reader.read();
+    if (done) {
+      break;
+    }
+    decoder.push(value);
+  }
+  decoder.finish();
+  return writer.finish(decoder.sink.records);
+}
+
+// Return a single CSV or a ZIP depending on how many files were generated.
+async function buildDownloadArtifact(
+  outputs: CsvOutput[],
+  outputMode: DecodeOutputMode
+): Promise<CsvOutput> {
+  if (outputs.length === 1) {
+    return outputs[0];
+  }
+
+  const zip = new JSZip();
+  for (const output of outputs) {
+    zip.file(output.fileName, output.blob);
+  }
+
+  return {
+    fileName: `decoded_${outputMode}_csv_${new Date()
+      .toISOString()
+      .slice(0, 10)}.zip`,
+    blob: await zip.generateAsync({ type: "blob" }),
+  };
+}
+
+async function decodeEntries({ entries, outputMode }: DecoderWorkerRequest) {
+  const successes: DecodeSuccess[] = [];
+  const failures: DecodeFailure[] = [];
+  const outputs: CsvOutput[] = [];
+  const total = entries.length;
+  let lastProgressAt = 0;
+
+  // fraction: how far into file `completed` the decode is, by bytes read
+  const emitProgress = (
+    phase: ProgressSnapshot["phase"],
+    completed: number,
+    fraction: number,
+    currentLabel: string,
+    force = false
+  ) => {
+    const now = performance.now();
+    if (!force && now - lastProgressAt < PROGRESS_INTERVAL_MS) {
+      return;
+    }
+    lastProgressAt = now;
+    const done = Math.min(total, completed + fraction);
+    post({
+      type: "progress",
+      progress: {
+        phase,
+        completed,
+        total,
+        percent: total > 0 ? Math.round((done / total) * 100) : 0,
+        currentLabel,
+      },
+    });
+  };
+
+  for (let index = 0; index < entries.length; index += 1) {
+    const entry = entries[index];
+    const size = entry.file.size;
+    emitProgress("decoding", index, 0, entry.displayName, true);
+
+    try {
+      const entryOutputs = await decodeEntryToCsv(entry, outputMode, (bytesRead) =>
+        emitProgress("decoding", index, size > 0 ? bytesRead / size : 0, entry.displayName)
+      );
+
+      if (entryOutputs.length === 0) {
+        failures.push({
+          entryName: entry.entryName,
+          reason: "Decoder returned no CSV files.",
+        });
+      } else {
+        successes.push({
+          entryName: entry.entryName,
+          outputFiles: entryOutputs.map((output) => ({
+            fileName: output.fileName,
+            bytes: output.blob.size,
+          })),
+        });
+        outputs.push(...entryOutputs);
+      }
+    } catch (error) {
+      failures.push({
+        entryName: entry.entryName,
+        reason:
+          error instanceof Error ? error.message : "Unknown decode error.",
+      });
+    }
+  }
+
+  let artifact: CsvOutput | null = null;
+  if (outputs.length > 0) {
+    emitProgress("packaging", total, 0, "Preparing CSV download", true);
+    artifact = await buildDownloadArtifact(outputs, outputMode);
+  }
+
+  post({ type: "done", successes, failures, artifact });
+}
+
+self.onmessage = (event: MessageEvent<DecoderWorkerRequest>) => {
+  decodeEntries(event.data).catch((error: unknown) => {
+    post({
+      type: "error",
+      message: error instanceof Error ? error.message : "Decoding failed.",
+    });
+  });
+};
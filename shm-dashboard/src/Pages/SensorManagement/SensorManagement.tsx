@@ -19,13 +19,15 @@ import {
   getNodes,
   getFaults,
   getFaultSummary,
-  getNodeSensorStatus,
+  plotRowCount,
+  plotWindowFromJson,
+  plotWindowToJson,
   type ApiResponse,
   type FaultRow,
   type NodeRecord,
   type FaultSummaryResponse,
-  type NodeSensorStatusResponse,
 } from "../../services/api";
+import { subscribeFleetStatus } from "../../services/fleetStatus";
 
 import {
   UI_PREVIEW_MODE,
@@ -42,7 +44,6 @@ import "./SensorManagement.css";
 
 const SETTINGS_CACHE_KEY = "shm_settings_cache";
 const PLOT_CACHE_KEY = "shm_plot_cache";
-const SENSOR_STATUS_POLL_MS = 5000;
 const PLOT_AUTO_REFRESH_MS = 5000;
 
 type PlotCacheRecord = {
@@ -199,7 +200,7 @@ function loadPlotCache(): Record<string, PlotCacheRecord> {
   try {
     const raw = localStorage.getItem(PLOT_CACHE_KEY);
     if (!raw) return {};
-    const parsed = JSON.parse(raw);
+    const parsed = JSON.parse(raw, plotCacheReviver);
     if (!parsed || typeof parsed !== "object") return {};
     return parsed as Record<string, PlotCacheRecord>;
   } catch {
@@ -207,9 +208,18 @@ function loadPlotCache(): Record<string, PlotCacheRecord> {
   }
 }
 
+// Typed plot columns are kept as plain arrays in local storage.
+function plotCacheReplacer(key: string, value: any) {
+  return key === "columns" && value ? plotWindowToJson(value) : value;
+}
+
+function plotCacheReviver(key: string, value: any) {
+  return key === "columns" && value ? plotWindowFromJson(value) : value;
+}
+
 // Check whether an API plot response contains usable data points.
 function hasPlotPoints(data: ApiResponse | null): boolean {
-  return !!data && Array.isArray(data.points) && data.points.length > 0;
+  return !!data && Array.isArray(data.points) && plotRowCount(data) > 0;
 }
 
 // Save one plot response into local cache.
@@ -217,7 +227,7 @@ function savePlotCacheEntry(key: string, data: ApiResponse) {
   try {
     const all = loadPlotCache();
     all[key] = { savedAt: new Date().toISOString(), data };
-    localStorage.setItem(PLOT_CACHE_KEY, JSON.stringify(all));
+    localStorage.setItem(PLOT_CACHE_KEY, JSON.stringify(all, plotCacheReplacer));
   } catch {
     // Ignore cache write failures.
   }
@@ -767,7 +777,7 @@ export default function SensorManagement() {
     }
   }, [sensor, timeframeMin]);
 
-    // Load backend-driven per-sensor status so each sensor can be independent of node status.
+    // Backend-driven per-sensor status (shared fleet status poller), so each sensor can be independent of node status.
   useEffect(() => {
     if (!selectedNode) {
       setSensorStatusMap(buildFallbackSensorStatus(false, []));
@@ -781,23 +791,17 @@ export default function SensorManagement() {
       return;
     }
 
-    const controller = new AbortController();
     const currentNode = selectedNode;
-    let cancelled = false;
-    let loading = false;
-
-    async function loadSensorStatuses() {
-      if (loading) return;
-      loading = true;
 
-      try {
-        const res: NodeSensorStatusResponse = await getNodeSensorStatus(
-          currentNode.node_id,
-          120,
-          controller.signal
-        );
-
-        if (cancelled) return;
+    return subscribeFleetStatus(
+      (fleet) => {
+        const res = fleet.get(currentNode.node_id);
+        if (!res) {
+          setSensorStatusMap(
+            buildFallbackSensorStatus(currentNode.online, nodeFaults)
+          );
+          return;
+        }
 
         setSensorStatusMap({
           accelerometer: {
@@ -825,28 +829,14 @@ export default function SensorManagement() {
               res.sensors.temperature.active_faults?.[0]?.description ?? null,
           },
         });
-      } catch (e) {
-        if (cancelled) return;
+      },
+      (e) => {
         console.error("Sensor status load failed:", e);
         setSensorStatusMap(
           buildFallbackSensorStatus(currentNode.online, nodeFaults)
         );
-      } finally {
-        loading = false;
       }
-    }
-
-    void loadSensorStatuses();
-
-    const intervalId = window.setInterval(() => {
-      void loadSensorStatuses();
-    }, SENSOR_STATUS_POLL_MS);
-
-    return () => {
-      cancelled = true;
-      controller.abort();
-      window.clearInterval(intervalId);
-    };
+    );
   }, [selectedNode, nodeFaults]);
 
   // Manually refresh the currently selected plot from the backend.
@@ -1127,6 +1117,7 @@ export default function SensorManagement() {
                     title={`${selectedSensorDef.label} (${selectedNode.serial})`}
                     data={apiData}
                     height={420}
+                    node={UI_PREVIEW_MODE ? undefined : nodeId}
                     onZoomStateChange={setIsPlotPaused}
                   />
                 ) : (
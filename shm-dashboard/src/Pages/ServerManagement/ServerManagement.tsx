@@ -4,6 +4,7 @@ import InfoTooltip from "../../components/InfoToolTip/InfoToolTip";
 import {
   clearFaults,
   getHealth,
+  getMetricsSummary,
   getServerNetwork,
   getServerStatus,
   getStorage,
@@ -15,6 +16,8 @@ import {
   restartMqttService,
   unmountStorage,
   type HealthResponse,
+  type MetricSummary,
+  type MetricsSummaryResponse,
   type ServerActionResponse,
   type ServerNetworkResponse,
   type ServerStatusResponse,
@@ -64,6 +67,37 @@ function formatUptime(totalSeconds: unknown) {
   return parts.join(" ");
 }
 
+// "shm_storage_encode_seconds" -> "storage encode"; units show in the value
+function formatMetricName(name: string) {
+  return name
+    .replace(/^shm_/, "")
+    .replace(/_(seconds|total)$/, "")
+    .replace(/_/g, " ");
+}
+
+function formatMetricNumber(name: string, value: number | null | undefined) {
+  if (value === null) return "> max";
+  if (value === undefined || !Number.isFinite(value)) return "—";
+  if (/_seconds$/.test(name)) {
+    return value < 1 ? `${(value * 1000).toFixed(value < 0.01 ? 2 : 1)} ms` : `${value.toFixed(2)} s`;
+  }
+  if (/_bytes(_|$)/.test(name)) {
+    return `${(value / (1024 * 1024)).toFixed(1)} MB`;
+  }
+  return Math.round(value).toLocaleString();
+}
+
+function formatMetricValue(metric: MetricSummary) {
+  if (metric.kind !== "histogram") {
+    return formatMetricNumber(metric.name, metric.value);
+  }
+  if (!metric.count) return "No samples";
+  return `p50 ${formatMetricNumber(metric.name, metric.p50)} · p95 ${formatMetricNumber(
+    metric.name,
+    metric.p95
+  )}`;
+}
+
 type BackendHealthBadgeState = "OK" | "OFFLINE";
 
 function getBackendStateFromSources(
@@ -123,6 +157,8 @@ export default function ServerManagementPage() {
   const [storage, setStorage] = useState<StorageResponse | null>(null);
   const [storageStatus, setStorageStatus] =
     useState<StorageStatusResponse | null>(null);
+  const [metricsSummary, setMetricsSummary] =
+    useState<MetricsSummaryResponse | null>(null);
 
   const [loading, setLoading] = useState(true);
   const [pageError, setPageError] = useState("");
@@ -139,6 +175,7 @@ export default function ServerManagementPage() {
       getServerNetwork(signal),
       getStorage(signal),
       getStorageStatus(signal),
+      getMetricsSummary(signal),
     ]);
 
     const errors: string[] = [];
@@ -149,6 +186,7 @@ export default function ServerManagementPage() {
       networkResult,
       storageResult,
       storageStatusResult,
+      metricsResult,
     ] = results;
 
     if (healthResult.status === "fulfilled") {
@@ -186,6 +224,13 @@ export default function ServerManagementPage() {
       errors.push("Storage status endpoint unavailable.");
     }
 
+    if (metricsResult.status === "fulfilled") {
+      setMetricsSummary(metricsResult.value);
+    } else {
+      setMetricsSummary(null);
+      errors.push("Metrics endpoint unavailable.");
+    }
+
     setPageError(errors.join(" "));
   }, []);
 
@@ -430,6 +475,48 @@ export default function ServerManagementPage() {
           </div>
         </article>
 
+        <article className="server-card server-card-span-2">
+          <div className="server-card-header">
+            <div>
+              <p className="server-card-kicker">Performance</p>
+              <h2 className="server-card-title">Pipeline Metrics</h2>
+            </div>
+
+            <InfoTooltip
+              label="More information about Pipeline Metrics"
+              content="Ingest and query hot-path timings, queue depths and counts since each process started, summed over nodes and listener processes. Timings show the p50 / p95 bucket. The full series are at /metrics for Prometheus."
+            />
+          </div>
+
+          <div className="server-metric-grid">
+            {(metricsSummary?.metrics ?? [])
+              .filter((metric) => metric.series > 0)
+              .map((metric) => (
+                <div
+                  className="server-metric"
+                  key={metric.name}
+                  title={metric.help}
+                >
+                  <span className="server-metric-label">
+                    {formatMetricName(metric.name)}
+                  </span>
+                  <strong className="server-metric-value">
+                    {formatMetricValue(metric)}
+                  </strong>
+                </div>
+              ))}
+          </div>
+
+          <div className="server-detail-list">
+            <div className="server-detail-row">
+              <span className="server-detail-label">Last Listener Update</span>
+              <span className="server-detail-value">
+                {formatDateTime(metricsSummary?.updated_at)}
+              </span>
+            </div>
+          </div>
+        </article>
+
         <article className="server-card">
           <div className="server-card-header">
             <div>
@@ -129,11 +129,13 @@ export default function FaultLog({
       }
     }
 
-    // Open an SSE connection for live fault updates.
-    function connectFaultLogSSE() {
+    // Open an SSE connection for live fault updates. A reconnect resumes
+    // from the last fault id seen, so the backend only sends what was missed.
+    function connectFaultLogSSE(resumeFromId = 0) {
       const params = new URLSearchParams();
       if (serial_number) params.set("serial_number", serial_number);
       params.set("limit", String(limit));
+      if (resumeFromId > 0) params.set("last_id", String(resumeFromId));
 
       const query = params.toString();
 
@@ -185,11 +187,13 @@ export default function FaultLog({
         setLoading(false);
         setError("Fault log connection lost — retrying...");
 
-        // Try a REST refresh first, then reopen SSE after a short delay.
+        // Reopen SSE after a short delay, catching up from the last fault
+        // id; without one, try a REST refresh first.
         reconnectTimeoutId = window.setTimeout(() => {
           if (!mounted) return;
-          void loadFaultsFallback();
-          connectFaultLogSSE();
+          const resumeFromId = lastFaultIdRef.current;
+          if (resumeFromId <= 0) void loadFaultsFallback();
+          connectFaultLogSSE(resumeFromId);
         }, 3000);
       };
     }
@@ -0,0 +1,77 @@
+import { useEffect, useImperativeHandle, useRef, type Ref } from "react";
+
+import type { TraceLayer } from "./glTrace";
+import { GlTraceController, type DetailFetcher } from "./glTraceController";
+
+export type GlTracePlotHandle = {
+  resetZoom: () => void;
+};
+
+type Props = {
+  layer: TraceLayer | null;
+  color: string;
+  yAxisLabel: string;
+  fetchDetail?: DetailFetcher;
+  onZoomChange?: (zoomed: boolean) => void;
+  ref?: Ref<GlTracePlotHandle>;
+};
+
+// One WebGL trace with its axes; see glTraceController.ts.
+export default function GlTracePlot({
+  layer,
+  color,
+  yAxisLabel,
+  fetchDetail,
+  onZoomChange,
+  ref,
+}: Props) {
+  const shellRef = useRef<HTMLDivElement>(null);
+  const glCanvasRef = useRef<HTMLCanvasElement>(null);
+  const axisCanvasRef = useRef<HTMLCanvasElement>(null);
+  const tooltipRef = useRef<HTMLDivElement>(null);
+  const statusRef = useRef<HTMLDivElement>(null);
+  const controllerRef = useRef<GlTraceController | null>(null);
+
+  useEffect(() => {
+    const shell = shellRef.current;
+    const glCanvas = glCanvasRef.current;
+    const axisCanvas = axisCanvasRef.current;
+    const tooltip = tooltipRef.current;
+    const status = statusRef.current;
+    if (!shell || !glCanvas || !axisCanvas || !tooltip || !status) return;
+
+    const controller = new GlTraceController(
+      { shell, glCanvas, axisCanvas, tooltip, status },
+      color
+    );
+    controllerRef.current = controller;
+    return () => {
+      controller.dispose();
+      controllerRef.current = null;
+    };
+  }, [color]);
+
+  // color: a new controller needs its options and data again
+  useEffect(() => {
+    controllerRef.current?.setOptions({ yAxisLabel, fetchDetail, onZoomChange });
+  }, [color, yAxisLabel, fetchDetail, onZoomChange]);
+
+  useEffect(() => {
+    controllerRef.current?.setOverview(layer);
+  }, [color, layer]);
+
+  useImperativeHandle(ref, () => ({
+    resetZoom() {
+      controllerRef.current?.resetZoom();
+    },
+  }), []);
+
+  return (
+    <div ref={shellRef} className="sp-gl-shell">
+      <canvas ref={glCanvasRef} className="sp-gl-trace" />
+      <canvas ref={axisCanvasRef} className="sp-gl-axes" />
+      <div ref={tooltipRef} className="sp-gl-tooltip" />
+      <div ref={statusRef} className="sp-gl-status" />
+    </div>
+  );
+}
@@ -15,12 +15,15 @@ import { Line } from "react-chartjs-2";
 
 import "./SensorPlot.css";
 
-import type {
-  AccelerometerPlotPoint,
-  ApiResponse,
-  InclinometerPlotPoint,
-  TemperaturePlotPoint,
+import {
+  getPlotWindow,
+  type ApiResponse,
+  type PlotWindow,
+  type PlotWindowSensor,
 } from "../../services/api";
+import GlTracePlot, { type GlTracePlotHandle } from "./GlTracePlot";
+import { isWebGlSupported, type TraceLayer } from "./glTrace";
+import type { DetailFetcher } from "./glTraceController";
 
 ChartJS.register(
   PointElement,
@@ -36,17 +39,22 @@ type Props = {
   title: string;
   data: ApiResponse;
   height?: number;
+  // Node the data belongs to; zooming into a WebGL plot fetches finer data
+  // for it from /api/plot/window. Without it the plots only zoom the loaded
+  // points.
+  node?: number;
   onZoomStateChange?: (zoomed: boolean) => void;
 };
 
 type PlotPoint = {
   x: number;
   y: number;
-  ts: string;
+  ts: number;
 };
 
 type SensorDataset = {
   label: string;
+  axis: string;
   data: PlotPoint[];
   borderColor: string;
   backgroundColor: string;
@@ -57,9 +65,10 @@ type SensorDataset = {
   fill: boolean;
 };
 
-function formatTimeLabel(ts: string): string {
-  const date = new Date(ts);
-  if (Number.isNaN(date.getTime())) return ts;
+// ts in epoch seconds
+function formatTimeLabel(ts: number): string {
+  const date = new Date(ts * 1000);
+  if (Number.isNaN(date.getTime())) return "";
   return date.toLocaleTimeString([], {
     hour: "2-digit",
     minute: "2-digit",
@@ -67,28 +76,51 @@ function formatTimeLabel(ts: string): string {
   });
 }
 
-function buildAxisPlotData<T extends { ts: string }>(
-  points: T[],
-  getValue: (point: T) => number | null
-): PlotPoint[] {
-  return points.flatMap((point, index) => {
-    const value = getValue(point);
-    if (value == null) return [];
-    return [
-      {
-        x: index,
-        y: value,
-        ts: point.ts,
-      },
-    ];
-  });
+// Column order of each sensor's axes (backend PYRAMID_AXES).
+const AXES_BY_SENSOR: Record<ApiResponse["sensor"], string[]> = {
+  accelerometer: ["x", "y", "z"],
+  inclinometer: ["roll", "pitch", "yaw"],
+  temperature: ["value"],
+};
+
+// JSON points (a response from before typed columns, e.g. from the plot
+// cache) as columns; <axis>_min / <axis>_max make it a bucket response.
+function pointsToColumns(points: { ts: string }[], axes: string[]): PlotWindow {
+  const rows = points as unknown as Record<string, unknown>[];
+  const buckets = rows.some((row) => typeof row[`${axes[0]}_min`] === "number");
+  const column = (key: string) =>
+    Float32Array.from(rows, (row) => {
+      const value = row[key];
+      return typeof value === "number" ? value : Number.NaN;
+    });
+
+  return {
+    kind: buckets ? "buckets" : "samples",
+    bucketS: 0,
+    ts: Float64Array.from(rows, (row) => Date.parse(String(row.ts)) / 1000),
+    values: axes.map((axis) => column(axis)),
+    mins: buckets ? axes.map((axis) => column(`${axis}_min`)) : null,
+    maxs: buckets ? axes.map((axis) => column(`${axis}_max`)) : null,
+  };
+}
+
+// Chart.js points of one axis; NaN rows (gaps) are left out.
+function buildAxisPlotData(columns: PlotWindow, axis: number): PlotPoint[] {
+  const values = columns.values[axis];
+  const points: PlotPoint[] = [];
+  for (let index = 0; index < values.length; index += 1) {
+    if (Number.isNaN(values[index])) continue;
+    points.push({ x: index, y: values[index], ts: columns.ts[index] });
+  }
+  return points;
 }
 
-function buildAccelerometerDatasets(points: AccelerometerPlotPoint[]): SensorDataset[] {
+function buildAccelerometerDatasets(columns: PlotWindow): SensorDataset[] {
   return [
     {
       label: "X",
-      data: buildAxisPlotData(points, (p) => p.x),
+      axis: "x",
+      data: buildAxisPlotData(columns, 0),
       borderColor: "#2563eb",
       backgroundColor: "#2563eb",
       pointRadius: 0,
@@ -99,7 +131,8 @@ function buildAccelerometerDatasets(points: AccelerometerPlotPoint[]): SensorDat
     },
     {
       label: "Y",
-      data: buildAxisPlotData(points, (p) => p.y),
+      axis: "y",
+      data: buildAxisPlotData(columns, 1),
       borderColor: "#059669",
       backgroundColor: "#059669",
       pointRadius: 0,
@@ -110,7 +143,8 @@ function buildAccelerometerDatasets(points: AccelerometerPlotPoint[]): SensorDat
     },
     {
       label: "Z",
-      data: buildAxisPlotData(points, (p) => p.z),
+      axis: "z",
+      data: buildAxisPlotData(columns, 2),
       borderColor: "#dc2626",
       backgroundColor: "#dc2626",
       pointRadius: 0,
@@ -122,11 +156,12 @@ function buildAccelerometerDatasets(points: AccelerometerPlotPoint[]): SensorDat
   ];
 }
 
-function buildInclinometerDatasets(points: InclinometerPlotPoint[]): SensorDataset[] {
+function buildInclinometerDatasets(columns: PlotWindow): SensorDataset[] {
   return [
     {
       label: "Roll",
-      data: buildAxisPlotData(points, (p) => p.roll),
+      axis: "roll",
+      data: buildAxisPlotData(columns, 0),
       borderColor: "#7c3aed",
       backgroundColor: "#7c3aed",
       pointRadius: 0,
@@ -137,7 +172,8 @@ function buildInclinometerDatasets(points: InclinometerPlotPoint[]): SensorDatas
     },
     {
       label: "Pitch",
-      data: buildAxisPlotData(points, (p) => p.pitch),
+      axis: "pitch",
+      data: buildAxisPlotData(columns, 1),
       borderColor: "#ea580c",
       backgroundColor: "#ea580c",
       pointRadius: 0,
@@ -148,7 +184,8 @@ function buildInclinometerDatasets(points: InclinometerPlotPoint[]): SensorDatas
     },
     {
       label: "Yaw",
-      data: buildAxisPlotData(points, (p) => p.yaw),
+      axis: "yaw",
+      data: buildAxisPlotData(columns, 2),
       borderColor: "#0891b2",
       backgroundColor: "#0891b2",
       pointRadius: 0,
@@ -161,13 +198,14 @@ function buildInclinometerDatasets(points: InclinometerPlotPoint[]): SensorDatas
 }
 
 function buildTemperatureDatasets(
-  points: TemperaturePlotPoint[],
+  columns: PlotWindow,
   unit: string
 ): SensorDataset[] {
   return [
     {
       label: unit ? `Temperature (${unit})` : "Temperature",
-      data: buildAxisPlotData(points, (p) => p.value),
+      axis: "value",
+      data: buildAxisPlotData(columns, 0),
       borderColor: "#d97706",
       backgroundColor: "#d97706",
       pointRadius: 0,
@@ -179,13 +217,62 @@ function buildTemperatureDatasets(
   ];
 }
 
+const PLOT_WINDOW_SENSOR: Record<ApiResponse["sensor"], PlotWindowSensor> = {
+  accelerometer: "accel",
+  inclinometer: "inclin",
+  temperature: "temp",
+};
+
+// The loaded columns of one axis as a WebGL layer. Pyramid and min-max
+// responses carry min / max columns, which become the envelope band.
+function buildTraceLayer(columns: PlotWindow, axis: number): TraceLayer | null {
+  const { ts } = columns;
+  if (ts.length === 0) return null;
+  const t0 = ts[0];
+  const end = ts[ts.length - 1];
+
+  return {
+    t0,
+    x: Float32Array.from(ts, (t) => t - t0),
+    y: columns.values[axis],
+    lo: columns.mins?.[axis] ?? null,
+    hi: columns.maxs?.[axis] ?? null,
+    start: t0,
+    end,
+    resolutionS: ts.length > 1 ? (end - t0) / (ts.length - 1) : 0,
+  };
+}
+
+function buildDetailFetcher(
+  node: number,
+  sensor: PlotWindowSensor,
+  axis: string
+): DetailFetcher {
+  return async (start, end, points, signal) => {
+    const plotWindow = await getPlotWindow(
+      { node, sensor, start, end, points, axis },
+      signal
+    );
+    return {
+      t0: start,
+      x: Float32Array.from(plotWindow.ts, (t) => t - start),
+      y: plotWindow.values[0],
+      lo: plotWindow.mins?.[0] ?? null,
+      hi: plotWindow.maxs?.[0] ?? null,
+      start,
+      end,
+      resolutionS: plotWindow.kind === "samples" ? 0 : plotWindow.bucketS,
+    };
+  };
+}
+
 function buildChartOptions(
-  points: { ts: string }[],
+  ts: Float64Array,
   yAxisLabel: string,
   onViewportChange?: (zoomed: boolean) => void
 ): ChartOptions<"line"> {
-  const maxIndex = Math.max(points.length - 1, 1);
-  const minRange = Math.max(Math.min(points.length - 1, 20), 1);
+  const maxIndex = Math.max(ts.length - 1, 1);
+  const minRange = Math.max(Math.min(ts.length - 1, 20), 1);
 
   return {
     responsive: true,
@@ -251,8 +338,7 @@ function buildChartOptions(
           maxTicksLimit: 8,
           callback(value) {
             const index = Math.round(Number(value));
-            const point = points[index];
-            return point ? formatTimeLabel(point.ts) : "";
+            return index >= 0 && index < ts.length ? formatTimeLabel(ts[index]) : "";
           },
         },
         title: {
@@ -275,9 +361,12 @@ function SensorLineChart({
   title,
   data,
   height = 420,
+  node,
   onZoomStateChange,
 }: Props) {
   const chartRefs = useRef<Record<string, ChartJS<"line"> | null>>({});
+  const glPlotRefs = useRef<Record<string, GlTracePlotHandle | null>>({});
+  const useWebGl = isWebGlSupported();
   const [chartZoomState, setChartZoomState] = useState<Record<string, boolean>>({});
 
   const channelOptions = useMemo(() => {
@@ -308,12 +397,21 @@ function SensorLineChart({
     setSelectedChannels(channelOptions.map((option) => option.key));
   }, [channelOptions]);
 
-  const allDatasets =
-    data.sensor === "accelerometer"
-      ? buildAccelerometerDatasets(data.points)
-      : data.sensor === "inclinometer"
-        ? buildInclinometerDatasets(data.points)
-        : buildTemperatureDatasets(data.points, data.unit ?? "");
+  const axes = AXES_BY_SENSOR[data.sensor];
+  const columns = useMemo(
+    () => data.columns ?? pointsToColumns(data.points, AXES_BY_SENSOR[data.sensor]),
+    [data]
+  );
+
+  const allDatasets = useMemo(
+    () =>
+      data.sensor === "accelerometer"
+        ? buildAccelerometerDatasets(columns)
+        : data.sensor === "inclinometer"
+          ? buildInclinometerDatasets(columns)
+          : buildTemperatureDatasets(columns, data.unit ?? ""),
+    [data.sensor, data.unit, columns]
+  );
 
   const visibleDatasets = allDatasets.filter((dataset) => {
     if (!channelOptions.length) return true;
@@ -352,6 +450,28 @@ function SensorLineChart({
     };
   }, [onZoomStateChange]);
 
+  const traceLayers = useMemo(() => {
+    if (!useWebGl) return {};
+    const layers: Record<string, TraceLayer | null> = {};
+    for (const dataset of allDatasets) {
+      layers[dataset.label] = buildTraceLayer(columns, axes.indexOf(dataset.axis));
+    }
+    return layers;
+  }, [useWebGl, allDatasets, columns, axes]);
+
+  const detailFetchers = useMemo(() => {
+    const fetchers: Record<string, DetailFetcher> = {};
+    if (node == null) return fetchers;
+    for (const dataset of allDatasets) {
+      fetchers[dataset.label] = buildDetailFetcher(
+        node,
+        PLOT_WINDOW_SENSOR[data.sensor],
+        dataset.axis
+      );
+    }
+    return fetchers;
+  }, [node, allDatasets, data.sensor]);
+
   const perChartHeight = visibleDatasets.length > 1 ? 250 : height;
 
   function handleChannelToggle(channel: string) {
@@ -380,6 +500,7 @@ function SensorLineChart({
 
   function handleResetZoom(label: string) {
     chartRefs.current[label]?.resetZoom();
+    glPlotRefs.current[label]?.resetZoom();
     setDatasetZoomState(label, false);
   }
 
@@ -436,21 +557,35 @@ function SensorLineChart({
               </div>
 
               <div className="sp-plot-canvas" style={{ height: perChartHeight }}>
-                <Line
-                  ref={(chart) => {
-                    chartRefs.current[dataset.label] = chart ?? null;
-                  }}
-                  data={chartData}
-                  options={buildChartOptions(
-                    data.points,
-                    getYAxisLabel(dataset.label),
-                    (zoomed) => setDatasetZoomState(dataset.label, zoomed)
-                  )}
-                />
+                {useWebGl ? (
+                  <GlTracePlot
+                    ref={(handle) => {
+                      glPlotRefs.current[dataset.label] = handle;
+                    }}
+                    layer={traceLayers[dataset.label] ?? null}
+                    color={dataset.borderColor}
+                    yAxisLabel={getYAxisLabel(dataset.label)}
+                    fetchDetail={detailFetchers[dataset.label]}
+                    onZoomChange={(zoomed) => setDatasetZoomState(dataset.label, zoomed)}
+                  />
+                ) : (
+                  <Line
+                    ref={(chart) => {
+                      chartRefs.current[dataset.label] = chart ?? null;
+                    }}
+                    data={chartData}
+                    options={buildChartOptions(
+                      columns.ts,
+                      getYAxisLabel(dataset.label),
+                      (zoomed) => setDatasetZoomState(dataset.label, zoomed)
+                    )}
+                  />
+                )}
               </div>
 
               <div className="sp-plot-hint">
                 Ctrl + wheel to zoom, Alt + drag to zoom box, Shift + drag to pan
+                {useWebGl && ", double-click to reset"}
               </div>
             </section>
           );
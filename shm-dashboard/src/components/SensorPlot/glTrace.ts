@@ -0,0 +1,274 @@
+// WebGL line renderer for SensorPlot. A trace's samples are uploaded once as
+// typed-array vertex buffers and the view (time and value range) is applied
+// in the vertex shader, so panning and zooming through a few hundred
+// thousand points only redraws. Min / max buckets draw as a band under the
+// mean line.
+//
+// Two layers per trace: "overview" (the whole plotted window, as loaded by
+// the page) and "detail" (the zoomed range fetched again at a finer
+// resolution). Where the detail layer has data the overview is scissored
+// out, so the two never draw over each other.
+
+export type TraceLayer = {
+  // x is seconds since t0 (epoch seconds), so float32 keeps sub-millisecond
+  // resolution within a layer
+  t0: number;
+  x: Float32Array;
+  // NaN breaks the line
+  y: Float32Array;
+  lo: Float32Array | null;
+  hi: Float32Array | null;
+  // Covered time range, epoch seconds
+  start: number;
+  end: number;
+  // Seconds per point; 0 when the layer holds raw samples
+  resolutionS: number;
+};
+
+export type TraceView = {
+  xMin: number;
+  xMax: number;
+  yMin: number;
+  yMax: number;
+};
+
+export type LayerSlot = "overview" | "detail";
+
+type GpuLayer = {
+  layer: TraceLayer;
+  line: WebGLBuffer;
+  band: WebGLBuffer | null;
+  lineRuns: [number, number][];
+  bandRuns: [number, number][];
+};
+
+const VERTEX_SHADER = `
+attribute vec2 a_pos;
+uniform vec2 u_origin;
+uniform vec2 u_scale;
+void main() {
+  gl_Position = vec4((a_pos - u_origin) * u_scale - 1.0, 0.0, 1.0);
+  gl_PointSize = 2.0;
+}`;
+
+const FRAGMENT_SHADER = `
+precision mediump float;
+uniform vec4 u_color;
+void main() {
+  gl_FragColor = u_color;
+}`;
+
+const BAND_ALPHA = 0.25;
+
+function compileShader(gl: WebGLRenderingContext, type: number, source: string) {
+  const shader = gl.createShader(type);
+  if (!shader) throw new Error("WebGL: cannot create shader");
+  gl.shaderSource(shader, source);
+  gl.compileShader(shader);
+  if (!gl.getShaderParameter(shader, gl.COMPILE_STATUS)) {
+    throw new Error(`WebGL: ${gl.getShaderInfoLog(shader) ?? "shader compile failed"}`);
+  }
+  return shader;
+}
+
+function parseHexColor(color: string): [number, number, number] {
+  const hex = color.replace("#", "");
+  const value = Number.parseInt(hex.length === 3 ? hex.replace(/./g, "$&$&") : hex, 16);
+  return [((value >> 16) & 255) / 255, ((value >> 8) & 255) / 255, (value & 255) / 255];
+}
+
+// [first, count] of each run of indices where every column is finite.
+function finiteRuns(columns: Float32Array[], length: number): [number, number][] {
+  const runs: [number, number][] = [];
+  let first = -1;
+  for (let index = 0; index <= length; index += 1) {
+    const finite =
+      index < length && columns.every((column) => Number.isFinite(column[index]));
+    if (finite && first < 0) {
+      first = index;
+    } else if (!finite && first >= 0) {
+      runs.push([first, index - first]);
+      first = -1;
+    }
+  }
+  return runs;
+}
+
+let supported: boolean | null = null;
+
+export function isWebGlSupported() {
+  if (supported === null) {
+    try {
+      supported = Boolean(document.createElement("canvas").getContext("webgl"));
+    } catch {
+      supported = false;
+    }
+  }
+  return supported;
+}
+
+export class GlTraceRenderer {
+  private readonly gl: WebGLRenderingContext;
+  private readonly program: WebGLProgram;
+  private readonly aPos: number;
+  private readonly uOrigin: WebGLUniformLocation | null;
+  private readonly uScale: WebGLUniformLocation | null;
+  private readonly uColor: WebGLUniformLocation | null;
+  private readonly color: [number, number, number];
+  private layers: Partial<Record<LayerSlot, GpuLayer>> = {};
+
+  constructor(canvas: HTMLCanvasElement, color: string) {
+    const gl = canvas.getContext("webgl", { antialias: true, premultipliedAlpha: false });
+    if (!gl) throw new Error("WebGL is not available");
+    this.gl = gl;
+
+    const program = gl.createProgram();
+    if (!program) throw new Error("WebGL: cannot create program");
+    gl.attachShader(program, compileShader(gl, gl.VERTEX_SHADER, VERTEX_SHADER));
+    gl.attachShader(program, compileShader(gl, gl.FRAGMENT_SHADER, FRAGMENT_SHADER));
+    gl.linkProgram(program);
+    if (!gl.getProgramParameter(program, gl.LINK_STATUS)) {
+      throw new Error(`WebGL: ${gl.getProgramInfoLog(program) ?? "program link failed"}`);
+    }
+    this.program = program;
+    this.aPos = gl.getAttribLocation(program, "a_pos");
+    this.uOrigin = gl.getUniformLocation(program, "u_origin");
+    this.uScale = gl.getUniformLocation(program, "u_scale");
+    this.uColor = gl.getUniformLocation(program, "u_color");
+    this.color = parseHexColor(color);
+
+    gl.enable(gl.BLEND);
+    gl.blendFunc(gl.SRC_ALPHA, gl.ONE_MINUS_SRC_ALPHA);
+  }
+
+  resize(width: number, height: number) {
+    const canvas = this.gl.canvas as HTMLCanvasElement;
+    if (canvas.width !== width || canvas.height !== height) {
+      canvas.width = width;
+      canvas.height = height;
+    }
+    this.gl.viewport(0, 0, width, height);
+  }
+
+  layer(slot: LayerSlot): TraceLayer | null {
+    return this.layers[slot]?.layer ?? null;
+  }
+
+  setLayer(slot: LayerSlot, layer: TraceLayer | null) {
+    const gl = this.gl;
+    const previous = this.layers[slot];
+    if (previous) {
+      gl.deleteBuffer(previous.line);
+      if (previous.band) gl.deleteBuffer(previous.band);
+      delete this.layers[slot];
+    }
+    if (!layer) return;
+
+    const length = layer.x.length;
+    const line = new Float32Array(length * 2);
+    for (let index = 0; index < length; index += 1) {
+      line[index * 2] = layer.x[index];
+      line[index * 2 + 1] = layer.y[index];
+    }
+    const lineBuffer = gl.createBuffer();
+    if (!lineBuffer) throw new Error("WebGL: cannot create buffer");
+    gl.bindBuffer(gl.ARRAY_BUFFER, lineBuffer);
+    gl.bufferData(gl.ARRAY_BUFFER, line, gl.STATIC_DRAW);
+
+    let bandBuffer: WebGLBuffer | null = null;
+    let bandRuns: [number, number][] = [];
+    if (layer.lo && layer.hi) {
+      // Triangle strip along the bucket extremes: (x, lo), (x, hi), ...
+      const band = new Float32Array(length * 4);
+      for (let index = 0; index < length; index += 1) {
+        band[index * 4] = layer.x[index];
+        band[index * 4 + 1] = layer.lo[index];
+        band[index * 4 + 2] = layer.x[index];
+        band[index * 4 + 3] = layer.hi[index];
+      }
+      bandBuffer = gl.createBuffer();
+      gl.bindBuffer(gl.ARRAY_BUFFER, bandBuffer);
+      gl.bufferData(gl.ARRAY_BUFFER, band, gl.STATIC_DRAW);
+      bandRuns = finiteRuns([layer.lo, layer.hi], length).map(
+        ([first, count]): [number, number] => [first * 2, count * 2]
+      );
+    }
+
+    this.layers[slot] = {
+      layer,
+      line: lineBuffer,
+      band: bandBuffer,
+      lineRuns: finiteRuns([layer.y], length),
+      bandRuns,
+    };
+  }
+
+  private drawLayer(gpu: GpuLayer, view: TraceView) {
+    const gl = this.gl;
+    const [r, g, b] = this.color;
+    gl.uniform2f(this.uOrigin, view.xMin - gpu.layer.t0, view.yMin);
+    gl.uniform2f(this.uScale, 2 / (view.xMax - view.xMin), 2 / (view.yMax - view.yMin));
+
+    if (gpu.band) {
+      gl.bindBuffer(gl.ARRAY_BUFFER, gpu.band);
+      gl.vertexAttribPointer(this.aPos, 2, gl.FLOAT, false, 0, 0);
+      gl.uniform4f(this.uColor, r, g, b, BAND_ALPHA);
+      for (const [first, count] of gpu.bandRuns) {
+        gl.drawArrays(gl.TRIANGLE_STRIP, first, count);
+      }
+    }
+
+    gl.bindBuffer(gl.ARRAY_BUFFER, gpu.line);
+    gl.vertexAttribPointer(this.aPos, 2, gl.FLOAT, false, 0, 0);
+    gl.uniform4f(this.uColor, r, g, b, 1);
+    for (const [first, count] of gpu.lineRuns) {
+      gl.drawArrays(count === 1 ? gl.POINTS : gl.LINE_STRIP, first, count);
+    }
+  }
+
+  draw(view: TraceView) {
+    const gl = this.gl;
+    const width = gl.drawingBufferWidth;
+    const height = gl.drawingBufferHeight;
+    gl.disable(gl.SCISSOR_TEST);
+    gl.clearColor(0, 0, 0, 0);
+    gl.clear(gl.COLOR_BUFFER_BIT);
+    if (!(view.xMax > view.xMin) || !(view.yMax > view.yMin)) return;
+
+    gl.useProgram(this.program);
+    gl.enableVertexAttribArray(this.aPos);
+
+    const overview = this.layers.overview;
+    const detail = this.layers.detail;
+    if (overview) {
+      if (detail) {
+        // Overview only left and right of the detail range
+        const toPx = (t: number) =>
+          Math.round(((t - view.xMin) / (view.xMax - view.xMin)) * width);
+        const left = Math.max(0, Math.min(width, toPx(detail.layer.start)));
+        const right = Math.max(0, Math.min(width, toPx(detail.layer.end)));
+        gl.enable(gl.SCISSOR_TEST);
+        if (left > 0) {
+          gl.scissor(0, 0, left, height);
+          this.drawLayer(overview, view);
+        }
+        if (right < width) {
+          gl.scissor(right, 0, width - right, height);
+          this.drawLayer(overview, view);
+        }
+        gl.disable(gl.SCISSOR_TEST);
+      } else {
+        this.drawLayer(overview, view);
+      }
+    }
+    if (detail) {
+      this.drawLayer(detail, view);
+    }
+  }
+
+  dispose() {
+    this.setLayer("overview", null);
+    this.setLayer("detail", null);
+    this.gl.deleteProgram(this.program);
+  }
+}
@@ -0,0 +1,542 @@
+import {
+  GlTraceRenderer,
+  type TraceLayer,
+  type TraceView,
+} from "./glTrace";
+
+// Imperative side of GlTracePlot, in the way Chart.js instances sit behind
+// react-chartjs-2: owns the renderer, the view, the axes overlay, pointer
+// handling and the detail requests, so moving the mouse or zooming never
+// re-renders React.
+//
+// Zooming narrows the view over the overview layer at once; DETAIL_DEBOUNCE_MS
+// after the view settles, the visible range (plus DETAIL_MARGIN on each side)
+// is fetched again through fetchDetail at about two points per pixel, which
+// the backend serves from the finest fitting pyramid level or sample by
+// sample for short windows.
+
+export type DetailFetcher = (
+  start: number,
+  end: number,
+  points: number,
+  signal: AbortSignal
+) => Promise<TraceLayer | null>;
+
+export type GlTraceOptions = {
+  yAxisLabel: string;
+  fetchDetail?: DetailFetcher;
+  onZoomChange?: (zoomed: boolean) => void;
+};
+
+export type GlTraceElements = {
+  shell: HTMLDivElement;
+  glCanvas: HTMLCanvasElement;
+  axisCanvas: HTMLCanvasElement;
+  tooltip: HTMLDivElement;
+  status: HTMLDivElement;
+};
+
+const MARGIN = { left: 64, right: 14, top: 10, bottom: 40 };
+const DETAIL_DEBOUNCE_MS = 200;
+const DETAIL_MARGIN = 0.25;
+const DETAIL_MAX_POINTS = 20000;
+const MIN_VIEW_S = 0.02;
+const WHEEL_ZOOM_SPEED = 0.002;
+const GRID_COLOR = "#e8eef5";
+const TEXT_COLOR = "#6f7c8d";
+const SELECTION_FILL = "rgba(37, 99, 235, 0.10)";
+const SELECTION_STROKE = "rgba(37, 99, 235, 0.35)";
+const TIME_STEPS_S = [
+  0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1, 2, 5, 10, 15, 30, 60, 120,
+  300, 600, 900, 1800, 3600, 7200, 10800, 21600, 43200, 86400,
+];
+
+type Drag =
+  | { mode: "pan"; startPx: number; xMin: number; xMax: number }
+  | { mode: "box"; startPx: number; currentPx: number };
+
+function niceStep(span: number, targetTicks: number) {
+  const raw = span / Math.max(1, targetTicks);
+  const magnitude = 10 ** Math.floor(Math.log10(raw));
+  const residual = raw / magnitude;
+  const nice = residual <= 1 ? 1 : residual <= 2 ? 2 : residual <= 5 ? 5 : 10;
+  return nice * magnitude;
+}
+
+function stepDecimals(step: number) {
+  return Math.max(0, Math.min(6, -Math.floor(Math.log10(step) + 1e-9)));
+}
+
+function formatTime(epochS: number, step: number) {
+  const date = new Date(epochS * 1000);
+  const label = date.toLocaleTimeString([], {
+    hour: "2-digit",
+    minute: "2-digit",
+    second: "2-digit",
+  });
+  const decimals = stepDecimals(step);
+  if (decimals === 0) return label;
+  const fraction = (epochS - Math.floor(epochS)).toFixed(decimals).slice(1);
+  return `${label}${fraction}`;
+}
+
+// First index whose x is >= value (x sorted).
+function lowerBound(x: Float32Array, value: number) {
+  let lo = 0;
+  let hi = x.length;
+  while (lo < hi) {
+    const mid = (lo + hi) >>> 1;
+    if (x[mid] < value) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+export class GlTraceController {
+  private readonly elements: GlTraceElements;
+  private readonly renderer: GlTraceRenderer;
+  private readonly resizeObserver: ResizeObserver;
+  private options: GlTraceOptions = { yAxisLabel: "" };
+  private view: { xMin: number; xMax: number } | null = null;
+  private size = { width: 0, height: 0, dpr: 1 };
+  private drag: Drag | null = null;
+  private frame = 0;
+  private detailTimer = 0;
+  private detailAbort: AbortController | null = null;
+  private lastY: { yMin: number; yMax: number } = { yMin: -1, yMax: 1 };
+
+  constructor(elements: GlTraceElements, color: string) {
+    this.elements = elements;
+    this.renderer = new GlTraceRenderer(elements.glCanvas, color);
+
+    const { axisCanvas } = elements;
+    axisCanvas.addEventListener("wheel", this.onWheel, { passive: false });
+    axisCanvas.addEventListener("pointerdown", this.onPointerDown);
+    axisCanvas.addEventListener("pointermove", this.onPointerMove);
+    axisCanvas.addEventListener("pointerup", this.onPointerUp);
+    axisCanvas.addEventListener("pointerleave", this.onPointerLeave);
+    axisCanvas.addEventListener("dblclick", this.onDoubleClick);
+
+    this.resizeObserver = new ResizeObserver(() => this.resize());
+    this.resizeObserver.observe(elements.shell);
+    this.resize();
+  }
+
+  setOptions(options: GlTraceOptions) {
+    this.options = options;
+    this.scheduleDraw();
+  }
+
+  setOverview(layer: TraceLayer | null) {
+    this.renderer.setLayer("overview", layer);
+    if (!layer) {
+      this.clearDetail();
+      this.view = null;
+    }
+    this.scheduleDraw();
+  }
+
+  resetZoom() {
+    this.view = null;
+    this.clearDetail();
+    this.options.onZoomChange?.(false);
+    this.scheduleDraw();
+  }
+
+  dispose() {
+    cancelAnimationFrame(this.frame);
+    this.clearDetail();
+    this.resizeObserver.disconnect();
+    const { axisCanvas } = this.elements;
+    axisCanvas.removeEventListener("wheel", this.onWheel);
+    axisCanvas.removeEventListener("pointerdown", this.onPointerDown);
+    axisCanvas.removeEventListener("pointermove", this.onPointerMove);
+    axisCanvas.removeEventListener("pointerup", this.onPointerUp);
+    axisCanvas.removeEventListener("pointerleave", this.onPointerLeave);
+    axisCanvas.removeEventListener("dblclick", this.onDoubleClick);
+    this.renderer.dispose();
+  }
+
+  private fullRange() {
+    const overview = this.renderer.layer("overview");
+    return overview ? { xMin: overview.start, xMax: overview.end } : null;
+  }
+
+  private currentX() {
+    return this.view ?? this.fullRange();
+  }
+
+  private plotRect() {
+    return {
+      left: MARGIN.left,
+      top: MARGIN.top,
+      width: Math.max(1, this.size.width - MARGIN.left - MARGIN.right),
+      height: Math.max(1, this.size.height - MARGIN.top - MARGIN.bottom),
+    };
+  }
+
+  private resize() {
+    const { shell, glCanvas, axisCanvas } = this.elements;
+    const width = shell.clientWidth;
+    const height = shell.clientHeight;
+    const dpr = window.devicePixelRatio || 1;
+    this.size = { width, height, dpr };
+
+    const plot = this.plotRect();
+    glCanvas.style.left = `${plot.left}px`;
+    glCanvas.style.top = `${plot.top}px`;
+    glCanvas.style.width = `${plot.width}px`;
+    glCanvas.style.height = `${plot.height}px`;
+    this.renderer.resize(Math.round(plot.width * dpr), Math.round(plot.height * dpr));
+
+    axisCanvas.width = Math.round(width * dpr);
+    axisCanvas.height = Math.round(height * dpr);
+    this.scheduleDraw();
+  }
+
+  private clearDetail() {
+    window.clearTimeout(this.detailTimer);
+    this.detailAbort?.abort();
+    this.detailAbort = null;
+    this.renderer.setLayer("detail", null);
+    this.elements.status.textContent = "";
+  }
+
+  private setView(xMin: number, xMax: number) {
+    const full = this.fullRange();
+    if (!full) return;
+
+    const fullSpan = full.xMax - full.xMin;
+    let span = Math.min(fullSpan, Math.max(MIN_VIEW_S, xMax - xMin));
+    if (span >= fullSpan) {
+      this.resetZoom();
+      return;
+    }
+    let start = Math.max(full.xMin, Math.min(xMin, full.xMax - span));
+    if (xMax - xMin < MIN_VIEW_S) {
+      // Keep a too-narrow selection centred
+      start = Math.max(full.xMin, (xMin + xMax) / 2 - span / 2);
+      span = Math.min(span, full.xMax - start);
+    }
+    this.view = { xMin: start, xMax: start + span };
+    this.options.onZoomChange?.(true);
+    this.scheduleDraw();
+    this.scheduleDetail();
+  }
+
+  private scheduleDetail() {
+    window.clearTimeout(this.detailTimer);
+    if (!this.options.fetchDetail) return;
+    this.detailTimer = window.setTimeout(() => void this.loadDetail(), DETAIL_DEBOUNCE_MS);
+  }
+
+  private async loadDetail() {
+    const fetchDetail = this.options.fetchDetail;
+    const view = this.view;
+    const full = this.fullRange();
+    const overview = this.renderer.layer("overview");
+    if (!fetchDetail || !view || !full || !overview) return;
+
+    const span = view.xMax - view.xMin;
+    const plotWidth = this.plotRect().width;
+    const wanted = span / plotWidth;
+
+    const covers = (layer: TraceLayer | null) =>
+      layer !== null && layer.start <= view.xMin && layer.end >= view.xMax;
+    const detail = this.renderer.layer("detail");
+    if (covers(detail) && detail!.resolutionS <= wanted) return;
+    if (overview.resolutionS <= wanted) return;
+
+    const start = Math.max(full.xMin, view.xMin - span * DETAIL_MARGIN);
+    const end = Math.min(full.xMax, view.xMax + span * DETAIL_MARGIN);
+    const points = Math.min(
+      DETAIL_MAX_POINTS,
+      Math.ceil(((end - start) / span) * plotWidth * 2)
+    );
+
+    this.detailAbort?.abort();
+    const abort = new AbortController();
+    this.detailAbort = abort;
+    this.elements.status.textContent = "Loading detail…";
+
+    try {
+      const layer = await fetchDetail(start, end, points, abort.signal);
+      if (abort.signal.aborted) return;
+      this.renderer.setLayer("detail", layer);
+      this.elements.status.textContent = layer
+        ? layer.resolutionS > 0
+          ? `Detail: ${layer.x.length.toLocaleString()} points, ${layer.resolutionS.toPrecision(3)} s buckets`
+          : `Detail: ${layer.x.length.toLocaleString()} samples, full resolution`
+        : "";
+      this.scheduleDraw();
+    } catch (err) {
+      if (abort.signal.aborted) return;
+      this.elements.status.textContent = `Detail unavailable: ${
+        err instanceof Error ? err.message : String(err)
+      }`;
+    } finally {
+      if (this.detailAbort === abort) this.detailAbort = null;
+    }
+  }
+
+  // Value range of the layers' data drawn in [xMin, xMax], padded.
+  private yRange(xMin: number, xMax: number) {
+    const detail = this.renderer.layer("detail");
+    let lo = Infinity;
+    let hi = -Infinity;
+
+    const scan = (layer: TraceLayer, from: number, to: number) => {
+      if (to <= from) return;
+      const first = Math.max(0, lowerBound(layer.x, from - layer.t0) - 1);
+      const last = Math.min(layer.x.length, lowerBound(layer.x, to - layer.t0) + 1);
+      const low = layer.lo ?? layer.y;
+      const high = layer.hi ?? layer.y;
+      for (let index = first; index < last; index += 1) {
+        const a = low[index];
+        const b = high[index];
+        if (a < lo) lo = a;
+        if (b > hi) hi = b;
+      }
+    };
+
+    const overview = this.renderer.layer("overview");
+    if (overview) {
+      if (detail) {
+        scan(overview, xMin, Math.min(xMax, detail.start));
+        scan(overview, Math.max(xMin, detail.end), xMax);
+      } else {
+        scan(overview, xMin, xMax);
+      }
+    }
+    if (detail) {
+      scan(detail, Math.max(xMin, detail.start), Math.min(xMax, detail.end));
+    }
+
+    if (!Number.isFinite(lo) || !Number.isFinite(hi)) {
+      return this.lastY;
+    }
+    const pad = hi > lo ? (hi - lo) * 0.05 : Math.max(Math.abs(hi) * 0.05, 1e-3);
+    this.lastY = { yMin: lo - pad, yMax: hi + pad };
+    return this.lastY;
+  }
+
+  private scheduleDraw() {
+    if (this.frame) return;
+    this.frame = requestAnimationFrame(() => {
+      this.frame = 0;
+      this.draw();
+    });
+  }
+
+  private draw() {
+    const x = this.currentX();
+    if (!x) {
+      this.renderer.draw({ xMin: 0, xMax: 0, yMin: 0, yMax: 0 });
+      this.drawAxes(null);
+      return;
+    }
+    const view: TraceView = { ...x, ...this.yRange(x.xMin, x.xMax) };
+    this.renderer.draw(view);
+    this.drawAxes(view);
+  }
+
+  private drawAxes(view: TraceView | null) {
+    const { axisCanvas } = this.elements;
+    const ctx = axisCanvas.getContext("2d");
+    if (!ctx) return;
+    const { width, height, dpr } = this.size;
+    ctx.setTransform(dpr, 0, 0, dpr, 0, 0);
+    ctx.clearRect(0, 0, width, height);
+    if (!view) return;
+
+    const plot = this.plotRect();
+    const toX = (t: number) =>
+      plot.left + ((t - view.xMin) / (view.xMax - view.xMin)) * plot.width;
+    const toY = (v: number) =>
+      plot.top + plot.height - ((v - view.yMin) / (view.yMax - view.yMin)) * plot.height;
+
+    ctx.font = "11px system-ui, sans-serif";
+    ctx.lineWidth = 1;
+    ctx.strokeStyle = GRID_COLOR;
+    ctx.fillStyle = TEXT_COLOR;
+
+    // Value grid and labels
+    const yStep = niceStep(view.yMax - view.yMin, Math.max(2, Math.floor(plot.height / 50)));
+    const yDecimals = stepDecimals(yStep);
+    ctx.textAlign = "right";
+    ctx.textBaseline = "middle";
+    for (let v = Math.ceil(view.yMin / yStep) * yStep; v <= view.yMax; v += yStep) {
+      const y = Math.round(toY(v)) + 0.5;
+      ctx.beginPath();
+      ctx.moveTo(plot.left, y);
+      ctx.lineTo(plot.left + plot.width, y);
+      ctx.stroke();
+      ctx.fillText(v.toFixed(yDecimals), plot.left - 6, y);
+    }
+
+    // Time grid and labels
+    const targetSteps = Math.max(2, Math.floor(plot.width / 110));
+    const rawStep = (view.xMax - view.xMin) / targetSteps;
+    const tStep = TIME_STEPS_S.find((step) => step >= rawStep) ?? rawStep;
+    ctx.textAlign = "center";
+    ctx.textBaseline = "top";
+    // Align to local wall-clock steps, as the labels are local time
+    const offsetS = new Date(view.xMin * 1000).getTimezoneOffset() * 60;
+    const firstTick = Math.ceil((view.xMin - offsetS) / tStep) * tStep + offsetS;
+    for (let t = firstTick; t <= view.xMax; t += tStep) {
+      const x = Math.round(toX(t)) + 0.5;
+      ctx.beginPath();
+      ctx.moveTo(x, plot.top);
+      ctx.lineTo(x, plot.top + plot.height);
+      ctx.stroke();
+      ctx.fillText(formatTime(t, tStep), x, plot.top + plot.height + 6);
+    }
+
+    ctx.font = "bold 11px system-ui, sans-serif";
+    ctx.fillText("Time", plot.left + plot.width / 2, plot.top + plot.height + 22);
+    ctx.save();
+    ctx.translate(12, plot.top + plot.height / 2);
+    ctx.rotate(-Math.PI / 2);
+    ctx.textBaseline = "middle";
+    ctx.fillText(this.options.yAxisLabel, 0, 0);
+    ctx.restore();
+
+    if (this.drag?.mode === "box") {
+      const left = Math.min(this.drag.startPx, this.drag.currentPx);
+      const boxWidth = Math.abs(this.drag.currentPx - this.drag.startPx);
+      ctx.fillStyle = SELECTION_FILL;
+      ctx.strokeStyle = SELECTION_STROKE;
+      ctx.fillRect(left, plot.top, boxWidth, plot.height);
+      ctx.strokeRect(left + 0.5, plot.top + 0.5, boxWidth, plot.height);
+    }
+  }
+
+  private timeAt(px: number) {
+    const x = this.currentX();
+    if (!x) return null;
+    const plot = this.plotRect();
+    return x.xMin + ((px - plot.left) / plot.width) * (x.xMax - x.xMin);
+  }
+
+  private localX(event: PointerEvent | WheelEvent | MouseEvent) {
+    return event.clientX - this.elements.axisCanvas.getBoundingClientRect().left;
+  }
+
+  private onWheel = (event: WheelEvent) => {
+    if (!event.ctrlKey) return;
+    const x = this.currentX();
+    const t = this.timeAt(this.localX(event));
+    if (!x || t === null) return;
+    event.preventDefault();
+
+    const factor = Math.exp(event.deltaY * WHEEL_ZOOM_SPEED);
+    this.setView(t - (t - x.xMin) * factor, t + (x.xMax - t) * factor);
+  };
+
+  private onPointerDown = (event: PointerEvent) => {
+    const x = this.currentX();
+    if (!x || event.button !== 0) return;
+    const px = this.localX(event);
+
+    if (event.shiftKey) {
+      this.drag = { mode: "pan", startPx: px, xMin: x.xMin, xMax: x.xMax };
+    } else if (event.altKey) {
+      this.drag = { mode: "box", startPx: px, currentPx: px };
+    } else {
+      return;
+    }
+    event.preventDefault();
+    this.elements.axisCanvas.setPointerCapture(event.pointerId);
+    this.hideTooltip();
+  };
+
+  private onPointerMove = (event: PointerEvent) => {
+    const px = this.localX(event);
+    const drag = this.drag;
+
+    if (drag?.mode === "pan") {
+      const plot = this.plotRect();
+      const shift = ((drag.startPx - px) / plot.width) * (drag.xMax - drag.xMin);
+      this.setView(drag.xMin + shift, drag.xMax + shift);
+      return;
+    }
+    if (drag?.mode === "box") {
+      drag.currentPx = px;
+      this.scheduleDraw();
+      return;
+    }
+    this.showTooltip(event);
+  };
+
+  private onPointerUp = (event: PointerEvent) => {
+    const drag = this.drag;
+    this.drag = null;
+    if (this.elements.axisCanvas.hasPointerCapture(event.pointerId)) {
+      this.elements.axisCanvas.releasePointerCapture(event.pointerId);
+    }
+    if (drag?.mode !== "box") return;
+
+    const a = this.timeAt(drag.startPx);
+    const b = this.timeAt(drag.currentPx);
+    if (a !== null && b !== null && Math.abs(drag.currentPx - drag.startPx) > 4) {
+      this.setView(Math.min(a, b), Math.max(a, b));
+    } else {
+      this.scheduleDraw();
+    }
+  };
+
+  private onPointerLeave = () => {
+    this.hideTooltip();
+  };
+
+  private onDoubleClick = () => {
+    if (this.view) this.resetZoom();
+  };
+
+  private hideTooltip() {
+    this.elements.tooltip.style.display = "none";
+  }
+
+  // Nearest sample / bucket of the layer drawn under the pointer.
+  private showTooltip(event: PointerEvent) {
+    const px = this.localX(event);
+    const plot = this.plotRect();
+    const t = this.timeAt(px);
+    if (t === null || px < plot.left || px > plot.left + plot.width) {
+      this.hideTooltip();
+      return;
+    }
+
+    const detail = this.renderer.layer("detail");
+    const layer =
+      detail && t >= detail.start && t <= detail.end
+        ? detail
+        : this.renderer.layer("overview");
+    if (!layer || layer.x.length === 0) {
+      this.hideTooltip();
+      return;
+    }
+
+    const rel = t - layer.t0;
+    let index = Math.min(layer.x.length - 1, lowerBound(layer.x, rel));
+    if (index > 0 && rel - layer.x[index - 1] < layer.x[index] - rel) index -= 1;
+    const value = layer.y[index];
+    if (!Number.isFinite(value)) {
+      this.hideTooltip();
+      return;
+    }
+
+    const view = this.currentX()!;
+    const precision = stepDecimals((view.xMax - view.xMin) / plot.width);
+    let text = `${formatTime(layer.t0 + layer.x[index], 10 ** -precision)}  ${value.toFixed(4)}`;
+    if (layer.lo && layer.hi) {
+      text += ` (${layer.lo[index].toFixed(4)} … ${layer.hi[index].toFixed(4)})`;
+    }
+
+    const { tooltip } = this.elements;
+    tooltip.textContent = text;
+    tooltip.style.display = "block";
+    tooltip.style.left = `${Math.min(px + 12, this.size.width - tooltip.offsetWidth - 4)}px`;
+    tooltip.style.top = `${Math.max(4, event.clientY - this.elements.shell.getBoundingClientRect().top - 28)}px`;
+  }
+}
@@ -5,16 +5,17 @@ const API_BASE = import.meta.env.VITE_API_BASE_URL ?? "";
   httpOnly session cookie automatically. Leave VITE_API_BASE_URL unset in
   local development to use the Vite proxy.
 */
-async function request<T>(
+async function fetchOk(
   path: string,
-  options?: RequestInit & { signal?: AbortSignal }
-): Promise<T> {
+  options?: RequestInit & { signal?: AbortSignal },
+  allowNotModified = false
+): Promise<Response> {
   const res = await fetch(`${API_BASE}${path}`, {
     credentials: "include",
     ...options,
   });
 
-  if (!res.ok) {
+  if (!res.ok && !(allowNotModified && res.status === 304)) {
     let msg = `HTTP ${res.status}`;
     try {
       const text = await res.text();
@@ -25,6 +26,14 @@ async function request<T>(
     throw new Error(msg);
   }
 
+  return res;
+}
+
+async function request<T>(
+  path: string,
+  options?: RequestInit & { signal?: AbortSignal }
+): Promise<T> {
+  const res = await fetchOk(path, options);
   return (await res.json()) as T;
 }
 
@@ -199,6 +208,7 @@ export type AccelerometerPlotResponse = {
   unit: "g";
   node: number;
   points: AccelerometerPlotPoint[];
+  columns?: PlotWindow;
 };
 
 export type InclinometerPlotResponse = {
@@ -206,6 +216,7 @@ export type InclinometerPlotResponse = {
   unit: "deg";
   node: number;
   points: InclinometerPlotPoint[];
+  columns?: PlotWindow;
 };
 
 export type TemperaturePlotResponse = {
@@ -213,6 +224,7 @@ export type TemperaturePlotResponse = {
   unit: "C";
   node: number;
   points: TemperaturePlotPoint[];
+  columns?: PlotWindow;
 };
 
 export type ApiResponse =
@@ -266,6 +278,27 @@ export type StorageStatusResponse = {
   [key: string]: unknown;
 };
 
+// /api/metrics/summary: each metric of the backend and the data listener
+// (backend metrics.py) summed over its series and processes. Histograms
+// give count, mean and the upper bound of the p50 / p95 bucket (null above
+// the last one); counters and gauges a value.
+export type MetricSummary = {
+  name: string;
+  kind: "counter" | "gauge" | "histogram";
+  help: string;
+  series: number;
+  value?: number;
+  count?: number;
+  mean?: number | null;
+  p50?: number | null;
+  p95?: number | null;
+};
+
+export type MetricsSummaryResponse = {
+  updated_at: string | null;
+  metrics: MetricSummary[];
+};
+
 export type NodeRecord = {
   node_id: number;
   serial: string;
@@ -337,6 +370,10 @@ export function getStorageStatus(signal?: AbortSignal) {
   return request<StorageStatusResponse>("/api/storage/status", { signal });
 }
 
+export function getMetricsSummary(signal?: AbortSignal) {
+  return request<MetricsSummaryResponse>("/api/metrics/summary", { signal });
+}
+
 export function getNodes(signal?: AbortSignal) {
   return request<NodesResponse>("/api/nodes", { signal });
 }
@@ -399,16 +436,158 @@ export function putSiteName(
   });
 }
 
-export function getSensorData(
+/*
+  The plot endpoints send typed columns (the /api/plot/window layout, see
+  parsePlotWindow()) to a client that accepts application/octet-stream;
+  those responses carry `columns` and an empty `points`. The sensor and
+  unit come in X-Plot-Sensor / X-Plot-Unit.
+*/
+export async function getSensorData(
   endpoint: string,
   params: { node: number; minutes: number },
   signal?: AbortSignal
-) {
+): Promise<ApiResponse> {
   const qs = new URLSearchParams();
   qs.set("node", String(params.node));
   qs.set("minutes", String(params.minutes));
 
-  return request<ApiResponse>(`${endpoint}?${qs.toString()}`, { signal });
+  const res = await fetchOk(`${endpoint}?${qs.toString()}`, {
+    headers: { Accept: "application/octet-stream, application/json;q=0.5" },
+    signal,
+  });
+  if (!res.headers.get("Content-Type")?.startsWith("application/octet-stream")) {
+    return (await res.json()) as ApiResponse;
+  }
+
+  return {
+    sensor: res.headers.get("X-Plot-Sensor") as ApiResponse["sensor"],
+    unit: res.headers.get("X-Plot-Unit") as ApiResponse["unit"],
+    node: params.node,
+    points: [],
+    columns: parsePlotWindow(await res.arrayBuffer()),
+  } as ApiResponse;
+}
+
+// Number of plot rows in a response, in either form.
+export function plotRowCount(data: ApiResponse): number {
+  return data.columns ? data.columns.ts.length : data.points.length;
+}
+
+export type PlotWindowSensor = "accel" | "inclin" | "temp";
+
+/*
+  /api/plot/window: one sensor over [start, end) as typed columns, either
+  every stored sample or mean / min / max buckets of bucketS seconds. ts is
+  epoch seconds; NaN marks a missing value or a gap. One array per requested
+  axis (all of the sensor's axes, or just `axis`).
+*/
+export type PlotWindow = {
+  kind: "samples" | "buckets";
+  bucketS: number;
+  ts: Float64Array;
+  values: Float32Array[];
+  mins: Float32Array[] | null;
+  maxs: Float32Array[] | null;
+};
+
+// Header "<4sBBBxId4x": magic, version, kind, axes, count, bucket_s
+const PLOT_WINDOW_HEADER_BYTES = 24;
+const PLOT_WINDOW_VERSION = 1;
+
+export function parsePlotWindow(buffer: ArrayBuffer): PlotWindow {
+  const view = new DataView(buffer);
+  const magic =
+    buffer.byteLength >= PLOT_WINDOW_HEADER_BYTES
+      ? String.fromCharCode(...new Uint8Array(buffer, 0, 4))
+      : "";
+  if (magic !== "SHMW" || view.getUint8(4) !== PLOT_WINDOW_VERSION) {
+    throw new Error("Unexpected plot window response");
+  }
+
+  const buckets = view.getUint8(5) === 1;
+  const axes = view.getUint8(6);
+  const count = view.getUint32(8, true);
+  const bucketS = view.getFloat64(12, true);
+
+  const ts = new Float64Array(buffer, PLOT_WINDOW_HEADER_BYTES, count);
+  let offset = PLOT_WINDOW_HEADER_BYTES + count * 8;
+  const columns = (buckets ? 3 : 1) * axes;
+  if (buffer.byteLength < offset + columns * count * 4) {
+    throw new Error("Truncated plot window response");
+  }
+  const read: Float32Array[] = [];
+  for (let index = 0; index < columns; index += 1) {
+    read.push(new Float32Array(buffer, offset, count));
+    offset += count * 4;
+  }
+
+  return {
+    kind: buckets ? "buckets" : "samples",
+    bucketS,
+    ts,
+    values: read.slice(0, axes),
+    mins: buckets ? read.slice(axes, axes * 2) : null,
+    maxs: buckets ? read.slice(axes * 2) : null,
+  };
+}
+
+// Typed arrays do not survive JSON.stringify(); the plot cache stores
+// columns as plain arrays (NaN becomes null) and revives them on load.
+type PlotWindowJson = {
+  kind: PlotWindow["kind"];
+  bucketS: number;
+  ts: number[];
+  values: (number | null)[][];
+  mins: (number | null)[][] | null;
+  maxs: (number | null)[][] | null;
+};
+
+export function plotWindowToJson(plotWindow: PlotWindow): PlotWindowJson {
+  const plain = (column: Float32Array) => Array.from(column);
+  return {
+    kind: plotWindow.kind,
+    bucketS: plotWindow.bucketS,
+    ts: Array.from(plotWindow.ts),
+    values: plotWindow.values.map(plain),
+    mins: plotWindow.mins?.map(plain) ?? null,
+    maxs: plotWindow.maxs?.map(plain) ?? null,
+  };
+}
+
+export function plotWindowFromJson(json: PlotWindowJson): PlotWindow {
+  const typed = (column: (number | null)[]) =>
+    Float32Array.from(column, (value) => value ?? Number.NaN);
+  return {
+    kind: json.kind,
+    bucketS: json.bucketS,
+    ts: Float64Array.from(json.ts),
+    values: json.values.map(typed),
+    mins: json.mins?.map(typed) ?? null,
+    maxs: json.maxs?.map(typed) ?? null,
+  };
+}
+
+export async function getPlotWindow(
+  params: {
+    node: number;
+    sensor: PlotWindowSensor;
+    start: number;
+    end: number;
+    points: number;
+    axis?: string;
+  },
+  signal?: AbortSignal
+) {
+  const qs = new URLSearchParams();
+  qs.set("node", String(params.node));
+  qs.set("sensor", params.sensor);
+  qs.set("start", String(params.start));
+  qs.set("end", String(params.end));
+  qs.set("points", String(Math.round(params.points)));
+  if (params.axis) qs.set("axis", params.axis);
+
+  const res = await fetchOk(`/api/plot/window?${qs.toString()}`, { signal });
+  return parsePlotWindow(await res.arrayBuffer());
 }
 
 export type FaultRow = {
@@ -822,6 +1001,38 @@ export function clearFaults(signal?: AbortSignal) {
   });
 }
 
+export type FleetStatusResponse = {
+  // Pass back as `since` to get only the nodes changed after this snapshot
+  tag: string;
+  // false: `nodes` holds only the changed nodes
+  full: boolean;
+  window_seconds: number;
+  time: string;
+  nodes: Omit<NodeSensorStatusResponse, "time">[];
+};
+
+// Fetch every node's sensor health, or with `since` the nodes changed after
+// that snapshot. Resolves null when nothing changed (HTTP 304).
+export async function getFleetStatus(
+  since?: string,
+  signal?: AbortSignal
+): Promise<FleetStatusResponse | null> {
+  const qs = new URLSearchParams();
+  const headers: Record<string, string> = {};
+  if (since) {
+    qs.set("since", since);
+    headers["If-None-Match"] = `"${since}"`;
+  }
+
+  const res = await fetchOk(
+    `/api/fleet/status?${qs.toString()}`,
+    { headers, cache: "no-store", signal },
+    true
+  );
+  if (res.status === 304) return null;
+  return (await res.json()) as FleetStatusResponse;
+}
+
 // Fetch per-sensor health for the selected node.
 export function getNodeSensorStatus(
   nodeId: number,
@@ -0,0 +1,82 @@
+import { getFleetStatus, type FleetStatusResponse } from "./api";
+
+export type FleetNodeStatus = FleetStatusResponse["nodes"][number];
+
+type Listener = {
+  onUpdate: (nodes: ReadonlyMap<number, FleetNodeStatus>) => void;
+  onError?: (error: unknown) => void;
+};
+
+/*
+  One poller of /api/fleet/status shared by every component showing node
+  sensor health, instead of one /api/nodes/{id}/sensor-status request per
+  node and component. Each poll sends the last snapshot tag, so the backend
+  answers 304 while nothing changed and otherwise only the changed nodes.
+  Polling runs while at least one listener is subscribed.
+*/
+const FLEET_STATUS_POLL_MS = 5000;
+
+const listeners = new Set<Listener>();
+let nodes = new Map<number, FleetNodeStatus>();
+let tag: string | undefined;
+let timer: number | undefined;
+let controller: AbortController | null = null;
+let loaded = false;
+
+async function poll() {
+  const current = new AbortController();
+  controller = current;
+  timer = undefined;
+  try {
+    const res = await getFleetStatus(tag, current.signal);
+    if (res) {
+      const next = res.full ? new Map<number, FleetNodeStatus>() : new Map(nodes);
+      for (const node of res.nodes) {
+        next.set(node.node_id, node);
+      }
+      nodes = next;
+      tag = res.tag;
+    }
+    if (res || !loaded) {
+      loaded = true;
+      listeners.forEach((listener) => listener.onUpdate(nodes));
+    }
+  } catch (error) {
+    if (current.signal.aborted) return;
+    listeners.forEach((listener) => listener.onError?.(error));
+  } finally {
+    if (controller === current) controller = null;
+  }
+  if (current.signal.aborted) return;
+
+  if (listeners.size > 0) {
+    timer = window.setTimeout(() => void poll(), FLEET_STATUS_POLL_MS);
+  }
+}
+
+// Listen to fleet sensor health; returns the unsubscribe function. A new
+// listener gets the current snapshot at once when one is loaded.
+export function subscribeFleetStatus(
+  onUpdate: Listener["onUpdate"],
+  onError?: Listener["onError"]
+) {
+  const listener: Listener = { onUpdate, onError };
+  listeners.add(listener);
+
+  if (loaded) {
+    onUpdate(nodes);
+  }
+  if (timer === undefined && controller === null) {
+    void poll();
+  }
+
+  return () => {
+    listeners.delete(listener);
+    if (listeners.size === 0) {
+      window.clearTimeout(timer);
+      timer = undefined;
+      controller?.abort();
+      controller = null;
+    }
+  };
+}